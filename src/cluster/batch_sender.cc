@@ -20,8 +20,14 @@
 
 #include "batch_sender.h"
 
+#include <glog/logging.h>
+#include <sys/socket.h>
+
+#include <cerrno>
+
 #include "io_util.h"
 #include "server/redis_reply.h"
+#include "thread_util.h"
 #include "time_util.h"
 
 Status BatchSender::Put(rocksdb::ColumnFamilyHandle *cf, const rocksdb::Slice &key, const rocksdb::Slice &value) {
@@ -70,43 +76,161 @@ Status BatchSender::Send() {
     return Status::OK();
   }
 
-  // rate limit
-  if (bytes_per_sec_ > 0) {
-    auto single_burst = rate_limiter_->GetSingleBurstBytes();
-    auto left = static_cast<int64_t>(write_batch_.GetDataSize());
-    while (left > 0) {
-      auto request_size = std::min(left, single_burst);
-      rate_limiter_->Request(request_size, rocksdb::Env::IOPriority::IO_HIGH, nullptr);
-      left -= request_size;
-    }
+  if (!sender_.joinable()) {
+    sender_ = GET_OR_RET(util::CreateThread("batch-sender", [this] { sendLoop(); }));
   }
 
-  auto s = sendApplyBatchCmd(dst_fd_, write_batch_);
-  if (!s.IsOK()) {
-    return s.Prefixed("failed to send APPLYBATCH command");
+  std::unique_lock<std::mutex> lock(mu_);
+  cv_.wait(lock, [this] { return !error_.IsOK() || queue_.size() < max_inflight_; });
+  if (!error_.IsOK()) {
+    return error_;
   }
 
-  sent_bytes_ += write_batch_.GetDataSize();
-  sent_batches_num_++;
+  queue_.emplace_back(std::move(write_batch_));
+  cv_.notify_all();
+  lock.unlock();
+
   pending_entries_ = 0;
   write_batch_.Clear();
   return Status::OK();
 }
 
+Status BatchSender::Flush() {
+  GET_OR_RET(Send());
+
+  std::unique_lock<std::mutex> lock(mu_);
+  cv_.wait(lock, [this] { return !error_.IsOK() || (queue_.empty() && inflight_ == 0); });
+  return error_;
+}
+
+BatchSender::~BatchSender() {
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    stop_ = true;
+    cv_.notify_all();
+  }
+  if (sender_.joinable()) {
+    if (auto s = util::ThreadJoin(sender_); !s) {
+      LOG(WARNING) << "[migrate] Batch sender thread operation failed: " << s.Msg();
+    }
+  }
+}
+
+void BatchSender::sendLoop() {
+  std::unique_lock<std::mutex> lock(mu_);
+  while (true) {
+    cv_.wait(lock, [this] { return stop_ || !queue_.empty() || inflight_ > 0; });
+    if (stop_) return;
+
+    Status s;
+    bool rejected = false;
+    if (!queue_.empty() && inflight_ < max_inflight_) {
+      auto write_batch = std::move(queue_.front());
+      queue_.pop_front();
+      inflight_++;
+      lock.unlock();
+
+      rateLimit(write_batch.GetDataSize());
+      s = sendApplyBatchCmd(dst_fd_, write_batch);
+      if (s.IsOK()) {
+        sent_bytes_ += write_batch.GetDataSize();
+        sent_batches_num_++;
+      } else {
+        s = s.Prefixed("failed to send APPLYBATCH command");
+      }
+      lock.lock();
+    } else {
+      // the window is full or there's nothing else to send, so wait for the oldest reply
+      lock.unlock();
+      s = readApplyBatchReply(&rejected);
+      lock.lock();
+      if (s.IsOK()) {
+        inflight_--;
+      } else {
+        s = s.Prefixed("failed to check the response of APPLYBATCH command");
+      }
+    }
+
+    if (!s.IsOK()) {
+      // The replies of the other batches in flight mustn't be left on the connection, or the next command on it
+      // would read one of them. They're drained before the error is reported.
+      auto outstanding = rejected ? inflight_ - 1 : inflight_;
+      queue_.clear();
+      lock.unlock();
+      if (!rejected || !drainReplies(outstanding)) {
+        // the stream is broken in the middle of a batch or a reply, so the connection is shut down
+        // instead. The destination drops the import on the link error, and the later commands fail.
+        shutdown(dst_fd_, SHUT_RDWR);
+      }
+      lock.lock();
+      error_ = std::move(s);
+      inflight_ = 0;
+      cv_.notify_all();
+      return;
+    }
+    cv_.notify_all();
+  }
+}
+
+void BatchSender::rateLimit(size_t bytes) {
+  if (bytes_per_sec_ == 0) {
+    return;
+  }
+
+  auto single_burst = rate_limiter_->GetSingleBurstBytes();
+  auto left = static_cast<int64_t>(bytes);
+  while (left > 0) {
+    auto request_size = std::min(left, single_burst);
+    rate_limiter_->Request(request_size, rocksdb::Env::IOPriority::IO_HIGH, nullptr);
+    left -= request_size;
+  }
+}
+
 Status BatchSender::sendApplyBatchCmd(int fd, const rocksdb::WriteBatch &write_batch) {
   if (fd <= 0) {
     return {Status::NotOK, "invalid fd"};
   }
 
-  GET_OR_RET(util::SockSend(fd, redis::ArrayOfBulkStrings({"APPLYBATCH", write_batch.Data()})));
+  if (compression_ != StreamCompression::kNone) {
+    auto frame = GET_OR_RET(stats_->CompressStreamFrame(compression_, write_batch.Data()));
+    return util::SockSend(fd, redis::ArrayOfBulkStrings({"APPLYBATCH", frame}));
+  }
+  return util::SockSend(fd, redis::ArrayOfBulkStrings({"APPLYBATCH", write_batch.Data()}));
+}
+
+Status BatchSender::readApplyBatchReply(bool *rejected) {
+  // the replies of several batches may be read at once, so the rest is kept for the next call
+  int timeouts = 0;
+  while (true) {
+    UniqueEvbufReadln line(replies_.get(), EVBUFFER_EOL_CRLF_STRICT);
+    if (line) {
+      if (line.length > 0 && line[0] == '-') {
+        *rejected = true;
+        return {Status::NotOK, std::string(line.get(), line.length)};
+      }
+      return Status::OK();
+    }
 
-  std::string line = GET_OR_RET(util::SockReadLine(fd));
+    auto n = evbuffer_read(replies_.get(), dst_fd_, -1);
+    if (n > 0) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && ++timeouts < kMaxReadTimeouts && !stop_) continue;
+    if (n < 0 && errno == EINTR) continue;
+    return n == 0 ? Status{Status::NotOK, "the connection is closed"} : Status::FromErrno("read response err");
+  }
+}
 
-  if (line.compare(0, 1, "-") == 0) {
-    return {Status::NotOK, line};
+bool BatchSender::drainReplies(size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    bool rejected = false;
+    if (auto s = readApplyBatchReply(&rejected); !s.IsOK() && !rejected) return false;
   }
+  return true;
+}
 
-  return Status::OK();
+void BatchSender::SetMaxInflight(size_t max_inflight) {
+  std::lock_guard<std::mutex> guard(mu_);
+  max_inflight_ = std::max<size_t>(max_inflight, 1);
+  cv_.notify_all();
 }
 
 void BatchSender::SetBytesPerSecond(size_t bytes_per_sec) {
@@ -23,29 +23,60 @@
 #include <rocksdb/rate_limiter.h>
 #include <rocksdb/write_batch.h>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "compression_util.h"
+#include "event_util.h"
+#include "stats/stats.h"
 #include "status.h"
 
+// BatchSender sends the migration batches by APPLYBATCH without waiting for each reply. The batches
+// are handed over to a sender thread, so the caller keeps iterating the data while the previous
+// batches are on the wire. At most max_inflight batches are sent but not yet acknowledged, and as
+// many may wait to be sent, beyond which Send() blocks. An error is reported by the next Send() or
+// Flush(), and the later batches are dropped. The connection is left with no unread replies after an error,
+// or is shut down if that's impossible.
 class BatchSender {
  public:
   BatchSender() = default;
-  BatchSender(int fd, size_t max_bytes, size_t bytes_per_sec)
+  BatchSender(int fd, size_t max_bytes, size_t bytes_per_sec, size_t max_inflight = 1)
       : dst_fd_(fd),
         max_bytes_(max_bytes),
+        max_inflight_(std::max<size_t>(max_inflight, 1)),
         bytes_per_sec_(bytes_per_sec),
         rate_limiter_(std::unique_ptr<rocksdb::RateLimiter>(
             rocksdb::NewGenericRateLimiter(static_cast<int64_t>(bytes_per_sec_)))) {}
 
-  ~BatchSender() = default;
+  BatchSender(const BatchSender &) = delete;
+  BatchSender &operator=(const BatchSender &) = delete;
+
+  ~BatchSender();
 
   Status Put(rocksdb::ColumnFamilyHandle *cf, const rocksdb::Slice &key, const rocksdb::Slice &value);
   Status Delete(rocksdb::ColumnFamilyHandle *cf, const rocksdb::Slice &key);
   Status PutLogData(const rocksdb::Slice &blob);
   void SetPrefixLogData(const std::string &prefix_logdata);
+  // Queues the pending entries to be sent
   Status Send();
+  // Sends the pending entries and waits until all the batches are acknowledged
+  Status Flush();
 
   void SetMaxBytes(size_t max_bytes) {
     if (max_bytes_ != max_bytes) max_bytes_ = max_bytes;
   }
+  void SetMaxInflight(size_t max_inflight);
+  // The batches are sent in compressed frames, it must be set before sending any batch
+  void SetCompression(StreamCompression compression, Stats *stats) {
+    compression_ = compression;
+    stats_ = stats;
+  }
   bool IsFull() const { return write_batch_.GetDataSize() >= max_bytes_; }
   uint64_t GetSentBytes() const { return sent_bytes_; }
   uint32_t GetSentBatchesNum() const { return sent_batches_num_; }
@@ -54,18 +85,39 @@ class BatchSender {
   double GetRate(uint64_t since) const;
 
  private:
-  static Status sendApplyBatchCmd(int fd, const rocksdb::WriteBatch &write_batch);
+  // the reply of a window of batches may take longer than the receive timeout of the socket
+  static constexpr int kMaxReadTimeouts = 30;
+
+  void sendLoop();
+  void rateLimit(size_t bytes);
+  Status sendApplyBatchCmd(int fd, const rocksdb::WriteBatch &write_batch);
+  // rejected is set if the destination replied an error, so the connection is still in sync
+  Status readApplyBatchReply(bool *rejected);
+  // Reads and discards n replies, returns false if the connection is broken
+  bool drainReplies(size_t n);
 
   rocksdb::WriteBatch write_batch_{};
   std::string prefix_logdata_{};
-  uint64_t sent_bytes_ = 0;
-  uint32_t sent_batches_num_ = 0;
+  std::atomic<uint64_t> sent_bytes_ = 0;
+  std::atomic<uint32_t> sent_batches_num_ = 0;
   uint32_t entries_num_ = 0;
   uint32_t pending_entries_ = 0;
 
   int dst_fd_;
   size_t max_bytes_;
+  StreamCompression compression_ = StreamCompression::kNone;
+  Stats *stats_ = nullptr;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<rocksdb::WriteBatch> queue_;  // GUARDED_BY(mu_)
+  size_t max_inflight_ = 1;                // GUARDED_BY(mu_)
+  size_t inflight_ = 0;                    // GUARDED_BY(mu_)
+  Status error_;                           // GUARDED_BY(mu_)
+  std::atomic<bool> stop_ = false;
+  std::thread sender_;
+  UniqueEvbuf replies_;  // only used by the sender thread
 
-  size_t bytes_per_sec_ = 0;  // 0 means no limit
+  std::atomic<size_t> bytes_per_sec_ = 0;  // 0 means no limit
   std::unique_ptr<rocksdb::RateLimiter> rate_limiter_;
 };
@@ -37,6 +37,7 @@
 #include "event_util.h"
 #include "fmt/format.h"
 #include "io_util.h"
+#include "parse_util.h"
 #include "rocksdb_crc32c.h"
 #include "scope_exit.h"
 #include "server/redis_reply.h"
@@ -68,6 +69,7 @@ Status FeedSlaveThread::Start() {
       return;
     }
     this->loop();
+    srv_->RemoveReplicaAck(this);
   });
 
   if (s) {
@@ -91,7 +93,9 @@ void FeedSlaveThread::Join() {
 }
 
 void FeedSlaveThread::checkLivenessIfNeed() {
-  if (++interval_ % 1000) return;
+  auto now_ms = util::GetTimeStampMS();
+  if (now_ms - last_ping_ms_ < kPingIntervalMs) return;
+  last_ping_ms_ = now_ms;
   const auto ping_command = redis::BulkString("ping");
   auto s = util::SockSend(conn_->GetFD(), ping_command, conn_->GetBufferEvent());
   if (!s.IsOK()) {
@@ -100,36 +104,110 @@ void FeedSlaveThread::checkLivenessIfNeed() {
   }
 }
 
+Status FeedSlaveThread::processAcksIfNeed() {
+  if (!conn_->IsReplAckEnabled()) return Status::OK();
+
+  // the acks are read at intervals, unless some clients are waiting for them
+  bool has_waiters = srv_->HasReplAckWaiters();
+  auto now_ms = util::GetTimeStampMS();
+  if (!has_waiters && now_ms - last_ack_read_ms_ < kAckReadIntervalMs) return Status::OK();
+  last_ack_read_ms_ = now_ms;
+
+  // ask the replica to acknowledge what it has been sent right away, instead of waiting for its periodic ack
+  if (has_waiters && sent_seq_ > std::max(getack_seq_, acked_seq_)) {
+    GET_OR_RET(util::SockSend(conn_->GetFD(), redis::BulkString("getack"), conn_->GetBufferEvent()));
+    getack_seq_ = sent_seq_;
+  }
+
+  if (GET_OR_RET(util::SockReadAvailable(conn_->GetFD(), ack_buf_.get(), conn_->GetBufferEvent())) == 0) {
+    return Status::OK();
+  }
+  GET_OR_RET(ack_req_.Tokenize(ack_buf_.get()));
+
+  // the replica only sends REPLCONF ACK <seq>
+  auto acked_seq = acked_seq_;
+  for (const auto &tokens : *ack_req_.GetCommands()) {
+    if (tokens.size() != 3 || !util::EqualICase(tokens[0], "replconf") || !util::EqualICase(tokens[1], "ack")) {
+      return {Status::NotOK, "unexpected command from the replica: " + tokens[0]};
+    }
+    acked_seq = std::max(acked_seq, GET_OR_RET(ParseInt<uint64_t>(tokens[2], 10)));
+  }
+  ack_req_.GetCommands()->clear();
+
+  if (acked_seq > acked_seq_) {
+    acked_seq_ = acked_seq;
+    srv_->UpdateReplicaAck(this, acked_seq);
+  }
+  return Status::OK();
+}
+
+std::shared_ptr<const ReplWALBatch> FeedSlaveThread::readBatch(rocksdb::SequenceNumber seq) {
+  if (auto batch = srv_->GetReplWALReader()->Get(seq)) {
+    // caught up with the shared reader, the own iterator is no longer needed
+    iter_ = nullptr;
+    return batch;
+  }
+
+  if (iter_ && iter_->Valid() && iter_next_seq_ == seq) {
+    iter_->Next();
+  } else {
+    iter_ = nullptr;
+  }
+  if (!iter_ || !iter_->Valid()) {
+    if (iter_) LOG(INFO) << "WAL was rotated, would reopen again";
+    if (!srv_->storage->GetWALIter(seq, &iter_).IsOK()) {
+      iter_ = nullptr;
+      return nullptr;
+    }
+  }
+
+  auto batch = iter_->GetBatch();
+  auto count = batch.writeBatchPtr->Count();
+  iter_next_seq_ = batch.sequence + count;
+  return std::make_shared<const ReplWALBatch>(ReplWALBatch{batch.sequence, count, batch.writeBatchPtr->Data()});
+}
+
 void FeedSlaveThread::loop() {
   // is_first_repl_batch was used to fix that replication may be stuck in a dead loop
   // when some seqs might be lost in the middle of the WAL log, so forced to replicate
   // first batch here to work around this issue instead of waiting for enough batch size.
   bool is_first_repl_batch = true;
-  uint32_t yield_microseconds = 2 * 1000;
   std::string batches_bulk;
   size_t updates_in_batches = 0;
+  last_ping_ms_ = util::GetTimeStampMS();
   while (!IsStopped()) {
     auto curr_seq = next_repl_seq_.load();
 
-    if (!iter_ || !iter_->Valid()) {
-      if (iter_) LOG(INFO) << "WAL was rotated, would reopen again";
-      if (!srv_->storage->WALHasNewData(curr_seq) || !srv_->storage->GetWALIter(curr_seq, &iter_).IsOK()) {
-        iter_ = nullptr;
-        usleep(yield_microseconds);
-        checkLivenessIfNeed();
-        continue;
-      }
+    if (auto s = processAcksIfNeed(); !s.IsOK()) {
+      LOG(ERROR) << "Failed to process the acks of slave[" << conn_->GetAddr() << "]: " << s.Msg()
+                 << ", would stop the thread";
+      Stop();
+      return;
     }
-    // iter_ would be always valid here
-    auto batch = iter_->GetBatch();
-    if (batch.sequence != curr_seq) {
+
+    // the writers wake us up as soon as the WAL grows, the timeout is only for checking the liveness,
+    // and polling the acks while there are clients waiting for them
+    auto timeout = srv_->HasReplAckWaiters() ? kAckWaitTimeout : kWALWaitTimeout;
+    if (!srv_->storage->WaitForWALData(curr_seq, timeout)) {
+      checkLivenessIfNeed();
+      continue;
+    }
+
+    auto batch = readBatch(curr_seq);
+    if (!batch) {
+      // the WAL may be rotated in the middle, try to reopen it later
+      std::this_thread::sleep_for(kWALWaitTimeout);
+      checkLivenessIfNeed();
+      continue;
+    }
+    if (batch->sequence != curr_seq) {
       LOG(ERROR) << "Fatal error encountered, WAL iterator is discrete, some seq might be lost"
-                 << ", sequence " << curr_seq << " expected, but got " << batch.sequence;
+                 << ", sequence " << curr_seq << " expected, but got " << batch->sequence;
       Stop();
       return;
     }
-    updates_in_batches += batch.writeBatchPtr->Count();
-    batches_bulk += redis::BulkString(batch.writeBatchPtr->Data());
+    updates_in_batches += batch->count;
+    batches_bulk += redis::BulkString(batch->data);
     // 1. We must send the first replication batch, as said above.
     // 2. To avoid frequently calling 'write' system call to send replication stream,
     //    we pack multiple batches into one big bulk if possible, and only send once.
@@ -140,9 +218,17 @@ void FeedSlaveThread::loop() {
     //    batches strategy, we still send batches if current batch sequence is less
     //    kMaxDelayUpdates than latest sequence.
     if (is_first_repl_batch || batches_bulk.size() >= kMaxDelayBytes || updates_in_batches >= kMaxDelayUpdates ||
-        srv_->storage->LatestSeqNumber() - batch.sequence <= kMaxDelayUpdates) {
-      // Send entire bulk which contain multiple batches
-      auto s = util::SockSend(conn_->GetFD(), batches_bulk, conn_->GetBufferEvent());
+        srv_->storage->LatestSeqNumber() - batch->sequence <= kMaxDelayUpdates) {
+      // Send entire bulk which contain multiple batches, or a bulk of their compressed frame
+      // if the replica asks for compression
+      Status s;
+      if (auto compression = conn_->GetStreamCompression(); compression != StreamCompression::kNone) {
+        auto frame = srv_->stats.CompressStreamFrame(compression, batches_bulk);
+        s = frame ? util::SockSend(conn_->GetFD(), redis::BulkString(*frame), conn_->GetBufferEvent())
+                  : std::move(frame).ToStatus();
+      } else {
+        s = util::SockSend(conn_->GetFD(), batches_bulk, conn_->GetBufferEvent());
+      }
       if (!s.IsOK()) {
         LOG(ERROR) << "Write error while sending batch to slave: " << s.Msg() << ". batches: 0x"
                    << util::StringToHex(batches_bulk);
@@ -150,18 +236,74 @@ void FeedSlaveThread::loop() {
         return;
       }
       is_first_repl_batch = false;
+      sent_seq_ = batch->sequence + batch->count - 1;
       batches_bulk.clear();
       if (batches_bulk.capacity() > kMaxDelayBytes * 2) batches_bulk.shrink_to_fit();
       updates_in_batches = 0;
+      last_ping_ms_ = util::GetTimeStampMS();
     }
-    curr_seq = batch.sequence + batch.writeBatchPtr->Count();
-    next_repl_seq_.store(curr_seq);
-    while (!IsStopped() && !srv_->storage->WALHasNewData(curr_seq)) {
-      usleep(yield_microseconds);
-      checkLivenessIfNeed();
+    next_repl_seq_.store(batch->sequence + batch->count);
+  }
+}
+
+std::shared_ptr<const ReplWALBatch> SharedWALReader::Get(rocksdb::SequenceNumber seq) {
+  std::lock_guard<std::mutex> lock(mu_);
+
+  // the replicas ahead of the cached range are the ones following the tail,
+  // so the cache is moved to them and the lagging ones read the WAL on their own
+  if (batches_.empty() || seq > next_seq_) reset(seq);
+
+  if (seq == next_seq_ && !readNext()) return nullptr;
+  if (seq < batches_.front()->sequence) return nullptr;
+
+  auto iter = std::lower_bound(
+      batches_.begin(), batches_.end(), seq,
+      [](const std::shared_ptr<const ReplWALBatch> &batch, rocksdb::SequenceNumber s) { return batch->sequence < s; });
+  if (iter == batches_.end() || (*iter)->sequence != seq) return nullptr;
+  return *iter;
+}
+
+void SharedWALReader::Reset() {
+  std::lock_guard<std::mutex> lock(mu_);
+  reset(0);
+}
+
+void SharedWALReader::reset(rocksdb::SequenceNumber seq) {
+  iter_ = nullptr;
+  batches_.clear();
+  cached_bytes_ = 0;
+  next_seq_ = seq;
+}
+
+bool SharedWALReader::readNext() {
+  if (!storage_->WALHasNewData(next_seq_)) return false;
+
+  if (iter_ && iter_->Valid()) iter_->Next();
+  if (!iter_ || !iter_->Valid()) {
+    if (!storage_->GetWALIter(next_seq_, &iter_).IsOK()) {
+      iter_ = nullptr;
+      return false;
     }
-    iter_->Next();
   }
+
+  auto batch = iter_->GetBatch();
+  if (batch.sequence != next_seq_) {
+    // let the feeder read it with its own iterator and report the discrete sequences
+    reset(next_seq_);
+    return false;
+  }
+
+  auto count = batch.writeBatchPtr->Count();
+  auto cached = std::make_shared<const ReplWALBatch>(ReplWALBatch{batch.sequence, count, batch.writeBatchPtr->Data()});
+  cached_bytes_ += cached->data.size();
+  batches_.emplace_back(std::move(cached));
+  next_seq_ += count;
+
+  while (cached_bytes_ > kMaxCachedBytes && batches_.size() > 1) {
+    cached_bytes_ -= batches_.front()->data.size();
+    batches_.pop_front();
+  }
+  return true;
 }
 
 void SendString(bufferevent *bev, const std::string &data) {
@@ -457,6 +599,16 @@ ReplicationThread::CBState ReplicationThread::replConfWriteCB(bufferevent *bev)
     data_to_send.emplace_back("ip-address");
     data_to_send.emplace_back(config->replica_announce_ip);
   }
+  repl_compression_ = next_try_without_compression_ ? StreamCompression::kNone : config->replication_compression;
+  if (repl_compression_ != StreamCompression::kNone) {
+    data_to_send.emplace_back("compression");
+    data_to_send.emplace_back(util::StreamCompressionName(repl_compression_));
+  }
+  repl_ack_ = !next_try_without_ack_;
+  if (repl_ack_) {
+    data_to_send.emplace_back("capa");
+    data_to_send.emplace_back("ack");
+  }
   SendString(bev, redis::ArrayOfBulkStrings(data_to_send));
   repl_state_.store(kReplReplConf, std::memory_order_relaxed);
   LOG(INFO) << "[replication] replconf request was sent, waiting for response";
@@ -468,7 +620,20 @@ ReplicationThread::CBState ReplicationThread::replConfReadCB(bufferevent *bev) {
   UniqueEvbufReadln line(input, EVBUFFER_EOL_CRLF_STRICT);
   if (!line) return CBState::AGAIN;
 
-  // on unknown option: first try without announce ip, if it fails again - do nothing (to prevent infinite loop)
+  // on unknown option: first try without compression, then without the acks, then without announce ip,
+  // if it fails again - do nothing (to prevent infinite loop)
+  if (isUnknownOption(line.View()) && repl_compression_ != StreamCompression::kNone) {
+    next_try_without_compression_ = true;
+    LOG(WARNING) << "The old version master, can't handle compression, "
+                 << "try without it again";
+    return CBState::PREV;
+  }
+  if (isUnknownOption(line.View()) && repl_ack_) {
+    next_try_without_ack_ = true;
+    LOG(WARNING) << "The old version master, can't handle the acks, "
+                 << "try without them again";
+    return CBState::PREV;
+  }
   if (isUnknownOption(line.View()) && !next_try_without_announce_ip_address_) {
     next_try_without_announce_ip_address_ = true;
     LOG(WARNING) << "The old version master, can't handle ip-address, "
@@ -481,6 +646,8 @@ ReplicationThread::CBState ReplicationThread::replConfReadCB(bufferevent *bev) {
     return CBState::RESTART;
   }
   if (!ResponseLineIsOK(line.View())) {
+    repl_compression_ = StreamCompression::kNone;
+    repl_ack_ = false;
     LOG(WARNING) << "[replication] Failed to replconf: " << line.get() + 1;
     //  backward compatible with old version that doesn't support replconf cmd
     return CBState::NEXT;
@@ -561,12 +728,16 @@ ReplicationThread::CBState ReplicationThread::incrementBatchLoopCB(bufferevent *
   char *bulk_data = nullptr;
   repl_state_.store(kReplConnected, std::memory_order_relaxed);
   auto input = bufferevent_get_input(bev);
+  bool ack_requested = false;
   while (true) {
     switch (incr_state_) {
       case Incr_batch_size: {
         // Read bulk length
         UniqueEvbufReadln line(input, EVBUFFER_EOL_CRLF_STRICT);
-        if (!line) return CBState::AGAIN;
+        if (!line) {
+          sendReplAckIfNeed(bev, ack_requested);
+          return CBState::AGAIN;
+        }
         incr_bulk_len_ = line.length > 0 ? std::strtoull(line.get() + 1, nullptr, 10) : 0;
         if (incr_bulk_len_ == 0) {
           LOG(ERROR) << "[replication] Invalid increment data size";
@@ -581,25 +752,21 @@ ReplicationThread::CBState ReplicationThread::incrementBatchLoopCB(bufferevent *
           bulk_data = reinterpret_cast<char *>(evbuffer_pullup(input, static_cast<ssize_t>(incr_bulk_len_ + 2)));
           std::string bulk_string = std::string(bulk_data, incr_bulk_len_);
           // master would send the ping heartbeat packet to check whether the slave was alive or not,
-          // don't write ping to db here.
-          if (bulk_string != "ping") {
-            auto s = storage_->ReplicaApplyWriteBatch(std::string(bulk_data, incr_bulk_len_));
+          // and the getack packet to ask for the ack of the applied sequence, don't write them to db here.
+          if (bulk_string == "getack") {
+            ack_requested = true;
+          } else if (bulk_string != "ping") {
+            // the compressed bulk is a frame of several bulks of batches
+            auto s = repl_compression_ != StreamCompression::kNone ? applyCompressedWriteBatches(bulk_string)
+                                                                   : applyWriteBatch(bulk_string);
             if (!s.IsOK()) {
-              LOG(ERROR) << "[replication] CRITICAL - Failed to write batch to local, " << s.Msg() << ". batch: 0x"
-                         << util::StringToHex(bulk_string);
-              return CBState::RESTART;
-            }
-
-            s = parseWriteBatch(bulk_string);
-            if (!s.IsOK()) {
-              LOG(ERROR) << "[replication] CRITICAL - failed to parse write batch 0x" << util::StringToHex(bulk_string)
-                         << ": " << s.Msg();
               return CBState::RESTART;
             }
           }
           evbuffer_drain(input, incr_bulk_len_ + 2);
           incr_state_ = Incr_batch_size;
         } else {
+          sendReplAckIfNeed(bev, ack_requested);
           return CBState::AGAIN;
         }
         break;
@@ -731,6 +898,8 @@ ReplicationThread::CBState ReplicationThread::fullSyncReadCB(bufferevent *bev) {
       }
       LOG(INFO) << "[replication] Succeeded restoring the backup, fullsync was finish";
       post_fullsync_cb_();
+      // the keys cached by the tracking clients may be replaced by the restored DB
+      SendInvalidations(srv_->tracking.InvalidateAll());
 
       // It needs to reload namespaces from DB after the full sync is done,
       // or namespaces are not visible in the replica.
@@ -782,6 +951,7 @@ Status ReplicationThread::parallelFetchFile(const std::string &dir,
           if (!s.IsOK()) {
             return s.Prefixed("send the auth command err");
           }
+          auto compression = GET_OR_RET(this->sendReplConfCompression(sock_fd, ssl));
           std::vector<std::string> fetch_files;
           std::vector<uint32_t> crcs;
           for (auto f_idx = tid; f_idx < files.size(); f_idx += concurrency) {
@@ -818,12 +988,12 @@ Status ReplicationThread::parallelFetchFile(const std::string &dir,
           // command, so we need to fetch all files by multiple command interactions.
           if (srv_->GetConfig()->master_use_repl_port) {
             for (unsigned i = 0; i < fetch_files.size(); i++) {
-              s = this->fetchFiles(sock_fd, dir, {fetch_files[i]}, {crcs[i]}, fn, ssl);
+              s = this->fetchFiles(sock_fd, dir, {fetch_files[i]}, {crcs[i]}, fn, ssl, compression);
               if (!s.IsOK()) break;
             }
           } else {
             if (!fetch_files.empty()) {
-              s = this->fetchFiles(sock_fd, dir, fetch_files, crcs, fn, ssl);
+              s = this->fetchFiles(sock_fd, dir, fetch_files, crcs, fn, ssl, compression);
             }
           }
           return s;
@@ -861,8 +1031,28 @@ Status ReplicationThread::sendAuth(int sock_fd, ssl_st *ssl) {
   return Status::OK();
 }
 
+StatusOr<StreamCompression> ReplicationThread::sendReplConfCompression(int sock_fd, ssl_st *ssl) {
+  // the compression of the file transfer is negotiated per connection as the replication stream
+  if (repl_compression_ == StreamCompression::kNone) return StreamCompression::kNone;
+
+  UniqueEvbuf evbuf;
+  const auto replconf_command =
+      redis::ArrayOfBulkStrings({"replconf", "compression", util::StreamCompressionName(repl_compression_)});
+  auto s = util::SockSend(sock_fd, replconf_command, ssl);
+  if (!s.IsOK()) return s.Prefixed("send replconf command err");
+  while (true) {
+    if (auto s = util::EvbufferRead(evbuf.get(), sock_fd, -1, ssl); !s) {
+      return std::move(s).Prefixed("read replconf response err");
+    }
+    UniqueEvbufReadln line(evbuf.get(), EVBUFFER_EOL_CRLF_STRICT);
+    if (!line) continue;
+    return ResponseLineIsOK(line.View()) ? repl_compression_ : StreamCompression::kNone;
+  }
+}
+
 Status ReplicationThread::fetchFile(int sock_fd, evbuffer *evbuf, const std::string &dir, const std::string &file,
-                                    uint32_t crc, const FetchFileCallback &fn, ssl_st *ssl) {
+                                    uint32_t crc, const FetchFileCallback &fn, ssl_st *ssl,
+                                    StreamCompression compression) {
   size_t file_size = 0;
 
   // Read file size line
@@ -890,6 +1080,34 @@ Status ReplicationThread::fetchFile(int sock_fd, evbuffer *evbuf, const std::str
 
   size_t remain = file_size;
   uint32_t tmp_crc = 0;
+  // the compressed file is sent in frames, each of them follows the line of its length
+  while (compression != StreamCompression::kNone && remain != 0) {
+    UniqueEvbufReadln line(evbuf, EVBUFFER_EOL_CRLF_STRICT);
+    if (!line) {
+      if (auto s = util::EvbufferRead(evbuf, sock_fd, -1, ssl); !s) {
+        return std::move(s).Prefixed("read frame size");
+      }
+      continue;
+    }
+    size_t frame_size = line.length > 0 ? std::strtoull(line.get(), nullptr, 10) : 0;
+    while (evbuffer_get_length(evbuf) < frame_size) {
+      if (auto s = util::EvbufferRead(evbuf, sock_fd, -1, ssl); !s) {
+        return std::move(s).Prefixed("read sst file frame");
+      }
+    }
+    std::string frame(frame_size, 0);
+    if (evbuffer_remove(evbuf, frame.data(), frame_size) != static_cast<int>(frame_size)) {
+      return {Status::NotOK, "read sst file frame error"};
+    }
+    auto data = GET_OR_RET(srv_->stats.DecompressStreamFrame(frame).Prefixed("decompress sst file frame"));
+    if (data.size() > remain) {
+      return {Status::NotOK, "the decompressed data exceeds the file size"};
+    }
+    tmp_file->Append(data);
+    tmp_crc = rocksdb::crc32c::Extend(tmp_crc, data.data(), data.size());
+    remain -= data.size();
+  }
+
   char data[16 * 1024];
   while (remain != 0) {
     if (evbuffer_get_length(evbuf) > 0) {
@@ -921,7 +1139,8 @@ Status ReplicationThread::fetchFile(int sock_fd, evbuffer *evbuf, const std::str
 }
 
 Status ReplicationThread::fetchFiles(int sock_fd, const std::string &dir, const std::vector<std::string> &files,
-                                     const std::vector<uint32_t> &crcs, const FetchFileCallback &fn, ssl_st *ssl) {
+                                     const std::vector<uint32_t> &crcs, const FetchFileCallback &fn, ssl_st *ssl,
+                                     StreamCompression compression) {
   std::string files_str;
   for (const auto &file : files) {
     files_str += file;
@@ -936,7 +1155,7 @@ Status ReplicationThread::fetchFiles(int sock_fd, const std::string &dir, const
   UniqueEvbuf evbuf;
   for (unsigned i = 0; i < files.size(); i++) {
     DLOG(INFO) << "[fetch] Start to fetch file " << files[i];
-    s = fetchFile(sock_fd, evbuf.get(), dir, files[i], crcs[i], fn, ssl);
+    s = fetchFile(sock_fd, evbuf.get(), dir, files[i], crcs[i], fn, ssl, compression);
     if (!s.IsOK()) {
       s = Status(Status::NotOK, "fetch file err: " + s.Msg());
       LOG(WARNING) << "[fetch] Fail to fetch file " << files[i] << ", err: " << s.Msg();
@@ -963,6 +1182,57 @@ void ReplicationThread::TimerCB(int, int16_t) {
   }
 }
 
+void ReplicationThread::sendReplAckIfNeed(bufferevent *bev, bool requested) {
+  if (!repl_ack_) return;
+
+  auto now_ms = util::GetTimeStampMS();
+  if (!requested && now_ms - last_ack_ms_ < kReplAckIntervalMs) return;
+  last_ack_ms_ = now_ms;
+  SendString(bev, redis::ArrayOfBulkStrings({"replconf", "ack", std::to_string(storage_->LatestSeqNumber())}));
+}
+
+Status ReplicationThread::applyWriteBatch(const std::string &batch_string) {
+  auto s = storage_->ReplicaApplyWriteBatch(std::string(batch_string));
+  if (!s.IsOK()) {
+    LOG(ERROR) << "[replication] CRITICAL - Failed to write batch to local, " << s.Msg() << ". batch: 0x"
+               << util::StringToHex(batch_string);
+    return s;
+  }
+  if (!srv_->tracking.Empty()) srv_->InvalidateKeysFromBatch(batch_string);
+
+  s = parseWriteBatch(batch_string);
+  if (!s.IsOK()) {
+    LOG(ERROR) << "[replication] CRITICAL - failed to parse write batch 0x" << util::StringToHex(batch_string)
+               << ": " << s.Msg();
+    return s;
+  }
+  return Status::OK();
+}
+
+Status ReplicationThread::applyCompressedWriteBatches(std::string_view frame) {
+  auto bulks = srv_->stats.DecompressStreamFrame(frame);
+  if (!bulks) {
+    LOG(ERROR) << "[replication] CRITICAL - Failed to decompress the batches: " << bulks.Msg();
+    return std::move(bulks).ToStatus();
+  }
+
+  std::string_view rest = *bulks;
+  while (!rest.empty()) {
+    size_t len = 0;
+    auto line_end = rest.find(CRLF);
+    if (line_end != std::string_view::npos && rest[0] == '$') {
+      len = std::strtoull(std::string(rest.substr(1, line_end - 1)).c_str(), nullptr, 10);
+    }
+    if (len == 0 || rest.size() < line_end + 2 + len + 2) {
+      LOG(ERROR) << "[replication] CRITICAL - Invalid bulk in the decompressed batches";
+      return {Status::NotOK, "invalid bulk in the decompressed batches"};
+    }
+    GET_OR_RET(applyWriteBatch(std::string(rest.substr(line_end + 2, len))));
+    rest.remove_prefix(line_end + 2 + len + 2);
+  }
+  return Status::OK();
+}
+
 Status ReplicationThread::parseWriteBatch(const std::string &batch_string) {
   rocksdb::WriteBatch write_batch(batch_string);
   WriteBatchHandler write_batch_handler;
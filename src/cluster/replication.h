@@ -23,14 +23,17 @@
 #include <event2/bufferevent.h>
 
 #include <atomic>
+#include <chrono>
 #include <deque>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <tuple>
 #include <utility>
 #include <vector>
 
+#include "compression_util.h"
 #include "event_util.h"
 #include "io_util.h"
 #include "server/redis_connection.h"
@@ -60,10 +63,45 @@ enum WriteBatchType {
 
 using FetchFileCallback = std::function<void(const std::string &, uint32_t)>;
 
+// A write batch read from the WAL, shared between the replica feeders
+struct ReplWALBatch {
+  rocksdb::SequenceNumber sequence = 0;
+  size_t count = 0;
+  std::string data;
+};
+
+// The WAL reader shared by all the replica feeders. The batches following the tail of the WAL
+// are read once by one TransactionLogIterator and cached here, so the replicas keeping up with
+// the master all get them from the cache, and only the ones lagging behind the cached range
+// open a WAL iterator of their own.
+class SharedWALReader {
+ public:
+  explicit SharedWALReader(engine::Storage *storage) : storage_(storage) {}
+
+  // Get the batch starting at `seq`, or nullptr if it's neither cached nor at the tail of the WAL
+  std::shared_ptr<const ReplWALBatch> Get(rocksdb::SequenceNumber seq);
+  void Reset();
+
+ private:
+  static const size_t kMaxCachedBytes = 16 * 1024 * 1024;
+
+  engine::Storage *storage_ = nullptr;
+  std::mutex mu_;
+  // the iterator is always at the last cached batch
+  std::unique_ptr<rocksdb::TransactionLogIterator> iter_ = nullptr;
+  std::deque<std::shared_ptr<const ReplWALBatch>> batches_;
+  size_t cached_bytes_ = 0;
+  // the sequence of the batch following the cached ones
+  rocksdb::SequenceNumber next_seq_ = 0;
+
+  void reset(rocksdb::SequenceNumber seq);
+  bool readNext();
+};
+
 class FeedSlaveThread {
  public:
   explicit FeedSlaveThread(Server *srv, redis::Connection *conn, rocksdb::SequenceNumber next_repl_seq)
-      : srv_(srv), conn_(conn), next_repl_seq_(next_repl_seq) {}
+      : srv_(srv), conn_(conn), next_repl_seq_(next_repl_seq), ack_req_(srv) {}
   ~FeedSlaveThread() = default;
 
   Status Start();
@@ -77,19 +115,38 @@ class FeedSlaveThread {
   }
 
  private:
-  uint64_t interval_ = 0;
   std::atomic<bool> stop_ = false;
   Server *srv_ = nullptr;
   std::unique_ptr<redis::Connection> conn_ = nullptr;
   std::atomic<rocksdb::SequenceNumber> next_repl_seq_ = 0;
   std::thread t_;
+  // the own WAL iterator for reading the batches out of the range of the shared reader,
+  // it's at the last batch read from it
   std::unique_ptr<rocksdb::TransactionLogIterator> iter_ = nullptr;
+  rocksdb::SequenceNumber iter_next_seq_ = 0;
+  uint64_t last_ping_ms_ = 0;
+
+  // the acknowledgements of the applied sequence sent by the replica, see REPLCONF CAPA ACK
+  UniqueEvbuf ack_buf_;
+  redis::Request ack_req_;
+  uint64_t last_ack_read_ms_ = 0;
+  // the last sequence sent to the replica, and the one covered by the last GETACK
+  rocksdb::SequenceNumber sent_seq_ = 0;
+  rocksdb::SequenceNumber getack_seq_ = 0;
+  rocksdb::SequenceNumber acked_seq_ = 0;
 
   static const size_t kMaxDelayUpdates = 16;
   static const size_t kMaxDelayBytes = 16 * 1024;
+  static constexpr std::chrono::milliseconds kWALWaitTimeout{100};
+  // the interval of polling the acks while some clients are waiting for them in WAIT
+  static constexpr std::chrono::milliseconds kAckWaitTimeout{1};
+  static const uint64_t kPingIntervalMs = 2000;
+  static const uint64_t kAckReadIntervalMs = 100;
 
   void loop();
   void checkLivenessIfNeed();
+  Status processAcksIfNeed();
+  std::shared_ptr<const ReplWALBatch> readBatch(rocksdb::SequenceNumber seq);
 };
 
 class ReplicationThread : private EventCallbackBase<ReplicationThread> {
@@ -158,6 +215,14 @@ class ReplicationThread : private EventCallbackBase<ReplicationThread> {
   std::atomic<int64_t> last_io_time_secs_ = 0;
   bool next_try_old_psync_ = false;
   bool next_try_without_announce_ip_address_ = false;
+  bool next_try_without_compression_ = false;
+  bool next_try_without_ack_ = false;
+  // the compression of the replication stream, which is accepted by the master
+  StreamCompression repl_compression_ = StreamCompression::kNone;
+  // whether the master accepts the acknowledgements of the applied sequence
+  bool repl_ack_ = false;
+  uint64_t last_ack_ms_ = 0;
+  static const uint64_t kReplAckIntervalMs = 1000;
 
   std::function<void()> pre_fullsync_cb_;
   std::function<void()> post_fullsync_cb_;
@@ -199,15 +264,20 @@ class ReplicationThread : private EventCallbackBase<ReplicationThread> {
 
   // Synchronized-Blocking ops
   Status sendAuth(int sock_fd, ssl_st *ssl);
+  StatusOr<StreamCompression> sendReplConfCompression(int sock_fd, ssl_st *ssl);
   Status fetchFile(int sock_fd, evbuffer *evbuf, const std::string &dir, const std::string &file, uint32_t crc,
-                   const FetchFileCallback &fn, ssl_st *ssl);
+                   const FetchFileCallback &fn, ssl_st *ssl, StreamCompression compression);
   Status fetchFiles(int sock_fd, const std::string &dir, const std::vector<std::string> &files,
-                    const std::vector<uint32_t> &crcs, const FetchFileCallback &fn, ssl_st *ssl);
+                    const std::vector<uint32_t> &crcs, const FetchFileCallback &fn, ssl_st *ssl,
+                    StreamCompression compression);
   Status parallelFetchFile(const std::string &dir, const std::vector<std::pair<std::string, uint32_t>> &files);
   static bool isRestoringError(std::string_view err);
   static bool isWrongPsyncNum(std::string_view err);
   static bool isUnknownOption(std::string_view err);
 
+  void sendReplAckIfNeed(bufferevent *bev, bool requested);
+  Status applyWriteBatch(const std::string &batch_string);
+  Status applyCompressedWriteBatches(std::string_view frame);
   Status parseWriteBatch(const std::string &batch_string);
 };
 
@@ -20,6 +20,11 @@
 
 #include "slot_import.h"
 
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <map>
+
 SlotImport::SlotImport(Server *srv)
     : Database(srv->storage, kDefaultNamespace), srv_(srv), import_slot_range_(-1, -1), import_status_(kImportNone) {
   std::lock_guard<std::mutex> guard(mutex_);
@@ -46,6 +51,7 @@ Status SlotImport::Start(const SlotRange &slot_range) {
     return {Status::NotOK, fmt::format("clear keys of slot(s) error: {}", s.ToString())};
   }
 
+  removeSSTFiles();
   import_status_ = kImportStart;
   import_slot_range_ = slot_range;
   return Status::OK();
@@ -63,6 +69,7 @@ Status SlotImport::Success(const SlotRange &slot_range) {
     return {Status::NotOK, fmt::format("unable to set imported status: {}", slot_range.String())};
   }
 
+  removeSSTFiles();
   import_status_ = kImportSuccess;
   return Status::OK();
 }
@@ -81,6 +88,7 @@ Status SlotImport::Fail(const SlotRange &slot_range) {
     return {Status::NotOK, fmt::format("clear keys of slot(s) error: {}", s.ToString())};
   }
 
+  removeSSTFiles();
   import_status_ = kImportFailed;
   return Status::OK();
 }
@@ -108,6 +116,7 @@ Status SlotImport::StopForLinkError() {
     }
   }
 
+  removeSSTFiles();
   import_status_ = kImportFailed;
   return Status::OK();
 }
@@ -153,3 +162,89 @@ void SlotImport::GetImportInfo(std::string *info) {
 
   *info = fmt::format("importing_slot(s): {}\r\nimport_state: {}\r\n", import_slot_range_.String(), import_stat);
 }
+
+Status SlotImport::PrepareSST() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (import_status_ != kImportStart) {
+    return {Status::NotOK, "no slot is being imported"};
+  }
+
+  removeSSTFiles();
+  // No replica can be added from now on, so the ones counted here are all of them
+  srv_->storage->SetImportingSST(true);
+  if (srv_->GetSlavesNum() > 0) {
+    srv_->storage->SetImportingSST(false);
+    return {Status::NotOK, "can't ingest SST files with replicas"};
+  }
+
+  auto dir = srv_->GetConfig()->ImportSSTDir();
+  std::error_code ec;
+  if (!std::filesystem::create_directories(dir, ec)) {
+    srv_->storage->SetImportingSST(false);
+    return {Status::NotOK, fmt::format("failed to create the directory {}: {}", dir, ec.message())};
+  }
+  return Status::OK();
+}
+
+Status SlotImport::WriteSSTChunk(const std::string &name, uint64_t offset, const std::string &data) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  GET_OR_RET(checkSSTImportable());
+
+  // the files are named by the source node, so don't let the name escape the directory
+  auto valid_char = [](char c) { return std::isalnum(c) || c == '-' || c == '.'; };
+  bool valid_name = name.size() > 4 && name.compare(name.size() - 4, 4, ".sst") == 0 &&
+                    std::all_of(name.begin(), name.end(), valid_char);
+  if (!valid_name) {
+    return {Status::NotOK, fmt::format("invalid SST file name: {}", name)};
+  }
+
+  auto env = rocksdb::Env::Default();
+  auto path = srv_->GetConfig()->ImportSSTDir() + "/" + name;
+  uint64_t size = 0;
+  if (offset > 0 && (!env->GetFileSize(path, &size).ok() || size != offset)) {
+    return {Status::NotOK, fmt::format("the SST file {} has {} bytes, but got the offset {}", name, size, offset)};
+  }
+
+  std::unique_ptr<rocksdb::WritableFile> file;
+  auto s = offset == 0 ? env->NewWritableFile(path, &file, rocksdb::EnvOptions())
+                       : env->ReopenWritableFile(path, &file, rocksdb::EnvOptions());
+  if (s.ok()) s = file->Append(data);
+  if (s.ok()) s = file->Close();
+  if (!s.ok()) {
+    return {Status::NotOK, fmt::format("failed to write the SST file {}: {}", name, s.ToString())};
+  }
+  return Status::OK();
+}
+
+Status SlotImport::IngestSSTFiles(const std::vector<std::pair<ColumnFamilyID, std::string>> &files) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  GET_OR_RET(checkSSTImportable());
+
+  std::map<ColumnFamilyID, std::vector<std::string>> paths;
+  for (const auto &[cf_id, name] : files) {
+    paths[cf_id].emplace_back(srv_->GetConfig()->ImportSSTDir() + "/" + name);
+  }
+
+  auto s = srv_->storage->IngestSSTFiles(paths);
+  removeSSTFiles();
+  if (!s.ok()) {
+    return {Status::NotOK, fmt::format("failed to ingest SST files: {}", s.ToString())};
+  }
+  return Status::OK();
+}
+
+Status SlotImport::checkSSTImportable() {
+  if (import_status_ != kImportStart) {
+    return {Status::NotOK, "no slot is being imported"};
+  }
+  if (!srv_->storage->IsImportingSST()) {
+    return {Status::NotOK, "SST files aren't prepared to be imported"};
+  }
+  return Status::OK();
+}
+
+void SlotImport::removeSSTFiles() {
+  std::error_code ec;
+  std::filesystem::remove_all(srv_->GetConfig()->ImportSSTDir(), ec);
+  srv_->storage->SetImportingSST(false);
+}
@@ -24,6 +24,7 @@
 
 #include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "cluster_defs.h"
@@ -51,7 +52,17 @@ class SlotImport : public redis::Database {
   int GetStatus();
   void GetImportInfo(std::string *info);
 
+  // The snapshot of the importing slots may be sent as SST files in chunks, then ingested all at once.
+  // The ingested files aren't in the WAL, so PrepareSST fails if there are replicas and no replica can be
+  // added until the files are ingested or removed, and the replicas added later have to sync fully.
+  Status PrepareSST();
+  Status WriteSSTChunk(const std::string &name, uint64_t offset, const std::string &data);
+  Status IngestSSTFiles(const std::vector<std::pair<ColumnFamilyID, std::string>> &files);
+
  private:
+  Status checkSSTImportable();
+  void removeSSTFiles();
+
   Server *srv_ = nullptr;
   std::mutex mutex_;
   SlotRange import_slot_range_;
@@ -20,6 +20,10 @@
 
 #include "slot_migrate.h"
 
+#include <rocksdb/sst_file_writer.h>
+
+#include <filesystem>
+#include <iterator>
 #include <memory>
 #include <utility>
 
@@ -32,7 +36,10 @@
 #include "sync_migrate_context.h"
 #include "thread_util.h"
 #include "time_util.h"
+#include "types/redis_bitmap.h"
+#include "types/redis_list.h"
 #include "types/redis_stream_base.h"
+#include "types/redis_zset.h"
 
 constexpr std::string_view errFailedToSendCommands = "failed to send commands to restore a key";
 constexpr std::string_view errMigrationTaskCanceled = "key migration stopped due to a task cancellation";
@@ -51,7 +58,9 @@ SlotMigrator::SlotMigrator(Server *srv)
       max_pipeline_size_(srv->GetConfig()->pipeline_size),
       seq_gap_limit_(srv->GetConfig()->sequence_gap),
       migrate_batch_bytes_per_sec_(srv->GetConfig()->migrate_batch_rate_limit_mb * MiB),
-      migrate_batch_size_bytes_(srv->GetConfig()->migrate_batch_size_kb * KiB) {
+      migrate_batch_size_bytes_(srv->GetConfig()->migrate_batch_size_kb * KiB),
+      migrate_batch_window_(srv->GetConfig()->migrate_batch_window),
+      migrate_snapshot_streams_(srv->GetConfig()->migrate_snapshot_streams) {
   // Let metadata_cf_handle_ be nullptr, and get them in real time to avoid accessing invalid pointer,
   // because metadata_cf_handle_ and db_ will be destroyed if DB is reopened.
   // [Situation]:
@@ -271,22 +280,7 @@ Status SlotMigrator::startMigration() {
   wal_begin_seq_ = slot_snapshot_->GetSequenceNumber();
   last_send_time_ = 0;
 
-  // Connect to the destination node
-  auto result = util::SockConnect(dst_ip_, dst_port_);
-  if (!result.IsOK()) {
-    return {Status::NotOK, fmt::format("failed to connect to the destination node: {}", result.Msg())};
-  }
-
-  dst_fd_.Reset(*result);
-
-  // Auth first
-  std::string pass = srv_->GetConfig()->requirepass;
-  if (!pass.empty()) {
-    auto s = authOnDstNode(*dst_fd_, pass);
-    if (!s.IsOK()) {
-      return s.Prefixed("failed to authenticate on destination node");
-    }
-  }
+  GET_OR_RET(connectToDstNode(&dst_fd_, &dst_compression_));
 
   // Set destination node import status to START
   auto s = setImportStatusOnDstNode(*dst_fd_, kImportStart);
@@ -296,6 +290,14 @@ Status SlotMigrator::startMigration() {
 
   migration_type_ = srv_->GetConfig()->migrate_type;
 
+  // If the destination can't ingest SST files, we will fall back to the raw-key-value migration type.
+  if (migration_type_ == MigrationType::kRawSST) {
+    if (auto s = prepareSSTImportOnDstNode(*dst_fd_); !s.IsOK()) {
+      LOG(INFO) << "[migrate] SST files can't be imported, use raw key value for migration: " << s.Msg();
+      migration_type_ = MigrationType::kRawKeyValue;
+    }
+  }
+
   // If the APPLYBATCH command is not supported on the destination,
   // we will fall back to the redis-command migration type.
   if (migration_type_ == MigrationType::kRawKeyValue) {
@@ -317,6 +319,8 @@ Status SlotMigrator::sendSnapshot() {
     return sendSnapshotByCmd();
   } else if (migration_type_ == MigrationType::kRawKeyValue) {
     return sendSnapshotByRawKV();
+  } else if (migration_type_ == MigrationType::kRawSST) {
+    return sendSnapshotBySST();
   }
   return {Status::NotOK, std::string(errUnsupportedMigrationType)};
 }
@@ -324,7 +328,7 @@ Status SlotMigrator::sendSnapshot() {
 Status SlotMigrator::syncWAL() {
   if (migration_type_ == MigrationType::kRedisCommand) {
     return syncWALByCmd();
-  } else if (migration_type_ == MigrationType::kRawKeyValue) {
+  } else if (migration_type_ == MigrationType::kRawKeyValue || migration_type_ == MigrationType::kRawSST) {
     return syncWALByRawKV();
   }
   return {Status::NotOK, std::string(errUnsupportedMigrationType)};
@@ -471,6 +475,11 @@ void SlotMigrator::clean() {
     slot_snapshot_ = nullptr;
   }
 
+  std::error_code ec;
+  std::filesystem::remove_all(srv_->GetConfig()->MigrateSSTDir(), ec);
+  sst_rate_limiter_.reset();
+  sst_sent_bytes_ = 0;
+
   current_stage_ = SlotMigrationStage::kNone;
   current_pipeline_size_ = 0;
   wal_begin_seq_ = 0;
@@ -481,6 +490,31 @@ void SlotMigrator::clean() {
   SetStopMigrationFlag(false);
 }
 
+Status SlotMigrator::connectToDstNode(UniqueFD *fd, StreamCompression *compression) {
+  auto result = util::SockConnect(dst_ip_, dst_port_);
+  if (!result.IsOK()) {
+    return {Status::NotOK, fmt::format("failed to connect to the destination node: {}", result.Msg())};
+  }
+
+  fd->Reset(*result);
+
+  // Auth first
+  std::string pass = srv_->GetConfig()->requirepass;
+  if (!pass.empty()) {
+    auto s = authOnDstNode(**fd, pass);
+    if (!s.IsOK()) {
+      return s.Prefixed("failed to authenticate on destination node");
+    }
+  }
+
+  *compression = StreamCompression::kNone;
+  if (auto type = srv_->GetConfig()->migrate_batch_compression; type != StreamCompression::kNone) {
+    *compression = GET_OR_RET(setCompressionOnDstNode(**fd, type));
+  }
+
+  return Status::OK();
+}
+
 Status SlotMigrator::authOnDstNode(int sock_fd, const std::string &password) {
   std::string cmd = redis::ArrayOfBulkStrings({"auth", password});
   auto s = util::SockSend(sock_fd, cmd);
@@ -514,6 +548,23 @@ Status SlotMigrator::setImportStatusOnDstNode(int sock_fd, int status) {
   return Status::OK();
 }
 
+StatusOr<StreamCompression> SlotMigrator::setCompressionOnDstNode(int sock_fd, StreamCompression type) {
+  std::string cmd = redis::ArrayOfBulkStrings({"replconf", "compression", util::StreamCompressionName(type)});
+  auto s = util::SockSend(sock_fd, cmd);
+  if (!s.IsOK()) {
+    return s.Prefixed("failed to send replconf to the destination node");
+  }
+
+  // the destination which can't decompress the batches rejects the option
+  s = checkSingleResponse(sock_fd);
+  if (!s.IsOK()) {
+    LOG(INFO) << "[migrate] The destination node doesn't support compression, send the batches uncompressed: "
+              << s.Msg();
+    return StreamCompression::kNone;
+  }
+  return type;
+}
+
 StatusOr<bool> SlotMigrator::supportedApplyBatchCommandOnDstNode(int sock_fd) {
   std::string cmd = redis::ArrayOfBulkStrings({"command", "info", "applybatch"});
   auto s = util::SockSend(sock_fd, cmd);
@@ -541,6 +592,19 @@ StatusOr<bool> SlotMigrator::supportedApplyBatchCommandOnDstNode(int sock_fd) {
   return false;
 }
 
+// Sends an APPLYSST command and checks its response, which is either OK or an error
+static Status SendSSTCommand(int sock_fd, const std::vector<std::string> &args) {
+  GET_OR_RET(util::SockSend(sock_fd, redis::ArrayOfBulkStrings(args)));
+
+  std::string line = GET_OR_RET(util::SockReadLine(sock_fd));
+  if (line.compare(0, 1, "-") == 0) {
+    return {Status::NotOK, line};
+  }
+  return Status::OK();
+}
+
+Status SlotMigrator::prepareSSTImportOnDstNode(int sock_fd) { return SendSSTCommand(sock_fd, {"APPLYSST", "PREPARE"}); }
+
 Status SlotMigrator::checkSingleResponse(int sock_fd) { return checkMultipleResponses(sock_fd, 1); }
 
 // Commands  |  Response            |  Instance
@@ -699,9 +763,21 @@ StatusOr<KeyMigrationResult> SlotMigrator::migrateOneKey(const rocksdb::Slice &k
       }
       break;
     }
+    case kRedisBitmap: {
+      // the encoding of the segments is kept in the bitmap metadata
+      BitmapMetadata bitmap_md(false);
+      if (auto s = bitmap_md.Decode(bytes); !s.ok()) {
+        return {Status::NotOK, s.ToString()};
+      }
+
+      auto s = migrateComplexKey(key, bitmap_md, restore_cmds);
+      if (!s.IsOK()) {
+        return s.Prefixed("failed to migrate complex key");
+      }
+      break;
+    }
     case kRedisList:
     case kRedisZSet:
-    case kRedisBitmap:
     case kRedisHash:
     case kRedisSet:
     case kRedisSortedint: {
@@ -812,7 +888,9 @@ Status SlotMigrator::migrateComplexKey(const rocksdb::Slice &key, const Metadata
         break;
       }
       case kRedisBitmap: {
-        auto s = migrateBitmapKey(inkey, &iter, &user_cmd, restore_cmds);
+        // the bitmaps are passed with their BitmapMetadata, see migrateOneKey()
+        const auto &bitmap_metadata = static_cast<const BitmapMetadata &>(metadata);
+        auto s = migrateBitmapKey(bitmap_metadata, inkey, &iter, &user_cmd, restore_cmds);
         if (!s.IsOK()) {
           return s.Prefixed("failed to migrate bitmap key");
         }
@@ -824,7 +902,16 @@ Status SlotMigrator::migrateComplexKey(const rocksdb::Slice &key, const Metadata
         break;
       }
       case kRedisList: {
-        user_cmd.emplace_back(iter->value().ToString());
+        if (!metadata.IsAltEncoded()) {
+          user_cmd.emplace_back(iter->value().ToString());
+          break;
+        }
+        // every subkey of a chunked list holds a chunk of elements
+        std::vector<std::string> elems;
+        if (auto s = redis::List::DecodeChunk(iter->value(), &elems); !s.ok()) {
+          return {Status::NotOK, fmt::format("failed to decode the list chunk of {}: {}", key.ToString(), s.ToString())};
+        }
+        std::move(elems.begin(), elems.end(), std::back_inserter(user_cmd));
         break;
       }
       case kRedisHyperLogLog: {
@@ -945,16 +1032,22 @@ Status SlotMigrator::migrateStream(const Slice &key, const StreamMetadata &metad
   return Status::OK();
 }
 
-Status SlotMigrator::migrateBitmapKey(const InternalKey &inkey, std::unique_ptr<rocksdb::Iterator> *iter,
-                                      std::vector<std::string> *user_cmd, std::string *restore_cmds) {
-  std::string index_str = inkey.GetSubKey().ToString();
-  std::string fragment = (*iter)->value().ToString();
-  auto parse_result = ParseInt<int>(index_str, 10);
-  if (!parse_result) {
-    return {Status::RedisParseErr, "index is not a valid integer"};
+Status SlotMigrator::migrateBitmapKey(const BitmapMetadata &metadata, const InternalKey &inkey,
+                                      std::unique_ptr<rocksdb::Iterator> *iter, std::vector<std::string> *user_cmd,
+                                      std::string *restore_cmds) {
+  // the popcount summary is rebuilt by SETBIT on the destination
+  if (metadata.IsSummarized() && redis::Bitmap::IsSummarySubKey(inkey.GetSubKey())) {
+    return Status::OK();
   }
 
-  uint32_t index = *parse_result;
+  uint32_t index = 0;
+  if (!redis::Bitmap::ParseSegmentSubKey(metadata.HasFixedWidthSubKeys(), inkey.GetSubKey(), &index)) {
+    return {Status::RedisParseErr, "index is not a valid integer"};
+  }
+  std::string fragment;
+  if (auto s = redis::Bitmap::DecodeSegment(metadata, (*iter)->value(), &fragment); !s.ok()) {
+    return {Status::NotOK, s.ToString()};
+  }
 
   // Bitmap does not have hmset-like command
   // TODO(chrisZMF): Use hmset-like command for efficiency
@@ -1237,18 +1330,80 @@ void SlotMigrator::resumeSyncCtx(const Status &migrate_result) {
   }
 }
 
-Status SlotMigrator::sendMigrationBatch(BatchSender *batch) {
+// The snapshot streams share the rate limit
+static size_t StreamBytesPerSec(size_t bytes_per_sec, int streams) {
+  return bytes_per_sec > 0 ? std::max<size_t>(bytes_per_sec / streams, 1) : 0;
+}
+
+Status SlotMigrator::sendMigrationBatch(BatchSender *batch, int streams) {
   // user may dynamically change some configs, apply it when send data
   batch->SetMaxBytes(migrate_batch_size_bytes_);
-  batch->SetBytesPerSecond(migrate_batch_bytes_per_sec_);
+  batch->SetMaxInflight(migrate_batch_window_);
+  batch->SetBytesPerSecond(StreamBytesPerSec(migrate_batch_bytes_per_sec_, streams));
   return batch->Send();
 }
 
 Status SlotMigrator::sendSnapshotByRawKV() {
   uint64_t start_ts = util::GetTimeStampMS();
   auto slot_range = slot_range_.load();
-  LOG(INFO) << "[migrate] Migrating snapshot of slot(s) " << slot_range.String() << " by raw key value";
+  int slots = slot_range.end - slot_range.start + 1;
+  int streams = std::min(migrate_snapshot_streams_.load(), slots);
+  LOG(INFO) << "[migrate] Migrating snapshot of slot(s) " << slot_range.String() << " by raw key value, streams: "
+            << streams;
+
+  if (streams <= 1) {
+    return sendSnapshotRangeByRawKV(slot_range, *dst_fd_, dst_compression_, 1, start_ts);
+  }
+
+  // Split the slots into contiguous ranges, each of them is sent through its own connection. The snapshot
+  // batches don't depend on each other, so they can be applied by the destination in any order.
+  std::vector<UniqueFD> fds(streams);
+  std::vector<StreamCompression> compressions(streams);
+  std::vector<SlotRange> ranges;
+  int begin = slot_range.start;
+  for (int i = 0; i < streams; i++) {
+    GET_OR_RET(connectToDstNode(&fds[i], &compressions[i]));
+    int size = slots / streams + (i < slots % streams ? 1 : 0);
+    ranges.push_back({begin, begin + size - 1});
+    begin += size;
+  }
+
+  std::vector<Status> results(streams);
+  std::vector<std::thread> threads;
+  Status s;
+  for (int i = 0; i < streams; i++) {
+    auto t = util::CreateThread(
+        "migrate-stream", [this, i, streams, start_ts, &ranges, &fds, &compressions, &results] {
+          results[i] = sendSnapshotRangeByRawKV(ranges[i], *fds[i], compressions[i], streams, start_ts);
+          if (!results[i].IsOK()) snapshot_stream_failed_ = true;
+        });
+    if (!t) {
+      s = std::move(t).ToStatus();
+      snapshot_stream_failed_ = true;
+      break;
+    }
+    threads.emplace_back(std::move(*t));
+  }
+
+  for (auto &t : threads) {
+    if (auto join_s = util::ThreadJoin(t); !join_s) {
+      LOG(WARNING) << "[migrate] Snapshot stream thread operation failed: " << join_s.Msg();
+    }
+  }
+  snapshot_stream_failed_ = false;
 
+  if (!s.IsOK()) return s;
+  for (const auto &result : results) {
+    if (!result.IsOK()) return result;
+  }
+
+  LOG(INFO) << fmt::format("[migrate] Succeed to migrate snapshot, slot(s): {}, elapsed: {} ms, streams: {}",
+                           slot_range.String(), util::GetTimeStampMS() - start_ts, streams);
+  return Status::OK();
+}
+
+Status SlotMigrator::sendSnapshotRangeByRawKV(const SlotRange &slot_range, int fd, StreamCompression compression,
+                                              int streams, uint64_t start_ts) {
   auto prefix = ComposeSlotKeyPrefix(namespace_, slot_range.start);
   rocksdb::ReadOptions read_options = storage_->DefaultScanOptions();
   read_options.snapshot = slot_snapshot_;
@@ -1257,7 +1412,9 @@ Status SlotMigrator::sendSnapshotByRawKV() {
   auto no_txn_ctx = engine::Context::NoTransactionContext(storage_);
   engine::DBIterator iter(no_txn_ctx, read_options);
 
-  BatchSender batch_sender(*dst_fd_, migrate_batch_size_bytes_, migrate_batch_bytes_per_sec_);
+  BatchSender batch_sender(fd, migrate_batch_size_bytes_, StreamBytesPerSec(migrate_batch_bytes_per_sec_, streams),
+                           migrate_batch_window_);
+  batch_sender.SetCompression(compression, &srv_->stats);
 
   for (iter.Seek(prefix); iter.Valid(); iter.Next()) {
     // Iteration is out of range
@@ -1266,10 +1423,20 @@ Status SlotMigrator::sendSnapshotByRawKV() {
       break;
     }
 
+    if (stop_migration_ || snapshot_stream_failed_) {
+      return {Status::NotOK, std::string(errMigrationTaskCanceled)};
+    }
+
     auto redis_type = iter.Type();
     std::string log_data;
     if (redis_type == RedisType::kRedisList) {
-      redis::WriteBatchLogData batch_log_data(redis_type, {std::to_string(RedisCommand::kRedisCmdRPush)});
+      // the subkeys of a chunked list hold whole chunks rather than single elements
+      ListMetadata list_metadata(false);
+      if (auto s = list_metadata.Decode(iter.Value()); !s.ok()) {
+        return {Status::NotOK, s.ToString()};
+      }
+      auto cmd = list_metadata.IsChunked() ? RedisCommand::kRedisCmdRPushChunk : RedisCommand::kRedisCmdRPush;
+      redis::WriteBatchLogData batch_log_data(redis_type, {std::to_string(cmd)});
       log_data = batch_log_data.Encode();
     } else {
       redis::WriteBatchLogData batch_log_data(redis_type);
@@ -1277,7 +1444,9 @@ Status SlotMigrator::sendSnapshotByRawKV() {
     }
     batch_sender.SetPrefixLogData(log_data);
 
-    GET_OR_RET(batch_sender.Put(storage_->GetCFHandle(ColumnFamilyID::Metadata), iter.Key(), iter.Value()));
+    std::string metadata_bytes = iter.Value().ToString();
+    if (redis_type == RedisType::kRedisZSet) redis::ZSet::ClearRankIndexFlag(&metadata_bytes);
+    GET_OR_RET(batch_sender.Put(storage_->GetCFHandle(ColumnFamilyID::Metadata), iter.Key(), metadata_bytes));
 
     auto subkey_iter = iter.GetSubKeyIterator();
     if (!subkey_iter) {
@@ -1297,16 +1466,17 @@ Status SlotMigrator::sendSnapshotByRawKV() {
       }
 
       if (batch_sender.IsFull()) {
-        GET_OR_RET(sendMigrationBatch(&batch_sender));
+        GET_OR_RET(sendMigrationBatch(&batch_sender, streams));
       }
     }
 
     if (batch_sender.IsFull()) {
-      GET_OR_RET(sendMigrationBatch(&batch_sender));
+      GET_OR_RET(sendMigrationBatch(&batch_sender, streams));
     }
   }
 
-  GET_OR_RET(sendMigrationBatch(&batch_sender));
+  GET_OR_RET(sendMigrationBatch(&batch_sender, streams));
+  GET_OR_RET(batch_sender.Flush());
 
   auto elapsed = util::GetTimeStampMS() - start_ts;
   LOG(INFO) << fmt::format(
@@ -1321,7 +1491,8 @@ Status SlotMigrator::sendSnapshotByRawKV() {
 Status SlotMigrator::syncWALByRawKV() {
   uint64_t start_ts = util::GetTimeStampMS();
   LOG(INFO) << "[migrate] Syncing WAL of slot(s) " << slot_range_.load().String() << " by raw key value";
-  BatchSender batch_sender(*dst_fd_, migrate_batch_size_bytes_, migrate_batch_bytes_per_sec_);
+  BatchSender batch_sender(*dst_fd_, migrate_batch_size_bytes_, migrate_batch_bytes_per_sec_, migrate_batch_window_);
+  batch_sender.SetCompression(dst_compression_, &srv_->stats);
 
   int epoch = 1;
   uint64_t wal_incremental_seq = 0;
@@ -1392,6 +1563,12 @@ Status SlotMigrator::migrateIncrementalDataByRawKV(uint64_t end_seq, BatchSender
           LOG(INFO) << fmt::format("[migrate] Invalid put column family id: {}", item.column_family_id);
           continue;
         }
+        // the snapshot carries no rank index, so the updates of the source's index would leave the
+        // destination with a partial one, the destination builds its own index on the next write instead
+        if (isZSetRankIndexKey(item.column_family_id, item.key)) break;
+        if (item.column_family_id == static_cast<uint32_t>(ColumnFamilyID::Metadata)) {
+          redis::ZSet::ClearRankIndexFlag(&item.value);
+        }
         GET_OR_RET(batch_sender->Put(storage_->GetCFHandle(static_cast<ColumnFamilyID>(item.column_family_id)),
                                      item.key, item.value));
         break;
@@ -1401,6 +1578,7 @@ Status SlotMigrator::migrateIncrementalDataByRawKV(uint64_t end_seq, BatchSender
           LOG(INFO) << fmt::format("[migrate] Invalid delete column family id: {}", item.column_family_id);
           continue;
         }
+        if (isZSetRankIndexKey(item.column_family_id, item.key)) break;
         GET_OR_RET(
             batch_sender->Delete(storage_->GetCFHandle(static_cast<ColumnFamilyID>(item.column_family_id)), item.key));
         break;
@@ -1417,6 +1595,168 @@ Status SlotMigrator::migrateIncrementalDataByRawKV(uint64_t end_seq, BatchSender
     }
   }
 
-  // send the remaining data
-  return sendMigrationBatch(batch_sender);
+  // send the remaining data and wait for it to be applied
+  GET_OR_RET(sendMigrationBatch(batch_sender));
+  return batch_sender->Flush();
+}
+
+bool SlotMigrator::isZSetRankIndexKey(uint32_t column_family_id, const Slice &key) const {
+  if (column_family_id != static_cast<uint32_t>(ColumnFamilyID::SecondarySubkey)) return false;
+  InternalKey internal_key(key, storage_->IsSlotIdEncoded());
+  return redis::ZSet::IsRankIndexSubKey(internal_key.GetSubKey());
+}
+
+Status SlotMigrator::sendSnapshotBySST() {
+  uint64_t start_ts = util::GetTimeStampMS();
+  auto slot_range = slot_range_.load();
+  LOG(INFO) << "[migrate] Migrating snapshot of slot(s) " << slot_range.String() << " by SST files";
+
+  auto dir = srv_->GetConfig()->MigrateSSTDir();
+  std::error_code ec;
+  std::filesystem::remove_all(dir, ec);
+  if (!std::filesystem::create_directories(dir, ec)) {
+    return {Status::NotOK, fmt::format("failed to create the directory {}: {}", dir, ec.message())};
+  }
+
+  struct timeval tv;
+  tv.tv_sec = kSSTResponseTimeoutSecs;
+  tv.tv_usec = 0;
+  setsockopt(*dst_fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  if (migrate_batch_bytes_per_sec_ > 0) {
+    sst_rate_limiter_.reset(rocksdb::NewGenericRateLimiter(static_cast<int64_t>(migrate_batch_bytes_per_sec_)));
+  }
+  sst_sent_bytes_ = 0;
+
+  // All column families which are keyed by the slot, the keys of every slot range are contiguous in them
+  auto begin = ComposeSlotKeyPrefix(namespace_, slot_range.start);
+  auto end = ComposeSlotKeyPrefix(namespace_, slot_range.end + 1);
+  rocksdb::Slice begin_slice(begin), end_slice(end);
+  rocksdb::ReadOptions read_options = storage_->DefaultScanOptions();
+  read_options.snapshot = slot_snapshot_;
+  read_options.iterate_lower_bound = &begin_slice;
+  read_options.iterate_upper_bound = &end_slice;
+
+  std::vector<std::string> ingest_args = {"APPLYSST", "INGEST"};
+  for (auto cf_id : {ColumnFamilyID::Metadata, ColumnFamilyID::PrimarySubkey, ColumnFamilyID::SecondarySubkey,
+                     ColumnFamilyID::Stream}) {
+    GET_OR_RET(writeSSTFiles(cf_id, read_options, dir, &ingest_args));
+  }
+
+  // Ingest the files of all column families at once, so the keys never miss their subkeys
+  size_t files = (ingest_args.size() - 2) / 2;
+  if (files > 0) {
+    GET_OR_RET(SendSSTCommand(*dst_fd_, ingest_args).Prefixed("failed to ingest SST files"));
+  }
+
+  auto elapsed = util::GetTimeStampMS() - start_ts;
+  LOG(INFO) << fmt::format(
+      "[migrate] Succeed to migrate snapshot by SST files, slot(s): {}, elapsed: {} ms, sent: {} bytes, files: {}",
+      slot_range.String(), elapsed, sst_sent_bytes_, files);
+
+  return Status::OK();
+}
+
+Status SlotMigrator::writeSSTFiles(ColumnFamilyID cf_id, const rocksdb::ReadOptions &read_options,
+                                   const std::string &dir, std::vector<std::string> *ingest_args) {
+  auto cf_handle = storage_->GetCFHandle(cf_id);
+  auto options = storage_->GetDB()->GetOptions(cf_handle);
+  auto iter = util::UniqueIterator(storage_->GetDB()->NewIterator(read_options, cf_handle));
+
+  std::unique_ptr<rocksdb::SstFileWriter> writer;
+  std::string name;
+  // Each file is sent once it's full, while the next one is being written
+  auto finish_file = [&]() -> Status {
+    if (auto s = writer->Finish(); !s.ok()) {
+      return {Status::NotOK, fmt::format("failed to finish the SST file {}: {}", name, s.ToString())};
+    }
+    writer.reset();
+    GET_OR_RET(sendSSTFile(dir, name));
+    ingest_args->emplace_back(std::to_string(static_cast<uint32_t>(cf_id)));
+    ingest_args->emplace_back(name);
+    return Status::OK();
+  };
+
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    if (stop_migration_) {
+      return {Status::NotOK, std::string(errMigrationTaskCanceled)};
+    }
+
+    if (!writer) {
+      name = fmt::format("{}-{}.sst", static_cast<uint32_t>(cf_id), (ingest_args->size() - 2) / 2);
+      writer = std::make_unique<rocksdb::SstFileWriter>(rocksdb::EnvOptions(), options, cf_handle);
+      if (auto s = writer->Open(dir + "/" + name); !s.ok()) {
+        return {Status::NotOK, fmt::format("failed to open the SST file {}: {}", name, s.ToString())};
+      }
+    }
+
+    // leave the rank index out like the raw key value migration does, since the WAL catch-up doesn't forward it
+    if (isZSetRankIndexKey(static_cast<uint32_t>(cf_id), iter->key())) continue;
+
+    std::string value = iter->value().ToString();
+    if (cf_id == ColumnFamilyID::Metadata) redis::ZSet::ClearRankIndexFlag(&value);
+    if (auto s = writer->Put(iter->key(), value); !s.ok()) {
+      return {Status::NotOK, fmt::format("failed to write the SST file {}: {}", name, s.ToString())};
+    }
+
+    if (writer->FileSize() >= kMaxSSTFileSize) {
+      GET_OR_RET(finish_file());
+    }
+  }
+
+  if (auto s = iter->status(); !s.ok()) {
+    return {Status::NotOK, fmt::format("failed to iterate the column family {}: {}", cf_handle->GetName(),
+                                       s.ToString())};
+  }
+
+  if (writer) {
+    GET_OR_RET(finish_file());
+  }
+  return Status::OK();
+}
+
+Status SlotMigrator::sendSSTFile(const std::string &dir, const std::string &name) {
+  auto path = dir + "/" + name;
+  auto env = rocksdb::Env::Default();
+  std::unique_ptr<rocksdb::SequentialFile> file;
+  if (auto s = env->NewSequentialFile(path, &file, rocksdb::EnvOptions()); !s.ok()) {
+    return {Status::NotOK, fmt::format("failed to open the SST file {}: {}", name, s.ToString())};
+  }
+
+  std::string buf(kSSTChunkSize, '\0');
+  uint64_t offset = 0;
+  while (true) {
+    if (stop_migration_) {
+      return {Status::NotOK, std::string(errMigrationTaskCanceled)};
+    }
+
+    rocksdb::Slice chunk;
+    if (auto s = file->Read(kSSTChunkSize, &chunk, buf.data()); !s.ok()) {
+      return {Status::NotOK, fmt::format("failed to read the SST file {}: {}", name, s.ToString())};
+    }
+    if (chunk.empty()) break;
+
+    if (sst_rate_limiter_ && migrate_batch_bytes_per_sec_ > 0) {
+      // the rate limit may be changed dynamically, apply it when sending data
+      sst_rate_limiter_->SetBytesPerSecond(static_cast<int64_t>(migrate_batch_bytes_per_sec_));
+      auto single_burst = sst_rate_limiter_->GetSingleBurstBytes();
+      auto left = static_cast<int64_t>(chunk.size());
+      while (left > 0) {
+        auto request_size = std::min(left, single_burst);
+        sst_rate_limiter_->Request(request_size, rocksdb::Env::IOPriority::IO_HIGH, nullptr);
+        left -= request_size;
+      }
+    }
+
+    auto s = SendSSTCommand(*dst_fd_, {"APPLYSST", "WRITE", name, std::to_string(offset), chunk.ToString()});
+    if (!s.IsOK()) {
+      return s.Prefixed(fmt::format("failed to send the SST file {}", name));
+    }
+    offset += chunk.size();
+  }
+
+  sst_sent_bytes_ += offset;
+  file.reset();
+  env->DeleteFile(path);
+  return Status::OK();
 }
@@ -22,6 +22,7 @@
 
 #include <glog/logging.h>
 #include <rocksdb/db.h>
+#include <rocksdb/rate_limiter.h>
 #include <rocksdb/status.h>
 #include <rocksdb/transaction_log.h>
 #include <rocksdb/write_batch.h>
@@ -52,7 +53,13 @@ enum class MigrationType {
   ///
   /// If downstream is not compatible with raw key-value, this migration type will
   /// auto switch to kRedisCommand.
-  kRawKeyValue
+  kRawKeyValue,
+  /// Write the snapshot of the slots into SST files, send and ingest them on the destination node,
+  /// then sync the incremental data by "APPLYBATCH" like kRawKeyValue.
+  ///
+  /// If downstream can't ingest SST files, e.g. it doesn't support "APPLYSST" or it has replicas
+  /// which can't get the ingested files from the WAL, this migration type will auto switch to kRawKeyValue.
+  kRawSST
 };
 
 enum class MigrationState { kNone = 0, kStarted, kSuccess, kFailed };
@@ -106,6 +113,10 @@ class SlotMigrator : public redis::Database {
   }
   void SetMigrateBatchRateLimit(size_t bytes_per_sec) { migrate_batch_bytes_per_sec_ = bytes_per_sec; }
   void SetMigrateBatchSize(size_t size) { migrate_batch_size_bytes_ = size; }
+  void SetMigrateBatchWindow(size_t window) { migrate_batch_window_ = window; }
+  void SetMigrateSnapshotStreams(int streams) {
+    if (streams > 0) migrate_snapshot_streams_ = streams;
+  }
   void SetStopMigrationFlag(bool value) { stop_migration_ = value; }
   bool IsMigrationInProgress() const { return migration_state_ == MigrationState::kStarted; }
   SlotMigrationStage GetCurrentSlotMigrationStage() const { return current_stage_; }
@@ -126,9 +137,11 @@ class SlotMigrator : public redis::Database {
   Status finishFailedMigration();
   void clean();
 
+  Status connectToDstNode(UniqueFD *fd, StreamCompression *compression);
   Status authOnDstNode(int sock_fd, const std::string &password);
   Status setImportStatusOnDstNode(int sock_fd, int status);
   static StatusOr<bool> supportedApplyBatchCommandOnDstNode(int sock_fd);
+  StatusOr<StreamCompression> setCompressionOnDstNode(int sock_fd, StreamCompression type);
 
   Status sendSnapshotByCmd();
   Status syncWALByCmd();
@@ -141,8 +154,9 @@ class SlotMigrator : public redis::Database {
                           std::string *restore_cmds);
   Status migrateComplexKey(const rocksdb::Slice &key, const Metadata &metadata, std::string *restore_cmds);
   Status migrateStream(const rocksdb::Slice &key, const StreamMetadata &metadata, std::string *restore_cmds);
-  Status migrateBitmapKey(const InternalKey &inkey, std::unique_ptr<rocksdb::Iterator> *iter,
-                          std::vector<std::string> *user_cmd, std::string *restore_cmds);
+  Status migrateBitmapKey(const BitmapMetadata &metadata, const InternalKey &inkey,
+                          std::unique_ptr<rocksdb::Iterator> *iter, std::vector<std::string> *user_cmd,
+                          std::string *restore_cmds);
 
   Status sendCmdsPipelineIfNeed(std::string *commands, bool need);
   void applyMigrationSpeedLimit() const;
@@ -151,11 +165,22 @@ class SlotMigrator : public redis::Database {
   Status syncWalBeforeForbiddingSlot();
   Status syncWalAfterForbiddingSlot();
 
-  Status sendMigrationBatch(BatchSender *batch);
+  Status prepareSSTImportOnDstNode(int sock_fd);
+  Status sendSnapshotBySST();
+  Status writeSSTFiles(ColumnFamilyID cf_id, const rocksdb::ReadOptions &read_options, const std::string &dir,
+                       std::vector<std::string> *ingest_args);
+  Status sendSSTFile(const std::string &dir, const std::string &name);
+
+  // The rate limit is shared by the streams which send the snapshot in parallel
+  Status sendMigrationBatch(BatchSender *batch, int streams = 1);
   Status sendSnapshotByRawKV();
+  Status sendSnapshotRangeByRawKV(const SlotRange &slot_range, int fd, StreamCompression compression, int streams,
+                                  uint64_t start_ts);
   Status syncWALByRawKV();
   bool catchUpIncrementalWAL();
   Status migrateIncrementalDataByRawKV(uint64_t end_seq, BatchSender *batch_sender);
+  // The rank index of the sorted sets isn't migrated by raw key values, see ZSet::IsRankIndexSubKey
+  bool isZSetRankIndexKey(uint32_t column_family_id, const Slice &key) const;
 
   void setForbiddenSlotRange(const SlotRange &slot_range);
   std::unique_lock<std::mutex> blockingLock() { return std::unique_lock<std::mutex>(blocking_mutex_); }
@@ -170,6 +195,10 @@ class SlotMigrator : public redis::Database {
   static constexpr int kDefaultSequenceGapLimit = 10000;
   static constexpr int kMaxItemsInCommand = 16;  // number of items in every write command of complex keys
   static constexpr int kMaxLoopTimes = 10;
+  static constexpr uint64_t kMaxSSTFileSize = 256 * MiB;
+  static constexpr size_t kSSTChunkSize = 4 * MiB;
+  // the ingestion may flush the memtables of the destination, so it takes longer than other commands
+  static constexpr int kSSTResponseTimeoutSecs = 60;
 
   Server *srv_;
 
@@ -178,6 +207,8 @@ class SlotMigrator : public redis::Database {
   uint64_t seq_gap_limit_ = kDefaultSequenceGapLimit;
   std::atomic<size_t> migrate_batch_bytes_per_sec_ = 1 * GiB;
   std::atomic<size_t> migrate_batch_size_bytes_;
+  std::atomic<size_t> migrate_batch_window_;
+  std::atomic<int> migrate_snapshot_streams_;
 
   SlotMigrationStage current_stage_ = SlotMigrationStage::kNone;
   ParserState parser_state_ = ParserState::ArrayLen;
@@ -196,6 +227,7 @@ class SlotMigrator : public redis::Database {
   std::string dst_ip_;
   int dst_port_ = -1;
   UniqueFD dst_fd_;
+  StreamCompression dst_compression_ = StreamCompression::kNone;
 
   MigrationType migration_type_ = MigrationType::kRedisCommand;
 
@@ -207,6 +239,11 @@ class SlotMigrator : public redis::Database {
   std::atomic<bool> stop_migration_ = false;  // if is true migration will be stopped but the thread won't be destroyed
   const rocksdb::Snapshot *slot_snapshot_ = nullptr;
   uint64_t wal_begin_seq_ = 0;
+  // the streams of the snapshot stop once one of them fails
+  std::atomic<bool> snapshot_stream_failed_ = false;
+
+  std::unique_ptr<rocksdb::RateLimiter> sst_rate_limiter_;
+  uint64_t sst_sent_bytes_ = 0;
 
   std::mutex blocking_mutex_;
   SyncMigrateContext *blocking_context_ = nullptr;
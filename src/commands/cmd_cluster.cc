@@ -45,6 +45,14 @@ class CommandCluster : public Commander {
 
     if (subcommand_ == "keyslot" && args_.size() == 3) return Status::OK();
 
+    if (subcommand_ == "countkeysinslot" && args_.size() == 3) {
+      auto slot = ParseInt<uint16_t>(args_[2], {0, HASH_SLOTS_MASK}, 10);
+      if (!slot) return {Status::RedisParseErr, "Invalid slot"};
+
+      slot_ = *slot;
+      return Status::OK();
+    }
+
     if (subcommand_ == "import") {
       if (args.size() != 4) return {Status::RedisParseErr, errWrongNumOfArguments};
 
@@ -62,7 +70,8 @@ class CommandCluster : public Commander {
 
     if (subcommand_ == "replicas" && args_.size() == 3) return Status::OK();
 
-    return {Status::RedisParseErr, "CLUSTER command, CLUSTER INFO|NODES|SLOTS|KEYSLOT|RESET|REPLICAS"};
+    return {Status::RedisParseErr,
+            "CLUSTER command, CLUSTER INFO|NODES|SLOTS|KEYSLOT|COUNTKEYSINSLOT|RESET|REPLICAS"};
   }
 
   Status Execute(Server *srv, Connection *conn, std::string *output) override {
@@ -77,6 +86,11 @@ class CommandCluster : public Commander {
     if (subcommand_ == "keyslot") {
       auto slot_id = GetSlotIdFromKey(args_[2]);
       *output = redis::Integer(slot_id);
+    } else if (subcommand_ == "countkeysinslot") {
+      uint64_t count = 0;
+      auto s = srv->storage->GetKeyNumEstimator()->CountKeysInSlot(conn->GetNamespace(), slot_, &count);
+      if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
+      *output = redis::Integer(count);
     } else if (subcommand_ == "slots") {
       std::vector<SlotInfo> infos;
       Status s = srv->cluster->GetSlotsInfo(&infos);
@@ -145,6 +159,7 @@ class CommandCluster : public Commander {
   std::string subcommand_;
   std::vector<SlotRange> slot_ranges_;
   ImportStatus state_ = kImportNone;
+  uint16_t slot_ = 0;
 };
 
 class CommandClusterX : public Commander {
@@ -319,6 +334,68 @@ class CommandClusterX : public Commander {
   std::unique_ptr<SyncMigrateContext> sync_migrate_ctx_ = nullptr;
 };
 
+// APPLYSST PREPARE
+// APPLYSST WRITE <name> <offset> <data>
+// APPLYSST INGEST <column family id> <name> [<column family id> <name> ...]
+//
+// Receives the snapshot of the importing slots as SST files, see the raw-sst migrate-type.
+class CommandApplySST : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    subcommand_ = util::ToLower(args[1]);
+
+    if (subcommand_ == "prepare" && args.size() == 2) return Status::OK();
+
+    if (subcommand_ == "write" && args.size() == 5) {
+      auto offset = ParseInt<uint64_t>(args[3], 10);
+      if (!offset) return {Status::RedisParseErr, "Invalid offset"};
+
+      offset_ = *offset;
+      return Status::OK();
+    }
+
+    if (subcommand_ == "ingest" && args.size() >= 4 && args.size() % 2 == 0) {
+      for (size_t i = 2; i < args.size(); i += 2) {
+        auto cf_id = ParseInt<uint32_t>(args[i], {0, kMaxColumnFamilyID}, 10);
+        if (!cf_id) return {Status::RedisParseErr, "Invalid column family id"};
+
+        files_.emplace_back(static_cast<ColumnFamilyID>(*cf_id), args[i + 1]);
+      }
+      return Status::OK();
+    }
+
+    return {Status::RedisParseErr, "APPLYSST command, APPLYSST PREPARE|WRITE|INGEST"};
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    if (!srv->GetConfig()->cluster_enabled) {
+      return {Status::RedisExecErr, "Cluster mode is not enabled"};
+    }
+
+    if (!conn->IsAdmin()) {
+      return {Status::RedisExecErr, errAdminPermissionRequired};
+    }
+
+    Status s;
+    if (subcommand_ == "prepare") {
+      s = srv->slot_import->PrepareSST();
+    } else if (subcommand_ == "write") {
+      s = srv->slot_import->WriteSSTChunk(args_[2], offset_, args_[4]);
+    } else {
+      s = srv->slot_import->IngestSSTFiles(files_);
+    }
+    if (!s.IsOK()) return s;
+
+    *output = redis::SimpleString("OK");
+    return Status::OK();
+  }
+
+ private:
+  std::string subcommand_;
+  uint64_t offset_ = 0;
+  std::vector<std::pair<ColumnFamilyID, std::string>> files_;
+};
+
 static uint64_t GenerateClusterFlag(uint64_t flags, const std::vector<std::string> &args) {
   if (args.size() >= 2 && Cluster::SubCommandIsExecExclusive(args[1])) {
     return flags | kCmdExclusive;
@@ -359,6 +436,7 @@ REDIS_REGISTER_COMMANDS(Cluster,
                         MakeCmdAttr<CommandClusterX>("clusterx", -2, "cluster no-script", 0, 0, 0, GenerateClusterFlag),
                         MakeCmdAttr<CommandReadOnly>("readonly", 1, "cluster no-multi", 0, 0, 0),
                         MakeCmdAttr<CommandReadWrite>("readwrite", 1, "cluster no-multi", 0, 0, 0),
-                        MakeCmdAttr<CommandAsking>("asking", 1, "cluster", 0, 0, 0), )
+                        MakeCmdAttr<CommandAsking>("asking", 1, "cluster", 0, 0, 0),
+                        MakeCmdAttr<CommandApplySST>("applysst", -2, "write no-multi no-script", 0, 0, 0), )
 
 }  // namespace redis
@@ -99,6 +99,7 @@ struct CommandFCall : Commander {
 };
 
 CommandKeyRange GetScriptEvalKeyRange(const std::vector<std::string> &args);
+uint64_t GenerateScriptEvalFlags(uint64_t flags, const std::vector<std::string> &args);
 
 uint64_t GenerateFunctionFlags(uint64_t flags, const std::vector<std::string> &args) {
   if (util::EqualICase(args[1], "load") || util::EqualICase(args[1], "delete")) {
@@ -110,7 +111,8 @@ uint64_t GenerateFunctionFlags(uint64_t flags, const std::vector<std::string> &a
 
 REDIS_REGISTER_COMMANDS(
     Function, MakeCmdAttr<CommandFunction>("function", -2, "exclusive no-script", 0, 0, 0, GenerateFunctionFlags),
-    MakeCmdAttr<CommandFCall<>>("fcall", -3, "exclusive write no-script", GetScriptEvalKeyRange),
+    MakeCmdAttr<CommandFCall<>>("fcall", -3, "exclusive write no-script", GetScriptEvalKeyRange,
+                                GenerateScriptEvalFlags),
     MakeCmdAttr<CommandFCall<true>>("fcall_ro", -3, "read-only ro-script no-script", GetScriptEvalKeyRange));
 
 }  // namespace redis
@@ -30,10 +30,8 @@ namespace redis {
 class CommandHGet : public Commander {
  public:
   Status Execute(Server *srv, Connection *conn, std::string *output) override {
-    redis::Hash hash_db(srv->storage, conn->GetNamespace());
     std::string value;
-    engine::Context ctx(srv->storage);
-    auto s = hash_db.Get(ctx, args_[1], args_[2], &value);
+    auto s = get(srv, conn, &value);
     if (!s.ok() && !s.IsNotFound()) {
       return {Status::RedisExecErr, s.ToString()};
     }
@@ -41,6 +39,28 @@ class CommandHGet : public Commander {
     *output = s.IsNotFound() ? conn->NilString() : redis::BulkString(value);
     return Status::OK();
   }
+
+  Status ExecuteWithReplyBuilder(Server *srv, Connection *conn, ReplyBuilder *builder) override {
+    std::string value;
+    auto s = get(srv, conn, &value);
+    if (!s.ok() && !s.IsNotFound()) {
+      return {Status::RedisExecErr, s.ToString()};
+    }
+
+    if (s.IsNotFound()) {
+      builder->NilString();
+    } else {
+      builder->BulkString(value);
+    }
+    return Status::OK();
+  }
+
+ private:
+  rocksdb::Status get(Server *srv, Connection *conn, std::string *value) const {
+    redis::Hash hash_db(srv->storage, conn->GetNamespace());
+    engine::Context ctx(srv->storage);
+    return hash_db.Get(ctx, args_[1], args_[2], value);
+  }
 };
 
 class CommandHSetNX : public Commander {
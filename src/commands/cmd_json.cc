@@ -136,9 +136,10 @@ class CommandJsonInfo : public Commander {
     auto s = json.Info(ctx, args_[1], &storage_format);
     if (!s.ok()) return {Status::RedisExecErr, s.ToString()};
 
-    auto format_str = storage_format == JsonStorageFormat::JSON   ? "json"
-                      : storage_format == JsonStorageFormat::CBOR ? "cbor"
-                                                                  : "unknown";
+    auto format_str = storage_format == JsonStorageFormat::JSON       ? "json"
+                      : storage_format == JsonStorageFormat::CBOR     ? "cbor"
+                      : storage_format == JsonStorageFormat::SHREDDED ? "shredded"
+                                                                      : "unknown";
     output->append(conn->MultiBulkString({"storage_format", format_str}));
     return Status::OK();
   }
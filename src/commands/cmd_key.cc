@@ -490,6 +490,43 @@ class CommandSort : public Commander {
     return Status::OK();
   }
 
+  static std::vector<CommandKeyRange> Range(const std::vector<std::string> &args) {
+    int store_key = 0;
+
+    // Skip the values of the options like the parser does, so a pattern named "store" isn't taken as the option.
+    for (size_t i = 2; i < args.size(); i++) {
+      if (util::EqualICase(args[i], "by") || util::EqualICase(args[i], "get")) {
+        i++;
+      } else if (util::EqualICase(args[i], "limit")) {
+        i += 2;
+      } else if (util::EqualICase(args[i], "store") && i + 1 < args.size()) {
+        store_key = (int)i + 1;
+        i++;
+      }
+    }
+
+    if (store_key > 0) {
+      return {{1, 1, 1}, {store_key, store_key, 1}};
+    }
+    return {{1, 1, 1}};
+  }
+
+  static uint64_t FlagGen(uint64_t flags, const std::vector<std::string> &args) {
+    // the keys formed by the BY and GET patterns are only known while sorting
+    for (size_t i = 2; i + 1 < args.size(); i++) {
+      if (util::EqualICase(args[i], "by") || util::EqualICase(args[i], "get")) {
+        if (args[i + 1].find('*') != std::string::npos) return flags | kCmdUnlistedKeys;
+        i++;
+      } else if (util::EqualICase(args[i], "limit")) {
+        i += 2;
+      } else if (util::EqualICase(args[i], "store")) {
+        i++;
+      }
+    }
+
+    return flags;
+  }
+
   Status Execute(Server *srv, Connection *conn, std::string *output) override {
     redis::Database redis(srv->storage, conn->GetNamespace());
     engine::Context ctx(srv->storage);
@@ -557,7 +594,7 @@ REDIS_REGISTER_COMMANDS(Key, MakeCmdAttr<CommandTTL>("ttl", 2, "read-only", 1, 1
                         MakeCmdAttr<CommandPTTL>("pttl", 2, "read-only", 1, 1, 1),
                         MakeCmdAttr<CommandType>("type", 2, "read-only", 1, 1, 1),
                         MakeCmdAttr<CommandMove>("move", 3, "write", 1, 1, 1),
-                        MakeCmdAttr<CommandMoveX>("movex", 3, "write", 1, 1, 1),
+                        MakeCmdAttr<CommandMoveX>("movex", 3, "write unlisted-keys", 1, 1, 1),
                         MakeCmdAttr<CommandObject>("object", 3, "read-only", 2, 2, 1),
                         MakeCmdAttr<CommandExists>("exists", -2, "read-only", 1, -1, 1),
                         MakeCmdAttr<CommandPersist>("persist", 2, "write", 1, 1, 1),
@@ -572,7 +609,9 @@ REDIS_REGISTER_COMMANDS(Key, MakeCmdAttr<CommandTTL>("ttl", 2, "read-only", 1, 1
                         MakeCmdAttr<CommandRename>("rename", 3, "write", 1, 2, 1),
                         MakeCmdAttr<CommandRenameNX>("renamenx", 3, "write", 1, 2, 1),
                         MakeCmdAttr<CommandCopy>("copy", -3, "write", 1, 2, 1),
-                        MakeCmdAttr<CommandSort<false>>("sort", -2, "write", 1, 1, 1),
-                        MakeCmdAttr<CommandSort<true>>("sort_ro", -2, "read-only", 1, 1, 1))
+                        MakeCmdAttr<CommandSort<false>>("sort", -2, "write", CommandSort<false>::Range,
+                                                        CommandSort<false>::FlagGen),
+                        MakeCmdAttr<CommandSort<true>>("sort_ro", -2, "read-only", 1, 1, 1,
+                                                       CommandSort<true>::FlagGen))
 
 }  // namespace redis
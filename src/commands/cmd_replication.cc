@@ -18,7 +18,12 @@
  *
  */
 
+#include <climits>
+#include <optional>
+
+#include "blocking_commander.h"
 #include "commander.h"
+#include "compression_util.h"
 #include "error_constants.h"
 #include "io_util.h"
 #include "scope_exit.h"
@@ -63,6 +68,10 @@ class CommandPSync : public Commander {
               << " replication id: " << (replica_replid_.length() ? replica_replid_ : "not supported")
               << ", and local sequence: " << srv->storage->LatestSeqNumber();
 
+    if (srv->storage->IsImportingSST()) {
+      return {Status::RedisExecErr, "SST files are being imported, please try again later"};
+    }
+
     bool need_full_sync = false;
 
     // Check replication id of the last sequence log
@@ -84,6 +93,12 @@ class CommandPSync : public Commander {
       need_full_sync = true;
     }
 
+    // The SST files ingested after the sequence aren't in the WAL
+    if (!need_full_sync && next_repl_seq_ <= srv->storage->GetSSTIngestedSequence() + 1) {
+      *output = "SST files were ingested after the sequence, please use fullsync";
+      need_full_sync = true;
+    }
+
     if (need_full_sync) {
       srv->stats.IncrPSyncErrCount();
       return {Status::RedisExecErr, *output};
@@ -179,6 +194,15 @@ class CommandReplConf : public Commander {
         return {Status::RedisParseErr, "ip-address should not be empty"};
       }
       ip_address_ = value;
+    } else if (option == "compression") {
+      auto type = util::ParseStreamCompression(value);
+      if (!type) {
+        return {Status::RedisParseErr, "compression should be no, lz4 or zstd"};
+      }
+      compression_ = *type;
+    } else if (option == "capa") {
+      // the unknown capabilities are ignored, so the newer replicas can announce more of them
+      if (util::EqualICase(value, "ack")) capa_ack_ = true;
     } else {
       return {Status::RedisParseErr, errUnknownOption};
     }
@@ -193,6 +217,12 @@ class CommandReplConf : public Commander {
     if (!ip_address_.empty()) {
       conn->SetAnnounceIP(ip_address_);
     }
+    if (compression_) {
+      conn->SetStreamCompression(*compression_);
+    }
+    if (capa_ack_) {
+      conn->EnableReplAck();
+    }
     *output = redis::SimpleString("OK");
     return Status::OK();
   }
@@ -200,6 +230,64 @@ class CommandReplConf : public Commander {
  private:
   int port_ = 0;
   std::string ip_address_;
+  std::optional<StreamCompression> compression_;
+  bool capa_ack_ = false;
+};
+
+class CommandWait : public BlockingCommander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    auto num_replicas = ParseInt<int>(args[1], {0, INT_MAX}, 10);
+    if (!num_replicas) {
+      return {Status::RedisParseErr, errValueNotInteger};
+    }
+    num_replicas_ = *num_replicas;
+
+    auto timeout_ms = ParseInt<int64_t>(args[2], {0, INT64_MAX / 1000}, 10);
+    if (!timeout_ms) {
+      return {Status::RedisParseErr, "timeout is not an integer or out of range"};
+    }
+    timeout_ms_ = *timeout_ms;
+    return Commander::Parse(args);
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    if (srv->IsSlave()) {
+      return {Status::RedisExecErr, "WAIT cannot be used with replica instances"};
+    }
+
+    srv_ = srv;
+    // the acks are compared with the latest sequence, which covers the writes of this connection
+    seq_ = srv->storage->LatestSeqNumber();
+    auto acked = srv->GetReplicasAcked(seq_);
+    if (num_replicas_ == 0 || acked >= num_replicas_) {
+      *output = redis::Integer(acked);
+      return Status::OK();
+    }
+
+    InitConnection(conn);
+    return StartBlocking(timeout_ms_ * 1000, output);
+  }
+
+  void BlockKeys() override { srv_->BlockOnReplAck(conn_, seq_, num_replicas_); }
+
+  void UnblockKeys() override { srv_->UnblockOnReplAck(conn_); }
+
+  bool OnBlockingWrite() override {
+    auto acked = srv_->GetReplicasAcked(seq_);
+    if (acked < num_replicas_) return false;
+
+    conn_->Reply(redis::Integer(acked));
+    return true;
+  }
+
+  std::string NoopReply(const Connection *conn) override { return redis::Integer(srv_->GetReplicasAcked(seq_)); }
+
+ private:
+  Server *srv_ = nullptr;
+  int num_replicas_ = 0;
+  int64_t timeout_ms_ = 0;
+  rocksdb::SequenceNumber seq_ = 0;
 };
 
 class CommandFetchMeta : public Commander {
@@ -267,6 +355,7 @@ class CommandFetchFile : public Commander {
 
     int repl_fd = conn->GetFD();
     std::string ip = conn->GetAnnounceIP();
+    auto compression = conn->GetStreamCompression();
 
     auto s = util::SockSetBlocking(repl_fd, 1);
     if (!s.IsOK()) {
@@ -276,7 +365,8 @@ class CommandFetchFile : public Commander {
     conn->NeedNotFreeBufferEvent();  // Feed-replica-file thread will close the replica bufferevent
     conn->EnableFlag(redis::Connection::kCloseAsync);
 
-    auto t = GET_OR_RET(util::CreateThread("feed-repl-file", [srv, repl_fd, ip, files, bev = conn->GetBufferEvent()]() {
+    auto t = GET_OR_RET(util::CreateThread("feed-repl-file", [srv, repl_fd, ip, files, compression,
+                                                              bev = conn->GetBufferEvent()]() {
       auto exit = MakeScopeExit([bev] { bufferevent_free(bev); });
       srv->IncrFetchFileThread();
 
@@ -292,11 +382,19 @@ class CommandFetchFile : public Commander {
         if (!fd) break;
 
         // Send file size and content
-        if (util::SockSend(repl_fd, std::to_string(file_size) + CRLF, bev).IsOK() &&
-            util::SockSendFile(repl_fd, *fd, file_size, bev).IsOK()) {
+        uint64_t sent_bytes = file_size;
+        auto s = util::SockSend(repl_fd, std::to_string(file_size) + CRLF, bev);
+        if (s.IsOK() && compression == StreamCompression::kNone) {
+          s = util::SockSendFile(repl_fd, *fd, file_size, bev);
+        } else if (s.IsOK()) {
+          auto sent = sendCompressedFile(srv, repl_fd, *fd, file_size, compression, bev);
+          s = sent ? Status::OK() : std::move(sent).ToStatus();
+          if (sent) sent_bytes = *sent;
+        }
+        if (s.IsOK()) {
           LOG(INFO) << "[replication] Succeed sending file " << file << " to " << ip;
         } else {
-          LOG(WARNING) << "[replication] Fail to send file " << file << " to " << ip << ", error: " << strerror(errno);
+          LOG(WARNING) << "[replication] Fail to send file " << file << " to " << ip << ", error: " << s.Msg();
           break;
         }
         fd.Close();
@@ -305,7 +403,7 @@ class CommandFetchFile : public Commander {
         auto end = std::chrono::high_resolution_clock::now();
         uint64_t duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
         if (max_replication_bytes > 0) {
-          auto shortest = static_cast<uint64_t>(static_cast<double>(file_size) /
+          auto shortest = static_cast<uint64_t>(static_cast<double>(sent_bytes) /
                                                 static_cast<double>(max_replication_bytes) * (1000 * 1000));
           if (duration < shortest) {
             LOG(INFO) << "[replication] Need to sleep " << (shortest - duration) / 1000
@@ -328,6 +426,30 @@ class CommandFetchFile : public Commander {
 
  private:
   std::string files_str_;
+
+  static const size_t kCompressedChunkSize = 1024 * 1024;
+
+  // Send the file in chunks of compressed frames, each of them follows the line of its length,
+  // return the number of bytes sent
+  static StatusOr<uint64_t> sendCompressedFile(Server *srv, int repl_fd, int file_fd, uint64_t file_size,
+                                               StreamCompression compression, bufferevent *bev) {
+    std::string chunk(kCompressedChunkSize, 0);
+    uint64_t sent_bytes = 0;
+    uint64_t remain = file_size;
+    while (remain > 0) {
+      auto n = read(file_fd, chunk.data(), std::min<uint64_t>(remain, chunk.size()));
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0) return Status::FromErrno("read file");
+      if (n == 0) return {Status::NotOK, "the file is truncated"};
+
+      auto frame = GET_OR_RET(srv->stats.CompressStreamFrame(compression, std::string_view(chunk.data(), n)));
+      auto payload = std::to_string(frame.size()) + CRLF + frame;
+      GET_OR_RET(util::SockSend(repl_fd, payload, bev));
+      sent_bytes += payload.size();
+      remain -= n;
+    }
+    return sent_bytes;
+  }
 };
 
 class CommandDBName : public Commander {
@@ -345,6 +467,7 @@ REDIS_REGISTER_COMMANDS(
     MakeCmdAttr<CommandPSync>("psync", -2, "read-only replication no-multi no-script", 0, 0, 0),
     MakeCmdAttr<CommandFetchMeta>("_fetch_meta", 1, "read-only replication no-multi no-script", 0, 0, 0),
     MakeCmdAttr<CommandFetchFile>("_fetch_file", 2, "read-only replication no-multi no-script", 0, 0, 0),
-    MakeCmdAttr<CommandDBName>("_db_name", 1, "read-only replication no-multi", 0, 0, 0), )
+    MakeCmdAttr<CommandDBName>("_db_name", 1, "read-only replication no-multi", 0, 0, 0),
+    MakeCmdAttr<CommandWait>("wait", 3, "read-only no-script", 0, 0, 0), )
 
 }  // namespace redis
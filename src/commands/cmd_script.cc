@@ -115,6 +115,15 @@ CommandKeyRange GetScriptEvalKeyRange(const std::vector<std::string> &args) {
   return {3, 2 + numkeys, 1};
 }
 
+uint64_t GenerateScriptEvalFlags(uint64_t flags, const std::vector<std::string> &args) {
+  // the scripts declaring their keys may run holding the locks of their keys instead of exclusively
+  if (ParseInt<int>(args[2], 10).ValueOr(0) > 0) {
+    return flags | kCmdKeyLocking;
+  }
+
+  return flags;
+}
+
 uint64_t GenerateScriptFlags(uint64_t flags, const std::vector<std::string> &args) {
   if (util::EqualICase(args[1], "load") || util::EqualICase(args[1], "flush")) {
     return flags | kCmdWrite;
@@ -124,8 +133,10 @@ uint64_t GenerateScriptFlags(uint64_t flags, const std::vector<std::string> &arg
 }
 
 REDIS_REGISTER_COMMANDS(
-    Script, MakeCmdAttr<CommandEval>("eval", -3, "exclusive write no-script", GetScriptEvalKeyRange),
-    MakeCmdAttr<CommandEvalSHA>("evalsha", -3, "exclusive write no-script", GetScriptEvalKeyRange),
+    Script,
+    MakeCmdAttr<CommandEval>("eval", -3, "exclusive write no-script", GetScriptEvalKeyRange, GenerateScriptEvalFlags),
+    MakeCmdAttr<CommandEvalSHA>("evalsha", -3, "exclusive write no-script", GetScriptEvalKeyRange,
+                                GenerateScriptEvalFlags),
     MakeCmdAttr<CommandEvalRO>("eval_ro", -3, "read-only no-script ro-script", GetScriptEvalKeyRange),
     MakeCmdAttr<CommandEvalSHARO>("evalsha_ro", -3, "read-only no-script ro-script", GetScriptEvalKeyRange),
     MakeCmdAttr<CommandScript>("script", -2, "exclusive no-script", 0, 0, 0), )
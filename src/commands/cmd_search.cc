@@ -125,6 +125,8 @@ class CommandFTCreate : public Commander {
             if (parser.EatEqICase("TYPE")) {
               if (parser.EatEqICase("FLOAT64")) {
                 vector->vector_type = VectorType::FLOAT64;
+              } else if (parser.EatEqICase("FLOAT32")) {
+                vector->vector_type = VectorType::FLOAT32;
               } else {
                 return {Status::RedisParseErr, "unsupported vector type"};
               }
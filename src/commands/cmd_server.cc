@@ -18,6 +18,8 @@
  *
  */
 
+#include <algorithm>
+
 #include "command_parser.h"
 #include "commander.h"
 #include "commands/scan_base.h"
@@ -401,12 +403,87 @@ class CommandSlowlog : public Commander {
   int64_t cnt_ = 10;
 };
 
+class CommandLatency : public Commander {
+ public:
+  Status Parse(const std::vector<std::string> &args) override {
+    subcommand_ = util::ToLower(args[1]);
+    if (subcommand_ == "latest" && args.size() == 2) {
+      return Status::OK();
+    }
+    if (subcommand_ == "history" && args.size() == 3) {
+      event_ = args[2];
+      return Status::OK();
+    }
+    if (subcommand_ == "reset" || subcommand_ == "histogram") {
+      for (size_t i = 2; i < args.size(); i++) {
+        names_.emplace_back(subcommand_ == "histogram" ? util::ToLower(args[i]) : args[i]);
+      }
+      return Status::OK();
+    }
+    return {Status::RedisParseErr, "LATENCY subcommand must be one of LATEST, HISTORY, RESET, HISTOGRAM"};
+  }
+
+  Status Execute(Server *srv, Connection *conn, std::string *output) override {
+    auto monitor = srv->storage->GetLatencyMonitor();
+    if (subcommand_ == "latest") {
+      auto latest = monitor->GetLatest();
+      *output = redis::MultiLen(latest.size());
+      for (const auto &stats : latest) {
+        output->append(redis::MultiLen(4));
+        output->append(redis::BulkString(stats.event));
+        output->append(redis::Integer(stats.latest.time));
+        output->append(redis::Integer(stats.latest.latency));
+        output->append(redis::Integer(stats.max));
+      }
+    } else if (subcommand_ == "history") {
+      auto history = monitor->GetHistory(event_);
+      *output = redis::MultiLen(history.size());
+      for (const auto &sample : history) {
+        output->append(redis::MultiLen(2));
+        output->append(redis::Integer(sample.time));
+        output->append(redis::Integer(sample.latency));
+      }
+    } else if (subcommand_ == "reset") {
+      *output = redis::Integer(monitor->Reset(names_));
+    } else if (subcommand_ == "histogram") {
+      std::string histograms;
+      size_t count = 0;
+      for (const auto &[name, attributes] : *CommandTable::GetOriginal()) {
+        if (!names_.empty() && std::find(names_.begin(), names_.end(), name) == names_.end()) continue;
+        auto calls = srv->stats.GetCommandStat(attributes->id).calls;
+        if (calls == 0) continue;
+
+        auto buckets = srv->stats.GetLatencyDistribution(attributes->id).CumulativeCounts();
+        histograms.append(redis::BulkString(name));
+        histograms.append(conn->HeaderOfMap(2));
+        histograms.append(redis::BulkString("calls"));
+        histograms.append(redis::Integer(calls));
+        histograms.append(redis::BulkString("histogram_usec"));
+        histograms.append(conn->HeaderOfMap(buckets.size()));
+        for (const auto &[bound, cumulative] : buckets) {
+          histograms.append(redis::Integer(bound));
+          histograms.append(redis::Integer(cumulative));
+        }
+        count++;
+      }
+      *output = conn->HeaderOfMap(count) + histograms;
+    }
+    return Status::OK();
+  }
+
+ private:
+  std::string subcommand_;
+  std::string event_;
+  std::vector<std::string> names_;
+};
+
 class CommandClient : public Commander {
  public:
   Status Parse(const std::vector<std::string> &args) override {
     subcommand_ = util::ToLower(args[1]);
-    // subcommand: getname id kill list info setname
-    if ((subcommand_ == "id" || subcommand_ == "getname" || subcommand_ == "list" || subcommand_ == "info") &&
+    // subcommand: getname id kill list info setname tracking getredir trackinginfo
+    if ((subcommand_ == "id" || subcommand_ == "getname" || subcommand_ == "list" || subcommand_ == "info" ||
+         subcommand_ == "getredir" || subcommand_ == "trackinginfo") &&
         args.size() == 2) {
       return Status::OK();
     }
@@ -425,6 +502,10 @@ class CommandClient : public Commander {
       return Status::OK();
     }
 
+    if (subcommand_ == "tracking" && args.size() >= 3) {
+      return parseTracking(args);
+    }
+
     if ((subcommand_ == "kill")) {
       if (args.size() == 2) {
         return {Status::RedisParseErr, errInvalidSyntax};
@@ -477,7 +558,8 @@ class CommandClient : public Commander {
       }
       return Status::OK();
     }
-    return {Status::RedisInvalidCmd, "Syntax error, try CLIENT LIST|INFO|KILL ip:port|GETNAME|SETNAME"};
+    return {Status::RedisInvalidCmd,
+            "Syntax error, try CLIENT LIST|INFO|KILL ip:port|GETNAME|SETNAME|TRACKING|GETREDIR|TRACKINGINFO"};
   }
 
   Status Execute(Server *srv, Connection *conn, std::string *output) override {
@@ -510,12 +592,98 @@ class CommandClient : public Commander {
           *output = redis::SimpleString("OK");
       }
       return Status::OK();
+    } else if (subcommand_ == "tracking") {
+      return executeTracking(srv, conn, output);
+    } else if (subcommand_ == "getredir") {
+      *output = redis::Integer(srv->tracking.GetRedirect(conn->GetID()));
+      return Status::OK();
+    } else if (subcommand_ == "trackinginfo") {
+      TrackingOptions options;
+      bool tracking = srv->tracking.GetOptions(conn->GetID(), &options);
+      std::vector<std::string> flags;
+      if (!tracking) {
+        flags.emplace_back("off");
+      } else {
+        flags.emplace_back("on");
+        if (options.bcast) flags.emplace_back("bcast");
+        if (options.noloop) flags.emplace_back("noloop");
+      }
+      *output = conn->HeaderOfMap(3);
+      *output += redis::BulkString("flags") + conn->SetOfBulkStrings(flags);
+      *output += redis::BulkString("redirect") + redis::Integer(tracking ? static_cast<int64_t>(options.redirect) : -1);
+      *output += redis::BulkString("prefixes") + redis::ArrayOfBulkStrings(options.prefixes);
+      return Status::OK();
     }
 
-    return {Status::RedisInvalidCmd, "Syntax error, try CLIENT LIST|INFO|KILL ip:port|GETNAME|SETNAME"};
+    return {Status::RedisInvalidCmd,
+            "Syntax error, try CLIENT LIST|INFO|KILL ip:port|GETNAME|SETNAME|TRACKING|GETREDIR|TRACKINGINFO"};
   }
 
  private:
+  // CLIENT TRACKING ON|OFF [REDIRECT client-id] [PREFIX prefix [PREFIX prefix ...]] [BCAST] [NOLOOP]
+  Status parseTracking(const std::vector<std::string> &args) {
+    if (util::EqualICase(args[2], "on")) {
+      tracking_on_ = true;
+    } else if (util::EqualICase(args[2], "off")) {
+      tracking_on_ = false;
+    } else {
+      return {Status::RedisParseErr, errInvalidSyntax};
+    }
+
+    CommandParser parser(args, 3);
+    while (parser.Good()) {
+      if (parser.EatEqICase("bcast")) {
+        tracking_options_.bcast = true;
+      } else if (parser.EatEqICase("noloop")) {
+        tracking_options_.noloop = true;
+      } else if (parser.EatEqICase("redirect")) {
+        tracking_options_.redirect = GET_OR_RET(parser.TakeInt<uint64_t>());
+      } else if (parser.EatEqICase("prefix")) {
+        tracking_options_.prefixes.emplace_back(GET_OR_RET(parser.TakeStr()));
+      } else if (parser.EatEqICase("optin") || parser.EatEqICase("optout")) {
+        return {Status::RedisParseErr, "OPTIN and OPTOUT are not supported"};
+      } else {
+        return {Status::RedisParseErr, errInvalidSyntax};
+      }
+    }
+
+    if (!tracking_options_.bcast && !tracking_options_.prefixes.empty()) {
+      return {Status::RedisParseErr, "PREFIX option requires BCAST mode to be enabled"};
+    }
+    return Status::OK();
+  }
+
+  Status executeTracking(Server *srv, Connection *conn, std::string *output) {
+    if (!tracking_on_) {
+      if (conn->IsFlagEnabled(Connection::kTracking)) {
+        srv->tracking.Disable(conn->GetID());
+        conn->DisableFlag(Connection::kTracking);
+      }
+      *output = redis::SimpleString("OK");
+      return Status::OK();
+    }
+
+    TrackingOptions current;
+    if (srv->tracking.GetOptions(conn->GetID(), &current) && current.bcast != tracking_options_.bcast) {
+      return {Status::RedisExecErr, "You can't switch BCAST mode on/off before disabling tracking for this client"};
+    }
+
+    TrackingTarget redirect;
+    if (tracking_options_.redirect != 0) {
+      // the client itself is served by the current worker, so it can't be missed by the lookup
+      redirect = srv->LookupClient(tracking_options_.redirect);
+      if (redirect.id == 0) {
+        return {Status::RedisExecErr, "The client ID you want redirect to does not exist"};
+      }
+    }
+
+    TrackingTarget client{conn->Owner(), conn->GetFD(), conn->GetID()};
+    srv->tracking.Enable(client, conn->GetNamespace(), tracking_options_, redirect);
+    conn->EnableFlag(Connection::kTracking);
+    *output = redis::SimpleString("OK");
+    return Status::OK();
+  }
+
   std::string addr_;
   std::string conn_name_;
   std::string subcommand_;
@@ -523,6 +691,8 @@ class CommandClient : public Commander {
   int64_t kill_type_ = 0;
   uint64_t id_ = 0;
   bool new_format_ = true;
+  bool tracking_on_ = false;
+  TrackingOptions tracking_options_;
 };
 
 class CommandMonitor : public Commander {
@@ -1210,7 +1380,12 @@ class CommandApplyBatch : public Commander {
     return Commander::Parse(args);
   }
 
-  Status Execute(Server *svr, [[maybe_unused]] Connection *conn, std::string *output) override {
+  Status Execute(Server *svr, Connection *conn, std::string *output) override {
+    // the batch is a compressed frame if the source asks for compression on this connection
+    if (conn && conn->GetStreamCompression() != StreamCompression::kNone) {
+      raw_batch_ = GET_OR_RET(svr->stats.DecompressStreamFrame(raw_batch_));
+    }
+
     size_t size = raw_batch_.size();
     auto options = svr->storage->DefaultWriteOptions();
     options.low_pri = low_pri_;
@@ -1337,6 +1512,7 @@ REDIS_REGISTER_COMMANDS(Server, MakeCmdAttr<CommandAuth>("auth", 2, "read-only o
                         MakeCmdAttr<CommandDBSize>("dbsize", -1, "read-only", 0, 0, 0),
                         MakeCmdAttr<CommandSlowlog>("slowlog", -2, "read-only", 0, 0, 0),
                         MakeCmdAttr<CommandPerfLog>("perflog", -2, "read-only", 0, 0, 0),
+                        MakeCmdAttr<CommandLatency>("latency", -2, "read-only", 0, 0, 0),
                         MakeCmdAttr<CommandClient>("client", -2, "read-only", 0, 0, 0),
                         MakeCmdAttr<CommandMonitor>("monitor", 1, "read-only no-multi", 0, 0, 0),
                         MakeCmdAttr<CommandShutdown>("shutdown", 1, "read-only no-multi no-script", 0, 0, 0),
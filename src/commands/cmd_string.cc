@@ -40,9 +40,35 @@ class CommandGet : public Commander {
  public:
   Status Execute(Server *srv, Connection *conn, std::string *output) override {
     std::string value;
+    auto s = get(srv, conn, &value);
+    if (!s.ok() && !s.IsNotFound()) {
+      return {Status::RedisExecErr, s.ToString()};
+    }
+
+    *output = s.IsNotFound() ? conn->NilString() : redis::BulkString(value);
+    return Status::OK();
+  }
+
+  Status ExecuteWithReplyBuilder(Server *srv, Connection *conn, ReplyBuilder *builder) override {
+    std::string value;
+    auto s = get(srv, conn, &value);
+    if (!s.ok() && !s.IsNotFound()) {
+      return {Status::RedisExecErr, s.ToString()};
+    }
+
+    if (s.IsNotFound()) {
+      builder->NilString();
+    } else {
+      builder->BulkString(value);
+    }
+    return Status::OK();
+  }
+
+ private:
+  rocksdb::Status get(Server *srv, Connection *conn, std::string *value) const {
     redis::String string_db(srv->storage, conn->GetNamespace());
     engine::Context ctx(srv->storage);
-    auto s = string_db.Get(ctx, args_[1], &value);
+    auto s = string_db.Get(ctx, args_[1], value);
     // The IsInvalidArgument error means the key type maybe a bitmap
     // which we need to fall back to the bitmap's GetString according
     // to the `max-bitmap-to-string-mb` configuration.
@@ -50,14 +76,9 @@ class CommandGet : public Commander {
       Config *config = srv->GetConfig();
       uint32_t max_btos_size = static_cast<uint32_t>(config->max_bitmap_to_string_mb) * MiB;
       redis::Bitmap bitmap_db(srv->storage, conn->GetNamespace());
-      s = bitmap_db.GetString(ctx, args_[1], max_btos_size, &value);
-    }
-    if (!s.ok() && !s.IsNotFound()) {
-      return {Status::RedisExecErr, s.ToString()};
+      s = bitmap_db.GetString(ctx, args_[1], max_btos_size, value);
     }
-
-    *output = s.IsNotFound() ? conn->NilString() : redis::BulkString(value);
-    return Status::OK();
+    return s;
   }
 };
 
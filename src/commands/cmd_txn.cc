@@ -18,8 +18,11 @@
  *
  */
 
+#include <optional>
+
 #include "commander.h"
 #include "error_constants.h"
+#include "lock_manager.h"
 #include "scope_exit.h"
 #include "server/redis_connection.h"
 #include "server/redis_reply.h"
@@ -77,6 +80,18 @@ class CommandExec : public Commander {
     }
 
     auto storage = srv->storage;
+    // Lock the keys of the queued commands instead of running exclusively if possible,
+    // the writes are still applied at once by the transaction below
+    std::optional<HeldLockGuard> key_locks;
+    if (conn->CanExecWithKeyLocks()) {
+      std::vector<std::string> ns_keys;
+      ns_keys.reserve(conn->GetMultiExecKeys().size());
+      for (const auto &key : conn->GetMultiExecKeys()) {
+        ns_keys.emplace_back(ComposeNamespaceKey(conn->GetNamespace(), key, storage->IsSlotIdEncoded()));
+      }
+      key_locks.emplace(storage->GetLockManager(), ns_keys);
+    }
+
     // Reply multi length first
     conn->Reply(redis::MultiLen(conn->GetMultiExecCommands()->size()));
     // Execute multi-exec commands
@@ -86,6 +101,7 @@ class CommandExec : public Commander {
       conn->ExecuteCommands(conn->GetMultiExecCommands());
       s = storage->CommitTxn();
     }
+    if (s.IsOK()) conn->SendExecInvalidations();
     return s;
   }
 };
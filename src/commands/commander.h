@@ -66,6 +66,12 @@ enum CommandFlags : uint64_t {
   kCmdCluster = 1ULL << 11,        // "cluster" flag
   kCmdNoDBSizeCheck = 1ULL << 12,  // "no-dbsize-check" flag
   kCmdSlow = 1ULL << 13,           // "slow" flag
+  // generated for the exclusive scripts declaring their keys, which run holding the locks of the keys
+  // instead of the exclusivity guard if lua-key-locking-enabled
+  kCmdKeyLocking = 1ULL << 14,
+  // the command accesses the keys out of its key range, like MOVEX writing into another namespace,
+  // so it can't run holding only the locks of its keys
+  kCmdUnlistedKeys = 1ULL << 15,  // "unlisted-keys" flag
 };
 
 enum class CommandCategory : uint8_t {
@@ -104,6 +110,14 @@ class Commander {
                          [[maybe_unused]] std::string *output) {
     return {Status::RedisExecErr, errNotImplemented};
   }
+  // Execute the command and pass the reply to the builder. The hot commands of the scripts build their replies
+  // directly, the others fall back to the RESP output of Execute.
+  virtual Status ExecuteWithReplyBuilder(Server *srv, Connection *conn, ReplyBuilder *builder) {
+    std::string output;
+    auto s = Execute(srv, conn, &output);
+    if (s) builder->RESPReply(output);
+    return s;
+  }
 
   virtual ~Commander() = default;
 
@@ -178,6 +192,10 @@ struct CommandAttributes {
   // commander object generator
   CommanderFactory factory;
 
+  // the index of the command in the command table, assigned at registration,
+  // it's used to index the per-command statistics
+  size_t id = 0;
+
   auto GenerateFlags(const std::vector<std::string> &args) const {
     uint64_t res = flags;
     if (flag_gen) res = flag_gen(res, args);
@@ -242,6 +260,8 @@ inline uint64_t ParseCommandFlags(const std::string &description, const std::str
       flags |= kCmdNoDBSizeCheck;
     else if (flag == "slow")
       flags |= kCmdSlow;
+    else if (flag == "unlisted-keys")
+      flags |= kCmdUnlistedKeys;
     else {
       std::cout << fmt::format("Encountered non-existent flag '{}' in command {} in command attribute parsing", flag,
                                cmd_name)
@@ -37,6 +37,19 @@ namespace util {
 inline size_t RawPopcount(const uint8_t *p, int64_t count) {
   size_t bits = 0;
 
+  // independent accumulators over 32-byte blocks keep the popcounts out of one dependency chain,
+  // so they can be pipelined or vectorized by the compiler
+  size_t bits1 = 0, bits2 = 0, bits3 = 0;
+  for (; count >= 32; p += 32, count -= 32) {
+    uint64_t w[4];
+    __builtin_memcpy(w, p, sizeof(w));
+    bits += __builtin_popcountll(w[0]);
+    bits1 += __builtin_popcountll(w[1]);
+    bits2 += __builtin_popcountll(w[2]);
+    bits3 += __builtin_popcountll(w[3]);
+  }
+  bits += bits1 + bits2 + bits3;
+
   for (; count >= 8; p += 8, count -= 8) {
     bits += __builtin_popcountll(*reinterpret_cast<const uint64_t *>(p));
   }
@@ -0,0 +1,115 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "compression_util.h"
+
+#include <lz4.h>
+#include <zstd.h>
+
+#include "encoding.h"
+#include "string_util.h"
+
+namespace util {
+
+// favor the speed, since the streams are compressed on the fly
+constexpr int kZSTDLevel = 1;
+
+const char *StreamCompressionName(StreamCompression type) {
+  switch (type) {
+    case StreamCompression::kLZ4:
+      return "lz4";
+    case StreamCompression::kZSTD:
+      return "zstd";
+    default:
+      return "no";
+  }
+}
+
+StatusOr<StreamCompression> ParseStreamCompression(std::string_view name) {
+  if (EqualICase(name, "no")) return StreamCompression::kNone;
+  if (EqualICase(name, "lz4")) return StreamCompression::kLZ4;
+  if (EqualICase(name, "zstd")) return StreamCompression::kZSTD;
+  return {Status::NotOK, "unknown compression type"};
+}
+
+StatusOr<std::string> CompressFrame(StreamCompression type, std::string_view data) {
+  if (data.size() > kMaxStreamFrameRawSize) {
+    return {Status::NotOK, "data is too large to be framed"};
+  }
+
+  std::string frame(kStreamFrameHeaderSize, 0);
+  size_t compressed_size = 0;
+  if (type == StreamCompression::kLZ4) {
+    frame.resize(kStreamFrameHeaderSize + LZ4_compressBound(static_cast<int>(data.size())));
+    auto n = LZ4_compress_default(data.data(), frame.data() + kStreamFrameHeaderSize, static_cast<int>(data.size()),
+                                  static_cast<int>(frame.size() - kStreamFrameHeaderSize));
+    compressed_size = n > 0 ? n : 0;
+  } else if (type == StreamCompression::kZSTD) {
+    frame.resize(kStreamFrameHeaderSize + ZSTD_compressBound(data.size()));
+    auto n = ZSTD_compress(frame.data() + kStreamFrameHeaderSize, frame.size() - kStreamFrameHeaderSize, data.data(),
+                           data.size(), kZSTDLevel);
+    compressed_size = ZSTD_isError(n) ? 0 : n;
+  }
+
+  if (compressed_size == 0 || compressed_size >= data.size()) {
+    type = StreamCompression::kNone;
+    frame.resize(kStreamFrameHeaderSize);
+    frame.append(data);
+  } else {
+    frame.resize(kStreamFrameHeaderSize + compressed_size);
+  }
+
+  EncodeFixed8(frame.data(), static_cast<uint8_t>(type));
+  EncodeFixed32(frame.data() + 1, static_cast<uint32_t>(data.size()));
+  return frame;
+}
+
+StatusOr<std::string> DecompressFrame(std::string_view frame) {
+  if (frame.size() < kStreamFrameHeaderSize) {
+    return {Status::NotOK, "the frame is truncated"};
+  }
+
+  auto type = static_cast<StreamCompression>(DecodeFixed8(frame.data()));
+  size_t raw_size = DecodeFixed32(frame.data() + 1);
+  auto payload = frame.substr(kStreamFrameHeaderSize);
+  if (raw_size > kMaxStreamFrameRawSize) {
+    return {Status::NotOK, "the raw size of the frame is too large"};
+  }
+
+  std::string data;
+  if (type == StreamCompression::kNone) {
+    if (payload.size() != raw_size) return {Status::NotOK, "the size of the raw frame is mismatched"};
+    data.assign(payload);
+  } else if (type == StreamCompression::kLZ4) {
+    data.resize(raw_size);
+    auto n = LZ4_decompress_safe(payload.data(), data.data(), static_cast<int>(payload.size()),
+                                 static_cast<int>(raw_size));
+    if (n < 0 || static_cast<size_t>(n) != raw_size) return {Status::NotOK, "failed to decompress the lz4 frame"};
+  } else if (type == StreamCompression::kZSTD) {
+    data.resize(raw_size);
+    auto n = ZSTD_decompress(data.data(), raw_size, payload.data(), payload.size());
+    if (ZSTD_isError(n) || n != raw_size) return {Status::NotOK, "failed to decompress the zstd frame"};
+  } else {
+    return {Status::NotOK, "unknown compression type of the frame"};
+  }
+  return data;
+}
+
+}  // namespace util
@@ -0,0 +1,47 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "status.h"
+
+// The compression of the replication and migration streams, which is negotiated
+// per connection by `REPLCONF compression <type>`
+enum class StreamCompression : uint8_t { kNone = 0, kLZ4 = 1, kZSTD = 2 };
+
+namespace util {
+
+// A frame is [type: 1 byte][raw size: fixed32][payload]. The payload is kept raw
+// and the type is kNone if the compression doesn't make it smaller.
+constexpr size_t kStreamFrameHeaderSize = 5;
+// The raw size of a frame is bounded to reject malformed frames before allocating
+constexpr size_t kMaxStreamFrameRawSize = 1024 * 1024 * 1024;
+
+const char *StreamCompressionName(StreamCompression type);
+StatusOr<StreamCompression> ParseStreamCompression(std::string_view name);
+
+StatusOr<std::string> CompressFrame(StreamCompression type, std::string_view data);
+StatusOr<std::string> DecompressFrame(std::string_view frame);
+
+}  // namespace util
@@ -519,4 +519,20 @@ StatusOr<int> EvbufferRead(evbuffer *buf, evutil_socket_t fd, int howmuch, [[may
   }
 }
 
+StatusOr<int> SockReadAvailable(int fd, evbuffer *buf, [[maybe_unused]] bufferevent *bev) {
+  ssl_st *ssl = nullptr;
+  bool pending = false;
+#ifdef ENABLE_OPENSSL
+  ssl = bufferevent_openssl_get_ssl(bev);
+  // the SSL connection may have decrypted the data already
+  pending = ssl && SSL_pending(ssl) > 0;
+#endif
+  if (!pending) {
+    int mask = AeWait(fd, AE_READABLE, 0);
+    if (mask < 0) return {Status::NotOK, fmt::format("failed to poll the socket: {}", strerror(errno))};
+    if (mask == 0) return 0;
+  }
+  return EvbufferRead(buf, fd, -1, ssl);
+}
+
 }  // namespace util
@@ -59,5 +59,8 @@ Status SockSendFile(int out_fd, int in_fd, size_t size, bufferevent *bev);
 
 StatusOr<int> SockConnect(const std::string &host, uint32_t port, ssl_st *ssl, int conn_timeout = 0, int timeout = 0);
 StatusOr<int> EvbufferRead(evbuffer *buf, int fd, int howmuch, ssl_st *ssl);
+// Read the data which has arrived on the socket, or the SSL connection of the bufferevent, without blocking,
+// return the number of bytes read
+StatusOr<int> SockReadAvailable(int fd, evbuffer *buf, bufferevent *bev);
 
 }  // namespace util
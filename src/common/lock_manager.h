@@ -22,16 +22,99 @@
 
 #include <rocksdb/db.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <functional>
-#include <mutex>
-#include <set>
+#include <memory>
+#include <shared_mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
+enum class LockMode : uint8_t {
+  kShared,
+  kExclusive,
+};
+
+// The stripes to acquire for a group of keys, deduplicated and sorted by the stripe index.
+//
+// For example, we need lock the key `A` and `B` and they have the same lock hash
+// index, it will be deadlock if lock the same stripe twice. Besides, we also need
+// to order the stripes before acquiring locks since different threads may acquire
+// same keys with different order. A stripe is locked in the exclusive mode
+// if any of its keys asks for it.
+//
+// The stripes of a few keys are kept in an inline array, so the common multi-key
+// commands don't allocate, and only the larger groups spill into the heap.
+class LockIndexes {
+ public:
+  using Entry = std::pair<unsigned, LockMode>;
+
+  LockIndexes() = default;
+
+  void Insert(unsigned index, LockMode mode) {
+    Entry *first = data();
+    Entry *last = first + size_;
+    Entry *pos = std::lower_bound(first, last, index, [](const Entry &e, unsigned i) { return e.first < i; });
+    if (pos != last && pos->first == index) {
+      if (mode == LockMode::kExclusive) pos->second = mode;
+      return;
+    }
+
+    size_t offset = pos - first;
+    if (size_ == kInlineSize) {
+      spilled_.assign(inline_.begin(), inline_.end());
+    }
+    if (size_ >= kInlineSize) {
+      spilled_.insert(spilled_.begin() + static_cast<std::ptrdiff_t>(offset), {index, mode});
+    } else {
+      std::move_backward(pos, last, last + 1);
+      *pos = {index, mode};
+    }
+    size_++;
+  }
+
+  bool Contains(unsigned index) const {
+    const Entry *first = data();
+    const Entry *last = first + size_;
+    const Entry *pos = std::lower_bound(first, last, index, [](const Entry &e, unsigned i) { return e.first < i; });
+    return pos != last && pos->first == index;
+  }
+
+  size_t Size() const { return size_; }
+  const Entry *begin() const { return data(); }
+  const Entry *end() const { return data() + size_; }
+
+ private:
+  static constexpr size_t kInlineSize = 8;
+
+  std::array<Entry, kInlineSize> inline_;
+  std::vector<Entry> spilled_;
+  size_t size_ = 0;
+
+  Entry *data() { return size_ > kInlineSize ? spilled_.data() : inline_.data(); }
+  const Entry *data() const { return size_ > kInlineSize ? spilled_.data() : inline_.data(); }
+};
+
 class LockManager {
  public:
+  struct StripeStats {
+    unsigned index;
+    uint64_t acquired;
+    uint64_t contended;
+  };
+
+  struct Stats {
+    uint64_t acquired = 0;
+    uint64_t contended = 0;
+    // the stripes waited on the most, in the descending order of the contended count
+    std::vector<StripeStats> hot_stripes;
+  };
+
   explicit LockManager(unsigned hash_power)
-      : hash_power_(hash_power), hash_mask_((1U << hash_power) - 1), mutex_pool_(Size()) {}
+      : hash_power_(hash_power), hash_mask_((1U << hash_power) - 1), stripes_(Size()) {}
   ~LockManager() = default;
 
   LockManager(const LockManager &) = delete;
@@ -39,60 +122,120 @@ class LockManager {
 
   unsigned Size() const { return (1U << hash_power_); }
 
-  void Lock(std::string_view key) { mutex_pool_[hash(key)].lock(); }
-  void UnLock(std::string_view key) { mutex_pool_[hash(key)].unlock(); }
-  void Lock(rocksdb::Slice key) { Lock(key.ToStringView()); }
-  void UnLock(rocksdb::Slice key) { UnLock(key.ToStringView()); }
+  void Lock(std::string_view key, LockMode mode = LockMode::kExclusive) { LockIndex(Index(key), mode); }
+  void UnLock(std::string_view key, LockMode mode = LockMode::kExclusive) { UnLockIndex(Index(key), mode); }
+  void Lock(rocksdb::Slice key, LockMode mode = LockMode::kExclusive) { Lock(key.ToStringView(), mode); }
+  void UnLock(rocksdb::Slice key, LockMode mode = LockMode::kExclusive) { UnLock(key.ToStringView(), mode); }
 
-  template <typename Key>
-  std::mutex *Get(const Key &key) {
-    return &mutex_pool_[hash(key)];
+  unsigned Index(std::string_view key) const { return std::hash<std::string_view>{}(key)&hash_mask_; }
+
+  // An uncontended stripe is taken by the try-lock alone, which is a single atomic operation
+  // on the stripe without blocking; only a stripe held in a conflicting mode by another thread
+  // is counted as contended and waited on. The stripes held by the current thread through
+  // HeldLockGuard are skipped.
+  void LockIndex(unsigned index, LockMode mode) {
+    if (isHeldByCurrentThread(index)) return;
+
+    auto &stripe = stripes_[index];
+    bool locked = mode == LockMode::kExclusive ? stripe.mutex.try_lock() : stripe.mutex.try_lock_shared();
+    if (!locked) {
+      stripe.contended.fetch_add(1, std::memory_order_relaxed);
+      if (mode == LockMode::kExclusive) {
+        stripe.mutex.lock();
+      } else {
+        stripe.mutex.lock_shared();
+      }
+    }
+    stripe.acquired.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void UnLockIndex(unsigned index, LockMode mode) {
+    if (isHeldByCurrentThread(index)) return;
+
+    if (mode == LockMode::kExclusive) {
+      stripes_[index].mutex.unlock();
+    } else {
+      stripes_[index].mutex.unlock_shared();
+    }
   }
 
   template <typename Keys>
-  std::vector<std::mutex *> MultiGet(const Keys &keys) {
-    std::set<unsigned, std::greater<unsigned>> to_acquire_indexes;
-    // We are using the `set` to avoid retrieving the mutex, as well as guarantee to retrieve
-    // the order of locks.
-    //
-    // For example, we need lock the key `A` and `B` and they have the same lock hash
-    // index, it will be deadlock if lock the same mutex twice. Besides, we also need
-    // to order the mutex before acquiring locks since different threads may acquire
-    // same keys with different order.
+  LockIndexes MultiGet(const Keys &keys, LockMode mode = LockMode::kExclusive) const {
+    LockIndexes indexes;
+    MultiGet(keys, mode, &indexes);
+    return indexes;
+  }
+
+  template <typename Keys>
+  void MultiGet(const Keys &keys, LockMode mode, LockIndexes *indexes) const {
     for (const auto &key : keys) {
-      to_acquire_indexes.insert(hash(key));
+      indexes->Insert(Index(key), mode);
     }
+  }
 
-    std::vector<std::mutex *> locks;
-    locks.reserve(to_acquire_indexes.size());
-    for (auto index : to_acquire_indexes) {
-      locks.emplace_back(&mutex_pool_[index]);
+  Stats GetStats(size_t hot_stripes_count) const {
+    Stats stats;
+    for (unsigned i = 0; i < Size(); i++) {
+      uint64_t acquired = stripes_[i].acquired.load(std::memory_order_relaxed);
+      uint64_t contended = stripes_[i].contended.load(std::memory_order_relaxed);
+      stats.acquired += acquired;
+      stats.contended += contended;
+      if (contended > 0) stats.hot_stripes.push_back({i, acquired, contended});
     }
-    return locks;
+
+    auto by_contention = [](const StripeStats &a, const StripeStats &b) { return a.contended > b.contended; };
+    if (stats.hot_stripes.size() > hot_stripes_count) {
+      std::partial_sort(stats.hot_stripes.begin(),
+                        stats.hot_stripes.begin() + static_cast<std::ptrdiff_t>(hot_stripes_count),
+                        stats.hot_stripes.end(), by_contention);
+      stats.hot_stripes.resize(hot_stripes_count);
+    } else {
+      std::sort(stats.hot_stripes.begin(), stats.hot_stripes.end(), by_contention);
+    }
+    return stats;
   }
 
  private:
+  friend class HeldLockGuard;
+
+  // padded to a cache line, so the threads working on the neighbouring stripes don't
+  // invalidate each other's cache lines
+  struct alignas(64) Stripe {
+    std::shared_mutex mutex;
+    std::atomic<uint64_t> acquired{0};
+    std::atomic<uint64_t> contended{0};
+  };
+
   unsigned hash_power_;
   unsigned hash_mask_;
-  std::vector<std::mutex> mutex_pool_;
+  std::vector<Stripe> stripes_;
+
+  // the stripes held by the current thread across several commands, see HeldLockGuard
+  inline static thread_local const LockManager *held_lock_mgr_ = nullptr;
+  inline static thread_local const LockIndexes *held_indexes_ = nullptr;
 
-  unsigned hash(std::string_view key) const { return std::hash<std::string_view>{}(key)&hash_mask_; }
+  bool isHeldByCurrentThread(unsigned index) const {
+    return held_lock_mgr_ == this && held_indexes_->Contains(index);
+  }
 };
 
 class LockGuard {
  public:
   template <typename KeyType>
-  explicit LockGuard(LockManager *lock_mgr, const KeyType &key) : lock_(lock_mgr->Get(key)) {
-    lock_->lock();
+  explicit LockGuard(LockManager *lock_mgr, const KeyType &key, LockMode mode = LockMode::kExclusive)
+      : lock_mgr_(lock_mgr), index_(lock_mgr->Index(key)), mode_(mode) {
+    lock_mgr_->LockIndex(index_, mode_);
   }
   ~LockGuard() {
-    if (lock_) lock_->unlock();
+    if (lock_mgr_) lock_mgr_->UnLockIndex(index_, mode_);
   }
 
   LockGuard(const LockGuard &) = delete;
   LockGuard &operator=(const LockGuard &) = delete;
 
-  LockGuard(LockGuard &&guard) noexcept : lock_(guard.lock_) { guard.lock_ = nullptr; }
+  LockGuard(LockGuard &&guard) noexcept : lock_mgr_(guard.lock_mgr_), index_(guard.index_), mode_(guard.mode_) {
+    guard.lock_mgr_ = nullptr;
+  }
 
   LockGuard &operator=(LockGuard &&other) noexcept {
     if (&other != this) {
@@ -103,30 +246,72 @@ class LockGuard {
   }
 
  private:
-  std::mutex *lock_{nullptr};
+  LockManager *lock_mgr_{nullptr};
+  unsigned index_{0};
+  LockMode mode_{LockMode::kExclusive};
 };
 
 class MultiLockGuard {
  public:
   template <typename Keys>
-  explicit MultiLockGuard(LockManager *lock_mgr, const Keys &keys) : locks_(lock_mgr->MultiGet(keys)) {
-    for (const auto &iter : locks_) {
-      iter->lock();
-    }
+  explicit MultiLockGuard(LockManager *lock_mgr, const Keys &keys, LockMode mode = LockMode::kExclusive)
+      : lock_mgr_(lock_mgr), indexes_(lock_mgr->MultiGet(keys, mode)) {
+    lock();
+  }
+
+  MultiLockGuard(LockManager *lock_mgr, LockIndexes indexes) : lock_mgr_(lock_mgr), indexes_(std::move(indexes)) {
+    lock();
   }
 
   ~MultiLockGuard() {
+    if (!lock_mgr_) return;
     // Lock with order `A B C` and unlock should be `C B A`
-    for (auto iter = locks_.rbegin(); iter != locks_.rend(); ++iter) {
-      (*iter)->unlock();
+    for (auto iter = indexes_.end(); iter != indexes_.begin();) {
+      --iter;
+      lock_mgr_->UnLockIndex(iter->first, iter->second);
     }
   }
 
   MultiLockGuard(const MultiLockGuard &) = delete;
   MultiLockGuard &operator=(const MultiLockGuard &) = delete;
 
-  MultiLockGuard(MultiLockGuard &&guard) : locks_(std::move(guard.locks_)) {}
+  MultiLockGuard(MultiLockGuard &&guard) noexcept : lock_mgr_(guard.lock_mgr_), indexes_(std::move(guard.indexes_)) {
+    guard.lock_mgr_ = nullptr;
+  }
+
+ private:
+  LockManager *lock_mgr_{nullptr};
+  LockIndexes indexes_;
+
+  void lock() {
+    for (const auto &[index, mode] : indexes_) {
+      lock_mgr_->LockIndex(index, mode);
+    }
+  }
+};
+
+// HeldLockGuard locks the keys exclusively like MultiLockGuard, and keeps them held by the current
+// thread until it's destroyed, so the commands run by the thread in the meantime, e.g. the commands
+// called by a Lua script which declares these keys, skip locking them again instead of deadlocking.
+// The stripes not held by the guard are locked by the commands as usual, so the holder should only
+// access the keys it locked.
+class HeldLockGuard {
+ public:
+  template <typename Keys>
+  HeldLockGuard(LockManager *lock_mgr, const Keys &keys)
+      : indexes_(lock_mgr->MultiGet(keys)), guard_(lock_mgr, indexes_) {
+    LockManager::held_lock_mgr_ = lock_mgr;
+    LockManager::held_indexes_ = &indexes_;
+  }
+  ~HeldLockGuard() {
+    LockManager::held_lock_mgr_ = nullptr;
+    LockManager::held_indexes_ = nullptr;
+  }
+
+  HeldLockGuard(const HeldLockGuard &) = delete;
+  HeldLockGuard &operator=(const HeldLockGuard &) = delete;
 
  private:
-  std::vector<std::mutex *> locks_;
+  LockIndexes indexes_;
+  MultiLockGuard guard_;
 };
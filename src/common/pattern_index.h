@@ -0,0 +1,163 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "string_util.h"
+
+// PatternIndex maps glob-style patterns (the same syntax as util::StringMatch) to values
+// and finds all patterns matching a subject without trying every pattern.
+//
+// Patterns are compiled on insertion and kept in a trie keyed by their literal prefix,
+// i.e. the characters before the first `*`, `?`, `[` or `\`. A lookup walks the subject
+// down the trie, so only the patterns whose literal prefix is a prefix of the subject
+// are considered. Among those, a pattern without wildcards or one ending with only `*`
+// after its prefix is decided right away, and only the others fall back to the glob
+// matcher, which then runs on the remaining part of the pattern.
+template <typename T>
+class PatternIndex {
+ public:
+  PatternIndex() : root_(std::make_unique<Node>()) {}
+
+  // Returns the value of the pattern, inserting a default one if the pattern is new.
+  T &operator[](const std::string &pattern) {
+    auto prefix_len = literalPrefixLength(pattern);
+    Node *node = root_.get();
+    for (size_t i = 0; i < prefix_len; i++) {
+      auto &child = node->children[pattern[i]];
+      if (!child) child = std::make_unique<Node>();
+      node = child.get();
+    }
+
+    auto [iter, inserted] = node->entries.try_emplace(pattern);
+    if (inserted) {
+      iter->second.kind = compile(pattern, prefix_len);
+      size_++;
+    }
+    return iter->second.value;
+  }
+
+  T *Find(const std::string &pattern) {
+    Node *node = findNode(pattern, nullptr);
+    if (!node) return nullptr;
+
+    auto iter = node->entries.find(pattern);
+    return iter == node->entries.end() ? nullptr : &iter->second.value;
+  }
+
+  // Removes the pattern and prunes the trie nodes which become empty.
+  bool Erase(const std::string &pattern) {
+    std::vector<Node *> path;
+    Node *node = findNode(pattern, &path);
+    if (!node || node->entries.erase(pattern) == 0) return false;
+    size_--;
+
+    auto prefix_len = path.size() - 1;
+    for (size_t i = prefix_len; i > 0 && path[i]->entries.empty() && path[i]->children.empty(); i--) {
+      path[i - 1]->children.erase(pattern[i - 1]);
+    }
+    return true;
+  }
+
+  // Calls `fn(pattern, value)` for each pattern matching the subject.
+  template <typename Fn>
+  void Match(std::string_view subject, Fn &&fn) const {
+    const Node *node = root_.get();
+    for (size_t depth = 0; node; depth++) {
+      for (const auto &[pattern, entry] : node->entries) {
+        if (matchEntry(pattern, entry.kind, depth, subject)) fn(pattern, entry.value);
+      }
+      if (depth == subject.size()) break;
+
+      auto iter = node->children.find(subject[depth]);
+      node = iter == node->children.end() ? nullptr : iter->second.get();
+    }
+  }
+
+  size_t Size() const { return size_; }
+  bool Empty() const { return size_ == 0; }
+
+ private:
+  enum class Kind {
+    kLiteral,  // no wildcards, matches only the subject equal to the pattern
+    kPrefix,   // the literal prefix followed by `*`s, matches any subject with the prefix
+    kGlob,     // matches if the rest of the pattern globs the rest of the subject
+  };
+
+  struct Entry {
+    Kind kind = Kind::kLiteral;
+    T value;
+  };
+
+  struct Node {
+    std::map<char, std::unique_ptr<Node>> children;
+    std::map<std::string, Entry> entries;
+  };
+
+  static size_t literalPrefixLength(const std::string &pattern) {
+    auto pos = pattern.find_first_of("*?[\\");
+    return pos == std::string::npos ? pattern.size() : pos;
+  }
+
+  static Kind compile(const std::string &pattern, size_t prefix_len) {
+    if (prefix_len == pattern.size()) return Kind::kLiteral;
+    if (pattern.find_first_not_of('*', prefix_len) == std::string::npos) return Kind::kPrefix;
+    return Kind::kGlob;
+  }
+
+  // The literal prefix of every pattern at `depth` already matched the subject.
+  static bool matchEntry(const std::string &pattern, Kind kind, size_t depth, std::string_view subject) {
+    switch (kind) {
+      case Kind::kLiteral:
+        return depth == subject.size();
+      case Kind::kPrefix:
+        // Same as util::StringMatch, which never matches an empty subject
+        return !subject.empty();
+      case Kind::kGlob:
+        return util::StringMatchLen(pattern.data() + depth, pattern.size() - depth, subject.data() + depth,
+                                    subject.size() - depth, 0);
+    }
+    return false;
+  }
+
+  Node *findNode(const std::string &pattern, std::vector<Node *> *path) {
+    auto prefix_len = literalPrefixLength(pattern);
+    Node *node = root_.get();
+    if (path) path->emplace_back(node);
+    for (size_t i = 0; i < prefix_len; i++) {
+      auto iter = node->children.find(pattern[i]);
+      if (iter == node->children.end()) return nullptr;
+      node = iter->second.get();
+      if (path) path->emplace_back(node);
+    }
+    return node;
+  }
+
+  std::unique_ptr<Node> root_;
+  size_t size_ = 0;
+};
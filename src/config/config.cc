@@ -35,6 +35,7 @@
 #include <utility>
 #include <vector>
 
+#include "compression_util.h"
 #include "config_type.h"
 #include "config_util.h"
 #include "parse_util.h"
@@ -67,7 +68,8 @@ const std::vector<ConfigEnum<int>> log_levels{
 };
 
 const std::vector<ConfigEnum<JsonStorageFormat>> json_storage_formats{{"json", JsonStorageFormat::JSON},
-                                                                      {"cbor", JsonStorageFormat::CBOR}};
+                                                                      {"cbor", JsonStorageFormat::CBOR},
+                                                                      {"shredded", JsonStorageFormat::SHREDDED}};
 
 const std::vector<ConfigEnum<rocksdb::CompressionType>> compression_types{[] {
   std::vector<ConfigEnum<rocksdb::CompressionType>> res;
@@ -88,7 +90,14 @@ const std::vector<ConfigEnum<BlockCacheType>> cache_types{[] {
 }()};
 
 const std::vector<ConfigEnum<MigrationType>> migration_types{{"redis-command", MigrationType::kRedisCommand},
-                                                             {"raw-key-value", MigrationType::kRawKeyValue}};
+                                                             {"raw-key-value", MigrationType::kRawKeyValue},
+                                                             {"raw-sst", MigrationType::kRawSST}};
+
+const std::vector<ConfigEnum<StreamCompression>> stream_compression_types{
+    {"no", StreamCompression::kNone},
+    {"lz4", StreamCompression::kLZ4},
+    {"zstd", StreamCompression::kZSTD},
+};
 
 std::string TrimRocksDbPrefix(std::string s) {
   if (strncasecmp(s.data(), "rocksdb.", 8) != 0) return s;
@@ -130,6 +139,7 @@ Config::Config() {
       {"timeout", false, new IntField(&timeout, 0, 0, INT_MAX)},
       {"tcp-backlog", true, new IntField(&backlog, 511, 0, INT_MAX)},
       {"maxclients", false, new IntField(&maxclients, 10240, 0, INT_MAX)},
+      {"tracking-table-max-keys", false, new IntField(&tracking_table_max_keys, 1000000, 0, INT_MAX)},
       {"max-backup-to-keep", false, new IntField(&max_backup_to_keep, 1, 0, 1)},
       {"max-backup-keep-hours", false, new IntField(&max_backup_keep_hours, 0, 0, INT_MAX)},
       {"master-use-repl-port", false, new YesNoField(&master_use_repl_port, false)},
@@ -146,6 +156,7 @@ Config::Config() {
       {"force-compact-file-age", false, new Int64Field(&force_compact_file_age, 2 * 24 * 3600, 60, INT64_MAX)},
       {"force-compact-file-min-deleted-percentage", false,
        new IntField(&force_compact_file_min_deleted_percentage, 10, 1, 100)},
+      {"active-expire-keys-per-cycle", false, new IntField(&active_expire_keys_per_cycle, 100, 0, INT_MAX)},
       {"db-name", true, new StringField(&db_name, "change.me.db")},
       {"dir", true, new StringField(&dir, kDefaultDir)},
       {"backup-dir", false, new StringField(&backup_dir, kDefaultBackupDir)},
@@ -154,8 +165,12 @@ Config::Config() {
       {"pidfile", true, new StringField(&pidfile, kDefaultPidfile)},
       {"max-io-mb", false, new IntField(&max_io_mb, 0, 0, INT_MAX)},
       {"max-bitmap-to-string-mb", false, new IntField(&max_bitmap_to_string_mb, 16, 0, INT_MAX)},
+      {"bitmap-summary-enabled", false, new YesNoField(&bitmap_summary_enabled, false)},
+      {"bitmap-compression-enabled", false, new YesNoField(&bitmap_compression_enabled, false)},
       {"max-db-size", false, new IntField(&max_db_size, 0, 0, INT_MAX)},
       {"max-replication-mb", false, new IntField(&max_replication_mb, 0, 0, INT_MAX)},
+      {"replication-compression", false,
+       new EnumField<StreamCompression>(&replication_compression, stream_compression_types, StreamCompression::kNone)},
       {"supervised", true, new EnumField<SupervisedMode>(&supervised_mode, supervised_modes, kSupervisedNone)},
       {"slave-serve-stale-data", false, new YesNoField(&slave_serve_stale_data, true)},
       {"slave-empty-db-before-fullsync", false, new YesNoField(&slave_empty_db_before_fullsync, false)},
@@ -169,6 +184,7 @@ Config::Config() {
       {"slowlog-log-slower-than", false, new IntField(&slowlog_log_slower_than, 200000, -1, INT_MAX)},
       {"profiling-sample-commands", false, new StringField(&profiling_sample_commands_str_, "")},
       {"slowlog-max-len", false, new IntField(&slowlog_max_len, 128, 0, INT_MAX)},
+      {"latency-monitor-threshold", false, new IntField(&latency_monitor_threshold, 0, 0, INT_MAX)},
       {"purge-backup-on-fullsync", false, new YesNoField(&purge_backup_on_fullsync, false)},
       {"rename-command", true, new MultiStringField(&rename_command_, std::vector<std::string>{})},
       {"auto-resize-block-and-sst", false, new YesNoField(&auto_resize_block_and_sst, true)},
@@ -181,6 +197,11 @@ Config::Config() {
        new EnumField<MigrationType>(&migrate_type, migration_types, MigrationType::kRedisCommand)},
       {"migrate-batch-size-kb", false, new IntField(&migrate_batch_size_kb, 16, 1, INT_MAX)},
       {"migrate-batch-rate-limit-mb", false, new IntField(&migrate_batch_rate_limit_mb, 16, 0, INT_MAX)},
+      {"migrate-batch-window", false, new IntField(&migrate_batch_window, 16, 1, 1024)},
+      {"migrate-snapshot-streams", false, new IntField(&migrate_snapshot_streams, 1, 1, 16)},
+      {"migrate-batch-compression", false,
+       new EnumField<StreamCompression>(&migrate_batch_compression, stream_compression_types,
+                                        StreamCompression::kNone)},
       {"unixsocket", true, new StringField(&unixsocket, "")},
       {"unixsocketperm", true, new OctalField(&unixsocketperm, 0777, 1, INT_MAX)},
       {"log-retention-days", false, new IntField(&log_retention_days, -1, -1, INT_MAX)},
@@ -190,10 +211,17 @@ Config::Config() {
       {"repl-namespace-enabled", false, new YesNoField(&repl_namespace_enabled, false)},
       {"proto-max-bulk-len", false,
        new IntWithUnitField<uint64_t>(&proto_max_bulk_len, std::to_string(512 * MiB), 1 * MiB, UINT64_MAX)},
+      {"list-chunk-size", false, new IntField(&list_chunk_size, 0, 0, 65536)},
+      {"zset-rank-index-threshold", false, new IntField(&zset_rank_index_threshold, 0, 0, INT_MAX)},
       {"json-max-nesting-depth", false, new IntField(&json_max_nesting_depth, 1024, 0, INT_MAX)},
       {"json-storage-format", false,
        new EnumField<JsonStorageFormat>(&json_storage_format, json_storage_formats, JsonStorageFormat::JSON)},
+      {"json-shred-threshold", false, new IntField(&json_shred_threshold, 16384, 0, INT_MAX)},
+      {"hnsw-cache-size", false, new IntField(&hnsw_cache_size, 0, 0, INT_MAX)},
+      {"search-executor-threads", true, new IntField(&search_executor_threads, 0, 0, 256)},
       {"txn-context-enabled", true, new YesNoField(&txn_context_enabled, false)},
+      {"lua-key-locking-enabled", false, new YesNoField(&lua_key_locking_enabled, false)},
+      {"txn-key-locking-enabled", false, new YesNoField(&txn_key_locking_enabled, false)},
 
       /* rocksdb options */
       {"rocksdb.compression", false,
@@ -457,6 +485,12 @@ void Config::initFieldCallback() {
              srv->AdjustOpenFilesLimit();
              return Status::OK();
            }},
+          {"tracking-table-max-keys",
+           [this](Server *srv, [[maybe_unused]] const std::string &k, [[maybe_unused]] const std::string &v) -> Status {
+             if (!srv) return Status::OK();
+             SendInvalidations(srv->tracking.SetMaxKeys(static_cast<size_t>(tracking_table_max_keys)));
+             return Status::OK();
+           }},
           {"slaveof",
            [this]([[maybe_unused]] Server *srv, [[maybe_unused]] const std::string &k, const std::string &v) -> Status {
              if (v.empty()) {
@@ -499,12 +533,24 @@ void Config::initFieldCallback() {
              srv->GetSlowLog()->SetMaxEntries(slowlog_max_len);
              return Status::OK();
            }},
+          {"latency-monitor-threshold",
+           [this](Server *srv, [[maybe_unused]] const std::string &k, [[maybe_unused]] const std::string &v) -> Status {
+             if (!srv) return Status::OK();
+             srv->storage->GetLatencyMonitor()->SetThreshold(latency_monitor_threshold);
+             return Status::OK();
+           }},
           {"max-db-size",
            [](Server *srv, [[maybe_unused]] const std::string &k, [[maybe_unused]] const std::string &v) -> Status {
              if (!srv) return Status::OK();
              srv->storage->CheckDBSizeLimit();
              return Status::OK();
            }},
+          {"hnsw-cache-size",
+           [this](Server *srv, [[maybe_unused]] const std::string &k, [[maybe_unused]] const std::string &v) -> Status {
+             if (!srv) return Status::OK();
+             srv->indexer.hnsw_cache.SetCapacity(static_cast<size_t>(hnsw_cache_size) * MiB);
+             return Status::OK();
+           }},
           {"max-io-mb",
            [this](Server *srv, [[maybe_unused]] const std::string &k, [[maybe_unused]] const std::string &v) -> Status {
              if (!srv) return Status::OK();
@@ -547,6 +593,18 @@ void Config::initFieldCallback() {
              srv->slot_migrator->SetMigrateBatchSize(migrate_batch_size_kb * KiB);
              return Status::OK();
            }},
+          {"migrate-batch-window",
+           [this](Server *srv, [[maybe_unused]] const std::string &k, [[maybe_unused]] const std::string &v) -> Status {
+             if (!srv) return Status::OK();
+             srv->slot_migrator->SetMigrateBatchWindow(migrate_batch_window);
+             return Status::OK();
+           }},
+          {"migrate-snapshot-streams",
+           [this](Server *srv, [[maybe_unused]] const std::string &k, [[maybe_unused]] const std::string &v) -> Status {
+             if (!srv) return Status::OK();
+             srv->slot_migrator->SetMigrateSnapshotStreams(migrate_snapshot_streams);
+             return Status::OK();
+           }},
           {"log-level",
            [this](Server *srv, [[maybe_unused]] const std::string &k, [[maybe_unused]] const std::string &v) -> Status {
              if (!srv) return Status::OK();
@@ -721,6 +779,10 @@ void Config::initFieldCallback() {
 
 std::string Config::NodesFilePath() const { return dir + "/nodes.conf"; }
 
+std::string Config::MigrateSSTDir() const { return dir + "/migrate_sst"; }
+
+std::string Config::ImportSSTDir() const { return dir + "/import_sst"; }
+
 void Config::SetMaster(const std::string &host, uint32_t port) {
   master_host = host;
   master_port = port;
@@ -37,6 +37,7 @@
 // forward declaration
 class Server;
 enum class MigrationType;
+enum class StreamCompression : uint8_t;
 namespace engine {
 class Storage;
 }
@@ -92,10 +93,12 @@ struct Config {
   int log_level = 0;
   int backlog = 511;
   int maxclients = 10000;
+  int tracking_table_max_keys = 1000000;
   int max_backup_to_keep = 1;
   int max_backup_keep_hours = 24;
   int slowlog_log_slower_than = 100000;
   int slowlog_max_len = 128;
+  int latency_monitor_threshold = 0;
   uint64_t proto_max_bulk_len = 512 * 1024 * 1024;
   bool daemonize = false;
   SupervisedMode supervised_mode = kSupervisedNone;
@@ -105,8 +108,11 @@ struct Config {
   int slave_priority = 100;
   int max_db_size = 0;
   int max_replication_mb = 0;
+  StreamCompression replication_compression;
   int max_io_mb = 0;
   int max_bitmap_to_string_mb = 16;
+  bool bitmap_summary_enabled = false;
+  bool bitmap_compression_enabled = false;
   bool master_use_repl_port = false;
   bool purge_backup_on_fullsync = false;
   bool auto_resize_block_and_sst = true;
@@ -134,6 +140,7 @@ struct Config {
   Cron compaction_checker_cron;
   int64_t force_compact_file_age;
   int force_compact_file_min_deleted_percentage;
+  int active_expire_keys_per_cycle;
   bool repl_namespace_enabled = false;
   std::string replica_announce_ip;
   uint32_t replica_announce_port = 0;
@@ -148,6 +155,9 @@ struct Config {
   MigrationType migrate_type;
   int migrate_batch_size_kb;
   int migrate_batch_rate_limit_mb;
+  int migrate_batch_window;
+  int migrate_snapshot_streams;
+  StreamCompression migrate_batch_compression;
 
   bool redis_cursor_compatible = false;
   bool resp3_enabled = false;
@@ -164,13 +174,28 @@ struct Config {
   std::set<std::string> profiling_sample_commands;
   bool profiling_sample_all_commands = false;
 
+  // list
+  int list_chunk_size = 0;
+
+  // zset
+  int zset_rank_index_threshold = 0;
+
   // json
   int json_max_nesting_depth = 1024;
   JsonStorageFormat json_storage_format = JsonStorageFormat::JSON;
+  int json_shred_threshold = 16384;
+  int hnsw_cache_size = 0;
+  int search_executor_threads = 0;
 
   // Enable transactional mode in engine::Context
   bool txn_context_enabled = false;
 
+  // Run the Lua scripts declaring their keys with the locks of the keys instead of exclusively
+  bool lua_key_locking_enabled = false;
+
+  // Run the transactions of MULTI/EXEC with the locks of their keys instead of exclusively
+  bool txn_key_locking_enabled = false;
+
   struct RocksDB {
     int block_size;
     bool cache_index_and_filter_blocks;
@@ -229,6 +254,9 @@ struct Config {
   mutable std::mutex backup_mu;
 
   std::string NodesFilePath() const;
+  // The SST files of the slots being migrated out or imported, see the raw-sst migrate-type
+  std::string MigrateSSTDir() const;
+  std::string ImportSSTDir() const;
   Status Rewrite(const std::map<std::string, std::string> &tokens);
   Status Load(const CLIOptions &path);
   void Get(const std::string &key, std::vector<std::string> *values) const;
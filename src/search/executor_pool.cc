@@ -0,0 +1,109 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "executor_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace kqir {
+
+ExecutorPool::ExecutorPool(size_t n_threads) {
+  threads_.reserve(n_threads);
+  for (size_t i = 0; i < n_threads; i++) {
+    threads_.emplace_back([this] { run(); });
+  }
+}
+
+ExecutorPool::~ExecutorPool() {
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    stop_ = true;
+  }
+  cond_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+void ExecutorPool::ParallelFor(size_t n, const std::function<void(size_t)> &fn) {
+  if (n == 0) return;
+
+  // The helpers may only start after all the work is claimed, so they share the state with the caller
+  // and never touch fn unless they claimed an index, which the caller is still waiting for.
+  struct State {
+    const std::function<void(size_t)> *fn;
+    size_t n;
+    std::atomic<size_t> next{0};
+    std::mutex mu;
+    std::condition_variable cond;
+    size_t done = 0;
+  };
+  auto state = std::make_shared<State>();
+  state->fn = &fn;
+  state->n = n;
+
+  auto work = [state] {
+    size_t finished = 0;
+    for (auto i = state->next.fetch_add(1); i < state->n; i = state->next.fetch_add(1)) {
+      (*state->fn)(i);
+      finished++;
+    }
+    if (finished == 0) return;
+
+    std::lock_guard<std::mutex> guard(state->mu);
+    state->done += finished;
+    if (state->done == state->n) state->cond.notify_all();
+  };
+
+  auto helpers = std::min(n - 1, threads_.size());
+  if (helpers > 0) {
+    {
+      std::lock_guard<std::mutex> guard(mu_);
+      for (size_t i = 0; i < helpers; i++) tasks_.emplace_back(work);
+    }
+    if (helpers == 1) {
+      cond_.notify_one();
+    } else {
+      cond_.notify_all();
+    }
+  }
+
+  work();
+  std::unique_lock<std::mutex> lock(state->mu);
+  state->cond.wait(lock, [&] { return state->done == state->n; });
+}
+
+void ExecutorPool::run() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      cond_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+      if (stop_ && tasks_.empty()) return;
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+}  // namespace kqir
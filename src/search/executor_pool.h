@@ -0,0 +1,59 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kqir {
+
+// ExecutorPool is a fixed set of worker threads shared by the plan executors of all queries,
+// which split the rows of a batch into partitions and process them in parallel.
+class ExecutorPool {
+ public:
+  explicit ExecutorPool(size_t n_threads);
+  ~ExecutorPool();
+
+  ExecutorPool(const ExecutorPool &) = delete;
+  ExecutorPool &operator=(const ExecutorPool &) = delete;
+
+  size_t Size() const { return threads_.size(); }
+
+  // Runs fn(i) for every i in [0, n) and returns once all of them are done. The calling thread
+  // takes part as well, so a query still makes progress when the workers are busy with others.
+  void ParallelFor(size_t n, const std::function<void(size_t)> &fn);
+
+ private:
+  void run();
+
+  std::mutex mu_;
+  std::condition_variable cond_;
+  std::deque<std::function<void()>> tasks_;
+  bool stop_ = false;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace kqir
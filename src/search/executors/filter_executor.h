@@ -20,7 +20,9 @@
 
 #pragma once
 
+#include <iterator>
 #include <variant>
+#include <vector>
 
 #include "parse_util.h"
 #include "search/hnsw_indexer.h"
@@ -139,9 +141,23 @@ struct QueryExprEvaluator {
 struct FilterExecutor : ExecutorNode {
   Filter *filter;
 
+  // The rows of the last batch which are not consumed yet, only used with a pool
+  RowBatch pending;
+  size_t pending_pos = 0;
+
   FilterExecutor(ExecutorContext *ctx, Filter *filter) : ExecutorNode(ctx), filter(filter) {}
 
   StatusOr<Result> Next() override {
+    // Without workers to share the evaluation, pulling a whole batch would only read ahead of a limit
+    if (ctx->pool) {
+      while (pending_pos == pending.size()) {
+        pending = GET_OR_RET(NextBatch(ctx->batch_size));
+        pending_pos = 0;
+        if (pending.empty()) return end;
+      }
+      return std::move(pending[pending_pos++]);
+    }
+
     while (true) {
       auto v = GET_OR_RET(ctx->Get(filter->source)->Next());
 
@@ -156,6 +172,42 @@ struct FilterExecutor : ExecutorNode {
       }
     }
   }
+
+  StatusOr<RowBatch> NextBatch(size_t max_rows) override {
+    if (pending_pos < pending.size()) {
+      RowBatch rest(std::make_move_iterator(pending.begin() + static_cast<std::ptrdiff_t>(pending_pos)),
+                    std::make_move_iterator(pending.end()));
+      pending.clear();
+      pending_pos = 0;
+      return rest;
+    }
+
+    while (true) {
+      auto batch = GET_OR_RET(ctx->Get(filter->source)->NextBatch(max_rows));
+      if (batch.empty()) return batch;
+
+      // Each row is evaluated by one partition only, and the fields it retrieves are cached in the row itself
+      std::vector<char> matched(batch.size());
+      GET_OR_RET(ctx->ForEachPartition(batch.size(), [&](size_t, size_t first, size_t last) -> Status {
+        for (size_t i = first; i < last; i++) {
+          QueryExprEvaluator eval{ctx, batch[i]};
+          matched[i] = GET_OR_RET(eval.Transform(filter->filter_expr.get()));
+        }
+        return Status::OK();
+      }));
+
+      size_t kept = 0;
+      for (size_t i = 0; i < batch.size(); i++) {
+        if (matched[i]) {
+          if (kept != i) batch[kept] = std::move(batch[i]);
+          kept++;
+        }
+      }
+      batch.erase(batch.begin() + static_cast<std::ptrdiff_t>(kept), batch.end());
+
+      if (!batch.empty()) return batch;
+    }
+  }
 };
 
 }  // namespace kqir
@@ -52,7 +52,9 @@ struct HnswVectorFieldKnnScanExecutor : ExecutorNode {
         index(scan->field->info->index),
         search_key(index->ns, index->name, scan->field->name),
         field_metadata(*(scan->field->info->MetadataAs<redis::HnswVectorFieldMetadata>())),
-        hnsw_index(redis::HnswIndex(search_key, &field_metadata, ctx->storage)) {}
+        hnsw_index(redis::HnswIndex(search_key, &field_metadata, ctx->storage)) {
+    hnsw_index.cache = index->hnsw_cache;
+  }
 
   StatusOr<Result> Next() override {
     if (!initialized) {
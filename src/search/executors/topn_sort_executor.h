@@ -21,7 +21,9 @@
 #pragma once
 
 #include <algorithm>
+#include <iterator>
 #include <variant>
+#include <vector>
 
 #include "parse_util.h"
 #include "search/plan_executor.h"
@@ -51,35 +53,38 @@ struct TopNSortExecutor : ExecutorNode {
       auto total = sort->limit->offset + sort->limit->count;
       if (total == 0) return end;
 
-      auto v = GET_OR_RET(ctx->Get(sort->op)->Next());
-
-      while (!std::holds_alternative<End>(v)) {
-        auto &row = std::get<RowType>(v);
-
-        auto get_order = [this](RowType &row) -> StatusOr<double> {
-          auto order_val = GET_OR_RET(ctx->Retrieve(ctx->db_ctx, row, sort->order->field->info));
-          CHECK(order_val.Is<kqir::Numeric>());
-          return order_val.Get<kqir::Numeric>();
-        };
-
-        if (rows.size() == total) {
-          std::make_heap(rows.begin(), rows.end());
-        }
-
-        if (rows.size() < total) {
-          auto order = GET_OR_RET(get_order(row));
-          rows.emplace_back(row, order);
-        } else {
-          auto order = GET_OR_RET(get_order(row));
-
-          if (order < rows[0].val) {
-            std::pop_heap(rows.begin(), rows.end());
-            rows.back() = ComparedRow{row, order};
-            std::push_heap(rows.begin(), rows.end());
+      auto get_order = [this](RowType &row) -> StatusOr<double> {
+        auto order_val = GET_OR_RET(ctx->Retrieve(ctx->db_ctx, row, sort->order->field->info));
+        CHECK(order_val.Is<kqir::Numeric>());
+        return order_val.Get<kqir::Numeric>();
+      };
+
+      // Each partition keeps the `total` smallest rows it has seen in a max-heap of its own,
+      // so the partitions don't contend, and the heaps are merged once the source ends
+      std::vector<std::vector<ComparedRow>> heaps(ctx->Partitions());
+      auto batch = GET_OR_RET(ctx->Get(sort->op)->NextBatch(ctx->batch_size));
+      while (!batch.empty()) {
+        GET_OR_RET(ctx->ForEachPartition(batch.size(), [&](size_t partition, size_t first, size_t last) -> Status {
+          auto &heap = heaps[partition];
+          for (size_t i = first; i < last; i++) {
+            auto order = GET_OR_RET(get_order(batch[i]));
+            if (heap.size() < total) {
+              heap.emplace_back(std::move(batch[i]), order);
+              std::push_heap(heap.begin(), heap.end());
+            } else if (order < heap.front().val) {
+              std::pop_heap(heap.begin(), heap.end());
+              heap.back() = ComparedRow{std::move(batch[i]), order};
+              std::push_heap(heap.begin(), heap.end());
+            }
           }
-        }
+          return Status::OK();
+        }));
+
+        batch = GET_OR_RET(ctx->Get(sort->op)->NextBatch(ctx->batch_size));
+      }
 
-        v = GET_OR_RET(ctx->Get(sort->op)->Next());
+      for (auto &heap : heaps) {
+        rows.insert(rows.end(), std::make_move_iterator(heap.begin()), std::make_move_iterator(heap.end()));
       }
 
       if (rows.size() <= sort->limit->offset) {
@@ -87,6 +92,9 @@ struct TopNSortExecutor : ExecutorNode {
       }
 
       std::sort(rows.begin(), rows.end());
+      if (rows.size() > total) {
+        rows.erase(rows.begin() + static_cast<std::ptrdiff_t>(total), rows.end());
+      }
       rows_iter = rows.begin() + static_cast<std::ptrdiff_t>(sort->limit->offset);
       initialized = true;
     }
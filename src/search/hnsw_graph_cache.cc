@@ -0,0 +1,127 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "hnsw_graph_cache.h"
+
+namespace redis {
+
+// The rough per-entry overhead of the list node, the hash map node and the shared pointer
+static constexpr size_t kEntryOverhead = 128;
+
+bool HnswGraphCache::IsFull() const {
+  size_t usage = 0;
+  for (const auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard.mu);
+    usage += shard.usage;
+  }
+  return usage >= capacity_.load(std::memory_order_relaxed);
+}
+
+bool HnswGraphCache::Contains(const std::string &key) const {
+  const auto &shard = shardOf(key);
+  std::lock_guard<std::mutex> guard(shard.mu);
+  return shard.map.count(key) > 0;
+}
+
+void HnswGraphCache::SetCapacity(size_t capacity) {
+  capacity_.store(capacity, std::memory_order_relaxed);
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard.mu);
+    shrinkLocked(&shard, capacity / kShards);
+  }
+}
+
+void HnswGraphCache::Evict(const std::vector<std::string> &keys, uint64_t sequence) {
+  if (keys.empty()) return;
+
+  // Bump the generation first, so the readers which may have read the old values can't fill them
+  auto evicted = evicted_sequence_.load(std::memory_order_relaxed);
+  while (evicted < sequence && !evicted_sequence_.compare_exchange_weak(evicted, sequence)) {
+  }
+  generation_.fetch_add(1, std::memory_order_acq_rel);
+  for (const auto &key : keys) {
+    auto &shard = shardOf(key);
+    std::lock_guard<std::mutex> guard(shard.mu);
+    if (auto iter = shard.map.find(key); iter != shard.map.end()) {
+      evictLocked(&shard, iter->second);
+    }
+  }
+}
+
+void HnswGraphCache::Clear() {
+  generation_.fetch_add(1, std::memory_order_acq_rel);
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard.mu);
+    shrinkLocked(&shard, 0);
+  }
+}
+
+HnswGraphCache::Stats HnswGraphCache::GetStats() const {
+  Stats stats{0, 0, hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed)};
+  for (const auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard.mu);
+    stats.usage += shard.usage;
+    stats.entries += shard.map.size();
+  }
+  return stats;
+}
+
+void HnswGraphCache::put(const std::string &key, Value value, uint64_t generation) {
+  auto shard_capacity = capacity_.load(std::memory_order_relaxed) / kShards;
+  auto charge = chargeOf(key, value);
+  if (charge > shard_capacity) return;
+
+  auto &shard = shardOf(key);
+  std::lock_guard<std::mutex> guard(shard.mu);
+  if (generation != generation_.load(std::memory_order_acquire)) return;
+
+  if (auto iter = shard.map.find(key); iter != shard.map.end()) {
+    evictLocked(&shard, iter->second);
+  }
+  shrinkLocked(&shard, shard_capacity - charge);
+
+  shard.lru.push_front(Entry{key, std::move(value), charge});
+  shard.map.emplace(shard.lru.front().key, shard.lru.begin());
+  shard.usage += charge;
+}
+
+size_t HnswGraphCache::chargeOf(const std::string &key, const Value &value) {
+  size_t charge = kEntryOverhead + key.size();
+  if (const auto *vector = std::get_if<Vector>(&value)) {
+    charge += (*vector)->size() * sizeof(double);
+  } else {
+    for (const auto &k : *std::get<Keys>(value)) charge += sizeof(std::string) + k.size();
+  }
+  return charge;
+}
+
+void HnswGraphCache::evictLocked(Shard *shard, std::list<Entry>::iterator iter) {
+  shard->usage -= iter->charge;
+  shard->map.erase(iter->key);
+  shard->lru.erase(iter);
+}
+
+void HnswGraphCache::shrinkLocked(Shard *shard, size_t capacity) {
+  while (shard->usage > capacity && !shard->lru.empty()) {
+    evictLocked(shard, std::prev(shard->lru.end()));
+  }
+}
+
+}  // namespace redis
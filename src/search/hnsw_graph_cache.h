@@ -0,0 +1,147 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "search/value.h"
+
+namespace redis {
+
+// HnswGraphCache keeps decoded HNSW graph data of all vector fields in memory, so the hops of
+// a KNN query don't read the search column family once the graph is warm. It caches:
+//
+//   - the vector of a node, keyed by the node key at level 0 since it's the same at every level,
+//   - the neighbours of a node at a level, keyed by the edge prefix of the node,
+//   - the default entry point of a level, keyed by the node prefix of the level.
+//
+// It's a read-through cache of the committed graph, bounded by a byte budget and evicting the
+// least recently used entries. Readers fill it on misses, writers evict the entries they changed
+// after writing their batch. A fill only succeeds if nothing was evicted since the reader took
+// the generation, so a reader which read the old graph can't put it back after an update, and
+// a reader of a snapshot older than the last eviction shouldn't fill it at all.
+class HnswGraphCache {
+ public:
+  using Vector = std::shared_ptr<const kqir::NumericArray>;
+  using Keys = std::shared_ptr<const std::vector<std::string>>;
+
+  struct Stats {
+    size_t usage;
+    size_t entries;
+    uint64_t hits;
+    uint64_t misses;
+  };
+
+  explicit HnswGraphCache(size_t capacity = 0) : capacity_(capacity) {}
+
+  HnswGraphCache(const HnswGraphCache &) = delete;
+  HnswGraphCache &operator=(const HnswGraphCache &) = delete;
+
+  bool Enabled() const { return capacity_.load(std::memory_order_relaxed) > 0; }
+  bool IsFull() const;
+  // Shrinking the capacity evicts entries until the usage fits, zero disables and clears the cache
+  void SetCapacity(size_t capacity);
+
+  uint64_t Generation() const { return generation_.load(std::memory_order_acquire); }
+  // The sequence number of the latest write whose changes were evicted
+  uint64_t EvictedSequence() const { return evicted_sequence_.load(std::memory_order_acquire); }
+
+  // Unlike the getters, it neither counts as a hit or miss nor refreshes the entry
+  bool Contains(const std::string &key) const;
+
+  Vector GetVector(const std::string &key) { return get<Vector>(key); }
+  Keys GetKeys(const std::string &key) { return get<Keys>(key); }
+  void PutVector(const std::string &key, Vector vector, uint64_t generation) {
+    put(key, std::move(vector), generation);
+  }
+  void PutKeys(const std::string &key, Keys keys, uint64_t generation) { put(key, std::move(keys), generation); }
+
+  // Evicts the keys changed by a write batch which was written with the given sequence number
+  void Evict(const std::vector<std::string> &keys, uint64_t sequence);
+  void Clear();
+
+  Stats GetStats() const;
+
+ private:
+  static constexpr size_t kShards = 16;
+
+  using Value = std::variant<Vector, Keys>;
+
+  struct Entry {
+    std::string key;
+    Value value;
+    size_t charge;
+  };
+
+  struct Shard {
+    mutable std::mutex mu;
+    std::list<Entry> lru;  // the most recently used entry goes first
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> map;
+    size_t usage = 0;
+  };
+
+  Shard &shardOf(std::string_view key) { return shards_[std::hash<std::string_view>{}(key) % kShards]; }
+  const Shard &shardOf(std::string_view key) const {
+    return shards_[std::hash<std::string_view>{}(key) % kShards];
+  }
+
+  template <typename T>
+  T get(const std::string &key) {
+    if (!Enabled()) return nullptr;
+
+    auto &shard = shardOf(key);
+    std::lock_guard<std::mutex> guard(shard.mu);
+    auto iter = shard.map.find(key);
+    if (iter == shard.map.end() || !std::holds_alternative<T>(iter->second->value)) {
+      misses_.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    shard.lru.splice(shard.lru.begin(), shard.lru, iter->second);
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return std::get<T>(iter->second->value);
+  }
+
+  void put(const std::string &key, Value value, uint64_t generation);
+  static size_t chargeOf(const std::string &key, const Value &value);
+  static void evictLocked(Shard *shard, std::list<Entry>::iterator iter);
+  static void shrinkLocked(Shard *shard, size_t capacity);
+
+  std::array<Shard, kShards> shards_;
+  std::atomic<size_t> capacity_;
+  std::atomic<uint64_t> generation_{0};
+  std::atomic<uint64_t> evicted_sequence_{0};
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+};
+
+}  // namespace redis
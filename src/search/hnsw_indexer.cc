@@ -31,6 +31,7 @@
 #include <vector>
 
 #include "db_util.h"
+#include "vector_distance.h"
 
 namespace redis {
 
@@ -127,10 +128,37 @@ bool VectorItem::operator==(const VectorItem& other) const { return key == other
 bool VectorItem::operator<(const VectorItem& other) const { return key < other.key; }
 
 VectorItem::VectorItem(NodeKey&& key, const kqir::NumericArray& vector, const HnswVectorFieldMetadata* metadata)
-    : key(std::move(key)), vector(vector), metadata(metadata) {}
+    : key(std::move(key)), vector(vector), metadata(metadata) {
+  if (metadata->vector_type == VectorType::FLOAT32) {
+    packed.assign(this->vector.begin(), this->vector.end());
+  }
+}
 
 VectorItem::VectorItem(NodeKey&& key, kqir::NumericArray&& vector, const HnswVectorFieldMetadata* metadata)
-    : key(std::move(key)), vector(std::move(vector)), metadata(metadata) {}
+    : key(std::move(key)), vector(std::move(vector)), metadata(metadata) {
+  if (metadata->vector_type == VectorType::FLOAT32) {
+    packed.assign(this->vector.begin(), this->vector.end());
+  }
+}
+
+// Computes the distance of FLOAT32 vectors with the SIMD kernels picked for the running CPU
+static double ComputePackedSimilarity(DistanceMetric metric, const std::vector<float>& left,
+                                      const std::vector<float>& right) {
+  const auto& kernels = GetVectorDistanceKernels();
+  switch (metric) {
+    case DistanceMetric::L2:
+      return std::sqrt(kernels.l2_squared(left.data(), right.data(), left.size()));
+    case DistanceMetric::IP:
+      return -kernels.inner_product(left.data(), right.data(), left.size());
+    case DistanceMetric::COSINE: {
+      float dot = 0, norm_left = 0, norm_right = 0;
+      kernels.cosine_terms(left.data(), right.data(), left.size(), &dot, &norm_left, &norm_right);
+      return 1.0 - dot / std::sqrt(static_cast<double>(norm_left) * norm_right);
+    }
+    default:
+      __builtin_unreachable();
+  }
+}
 
 StatusOr<double> ComputeSimilarity(const VectorItem& left, const VectorItem& right) {
   if (left.metadata->distance_metric != right.metadata->distance_metric || left.metadata->dim != right.metadata->dim)
@@ -139,6 +167,10 @@ StatusOr<double> ComputeSimilarity(const VectorItem& left, const VectorItem& rig
   auto metric = left.metadata->distance_metric;
   auto dim = left.metadata->dim;
 
+  if (left.packed.size() == dim && right.packed.size() == dim) {
+    return ComputePackedSimilarity(metric, left.packed, right.packed);
+  }
+
   switch (metric) {
     case DistanceMetric::L2: {
       double dist = 0.0;
@@ -172,6 +204,18 @@ StatusOr<double> ComputeSimilarity(const VectorItem& left, const VectorItem& rig
   }
 }
 
+// The cache holds the committed graph, so it can't serve the reads which should see uncommitted writes
+static bool CanReadCache(const HnswGraphCache* cache, const engine::Context& ctx) {
+  return cache && cache->Enabled() && !ctx.batch && !ctx.storage->IsTxnMode();
+}
+
+// Takes the generation to fill the cache with, and returns false if the snapshot of ctx may miss
+// some evicted changes, in which case what it reads shouldn't be put into the cache
+static bool CanFillCache(const HnswGraphCache* cache, const engine::Context& ctx, uint64_t* generation) {
+  *generation = cache->Generation();
+  return !ctx.snapshot || ctx.snapshot->GetSequenceNumber() >= cache->EvictedSequence();
+}
+
 HnswIndex::HnswIndex(const SearchKey& search_key, HnswVectorFieldMetadata* vector, engine::Storage* storage)
     : search_key(search_key),
       metadata(vector),
@@ -191,6 +235,15 @@ uint16_t HnswIndex::RandomizeLayer() {
 
 StatusOr<HnswIndex::NodeKey> HnswIndex::DefaultEntryPoint(engine::Context& ctx, uint16_t level) const {
   auto prefix = search_key.ConstructHnswLevelNodePrefix(level);
+  bool use_cache = CanReadCache(cache, ctx);
+  if (use_cache) {
+    if (auto keys = cache->GetKeys(prefix); keys && !keys->empty()) {
+      return keys->front();
+    }
+  }
+  uint64_t generation = 0;
+  bool fill_cache = use_cache && CanFillCache(cache, ctx, &generation);
+
   util::UniqueIterator it(ctx, ctx.DefaultScanOptions(), ColumnFamilyID::Search);
   it->Seek(prefix);
 
@@ -202,7 +255,11 @@ StatusOr<HnswIndex::NodeKey> HnswIndex::DefaultEntryPoint(engine::Context& ctx,
     if (!GetSizedString(&node_key, &node_key_dst)) {
       return {Status::NotOK, fmt::format("fail to decode the default node key layer {}", level)};
     }
-    return node_key_dst.ToString();
+    auto entry_point = node_key_dst.ToString();
+    if (fill_cache) {
+      cache->PutKeys(prefix, std::make_shared<const std::vector<NodeKey>>(1, entry_point), generation);
+    }
+    return entry_point;
   }
   return {Status::NotFound, fmt::format("No node found in layer {}", level)};
 }
@@ -228,6 +285,142 @@ StatusOr<std::vector<VectorItem>> HnswIndex::DecodeNodesToVectorItems(engine::Co
   return vector_items;
 }
 
+StatusOr<VectorItem> HnswIndex::DecodeVectorItem(engine::Context& ctx, uint16_t level, const NodeKey& node_key) const {
+  bool use_cache = CanReadCache(cache, ctx);
+  std::string cache_key;
+  uint64_t generation = 0;
+  bool fill_cache = false;
+  if (use_cache) {
+    // The vector of a node is the same at every level
+    cache_key = search_key.ConstructHnswNode(0, node_key);
+    if (auto vector = cache->GetVector(cache_key)) {
+      VectorItem item;
+      GET_OR_RET(VectorItem::Create(node_key, *vector, metadata, &item));
+      return item;
+    }
+    fill_cache = CanFillCache(cache, ctx, &generation);
+  }
+
+  auto node_metadata = GET_OR_RET(HnswNode(node_key, level).DecodeMetadata(ctx, search_key));
+  VectorItem item;
+  if (fill_cache) {
+    auto vector = std::make_shared<const kqir::NumericArray>(std::move(node_metadata.vector));
+    GET_OR_RET(VectorItem::Create(node_key, *vector, metadata, &item));
+    cache->PutVector(cache_key, std::move(vector), generation);
+  } else {
+    GET_OR_RET(VectorItem::Create(node_key, std::move(node_metadata.vector), metadata, &item));
+  }
+  return item;
+}
+
+HnswGraphCache::Keys HnswIndex::DecodeNeighbours(engine::Context& ctx, uint16_t level, const NodeKey& node_key) const {
+  bool use_cache = CanReadCache(cache, ctx);
+  std::string cache_key;
+  uint64_t generation = 0;
+  bool fill_cache = false;
+  if (use_cache) {
+    cache_key = search_key.ConstructHnswEdgeWithSingleEnd(level, node_key);
+    if (auto neighbours = cache->GetKeys(cache_key)) {
+      return neighbours;
+    }
+    fill_cache = CanFillCache(cache, ctx, &generation);
+  }
+
+  HnswNode node(node_key, level);
+  node.DecodeNeighbours(ctx, search_key);
+  auto neighbours = std::make_shared<const std::vector<NodeKey>>(std::move(node.neighbours));
+  if (fill_cache) {
+    cache->PutKeys(cache_key, neighbours, generation);
+  }
+  return neighbours;
+}
+
+void HnswIndex::MarkModified(std::string cache_key) const {
+  if (cache) {
+    modified_cache_keys.emplace_back(std::move(cache_key));
+  }
+}
+
+void HnswIndex::EvictModifiedFromCache() {
+  if (cache) {
+    // Inside a transaction, the batch is only written on the commit. Evicting before that would let the
+    // other workers put the old graph back with a fresh generation, so it's deferred until the commit.
+    storage->AfterCommit([cache = cache, storage = storage, keys = std::move(modified_cache_keys)]() {
+      cache->Evict(keys, storage->LatestSeqNumber());
+    });
+  }
+  modified_cache_keys.clear();
+}
+
+Status HnswIndex::WarmCache(engine::Context& ctx) const {
+  if (!CanReadCache(cache, ctx)) {
+    return Status::OK();
+  }
+
+  for (int level = metadata->num_levels - 1; level >= 0 && !cache->IsFull(); level--) {
+    uint64_t generation = 0;
+    if (!CanFillCache(cache, ctx, &generation)) {
+      break;
+    }
+
+    // The upper levels are visited by every query, so they are loaded first. A node of an upper level
+    // is also at the lower ones, so its vector is only loaded once.
+    auto node_prefix = search_key.ConstructHnswLevelNodePrefix(level);
+    util::UniqueIterator node_iter(ctx, ctx.DefaultScanOptions(), ColumnFamilyID::Search);
+    for (node_iter->Seek(node_prefix); node_iter->Valid() && node_iter->key().starts_with(node_prefix);
+         node_iter->Next()) {
+      auto node_key = node_iter->key();
+      node_key.remove_prefix(node_prefix.size());
+      Slice node;
+      if (!GetSizedString(&node_key, &node)) {
+        return {Status::NotOK, fmt::format("fail to decode the node key at layer {}", level)};
+      }
+
+      auto cache_key = search_key.ConstructHnswNode(0, node.ToStringView());
+      if (cache->Contains(cache_key)) continue;
+
+      HnswNodeFieldMetadata node_metadata;
+      auto value = node_iter->value();
+      auto s = node_metadata.Decode(&value);
+      if (!s.ok()) return {Status::NotOK, s.ToString()};
+      cache->PutVector(cache_key, std::make_shared<const kqir::NumericArray>(std::move(node_metadata.vector)),
+                       generation);
+    }
+
+    // The edges of a node are adjacent, so its neighbours are collected until the node changes
+    std::string edge_prefix;
+    search_key.PutHnswLevelEdgePrefix(&edge_prefix, level);
+    std::string current_node;
+    std::vector<NodeKey> neighbours;
+    auto flush = [&] {
+      if (!current_node.empty()) {
+        cache->PutKeys(search_key.ConstructHnswEdgeWithSingleEnd(level, current_node),
+                       std::make_shared<const std::vector<NodeKey>>(std::move(neighbours)), generation);
+      }
+      neighbours.clear();
+    };
+
+    util::UniqueIterator edge_iter(ctx, ctx.DefaultScanOptions(), ColumnFamilyID::Search);
+    for (edge_iter->Seek(edge_prefix); edge_iter->Valid() && edge_iter->key().starts_with(edge_prefix);
+         edge_iter->Next()) {
+      auto edge_key = edge_iter->key();
+      edge_key.remove_prefix(edge_prefix.size());
+      Slice node, neighbour;
+      if (!GetSizedString(&edge_key, &node) || !GetSizedString(&edge_key, &neighbour)) {
+        return {Status::NotOK, fmt::format("fail to decode the edge key at layer {}", level)};
+      }
+
+      if (node.ToStringView() != current_node) {
+        flush();
+        current_node = node.ToString();
+      }
+      neighbours.push_back(neighbour.ToString());
+    }
+    flush();
+  }
+  return Status::OK();
+}
+
 Status HnswIndex::AddEdge(const NodeKey& node_key1, const NodeKey& node_key2, uint16_t layer,
                           ObserverOrUniquePtr<rocksdb::WriteBatchBase>& batch) const {
   auto edge_index_key1 = search_key.ConstructHnswEdge(layer, node_key1, node_key2);
@@ -241,6 +434,9 @@ Status HnswIndex::AddEdge(const NodeKey& node_key1, const NodeKey& node_key2, ui
   if (!s.ok()) {
     return {Status::NotOK, fmt::format("failed to add edge, {}", s.ToString())};
   }
+
+  MarkModified(search_key.ConstructHnswEdgeWithSingleEnd(layer, node_key1));
+  MarkModified(search_key.ConstructHnswEdgeWithSingleEnd(layer, node_key2));
   return Status::OK();
 }
 
@@ -257,6 +453,9 @@ Status HnswIndex::RemoveEdge(const NodeKey& node_key1, const NodeKey& node_key2,
   if (!s.ok()) {
     return {Status::NotOK, fmt::format("failed to delete edge, {}", s.ToString())};
   }
+
+  MarkModified(search_key.ConstructHnswEdgeWithSingleEnd(layer, node_key1));
+  MarkModified(search_key.ConstructHnswEdgeWithSingleEnd(layer, node_key2));
   return Status::OK();
 }
 
@@ -290,12 +489,7 @@ StatusOr<std::vector<VectorItemWithDistance>> HnswIndex::SearchLayerInternal(
   std::priority_queue<VectorItemWithDistance> result_heap;
 
   for (const auto& entry_point_key : entry_points) {
-    HnswNode entry_node = HnswNode(entry_point_key, level);
-    auto entry_node_metadata = GET_OR_RET(entry_node.DecodeMetadata(ctx, search_key));
-
-    VectorItem entry_point_vector;
-    GET_OR_RET(
-        VectorItem::Create(entry_point_key, std::move(entry_node_metadata.vector), metadata, &entry_point_vector));
+    auto entry_point_vector = GET_OR_RET(DecodeVectorItem(ctx, level, entry_point_key));
     auto dist = GET_OR_RET(ComputeSimilarity(target_vector, entry_point_vector));
 
     explore_heap.push(std::make_pair(dist, entry_point_vector));
@@ -310,22 +504,14 @@ StatusOr<std::vector<VectorItemWithDistance>> HnswIndex::SearchLayerInternal(
       break;
     }
 
-    auto current_node = HnswNode(current_vector.key, level);
-    current_node.DecodeNeighbours(ctx, search_key);
-
-    for (const auto& neighbour_key : current_node.neighbours) {
+    auto neighbours = DecodeNeighbours(ctx, level, current_vector.key);
+    for (const auto& neighbour_key : *neighbours) {
       if (visited.find(neighbour_key) != visited.end()) {
         continue;
       }
       visited.insert(neighbour_key);
 
-      auto neighbour_node = HnswNode(neighbour_key, level);
-      auto neighbour_node_metadata = GET_OR_RET(neighbour_node.DecodeMetadata(ctx, search_key));
-
-      VectorItem neighbour_node_vector;
-      GET_OR_RET(VectorItem::Create(neighbour_key, std::move(neighbour_node_metadata.vector), metadata,
-                                    &neighbour_node_vector));
-
+      auto neighbour_node_vector = GET_OR_RET(DecodeVectorItem(ctx, level, neighbour_key));
       auto dist = GET_OR_RET(ComputeSimilarity(target_vector, neighbour_node_vector));
       explore_heap.push(std::make_pair(dist, neighbour_node_vector));
       result_heap.push(std::make_pair(dist, neighbour_node_vector));
@@ -449,7 +635,9 @@ Status HnswIndex::InsertVectorEntryInternal(engine::Context& ctx, std::string_vi
       }
 
       // Update inserted node metadata
-      HnswNodeFieldMetadata node_metadata(static_cast<uint16_t>(connected_edges_set.size()), vector);
+      MarkModified(search_key.ConstructHnswLevelNodePrefix(level));
+      HnswNodeFieldMetadata node_metadata(static_cast<uint16_t>(connected_edges_set.size()), vector,
+                                          metadata->vector_type);
       auto s = node.PutMetadata(&node_metadata, search_key, storage, batch.Get());
       if (!s.IsOK()) {
         return s;
@@ -489,7 +677,8 @@ Status HnswIndex::InsertVectorEntryInternal(engine::Context& ctx, std::string_vi
     }
   } else {
     auto node = HnswNode(std::string(key), 0);
-    HnswNodeFieldMetadata node_metadata(0, vector);
+    MarkModified(search_key.ConstructHnswLevelNodePrefix(0));
+    HnswNodeFieldMetadata node_metadata(0, vector, metadata->vector_type);
     auto s = node.PutMetadata(&node_metadata, search_key, storage, batch.Get());
     if (!s.IsOK()) {
       return s;
@@ -499,7 +688,8 @@ Status HnswIndex::InsertVectorEntryInternal(engine::Context& ctx, std::string_vi
 
   while (target_level > metadata->num_levels - 1) {
     auto node = HnswNode(std::string(key), metadata->num_levels);
-    HnswNodeFieldMetadata node_metadata(0, vector);
+    MarkModified(search_key.ConstructHnswLevelNodePrefix(metadata->num_levels));
+    HnswNodeFieldMetadata node_metadata(0, vector, metadata->vector_type);
     auto s = node.PutMetadata(&node_metadata, search_key, storage, batch.Get());
     if (!s.IsOK()) {
       return s;
@@ -507,6 +697,8 @@ Status HnswIndex::InsertVectorEntryInternal(engine::Context& ctx, std::string_vi
     metadata->num_levels++;
   }
 
+  MarkModified(search_key.ConstructHnswNode(0, key));
+
   std::string encoded_index_metadata;
   metadata->Encode(&encoded_index_metadata);
   auto index_meta_key = search_key.ConstructFieldMeta();
@@ -540,6 +732,8 @@ Status HnswIndex::DeleteVectorEntry(engine::Context& ctx, std::string_view key,
     if (!s.ok()) {
       return {Status::NotOK, s.ToString()};
     }
+    MarkModified(search_key.ConstructHnswNode(0, key));
+    MarkModified(search_key.ConstructHnswLevelNodePrefix(level));
 
     node.DecodeNeighbours(ctx, search_key);
     for (const auto& neighbour_key : node.neighbours) {
@@ -637,22 +831,14 @@ StatusOr<std::vector<KeyWithDistance>> HnswIndex::ExpandSearchScope(engine::Cont
     auto current_key = initial_keys.front().second;
     initial_keys.erase(initial_keys.begin());
 
-    auto current_node = HnswNode(current_key, level);
-    current_node.DecodeNeighbours(ctx, search_key);
-
-    for (const auto& neighbour_key : current_node.neighbours) {
+    auto neighbours = DecodeNeighbours(ctx, level, current_key);
+    for (const auto& neighbour_key : *neighbours) {
       if (visited.find(neighbour_key) != visited.end()) {
         continue;
       }
       visited.insert(neighbour_key);
 
-      auto neighbour_node = HnswNode(neighbour_key, level);
-      auto neighbour_node_metadata = GET_OR_RET(neighbour_node.DecodeMetadata(ctx, search_key));
-
-      VectorItem neighbour_node_vector;
-      GET_OR_RET(VectorItem::Create(neighbour_key, std::move(neighbour_node_metadata.vector), metadata,
-                                    &neighbour_node_vector));
-
+      auto neighbour_node_vector = GET_OR_RET(DecodeVectorItem(ctx, level, neighbour_key));
       auto dist = GET_OR_RET(ComputeSimilarity(query_vector_item, neighbour_node_vector));
       result.emplace_back(dist, neighbour_key);
     }
@@ -24,6 +24,7 @@
 #include <string>
 #include <vector>
 
+#include "search/hnsw_graph_cache.h"
 #include "search/indexer.h"
 #include "search/search_encoding.h"
 #include "search/value.h"
@@ -59,6 +60,8 @@ struct VectorItem {
 
   NodeKey key;
   kqir::NumericArray vector;
+  // The vector packed into float32 for the SIMD distance kernels, only filled for FLOAT32 fields
+  std::vector<float> packed;
   const HnswVectorFieldMetadata* metadata;
 
   VectorItem() : metadata(nullptr) {}
@@ -92,6 +95,11 @@ struct HnswIndex {
   std::mt19937 generator;
   double m_level_normalization_factor;
 
+  // The graph cache shared by the vector fields, nullptr if it isn't attached
+  HnswGraphCache* cache = nullptr;
+  // The cache keys of the graph data changed by the pending write batch
+  mutable std::vector<std::string> modified_cache_keys;
+
   HnswIndex(const SearchKey& search_key, HnswVectorFieldMetadata* vector, engine::Storage* storage);
 
   static StatusOr<std::vector<VectorItem>> DecodeNodesToVectorItems(engine::Context& ctx,
@@ -124,6 +132,16 @@ struct HnswIndex {
   StatusOr<std::vector<KeyWithDistance>> ExpandSearchScope(engine::Context& ctx, const kqir::NumericArray& query_vector,
                                                            std::vector<redis::KeyWithDistance>&& initial_keys,
                                                            std::unordered_set<std::string>& visited) const;
+
+  // Evicts the graph data changed by InsertVectorEntry or DeleteVectorEntry from the cache,
+  // it should be called once their write batch is written.
+  void EvictModifiedFromCache();
+  // Fills the cache with the graph level by level from the top one, until the cache is full
+  Status WarmCache(engine::Context& ctx) const;
+  // Reads the vector of a node or its neighbours at a level, through the cache when it can be used
+  StatusOr<VectorItem> DecodeVectorItem(engine::Context& ctx, uint16_t level, const NodeKey& node_key) const;
+  HnswGraphCache::Keys DecodeNeighbours(engine::Context& ctx, uint16_t level, const NodeKey& node_key) const;
+  void MarkModified(std::string cache_key) const;
 };
 
 }  // namespace redis
\ No newline at end of file
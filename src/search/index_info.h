@@ -29,6 +29,12 @@
 #include "search_encoding.h"
 #include "storage/redis_metadata.h"
 
+namespace redis {
+
+class HnswGraphCache;
+
+}  // namespace redis
+
 namespace kqir {
 
 struct IndexInfo;
@@ -58,6 +64,8 @@ struct IndexInfo {
   FieldMap fields;
   redis::IndexPrefixes prefixes;
   std::string ns;
+  // The cache of the HNSW graphs of the vector fields, nullptr if the index isn't managed by a server
+  redis::HnswGraphCache *hnsw_cache = nullptr;
 
   IndexInfo(std::string name, redis::IndexMetadata metadata, std::string ns)
       : name(std::move(name)), metadata(std::move(metadata)), ns(std::move(ns)) {}
@@ -22,6 +22,7 @@
 
 #include "db_util.h"
 #include "encoding.h"
+#include "search/hnsw_indexer.h"
 #include "search/index_info.h"
 #include "search/indexer.h"
 #include "search/ir.h"
@@ -39,8 +40,13 @@ struct IndexManager {
   kqir::IndexMap index_map;
   GlobalIndexer *indexer;
   engine::Storage *storage;
+  std::unique_ptr<kqir::ExecutorPool> executor_pool;
 
-  IndexManager(GlobalIndexer *indexer, engine::Storage *storage) : indexer(indexer), storage(storage) {}
+  IndexManager(GlobalIndexer *indexer, engine::Storage *storage) : indexer(indexer), storage(storage) {
+    if (auto threads = storage->GetConfig()->search_executor_threads; threads > 0) {
+      executor_pool = std::make_unique<kqir::ExecutorPool>(threads);
+    }
+  }
 
   Status Load(const std::string &ns) {
     // currently index cannot work in cluster mode
@@ -90,6 +96,7 @@ struct IndexManager {
 
       auto info = std::make_unique<kqir::IndexInfo>(index_name.ToString(), metadata, ns);
       info->prefixes = prefixes;
+      info->hnsw_cache = &indexer->hnsw_cache;
 
       util::UniqueIterator field_iter(no_txn_ctx, no_txn_ctx.DefaultScanOptions(), ColumnFamilyID::Search);
       auto field_begin = index_key.ConstructFieldMeta();
@@ -125,6 +132,17 @@ struct IndexManager {
         info->Add(kqir::FieldInfo(field_name.ToString(), std::move(field_meta)));
       }
 
+      for (auto &[_, field] : info->fields) {
+        if (auto vector = dynamic_cast<HnswVectorFieldMetadata *>(field.metadata.get())) {
+          HnswIndex hnsw(SearchKey(ns, info->name, field.name), vector, storage);
+          hnsw.cache = info->hnsw_cache;
+          if (auto s = hnsw.WarmCache(no_txn_ctx); !s.IsOK()) {
+            return {Status::NotOK, fmt::format("fail to warm the HNSW graph cache for index {}, field {}: {}",
+                                               info->name, field.name, s.Msg())};
+          }
+        }
+      }
+
       IndexUpdater updater(info.get());
       indexer->Add(updater);
       index_map.Insert(std::move(info));
@@ -145,6 +163,7 @@ struct IndexManager {
     if (auto iter = index_map.Find(info->name, info->ns); iter != index_map.end()) {
       return {Status::NotOK, "index already exists"};
     }
+    info->hnsw_cache = &indexer->hnsw_cache;
 
     SearchKey index_key(info->ns, info->name);
     auto cf = storage->GetCFHandle(ColumnFamilyID::Search);
@@ -212,7 +231,7 @@ struct IndexManager {
                                                                const std::string &ns) const {
     auto plan_op = GET_OR_RET(GeneratePlan(std::move(ir), ns));
 
-    kqir::ExecutorContext executor_ctx(plan_op.get(), storage);
+    kqir::ExecutorContext executor_ctx(plan_op.get(), storage, executor_pool.get());
 
     std::vector<kqir::ExecutorContext::RowType> results;
 
@@ -269,6 +288,8 @@ struct IndexManager {
     }
 
     index_map.erase(iter);
+    // Otherwise an index created with the same name later could hit the graph of the dropped one
+    indexer->hnsw_cache.Clear();
 
     return Status::OK();
   }
@@ -35,9 +35,9 @@
 
 namespace redis {
 
-StatusOr<FieldValueRetriever> FieldValueRetriever::Create(IndexOnDataType type, std::string_view key,
-                                                          engine::Storage *storage, const std::string &ns) {
-  engine::Context ctx(storage);
+StatusOr<FieldValueRetriever> FieldValueRetriever::Create(engine::Context &ctx, IndexOnDataType type,
+                                                          std::string_view key, const std::string &ns) {
+  auto storage = ctx.storage;
   if (type == IndexOnDataType::HASH) {
     Hash db(storage, ns);
     std::string ns_key = db.AppendNamespacePrefix(key);
@@ -166,7 +166,7 @@ StatusOr<IndexUpdater::FieldValues> IndexUpdater::Record(engine::Context &ctx, s
     return {Status::TypeMismatched};
   }
 
-  auto retriever = GET_OR_RET(FieldValueRetriever::Create(info->metadata.on_data_type, key, indexer->storage, ns));
+  auto retriever = GET_OR_RET(FieldValueRetriever::Create(ctx, info->metadata.on_data_type, key, ns));
 
   FieldValues values;
   for (const auto &[field, i] : info->fields) {
@@ -286,12 +286,14 @@ Status IndexUpdater::UpdateHnswVectorIndex(engine::Context &ctx, std::string_vie
 
   auto storage = indexer->storage;
   auto hnsw = HnswIndex(search_key, vector, storage);
+  hnsw.cache = info->hnsw_cache;
 
   if (!original.IsNull()) {
     auto batch = storage->GetWriteBatchBase();
     GET_OR_RET(hnsw.DeleteVectorEntry(ctx, key, batch));
     auto s = storage->Write(ctx, storage->DefaultWriteOptions(), batch->GetWriteBatch());
     if (!s.ok()) return {Status::NotOK, s.ToString()};
+    hnsw.EvictModifiedFromCache();
   }
 
   if (!current.IsNull()) {
@@ -299,6 +301,7 @@ Status IndexUpdater::UpdateHnswVectorIndex(engine::Context &ctx, std::string_vie
     GET_OR_RET(hnsw.InsertVectorEntry(ctx, key, current.Get<kqir::NumericArray>(), batch));
     auto s = storage->Write(ctx, storage->DefaultWriteOptions(), batch->GetWriteBatch());
     if (!s.ok()) return {Status::NotOK, s.ToString()};
+    hnsw.EvictModifiedFromCache();
   }
 
   return Status::OK();
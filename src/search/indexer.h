@@ -31,6 +31,7 @@
 #include "config/config.h"
 #include "index_info.h"
 #include "indexer.h"
+#include "search/hnsw_graph_cache.h"
 #include "search/search_encoding.h"
 #include "storage/redis_metadata.h"
 #include "storage/storage.h"
@@ -56,7 +57,7 @@ struct FieldValueRetriever {
   using Variant = std::variant<HashData, JsonData>;
   Variant db;
 
-  static StatusOr<FieldValueRetriever> Create(IndexOnDataType type, std::string_view key, engine::Storage *storage,
+  static StatusOr<FieldValueRetriever> Create(engine::Context &ctx, IndexOnDataType type, std::string_view key,
                                               const std::string &ns);
 
   explicit FieldValueRetriever(Hash hash, HashMetadata metadata, std::string_view key)
@@ -107,6 +108,8 @@ struct GlobalIndexer {
   std::vector<IndexUpdater> updater_list;
 
   engine::Storage *storage = nullptr;
+  // Shared by the vector fields of all indexes, so they are bounded by one memory budget
+  HnswGraphCache hnsw_cache;
 
   explicit GlobalIndexer(engine::Storage *storage) : storage(storage) {}
 
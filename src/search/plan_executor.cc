@@ -20,6 +20,7 @@
 
 #include "plan_executor.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "search/executors/filter_executor.h"
@@ -155,8 +156,8 @@ ExecutorContext::ExecutorContext(PlanOperator *op) : root(op), db_ctx(engine::Co
   visitor.Transform(root);
 }
 
-ExecutorContext::ExecutorContext(PlanOperator *op, engine::Storage *storage)
-    : root(op), storage(storage), db_ctx(storage) {
+ExecutorContext::ExecutorContext(PlanOperator *op, engine::Storage *storage, ExecutorPool *pool)
+    : root(op), storage(storage), db_ctx(storage), pool(pool) {
   details::ExecutorContextVisitor visitor{this};
   visitor.Transform(root);
 }
@@ -168,7 +169,7 @@ auto ExecutorContext::Retrieve(engine::Context &ctx, RowType &row, const FieldIn
   }
 
   auto retriever = GET_OR_RET(
-      redis::FieldValueRetriever::Create(field->index->metadata.on_data_type, row.key, storage, field->index->ns));
+      redis::FieldValueRetriever::Create(ctx, field->index->metadata.on_data_type, row.key, field->index->ns));
 
   auto s = retriever.Retrieve(ctx, field->name, field->metadata.get());
   if (!s) return s;
@@ -177,4 +178,33 @@ auto ExecutorContext::Retrieve(engine::Context &ctx, RowType &row, const FieldIn
   return *s;
 }
 
+Status ExecutorContext::ForEachPartition(size_t n, const PartitionFn &fn) const {
+  auto partitions = std::min(Partitions(), n);
+  if (partitions <= 1) {
+    return n == 0 ? Status::OK() : fn(0, 0, n);
+  }
+
+  std::vector<Status> results(partitions);
+  pool->ParallelFor(partitions, [&](size_t partition) {
+    auto begin = n * partition / partitions;
+    auto end = n * (partition + 1) / partitions;
+    results[partition] = fn(partition, begin, end);
+  });
+
+  for (auto &s : results) {
+    if (!s) return std::move(s);
+  }
+  return Status::OK();
+}
+
+auto ExecutorNode::NextBatch(size_t max_rows) -> StatusOr<RowBatch> {
+  RowBatch batch;
+  while (batch.size() < max_rows) {
+    auto v = GET_OR_RET(Next());
+    if (std::holds_alternative<End>(v)) break;
+    batch.push_back(std::get<RowType>(std::move(v)));
+  }
+  return batch;
+}
+
 }  // namespace kqir
@@ -20,9 +20,12 @@
 
 #pragma once
 
+#include <functional>
 #include <variant>
+#include <vector>
 
 #include "ir_plan.h"
+#include "search/executor_pool.h"
 #include "search/index_info.h"
 #include "search/value.h"
 #include "storage/storage.h"
@@ -65,11 +68,16 @@ struct ExecutorNode {
   friend constexpr bool operator!=(End, End) noexcept { return false; }
 
   using Result = std::variant<End, RowType>;
+  // A batch of rows in the order Next would produce them, an empty batch means the end
+  using RowBatch = std::vector<RowType>;
 
   ExecutorContext *ctx;
   explicit ExecutorNode(ExecutorContext *ctx) : ctx(ctx) {}
 
   virtual StatusOr<Result> Next() = 0;
+  // Produces up to max_rows rows at once, so the consumer can process them in parallel.
+  // It calls Next by default, and the executors which benefit from batching override it.
+  virtual StatusOr<RowBatch> NextBatch(size_t max_rows);
   virtual ~ExecutorNode() = default;
 };
 
@@ -78,6 +86,10 @@ struct ExecutorContext {
   PlanOperator *root;
   engine::Storage *storage;
   engine::Context db_ctx;
+  // The workers to process the partitions of a row batch, the batches are processed
+  // on the calling thread only if it's nullptr
+  ExecutorPool *pool = nullptr;
+  size_t batch_size = 1024;
 
   using Result = ExecutorNode::Result;
   using RowType = ExecutorNode::RowType;
@@ -85,7 +97,7 @@ struct ExecutorContext {
   using ValueType = ExecutorNode::ValueType;
 
   explicit ExecutorContext(PlanOperator *op);
-  explicit ExecutorContext(PlanOperator *op, engine::Storage *storage);
+  explicit ExecutorContext(PlanOperator *op, engine::Storage *storage, ExecutorPool *pool = nullptr);
 
   ExecutorNode *Get(PlanOperator *op) {
     if (auto iter = nodes.find(op); iter != nodes.end()) {
@@ -99,6 +111,14 @@ struct ExecutorContext {
 
   StatusOr<Result> Next() { return Get(root)->Next(); }
   StatusOr<ValueType> Retrieve(engine::Context &ctx, RowType &row, const FieldInfo *field) const;
+
+  // The pool threads don't see the pending writes of the transaction of this thread, e.g. in EXEC or a key-locked
+  // script, so it runs serially in a transaction.
+  size_t Partitions() const { return pool && !(storage && storage->IsTxnMode()) ? pool->Size() + 1 : 1; }
+  // Splits [0, n) into up to Partitions() contiguous ranges and runs fn(partition, begin, end) on each of them,
+  // in parallel if there is a pool. Returns the error of the first failed partition.
+  using PartitionFn = std::function<Status(size_t partition, size_t begin, size_t end)>;
+  Status ForEachPartition(size_t n, const PartitionFn &fn) const;
 };
 
 }  // namespace kqir
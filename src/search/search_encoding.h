@@ -83,6 +83,7 @@ enum class IndexFieldType : uint8_t {
 
 enum class VectorType : uint8_t {
   FLOAT64 = 1,
+  FLOAT32 = 2,
 };
 
 enum class DistanceMetric : uint8_t {
@@ -417,14 +418,28 @@ struct HnswVectorFieldMetadata : IndexFieldMetadata {
 struct HnswNodeFieldMetadata {
   uint16_t num_neighbours;
   std::vector<double> vector;
+  // The element type of the encoded vector, FLOAT32 vectors are stored as a contiguous
+  // blob of little-endian floats, which takes half the space of the FLOAT64 encoding.
+  VectorType vector_type = VectorType::FLOAT64;
 
   HnswNodeFieldMetadata() = default;
-  HnswNodeFieldMetadata(uint16_t num_neighbours, std::vector<double> vector)
-      : num_neighbours(num_neighbours), vector(std::move(vector)) {}
+  HnswNodeFieldMetadata(uint16_t num_neighbours, std::vector<double> vector,
+                        VectorType vector_type = VectorType::FLOAT64)
+      : num_neighbours(num_neighbours), vector(std::move(vector)), vector_type(vector_type) {}
 
   void Encode(std::string *dst) const {
     PutFixed16(dst, num_neighbours);
     PutFixed16(dst, static_cast<uint16_t>(vector.size()));
+    if (vector_type == VectorType::FLOAT32) {
+      for (double element : vector) {
+        auto value = static_cast<float>(element);
+        uint32_t bits = 0;
+        __builtin_memcpy(&bits, &value, sizeof(bits));
+        if constexpr (IsBigEndian()) bits = BitSwap(bits);
+        dst->append(reinterpret_cast<const char *>(&bits), sizeof(bits));
+      }
+      return;
+    }
     for (double element : vector) {
       PutDouble(dst, element);
     }
@@ -439,9 +454,26 @@ struct HnswNodeFieldMetadata {
     uint16_t dim = 0;
     GetFixed16(input, (uint16_t *)(&dim));
 
+    // The element type is told apart by the size of the encoded vector
+    if (dim > 0 && input->size() == dim * sizeof(float)) {
+      vector_type = VectorType::FLOAT32;
+      vector.resize(dim);
+      for (auto i = 0; i < dim; ++i) {
+        uint32_t bits = 0;
+        __builtin_memcpy(&bits, input->data() + i * sizeof(float), sizeof(bits));
+        if constexpr (IsBigEndian()) bits = BitSwap(bits);
+        float value = 0;
+        __builtin_memcpy(&value, &bits, sizeof(value));
+        vector[i] = value;
+      }
+      input->remove_prefix(dim * sizeof(float));
+      return rocksdb::Status::OK();
+    }
+
     if (input->size() != dim * sizeof(double)) {
       return rocksdb::Status::Corruption(kErrorIncorrectLength);
     }
+    vector_type = VectorType::FLOAT64;
     vector.resize(dim);
 
     for (auto i = 0; i < dim; ++i) {
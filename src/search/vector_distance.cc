@@ -0,0 +1,256 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "vector_distance.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define KVROCKS_VECTOR_DISTANCE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace redis {
+
+namespace {
+
+// The portable kernels keep several independent accumulators, so the loop isn't
+// bound by the latency of a single chain of additions.
+constexpr size_t kScalarLanes = 8;
+
+float L2SquaredScalar(const float *left, const float *right, size_t dim) {
+  float acc[kScalarLanes] = {};
+  size_t i = 0;
+  for (; i + kScalarLanes <= dim; i += kScalarLanes) {
+    for (size_t j = 0; j < kScalarLanes; j++) {
+      float diff = left[i + j] - right[i + j];
+      acc[j] += diff * diff;
+    }
+  }
+  for (; i < dim; i++) {
+    float diff = left[i] - right[i];
+    acc[0] += diff * diff;
+  }
+
+  float sum = 0;
+  for (float v : acc) sum += v;
+  return sum;
+}
+
+float InnerProductScalar(const float *left, const float *right, size_t dim) {
+  float acc[kScalarLanes] = {};
+  size_t i = 0;
+  for (; i + kScalarLanes <= dim; i += kScalarLanes) {
+    for (size_t j = 0; j < kScalarLanes; j++) {
+      acc[j] += left[i + j] * right[i + j];
+    }
+  }
+  for (; i < dim; i++) {
+    acc[0] += left[i] * right[i];
+  }
+
+  float sum = 0;
+  for (float v : acc) sum += v;
+  return sum;
+}
+
+void CosineTermsScalar(const float *left, const float *right, size_t dim, float *dot, float *norm_left,
+                       float *norm_right) {
+  *dot = InnerProductScalar(left, right, dim);
+  *norm_left = InnerProductScalar(left, left, dim);
+  *norm_right = InnerProductScalar(right, right, dim);
+}
+
+#ifdef KVROCKS_VECTOR_DISTANCE_X86
+
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+
+TARGET_AVX2 inline float HorizontalSum(__m256 v) {
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  __m128 shuf = _mm_movehdup_ps(sum);
+  sum = _mm_add_ps(sum, shuf);
+  shuf = _mm_movehl_ps(shuf, sum);
+  return _mm_cvtss_f32(_mm_add_ss(sum, shuf));
+}
+
+TARGET_AVX2 float L2SquaredAVX2(const float *left, const float *right, size_t dim) {
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= dim; i += 16) {
+    __m256 diff0 = _mm256_sub_ps(_mm256_loadu_ps(left + i), _mm256_loadu_ps(right + i));
+    __m256 diff1 = _mm256_sub_ps(_mm256_loadu_ps(left + i + 8), _mm256_loadu_ps(right + i + 8));
+    acc0 = _mm256_fmadd_ps(diff0, diff0, acc0);
+    acc1 = _mm256_fmadd_ps(diff1, diff1, acc1);
+  }
+  if (i + 8 <= dim) {
+    __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(left + i), _mm256_loadu_ps(right + i));
+    acc0 = _mm256_fmadd_ps(diff, diff, acc0);
+    i += 8;
+  }
+
+  float sum = HorizontalSum(_mm256_add_ps(acc0, acc1));
+  for (; i < dim; i++) {
+    float diff = left[i] - right[i];
+    sum += diff * diff;
+  }
+  return sum;
+}
+
+TARGET_AVX2 float InnerProductAVX2(const float *left, const float *right, size_t dim) {
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= dim; i += 16) {
+    acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(left + i), _mm256_loadu_ps(right + i), acc0);
+    acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(left + i + 8), _mm256_loadu_ps(right + i + 8), acc1);
+  }
+  if (i + 8 <= dim) {
+    acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(left + i), _mm256_loadu_ps(right + i), acc0);
+    i += 8;
+  }
+
+  float sum = HorizontalSum(_mm256_add_ps(acc0, acc1));
+  for (; i < dim; i++) {
+    sum += left[i] * right[i];
+  }
+  return sum;
+}
+
+TARGET_AVX2 void CosineTermsAVX2(const float *left, const float *right, size_t dim, float *dot, float *norm_left,
+                                 float *norm_right) {
+  __m256 dot_acc = _mm256_setzero_ps();
+  __m256 left_acc = _mm256_setzero_ps();
+  __m256 right_acc = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= dim; i += 8) {
+    __m256 l = _mm256_loadu_ps(left + i);
+    __m256 r = _mm256_loadu_ps(right + i);
+    dot_acc = _mm256_fmadd_ps(l, r, dot_acc);
+    left_acc = _mm256_fmadd_ps(l, l, left_acc);
+    right_acc = _mm256_fmadd_ps(r, r, right_acc);
+  }
+
+  *dot = HorizontalSum(dot_acc);
+  *norm_left = HorizontalSum(left_acc);
+  *norm_right = HorizontalSum(right_acc);
+  for (; i < dim; i++) {
+    *dot += left[i] * right[i];
+    *norm_left += left[i] * left[i];
+    *norm_right += right[i] * right[i];
+  }
+}
+
+// The AVX-512 kernels handle the tail with masked loads instead of a scalar loop
+TARGET_AVX512 inline __mmask16 TailMask(size_t remaining) {
+  return static_cast<__mmask16>((1U << remaining) - 1);
+}
+
+// Only runs once per call, so a plain store avoids the 512-to-256 bit casts and
+// _mm512_reduce_add_ps, which trip -Wuninitialized in the headers of some GCC versions.
+TARGET_AVX512 inline float HorizontalSum(__m512 v) {
+  alignas(64) float lanes[16];
+  _mm512_store_ps(lanes, v);
+  float sum = 0;
+  for (float lane : lanes) sum += lane;
+  return sum;
+}
+
+TARGET_AVX512 float L2SquaredAVX512(const float *left, const float *right, size_t dim) {
+  __m512 acc0 = _mm512_setzero_ps();
+  __m512 acc1 = _mm512_setzero_ps();
+  size_t i = 0;
+  for (; i + 32 <= dim; i += 32) {
+    __m512 diff0 = _mm512_sub_ps(_mm512_loadu_ps(left + i), _mm512_loadu_ps(right + i));
+    __m512 diff1 = _mm512_sub_ps(_mm512_loadu_ps(left + i + 16), _mm512_loadu_ps(right + i + 16));
+    acc0 = _mm512_fmadd_ps(diff0, diff0, acc0);
+    acc1 = _mm512_fmadd_ps(diff1, diff1, acc1);
+  }
+  for (; i < dim; i += 16) {
+    __mmask16 mask = dim - i >= 16 ? static_cast<__mmask16>(0xffff) : TailMask(dim - i);
+    __m512 diff = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, left + i), _mm512_maskz_loadu_ps(mask, right + i));
+    acc0 = _mm512_fmadd_ps(diff, diff, acc0);
+  }
+  return HorizontalSum(_mm512_add_ps(acc0, acc1));
+}
+
+TARGET_AVX512 float InnerProductAVX512(const float *left, const float *right, size_t dim) {
+  __m512 acc0 = _mm512_setzero_ps();
+  __m512 acc1 = _mm512_setzero_ps();
+  size_t i = 0;
+  for (; i + 32 <= dim; i += 32) {
+    acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(left + i), _mm512_loadu_ps(right + i), acc0);
+    acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(left + i + 16), _mm512_loadu_ps(right + i + 16), acc1);
+  }
+  for (; i < dim; i += 16) {
+    __mmask16 mask = dim - i >= 16 ? static_cast<__mmask16>(0xffff) : TailMask(dim - i);
+    acc0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, left + i), _mm512_maskz_loadu_ps(mask, right + i), acc0);
+  }
+  return HorizontalSum(_mm512_add_ps(acc0, acc1));
+}
+
+TARGET_AVX512 void CosineTermsAVX512(const float *left, const float *right, size_t dim, float *dot, float *norm_left,
+                                     float *norm_right) {
+  __m512 dot_acc = _mm512_setzero_ps();
+  __m512 left_acc = _mm512_setzero_ps();
+  __m512 right_acc = _mm512_setzero_ps();
+  for (size_t i = 0; i < dim; i += 16) {
+    __mmask16 mask = dim - i >= 16 ? static_cast<__mmask16>(0xffff) : TailMask(dim - i);
+    __m512 l = _mm512_maskz_loadu_ps(mask, left + i);
+    __m512 r = _mm512_maskz_loadu_ps(mask, right + i);
+    dot_acc = _mm512_fmadd_ps(l, r, dot_acc);
+    left_acc = _mm512_fmadd_ps(l, l, left_acc);
+    right_acc = _mm512_fmadd_ps(r, r, right_acc);
+  }
+
+  *dot = HorizontalSum(dot_acc);
+  *norm_left = HorizontalSum(left_acc);
+  *norm_right = HorizontalSum(right_acc);
+}
+
+#undef TARGET_AVX2
+#undef TARGET_AVX512
+
+#endif  // KVROCKS_VECTOR_DISTANCE_X86
+
+constexpr VectorDistanceKernels kScalarKernels = {"scalar", L2SquaredScalar, InnerProductScalar, CosineTermsScalar};
+
+const VectorDistanceKernels &SelectKernels() {
+#ifdef KVROCKS_VECTOR_DISTANCE_X86
+  static constexpr VectorDistanceKernels avx512_kernels = {"avx512f", L2SquaredAVX512, InnerProductAVX512,
+                                                           CosineTermsAVX512};
+  static constexpr VectorDistanceKernels avx2_kernels = {"avx2", L2SquaredAVX2, InnerProductAVX2, CosineTermsAVX2};
+
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("fma")) return avx512_kernels;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return avx2_kernels;
+#endif
+  return kScalarKernels;
+}
+
+}  // namespace
+
+const VectorDistanceKernels &GetVectorDistanceKernels() {
+  static const VectorDistanceKernels &kernels = SelectKernels();
+  return kernels;
+}
+
+const VectorDistanceKernels &GetScalarVectorDistanceKernels() { return kScalarKernels; }
+
+}  // namespace redis
@@ -0,0 +1,47 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace redis {
+
+// Distance kernels over packed float32 vectors, used by FLOAT32 vector fields.
+//
+// The implementation is picked once according to the running CPU: AVX-512F, AVX2 with FMA,
+// or a portable one which the compiler is free to vectorize for the target architecture.
+// A kernel accumulates in float32, so the result may differ from the float64 one in the
+// last few bits.
+struct VectorDistanceKernels {
+  const char *name;
+  float (*l2_squared)(const float *left, const float *right, size_t dim);
+  float (*inner_product)(const float *left, const float *right, size_t dim);
+  // Computes the inner product and both squared norms in one pass, for the cosine distance
+  void (*cosine_terms)(const float *left, const float *right, size_t dim, float *dot, float *norm_left,
+                       float *norm_right);
+};
+
+const VectorDistanceKernels &GetVectorDistanceKernels();
+
+// The portable kernels, exposed for testing and benchmarking the dispatched ones against
+const VectorDistanceKernels &GetScalarVectorDistanceKernels();
+
+}  // namespace redis
@@ -65,6 +65,7 @@ Connection::~Connection() {
   // unsubscribe all channels and patterns if exists
   UnsubscribeAll();
   PUnsubscribeAll();
+  if (IsFlagEnabled(kTracking)) srv_->tracking.Disable(id_);
 }
 
 std::string Connection::ToString() {
@@ -173,6 +174,7 @@ std::string Connection::GetFlags() const {
   if (IsFlagEnabled(kCloseAfterReply)) flags.append("c");
   if (IsFlagEnabled(kMonitor)) flags.append("M");
   if (IsFlagEnabled(kAsking)) flags.append("A");
+  if (IsFlagEnabled(kTracking)) flags.append("t");
   if (!subscribe_channels_.empty() || !subscribe_patterns_.empty()) flags.append("P");
   if (flags.empty()) flags = "N";
   return flags;
@@ -188,7 +190,8 @@ bool Connection::CanMigrate() const {
   return !is_running_                                                    // reading or writing
          && !IsFlagEnabled(redis::Connection::kCloseAfterReply)          // close after reply
          && saved_current_command_ == nullptr                            // not executing blocking command like BLPOP
-         && subscribe_channels_.empty() && subscribe_patterns_.empty();  // not subscribing any channel
+         && subscribe_channels_.empty() && subscribe_patterns_.empty()   // not subscribing any channel
+         && !IsFlagEnabled(redis::Connection::kTracking);                // invalidations are sent by worker and fd
 }
 
 void Connection::SubscribeChannel(const std::string &channel) {
@@ -346,17 +349,31 @@ void Connection::RecordProfilingSampleIfNeed(const std::string &cmd, uint64_t du
 
 Status Connection::ExecuteCommand(const std::string &cmd_name, const std::vector<std::string> &cmd_tokens,
                                   Commander *current_cmd, std::string *reply) {
-  srv_->stats.IncrCalls(cmd_name);
+  return executeCommand(cmd_name, cmd_tokens, current_cmd, [&] { return current_cmd->Execute(srv_, this, reply); });
+}
+
+Status Connection::ExecuteCommand(const std::string &cmd_name, const std::vector<std::string> &cmd_tokens,
+                                  Commander *current_cmd, ReplyBuilder *builder) {
+  return executeCommand(cmd_name, cmd_tokens, current_cmd,
+                        [&] { return current_cmd->ExecuteWithReplyBuilder(srv_, this, builder); });
+}
+
+template <typename F>
+Status Connection::executeCommand(const std::string &cmd_name, const std::vector<std::string> &cmd_tokens,
+                                  Commander *current_cmd, F &&execute) {
+  auto command_id = current_cmd->GetAttributes()->id;
+  srv_->stats.IncrCalls(command_id);
 
   auto start = std::chrono::high_resolution_clock::now();
   bool is_profiling = IsProfilingEnabled(cmd_name);
-  auto s = current_cmd->Execute(srv_, this, reply);
+  auto s = std::forward<F>(execute)();
   auto end = std::chrono::high_resolution_clock::now();
   uint64_t duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
   if (is_profiling) RecordProfilingSampleIfNeed(cmd_name, duration);
 
   srv_->SlowlogPushEntryIfNeeded(&cmd_tokens, duration, this);
-  srv_->stats.IncrLatency(static_cast<uint64_t>(duration), cmd_name);
+  srv_->stats.IncrLatency(static_cast<uint64_t>(duration), command_id);
+  srv_->storage->GetLatencyMonitor()->AddSampleIfNeeded("command", duration / 1000);
   srv_->FeedMonitorConns(this, cmd_tokens);
   return s;
 }
@@ -414,23 +431,18 @@ void Connection::ExecuteCommands(std::deque<CommandTokens> *to_process_cmds) {
     // that can guarantee other threads can't come into critical zone, such as DEBUG,
     // CLUSTER subcommand, CONFIG SET, MULTI, LUA (in the immediate future).
     // Otherwise, we just use 'ConcurrencyGuard' to allow all workers to execute commands at the same time.
+    // The Lua scripts declaring their keys lock the keys instead if lua-key-locking-enabled,
+    // and so does EXEC with the keys of the queued commands if txn-key-locking-enabled.
+    bool key_locking = (cmd_flags & kCmdKeyLocking) && config->lua_key_locking_enabled;
+    if (is_multi_exec && cmd_name == "exec") key_locking = CanExecWithKeyLocks();
     if (is_multi_exec && cmd_name != "exec") {
-      // No lock guard, because 'exec' command has acquired 'WorkExclusivityGuard'
-    } else if (cmd_flags & kCmdExclusive) {
+      // No lock guard, because 'exec' command has acquired 'WorkExclusivityGuard' or the key locks
+    } else if ((cmd_flags & kCmdExclusive) && !key_locking) {
       exclusivity = srv_->WorkExclusivityGuard();
-
-      // When executing lua script commands that have "exclusive" attribute, we need to know current connection,
-      // but we should set current connection after acquiring the WorkExclusivityGuard to make it thread-safe
-      srv_->SetCurrentConnection(this);
     } else {
       concurrency = srv_->WorkConcurrencyGuard();
     }
 
-    if (cmd_flags & kCmdROScript) {
-      // if executing read only lua script commands, set current connection.
-      srv_->SetCurrentConnection(this);
-    }
-
     if (srv_->IsLoading() && !(cmd_flags & kCmdLoading)) {
       Reply(redis::Error({Status::RedisLoading, errRestoringBackup}));
       if (is_multi_exec) multi_error_ = true;
@@ -474,6 +486,7 @@ void Connection::ExecuteCommands(std::deque<CommandTokens> *to_process_cmds) {
 
     // We don't execute commands, but queue them, ant then execute in EXEC command
     if (is_multi_exec && !in_exec_ && !(cmd_flags & kCmdMulti)) {
+      addMultiExecKeys(*attributes, cmd_flags, cmd_tokens);
       multi_cmds_.emplace_back(cmd_tokens);
       Reply(redis::SimpleString("QUEUED"));
       continue;
@@ -517,6 +530,8 @@ void Connection::ExecuteCommands(std::deque<CommandTokens> *to_process_cmds) {
           cmd_tokens);
     }
 
+    if (!srv_->tracking.Empty()) srv_->TrackReadKeysFromArgs(this, cmd_tokens, *attributes);
+
     SetLastCmd(cmd_name);
     s = ExecuteCommand(cmd_name, cmd_tokens, current_cmd.get(), &reply);
 
@@ -546,6 +561,14 @@ void Connection::ExecuteCommands(std::deque<CommandTokens> *to_process_cmds) {
     }
 
     srv_->UpdateWatchedKeysFromArgs(cmd_tokens, *attributes);
+    if (!srv_->tracking.Empty() && (attributes->flags & kCmdWrite)) {
+      // the writes of EXEC aren't visible to the other clients until the transaction is committed
+      if (in_exec_) {
+        exec_writes_.emplace_back(attributes, cmd_tokens);
+      } else {
+        srv_->InvalidateKeysFromArgs(this, cmd_tokens, *attributes);
+      }
+    }
 
     if (!reply.empty()) Reply(reply);
     reply.clear();
@@ -556,7 +579,40 @@ void Connection::ResetMultiExec() {
   in_exec_ = false;
   multi_error_ = false;
   multi_cmds_.clear();
+  multi_keys_.clear();
+  multi_needs_exclusivity_ = false;
+  exec_writes_.clear();
   DisableFlag(Connection::kMultiExec);
 }
 
+void Connection::SendExecInvalidations() {
+  for (const auto &[attributes, cmd_tokens] : exec_writes_) {
+    srv_->InvalidateKeysFromArgs(this, cmd_tokens, *attributes);
+  }
+  exec_writes_.clear();
+}
+
+bool Connection::CanExecWithKeyLocks() const {
+  // the watched keys can be modified by the other workers right before EXEC locks the keys,
+  // which is only noticed under the exclusivity
+  return srv_->GetConfig()->txn_key_locking_enabled && !multi_needs_exclusivity_ && watched_keys.empty();
+}
+
+void Connection::addMultiExecKeys(const CommandAttributes &attributes, uint64_t cmd_flags,
+                                  const CommandTokens &cmd_tokens) {
+  if (multi_needs_exclusivity_) return;
+
+  size_t keys_num = multi_keys_.size();
+  attributes.ForEachKeyRange(
+      [this](const std::vector<std::string> &args, const CommandKeyRange &key_range) {
+        key_range.ForEachKey([this](const std::string &key) { multi_keys_.emplace_back(key); }, args);
+      },
+      cmd_tokens);
+  // the keys out of the key range wouldn't be locked by EXEC
+  if ((cmd_flags & (kCmdExclusive | kCmdUnlistedKeys)) || multi_keys_.size() == keys_num) {
+    multi_needs_exclusivity_ = true;
+    multi_keys_.clear();
+  }
+}
+
 }  // namespace redis
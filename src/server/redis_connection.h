@@ -30,6 +30,7 @@
 #include <vector>
 
 #include "commands/commander.h"
+#include "compression_util.h"
 #include "event_util.h"
 #include "redis_request.h"
 #include "server/redis_reply.h"
@@ -48,6 +49,7 @@ class Connection : public EvbufCallbackBase<Connection> {
     kMultiExec = 1 << 8,
     kReadOnly = 1 << 9,
     kAsking = 1 << 10,
+    kTracking = 1 << 11,
   };
 
   explicit Connection(bufferevent *bev, Worker *owner);
@@ -140,6 +142,11 @@ class Connection : public EvbufCallbackBase<Connection> {
   std::string GetAnnounceIP() const { return !announce_ip_.empty() ? announce_ip_ : ip_; }
   uint32_t GetAnnouncePort() const { return listening_port_ != 0 ? listening_port_ : port_; }
   std::string GetAnnounceAddr() const { return GetAnnounceIP() + ":" + std::to_string(GetAnnouncePort()); }
+  void SetStreamCompression(StreamCompression type) { stream_compression_ = type; }
+  StreamCompression GetStreamCompression() const { return stream_compression_; }
+  // whether the replica acknowledges the applied sequence, see REPLCONF CAPA ACK
+  void EnableReplAck() { repl_ack_ = true; }
+  bool IsReplAckEnabled() const { return repl_ack_; }
   uint64_t GetClientType() const;
   Server *GetServer() { return srv_; }
 
@@ -162,6 +169,8 @@ class Connection : public EvbufCallbackBase<Connection> {
   void ExecuteCommands(std::deque<CommandTokens> *to_process_cmds);
   Status ExecuteCommand(const std::string &cmd_name, const std::vector<std::string> &cmd_tokens, Commander *current_cmd,
                         std::string *reply);
+  Status ExecuteCommand(const std::string &cmd_name, const std::vector<std::string> &cmd_tokens, Commander *current_cmd,
+                        ReplyBuilder *builder);
   bool IsProfilingEnabled(const std::string &cmd);
   void RecordProfilingSampleIfNeed(const std::string &cmd, uint64_t duration);
   void SetImporting() { importing_ = true; }
@@ -174,6 +183,12 @@ class Connection : public EvbufCallbackBase<Connection> {
   bool IsMultiError() const { return multi_error_; }
   void ResetMultiExec();
   std::deque<redis::CommandTokens> *GetMultiExecCommands() { return &multi_cmds_; }
+  // Whether EXEC can run the queued commands holding the locks of their keys
+  // instead of exclusively, see txn-key-locking-enabled
+  bool CanExecWithKeyLocks() const;
+  const std::vector<std::string> &GetMultiExecKeys() const { return multi_keys_; }
+  // Send the invalidations of the keys written by EXEC to the tracking clients once the transaction is committed
+  void SendExecInvalidations();
 
   std::function<void(int)> close_cb = nullptr;
 
@@ -190,6 +205,8 @@ class Connection : public EvbufCallbackBase<Connection> {
   uint32_t port_ = 0;
   std::string addr_;
   int listening_port_ = 0;
+  StreamCompression stream_compression_ = StreamCompression::kNone;
+  bool repl_ack_ = false;
   bool is_admin_ = false;
   bool need_free_bev_ = true;
   std::string last_cmd_;
@@ -210,9 +227,19 @@ class Connection : public EvbufCallbackBase<Connection> {
   bool multi_error_ = false;
   std::atomic<bool> is_running_ = false;
   std::deque<redis::CommandTokens> multi_cmds_;
+  // the keys of the queued commands, unless any of them has no keys or runs exclusively
+  std::vector<std::string> multi_keys_;
+  bool multi_needs_exclusivity_ = false;
+  // the writes run by EXEC, whose keys are invalidated after the transaction is committed
+  std::vector<std::pair<const CommandAttributes *, CommandTokens>> exec_writes_;
 
   bool importing_ = false;
   RESP protocol_version_ = RESP::v2;
+
+  void addMultiExecKeys(const CommandAttributes &attributes, uint64_t cmd_flags, const CommandTokens &cmd_tokens);
+  template <typename F>
+  Status executeCommand(const std::string &cmd_name, const std::vector<std::string> &cmd_tokens, Commander *current_cmd,
+                        F &&execute);
 };
 
 }  // namespace redis
@@ -37,6 +37,21 @@ namespace redis {
 
 void Reply(evbuffer *output, const std::string &data) { evbuffer_add(output, data.c_str(), data.length()); }
 
+void Reply(evbuffer *output, const std::string &header, const SharedReply &body) {
+  evbuffer_lock(output);
+  evbuffer_add(output, header.data(), header.size());
+  bool referenced = false;
+  if (body->size() >= SHARED_REPLY_REFERENCE_SIZE) {
+    // The output buffer holds its own reference of the body until the data is drained
+    auto holder = new SharedReply(body);
+    auto cleanup = [](const void *, size_t, void *arg) { delete static_cast<SharedReply *>(arg); };
+    referenced = evbuffer_add_reference(output, body->data(), body->size(), cleanup, holder) == 0;
+    if (!referenced) delete holder;
+  }
+  if (!referenced) evbuffer_add(output, body->data(), body->size());
+  evbuffer_unlock(output);
+}
+
 std::string SimpleString(const std::string &data) { return "+" + data + CRLF; }
 
 std::string Error(const Status &s) { return RESP_PREFIX_ERROR + StatusToRedisErrorMsg(s) + CRLF; }
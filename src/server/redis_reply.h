@@ -23,7 +23,9 @@
 #include <event2/buffer.h>
 
 #include <map>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "rocksdb/status.h"
@@ -39,8 +41,28 @@ namespace redis {
 enum class RESP { v2, v3 };
 
 void Reply(evbuffer *output, const std::string &data);
+
+// A reply body shared by many connections, e.g. the message of a PUBLISH fanned out
+// to all subscribers. Bodies of at least SHARED_REPLY_REFERENCE_SIZE bytes are added
+// to the output buffers by reference, so they are not copied once per connection.
+using SharedReply = std::shared_ptr<const std::string>;
+constexpr size_t SHARED_REPLY_REFERENCE_SIZE = 1024;
+
+// Appends the header followed by the shared body, atomically relative to other writers of the output.
+void Reply(evbuffer *output, const std::string &header, const SharedReply &body);
 std::string SimpleString(const std::string &data);
 
+// Receives the reply of a command as values instead of the RESP output, so the callers which don't send it
+// to a client, like redis.call() in the scripts, can skip encoding and parsing it. The commands which don't
+// build their replies this way pass their RESP output to RESPReply.
+class ReplyBuilder {
+ public:
+  virtual ~ReplyBuilder() = default;
+  virtual void NilString() = 0;
+  virtual void BulkString(std::string_view data) = 0;
+  virtual void RESPReply(const std::string &output) = 0;
+};
+
 std::string Error(const Status &s);
 std::string StatusToRedisErrorMsg(const Status &s);
 
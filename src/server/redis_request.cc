@@ -23,8 +23,12 @@
 #include <glog/logging.h>
 #include <rocksdb/perf_context.h>
 
+#include <algorithm>
+#include <charconv>
 #include <chrono>
 #include <memory>
+#include <optional>
+#include <string_view>
 #include <utility>
 
 #include "cluster/redis_slot.h"
@@ -36,79 +40,136 @@
 
 namespace redis {
 
+namespace {
+
+// the longest `*<multibulk length>` or `$<bulk length>` line, a longer one can't hold a valid length
+constexpr size_t PROTO_MAX_LENGTH_LINE_SIZE = 32;
+
+// Locate the line at the front of the buffer, return the length of the line without the EOL,
+// or nullopt if there's no complete line yet
+std::optional<size_t> FindLine(evbuffer *input, evbuffer_eol_style eol_style, size_t *eol_len) {
+  auto eol = evbuffer_search_eol(input, nullptr, eol_len, eol_style);
+  if (eol.pos < 0) return std::nullopt;
+  return static_cast<size_t>(eol.pos);
+}
+
+// View the first `len` bytes of the buffer in place if they're in its first chunk,
+// otherwise they're copied to `buf`, which must have room for `len` bytes
+std::string_view PeekBytes(evbuffer *input, size_t len, char *buf) {
+  evbuffer_iovec chunk;
+  if (evbuffer_peek(input, -1, nullptr, &chunk, 1) > 0 && chunk.iov_len >= len) {
+    return {static_cast<const char *>(chunk.iov_base), len};
+  }
+  evbuffer_copyout(input, buf, len);
+  return {buf, len};
+}
+
+template <typename T>
+std::optional<T> ParseLength(std::string_view str) {
+  T value = 0;
+  auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+  if (ec != std::errc() || end != str.data() + str.size()) return std::nullopt;
+  return value;
+}
+
+}  // namespace
+
+Request::Request(Server *srv) : Request(&srv->stats, srv->GetConfig()) {}
+
 Status Request::Tokenize(evbuffer *input) {
   size_t pipeline_size = 0;
+  char line_buf[PROTO_MAX_LENGTH_LINE_SIZE];
 
   while (true) {
     switch (state_) {
       case ArrayLen: {
-        bool is_only_lf = true;
         // We don't use the `EVBUFFER_EOL_CRLF_STRICT` here since only LF is allowed in INLINE protocol.
         // So we need to search LF EOL and figure out current line has CR or not.
-        UniqueEvbufReadln line(input, EVBUFFER_EOL_LF);
-        if (line && line.length > 0 && line[line.length - 1] == '\r') {
-          // remove `\r` if exists
-          --line.length;
-          is_only_lf = false;
-        }
-
-        if (!line || line.length <= 0) {
+        size_t eol_len = 0;
+        auto line_len = FindLine(input, EVBUFFER_EOL_LF, &eol_len);
+        if (!line_len) {
           if (pipeline_size > 128) {
             LOG(INFO) << "Large pipeline detected: " << pipeline_size;
           }
-          if (line) {
-            continue;
-          }
           return Status::OK();
         }
 
-        pipeline_size++;
-        srv_->stats.IncrInboundBytes(line.length);
-        if (line[0] == '*') {
-          auto parse_result = ParseInt<int64_t>(std::string(line.get() + 1, line.length - 1), 10);
-          if (!parse_result) {
-            return {Status::NotOK, "Protocol error: invalid multibulk length"};
-          }
-
-          multi_bulk_len_ = *parse_result;
-          if (is_only_lf || multi_bulk_len_ > (int64_t)PROTO_MULTI_MAX_SIZE) {
-            return {Status::NotOK, "Protocol error: invalid multibulk length"};
-          }
-
-          if (multi_bulk_len_ <= 0) {
-            multi_bulk_len_ = 0;
-            continue;
-          }
+        char first = 0;
+        if (*line_len > 0) evbuffer_copyout(input, &first, 1);
+        if (first != '*') {
+          std::string line(*line_len, '\0');
+          evbuffer_remove(input, line.data(), line.size());
+          evbuffer_drain(input, eol_len);
+          // remove `\r` if exists
+          if (!line.empty() && line.back() == '\r') line.pop_back();
+          if (line.empty()) continue;
 
-          state_ = BulkLen;
-        } else {
-          if (line.length > PROTO_INLINE_MAX_SIZE) {
+          pipeline_size++;
+          stats_->IncrInboundBytes(line.size());
+          if (line.size() > PROTO_INLINE_MAX_SIZE) {
             return {Status::NotOK, "Protocol error: invalid bulk length"};
           }
 
-          tokens_ = util::Split(std::string(line.get(), line.length), " \t");
+          tokens_ = util::Split(line, " \t");
           if (tokens_.empty()) continue;
           commands_.emplace_back(std::move(tokens_));
           state_ = ArrayLen;
+          break;
+        }
+
+        if (*line_len > PROTO_MAX_LENGTH_LINE_SIZE) {
+          return {Status::NotOK, "Protocol error: invalid multibulk length"};
+        }
+        auto line = PeekBytes(input, *line_len, line_buf);
+        bool is_only_lf = line.back() != '\r';
+        if (!is_only_lf) line.remove_suffix(1);
+
+        pipeline_size++;
+        stats_->IncrInboundBytes(line.size());
+        auto parse_result = ParseLength<int64_t>(line.substr(1));
+        evbuffer_drain(input, *line_len + eol_len);
+        if (!parse_result) {
+          return {Status::NotOK, "Protocol error: invalid multibulk length"};
         }
+
+        multi_bulk_len_ = *parse_result;
+        if (is_only_lf || multi_bulk_len_ > (int64_t)PROTO_MULTI_MAX_SIZE) {
+          return {Status::NotOK, "Protocol error: invalid multibulk length"};
+        }
+
+        if (multi_bulk_len_ <= 0) {
+          multi_bulk_len_ = 0;
+          continue;
+        }
+
+        tokens_.reserve(std::min<size_t>(multi_bulk_len_, 1024));
+        state_ = BulkLen;
         break;
       }
       case BulkLen: {
-        UniqueEvbufReadln line(input, EVBUFFER_EOL_CRLF_STRICT);
-        if (!line || line.length <= 0) return Status::OK();
+        size_t eol_len = 0;
+        auto line_len = FindLine(input, EVBUFFER_EOL_CRLF_STRICT, &eol_len);
+        if (!line_len) return Status::OK();
+        if (*line_len == 0) {
+          evbuffer_drain(input, eol_len);
+          return Status::OK();
+        }
 
-        srv_->stats.IncrInboundBytes(line.length);
+        auto line = PeekBytes(input, std::min(*line_len, PROTO_MAX_LENGTH_LINE_SIZE), line_buf);
+        stats_->IncrInboundBytes(*line_len);
         if (line[0] != '$') {
           return {Status::NotOK, "Protocol error: expected '$'"};
         }
 
-        auto parse_result = ParseInt<uint64_t>(std::string(line.get() + 1, line.length - 1), 10);
+        std::optional<uint64_t> parse_result;
+        if (*line_len <= PROTO_MAX_LENGTH_LINE_SIZE) parse_result = ParseLength<uint64_t>(line.substr(1));
+        evbuffer_drain(input, *line_len + eol_len);
         if (!parse_result) {
           return {Status::NotOK, "Protocol error: invalid bulk length"};
         }
 
         bulk_len_ = *parse_result;
-        if (bulk_len_ > srv_->GetConfig()->proto_max_bulk_len) {
+        if (bulk_len_ > config_->proto_max_bulk_len) {
           return {Status::NotOK, "Protocol error: invalid bulk length"};
         }
 
@@ -118,10 +179,17 @@ Status Request::Tokenize(evbuffer *input) {
       case BulkData:
         if (evbuffer_get_length(input) < bulk_len_ + 2) return Status::OK();
 
-        char *data = reinterpret_cast<char *>(evbuffer_pullup(input, static_cast<ssize_t>(bulk_len_ + 2)));
-        tokens_.emplace_back(data, bulk_len_);
+        // copy the argument from the chunks of the buffer into the token directly, instead of
+        // making the buffer contiguous first with evbuffer_pullup
+        evbuffer_iovec chunk;
+        if (evbuffer_peek(input, -1, nullptr, &chunk, 1) > 0 && chunk.iov_len >= bulk_len_) {
+          tokens_.emplace_back(static_cast<const char *>(chunk.iov_base), bulk_len_);
+        } else {
+          auto &token = tokens_.emplace_back(bulk_len_, '\0');
+          evbuffer_copyout(input, token.data(), bulk_len_);
+        }
         evbuffer_drain(input, bulk_len_ + 2);
-        srv_->stats.IncrInboundBytes(bulk_len_ + 2);
+        stats_->IncrInboundBytes(bulk_len_ + 2);
         --multi_bulk_len_;
         if (multi_bulk_len_ == 0) {
           state_ = ArrayLen;
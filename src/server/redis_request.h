@@ -28,7 +28,9 @@
 
 #include "status.h"
 
+struct Config;
 class Server;
+class Stats;
 
 namespace redis {
 
@@ -41,7 +43,8 @@ class Connection;
 
 class Request {
  public:
-  explicit Request(Server *srv) : srv_(srv) {}
+  explicit Request(Server *srv);
+  Request(Stats *stats, Config *config) : stats_(stats), config_(config) {}
   ~Request() = default;
 
   // Not copyable
@@ -49,6 +52,9 @@ class Request {
   Request &operator=(const Request &) = delete;
 
   // Parse the redis requests (bulk string array format)
+  //
+  // The lines and arguments are scanned in place in the chunks of the input buffer, every
+  // argument is copied once, straight from the buffer into its token.
   Status Tokenize(evbuffer *input);
 
   std::deque<CommandTokens> *GetCommands() { return &commands_; }
@@ -63,7 +69,8 @@ class Request {
   CommandTokens tokens_;
   std::deque<CommandTokens> commands_;
 
-  Server *srv_;
+  Stats *stats_;
+  Config *config_;
 };
 
 }  // namespace redis
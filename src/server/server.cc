@@ -27,6 +27,7 @@
 #include <sys/statvfs.h>
 #include <sys/utsname.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
 #include <functional>
@@ -42,6 +43,7 @@
 #include "config/config.h"
 #include "fmt/format.h"
 #include "redis_connection.h"
+#include "storage/active_expire.h"
 #include "storage/compaction_checker.h"
 #include "storage/redis_db.h"
 #include "storage/scripting.h"
@@ -58,13 +60,10 @@ Server::Server(engine::Storage *storage, Config *config)
       index_mgr(&indexer, storage),
       start_time_secs_(util::GetTimeStamp()),
       config_(config),
+      repl_wal_reader_(storage),
       namespace_(storage) {
-  // init commands stats here to prevent concurrent insert, and cause core
-  auto commands = redis::CommandTable::GetOriginal();
-  for (const auto &iter : *commands) {
-    stats.commands_stats[iter.first].calls = 0;
-    stats.commands_stats[iter.first].latency = 0;
-  }
+  // the commands stats are indexed by the command IDs, all commands are registered before the server starts
+  stats.InitCommandStats(redis::CommandTable::Size());
 
   // init cursor_dict_
   cursor_dict_ = std::make_unique<CursorDictType>();
@@ -157,7 +156,10 @@ Status Server::Start() {
     }
   }
 
+  tracking.SetMaxKeys(static_cast<size_t>(config_->tracking_table_max_keys));
+
   if (!config_->cluster_enabled) {
+    indexer.hnsw_cache.SetCapacity(static_cast<size_t>(config_->hnsw_cache_size) * MiB);
     GET_OR_RET(index_mgr.Load(kDefaultNamespace));
     for (auto [_, ns] : namespace_.List()) {
       GET_OR_RET(index_mgr.Load(ns));
@@ -225,6 +227,25 @@ Status Server::Start() {
     }
   }));
 
+  active_expire_thread_ = GET_OR_RET(util::CreateThread("active-expire", [this] {
+    ActiveExpirer expirer{this->storage};
+
+    while (!stop_) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+      auto max_keys = config_->active_expire_keys_per_cycle;
+      if (max_keys <= 0 || IsSlave()) continue;
+
+      // Run like a write command, so the DB isn't closed under it and its batches
+      // don't get into a transaction of MULTI/EXEC
+      auto concurrency = WorkConcurrencyGuard();
+      if (is_loading_ || storage->IsClosing()) continue;
+      std::vector<std::string> expired_keys;
+      expirer.RunCycle(static_cast<uint64_t>(max_keys), tracking.Empty() ? nullptr : &expired_keys);
+      if (!expired_keys.empty()) InvalidateNsKeys(expired_keys);
+    }
+  }));
+
   memory_startup_use_.store(Stats::GetMemoryRSS(), std::memory_order_relaxed);
   LOG(INFO) << "[server] Ready to accept connections";
 
@@ -253,6 +274,9 @@ void Server::Join() {
   if (auto s = util::ThreadJoin(compaction_checker_thread_); !s) {
     LOG(WARNING) << "Compaction checker thread operation failed: " << s.Msg();
   }
+  if (auto s = util::ThreadJoin(active_expire_thread_); !s) {
+    LOG(WARNING) << "Active expire thread operation failed: " << s.Msg();
+  }
   if (auto s = task_runner_.Join(); !s) {
     LOG(WARNING) << s.Msg();
   }
@@ -316,13 +340,18 @@ Status Server::RemoveMaster() {
 }
 
 Status Server::AddSlave(redis::Connection *conn, rocksdb::SequenceNumber next_repl_seq) {
+  // Checked under the lock since the slot importer counts the replicas after starting to import SST files
+  std::lock_guard<std::mutex> lg(slave_threads_mu_);
+  if (storage->IsImportingSST()) {
+    return {Status::NotOK, "SST files are being imported"};
+  }
+
   auto t = std::make_unique<FeedSlaveThread>(this, conn, next_repl_seq);
   auto s = t->Start();
   if (!s.IsOK()) {
     return s;
   }
 
-  std::lock_guard<std::mutex> lg(slave_threads_mu_);
   slave_threads_.emplace_back(std::move(t));
   return Status::OK();
 }
@@ -339,6 +368,58 @@ void Server::DisconnectSlaves() {
     slave_threads_.pop_front();
     slave_thread->Join();
   }
+  // the cached batches may be stale once the DB is replaced by the new master's
+  repl_wal_reader_.Reset();
+}
+
+void Server::BlockOnReplAck(redis::Connection *conn, rocksdb::SequenceNumber seq, int num_replicas) {
+  std::lock_guard<std::mutex> guard(repl_ack_mu_);
+  repl_ack_waiters_.push_back({ConnContext(conn->Owner(), conn->GetFD()), seq, num_replicas});
+  repl_ack_waiters_num_.fetch_add(1, std::memory_order_relaxed);
+  IncrBlockedClientNum();
+}
+
+void Server::UnblockOnReplAck(redis::Connection *conn) {
+  std::lock_guard<std::mutex> guard(repl_ack_mu_);
+  for (auto iter = repl_ack_waiters_.begin(); iter != repl_ack_waiters_.end(); ++iter) {
+    if (conn->GetFD() == iter->conn_ctx.fd && conn->Owner() == iter->conn_ctx.owner) {
+      repl_ack_waiters_.erase(iter);
+      repl_ack_waiters_num_.fetch_sub(1, std::memory_order_relaxed);
+      DecrBlockedClientNum();
+      break;
+    }
+  }
+}
+
+int Server::GetReplicasAcked(rocksdb::SequenceNumber seq) {
+  std::lock_guard<std::mutex> guard(repl_ack_mu_);
+  return static_cast<int>(std::count_if(replica_acks_.begin(), replica_acks_.end(),
+                                        [seq](const auto &ack) { return ack.second >= seq; }));
+}
+
+void Server::UpdateReplicaAck(const FeedSlaveThread *replica, rocksdb::SequenceNumber seq) {
+  std::lock_guard<std::mutex> guard(repl_ack_mu_);
+  replica_acks_[replica] = seq;
+
+  // wake up the waiters which have got enough acks, they're kept until unblocked
+  // since the replicas may be gone before the waiters are resumed
+  for (const auto &waiter : repl_ack_waiters_) {
+    if (seq < waiter.seq) continue;
+    auto acked = std::count_if(replica_acks_.begin(), replica_acks_.end(),
+                               [&waiter](const auto &ack) { return ack.second >= waiter.seq; });
+    if (acked < waiter.num_replicas) continue;
+
+    auto s = waiter.conn_ctx.owner->EnableWriteEvent(waiter.conn_ctx.fd);
+    if (!s.IsOK()) {
+      LOG(ERROR) << "[server] Failed to enable write event on the WAIT client " << waiter.conn_ctx.fd << ": "
+                 << s.Msg();
+    }
+  }
+}
+
+void Server::RemoveReplicaAck(const FeedSlaveThread *replica) {
+  std::lock_guard<std::mutex> guard(repl_ack_mu_);
+  replica_acks_.erase(replica);
 }
 
 void Server::CleanupExitedSlaves() {
@@ -375,53 +456,44 @@ void Server::FeedMonitorConns(redis::Connection *conn, const std::vector<std::st
 
 int Server::PublishMessage(const std::string &channel, const std::string &msg) {
   int cnt = 0;
-  int index = 0;
-
-  pubsub_channels_mu_.lock();
 
   std::vector<ConnContext> to_publish_conn_ctxs;
-  if (auto iter = pubsub_channels_.find(channel); iter != pubsub_channels_.end()) {
-    for (const auto &conn_ctx : iter->second) {
-      to_publish_conn_ctxs.emplace_back(conn_ctx);
-    }
-  }
+  // The matched patterns and the connections subscribing each of them
+  std::vector<std::pair<std::string, std::vector<ConnContext>>> to_publish_patterns;
+  {
+    std::shared_lock<std::shared_mutex> guard(pubsub_channels_mu_);
 
-  // The patterns variable records the pattern of connections
-  std::vector<std::string> patterns;
-  std::vector<ConnContext> to_publish_patterns_conn_ctxs;
-  for (const auto &iter : pubsub_patterns_) {
-    if (util::StringMatch(iter.first, channel, 0)) {
-      for (const auto &conn_ctx : iter.second) {
-        to_publish_patterns_conn_ctxs.emplace_back(conn_ctx);
-        patterns.emplace_back(iter.first);
-      }
+    if (auto iter = pubsub_channels_.find(channel); iter != pubsub_channels_.end()) {
+      to_publish_conn_ctxs.assign(iter->second.begin(), iter->second.end());
     }
+
+    pubsub_patterns_.Match(channel, [&](const std::string &pattern, const std::list<ConnContext> &conn_ctxs) {
+      to_publish_patterns.emplace_back(pattern, std::vector<ConnContext>(conn_ctxs.begin(), conn_ctxs.end()));
+    });
   }
-  pubsub_channels_mu_.unlock();
 
-  std::string channel_reply;
-  channel_reply.append(redis::MultiLen(3));
-  channel_reply.append(redis::BulkString("message"));
-  channel_reply.append(redis::BulkString(channel));
-  channel_reply.append(redis::BulkString(msg));
-  for (const auto &conn_ctx : to_publish_conn_ctxs) {
-    auto s = conn_ctx.owner->Reply(conn_ctx.fd, channel_reply);
-    if (s.IsOK()) {
-      cnt++;
+  // The channel and message are the same for all subscribers, so build them once
+  // and share the buffer instead of copying the message for each connection.
+  auto body = std::make_shared<const std::string>(redis::BulkString(channel) + redis::BulkString(msg));
+
+  if (!to_publish_conn_ctxs.empty()) {
+    std::string channel_header = redis::MultiLen(3) + redis::BulkString("message");
+    for (const auto &conn_ctx : to_publish_conn_ctxs) {
+      auto s = conn_ctx.owner->Reply(conn_ctx.fd, channel_header, body);
+      if (s.IsOK()) {
+        cnt++;
+      }
     }
   }
 
   // We should publish corresponding pattern and message for connections
-  for (const auto &conn_ctx : to_publish_patterns_conn_ctxs) {
-    std::string pattern_reply;
-    pattern_reply.append(redis::MultiLen(4));
-    pattern_reply.append(redis::BulkString("pmessage"));
-    pattern_reply.append(redis::BulkString(patterns[index++]));
-    pattern_reply.append(redis::BulkString(channel));
-    pattern_reply.append(redis::BulkString(msg));
-    auto s = conn_ctx.owner->Reply(conn_ctx.fd, pattern_reply);
-    if (s.IsOK()) {
-      cnt++;
+  for (const auto &[pattern, conn_ctxs] : to_publish_patterns) {
+    std::string pattern_header = redis::MultiLen(4) + redis::BulkString("pmessage") + redis::BulkString(pattern);
+    for (const auto &conn_ctx : conn_ctxs) {
+      auto s = conn_ctx.owner->Reply(conn_ctx.fd, pattern_header, body);
+      if (s.IsOK()) {
+        cnt++;
+      }
     }
   }
 
@@ -429,7 +501,7 @@ int Server::PublishMessage(const std::string &channel, const std::string &msg) {
 }
 
 void Server::SubscribeChannel(const std::string &channel, redis::Connection *conn) {
-  std::lock_guard<std::mutex> guard(pubsub_channels_mu_);
+  std::unique_lock<std::shared_mutex> guard(pubsub_channels_mu_);
 
   auto conn_ctx = ConnContext(conn->Owner(), conn->GetFD());
   if (auto iter = pubsub_channels_.find(channel); iter == pubsub_channels_.end()) {
@@ -440,7 +512,7 @@ void Server::SubscribeChannel(const std::string &channel, redis::Connection *con
 }
 
 void Server::UnsubscribeChannel(const std::string &channel, redis::Connection *conn) {
-  std::lock_guard<std::mutex> guard(pubsub_channels_mu_);
+  std::unique_lock<std::shared_mutex> guard(pubsub_channels_mu_);
 
   auto iter = pubsub_channels_.find(channel);
   if (iter == pubsub_channels_.end()) {
@@ -459,7 +531,7 @@ void Server::UnsubscribeChannel(const std::string &channel, redis::Connection *c
 }
 
 void Server::GetChannelsByPattern(const std::string &pattern, std::vector<std::string> *channels) {
-  std::lock_guard<std::mutex> guard(pubsub_channels_mu_);
+  std::shared_lock<std::shared_mutex> guard(pubsub_channels_mu_);
 
   for (const auto &iter : pubsub_channels_) {
     if (pattern.empty() || util::StringMatch(pattern, iter.first, 0)) {
@@ -470,7 +542,7 @@ void Server::GetChannelsByPattern(const std::string &pattern, std::vector<std::s
 
 void Server::ListChannelSubscribeNum(const std::vector<std::string> &channels,
                                      std::vector<ChannelSubscribeNum> *channel_subscribe_nums) {
-  std::lock_guard<std::mutex> guard(pubsub_channels_mu_);
+  std::shared_lock<std::shared_mutex> guard(pubsub_channels_mu_);
 
   for (const auto &chan : channels) {
     if (auto iter = pubsub_channels_.find(chan); iter != pubsub_channels_.end()) {
@@ -482,29 +554,24 @@ void Server::ListChannelSubscribeNum(const std::vector<std::string> &channels,
 }
 
 void Server::PSubscribeChannel(const std::string &pattern, redis::Connection *conn) {
-  std::lock_guard<std::mutex> guard(pubsub_channels_mu_);
+  std::unique_lock<std::shared_mutex> guard(pubsub_channels_mu_);
 
-  auto conn_ctx = ConnContext(conn->Owner(), conn->GetFD());
-  if (auto iter = pubsub_patterns_.find(pattern); iter == pubsub_patterns_.end()) {
-    pubsub_patterns_.emplace(pattern, std::list<ConnContext>{conn_ctx});
-  } else {
-    iter->second.emplace_back(conn_ctx);
-  }
+  pubsub_patterns_[pattern].emplace_back(conn->Owner(), conn->GetFD());
 }
 
 void Server::PUnsubscribeChannel(const std::string &pattern, redis::Connection *conn) {
-  std::lock_guard<std::mutex> guard(pubsub_channels_mu_);
+  std::unique_lock<std::shared_mutex> guard(pubsub_channels_mu_);
 
-  auto iter = pubsub_patterns_.find(pattern);
-  if (iter == pubsub_patterns_.end()) {
+  auto conn_ctxs = pubsub_patterns_.Find(pattern);
+  if (!conn_ctxs) {
     return;
   }
 
-  for (const auto &conn_ctx : iter->second) {
+  for (const auto &conn_ctx : *conn_ctxs) {
     if (conn->GetFD() == conn_ctx.fd && conn->Owner() == conn_ctx.owner) {
-      iter->second.remove(conn_ctx);
-      if (iter->second.empty()) {
-        pubsub_patterns_.erase(iter);
+      conn_ctxs->remove(conn_ctx);
+      if (conn_ctxs->empty()) {
+        pubsub_patterns_.Erase(pattern);
       }
       break;
     }
@@ -717,7 +784,7 @@ uint64_t Server::GetClientID() { return client_id_.fetch_add(1, std::memory_orde
 
 void Server::recordInstantaneousMetrics() {
   auto rocksdb_stats = storage->GetDB()->GetDBOptions().statistics;
-  stats.TrackInstantaneousMetric(STATS_METRIC_COMMAND, stats.total_calls);
+  stats.TrackInstantaneousMetric(STATS_METRIC_COMMAND, stats.GetTotalCalls());
   stats.TrackInstantaneousMetric(STATS_METRIC_NET_INPUT, stats.in_bytes);
   stats.TrackInstantaneousMetric(STATS_METRIC_NET_OUTPUT, stats.out_bytes);
   stats.TrackInstantaneousMetric(STATS_METRIC_ROCKSDB_PUT,
@@ -732,6 +799,7 @@ void Server::recordInstantaneousMetrics() {
                                  rocksdb_stats->getTickerCount(rocksdb::Tickers::NUMBER_DB_NEXT));
   stats.TrackInstantaneousMetric(STATS_METRIC_ROCKSDB_PREV,
                                  rocksdb_stats->getTickerCount(rocksdb::Tickers::NUMBER_DB_PREV));
+  stats.TrackInstantaneousMetric(STATS_METRIC_EXPIRED_KEYS, storage->GetDBStats()->expired_keys);
 }
 
 void Server::cron() {
@@ -754,6 +822,8 @@ void Server::cron() {
       continue;
     }
 
+    if (!tracking.Empty()) SendInvalidations(tracking.InvalidateExpired(util::GetTimeStampMS()));
+
     // check every 20s (use 20s instead of 60s so that cron will execute in critical condition)
     if (counter != 0 && counter % 200 == 0) {
       auto t = static_cast<time_t>(util::GetTimeStamp());
@@ -1042,13 +1112,27 @@ void Server::GetReplicationInfo(std::string *info) {
     string_stream << "slave" << std::to_string(idx) << ":";
     string_stream << "ip=" << slave->GetConn()->GetAnnounceIP() << ",port=" << slave->GetConn()->GetAnnouncePort()
                   << ",offset=" << slave->GetCurrentReplSeq() << ",lag=" << latest_seq - slave->GetCurrentReplSeq()
-                  << "\r\n";
+                  << ",compression=" << util::StreamCompressionName(slave->GetConn()->GetStreamCompression()) << "\r\n";
     ++idx;
   }
   slave_threads_mu_.unlock();
 
   string_stream << "master_repl_offset:" << latest_seq << "\r\n";
 
+  // the replication streams, files of the full synchronization and migration batches which are compressed
+  auto compression_raw_bytes = stats.stream_compression_raw_bytes.load();
+  auto compression_compressed_bytes = stats.stream_compression_compressed_bytes.load();
+  string_stream << "stream_compression_raw_bytes:" << compression_raw_bytes << "\r\n";
+  string_stream << "stream_compression_compressed_bytes:" << compression_compressed_bytes << "\r\n";
+  string_stream << "stream_compression_ratio:"
+                << (compression_compressed_bytes > 0 ? static_cast<double>(compression_raw_bytes) /
+                                                           static_cast<double>(compression_compressed_bytes)
+                                                     : 0)
+                << "\r\n";
+  string_stream << "stream_compression_cpu_ms:" << stats.stream_compression_us.load() / 1000 << "\r\n";
+  string_stream << "stream_decompression_raw_bytes:" << stats.stream_decompression_raw_bytes.load() << "\r\n";
+  string_stream << "stream_decompression_cpu_ms:" << stats.stream_decompression_us.load() / 1000 << "\r\n";
+
   *info = string_stream.str();
 }
 
@@ -1125,7 +1209,7 @@ void Server::GetStatsInfo(std::string *info) {
   std::ostringstream string_stream;
   string_stream << "# Stats\r\n";
   string_stream << "total_connections_received:" << total_clients_ << "\r\n";
-  string_stream << "total_commands_processed:" << stats.total_calls << "\r\n";
+  string_stream << "total_commands_processed:" << stats.GetTotalCalls() << "\r\n";
   string_stream << "instantaneous_ops_per_sec:" << stats.GetInstantaneousMetric(STATS_METRIC_COMMAND) << "\r\n";
   string_stream << "total_net_input_bytes:" << stats.in_bytes << "\r\n";
   string_stream << "total_net_output_bytes:" << stats.out_bytes << "\r\n";
@@ -1140,11 +1224,38 @@ void Server::GetStatsInfo(std::string *info) {
   auto db_stats = storage->GetDBStats();
   string_stream << "keyspace_hits:" << db_stats->keyspace_hits << "\r\n";
   string_stream << "keyspace_misses:" << db_stats->keyspace_misses << "\r\n";
+  string_stream << "expired_keys:" << db_stats->expired_keys << "\r\n";
+  string_stream << "instantaneous_expired_keys_per_sec:" << stats.GetInstantaneousMetric(STATS_METRIC_EXPIRED_KEYS)
+                << "\r\n";
+  string_stream << "expire_lag_ms:" << db_stats->expire_lag_ms << "\r\n";
+
+  auto tracking_stats = tracking.GetStats();
+  string_stream << "tracking_clients:" << tracking_stats.clients << "\r\n";
+  string_stream << "tracking_total_keys:" << tracking_stats.keys << "\r\n";
+  string_stream << "tracking_total_prefixes:" << tracking_stats.prefixes << "\r\n";
+
+  auto lock_stats = storage->GetLockManager()->GetStats(HOT_LOCK_STRIPES_COUNT);
+  string_stream << "key_lock_stripes:" << storage->GetLockManager()->Size() << "\r\n";
+  string_stream << "key_lock_acquired:" << lock_stats.acquired << "\r\n";
+  string_stream << "key_lock_contended:" << lock_stats.contended << "\r\n";
+  string_stream << "key_lock_hot_stripes:";
+  for (size_t i = 0; i < lock_stats.hot_stripes.size(); i++) {
+    const auto &stripe = lock_stats.hot_stripes[i];
+    if (i > 0) string_stream << ",";
+    string_stream << stripe.index << "=" << stripe.contended << "/" << stripe.acquired;
+  }
+  string_stream << "\r\n";
+
+  auto hnsw_cache_stats = indexer.hnsw_cache.GetStats();
+  string_stream << "hnsw_cache_used_bytes:" << hnsw_cache_stats.usage << "\r\n";
+  string_stream << "hnsw_cache_entries:" << hnsw_cache_stats.entries << "\r\n";
+  string_stream << "hnsw_cache_hits:" << hnsw_cache_stats.hits << "\r\n";
+  string_stream << "hnsw_cache_misses:" << hnsw_cache_stats.misses << "\r\n";
 
   {
-    std::lock_guard<std::mutex> lg(pubsub_channels_mu_);
+    std::shared_lock<std::shared_mutex> lg(pubsub_channels_mu_);
     string_stream << "pubsub_channels:" << pubsub_channels_.size() << "\r\n";
-    string_stream << "pubsub_patterns:" << pubsub_patterns_.size() << "\r\n";
+    string_stream << "pubsub_patterns:" << pubsub_patterns_.Size() << "\r\n";
   }
 
   *info = string_stream.str();
@@ -1154,13 +1265,26 @@ void Server::GetCommandsStatsInfo(std::string *info) {
   std::ostringstream string_stream;
   string_stream << "# Commandstats\r\n";
 
-  for (const auto &cmd_stat : stats.commands_stats) {
-    auto calls = cmd_stat.second.calls.load();
-    if (calls == 0) continue;
+  for (const auto &[name, attributes] : *redis::CommandTable::GetOriginal()) {
+    auto cmd_stat = stats.GetCommandStat(attributes->id);
+    if (cmd_stat.calls == 0) continue;
 
-    auto latency = cmd_stat.second.latency.load();
-    string_stream << "cmdstat_" << cmd_stat.first << ":calls=" << calls << ",usec=" << latency
-                  << ",usec_per_call=" << static_cast<float>(latency / calls) << "\r\n";
+    string_stream << "cmdstat_" << name << ":calls=" << cmd_stat.calls << ",usec=" << cmd_stat.latency
+                  << ",usec_per_call=" << static_cast<float>(cmd_stat.latency / cmd_stat.calls) << "\r\n";
+  }
+
+  *info = string_stream.str();
+}
+
+void Server::GetLatencyStatsInfo(std::string *info) {
+  std::ostringstream string_stream;
+  string_stream << "# Latencystats\r\n";
+
+  for (const auto &[name, attributes] : *redis::CommandTable::GetOriginal()) {
+    auto distribution = stats.GetLatencyDistribution(attributes->id);
+    if (distribution.Count() == 0) continue;
+    string_stream << "latency_percentiles_usec_" << name << ":p50=" << distribution.Percentile(50)
+                  << ",p99=" << distribution.Percentile(99) << ",p99.9=" << distribution.Percentile(99.9) << "\r\n";
   }
 
   *info = string_stream.str();
@@ -1257,6 +1381,13 @@ void Server::GetInfo(const std::string &ns, const std::string &section, std::str
     string_stream << commands_stats_info;
   }
 
+  if (all || section == "latencystats") {
+    std::string latency_stats_info;
+    GetLatencyStatsInfo(&latency_stats_info);
+    if (section_cnt++) string_stream << "\r\n";
+    string_stream << latency_stats_info;
+  }
+
   if (all || section == "cluster") {
     std::string cluster_info;
     GetClusterInfo(&cluster_info);
@@ -1267,7 +1398,7 @@ void Server::GetInfo(const std::string &ns, const std::string &section, std::str
   // In keyspace section, we access DB, so we can't do that when loading
   if (!is_loading_ && (all || section == "keyspace")) {
     KeyNumStats stats;
-    GetLatestKeyNumStats(ns, &stats);
+    bool estimated = GetLatestKeyNumStats(ns, &stats);
 
     // FIXME(mwish): output still requires std::tm.
     auto last_scan_time = static_cast<time_t>(GetLastScanTime(ns));
@@ -1276,7 +1407,9 @@ void Server::GetInfo(const std::string &ns, const std::string &section, std::str
 
     if (section_cnt++) string_stream << "\r\n";
     string_stream << "# Keyspace\r\n";
-    if (last_scan_time == 0) {
+    if (estimated) {
+      string_stream << "# Keys estimated from the SST properties and memtables\r\n";
+    } else if (last_scan_time == 0) {
       string_stream << "# WARN: DBSIZE SCAN never performed yet\r\n";
     } else {
       string_stream << "# Last DBSIZE SCAN time: " << std::put_time(&last_scan_tm, "%a %b %e %H:%M:%S %Y") << "\r\n";
@@ -1545,12 +1678,15 @@ Status Server::autoResizeBlockAndSST() {
   return Status::OK();
 }
 
-void Server::GetLatestKeyNumStats(const std::string &ns, KeyNumStats *stats) {
+bool Server::GetLatestKeyNumStats(const std::string &ns, KeyNumStats *stats) {
+  if (storage->GetKeyNumEstimator()->GetKeyNumStats(ns, stats).ok()) return true;
+
   auto iter = db_scan_infos_.find(ns);
   if (iter != db_scan_infos_.end()) {
     std::lock_guard<std::mutex> lg(db_job_mu_);
     *stats = iter->second.key_num_stats;
   }
+  return false;
 }
 
 int64_t Server::GetLastScanTime(const std::string &ns) const {
@@ -1756,6 +1892,7 @@ Status Server::FunctionSetLib(const std::string &func, const std::string &lib) c
 void Server::ScriptReset() {
   auto lua = lua_.exchange(lua::CreateState(this));
   lua::DestroyState(lua);
+  IncrLuaVersion();
 }
 
 Status Server::ScriptFlush() {
@@ -1997,6 +2134,129 @@ void Server::UpdateWatchedKeysFromArgs(const std::vector<std::string> &args, con
   }
 }
 
+static std::vector<std::string> KeysFromArgs(const std::vector<std::string> &args,
+                                             const redis::CommandAttributes &attr) {
+  std::vector<std::string> keys;
+  attr.ForEachKeyRange(
+      [&keys](const std::vector<std::string> &args, const redis::CommandKeyRange &range) {
+        range.ForEachKey([&keys](const std::string &key) { keys.emplace_back(key); }, args);
+      },
+      args);
+  return keys;
+}
+
+void Server::TrackReadKeysFromArgs(redis::Connection *conn, const std::vector<std::string> &args,
+                                   const redis::CommandAttributes &attr) {
+  if (!(attr.flags & redis::kCmdReadOnly) || !conn->IsFlagEnabled(redis::Connection::kTracking)) return;
+  if (!tracking.RemembersReads(conn->GetID())) return;
+
+  auto keys = KeysFromArgs(args, attr);
+  if (keys.empty()) return;
+
+  // the keys are invalidated once they expire, since an expired key isn't deleted until it's
+  // written or reclaimed, which may never happen
+  std::vector<uint64_t> expires;
+  expires.reserve(keys.size());
+  auto metadata_cf = storage->GetCFHandle(ColumnFamilyID::Metadata);
+  for (const auto &key : keys) {
+    auto ns_key = ComposeNamespaceKey(conn->GetNamespace(), key, storage->IsSlotIdEncoded());
+    std::string value;
+    Metadata metadata(kRedisNone, false);
+    auto s = storage->GetDB()->Get(rocksdb::ReadOptions(), metadata_cf, ns_key, &value);
+    expires.emplace_back(s.ok() && metadata.Decode(value).ok() ? metadata.expire : 0);
+  }
+  SendInvalidations(tracking.RecordRead(conn->GetID(), conn->GetNamespace(), keys, expires));
+}
+
+void Server::InvalidateKeysFromArgs(redis::Connection *conn, const std::vector<std::string> &args,
+                                    const redis::CommandAttributes &attr) {
+  if (!(attr.flags & redis::kCmdWrite)) return;
+
+  if (attr.key_range.first_key == 0) {
+    // support commands like flushdb (write flag && key range {0,0,0})
+    SendInvalidations(tracking.InvalidateAll());
+    return;
+  }
+
+  auto keys = KeysFromArgs(args, attr);
+  if (keys.empty()) return;
+  SendInvalidations(tracking.Invalidate(conn->GetID(), conn->GetNamespace(), keys));
+}
+
+void Server::InvalidateNsKeys(const std::vector<std::string> &ns_keys) {
+  std::map<std::string, std::vector<std::string>> keys_by_ns;
+  for (const auto &ns_key : ns_keys) {
+    auto [ns, key] = ExtractNamespaceKey<std::string>(ns_key, storage->IsSlotIdEncoded());
+    keys_by_ns[ns].emplace_back(std::move(key));
+  }
+  for (const auto &[ns, keys] : keys_by_ns) {
+    SendInvalidations(tracking.Invalidate(0, ns, keys));
+  }
+}
+
+void Server::InvalidateKeysFromBatch(const std::string &raw_batch) {
+  // Collects the keys whose metadata or subkeys are written by a batch
+  class KeyCollector : public rocksdb::WriteBatch::Handler {
+   public:
+    explicit KeyCollector(bool slot_id_encoded) : slot_id_encoded_(slot_id_encoded) {}
+
+    rocksdb::Status PutCF(uint32_t column_family_id, const rocksdb::Slice &key,
+                          [[maybe_unused]] const rocksdb::Slice &value) override {
+      collect(column_family_id, key);
+      return rocksdb::Status::OK();
+    }
+    rocksdb::Status DeleteCF(uint32_t column_family_id, const rocksdb::Slice &key) override {
+      collect(column_family_id, key);
+      return rocksdb::Status::OK();
+    }
+    rocksdb::Status SingleDeleteCF(uint32_t column_family_id, const rocksdb::Slice &key) override {
+      collect(column_family_id, key);
+      return rocksdb::Status::OK();
+    }
+    rocksdb::Status DeleteRangeCF(uint32_t column_family_id, [[maybe_unused]] const rocksdb::Slice &begin_key,
+                                  [[maybe_unused]] const rocksdb::Slice &end_key) override {
+      // the subkeys of an expired key are deleted together with its metadata, while a range of
+      // the metadata is only deleted by flushing the DB or a slot
+      if (column_family_id == static_cast<uint32_t>(ColumnFamilyID::Metadata)) all_keys = true;
+      return rocksdb::Status::OK();
+    }
+
+    std::set<std::string> ns_keys;
+    bool all_keys = false;
+
+   private:
+    void collect(uint32_t column_family_id, const rocksdb::Slice &key) {
+      auto cf = static_cast<ColumnFamilyID>(column_family_id);
+      if (cf == ColumnFamilyID::Metadata) {
+        ns_keys.emplace(key.ToString());
+      } else if (cf == ColumnFamilyID::PrimarySubkey || cf == ColumnFamilyID::SecondarySubkey ||
+                 cf == ColumnFamilyID::Stream) {
+        InternalKey ikey(key, slot_id_encoded_);
+        ns_keys.emplace(ComposeNamespaceKey(ikey.GetNamespace(), ikey.GetKey(), slot_id_encoded_));
+      }
+    }
+
+    bool slot_id_encoded_;
+  };
+
+  rocksdb::WriteBatch batch(raw_batch);
+  KeyCollector collector(storage->IsSlotIdEncoded());
+  auto s = batch.Iterate(&collector);
+  if (!s.ok() || collector.all_keys) {
+    SendInvalidations(tracking.InvalidateAll());
+    return;
+  }
+  InvalidateNsKeys({collector.ns_keys.begin(), collector.ns_keys.end()});
+}
+
+TrackingTarget Server::LookupClient(uint64_t id) {
+  for (const auto &t : worker_threads_) {
+    auto worker = t->GetWorker();
+    if (int fd = worker->LookupConnection(id); fd >= 0) return {worker, fd, id};
+  }
+  return {};
+}
+
 void Server::UpdateWatchedKeysManually(const std::vector<std::string> &keys) {
   std::shared_lock lock(watched_key_mutex_);
 
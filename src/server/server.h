@@ -44,9 +44,11 @@
 #include "commands/commander.h"
 #include "lua.hpp"
 #include "namespace.h"
+#include "pattern_index.h"
 #include "search/index_manager.h"
 #include "search/indexer.h"
 #include "server/redis_connection.h"
+#include "server/tracking.h"
 #include "stats/log_collector.h"
 #include "stats/stats.h"
 #include "storage/redis_metadata.h"
@@ -100,6 +102,9 @@ constexpr const size_t CURSOR_DICT_SIZE = 1024 * 16;
 static_assert((CURSOR_DICT_SIZE & (CURSOR_DICT_SIZE - 1)) == 0, "CURSOR_DICT_SIZE must be 2^n");
 static_assert(CURSOR_DICT_SIZE <= (1 << 16), "CURSOR_DICT_SIZE must be less than or equal to 2^16");
 
+// the number of the most contended key lock stripes shown in INFO stats
+constexpr const size_t HOT_LOCK_STRIPES_COUNT = 8;
+
 enum class CursorType : uint8_t {
   kTypeNone = 0,  // none
   kTypeBase = 1,  // cursor for SCAN
@@ -197,6 +202,18 @@ class Server {
   Status RemoveMaster();
   Status AddSlave(redis::Connection *conn, rocksdb::SequenceNumber next_repl_seq);
   void DisconnectSlaves();
+  size_t GetSlavesNum() {
+    std::lock_guard<std::mutex> lg(slave_threads_mu_);
+    return slave_threads_.size();
+  }
+  SharedWALReader *GetReplWALReader() { return &repl_wal_reader_; }
+  // WAIT blocks the connection until `num_replicas` replicas acknowledge the sequence `seq`
+  void BlockOnReplAck(redis::Connection *conn, rocksdb::SequenceNumber seq, int num_replicas);
+  void UnblockOnReplAck(redis::Connection *conn);
+  bool HasReplAckWaiters() const { return repl_ack_waiters_num_.load(std::memory_order_relaxed) > 0; }
+  int GetReplicasAcked(rocksdb::SequenceNumber seq);
+  void UpdateReplicaAck(const FeedSlaveThread *replica, rocksdb::SequenceNumber seq);
+  void RemoveReplicaAck(const FeedSlaveThread *replica);
   void CleanupExitedSlaves();
   bool IsSlave() const { return !master_host_.empty(); }
   void FeedMonitorConns(redis::Connection *conn, const std::vector<std::string> &tokens);
@@ -212,7 +229,7 @@ class Server {
                                std::vector<ChannelSubscribeNum> *channel_subscribe_nums);
   void PSubscribeChannel(const std::string &pattern, redis::Connection *conn);
   void PUnsubscribeChannel(const std::string &pattern, redis::Connection *conn);
-  size_t GetPubSubPatternSize() const { return pubsub_patterns_.size(); }
+  size_t GetPubSubPatternSize() const { return pubsub_patterns_.Size(); }
   void SSubscribeChannel(const std::string &channel, redis::Connection *conn, uint16_t slot);
   void SUnsubscribeChannel(const std::string &channel, redis::Connection *conn, uint16_t slot);
   void GetSChannelsByPattern(const std::string &pattern, std::vector<std::string> *channels);
@@ -240,6 +257,7 @@ class Server {
   void GetReplicationInfo(std::string *info);
   void GetRoleInfo(std::string *info);
   void GetCommandsStatsInfo(std::string *info);
+  void GetLatencyStatsInfo(std::string *info);
   void GetClusterInfo(std::string *info);
   void GetInfo(const std::string &ns, const std::string &section, std::string *info);
   std::string GetRocksDBStatsJson() const;
@@ -251,7 +269,8 @@ class Server {
   Status AsyncBgSaveDB();
   Status AsyncPurgeOldBackups(uint32_t num_backups_to_keep, uint32_t backup_max_keep_hours);
   Status AsyncScanDBSize(const std::string &ns);
-  void GetLatestKeyNumStats(const std::string &ns, KeyNumStats *stats);
+  // Returns false if the keys can't be counted without a scan, then the stats of the last DBSIZE SCAN are used
+  bool GetLatestKeyNumStats(const std::string &ns, KeyNumStats *stats);
   int64_t GetLastScanTime(const std::string &ns) const;
   StatusOr<std::vector<rocksdb::BatchResult>> PollUpdates(uint64_t next_sequence, int64_t count, bool is_strict) const;
 
@@ -275,6 +294,10 @@ class Server {
   Status ScriptSet(const std::string &sha, const std::string &body) const;
   void ScriptReset();
   Status ScriptFlush();
+  // The version of the scripts and functions, which is increased when they're flushed, replaced or deleted,
+  // the private Lua VMs of the workers are recreated once it changes.
+  void IncrLuaVersion() { lua_version_.fetch_add(1, std::memory_order_relaxed); }
+  uint64_t GetLuaVersion() const { return lua_version_.load(std::memory_order_relaxed); }
 
   Status FunctionGetCode(const std::string &lib, std::string *code) const;
   Status FunctionGetLib(const std::string &func, std::string *lib) const;
@@ -285,9 +308,6 @@ class Server {
   Status ExecPropagatedCommand(const std::vector<std::string> &tokens);
   Status ExecPropagateScriptCommand(const std::vector<std::string> &tokens);
 
-  void SetCurrentConnection(redis::Connection *conn) { curr_connection_ = conn; }
-  redis::Connection *GetCurrentConnection() { return curr_connection_; }
-
   LogCollector<PerfEntry> *GetPerfLog() { return &perf_log_; }
   LogCollector<SlowEntry> *GetSlowLog() { return &slow_log_; }
   void SlowlogPushEntryIfNeeded(const std::vector<std::string> *args, uint64_t duration, const redis::Connection *conn);
@@ -307,6 +327,21 @@ class Server {
   void WatchKey(redis::Connection *conn, const std::vector<std::string> &keys);
   static bool IsWatchedKeysModified(redis::Connection *conn);
   void ResetWatchedKeys(redis::Connection *conn);
+  // Remembers the keys read by a command of a tracking client. It's called before the command is executed,
+  // so a write landing between the read and this call still sends the invalidation.
+  void TrackReadKeysFromArgs(redis::Connection *conn, const std::vector<std::string> &args,
+                             const redis::CommandAttributes &attr);
+  // Invalidates the keys modified by a write command for the tracking clients,
+  // it's called once the write is committed
+  void InvalidateKeysFromArgs(redis::Connection *conn, const std::vector<std::string> &args,
+                              const redis::CommandAttributes &attr);
+  // Invalidates the keys modified without a command, given as the keys of the metadata,
+  // e.g. the keys deleted by the active expiration
+  void InvalidateNsKeys(const std::vector<std::string> &ns_keys);
+  // Invalidates the keys modified by a write batch of the master once it's applied by a replica
+  void InvalidateKeysFromBatch(const std::string &raw_batch);
+  // Returns the target with a zero id if no worker serves the client
+  TrackingTarget LookupClient(uint64_t id);
   std::list<std::pair<std::string, uint32_t>> GetSlaveHostAndPort();
   Namespace *GetNamespace() { return &namespace_; }
 
@@ -320,6 +355,8 @@ class Server {
   redis::GlobalIndexer indexer;
   redis::IndexManager index_mgr;
 
+  TrackingTable tracking;
+
  private:
   void cron();
   void recordInstantaneousMetrics();
@@ -342,8 +379,7 @@ class Server {
   std::mutex last_random_key_cursor_mu_;
 
   std::atomic<lua_State *> lua_;
-
-  redis::Connection *curr_connection_ = nullptr;
+  std::atomic<uint64_t> lua_version_ = 0;
 
   // client counters
   std::atomic<uint64_t> client_id_{1};
@@ -354,6 +390,7 @@ class Server {
   // slave
   std::mutex slave_threads_mu_;
   std::list<std::unique_ptr<FeedSlaveThread>> slave_threads_;
+  SharedWALReader repl_wal_reader_;
   std::atomic<int> fetch_file_threads_num_ = 0;
 
   // namespace
@@ -373,8 +410,9 @@ class Server {
   LogCollector<PerfEntry> perf_log_;
 
   std::map<std::string, std::list<ConnContext>> pubsub_channels_;
-  std::map<std::string, std::list<ConnContext>> pubsub_patterns_;
-  std::mutex pubsub_channels_mu_;
+  PatternIndex<std::list<ConnContext>> pubsub_patterns_;
+  // Guards both the channels and the patterns, PUBLISH only takes it shared
+  std::shared_mutex pubsub_channels_mu_;
   std::vector<std::map<std::string, std::list<ConnContext>>> pubsub_shard_channels_;
   std::mutex pubsub_shard_channels_mu_;
   std::map<std::string, std::list<ConnContext>> blocking_keys_;
@@ -382,6 +420,17 @@ class Server {
 
   std::atomic<int> blocked_clients_{0};
 
+  struct ReplAckWaiter {
+    ConnContext conn_ctx;
+    rocksdb::SequenceNumber seq;
+    int num_replicas;
+  };
+  std::mutex repl_ack_mu_;
+  // the sequences acknowledged by the replicas, and the connections blocked by WAIT
+  std::map<const FeedSlaveThread *, rocksdb::SequenceNumber> replica_acks_;
+  std::list<ReplAckWaiter> repl_ack_waiters_;
+  std::atomic<int> repl_ack_waiters_num_ = 0;
+
   std::mutex blocked_stream_consumers_mu_;
   std::map<std::string, std::set<std::shared_ptr<StreamConsumer>>> blocked_stream_consumers_;
 
@@ -389,6 +438,7 @@ class Server {
   std::shared_mutex works_concurrency_rw_lock_;
   std::thread cron_thread_;
   std::thread compaction_checker_thread_;
+  std::thread active_expire_thread_;
   TaskRunner task_runner_;
   std::vector<std::unique_ptr<WorkerThread>> worker_threads_;
   std::unique_ptr<ReplicationThread> replication_thread_;
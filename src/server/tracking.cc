@@ -0,0 +1,305 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "tracking.h"
+
+#include <functional>
+#include <utility>
+
+#include "server/redis_reply.h"
+#include "server/worker.h"
+
+std::vector<Invalidation> TrackingTable::SetMaxKeys(size_t max_keys) {
+  max_keys_.store(max_keys, std::memory_order_relaxed);
+  return evict(max_keys);
+}
+
+void TrackingTable::Enable(const TrackingTarget &client, const std::string &ns, TrackingOptions options,
+                           const TrackingTarget &redirect) {
+  // subscribing to no prefix means subscribing to all keys
+  if (options.bcast && options.prefixes.empty()) options.prefixes.emplace_back();
+
+  std::unique_lock<std::shared_mutex> guard(clients_mu_);
+  if (auto iter = clients_.find(client.id); iter != clients_.end()) removePrefixesLocked(iter->second);
+  auto &entry = clients_[client.id] = Client{client, redirect, ns, std::move(options)};
+  addPrefixesLocked(entry);
+  clients_count_.store(clients_.size(), std::memory_order_relaxed);
+}
+
+void TrackingTable::Disable(uint64_t id) {
+  std::unique_lock<std::shared_mutex> guard(clients_mu_);
+  auto iter = clients_.find(id);
+  if (iter == clients_.end()) return;
+
+  removePrefixesLocked(iter->second);
+  // the keys read by the client are left in the table, and skipped when they're invalidated
+  clients_.erase(iter);
+  clients_count_.store(clients_.size(), std::memory_order_relaxed);
+}
+
+int64_t TrackingTable::GetRedirect(uint64_t id) const {
+  std::shared_lock<std::shared_mutex> guard(clients_mu_);
+  auto iter = clients_.find(id);
+  if (iter == clients_.end()) return -1;
+  return static_cast<int64_t>(iter->second.redirect.id);
+}
+
+bool TrackingTable::GetOptions(uint64_t id, TrackingOptions *options) const {
+  std::shared_lock<std::shared_mutex> guard(clients_mu_);
+  auto iter = clients_.find(id);
+  if (iter == clients_.end()) return false;
+  *options = iter->second.options;
+  return true;
+}
+
+bool TrackingTable::RemembersReads(uint64_t id) const {
+  std::shared_lock<std::shared_mutex> guard(clients_mu_);
+  auto iter = clients_.find(id);
+  return iter != clients_.end() && !iter->second.options.bcast;
+}
+
+std::vector<Invalidation> TrackingTable::RecordRead(uint64_t id, const std::string &ns,
+                                                    const std::vector<std::string> &keys,
+                                                    const std::vector<uint64_t> &expires) {
+  {
+    std::shared_lock<std::shared_mutex> guard(clients_mu_);
+    auto client = clients_.find(id);
+    if (client == clients_.end() || client->second.options.bcast) return {};
+
+    for (size_t i = 0; i < keys.size(); i++) {
+      auto composed_key = composeKey(ns, keys[i]);
+      auto &shard = shardOf(composed_key);
+      std::lock_guard<std::mutex> shard_guard(shard.mu);
+      auto [iter, inserted] = shard.keys.try_emplace(composed_key);
+      if (inserted) {
+        shard.order.emplace_back(std::move(composed_key));
+        iter->second.order = std::prev(shard.order.end());
+        keys_count_.fetch_add(1, std::memory_order_relaxed);
+      }
+      iter->second.readers.insert(id);
+      setExpireLocked(&shard, iter, i < expires.size() ? expires[i] : 0);
+    }
+  }
+  return evict(max_keys_.load(std::memory_order_relaxed));
+}
+
+std::vector<Invalidation> TrackingTable::Invalidate(uint64_t writer_id, const std::string &ns,
+                                                    const std::vector<std::string> &keys) {
+  std::map<uint64_t, Invalidation> to_send;
+  std::shared_lock<std::shared_mutex> guard(clients_mu_);
+  auto send_to = [&, this](uint64_t id, const std::string &key) {
+    if (id != writer_id) {
+      addInvalidationLocked(&to_send, id, key);
+    } else if (auto iter = clients_.find(id); iter != clients_.end() && !iter->second.options.noloop) {
+      addInvalidationLocked(&to_send, id, key);
+    }
+  };
+
+  for (const auto &key : keys) {
+    auto composed_key = composeKey(ns, key);
+    {
+      auto &shard = shardOf(composed_key);
+      std::lock_guard<std::mutex> shard_guard(shard.mu);
+      if (auto iter = shard.keys.find(composed_key); iter != shard.keys.end()) {
+        for (auto id : iter->second.readers) send_to(id, key);
+        eraseLocked(&shard, iter);
+      }
+    }
+    for (const auto &[length, ids_by_prefix] : prefixes_) {
+      if (length > composed_key.size()) break;
+      auto iter = ids_by_prefix.find(composed_key.substr(0, length));
+      if (iter == ids_by_prefix.end()) continue;
+      for (auto id : iter->second) send_to(id, key);
+    }
+  }
+  return collect(&to_send);
+}
+
+std::vector<Invalidation> TrackingTable::InvalidateExpired(uint64_t now_ms) {
+  std::map<uint64_t, Invalidation> to_send;
+  std::shared_lock<std::shared_mutex> guard(clients_mu_);
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> shard_guard(shard.mu);
+    while (!shard.expires.empty() && shard.expires.begin()->first <= now_ms) {
+      auto iter = shard.keys.find(shard.expires.begin()->second);
+      auto user_key = userKey(iter->first);
+      for (auto id : iter->second.readers) addInvalidationLocked(&to_send, id, user_key);
+      eraseLocked(&shard, iter);
+    }
+  }
+  return collect(&to_send);
+}
+
+std::vector<Invalidation> TrackingTable::InvalidateAll() {
+  std::shared_lock<std::shared_mutex> guard(clients_mu_);
+  std::vector<Invalidation> invalidations;
+  invalidations.reserve(clients_.size());
+  for (const auto &[_, client] : clients_) {
+    invalidations.emplace_back(Invalidation{client.target, client.redirect, {}});
+  }
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> shard_guard(shard.mu);
+    keys_count_.fetch_sub(shard.keys.size(), std::memory_order_relaxed);
+    shard.keys.clear();
+    shard.order.clear();
+    shard.expires.clear();
+  }
+  return invalidations;
+}
+
+TrackingTable::Stats TrackingTable::GetStats() const {
+  std::shared_lock<std::shared_mutex> guard(clients_mu_);
+  return {clients_.size(), keys_count_.load(std::memory_order_relaxed), prefixes_count_};
+}
+
+std::string TrackingTable::userKey(const std::string &composed_key) {
+  return composed_key.substr(composed_key.find('\0') + 1);
+}
+
+void TrackingTable::setExpireLocked(Shard *shard, std::unordered_map<std::string, KeyEntry>::iterator iter,
+                                    uint64_t expire_ms) {
+  auto &entry = iter->second;
+  if (entry.expire_ms == expire_ms) return;
+  if (entry.expire_ms > 0) shard->expires.erase(entry.expire);
+  entry.expire_ms = expire_ms;
+  if (expire_ms > 0) entry.expire = shard->expires.emplace(expire_ms, iter->first);
+}
+
+void TrackingTable::eraseLocked(Shard *shard, std::unordered_map<std::string, KeyEntry>::iterator iter) {
+  if (iter->second.expire_ms > 0) shard->expires.erase(iter->second.expire);
+  shard->order.erase(iter->second.order);
+  shard->keys.erase(iter);
+  keys_count_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void TrackingTable::addPrefixesLocked(const Client &client) {
+  for (const auto &prefix : client.options.prefixes) {
+    auto composed_prefix = composeKey(client.ns, prefix);
+    auto &ids = prefixes_[composed_prefix.size()][composed_prefix];
+    if (ids.empty()) prefixes_count_++;
+    ids.insert(client.target.id);
+  }
+}
+
+void TrackingTable::removePrefixesLocked(const Client &client) {
+  for (const auto &prefix : client.options.prefixes) {
+    auto composed_prefix = composeKey(client.ns, prefix);
+    auto length_iter = prefixes_.find(composed_prefix.size());
+    if (length_iter == prefixes_.end()) continue;
+    auto prefix_iter = length_iter->second.find(composed_prefix);
+    if (prefix_iter == length_iter->second.end()) continue;
+
+    prefix_iter->second.erase(client.target.id);
+    if (!prefix_iter->second.empty()) continue;
+    length_iter->second.erase(prefix_iter);
+    prefixes_count_--;
+    if (length_iter->second.empty()) prefixes_.erase(length_iter);
+  }
+}
+
+void TrackingTable::addInvalidationLocked(std::map<uint64_t, Invalidation> *to_send, uint64_t id,
+                                          const std::string &user_key) {
+  auto client = clients_.find(id);
+  if (client == clients_.end()) return;
+
+  auto [iter, inserted] = to_send->try_emplace(id);
+  auto &invalidation = iter->second;
+  if (inserted) {
+    invalidation.client = client->second.target;
+    invalidation.redirect = client->second.redirect;
+  }
+  // a key may match several prefixes of a client
+  if (invalidation.keys.empty() || invalidation.keys.back() != user_key) {
+    invalidation.keys.emplace_back(user_key);
+  }
+}
+
+std::vector<Invalidation> TrackingTable::evict(size_t max_keys) {
+  if (max_keys == 0 || keys_count_.load(std::memory_order_relaxed) <= max_keys) return {};
+
+  std::map<uint64_t, Invalidation> to_send;
+  std::shared_lock<std::shared_mutex> guard(clients_mu_);
+  // evict the oldest key of each shard in turn, stopping once every shard turns out to be empty
+  for (size_t empty_shards = 0;
+       keys_count_.load(std::memory_order_relaxed) > max_keys && empty_shards < shards_.size();) {
+    auto &shard = shards_[evict_cursor_.fetch_add(1, std::memory_order_relaxed) % shards_.size()];
+    std::lock_guard<std::mutex> shard_guard(shard.mu);
+    if (shard.order.empty()) {
+      empty_shards++;
+      continue;
+    }
+    empty_shards = 0;
+
+    auto iter = shard.keys.find(shard.order.front());
+    auto user_key = userKey(iter->first);
+    for (auto id : iter->second.readers) addInvalidationLocked(&to_send, id, user_key);
+    eraseLocked(&shard, iter);
+  }
+  return collect(&to_send);
+}
+
+std::vector<Invalidation> TrackingTable::collect(std::map<uint64_t, Invalidation> *to_send) {
+  std::vector<Invalidation> invalidations;
+  invalidations.reserve(to_send->size());
+  for (auto &[_, invalidation] : *to_send) {
+    invalidations.emplace_back(std::move(invalidation));
+  }
+  return invalidations;
+}
+
+static std::string InvalidationMessage(redis::RESP ver, const std::vector<std::string> &keys) {
+  std::string keys_reply = keys.empty() ? redis::NilArray(ver) : redis::ArrayOfBulkStrings(keys);
+  if (ver == redis::RESP::v3) {
+    return redis::HeaderOfPush(ver, 2) + redis::BulkString("invalidate") + keys_reply;
+  }
+  return redis::MultiLen(3) + redis::BulkString("message") + redis::BulkString("__redis__:invalidate") + keys_reply;
+}
+
+// Returns false if the target was closed
+static bool Deliver(const TrackingTarget &target, const std::function<std::string(redis::RESP)> &reply_of) {
+  if (!target.owner) return false;
+  return target.owner->Reply(target.fd, target.id, reply_of).IsOK();
+}
+
+void SendInvalidations(const std::vector<Invalidation> &invalidations) {
+  for (const auto &invalidation : invalidations) {
+    const auto &client = invalidation.client;
+    const auto &redirect = invalidation.redirect;
+    if (redirect.id == 0) {
+      // a client without a redirect target can read push messages, unless it switched back to RESP2
+      Deliver(client, [&invalidation](redis::RESP ver) -> std::string {
+        if (ver != redis::RESP::v3) return "";
+        return InvalidationMessage(ver, invalidation.keys);
+      });
+      continue;
+    }
+
+    bool delivered = Deliver(redirect, [&invalidation](redis::RESP ver) {
+      return InvalidationMessage(ver, invalidation.keys);
+    });
+    if (delivered) continue;
+
+    // tell the client its cache can't be trusted anymore, if it can read push messages
+    Deliver(client, [&redirect](redis::RESP ver) -> std::string {
+      if (ver != redis::RESP::v3) return "";
+      return redis::HeaderOfPush(ver, 2) + redis::BulkString("tracking-redir-broken") + redis::Integer(redirect.id);
+    });
+  }
+}
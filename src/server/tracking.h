@@ -0,0 +1,180 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Worker;
+
+// A connection which receives invalidation messages, identified by its id as well since
+// the fd may be taken by a new connection once it's closed
+struct TrackingTarget {
+  Worker *owner = nullptr;
+  int fd = -1;
+  uint64_t id = 0;
+};
+
+struct TrackingOptions {
+  bool bcast = false;
+  bool noloop = false;
+  uint64_t redirect = 0;
+  std::vector<std::string> prefixes;
+};
+
+// The invalidation of keys which should be sent to a tracking client, or to its redirect target
+struct Invalidation {
+  TrackingTarget client;
+  TrackingTarget redirect;        // the messages go to the client itself if the id is 0
+  std::vector<std::string> keys;  // empty means every key is invalidated, e.g. after FLUSHALL
+};
+
+// TrackingTable is the server side of the client side caching, i.e. CLIENT TRACKING.
+//
+// In the default mode, it remembers which clients read which keys, and a client is told to
+// invalidate a key once the key is modified or expires, after which the key is forgotten until
+// it's read again. So a client only hears about the keys it may have cached. In the broadcasting
+// mode (BCAST), clients subscribe to key prefixes instead, and hear about every modified key which
+// matches one of their prefixes, including the keys deleted by the active expiration, without the
+// server remembering any key.
+//
+// Keys and prefixes are tracked in the namespace of the client. The remembered keys are spread over
+// shards by their hashes, so the reads and writes of different keys don't wait for each other, and
+// bounded by max_keys: once it's exceeded, the oldest keys of the shards are evicted in turn and
+// their readers are told to invalidate them, like the tracking-table-max-keys of Redis.
+//
+// The table only computes the messages, SendInvalidations delivers them.
+class TrackingTable {
+ public:
+  static constexpr size_t kDefaultMaxKeys = 1000000;
+  static constexpr size_t kDefaultShards = 16;
+
+  struct Stats {
+    size_t clients;
+    size_t keys;
+    size_t prefixes;
+  };
+
+  explicit TrackingTable(size_t max_keys = kDefaultMaxKeys, size_t shards = kDefaultShards)
+      : shards_(shards), max_keys_(max_keys) {}
+
+  TrackingTable(const TrackingTable &) = delete;
+  TrackingTable &operator=(const TrackingTable &) = delete;
+
+  // Cheap enough to check for every command, so the commands don't take the lock if nobody tracks
+  bool Empty() const { return clients_count_.load(std::memory_order_relaxed) == 0; }
+
+  // Zero means unlimited, shrinking the limit evicts the oldest keys
+  std::vector<Invalidation> SetMaxKeys(size_t max_keys);
+
+  // Enables tracking for a client, or replaces its options if it was tracking already
+  void Enable(const TrackingTarget &client, const std::string &ns, TrackingOptions options,
+              const TrackingTarget &redirect);
+  void Disable(uint64_t id);
+  // Returns the redirect target id of a client, 0 if it doesn't redirect or -1 if it doesn't track
+  int64_t GetRedirect(uint64_t id) const;
+  bool GetOptions(uint64_t id, TrackingOptions *options) const;
+  // Whether the keys read by a client are remembered, i.e. it's tracking in the default mode
+  bool RemembersReads(uint64_t id) const;
+
+  // Remembers the keys read by a client in the default mode, with their expire time in milliseconds
+  // if they have one, or 0 if they don't
+  std::vector<Invalidation> RecordRead(uint64_t id, const std::string &ns, const std::vector<std::string> &keys,
+                                       const std::vector<uint64_t> &expires = {});
+  // Returns the invalidation of the keys modified by the given client, 0 if it's not a client, e.g. the master
+  std::vector<Invalidation> Invalidate(uint64_t writer_id, const std::string &ns,
+                                       const std::vector<std::string> &keys);
+  // Returns the invalidation of the remembered keys which expire no later than now
+  std::vector<Invalidation> InvalidateExpired(uint64_t now_ms);
+  // Returns the invalidation of all keys for every tracking client, e.g. after FLUSHDB
+  std::vector<Invalidation> InvalidateAll();
+
+  Stats GetStats() const;
+
+ private:
+  struct Client {
+    TrackingTarget target;
+    TrackingTarget redirect;
+    std::string ns;
+    TrackingOptions options;
+  };
+
+  struct KeyEntry {
+    std::set<uint64_t> readers;
+    std::list<std::string>::iterator order;
+    uint64_t expire_ms = 0;
+    std::multimap<uint64_t, std::string>::iterator expire;
+  };
+
+  struct Shard {
+    std::mutex mu;
+    std::unordered_map<std::string, KeyEntry> keys;
+    std::list<std::string> order;                   // the key remembered first goes first
+    std::multimap<uint64_t, std::string> expires;  // the keys with an expire time by the time
+  };
+
+  // The namespace and the key are joined by a zero byte, so a prefix of the joined key
+  // matches the keys of the same namespace only
+  static std::string composeKey(const std::string &ns, const std::string &key) { return ns + '\0' + key; }
+  static std::string userKey(const std::string &composed_key);
+
+  Shard &shardOf(const std::string &composed_key) {
+    return shards_[std::hash<std::string>{}(composed_key) % shards_.size()];
+  }
+  void setExpireLocked(Shard *shard, std::unordered_map<std::string, KeyEntry>::iterator iter, uint64_t expire_ms);
+  void eraseLocked(Shard *shard, std::unordered_map<std::string, KeyEntry>::iterator iter);
+  void addPrefixesLocked(const Client &client);
+  void removePrefixesLocked(const Client &client);
+
+  // Needs the lock of the clients, either shared or not
+  void addInvalidationLocked(std::map<uint64_t, Invalidation> *to_send, uint64_t id, const std::string &user_key);
+  std::vector<Invalidation> evict(size_t max_keys);
+  static std::vector<Invalidation> collect(std::map<uint64_t, Invalidation> *to_send);
+
+  // guards the clients and the prefixes, which only change when a client enables or disables tracking,
+  // and is taken before the lock of a shard
+  mutable std::shared_mutex clients_mu_;
+  std::unordered_map<uint64_t, Client> clients_;
+  std::atomic<size_t> clients_count_{0};
+  // the prefixes by their lengths, so a key is matched by looking up its prefix of each length
+  // rather than comparing it with every prefix
+  std::map<size_t, std::unordered_map<std::string, std::set<uint64_t>>> prefixes_;
+  size_t prefixes_count_ = 0;
+
+  std::vector<Shard> shards_;
+  std::atomic<size_t> keys_count_{0};
+  std::atomic<size_t> max_keys_;
+  std::atomic<size_t> evict_cursor_{0};
+};
+
+// Sends the invalidation messages: a push message for a RESP3 connection, or a message
+// of the __redis__:invalidate channel for a RESP2 redirect target
+void SendInvalidations(const std::vector<Invalidation> &invalidations);
@@ -73,6 +73,7 @@ Worker::Worker(Server *srv, Config *config) : srv(srv), base_(event_base_new())
     }
   }
   lua_ = lua::CreateState(srv);
+  lua_version_ = srv->GetLuaVersion();
 }
 
 Worker::~Worker() {
@@ -100,6 +101,16 @@ Worker::~Worker() {
   lua::DestroyState(lua_);
 }
 
+void Worker::RecreateLuaIfStale() {
+  // the private Lua VM is only used by the worker thread, so it's safe to recreate it here
+  auto version = srv->GetLuaVersion();
+  if (version == lua_version_) return;
+
+  lua::DestroyState(lua_);
+  lua_ = lua::CreateState(srv);
+  lua_version_ = version;
+}
+
 void Worker::TimerCB(int, [[maybe_unused]] int16_t events) {
   auto config = srv->GetConfig();
   if (config->timeout == 0) return;
@@ -455,6 +466,30 @@ Status Worker::Reply(int fd, const std::string &reply) {
   return {Status::NotOK, "connection doesn't exist"};
 }
 
+Status Worker::Reply(int fd, const std::string &header, const redis::SharedReply &body) {
+  std::unique_lock<std::mutex> lock(conns_mu_);
+  auto iter = conns_.find(fd);
+  if (iter != conns_.end()) {
+    iter->second->SetLastInteraction();
+    redis::Reply(iter->second->Output(), header, body);
+    return Status::OK();
+  }
+
+  return {Status::NotOK, "connection doesn't exist"};
+}
+
+Status Worker::Reply(int fd, uint64_t id, const std::function<std::string(redis::RESP)> &reply_of) {
+  std::unique_lock<std::mutex> lock(conns_mu_);
+  auto iter = conns_.find(fd);
+  if (iter == conns_.end() || iter->second->GetID() != id) {
+    return {Status::NotOK, "connection doesn't exist"};
+  }
+
+  auto reply = reply_of(iter->second->GetProtocolVersion());
+  if (!reply.empty()) redis::Reply(iter->second->Output(), reply);
+  return Status::OK();
+}
+
 void Worker::BecomeMonitorConn(redis::Connection *conn) {
   {
     std::lock_guard<std::mutex> guard(conns_mu_);
@@ -499,6 +534,15 @@ std::string Worker::GetClientsStr() {
   return output;
 }
 
+int Worker::LookupConnection(uint64_t id) {
+  std::lock_guard<std::mutex> guard(conns_mu_);
+
+  for (const auto &iter : conns_) {
+    if (iter.second->GetID() == id) return iter.first;
+  }
+  return -1;
+}
+
 void Worker::KillClient(redis::Connection *self, uint64_t id, const std::string &addr, uint64_t type, bool skipme,
                         int64_t *killed) {
   std::lock_guard<std::mutex> guard(conns_mu_);
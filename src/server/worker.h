@@ -27,6 +27,7 @@
 
 #include <cstdint>
 #include <cstring>
+#include <functional>
 #include <iostream>
 #include <lua.hpp>
 #include <map>
@@ -61,11 +62,17 @@ class Worker : EventCallbackBase<Worker>, EvconnlistenerBase<Worker> {
   Status AddConnection(redis::Connection *c);
   Status EnableWriteEvent(int fd);
   Status Reply(int fd, const std::string &reply);
+  Status Reply(int fd, const std::string &header, const redis::SharedReply &body);
+  // Replies only if the connection still has the given id, since its fd may be taken by a new one.
+  // The reply is built in the protocol version of the connection, and nothing is sent if it's empty.
+  Status Reply(int fd, uint64_t id, const std::function<std::string(redis::RESP)> &reply_of);
   void BecomeMonitorConn(redis::Connection *conn);
   void QuitMonitorConn(redis::Connection *conn);
   void FeedMonitorConns(redis::Connection *conn, const std::string &response);
 
   std::string GetClientsStr();
+  // Returns the fd of the connection with the given id, or -1 if it's not served by this worker
+  int LookupConnection(uint64_t id);
   void KillClient(redis::Connection *self, uint64_t id, const std::string &addr, uint64_t type, bool skipme,
                   int64_t *killed);
   void KickoutIdleClients(int timeout);
@@ -75,6 +82,9 @@ class Worker : EventCallbackBase<Worker>, EvconnlistenerBase<Worker> {
   void TimerCB(int, int16_t events);
 
   lua_State *Lua() { return lua_; }
+  // Recreate the private Lua VM if the scripts or functions were changed since it was created,
+  // it should be called before running a script rather than in the middle of it.
+  void RecreateLuaIfStale();
   std::map<int, redis::Connection *> GetConnections() const { return conns_; }
   Server *srv;
 
@@ -96,6 +106,7 @@ class Worker : EventCallbackBase<Worker>, EvconnlistenerBase<Worker> {
   struct bufferevent_rate_limit_group *rate_limit_group_ = nullptr;
   struct ev_token_bucket_cfg *rate_limit_group_cfg_ = nullptr;
   lua_State *lua_;
+  uint64_t lua_version_ = 0;
   std::atomic<bool> is_terminated_ = false;
 };
 
@@ -114,8 +114,10 @@ rocksdb::Status Disk::GetBitmapSize(engine::Context &ctx, const Slice &ns_key, u
   BitmapMetadata metadata(false);
   rocksdb::Status s = Database::GetMetadata(ctx, {kRedisBitmap}, ns_key, &metadata);
   if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
+  // the fixed-width segment subkeys sort before the decimal ones
+  std::string first_sub_key = metadata.HasFixedWidthSubKeys() ? "" : std::to_string(0);
   return GetApproximateSizes(metadata, ns_key, storage_->GetCFHandle(ColumnFamilyID::PrimarySubkey), key_size,
-                             std::to_string(0), std::to_string(0));
+                             first_sub_key, first_sub_key);
 }
 
 rocksdb::Status Disk::GetSortedintSize(engine::Context &ctx, const Slice &ns_key, uint64_t *key_size) {
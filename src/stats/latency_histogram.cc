@@ -0,0 +1,131 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "latency_histogram.h"
+
+#include <cmath>
+
+#include "thread_index.h"
+
+size_t LatencyHistogram::BucketIndex(uint64_t value) {
+  if (value < kSubBuckets) return static_cast<size_t>(value);
+  if (value >> kMaxValueBits) return kBuckets - 1;
+
+  int msb = 63 - __builtin_clzll(value);
+  int shift = msb - kSubBucketBits;
+  return static_cast<size_t>(shift + 1) * kSubBuckets + ((value >> shift) & (kSubBuckets - 1));
+}
+
+uint64_t LatencyHistogram::BucketLowerBound(size_t idx) {
+  if (idx < kSubBuckets) return idx;
+  return (kSubBuckets + idx % kSubBuckets) << (idx / kSubBuckets - 1);
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t idx) {
+  if (idx < kSubBuckets) return idx;
+  if (idx == kBuckets - 1) return UINT64_MAX;
+  return BucketLowerBound(idx) + (uint64_t(1) << (idx / kSubBuckets - 1)) - 1;
+}
+
+void LatencyHistogram::MergeTo(std::array<uint64_t, kBuckets> *counts) const {
+  for (size_t i = 0; i < kBuckets; i++) {
+    (*counts)[i] += counts_[i].load(std::memory_order_relaxed);
+  }
+}
+
+void LatencyHistogram::Reset() {
+  for (auto &count : counts_) {
+    count.store(0, std::memory_order_relaxed);
+  }
+}
+
+void LatencyDistribution::Add(const LatencyHistogram &histogram) {
+  histogram.MergeTo(&counts_);
+  total_ = 0;
+  for (auto count : counts_) total_ += count;
+}
+
+uint64_t LatencyDistribution::Percentile(double p) const {
+  if (total_ == 0) return 0;
+
+  auto rank = static_cast<uint64_t>(std::ceil(p / 100 * static_cast<double>(total_)));
+  if (rank == 0) rank = 1;
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i < counts_.size(); i++) {
+    cumulative += counts_[i];
+    if (cumulative >= rank) return LatencyHistogram::BucketUpperBound(i);
+  }
+  return LatencyHistogram::BucketUpperBound(counts_.size() - 1);
+}
+
+std::vector<std::pair<uint64_t, uint64_t>> LatencyDistribution::CumulativeCounts() const {
+  std::vector<std::pair<uint64_t, uint64_t>> result;
+  if (total_ == 0) return result;
+
+  uint64_t cumulative = 0;
+  size_t idx = 0;
+  for (int bits = 1; bits <= LatencyHistogram::kMaxValueBits && cumulative < total_; bits++) {
+    uint64_t boundary = uint64_t(1) << bits;
+    for (; idx < counts_.size() && LatencyHistogram::BucketUpperBound(idx) < boundary; idx++) {
+      cumulative += counts_[idx];
+    }
+    if (cumulative > 0) result.emplace_back(boundary, cumulative);
+  }
+  // the values beyond the largest boundary
+  if (cumulative < total_) result.emplace_back(UINT64_MAX, total_);
+  return result;
+}
+
+ShardedLatencyHistogram::~ShardedLatencyHistogram() {
+  for (auto &shard : shards_) {
+    delete shard.load(std::memory_order_relaxed);
+  }
+}
+
+void ShardedLatencyHistogram::Record(uint64_t value) {
+  auto &shard = shards_[CurrentThreadIndex() % kShards];
+  auto histogram = shard.load(std::memory_order_acquire);
+  if (!histogram) {
+    auto new_histogram = new LatencyHistogram();
+    if (shard.compare_exchange_strong(histogram, new_histogram, std::memory_order_acq_rel)) {
+      histogram = new_histogram;
+    } else {
+      // other thread mapped to the same shard has allocated it
+      delete new_histogram;
+    }
+  }
+  histogram->Record(value);
+}
+
+LatencyDistribution ShardedLatencyHistogram::Distribution() const {
+  LatencyDistribution distribution;
+  for (const auto &shard : shards_) {
+    auto histogram = shard.load(std::memory_order_acquire);
+    if (histogram) distribution.Add(*histogram);
+  }
+  return distribution;
+}
+
+void ShardedLatencyHistogram::Reset() {
+  for (auto &shard : shards_) {
+    auto histogram = shard.load(std::memory_order_acquire);
+    if (histogram) histogram->Reset();
+  }
+}
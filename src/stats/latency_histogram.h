@@ -0,0 +1,92 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// A log-linear histogram of latencies in microseconds like HdrHistogram: every power of two is divided
+// into 16 sub-buckets, so the relative error of the recorded values is below 1/16, and the values
+// less than 16us are recorded exactly. Recording is lock-free and wait-free.
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits = 4;
+  static constexpr size_t kSubBuckets = 1 << kSubBucketBits;
+  // the values not less than 2^40us(about 12 days) are recorded into the last bucket
+  static constexpr int kMaxValueBits = 40;
+  static constexpr size_t kBuckets = (kMaxValueBits - kSubBucketBits + 1) * kSubBuckets;
+
+  LatencyHistogram() = default;
+  LatencyHistogram(const LatencyHistogram &) = delete;
+  LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+  void Record(uint64_t value) { counts_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed); }
+  void MergeTo(std::array<uint64_t, kBuckets> *counts) const;
+  void Reset();
+
+  static size_t BucketIndex(uint64_t value);
+  static uint64_t BucketLowerBound(size_t idx);
+  // the largest value in the bucket
+  static uint64_t BucketUpperBound(size_t idx);
+
+ private:
+  std::array<std::atomic<uint64_t>, kBuckets> counts_{};
+};
+
+// The counts merged from the latency histograms, it's used to compute the percentiles
+class LatencyDistribution {
+ public:
+  void Add(const LatencyHistogram &histogram);
+
+  uint64_t Count() const { return total_; }
+  // The upper bound of the bucket which the p-th percentile falls in, p is in [0, 100]
+  uint64_t Percentile(double p) const;
+  // The cumulative counts of the values less than the power of two boundaries,
+  // from the first non-empty boundary to the one covering all values
+  std::vector<std::pair<uint64_t, uint64_t>> CumulativeCounts() const;
+
+ private:
+  std::array<uint64_t, LatencyHistogram::kBuckets> counts_{};
+  uint64_t total_ = 0;
+};
+
+// The latency histogram sharded by the threads which record it, so the workers seldom write the same
+// cache lines. The shards are allocated on first use and merged on read.
+class ShardedLatencyHistogram {
+ public:
+  static constexpr size_t kShards = 8;
+
+  ShardedLatencyHistogram() = default;
+  ~ShardedLatencyHistogram();
+  ShardedLatencyHistogram(const ShardedLatencyHistogram &) = delete;
+  ShardedLatencyHistogram &operator=(const ShardedLatencyHistogram &) = delete;
+
+  void Record(uint64_t value);
+  LatencyDistribution Distribution() const;
+  void Reset();
+
+ private:
+  std::array<std::atomic<LatencyHistogram *>, kShards> shards_{};
+};
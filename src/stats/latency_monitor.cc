@@ -0,0 +1,93 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "latency_monitor.h"
+
+#include <algorithm>
+
+#include "time_util.h"
+
+void LatencyMonitor::AddSampleIfNeeded(const std::string &event, uint64_t latency_ms) {
+  int threshold_ms = threshold_ms_.load(std::memory_order_relaxed);
+  if (threshold_ms <= 0 || latency_ms < static_cast<uint64_t>(threshold_ms)) return;
+
+  int64_t now = util::GetTimeStamp();
+  std::lock_guard<std::mutex> guard(mu_);
+  auto &history = events_[event];
+  history.max = std::max(history.max, latency_ms);
+
+  // merge the samples in the same second and keep the max latency
+  if (!history.samples.empty()) {
+    auto &prev = history.samples[(history.next + history.samples.size() - 1) % history.samples.size()];
+    if (prev.time == now) {
+      prev.latency = std::max(prev.latency, latency_ms);
+      return;
+    }
+  }
+
+  if (history.samples.size() < kMaxSamplesPerEvent) {
+    history.samples.push_back({now, latency_ms});
+    history.next = history.samples.size() % kMaxSamplesPerEvent;
+  } else {
+    history.samples[history.next] = {now, latency_ms};
+    history.next = (history.next + 1) % kMaxSamplesPerEvent;
+  }
+}
+
+std::vector<LatencyMonitor::EventStats> LatencyMonitor::GetLatest() {
+  std::vector<EventStats> result;
+  std::lock_guard<std::mutex> guard(mu_);
+  for (const auto &[event, history] : events_) {
+    if (history.samples.empty()) continue;
+    auto latest = history.samples[(history.next + history.samples.size() - 1) % history.samples.size()];
+    result.push_back({event, latest, history.max});
+  }
+  return result;
+}
+
+std::vector<LatencyMonitor::Sample> LatencyMonitor::GetHistory(const std::string &event) {
+  std::vector<Sample> result;
+  std::lock_guard<std::mutex> guard(mu_);
+  auto iter = events_.find(event);
+  if (iter == events_.end()) return result;
+
+  // from the oldest to the latest
+  const auto &samples = iter->second.samples;
+  size_t start = samples.size() < kMaxSamplesPerEvent ? 0 : iter->second.next;
+  for (size_t i = 0; i < samples.size(); i++) {
+    result.push_back(samples[(start + i) % samples.size()]);
+  }
+  return result;
+}
+
+size_t LatencyMonitor::Reset(const std::vector<std::string> &events) {
+  std::lock_guard<std::mutex> guard(mu_);
+  if (events.empty()) {
+    size_t reset = events_.size();
+    events_.clear();
+    return reset;
+  }
+
+  size_t reset = 0;
+  for (const auto &event : events) {
+    reset += events_.erase(event);
+  }
+  return reset;
+}
@@ -0,0 +1,70 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// The latency monitor records the latency spikes of the events like the slow commands, flushes,
+// compactions and write stalls, which take not less than `latency-monitor-threshold` milliseconds.
+// It keeps the recent samples of every event, which are queried by the LATENCY command.
+class LatencyMonitor {
+ public:
+  static constexpr size_t kMaxSamplesPerEvent = 160;
+
+  struct Sample {
+    int64_t time;      // in seconds
+    uint64_t latency;  // in milliseconds
+  };
+
+  struct EventStats {
+    std::string event;
+    Sample latest;
+    uint64_t max;
+  };
+
+  LatencyMonitor() = default;
+  LatencyMonitor(const LatencyMonitor &) = delete;
+  LatencyMonitor &operator=(const LatencyMonitor &) = delete;
+
+  void SetThreshold(int threshold_ms) { threshold_ms_.store(threshold_ms, std::memory_order_relaxed); }
+  bool IsEnabled() const { return threshold_ms_.load(std::memory_order_relaxed) > 0; }
+  void AddSampleIfNeeded(const std::string &event, uint64_t latency_ms);
+  std::vector<EventStats> GetLatest();
+  std::vector<Sample> GetHistory(const std::string &event);
+  // Reset the given events or all events if it's empty, return the number of the events reset
+  size_t Reset(const std::vector<std::string> &events);
+
+ private:
+  struct EventHistory {
+    std::vector<Sample> samples;  // the ring buffer of samples
+    size_t next = 0;
+    uint64_t max = 0;
+  };
+
+  std::atomic<int> threshold_ms_ = 0;
+  std::mutex mu_;
+  std::map<std::string, EventHistory> events_;
+};
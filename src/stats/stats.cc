@@ -83,13 +83,31 @@ int64_t Stats::GetMemoryRSS() {
 }
 #endif
 
-void Stats::IncrCalls(const std::string &command_name) {
-  total_calls.fetch_add(1, std::memory_order_relaxed);
-  commands_stats[command_name].calls.fetch_add(1, std::memory_order_relaxed);
+void Stats::InitCommandStats(size_t commands) {
+  commands_ = commands;
+  for (auto &shard : command_stats_shards_) {
+    shard.commands = std::make_unique<CommandStat[]>(commands);
+  }
+  latency_histograms_ = std::make_unique<ShardedLatencyHistogram[]>(commands);
 }
 
-void Stats::IncrLatency(uint64_t latency, const std::string &command_name) {
-  commands_stats[command_name].latency.fetch_add(latency, std::memory_order_relaxed);
+uint64_t Stats::GetTotalCalls() const {
+  uint64_t total = 0;
+  for (const auto &shard : command_stats_shards_) {
+    total += shard.total_calls.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+CommandStatSummary Stats::GetCommandStat(size_t command_id) const {
+  CommandStatSummary summary;
+  if (command_id >= commands_) return summary;
+
+  for (const auto &shard : command_stats_shards_) {
+    summary.calls += shard.commands[command_id].calls.load(std::memory_order_relaxed);
+    summary.latency += shard.commands[command_id].latency.load(std::memory_order_relaxed);
+  }
+  return summary;
 }
 
 void Stats::TrackInstantaneousMetric(int metric, uint64_t current_reading) {
@@ -111,3 +129,20 @@ uint64_t Stats::GetInstantaneousMetric(int metric) const {
   for (uint64_t sample : inst_metrics[metric].samples) sum += sample;
   return sum / STATS_METRIC_SAMPLES;
 }
+
+StatusOr<std::string> Stats::CompressStreamFrame(StreamCompression type, std::string_view data) {
+  auto start = util::GetTimeStampUS();
+  auto frame = GET_OR_RET(util::CompressFrame(type, data));
+  stream_compression_raw_bytes.fetch_add(data.size(), std::memory_order_relaxed);
+  stream_compression_compressed_bytes.fetch_add(frame.size(), std::memory_order_relaxed);
+  stream_compression_us.fetch_add(util::GetTimeStampUS() - start, std::memory_order_relaxed);
+  return frame;
+}
+
+StatusOr<std::string> Stats::DecompressStreamFrame(std::string_view frame) {
+  auto start = util::GetTimeStampUS();
+  auto data = GET_OR_RET(util::DecompressFrame(frame));
+  stream_decompression_raw_bytes.fetch_add(data.size(), std::memory_order_relaxed);
+  stream_decompression_us.fetch_add(util::GetTimeStampUS() - start, std::memory_order_relaxed);
+  return data;
+}
@@ -22,12 +22,19 @@
 
 #include <unistd.h>
 
+#include <array>
 #include <atomic>
-#include <map>
+#include <memory>
 #include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "compression_util.h"
+#include "latency_histogram.h"
+#include "status.h"
+#include "thread_index.h"
+
 enum StatsMetricFlags {
   STATS_METRIC_COMMAND = 0,       // Number of commands executed
   STATS_METRIC_NET_INPUT,         // Bytes read to network
@@ -38,14 +45,23 @@ enum StatsMetricFlags {
   STATS_METRIC_ROCKSDB_SEEK,      // Number of calls of seek in rocksdb
   STATS_METRIC_ROCKSDB_NEXT,      // Number of calls of next in rocksdb
   STATS_METRIC_ROCKSDB_PREV,      // Number of calls of prev in rocksdb
+  STATS_METRIC_EXPIRED_KEYS,      // Number of keys reclaimed by the active expiration
   STATS_METRIC_COUNT
 };
 
 constexpr int STATS_METRIC_SAMPLES = 16;  // Number of samples per metric
 
-struct CommandStat {
-  std::atomic<uint64_t> calls;
-  std::atomic<uint64_t> latency;
+// The counters of a command written by the workers mapped to the same shard, they're aligned to the cache line
+// so the different shards never write the same cache line
+struct alignas(64) CommandStat {
+  std::atomic<uint64_t> calls = 0;
+  std::atomic<uint64_t> latency = 0;
+};
+
+// The counters of a command aggregated from all shards
+struct CommandStatSummary {
+  uint64_t calls = 0;
+  uint64_t latency = 0;
 };
 
 struct InstMetric {
@@ -57,7 +73,8 @@ struct InstMetric {
 
 class Stats {
  public:
-  std::atomic<uint64_t> total_calls = {0};
+  static constexpr size_t kCommandStatsShards = 32;
+
   std::atomic<uint64_t> in_bytes = {0};
   std::atomic<uint64_t> out_bytes = {0};
 
@@ -67,17 +84,50 @@ class Stats {
   std::atomic<uint64_t> fullsync_count = {0};
   std::atomic<uint64_t> psync_err_count = {0};
   std::atomic<uint64_t> psync_ok_count = {0};
-  std::map<std::string, CommandStat> commands_stats;
+  // the replication and migration streams negotiated to be compressed
+  std::atomic<uint64_t> stream_compression_raw_bytes = {0};
+  std::atomic<uint64_t> stream_compression_compressed_bytes = {0};
+  std::atomic<uint64_t> stream_compression_us = {0};
+  std::atomic<uint64_t> stream_decompression_raw_bytes = {0};
+  std::atomic<uint64_t> stream_decompression_us = {0};
 
   Stats();
-  void IncrCalls(const std::string &command_name);
-  void IncrLatency(uint64_t latency, const std::string &command_name);
+  // Allocate the counters of the commands, which are indexed by the command IDs assigned at registration
+  void InitCommandStats(size_t commands);
+  void IncrCalls(size_t command_id) {
+    auto &shard = command_stats_shards_[CurrentThreadIndex() % kCommandStatsShards];
+    shard.total_calls.fetch_add(1, std::memory_order_relaxed);
+    shard.commands[command_id].calls.fetch_add(1, std::memory_order_relaxed);
+  }
+  void IncrLatency(uint64_t latency, size_t command_id) {
+    auto &shard = command_stats_shards_[CurrentThreadIndex() % kCommandStatsShards];
+    shard.commands[command_id].latency.fetch_add(latency, std::memory_order_relaxed);
+    latency_histograms_[command_id].Record(latency);
+  }
+  uint64_t GetTotalCalls() const;
+  CommandStatSummary GetCommandStat(size_t command_id) const;
+  LatencyDistribution GetLatencyDistribution(size_t command_id) const {
+    return latency_histograms_[command_id].Distribution();
+  }
   void IncrInboundBytes(uint64_t bytes) { in_bytes.fetch_add(bytes, std::memory_order_relaxed); }
   void IncrOutboundBytes(uint64_t bytes) { out_bytes.fetch_add(bytes, std::memory_order_relaxed); }
   void IncrFullSyncCount() { fullsync_count.fetch_add(1, std::memory_order_relaxed); }
   void IncrPSyncErrCount() { psync_err_count.fetch_add(1, std::memory_order_relaxed); }
   void IncrPSyncOKCount() { psync_ok_count.fetch_add(1, std::memory_order_relaxed); }
+  // Compress or decompress a frame of the replication and migration streams, and count the bytes and time
+  StatusOr<std::string> CompressStreamFrame(StreamCompression type, std::string_view data);
+  StatusOr<std::string> DecompressStreamFrame(std::string_view frame);
   static int64_t GetMemoryRSS();
   void TrackInstantaneousMetric(int metric, uint64_t current_reading);
   uint64_t GetInstantaneousMetric(int metric) const;
+
+ private:
+  struct alignas(64) CommandStatsShard {
+    std::atomic<uint64_t> total_calls = 0;
+    std::unique_ptr<CommandStat[]> commands;
+  };
+
+  size_t commands_ = 0;
+  std::array<CommandStatsShard, kCommandStatsShards> command_stats_shards_;
+  std::unique_ptr<ShardedLatencyHistogram[]> latency_histograms_;
 };
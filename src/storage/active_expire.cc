@@ -0,0 +1,179 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "active_expire.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "lock_manager.h"
+#include "parse_util.h"
+#include "redis_db.h"
+#include "redis_metadata.h"
+#include "table_properties_collector.h"
+#include "time_util.h"
+
+rocksdb::Status ActiveExpirer::refreshFiles() {
+  // read the version before the properties, so a change in between is picked up by the next cycle
+  auto files_version = storage_->GetMetadataFilesVersion();
+  if (files_loaded_ && files_version == files_version_) return rocksdb::Status::OK();
+
+  rocksdb::TablePropertiesCollection props;
+  auto s = storage_->GetDB()->GetPropertiesOfAllTables(storage_->GetCFHandle(ColumnFamilyID::Metadata), &props);
+  if (!s.ok()) return s;
+
+  // keep the progress of the files which are still alive, and forget the ones compacted away
+  std::map<std::string, FileState> files;
+  for (const auto &[filename, table_props] : props) {
+    if (auto iter = files_.find(filename); iter != files_.end()) {
+      files.emplace(filename, std::move(iter->second));
+      continue;
+    }
+
+    const auto &user_props = table_props->user_collected_properties;
+    auto min_expire = user_props.find(kMinExpireProperty);
+    auto start_key = user_props.find("start_key");
+    auto stop_key = user_props.find("stop_key");
+    if (min_expire == user_props.end() || start_key == user_props.end() || stop_key == user_props.end()) continue;
+    auto parse_result = ParseInt<uint64_t>(min_expire->second, 10);
+    if (!parse_result) continue;
+
+    files.emplace(filename, FileState{start_key->second, stop_key->second, *parse_result,
+                                      std::numeric_limits<uint64_t>::max(), ""});
+  }
+  files_ = std::move(files);
+  files_version_ = files_version;
+  files_loaded_ = true;
+  return rocksdb::Status::OK();
+}
+
+uint64_t ActiveExpirer::RunCycle(uint64_t max_keys, std::vector<std::string> *expired_keys) {
+  auto s = refreshFiles();
+  if (!s.ok()) {
+    LOG(WARNING) << "[active expire] Failed to get table properties, " << s.ToString();
+    return 0;
+  }
+
+  auto metadata_cf = storage_->GetCFHandle(ColumnFamilyID::Metadata);
+  uint64_t now_ms = util::GetTimeStampMS();
+  std::vector<std::pair<uint64_t, std::string>> due_files;
+  for (const auto &[filename, state] : files_) {
+    if (state.due_ms <= now_ms) due_files.emplace_back(state.due_ms, filename);
+  }
+  // the files which have been due for the longest go first
+  std::sort(due_files.begin(), due_files.end());
+
+  uint64_t expired = 0, scan_budget = max_keys * kScanFactor, max_lag_ms = 0;
+  for (const auto &[_, filename] : due_files) {
+    if (expired >= max_keys || scan_budget == 0) break;
+
+    auto &state = files_[filename];
+    // the stop key is inclusive, so bound the scan right after it
+    std::string upper_bound = state.stop_key + '\0';
+    rocksdb::Slice upper_bound_slice(upper_bound);
+    rocksdb::ReadOptions read_options;
+    read_options.fill_cache = false;
+    read_options.iterate_upper_bound = &upper_bound_slice;
+    std::unique_ptr<rocksdb::Iterator> iter(storage_->GetDB()->NewIterator(read_options, metadata_cf));
+
+    iter->Seek(state.resume_key.empty() ? state.start_key : state.resume_key);
+    for (; iter->Valid(); iter->Next()) {
+      if (expired >= max_keys || scan_budget == 0) break;
+      scan_budget--;
+
+      Metadata metadata(kRedisNone, false);
+      if (!metadata.Decode(iter->value()).ok()) continue;
+      if (!metadata.ExpireAt(now_ms)) {
+        if (metadata.expire > 0) state.next_due_ms = std::min(state.next_due_ms, metadata.expire);
+        continue;
+      }
+      if (expireKey(iter->key().ToString(), now_ms)) {
+        expired++;
+        if (expired_keys) expired_keys->emplace_back(iter->key().ToString());
+        if (metadata.expire > 0) max_lag_ms = std::max(max_lag_ms, now_ms - metadata.expire);
+      }
+    }
+
+    if (!iter->status().ok()) {
+      LOG(WARNING) << "[active expire] Failed to scan the keys in file: " << filename
+                   << ", err: " << iter->status().ToString();
+      continue;
+    }
+    if (iter->Valid()) {
+      state.resume_key = iter->key().ToString();
+    } else {
+      // the pass is over, the file is due again when its earliest remaining key expires
+      state.due_ms = state.next_due_ms;
+      state.next_due_ms = std::numeric_limits<uint64_t>::max();
+      state.resume_key.clear();
+    }
+  }
+
+  auto db_stats = storage_->GetDBStats();
+  db_stats->expired_keys.fetch_add(expired, std::memory_order_relaxed);
+  db_stats->expire_lag_ms.store(max_lag_ms, std::memory_order_relaxed);
+  return expired;
+}
+
+bool ActiveExpirer::expireKey(const std::string &ns_key, uint64_t now_ms) {
+  // re-check the metadata under the key lock, the key may be overwritten since it was scanned
+  LockGuard guard(storage_->GetLockManager(), ns_key);
+  auto metadata_cf = storage_->GetCFHandle(ColumnFamilyID::Metadata);
+  std::string value;
+  auto s = storage_->GetDB()->Get(rocksdb::ReadOptions(), metadata_cf, ns_key, &value);
+  if (!s.ok()) return false;
+  Metadata metadata(kRedisNone, false);
+  if (!metadata.Decode(value).ok() || !metadata.ExpireAt(now_ms)) return false;
+
+  auto batch = storage_->GetWriteBatchBase();
+  redis::WriteBatchLogData log_data(kRedisNone);
+  s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return false;
+  s = batch->Delete(metadata_cf, ns_key);
+  if (!s.ok()) return false;
+
+  // The range deletions drop the subkeys at once rather than leaving them to the compaction filter,
+  // but they aren't supported together with the row cache.
+  bool has_subkeys = !metadata.IsSingleKVType() && metadata.version != std::numeric_limits<uint64_t>::max();
+  if (has_subkeys && !storage_->GetDB()->GetDBOptions().row_cache) {
+    auto begin = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
+    auto end = InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+    std::vector<ColumnFamilyID> subkey_cfs = {ColumnFamilyID::PrimarySubkey};
+    if (metadata.Type() == kRedisZSet) subkey_cfs.emplace_back(ColumnFamilyID::SecondarySubkey);
+    if (metadata.Type() == kRedisStream) subkey_cfs = {ColumnFamilyID::Stream};
+    for (auto cf : subkey_cfs) {
+      s = batch->DeleteRange(storage_->GetCFHandle(cf), begin, end);
+      if (!s.ok()) return false;
+    }
+  }
+
+  auto ctx = engine::Context::NoTransactionContext(storage_);
+  s = storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  if (!s.ok()) {
+    LOG(WARNING) << "[active expire] Failed to delete the expired key: " << ns_key << ", err: " << s.ToString();
+    return false;
+  }
+  return true;
+}
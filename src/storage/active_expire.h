@@ -0,0 +1,70 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "storage.h"
+
+// ActiveExpirer reclaims the expired keys in the background, instead of leaving them until they
+// are read or their SST files are compacted. Each metadata SST records the earliest expire time
+// of its keys as a table property, so a cycle only scans the key ranges of the files which have
+// keys due. An expired key is removed by deleting its metadata together with a range deletion
+// over all the subkeys of its version.
+//
+// The table properties are only read again after the metadata SST files change, which the event
+// listener reports on flushes and compactions. The keys which expire while they're still in the
+// memtables aren't seen until they're flushed, they're left to be expired on read until then.
+//
+// A cycle is bounded by the number of keys it may expire and scan, and resumes where it stopped
+// in the next cycle. It must not run concurrently with itself or with a transaction.
+class ActiveExpirer {
+ public:
+  // The number of metadata keys a cycle may scan for each key it may expire
+  static constexpr uint64_t kScanFactor = 10;
+
+  explicit ActiveExpirer(engine::Storage *storage) : storage_(storage) {}
+
+  // Runs one expire cycle and returns the number of the expired keys, whose metadata keys are
+  // appended to expired_keys if it's given
+  uint64_t RunCycle(uint64_t max_keys, std::vector<std::string> *expired_keys = nullptr);
+
+ private:
+  struct FileState {
+    std::string start_key;   // the smallest key of the file
+    std::string stop_key;    // the largest key of the file
+    uint64_t due_ms;         // the time the file has keys to expire again
+    uint64_t next_due_ms;    // the earliest expire time of the keys scanned in the current pass
+    std::string resume_key;  // where the current pass over the file stopped
+  };
+
+  rocksdb::Status refreshFiles();
+  bool expireKey(const std::string &ns_key, uint64_t now_ms);
+
+  engine::Storage *storage_ = nullptr;
+  // the metadata SST files which have keys to expire, refreshed when the files version of the storage changes
+  std::map<std::string, FileState> files_;
+  uint64_t files_version_ = 0;
+  bool files_loaded_ = false;
+};
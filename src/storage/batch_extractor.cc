@@ -22,11 +22,14 @@
 
 #include <glog/logging.h>
 
+#include <iterator>
+
 #include "cluster/redis_slot.h"
 #include "parse_util.h"
 #include "server/redis_reply.h"
 #include "server/server.h"
 #include "types/redis_bitmap.h"
+#include "types/redis_list.h"
 
 void WriteBatchExtractor::LogData(const rocksdb::Slice &blob) {
   // Currently, we only have two kinds of log data
@@ -148,7 +151,8 @@ rocksdb::Status WriteBatchExtractor::PutCF(uint32_t column_family_id, const Slic
               return rocksdb::Status::OK();
             }
 
-            command_args = {"LSET", user_key, (*args)[1], value.ToString()};
+            // the element is recorded in the log data for the chunked lists, whose value is a whole chunk
+            command_args = {"LSET", user_key, (*args)[1], args->size() > 2 ? (*args)[2] : value.ToString()};
             break;
           case kRedisCmdLInsert:
             if (first_seen_) {
@@ -163,16 +167,69 @@ rocksdb::Status WriteBatchExtractor::PutCF(uint32_t column_family_id, const Slic
             }
             break;
           case kRedisCmdLPush:
-            command_args = {"LPUSH", user_key, value.ToString()};
+          case kRedisCmdRPush: {
+            std::string cmd_name = cmd == kRedisCmdLPush ? "LPUSH" : "RPUSH";
+            if (args->size() == 1) {
+              command_args = {cmd_name, user_key, value.ToString()};
+            } else if (first_seen_) {
+              // the pushed elements are recorded in the log data for the chunked lists
+              command_args = {cmd_name, user_key};
+              command_args.insert(command_args.end(), args->begin() + 1, args->end());
+              first_seen_ = false;
+            }
+            break;
+          }
+          case kRedisCmdRPushChunk: {
+            // every chunk is put in the order of the list, so its elements are appended to the list
+            std::vector<std::string> elems;
+            auto s = redis::List::DecodeChunk(value, &elems);
+            if (!s.ok()) return s;
+            command_args = {"RPUSH", user_key};
+            std::move(elems.begin(), elems.end(), std::back_inserter(command_args));
+            break;
+          }
+          case kRedisCmdLPop:
+          case kRedisCmdRPop:
+            // only the chunked lists put subkeys while popping, and they record the count in the log data
+            if (first_seen_ && args->size() > 1) {
+              command_args = {cmd == kRedisCmdLPop ? "LPOP" : "RPOP", user_key, (*args)[1]};
+              first_seen_ = false;
+            }
             break;
-          case kRedisCmdRPush:
-            command_args = {"RPUSH", user_key, value.ToString()};
+          case kRedisCmdLTrim:
+            if (first_seen_) {
+              if (args->size() < 3) {
+                LOG(ERROR) << "Failed to parse write_batch in PutCF; Command=LTRIM: no enough arguments, should "
+                              "contain start and stop";
+                return rocksdb::Status::OK();
+              }
+
+              command_args = {"LTRIM", user_key, (*args)[1], (*args)[2]};
+              first_seen_ = false;
+            }
             break;
           case kRedisCmdLRem:
-            // LREM will be parsed in DeleteCF, so ignore it here
+            if (first_seen_) {
+              if (args->size() < 3) {
+                LOG(ERROR) << "Failed to parse write_batch in PutCF. Command=LREM: no enough arguments, should "
+                              "contain count and value";
+                return rocksdb::Status::OK();
+              }
+
+              command_args = {"LREM", user_key, (*args)[1], (*args)[2]};
+              first_seen_ = false;
+            }
             break;
           case kRedisCmdLMove:
-            // LMOVE will be parsed in DeleteCF, so ignore it here
+            if (first_seen_) {
+              if (args->size() < 5) {
+                LOG(ERROR) << "Failed to parse write_batch in PutCF; Command=LMOVE: no enough arguments, should "
+                              "contain source, destination and where/from arguments";
+                return rocksdb::Status::OK();
+              }
+              command_args = {"LMOVE", (*args)[1], (*args)[2], (*args)[3], (*args)[4]};
+              first_seen_ = false;
+            }
             break;
           default:
             LOG(ERROR) << "Failed to parse write_batch in PutCF. Type=List: unhandled command with code "
@@ -189,6 +246,9 @@ rocksdb::Status WriteBatchExtractor::PutCF(uint32_t column_family_id, const Slic
         break;
       }
       case kRedisBitmap: {
+        // the popcount summary is maintained by the commands themselves
+        if (redis::Bitmap::IsSummarySubKey(sub_key)) break;
+
         auto args = log_data_.GetArguments();
         if (args->empty()) {
           LOG(ERROR)
@@ -216,7 +276,10 @@ rocksdb::Status WriteBatchExtractor::PutCF(uint32_t column_family_id, const Slic
               return rocksdb::Status::InvalidArgument(
                   fmt::format("failed to parse an offset of SETBIT: {}", parsed_offset.Msg()));
             }
-            bool bit_value = redis::Bitmap::GetBitFromValueAndOffset(value.ToStringView(), *parsed_offset);
+            // the new bit is recorded in the log data since the value can be a compressed segment
+            bool bit_value = args->size() > 2
+                                 ? (*args)[2] == "1"
+                                 : redis::Bitmap::GetBitFromValueAndOffset(value.ToStringView(), *parsed_offset);
             command_args = {"SETBIT", user_key, (*args)[1], bit_value ? "1" : "0"};
             break;
           }
@@ -349,11 +412,17 @@ rocksdb::Status WriteBatchExtractor::DeleteCF(uint32_t column_family_id, const S
             }
             break;
           case kRedisCmdLPop:
-            command_args = {"LPOP", user_key};
-            break;
-          case kRedisCmdRPop:
-            command_args = {"RPOP", user_key};
+          case kRedisCmdRPop: {
+            std::string cmd_name = cmd == kRedisCmdLPop ? "LPOP" : "RPOP";
+            if (args->size() == 1) {
+              command_args = {cmd_name, user_key};
+            } else if (first_seen_) {
+              // the chunked lists record the count of popped elements in the log data
+              command_args = {cmd_name, user_key, (*args)[1]};
+              first_seen_ = false;
+            }
             break;
+          }
           case kRedisCmdLMove:
             if (first_seen_) {
               if (args->size() < 5) {
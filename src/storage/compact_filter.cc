@@ -22,10 +22,12 @@
 
 #include <glog/logging.h>
 
+#include <limits>
 #include <string>
 #include <utility>
 
 #include "db_util.h"
+#include "encoding.h"
 #include "time_util.h"
 #include "types/redis_bitmap.h"
 
@@ -49,6 +51,33 @@ bool MetadataFilter::Filter([[maybe_unused]] int level, const Slice &key, const
   return metadata.Expired();
 }
 
+const std::string *MetadataCache::Get(const std::string &key) {
+  auto iter = map_.find(key);
+  if (iter == map_.end()) return nullptr;
+
+  lru_.splice(lru_.begin(), lru_, iter->second);
+  return &iter->second->second;
+}
+
+void MetadataCache::Put(const std::string &key, std::string metadata) {
+  if (capacity_ == 0) return;
+
+  Erase(key);
+  while (map_.size() >= capacity_) {
+    map_.erase(lru_.back().first);
+    lru_.pop_back();
+  }
+  lru_.emplace_front(key, std::move(metadata));
+  map_.emplace(key, lru_.begin());
+}
+
+void MetadataCache::Erase(const std::string &key) {
+  if (auto iter = map_.find(key); iter != map_.end()) {
+    lru_.erase(iter->second);
+    map_.erase(iter);
+  }
+}
+
 Status SubKeyFilter::GetMetadata(const InternalKey &ikey, Metadata *metadata) const {
   auto db = stor_->GetDB();
   const auto cf_handles = stor_->GetCFHandles();
@@ -56,29 +85,28 @@ Status SubKeyFilter::GetMetadata(const InternalKey &ikey, Metadata *metadata) co
   if (!db || cf_handles->size() < 2) return {Status::NotOK, "storage is closed"};
   std::string metadata_key = ComposeNamespaceKey(ikey.GetNamespace(), ikey.GetKey(), stor_->IsSlotIdEncoded());
 
-  if (cached_key_.empty() || metadata_key != cached_key_) {
+  // The cached metadata may be stale within a compaction job, but the version of a key only moves forward
+  // and an expired or deleted key can't come back, so a subkey which was dead stays dead.
+  const std::string *cached = cache_.Get(metadata_key);
+  if (!cached) {
     std::string bytes;
     rocksdb::Status s = db->Get(rocksdb::ReadOptions(), (*cf_handles)[1], metadata_key, &bytes);
-    cached_key_ = std::move(metadata_key);
-    if (s.ok()) {
-      cached_metadata_ = std::move(bytes);
-    } else if (s.IsNotFound()) {
-      // metadata was deleted(perhaps compaction or manual)
-      // clear the metadata
-      cached_metadata_.clear();
-      return {Status::NotFound, "metadata is not found"};
-    } else {
-      cached_key_.clear();
-      cached_metadata_.clear();
+    if (s.IsNotFound()) {
+      // metadata was deleted(perhaps compaction or manual), cache it as empty
+      bytes.clear();
+    } else if (!s.ok()) {
       return {Status::NotOK, "fetch error: " + s.ToString()};
     }
+    cache_.Put(metadata_key, std::move(bytes));
+    cached = cache_.Get(metadata_key);
+    if (!cached) return {Status::NotOK, "metadata cache is disabled"};
   }
   // the metadata was not found
-  if (cached_metadata_.empty()) return {Status::NotFound, "metadata is not found"};
+  if (cached->empty()) return {Status::NotFound, "metadata is not found"};
   // the metadata is cached
-  rocksdb::Status s = metadata->Decode(cached_metadata_);
+  rocksdb::Status s = metadata->Decode(*cached);
   if (!s.ok()) {
-    cached_key_.clear();
+    cache_.Erase(metadata_key);
     return {Status::NotOK, "decode error: " + s.ToString()};
   }
   return Status::OK();
@@ -95,14 +123,25 @@ bool SubKeyFilter::IsMetadataExpired(const InternalKey &ikey, const Metadata &me
          || metadata.ExpireAt(lazy_expired_ts) || ikey.GetVersion() != metadata.version;
 }
 
+std::string SubKeyFilter::DeadRangeEnd(const Slice &key, const InternalKey &ikey) {
+  // all the subkeys of a version share the prefix which ends with the big-endian version
+  uint64_t version = ikey.GetVersion();
+  if (version == std::numeric_limits<uint64_t>::max()) return {};
+
+  size_t version_end = key.size() - ikey.GetSubKey().size();
+  std::string end(key.data(), version_end);
+  EncodeFixed64(end.data() + version_end - sizeof(uint64_t), version + 1);
+  return end;
+}
+
 rocksdb::CompactionFilter::Decision SubKeyFilter::FilterBlobByKey([[maybe_unused]] int level, const Slice &key,
                                                                   [[maybe_unused]] std::string *new_value,
-                                                                  [[maybe_unused]] std::string *skip_until) const {
+                                                                  std::string *skip_until) const {
   InternalKey ikey(key, stor_->IsSlotIdEncoded());
   Metadata metadata(kRedisNone, false);
   Status s = GetMetadata(ikey, &metadata);
   if (s.Is<Status::NotFound>()) {
-    return rocksdb::CompactionFilter::Decision::kRemove;
+    return removeDead(key, ikey, skip_until);
   }
   if (!s.IsOK()) {
     LOG(ERROR) << "[compact_filter/subkey] Failed to get metadata"
@@ -114,8 +153,8 @@ rocksdb::CompactionFilter::Decision SubKeyFilter::FilterBlobByKey([[maybe_unused
     return rocksdb::CompactionFilter::Decision::kUndetermined;
   }
 
-  bool result = IsMetadataExpired(ikey, metadata);
-  return result ? rocksdb::CompactionFilter::Decision::kRemove : rocksdb::CompactionFilter::Decision::kKeep;
+  if (IsMetadataExpired(ikey, metadata)) return removeDead(key, ikey, skip_until);
+  return rocksdb::CompactionFilter::Decision::kKeep;
 }
 
 bool SubKeyFilter::Filter([[maybe_unused]] int level, const Slice &key, const Slice &value,
@@ -135,4 +174,52 @@ bool SubKeyFilter::Filter([[maybe_unused]] int level, const Slice &key, const Sl
   return IsMetadataExpired(ikey, metadata) || (metadata.Type() == kRedisBitmap && redis::Bitmap::IsEmptySegment(value));
 }
 
+rocksdb::CompactionFilter::Decision SubKeyFilter::FilterV2(int level, const Slice &key, ValueType value_type,
+                                                           const Slice &existing_value, std::string *new_value,
+                                                           std::string *skip_until) const {
+  if (value_type != ValueType::kValue) {
+    return rocksdb::CompactionFilter::FilterV2(level, key, value_type, existing_value, new_value, skip_until);
+  }
+
+  InternalKey ikey(key, stor_->IsSlotIdEncoded());
+  Metadata metadata(kRedisNone, false);
+  Status s = GetMetadata(ikey, &metadata);
+  if (!s.IsOK() && !s.Is<Status::NotFound>()) {
+    LOG(ERROR) << "[compact_filter/subkey] Failed to get metadata"
+               << ", namespace: " << ikey.GetNamespace() << ", key: " << ikey.GetKey() << ", err: " << s.Msg();
+    return rocksdb::CompactionFilter::Decision::kKeep;
+  }
+
+  if (s.Is<Status::NotFound>() || IsMetadataExpired(ikey, metadata)) {
+    return removeDead(key, ikey, skip_until);
+  }
+  if (metadata.Type() == kRedisBitmap && redis::Bitmap::IsEmptySegment(existing_value)) {
+    return rocksdb::CompactionFilter::Decision::kRemove;
+  }
+  return rocksdb::CompactionFilter::Decision::kKeep;
+}
+
+rocksdb::CompactionFilter::Decision SubKeyFilter::removeDead(const Slice &key, const InternalKey &ikey,
+                                                             std::string *skip_until) const {
+  // every subkey of this version is dead, so skip them all instead of looking up each of them
+  if (skip_dead_ranges_) {
+    if (auto end = DeadRangeEnd(key, ikey); !end.empty()) {
+      *skip_until = std::move(end);
+      return rocksdb::CompactionFilter::Decision::kRemoveAndSkipUntil;
+    }
+  }
+  return rocksdb::CompactionFilter::Decision::kRemove;
+}
+
+std::unique_ptr<rocksdb::CompactionFilter> SubKeyFilterFactory::CreateCompactionFilter(
+    [[maybe_unused]] const rocksdb::CompactionFilter::Context &context) {
+  // Skipping a range also drops the subkeys which are still visible to a snapshot,
+  // so only do it when there is no snapshot at the time the compaction starts
+  uint64_t num_snapshots = 0;
+  auto db = stor_->GetDB();
+  bool skip_dead_ranges = db && db->GetIntProperty(rocksdb::DB::Properties::kNumSnapshots, &num_snapshots) &&
+                          num_snapshots == 0;
+  return std::unique_ptr<rocksdb::CompactionFilter>(new SubKeyFilter(stor_, skip_dead_ranges));
+}
+
 }  // namespace engine
@@ -23,8 +23,10 @@
 #include <rocksdb/compaction_filter.h>
 #include <rocksdb/db.h>
 
+#include <list>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "redis_metadata.h"
@@ -55,21 +57,55 @@ class MetadataFilterFactory : public rocksdb::CompactionFilterFactory {
   engine::Storage *stor_ = nullptr;
 };
 
+// MetadataCache is a small LRU cache of the encoded metadata of the keys a compaction job has seen,
+// so the subkeys of a few interleaved keys don't keep fetching their metadata again.
+// A key whose metadata was not found is cached with an empty value.
+class MetadataCache {
+ public:
+  static constexpr size_t kDefaultCapacity = 1024;
+
+  explicit MetadataCache(size_t capacity = kDefaultCapacity) : capacity_(capacity) {}
+
+  const std::string *Get(const std::string &key);
+  void Put(const std::string &key, std::string metadata);
+  void Erase(const std::string &key);
+  size_t Size() const { return map_.size(); }
+
+ private:
+  using Entry = std::pair<std::string, std::string>;
+
+  size_t capacity_;
+  std::list<Entry> lru_;  // the most recently used entry goes first
+  std::unordered_map<std::string, std::list<Entry>::iterator> map_;
+};
+
 class SubKeyFilter : public rocksdb::CompactionFilter {
  public:
-  explicit SubKeyFilter(Storage *storage) : stor_(storage) {}
+  // Removing a range skips the subkeys without checking their sequence numbers, so the subkeys
+  // visible to a snapshot could be removed as well. Only enable it if there is no snapshot.
+  explicit SubKeyFilter(Storage *storage, bool skip_dead_ranges = false)
+      : stor_(storage), skip_dead_ranges_(skip_dead_ranges) {}
 
   const char *Name() const override { return "SubkeyFilter"; }
   Status GetMetadata(const InternalKey &ikey, Metadata *metadata) const;
   static bool IsMetadataExpired(const InternalKey &ikey, const Metadata &metadata);
+  // Returns the first key after all the subkeys sharing the key and version of the given subkey,
+  // or an empty string if there is no such key
+  static std::string DeadRangeEnd(const Slice &key, const InternalKey &ikey);
   rocksdb::CompactionFilter::Decision FilterBlobByKey(int level, const Slice &key, std::string *new_value,
                                                       std::string *skip_until) const override;
   bool Filter(int level, const Slice &key, const Slice &value, std::string *new_value, bool *modified) const override;
+  rocksdb::CompactionFilter::Decision FilterV2(int level, const Slice &key, ValueType value_type,
+                                               const Slice &existing_value, std::string *new_value,
+                                               std::string *skip_until) const override;
 
  protected:
-  mutable std::string cached_key_;
-  mutable std::string cached_metadata_;
+  rocksdb::CompactionFilter::Decision removeDead(const Slice &key, const InternalKey &ikey,
+                                                 std::string *skip_until) const;
+
+  mutable MetadataCache cache_;
   engine::Storage *stor_;
+  bool skip_dead_ranges_;
 };
 
 class SubKeyFilterFactory : public rocksdb::CompactionFilterFactory {
@@ -78,9 +114,7 @@ class SubKeyFilterFactory : public rocksdb::CompactionFilterFactory {
 
   const char *Name() const override { return "SubKeyFilterFactory"; }
   std::unique_ptr<rocksdb::CompactionFilter> CreateCompactionFilter(
-      [[maybe_unused]] const rocksdb::CompactionFilter::Context &context) override {
-    return std::unique_ptr<rocksdb::CompactionFilter>(new SubKeyFilter(stor_));
-  }
+      [[maybe_unused]] const rocksdb::CompactionFilter::Context &context) override;
 
  private:
   engine::Storage *stor_ = nullptr;
@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "fmt/format.h"
+#include "time_util.h"
 
 std::string BackgroundErrorReason2String(const rocksdb::BackgroundErrorReason reason) {
   std::vector<std::string> background_error_reason = {
@@ -96,6 +97,8 @@ void EventListener::OnCompactionCompleted([[maybe_unused]] rocksdb::DB *db, cons
             << ", elapsed(micro): " << ci.stats.elapsed_micros;
   storage_->RecordStat(engine::StatType::CompactionCount, 1);
   storage_->CheckDBSizeLimit();
+  if (ci.cf_name == engine::kMetadataColumnFamilyName) storage_->OnMetadataFilesChanged();
+  storage_->GetLatencyMonitor()->AddSampleIfNeeded("compaction", ci.stats.elapsed_micros / 1000);
 }
 
 void EventListener::OnSubcompactionBegin(const rocksdb::SubcompactionJobInfo &si) {
@@ -117,11 +120,26 @@ void EventListener::OnSubcompactionCompleted(const rocksdb::SubcompactionJobInfo
 void EventListener::OnFlushBegin([[maybe_unused]] rocksdb::DB *db, const rocksdb::FlushJobInfo &fi) {
   LOG(INFO) << "[event_listener/flush_begin] column family: " << fi.cf_name << ", thread_id: " << fi.thread_id
             << ", job_id: " << fi.job_id << ", reason: " << rocksdb::GetFlushReasonString(fi.flush_reason);
+  if (storage_->GetLatencyMonitor()->IsEnabled()) {
+    std::lock_guard<std::mutex> guard(latency_mu_);
+    flush_begin_ms_[fi.job_id] = util::GetTimeStampMS();
+  }
 }
 
 void EventListener::OnFlushCompleted([[maybe_unused]] rocksdb::DB *db, const rocksdb::FlushJobInfo &fi) {
   storage_->RecordStat(engine::StatType::FlushCount, 1);
   storage_->CheckDBSizeLimit();
+  if (fi.cf_name == engine::kMetadataColumnFamilyName) {
+    storage_->GetKeyNumEstimator()->OnFlushCompleted(fi.largest_seqno);
+    storage_->OnMetadataFilesChanged();
+  }
+  {
+    std::lock_guard<std::mutex> guard(latency_mu_);
+    if (auto iter = flush_begin_ms_.find(fi.job_id); iter != flush_begin_ms_.end()) {
+      storage_->GetLatencyMonitor()->AddSampleIfNeeded("flush", util::GetTimeStampMS() - iter->second);
+      flush_begin_ms_.erase(iter);
+    }
+  }
   LOG(INFO) << "[event_listener/flush_completed] column family: " << fi.cf_name << ", thread_id: " << fi.thread_id
             << ", job_id: " << fi.job_id << ", file: " << fi.file_path
             << ", reason: " << static_cast<int>(fi.flush_reason)
@@ -171,6 +189,19 @@ void EventListener::OnStallConditionsChanged(const rocksdb::WriteStallInfo &info
   LOG(WARNING) << "[event_listener/stall_cond_changed] column family: " << info.cf_name
                << " write stall condition was changed, from " << StallConditionType2String(info.condition.prev)
                << " to " << StallConditionType2String(info.condition.cur);
+
+  // record how long the writes of the column family were slowed down or stopped
+  uint64_t now_ms = util::GetTimeStampMS();
+  std::lock_guard<std::mutex> guard(latency_mu_);
+  if (auto iter = stall_begin_ms_.find(info.cf_name); iter != stall_begin_ms_.end()) {
+    auto [cond, begin_ms] = iter->second;
+    const char *event = cond == rocksdb::WriteStallCondition::kStopped ? "write-stop" : "write-slowdown";
+    storage_->GetLatencyMonitor()->AddSampleIfNeeded(event, now_ms - begin_ms);
+    stall_begin_ms_.erase(iter);
+  }
+  if (info.condition.cur != rocksdb::WriteStallCondition::kNormal) {
+    stall_begin_ms_[info.cf_name] = {info.condition.cur, now_ms};
+  }
 }
 
 void EventListener::OnTableFileCreated(const rocksdb::TableFileCreationInfo &info) {
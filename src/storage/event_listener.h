@@ -23,6 +23,11 @@
 #include <glog/logging.h>
 #include <rocksdb/listener.h>
 
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
 #include "storage.h"
 
 class EventListener : public rocksdb::EventListener {
@@ -43,4 +48,9 @@ class EventListener : public rocksdb::EventListener {
 
  private:
   engine::Storage *storage_ = nullptr;
+
+  // the start time of the flushes and the write stalls, for the latency monitor
+  std::mutex latency_mu_;
+  std::map<int, uint64_t> flush_begin_ms_;
+  std::map<std::string, std::pair<rocksdb::WriteStallCondition, uint64_t>> stall_begin_ms_;
 };
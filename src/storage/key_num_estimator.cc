@@ -0,0 +1,355 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "key_num_estimator.h"
+
+#include <rocksdb/sst_file_writer.h>
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+
+#include "cluster/redis_slot.h"
+#include "storage.h"
+#include "time_util.h"
+
+void KeyNumEstimator::Reset() {
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    dirty_ = true;
+    files_.clear();
+  }
+  // the memtables recovered from the WAL are flushed by opening the DB
+  std::lock_guard<std::mutex> guard(memtable_mu_);
+  flushed_sequence_ = 0;
+  pending_deletions_.clear();
+  memtable_keys_.clear();
+  memtable_ns_totals_.clear();
+  memtable_slot_totals_.clear();
+}
+
+void KeyNumEstimator::OnBatchWritten(rocksdb::WriteBatch *batch, rocksdb::SequenceNumber sequence) {
+  // the entries of a batch take the sequence numbers one by one from that of the batch
+  class MetadataExtractor : public rocksdb::WriteBatch::Handler {
+   public:
+    explicit MetadataExtractor(rocksdb::SequenceNumber sequence) : sequence_(sequence) {}
+
+    rocksdb::Status PutCF(uint32_t column_family_id, const rocksdb::Slice &key, const rocksdb::Slice &value) override {
+      if (isMetadata(column_family_id)) {
+        MemtableKey entry{sequence_, false, 0};
+        Metadata metadata(kRedisNone, false);
+        if (metadata.Decode(value).ok() && metadata.expire > 0) {
+          entry.expire_secs = Metadata::ExpireMsToS(metadata.expire);
+        }
+        keys.emplace_back(key.ToString(), entry);
+      }
+      sequence_++;
+      return rocksdb::Status::OK();
+    }
+    rocksdb::Status DeleteCF(uint32_t column_family_id, const rocksdb::Slice &key) override {
+      if (isMetadata(column_family_id)) keys.emplace_back(key.ToString(), MemtableKey{sequence_, true, 0});
+      sequence_++;
+      return rocksdb::Status::OK();
+    }
+    rocksdb::Status SingleDeleteCF(uint32_t column_family_id, const rocksdb::Slice &key) override {
+      return DeleteCF(column_family_id, key);
+    }
+    rocksdb::Status MergeCF([[maybe_unused]] uint32_t column_family_id, [[maybe_unused]] const rocksdb::Slice &key,
+                            [[maybe_unused]] const rocksdb::Slice &value) override {
+      sequence_++;
+      return rocksdb::Status::OK();
+    }
+    rocksdb::Status DeleteRangeCF(uint32_t column_family_id, const rocksdb::Slice &begin_key,
+                                  const rocksdb::Slice &end_key) override {
+      if (isMetadata(column_family_id)) deletions.push_back({begin_key.ToString(), end_key.ToString(), sequence_});
+      sequence_++;
+      return rocksdb::Status::OK();
+    }
+
+    std::vector<std::pair<std::string, MemtableKey>> keys;
+    std::vector<RangeDeletion> deletions;
+
+   private:
+    static bool isMetadata(uint32_t column_family_id) {
+      return column_family_id == static_cast<uint32_t>(ColumnFamilyID::Metadata);
+    }
+
+    rocksdb::SequenceNumber sequence_;
+  };
+
+  MetadataExtractor extractor(sequence);
+  if (!batch->Iterate(&extractor).ok()) return;
+  if (extractor.keys.empty() && extractor.deletions.empty()) return;
+
+  {
+    std::lock_guard<std::mutex> guard(memtable_mu_);
+    for (auto &deletion : extractor.deletions) {
+      // it's already in the table properties if the flush completed before it's counted
+      if (deletion.sequence <= flushed_sequence_) continue;
+      deleteMemtableRangeLocked(deletion);
+      pending_deletions_.emplace_back(std::move(deletion));
+    }
+    for (auto &[key, entry] : extractor.keys) putMemtableKeyLocked(std::move(key), entry);
+  }
+
+  if (extractor.deletions.empty()) return;
+  std::lock_guard<std::mutex> guard(mu_);
+  dirty_ = true;
+}
+
+void KeyNumEstimator::OnFlushCompleted(rocksdb::SequenceNumber largest_sequence) {
+  std::lock_guard<std::mutex> guard(memtable_mu_);
+  flushed_sequence_ = std::max(flushed_sequence_, largest_sequence);
+
+  // the flushed keys and range deletions are found in the table properties from now on,
+  // and the sums of the files are refreshed since the flush changes the super version
+  for (auto iter = memtable_keys_.begin(); iter != memtable_keys_.end();) {
+    if (iter->second.sequence > largest_sequence) {
+      ++iter;
+      continue;
+    }
+    countMemtableKeyLocked(iter->first, iter->second, -1);
+    iter = memtable_keys_.erase(iter);
+  }
+  auto iter = std::remove_if(pending_deletions_.begin(), pending_deletions_.end(),
+                             [largest_sequence](const RangeDeletion &d) { return d.sequence <= largest_sequence; });
+  pending_deletions_.erase(iter, pending_deletions_.end());
+}
+
+rocksdb::Status KeyNumEstimator::GetKeyNumStats(const std::string &ns, KeyNumStats *stats) {
+  Totals totals;
+  auto add_totals = [&ns, &totals](const std::map<std::string, Totals> &ns_totals) {
+    for (const auto &[total_ns, total] : ns_totals) {
+      if (ns != kDefaultNamespace && ns != total_ns) continue;
+      totals.keys += total.keys;
+      totals.expires += total.expires;
+      totals.expire_sum_secs += total.expire_sum_secs;
+    }
+  };
+
+  // the keys flushed in between are counted twice rather than missed
+  {
+    std::lock_guard<std::mutex> guard(memtable_mu_);
+    add_totals(memtable_ns_totals_);
+  }
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    auto s = refreshLocked();
+    if (!s.ok()) return s;
+    add_totals(ns_totals_);
+  }
+
+  // the keys of a file may be deleted by a newer file, so only the sum makes sense
+  auto keys = static_cast<uint64_t>(std::max<int64_t>(totals.keys, 0));
+  auto expires = static_cast<uint64_t>(std::clamp<int64_t>(totals.expires, 0, std::max<int64_t>(totals.keys, 0)));
+  auto ttl_sum_secs = std::max<int64_t>(totals.expire_sum_secs - totals.expires * util::GetTimeStamp(), 0);
+
+  stats->n_key = keys;
+  stats->n_expires = expires;
+  stats->n_expired = 0;
+  stats->avg_ttl = expires > 0 ? static_cast<uint64_t>(ttl_sum_secs) / expires : 0;
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status KeyNumEstimator::CountKeysInSlot(const std::string &ns, uint16_t slot, uint64_t *count) {
+  if (!storage_->IsSlotIdEncoded()) return rocksdb::Status::NotSupported("the slot id isn't encoded");
+  if (slot >= HASH_SLOTS_SIZE) return rocksdb::Status::InvalidArgument("invalid slot");
+
+  int64_t keys = 0;
+  {
+    std::lock_guard<std::mutex> guard(memtable_mu_);
+    if (auto iter = memtable_slot_totals_.find(ns); iter != memtable_slot_totals_.end()) keys += iter->second[slot];
+  }
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    auto s = refreshLocked();
+    if (!s.ok()) return s;
+
+    if (auto iter = slot_totals_.find(ns); iter != slot_totals_.end()) keys += iter->second[slot];
+  }
+
+  *count = static_cast<uint64_t>(std::max<int64_t>(keys, 0));
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status KeyNumEstimator::refreshLocked() {
+  auto db = storage_->GetDB();
+  auto metadata_cf = storage_->GetCFHandle(ColumnFamilyID::Metadata);
+  uint64_t super_version = 0;
+  if (!db->GetIntProperty(metadata_cf, rocksdb::DB::Properties::kCurrentSuperVersionNumber, &super_version)) {
+    return rocksdb::Status::NotSupported("failed to get the super version number");
+  }
+  if (!dirty_ && super_version == super_version_) {
+    return complete_ ? rocksdb::Status::OK() : rocksdb::Status::Incomplete("some SST files aren't counted yet");
+  }
+
+  rocksdb::TablePropertiesCollection props;
+  auto s = db->GetPropertiesOfAllTables(metadata_cf, &props);
+  if (!s.ok()) return s;
+
+  // reuse the decoded properties of the files which are still alive
+  std::map<std::string, KeyNumProperty> files;
+  std::map<std::string, rocksdb::SequenceNumber> ingested_sequences;
+  bool complete = true;
+  for (const auto &[filename, table_props] : props) {
+    if (auto iter = files_.find(filename); iter != files_.end()) {
+      files.emplace(filename, std::move(iter->second));
+      continue;
+    }
+
+    const auto &user_props = table_props->user_collected_properties;
+    auto iter = user_props.find(kKeyNumProperty);
+    KeyNumProperty property;
+    if (iter == user_props.end() || !property.Decode(iter->second)) {
+      complete = false;
+      continue;
+    }
+
+    // the keys of an ingested file were written without sequence numbers, they take the one assigned
+    // by the ingestion, which is newer than the range deletions of the slots before importing them
+    if (user_props.count(rocksdb::ExternalSstFilePropertyNames::kVersion) > 0) {
+      if (ingested_sequences.empty()) ingested_sequences = getFileSequences();
+      auto sequence = ingested_sequences[filename];
+      for (auto &entry : property.namespaces) entry.max_sequence = sequence;
+      for (auto &deletion : property.range_deletions) deletion.sequence = sequence;
+    }
+    files.emplace(filename, std::move(property));
+  }
+  files_ = std::move(files);
+
+  std::vector<const RangeDeletion *> deletions;
+  for (const auto &[_, property] : files_) {
+    for (const auto &deletion : property.range_deletions) deletions.emplace_back(&deletion);
+  }
+  std::vector<RangeDeletion> pending_deletions;
+  {
+    std::lock_guard<std::mutex> guard(memtable_mu_);
+    pending_deletions = pending_deletions_;
+  }
+  for (const auto &deletion : pending_deletions) deletions.emplace_back(&deletion);
+  std::sort(deletions.begin(), deletions.end(),
+            [](const RangeDeletion *l, const RangeDeletion *r) { return l->begin < r->begin; });
+
+  ns_totals_.clear();
+  slot_totals_.clear();
+  for (const auto &[_, property] : files_) {
+    for (const auto &entry : property.namespaces) {
+      // the smallest key after the last one, as the end of the range is excluded
+      std::string end = entry.last_key + '\0';
+      if (isCovered(deletions, entry.first_key, end, entry.max_sequence)) continue;
+
+      auto &totals = ns_totals_[entry.ns];
+      totals.keys += static_cast<int64_t>(entry.keys) - static_cast<int64_t>(entry.deletes);
+      totals.expires += static_cast<int64_t>(entry.expires);
+      totals.expire_sum_secs += static_cast<int64_t>(entry.expire_sum_secs);
+
+      if (entry.slots.empty()) continue;
+      auto &slots = slot_totals_[entry.ns];
+      slots.resize(HASH_SLOTS_SIZE, 0);
+      for (const auto &slot : entry.slots) {
+        auto slot_begin = std::max(entry.first_key, ComposeSlotKeyPrefix(entry.ns, slot.slot));
+        auto slot_end = std::min(end, ComposeSlotKeyPrefix(entry.ns, slot.slot + 1));
+        if (isCovered(deletions, slot_begin, slot_end, entry.max_sequence)) continue;
+        slots[slot.slot] += static_cast<int64_t>(slot.keys) - static_cast<int64_t>(slot.deletes);
+      }
+    }
+  }
+
+  super_version_ = super_version;
+  dirty_ = false;
+  complete_ = complete;
+  return complete_ ? rocksdb::Status::OK() : rocksdb::Status::Incomplete("some SST files aren't counted yet");
+}
+
+std::map<std::string, rocksdb::SequenceNumber> KeyNumEstimator::getFileSequences() {
+  std::vector<rocksdb::LiveFileMetaData> metadata;
+  storage_->GetDB()->GetLiveFilesMetaData(&metadata);
+
+  std::map<std::string, rocksdb::SequenceNumber> sequences;
+  for (const auto &file : metadata) {
+    if (file.column_family_name != engine::kMetadataColumnFamilyName) continue;
+    sequences.emplace(file.db_path + file.name, file.largest_seqno);
+  }
+  return sequences;
+}
+
+bool KeyNumEstimator::isCovered(const std::vector<const RangeDeletion *> &deletions, const std::string &begin,
+                                const std::string &end, rocksdb::SequenceNumber sequence) {
+  // the keys before `covered` are deleted
+  std::string covered = begin;
+  for (const auto *deletion : deletions) {
+    if (deletion->begin > covered) break;
+    if (deletion->sequence <= sequence || deletion->end <= covered) continue;
+    covered = deletion->end;
+    if (covered >= end) return true;
+  }
+  return false;
+}
+
+void KeyNumEstimator::countMemtableKeyLocked(const std::string &key, const MemtableKey &entry, int64_t sign) {
+  bool slot_id_encoded = storage_->IsSlotIdEncoded();
+  auto ns = std::get<0>(ExtractNamespaceKey(key, slot_id_encoded)).ToString();
+  // a deletion marker hides a key of the files, like the deletes of a file
+  int64_t keys = entry.is_delete ? -sign : sign;
+
+  auto &totals = memtable_ns_totals_[ns];
+  totals.keys += keys;
+  if (entry.expire_secs > 0) {
+    totals.expires += sign;
+    totals.expire_sum_secs += sign * static_cast<int64_t>(entry.expire_secs);
+  }
+
+  if (!slot_id_encoded) return;
+  auto &slots = memtable_slot_totals_[ns];
+  slots.resize(HASH_SLOTS_SIZE, 0);
+  slots[ExtractSlotId(key)] += keys;
+}
+
+void KeyNumEstimator::putMemtableKeyLocked(std::string key, const MemtableKey &entry) {
+  // the write may be counted after the flush of it or a newer range deletion of the key
+  if (entry.sequence <= flushed_sequence_) return;
+  for (const auto &deletion : pending_deletions_) {
+    if (deletion.sequence > entry.sequence && deletion.begin <= key && key < deletion.end) return;
+  }
+
+  // only the latest version is counted, like a flush keeps only the latest one
+  auto iter = memtable_keys_.find(key);
+  if (iter == memtable_keys_.end()) {
+    iter = memtable_keys_.emplace(std::move(key), entry).first;
+  } else if (iter->second.sequence < entry.sequence) {
+    countMemtableKeyLocked(iter->first, iter->second, -1);
+    iter->second = entry;
+  } else {
+    return;
+  }
+  countMemtableKeyLocked(iter->first, entry, 1);
+}
+
+void KeyNumEstimator::deleteMemtableRangeLocked(const RangeDeletion &deletion) {
+  auto iter = memtable_keys_.lower_bound(deletion.begin);
+  while (iter != memtable_keys_.end() && iter->first < deletion.end) {
+    if (iter->second.sequence > deletion.sequence) {
+      ++iter;
+      continue;
+    }
+    countMemtableKeyLocked(iter->first, iter->second, -1);
+    iter = memtable_keys_.erase(iter);
+  }
+}
@@ -0,0 +1,119 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <rocksdb/db.h>
+#include <rocksdb/write_batch.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "redis_metadata.h"
+#include "table_properties_collector.h"
+
+namespace engine {
+class Storage;
+}  // namespace engine
+
+// KeyNumEstimator counts the keys of a namespace or a slot without scanning the metadata column family.
+//
+// Every metadata SST records the number of keys and deletion markers of each namespace and slot in it
+// as a table property, so the keys in the SSTs add up to the keys minus the deletion markers of all
+// files, leaving out the counts hidden by a newer range deletion, e.g. of FLUSHDB. The sums are kept
+// until the SSTs change. The metadata keys written since the last flush are counted the same way as
+// the batches are written, keeping the latest version of each key until it's flushed, so neither is
+// scanned on a query. The expired keys are counted until the active expiration or a compaction drops them.
+//
+// The estimate is an upper bound rather than an exact count: a key with versions in several files, or in
+// the memtables and a file, i.e. overwritten after being flushed, is counted once for each of them until
+// they're compacted together. The only exception is a key written and deleted again before a flush,
+// whose deletion marker is subtracted like that of a flushed key until a compaction drops it.
+// An SST written before the property was introduced can't be counted, so no estimate is available
+// until all of them are compacted.
+class KeyNumEstimator {
+ public:
+  explicit KeyNumEstimator(engine::Storage *storage) : storage_(storage) {}
+
+  KeyNumEstimator(const KeyNumEstimator &) = delete;
+  KeyNumEstimator &operator=(const KeyNumEstimator &) = delete;
+
+  // Forgets the files and the range deletions, e.g. once the DB is reopened
+  void Reset();
+
+  // Counts the metadata keys and remembers the range deletions of a written batch, which can't be found
+  // in the table properties until they're flushed. The sequence number must be the one assigned to the
+  // batch by the write, since other batches may be written at the same time.
+  void OnBatchWritten(rocksdb::WriteBatch *batch, rocksdb::SequenceNumber sequence);
+  void OnFlushCompleted(rocksdb::SequenceNumber largest_sequence);
+
+  // Counts the keys of all namespaces for the default namespace, like the DBSIZE SCAN does
+  rocksdb::Status GetKeyNumStats(const std::string &ns, KeyNumStats *stats);
+  rocksdb::Status CountKeysInSlot(const std::string &ns, uint16_t slot, uint64_t *count);
+
+ private:
+  struct Totals {
+    int64_t keys = 0;
+    int64_t expires = 0;
+    int64_t expire_sum_secs = 0;
+  };
+
+  // The latest version of a metadata key written since the last flush
+  struct MemtableKey {
+    rocksdb::SequenceNumber sequence = 0;
+    bool is_delete = false;
+    uint64_t expire_secs = 0;
+  };
+
+  using RangeDeletion = KeyNumProperty::RangeDeletion;
+
+  rocksdb::Status refreshLocked();
+  // The largest sequence numbers of the metadata SSTs by their paths
+  std::map<std::string, rocksdb::SequenceNumber> getFileSequences();
+  // Whether [begin, end) is covered by the range deletions newer than the sequence number
+  static bool isCovered(const std::vector<const RangeDeletion *> &deletions, const std::string &begin,
+                        const std::string &end, rocksdb::SequenceNumber sequence);
+  // Adds (sign = 1) or removes (sign = -1) the counts of a memtable key, like a file counts its keys
+  void countMemtableKeyLocked(const std::string &key, const MemtableKey &entry, int64_t sign);
+  void putMemtableKeyLocked(std::string key, const MemtableKey &entry);
+  void deleteMemtableRangeLocked(const RangeDeletion &deletion);
+
+  engine::Storage *storage_ = nullptr;
+
+  std::mutex mu_;
+  uint64_t super_version_ = 0;
+  bool dirty_ = true;
+  bool complete_ = false;
+  std::map<std::string, KeyNumProperty> files_;
+  std::map<std::string, Totals> ns_totals_;
+  // the key numbers of the slots of a namespace, only if the slot id is encoded
+  std::map<std::string, std::vector<int64_t>> slot_totals_;
+
+  // the writes since the last flush, which don't wait for refreshing the sums of the files
+  std::mutex memtable_mu_;
+  rocksdb::SequenceNumber flushed_sequence_ = 0;
+  std::vector<RangeDeletion> pending_deletions_;
+  std::map<std::string, MemtableKey> memtable_keys_;
+  std::map<std::string, Totals> memtable_ns_totals_;
+  std::map<std::string, std::vector<int64_t>> memtable_slot_totals_;
+};
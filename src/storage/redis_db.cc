@@ -646,8 +646,12 @@ rocksdb::Status Database::typeInternal(engine::Context &ctx, const Slice &key, R
 
 rocksdb::Status Database::Copy(engine::Context &ctx, const std::string &key, const std::string &new_key, bool nx,
                                bool delete_old, CopyResult *res) {
-  std::vector<std::string> lock_keys = {key, new_key};
-  MultiLockGuard guard(storage_->GetLockManager(), lock_keys);
+  // the source key is only read unless it's moved, so the other readers of it can go on
+  auto lock_mgr = storage_->GetLockManager();
+  LockIndexes lock_indexes;
+  lock_indexes.Insert(lock_mgr->Index(key), delete_old ? LockMode::kExclusive : LockMode::kShared);
+  lock_indexes.Insert(lock_mgr->Index(new_key), LockMode::kExclusive);
+  MultiLockGuard guard(lock_mgr, std::move(lock_indexes));
 
   RedisType type = kRedisNone;
   auto s = typeInternal(ctx, key, &type);
@@ -686,8 +690,10 @@ rocksdb::Status Database::Copy(engine::Context &ctx, const std::string &key, con
       return s;
     }
   }
-  // copy metadata
-  s = batch->Put(metadata_cf_handle_, new_key, iter.Value());
+  // copy metadata, the rank index of a sorted set isn't copied, so the copy is built without it
+  std::string metadata_bytes = iter.Value().ToString();
+  if (type == kRedisZSet) ZSet::ClearRankIndexFlag(&metadata_bytes);
+  s = batch->Put(metadata_cf_handle_, new_key, metadata_bytes);
   if (!s.ok()) {
     return s;
   }
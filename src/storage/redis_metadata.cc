@@ -251,6 +251,16 @@ uint64_t Metadata::ExpireMsToS(uint64_t ms) {
 
 bool Metadata::Is64BitEncoded() const { return flags & METADATA_64BIT_ENCODING_MASK; }
 
+bool Metadata::IsAltEncoded() const { return flags & METADATA_ALT_ENCODING_MASK; }
+
+void Metadata::SetAltEncoded(bool alt_encoded) {
+  if (alt_encoded) {
+    flags |= METADATA_ALT_ENCODING_MASK;
+  } else {
+    flags &= ~METADATA_ALT_ENCODING_MASK;
+  }
+}
+
 size_t Metadata::CommonEncodedSize() const { return Is64BitEncoded() ? 8 : 4; }
 
 bool Metadata::GetFixedCommon(rocksdb::Slice *input, uint64_t *value) const {
@@ -326,21 +336,57 @@ bool Metadata::ExpireAt(uint64_t expired_ts) const {
   return expire < expired_ts;
 }
 
-bool Metadata::IsSingleKVType() const { return Type() == kRedisString || Type() == kRedisJson; }
+bool Metadata::IsSingleKVType() const {
+  // a shredded JSON document keeps its nodes in subkeys, so it has a version like the composite types
+  return Type() == kRedisString || (Type() == kRedisJson && !IsAltEncoded());
+}
 
 bool Metadata::IsEmptyableType() const {
-  return IsSingleKVType() || Type() == kRedisStream || Type() == kRedisBloomFilter || Type() == kRedisHyperLogLog;
+  return IsSingleKVType() || Type() == kRedisJson || Type() == kRedisStream || Type() == kRedisBloomFilter ||
+         Type() == kRedisHyperLogLog;
 }
 
 bool Metadata::Expired() const { return ExpireAt(util::GetTimeStampMS()); }
 
+void BitmapMetadata::Encode(std::string *dst) const {
+  Metadata::Encode(dst);
+  if (Type() == kRedisBitmap && IsAltEncoded()) {
+    dst->push_back(static_cast<char>(encoding));
+  }
+}
+
+rocksdb::Status BitmapMetadata::Decode(Slice *input) {
+  if (auto s = Metadata::Decode(input); !s.ok()) {
+    return s;
+  }
+
+  encoding = BitmapEncoding::kSegments;
+  // the bitmap strings are decoded by BitmapMetadata as well
+  if (Type() == kRedisBitmap && IsAltEncoded()) {
+    if (input->size() < 1) {
+      return rocksdb::Status::InvalidArgument(kErrMetadataTooShort);
+    }
+    encoding = static_cast<BitmapEncoding>((*input)[0]);
+    input->remove_prefix(1);
+  }
+
+  return rocksdb::Status::OK();
+}
+
 ListMetadata::ListMetadata(bool generate_version)
-    : Metadata(kRedisList, generate_version), head(UINT64_MAX / 2), tail(head) {}
+    : Metadata(kRedisList, generate_version), head(UINT64_MAX / 2), tail(head), chunk_groups{{0, 0}} {}
 
 void ListMetadata::Encode(std::string *dst) const {
   Metadata::Encode(dst);
   PutFixed64(dst, head);
   PutFixed64(dst, tail);
+  if (chunk_groups.size() > 1) {
+    PutFixed32(dst, static_cast<uint32_t>(chunk_groups.size()));
+    for (const auto &group : chunk_groups) {
+      PutFixed64(dst, group.first_id);
+      PutFixed64(dst, group.size);
+    }
+  }
 }
 
 rocksdb::Status ListMetadata::Decode(Slice *input) {
@@ -354,6 +400,20 @@ rocksdb::Status ListMetadata::Decode(Slice *input) {
   GetFixed64(input, &head);
   GetFixed64(input, &tail);
 
+  chunk_groups.clear();
+  uint32_t group_count = 0;
+  if (GetFixed32(input, &group_count)) {
+    if (input->size() < static_cast<size_t>(group_count) * (8 + 8)) {
+      return rocksdb::Status::InvalidArgument(kErrMetadataTooShort);
+    }
+    chunk_groups.resize(group_count);
+    for (auto &group : chunk_groups) {
+      GetFixed64(input, &group.first_id);
+      GetFixed64(input, &group.size);
+    }
+  }
+  if (chunk_groups.empty()) chunk_groups.push_back({0, size});
+
   return rocksdb::Status::OK();
 }
 
@@ -89,6 +89,8 @@ enum RedisCommand {
   kRedisCmdBitOp,
   kRedisCmdBitfield,
   kRedisCmdLMove,
+  // a whole chunk of a chunked list is put, e.g. by the raw key value migration
+  kRedisCmdRPushChunk,
 };
 
 const std::vector<std::string> RedisTypeNames = {"none",   "string",    "hash",      "list",
@@ -136,14 +138,17 @@ class InternalKey {
 };
 
 constexpr uint8_t METADATA_64BIT_ENCODING_MASK = 0x80;
+constexpr uint8_t METADATA_ALT_ENCODING_MASK = 0x40;
 constexpr uint8_t METADATA_TYPE_MASK = 0x0f;
 
 class Metadata {
  public:
   // metadata flags
-  // <(1-bit) 64bit-common-field-indicator> 0 0 0 <(4-bit) redis-type>
+  // <(1-bit) 64bit-common-field-indicator> <(1-bit) alt-encoding-indicator> 0 0 <(4-bit) redis-type>
   // 64bit-common-field-indicator: make `expire` and `size` 64bit instead of 32bit
   // NOTE: `expire` is stored in milliseconds for 64bit, seconds for 32bit
+  // alt-encoding-indicator: the subkeys use the alternative encoding of the type, e.g. chunked list,
+  //                         or a sorted set which keeps a rank index
   // redis-type: RedisType for the key-value
   uint8_t flags;
 
@@ -166,6 +171,8 @@ class Metadata {
   static uint64_t ExpireMsToS(uint64_t ms);
 
   bool Is64BitEncoded() const;
+  bool IsAltEncoded() const;
+  void SetAltEncoded(bool alt_encoded);
   bool GetFixedCommon(rocksdb::Slice *input, uint64_t *value) const;
   bool GetExpire(rocksdb::Slice *input);
   void PutFixedCommon(std::string *dst, uint64_t value) const;
@@ -182,7 +189,7 @@ class Metadata {
   // no other key-values.
   // this means that the metadata of these types do NOT have
   // `version` and `size` field.
-  // e.g. RedisString, RedisJson
+  // e.g. RedisString, RedisJson (except for the shredded JSON documents)
   bool IsSingleKVType() const;
 
   // return whether the `size` field of this type can be zero.
@@ -215,11 +222,41 @@ class SetMetadata : public Metadata {
 class ZSetMetadata : public Metadata {
  public:
   explicit ZSetMetadata(bool generate_version = true) : Metadata(kRedisZSet, generate_version) {}
+
+  // whether the rank index is maintained beside the score entries, see redis::ZSet
+  bool HasRankIndex() const { return IsAltEncoded(); }
+  void SetRankIndex(bool has_rank_index) { SetAltEncoded(has_rank_index); }
+};
+
+enum class BitmapEncoding : uint8_t {
+  // the segments are keyed by their decimal byte offsets
+  kSegments = 0,
+  // the segments are keyed by their fixed-width byte offsets, so they're in order,
+  // and the popcounts of the segments are summarized beside them
+  kSummarizedSegments = 1,
+  // the segments are keyed by their fixed-width byte offsets, and each of them is stored
+  // in an array, run or bitset container, whichever is the smallest
+  kCompressedSegments = 2,
 };
 
 class BitmapMetadata : public Metadata {
  public:
+  // only stored for the alt-encoded bitmaps
+  BitmapEncoding encoding = BitmapEncoding::kSegments;
+
   explicit BitmapMetadata(bool generate_version = true) : Metadata(kRedisBitmap, generate_version) {}
+
+  bool IsSummarized() const { return encoding == BitmapEncoding::kSummarizedSegments; }
+  bool IsCompressed() const { return encoding == BitmapEncoding::kCompressedSegments; }
+  bool HasFixedWidthSubKeys() const { return encoding != BitmapEncoding::kSegments; }
+  void SetEncoding(BitmapEncoding enc) {
+    encoding = enc;
+    SetAltEncoded(enc != BitmapEncoding::kSegments);
+  }
+
+  void Encode(std::string *dst) const override;
+  using Metadata::Decode;
+  rocksdb::Status Decode(Slice *input) override;
 };
 
 class SortedintMetadata : public Metadata {
@@ -227,12 +264,28 @@ class SortedintMetadata : public Metadata {
   explicit SortedintMetadata(bool generate_version = true) : Metadata(kRedisSortedint, generate_version) {}
 };
 
+// A run of adjacent chunks of a chunked list, holding the chunks from `first_id` up to the first id of the next group
+struct ListChunkGroup {
+  uint64_t first_id = 0;
+  // the number of elements of the chunks in the group
+  uint64_t size = 0;
+};
+
 class ListMetadata : public Metadata {
  public:
+  // for the chunked encoding, all the chunk ids are in [head, tail)
   uint64_t head;
   uint64_t tail;
+  // for the chunked encoding, the groups of chunks in the order of the list, the first one starts from id 0,
+  // so an element can be found by its index without reading the chunks ahead of it
+  // NOTE: a single group is not encoded since its size is the size of the list
+  std::vector<ListChunkGroup> chunk_groups;
   explicit ListMetadata(bool generate_version = true);
 
+  // whether the elements are packed into chunks instead of one subkey per element
+  bool IsChunked() const { return IsAltEncoded(); }
+  void SetChunked(bool chunked) { SetAltEncoded(chunked); }
+
   void Encode(std::string *dst) const override;
   using Metadata::Decode;
   rocksdb::Status Decode(Slice *input) override;
@@ -302,6 +355,8 @@ class BloomChainMetadata : public Metadata {
 enum class JsonStorageFormat : uint8_t {
   JSON = 0,
   CBOR = 1,
+  // the document is split into one subkey per node, see redis::Json for the layout
+  SHREDDED = 2,
 };
 
 class JsonMetadata : public Metadata {
@@ -312,6 +367,9 @@ class JsonMetadata : public Metadata {
 
   explicit JsonMetadata(bool generate_version = true) : Metadata(kRedisJson, generate_version) {}
 
+  bool IsShredded() const { return IsAltEncoded(); }
+  void SetShredded(bool shredded) { SetAltEncoded(shredded); }
+
   void Encode(std::string *dst) const override;
   rocksdb::Status Decode(Slice *input) override;
 };
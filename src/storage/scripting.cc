@@ -27,14 +27,17 @@
 
 #include <algorithm>
 #include <cctype>
+#include <charconv>
+#include <cmath>
+#include <optional>
 #include <string>
 
 #include "commands/commander.h"
 #include "commands/error_constants.h"
 #include "db_util.h"
 #include "fmt/format.h"
+#include "lock_manager.h"
 #include "lua.h"
-#include "parse_util.h"
 #include "rand.h"
 #include "scope_exit.h"
 #include "server/redis_connection.h"
@@ -75,6 +78,49 @@ void DestroyState(lua_State *lua) {
   lua_close(lua);
 }
 
+bool RunsWithKeyLocks(Server *srv, const std::vector<std::string> &keys, bool read_only) {
+  return !read_only && !keys.empty() && srv->GetConfig()->lua_key_locking_enabled;
+}
+
+// ScriptKeyLocks holds the locks of the keys declared by a script while it runs, and groups the writes
+// of the script into one write batch, so the other workers see either none or all of them.
+class ScriptKeyLocks {
+ public:
+  ScriptKeyLocks(Server *srv, const redis::Connection *conn, const std::vector<std::string> &keys)
+      : storage_(srv->storage) {
+    std::vector<std::string> ns_keys;
+    ns_keys.reserve(keys.size());
+    for (const auto &key : keys) {
+      ns_keys.emplace_back(ComposeNamespaceKey(conn->GetNamespace(), key, storage_->IsSlotIdEncoded()));
+    }
+    guard_.emplace(storage_->GetLockManager(), ns_keys);
+
+    // the script run by EXEC writes into the transaction of EXEC
+    if (!storage_->IsTxnMode()) {
+      in_txn_ = storage_->BeginTxn().IsOK();
+    }
+  }
+  ~ScriptKeyLocks() {
+    if (auto s = Commit(); !s.IsOK()) {
+      LOG(ERROR) << "[script] Failed to write the changes of the script: " << s.Msg();
+    }
+  }
+
+  ScriptKeyLocks(const ScriptKeyLocks &) = delete;
+  ScriptKeyLocks &operator=(const ScriptKeyLocks &) = delete;
+
+  Status Commit() {
+    if (!in_txn_) return Status::OK();
+    in_txn_ = false;
+    return storage_->CommitTxn();
+  }
+
+ private:
+  engine::Storage *storage_;
+  std::optional<HeldLockGuard> guard_;
+  bool in_txn_ = false;
+};
+
 void LoadFuncs(lua_State *lua) {
   lua_newtable(lua);
 
@@ -335,7 +381,14 @@ Status FunctionLoad(redis::Connection *conn, const std::string &script, bool nee
     return {Status::NotOK, "Please register some function in FUNCTION LOAD"};
   }
 
-  return need_to_store ? srv->FunctionSetCode(libname, script) : Status::OK();
+  if (!need_to_store) return Status::OK();
+
+  auto s = srv->FunctionSetCode(libname, script);
+  if (!s) return s;
+
+  // the workers load the new library from the storage on demand
+  srv->IncrLuaVersion();
+  return Status::OK();
 }
 
 bool FunctionIsLibExist(redis::Connection *conn, const std::string &libname, bool need_check_storage, bool read_only) {
@@ -374,7 +427,13 @@ bool FunctionIsLibExist(redis::Connection *conn, const std::string &libname, boo
 Status FunctionCall(redis::Connection *conn, const std::string &name, const std::vector<std::string> &keys,
                     const std::vector<std::string> &argv, std::string *output, bool read_only) {
   auto srv = conn->GetServer();
-  auto lua = read_only ? conn->Owner()->Lua() : srv->Lua();
+  // the functions running with the key locks may run on several workers at the same time,
+  // so they use the worker's private Lua VM as the read-only ones
+  bool lock_keys = RunsWithKeyLocks(srv, keys, read_only);
+  if (read_only || lock_keys) conn->Owner()->RecreateLuaIfStale();
+  auto lua = read_only || lock_keys ? conn->Owner()->Lua() : srv->Lua();
+  std::optional<ScriptKeyLocks> key_locks;
+  if (lock_keys) key_locks.emplace(srv, conn, keys);
 
   lua_getglobal(lua, "__redis__err__handler");
 
@@ -389,7 +448,7 @@ Status FunctionCall(redis::Connection *conn, const std::string &name, const std:
     std::string libcode;
     s = srv->FunctionGetCode(libname, &libcode);
     if (!s) return s;
-    s = FunctionLoad(conn, libcode, false, false, &libname, read_only);
+    s = FunctionLoad(conn, libcode, false, false, &libname, read_only || lock_keys);
     if (!s) return s;
 
     lua_getglobal(lua, (REDIS_LUA_REGISTER_FUNC_PREFIX + name).c_str());
@@ -397,6 +456,8 @@ Status FunctionCall(redis::Connection *conn, const std::string &name, const std:
 
   ScriptRunCtx script_run_ctx;
   script_run_ctx.flags = read_only ? ScriptFlagType::kScriptNoWrites : 0;
+  script_run_ctx.conn = conn;
+  script_run_ctx.locked_keys = lock_keys ? &keys : nullptr;
   lua_getglobal(lua, (REDIS_LUA_REGISTER_FUNC_FLAGS_PREFIX + name).c_str());
   if (!lua_isnil(lua, -1)) {
     // It should be ensured that the conversion is successful
@@ -419,6 +480,10 @@ Status FunctionCall(redis::Connection *conn, const std::string &name, const std:
   }
 
   RemoveFromRegistry(lua, REGISTRY_SCRIPT_RUN_CTX_NAME);
+  if (key_locks) {
+    auto s = key_locks->Commit();
+    if (!s) return s;
+  }
 
   /* Call the Lua garbage collector from time to time to avoid a
    * full cycle performed by Lua, which adds too latency.
@@ -427,7 +492,7 @@ Status FunctionCall(redis::Connection *conn, const std::string &name, const std:
    * (and for LUA_GC_CYCLE_PERIOD collection steps) because calling it
    * for every command uses too much CPU. */
   constexpr int64_t LUA_GC_CYCLE_PERIOD = 50;
-  static int64_t gc_count = 0;
+  static thread_local int64_t gc_count = 0;
 
   gc_count++;
   if (gc_count == LUA_GC_CYCLE_PERIOD) {
@@ -591,14 +656,20 @@ Status FunctionDelete(engine::Context &ctx, Server *srv, const std::string &name
   auto s = storage->Delete(ctx, rocksdb::WriteOptions(), cf, engine::kLuaLibCodePrefix + name);
   if (!s.ok()) return {Status::NotOK, s.ToString()};
 
+  srv->IncrLuaVersion();
   return Status::OK();
 }
 
 Status EvalGenericCommand(redis::Connection *conn, const std::string &body_or_sha, const std::vector<std::string> &keys,
                           const std::vector<std::string> &argv, bool evalsha, std::string *output, bool read_only) {
   Server *srv = conn->GetServer();
-  // Use the worker's private Lua VM when entering the read-only mode
-  lua_State *lua = read_only ? conn->Owner()->Lua() : srv->Lua();
+  // Use the worker's private Lua VM when entering the read-only mode, or running with the key locks
+  // since the scripts may run on several workers at the same time then
+  bool lock_keys = RunsWithKeyLocks(srv, keys, read_only);
+  if (read_only || lock_keys) conn->Owner()->RecreateLuaIfStale();
+  lua_State *lua = read_only || lock_keys ? conn->Owner()->Lua() : srv->Lua();
+  std::optional<ScriptKeyLocks> key_locks;
+  if (lock_keys) key_locks.emplace(srv, conn, keys);
 
   /* We obtain the script SHA1, then check if this function is already
    * defined into the Lua state */
@@ -643,6 +714,8 @@ Status EvalGenericCommand(redis::Connection *conn, const std::string &body_or_sh
 
   ScriptRunCtx current_script_run_ctx;
   current_script_run_ctx.flags = read_only ? ScriptFlagType::kScriptNoWrites : 0;
+  current_script_run_ctx.conn = conn;
+  current_script_run_ctx.locked_keys = lock_keys ? &keys : nullptr;
   lua_getglobal(lua, fmt::format(REDIS_LUA_FUNC_SHA_FLAGS, funcname + 2).c_str());
   if (!lua_isnil(lua, -1)) {
     // It should be ensured that the conversion is successful
@@ -688,7 +761,7 @@ Status EvalGenericCommand(redis::Connection *conn, const std::string &body_or_sh
    * (and for LUA_GC_CYCLE_PERIOD collection steps) because calling it
    * for every command uses too much CPU. */
   constexpr int64_t LUA_GC_CYCLE_PERIOD = 50;
-  static int64_t gc_count = 0;
+  static thread_local int64_t gc_count = 0;
 
   gc_count++;
   if (gc_count == LUA_GC_CYCLE_PERIOD) {
@@ -696,6 +769,7 @@ Status EvalGenericCommand(redis::Connection *conn, const std::string &body_or_sh
     gc_count = 0;
   }
 
+  if (key_locks) return key_locks->Commit();
   return Status::OK();
 }
 
@@ -717,6 +791,66 @@ Server *GetServer(lua_State *lua) {
   return srv;
 }
 
+// The script running with the key locks can only access the keys it declared, since the other keys aren't locked
+// for it, and the write commands without keys like FLUSHDB could change the keys locked by the others.
+static Status CheckKeysLockedByScript(const std::vector<std::string> &locked_keys,
+                                      const redis::CommandAttributes *attributes, const std::vector<std::string> &args,
+                                      uint64_t cmd_flags) {
+  bool has_keys = false;
+  bool all_locked = true;
+  attributes->ForEachKeyRange(
+      [&](const std::vector<std::string> &cmd_args, const redis::CommandKeyRange &key_range) {
+        key_range.ForEachKey(
+            [&](const std::string &key) {
+              has_keys = true;
+              if (std::find(locked_keys.begin(), locked_keys.end(), key) == locked_keys.end()) all_locked = false;
+            },
+            cmd_args);
+      },
+      args);
+
+  if (!all_locked || (cmd_flags & redis::kCmdUnlistedKeys)) {
+    return {Status::NotOK, "Script attempted to access a key not declared in KEYS while running with the key locks"};
+  }
+  if (!has_keys && (cmd_flags & redis::kCmdWrite)) {
+    return {Status::NotOK, "Script attempted to run a write command without keys while running with the key locks"};
+  }
+  return Status::OK();
+}
+
+// Format the number argument of redis.call() like "%.17g", the integers are formatted without
+// going through the floating-point formatting since they're the most common numbers in the scripts
+static void FormatLuaNumber(lua_Number num, std::string *arg) {
+  auto d = static_cast<double>(num);
+  if (std::trunc(d) == d && std::abs(d) < 1e17 && !(d == 0 && std::signbit(d))) {
+    fmt::format_int formatted(static_cast<int64_t>(d));
+    arg->assign(formatted.data(), formatted.size());
+  } else {
+    arg->clear();
+    fmt::format_to(std::back_inserter(*arg), "{:.17g}", d);
+  }
+}
+
+// Push the reply of redis.call() onto the Lua stack as the values converted from the RESP reply would be
+class LuaReplyBuilder : public redis::ReplyBuilder {
+ public:
+  LuaReplyBuilder(lua_State *lua, redis::RESP ver) : lua_(lua), ver_(ver) {}
+
+  void NilString() override {
+    if (ver_ == redis::RESP::v3) {
+      lua_pushnil(lua_);
+    } else {
+      lua_pushboolean(lua_, 0);
+    }
+  }
+  void BulkString(std::string_view data) override { lua_pushlstring(lua_, data.data(), data.size()); }
+  void RESPReply(const std::string &output) override { RedisProtocolToLuaType(lua_, output.data()); }
+
+ private:
+  lua_State *lua_;
+  redis::RESP ver_;
+};
+
 // TODO: we do not want to repeat same logic as Connection::ExecuteCommands,
 // so the function need to be refactored
 int RedisGenericCommand(lua_State *lua, int raise_error) {
@@ -729,11 +863,12 @@ int RedisGenericCommand(lua_State *lua, int raise_error) {
     return raise_error ? RaiseError(lua) : 1;
   }
 
-  std::vector<std::string> args;
+  // the argument buffers are reused by the calls of the script to save the allocations
+  auto &args = script_run_ctx->call_args;
+  args.resize(argc);
   for (int j = 1; j <= argc; j++) {
     if (lua_type(lua, j) == LUA_TNUMBER) {
-      lua_Number num = lua_tonumber(lua, j);
-      args.emplace_back(fmt::format("{:.17g}", static_cast<double>(num)));
+      FormatLuaNumber(lua_tonumber(lua, j), &args[j - 1]);
     } else {
       size_t obj_len = 0;
       const char *obj_s = lua_tolstring(lua, j, &obj_len);
@@ -741,7 +876,7 @@ int RedisGenericCommand(lua_State *lua, int raise_error) {
         PushError(lua, "Lua redis.call() command arguments must be strings or integers");
         return raise_error ? RaiseError(lua) : 1;
       }
-      args.emplace_back(obj_s, obj_len);
+      args[j - 1].assign(obj_s, obj_len);
     }
   }
 
@@ -770,12 +905,20 @@ int RedisGenericCommand(lua_State *lua, int raise_error) {
     return raise_error ? RaiseError(lua) : 1;
   }
 
+  if (script_run_ctx->locked_keys) {
+    auto s = CheckKeysLockedByScript(*script_run_ctx->locked_keys, attributes, args, cmd_flags);
+    if (!s) {
+      PushError(lua, s.Msg().data());
+      return raise_error ? RaiseError(lua) : 1;
+    }
+  }
+
   std::string cmd_name = attributes->name;
 
   auto srv = GetServer(lua);
   Config *config = srv->GetConfig();
 
-  redis::Connection *conn = srv->GetCurrentConnection();
+  redis::Connection *conn = script_run_ctx->conn;
   if (config->cluster_enabled) {
     if (script_run_ctx->flags & ScriptFlagType::kScriptNoCluster) {
       PushError(lua, "Can not run script on cluster, 'no-cluster' flag is set");
@@ -812,14 +955,14 @@ int RedisGenericCommand(lua_State *lua, int raise_error) {
     return raise_error ? RaiseError(lua) : 1;
   }
 
-  std::string output;
-  s = conn->ExecuteCommand(cmd_name, args, cmd.get(), &output);
+  // the reply is pushed by the builder only if the command succeeded
+  LuaReplyBuilder builder(lua, conn->GetProtocolVersion());
+  s = conn->ExecuteCommand(cmd_name, args, cmd.get(), &builder);
   if (!s) {
     PushError(lua, s.Msg().data());
     return raise_error ? RaiseError(lua) : 1;
   }
 
-  RedisProtocolToLuaType(lua, output.data());
   return 1;
 }
 
@@ -896,7 +1039,9 @@ int RedisReturnSingleFieldTable(lua_State *lua, const char *field) {
 
 int RedisSetResp(lua_State *lua) {
   auto srv = GetServer(lua);
-  auto conn = srv->GetCurrentConnection();
+  auto *script_run_ctx = GetFromRegistry<ScriptRunCtx>(lua, REGISTRY_SCRIPT_RUN_CTX_NAME);
+  CHECK_NOTNULL(script_run_ctx);
+  auto conn = script_run_ctx->conn;
 
   if (lua_gettop(lua) != 1) {
     PushError(lua, "redis.setresp() requires one argument.");
@@ -1033,16 +1178,24 @@ const char *RedisProtocolToLuaType(lua_State *lua, const char *reply) {
   return p;
 }
 
-const char *RedisProtocolToLuaTypeInt(lua_State *lua, const char *reply) {
+// Parse the length or the integer following the type byte of the reply, which is always valid since
+// the reply is generated by the commands. It's parsed in place since it's done for every element.
+static const char *ParseReplyInt(const char *reply, int64_t *value) {
   const char *p = strchr(reply + 1, '\r');
-  auto value = ParseInt<int64_t>(std::string(reply + 1, p - reply - 1), 10).ValueOr(0);
+  if (std::from_chars(reply + 1, p, *value).ec != std::errc()) *value = 0;
+  return p;
+}
+
+const char *RedisProtocolToLuaTypeInt(lua_State *lua, const char *reply) {
+  int64_t value = 0;
+  const char *p = ParseReplyInt(reply, &value);
   lua_pushnumber(lua, static_cast<lua_Number>(value));
   return p + 2;
 }
 
 const char *RedisProtocolToLuaTypeBulk(lua_State *lua, const char *reply) {
-  const char *p = strchr(reply + 1, '\r');
-  auto bulklen = ParseInt<int64_t>(std::string(reply + 1, p - reply - 1), 10).ValueOr(0);
+  int64_t bulklen = 0;
+  const char *p = ParseReplyInt(reply, &bulklen);
 
   if (bulklen == -1) {
     lua_pushboolean(lua, 0);
@@ -1074,8 +1227,8 @@ const char *RedisProtocolToLuaTypeError(lua_State *lua, const char *reply) {
 }
 
 const char *RedisProtocolToLuaTypeAggregate(lua_State *lua, const char *reply, int atype) {
-  const char *p = strchr(reply + 1, '\r');
-  int64_t mbulklen = ParseInt<int64_t>(std::string(reply + 1, p - reply - 1), 10).ValueOr(0);
+  int64_t mbulklen = 0;
+  const char *p = ParseReplyInt(reply, &mbulklen);
   int j = 0;
 
   p += 2;
@@ -1084,11 +1237,10 @@ const char *RedisProtocolToLuaTypeAggregate(lua_State *lua, const char *reply, i
     return p;
   }
   if (atype == '*') {
-    lua_newtable(lua);
+    lua_createtable(lua, static_cast<int>(mbulklen), 0);
     for (j = 0; j < mbulklen; j++) {
-      lua_pushnumber(lua, j + 1);
       p = RedisProtocolToLuaType(lua, p);
-      lua_settable(lua, -3);
+      lua_rawseti(lua, -2, j + 1);
     }
     return p;
   }
@@ -1097,7 +1249,7 @@ const char *RedisProtocolToLuaTypeAggregate(lua_State *lua, const char *reply, i
   if (atype == '%' || atype == '~') {
     lua_newtable(lua);
     lua_pushstring(lua, atype == '%' ? "map" : "set");
-    lua_newtable(lua);
+    lua_createtable(lua, 0, static_cast<int>(mbulklen));
     for (j = 0; j < mbulklen; j++) {
       p = RedisProtocolToLuaType(lua, p);
       if (atype == '%') {  // map
@@ -1158,8 +1310,8 @@ const char *RedisProtocolToLuaTypeBigNumber(lua_State *lua, const char *reply) {
 }
 
 const char *RedisProtocolToLuaTypeVerbatimString(lua_State *lua, const char *reply) {
-  const char *p = strchr(reply + 1, '\r');
-  int64_t bulklen = ParseInt<int64_t>(std::string(reply + 1, p - reply - 1), 10).ValueOr(0);
+  int64_t bulklen = 0;
+  const char *p = ParseReplyInt(reply, &bulklen);
   p += 2;  // skip \r\n
 
   lua_newtable(lua);
@@ -64,6 +64,10 @@ int RedisSetResp(lua_State *lua);
 
 Status CreateFunction(Server *srv, const std::string &body, std::string *sha, lua_State *lua, bool need_to_store);
 
+/// RunsWithKeyLocks returns whether the script declaring the keys runs holding the locks of its keys
+/// instead of the exclusivity guard, see lua-key-locking-enabled
+bool RunsWithKeyLocks(Server *srv, const std::vector<std::string> &keys, bool read_only);
+
 Status EvalGenericCommand(redis::Connection *conn, const std::string &body_or_sha, const std::vector<std::string> &keys,
                           const std::vector<std::string> &argv, bool evalsha, std::string *output,
                           bool read_only = false);
@@ -150,6 +154,13 @@ struct ScriptRunCtx {
   // and is used to detect whether there is cross-slot access
   // between multiple commands in a script or function.
   int current_slot = -1;
+  // the connection running the script
+  redis::Connection *conn = nullptr;
+  // locked_keys are the keys declared by the script if it runs holding their locks instead of
+  // the exclusivity guard, see lua-key-locking-enabled, then only these keys are accessible
+  const std::vector<std::string> *locked_keys = nullptr;
+  // the arguments of the last redis.call(), kept to reuse their buffers in the next calls
+  std::vector<std::string> call_args;
 };
 
 /// SaveOnRegistry saves user-defined data to lua REGISTRY
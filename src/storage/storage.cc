@@ -38,8 +38,10 @@
 
 #include "compact_filter.h"
 #include "db_util.h"
+#include "encoding.h"
 #include "event_listener.h"
 #include "event_util.h"
+#include "parse_util.h"
 #include "redis_db.h"
 #include "redis_metadata.h"
 #include "rocksdb/cache.h"
@@ -53,6 +55,7 @@
 namespace engine {
 
 constexpr const char *kReplicationIdKey = "replication_id_";
+constexpr const char *kSSTIngestedSequenceKey = "sst_ingested_sequence_";
 
 // used in creating rocksdb::LRUCache, set `num_shard_bits` to -1 means let rocksdb choose a good default shard count
 // based on the capacity and the implementation.
@@ -80,8 +83,11 @@ Storage::Storage(Config *config)
       env_(rocksdb::Env::Default()),
       config_(config),
       lock_mgr_(16),
-      db_stats_(std::make_unique<DBStats>()) {
+      db_stats_(std::make_unique<DBStats>()),
+      key_num_estimator_(std::make_unique<KeyNumEstimator>(this)),
+      latency_monitor_(std::make_unique<LatencyMonitor>()) {
   Metadata::InitVersionCounter();
+  latency_monitor_->SetThreshold(config->latency_monitor_threshold);
   SetWriteOptions(config->rocks_db.write_options);
 }
 
@@ -310,6 +316,8 @@ Status Storage::Open(DBOpenMode mode) {
   metadata_opts.memtable_prefix_bloom_size_ratio = 0.1;
   metadata_opts.table_properties_collector_factories.emplace_back(
       NewCompactOnExpiredTableCollectorFactory(std::string(kMetadataColumnFamilyName), 0.3));
+  metadata_opts.table_properties_collector_factories.emplace_back(
+      std::make_shared<KeyNumTableCollectorFactory>(config_->slot_id_encoded));
   SetBlobDB(&metadata_opts);
 
   rocksdb::BlockBasedTableOptions subkey_table_opts = InitTableOptions();
@@ -360,6 +368,8 @@ Status Storage::Open(DBOpenMode mode) {
   auto s = rocksdb::DB::ListColumnFamilies(options, config_->db_dir, &old_column_families);
   if (!s.ok()) return {Status::NotOK, s.ToString()};
 
+  key_num_estimator_->Reset();
+  OnMetadataFilesChanged();
   auto start = std::chrono::high_resolution_clock::now();
   switch (mode) {
     case DBOpenMode::kDBOpenModeDefault: {
@@ -387,6 +397,14 @@ Status Storage::Open(DBOpenMode mode) {
   }
   LOG(INFO) << "[storage] Success to load the data from disk: " << duration << " ms";
 
+  std::string ingested_sequence;
+  s = db_->Get(rocksdb::ReadOptions(), GetCFHandle(ColumnFamilyID::Propagate), kSSTIngestedSequenceKey,
+               &ingested_sequence);
+  if (s.ok()) {
+    sst_ingested_sequence_ = ParseInt<uint64_t>(ingested_sequence, 10).ValueOr(0);
+  } else if (!s.IsNotFound()) {
+    return {Status::DBOpenErr, s.ToString()};
+  }
   return Status::OK();
 }
 
@@ -601,8 +619,8 @@ rocksdb::Status Storage::Get(engine::Context &ctx, const rocksdb::ReadOptions &o
     DCHECK_EQ(ctx.snapshot->GetSequenceNumber(), options.snapshot->GetSequenceNumber());
   }
   rocksdb::Status s;
-  if (is_txn_mode_ && txn_write_batch_->GetWriteBatch()->Count() > 0) {
-    s = txn_write_batch_->GetFromBatchAndDB(db_.get(), options, column_family, key, value);
+  if (auto txn_batch = txnWriteBatch(); txn_batch && txn_batch->GetWriteBatch()->Count() > 0) {
+    s = txn_batch->GetFromBatchAndDB(db_.get(), options, column_family, key, value);
   } else if (ctx.batch && ctx.is_txn_mode) {
     s = ctx.batch->GetFromBatchAndDB(db_.get(), options, column_family, key, value);
   } else {
@@ -626,8 +644,8 @@ rocksdb::Status Storage::Get(engine::Context &ctx, const rocksdb::ReadOptions &o
     DCHECK_EQ(ctx.snapshot->GetSequenceNumber(), options.snapshot->GetSequenceNumber());
   }
   rocksdb::Status s;
-  if (is_txn_mode_ && txn_write_batch_->GetWriteBatch()->Count() > 0) {
-    s = txn_write_batch_->GetFromBatchAndDB(db_.get(), options, column_family, key, value);
+  if (auto txn_batch = txnWriteBatch(); txn_batch && txn_batch->GetWriteBatch()->Count() > 0) {
+    s = txn_batch->GetFromBatchAndDB(db_.get(), options, column_family, key, value);
   } else if (ctx.is_txn_mode && ctx.batch) {
     s = ctx.batch->GetFromBatchAndDB(db_.get(), options, column_family, key, value);
   } else {
@@ -659,8 +677,8 @@ rocksdb::Iterator *Storage::NewIterator(engine::Context &ctx, const rocksdb::Rea
     DCHECK_EQ(ctx.snapshot->GetSequenceNumber(), options.snapshot->GetSequenceNumber());
   }
   auto iter = db_->NewIterator(options, column_family);
-  if (is_txn_mode_ && txn_write_batch_->GetWriteBatch()->Count() > 0) {
-    return txn_write_batch_->NewIteratorWithBase(column_family, iter, &options);
+  if (auto txn_batch = txnWriteBatch(); txn_batch && txn_batch->GetWriteBatch()->Count() > 0) {
+    return txn_batch->NewIteratorWithBase(column_family, iter, &options);
   } else if (ctx.is_txn_mode && ctx.batch && ctx.batch->GetWriteBatch()->Count() > 0) {
     return ctx.batch->NewIteratorWithBase(column_family, iter, &options);
   }
@@ -674,9 +692,8 @@ void Storage::MultiGet(engine::Context &ctx, const rocksdb::ReadOptions &options
     DCHECK_NOTNULL(options.snapshot);
     DCHECK_EQ(ctx.snapshot->GetSequenceNumber(), options.snapshot->GetSequenceNumber());
   }
-  if (is_txn_mode_ && txn_write_batch_->GetWriteBatch()->Count() > 0) {
-    txn_write_batch_->MultiGetFromBatchAndDB(db_.get(), options, column_family, num_keys, keys, values, statuses,
-                                             false);
+  if (auto txn_batch = txnWriteBatch(); txn_batch && txn_batch->GetWriteBatch()->Count() > 0) {
+    txn_batch->MultiGetFromBatchAndDB(db_.get(), options, column_family, num_keys, keys, values, statuses, false);
   } else if (ctx.is_txn_mode && ctx.batch) {
     ctx.batch->MultiGetFromBatchAndDB(db_.get(), options, column_family, num_keys, keys, values, statuses, false);
   } else {
@@ -690,13 +707,19 @@ void Storage::MultiGet(engine::Context &ctx, const rocksdb::ReadOptions &options
 
 rocksdb::Status Storage::Write(engine::Context &ctx, const rocksdb::WriteOptions &options,
                                rocksdb::WriteBatch *updates) {
-  if (is_txn_mode_) {
+  if (IsTxnMode()) {
     // The batch won't be flushed until the transaction was committed or rollback
     return rocksdb::Status::OK();
   }
   return writeToDB(ctx, options, updates);
 }
 
+// The write stores the sequence number assigned to the batch in the header of its representation,
+// which isn't known before it as other threads may write at the same time
+static rocksdb::SequenceNumber WrittenBatchSequence(const rocksdb::WriteBatch &batch) {
+  return DecodeFixed64(batch.Data().data());
+}
+
 rocksdb::Status Storage::writeToDB(engine::Context &ctx, const rocksdb::WriteOptions &options,
                                    rocksdb::WriteBatch *updates) {
   // Put replication id logdata at the end of write batch
@@ -713,7 +736,31 @@ rocksdb::Status Storage::writeToDB(engine::Context &ctx, const rocksdb::WriteOpt
     if (!s.ok()) return s;
   }
 
-  return db_->Write(options, updates);
+  auto s = db_->Write(options, updates);
+  if (!s.ok()) return s;
+
+  key_num_estimator_->OnBatchWritten(updates, WrittenBatchSequence(*updates));
+  notifyWALWaiters();
+  return s;
+}
+
+bool Storage::WaitForWALData(rocksdb::SequenceNumber seq, std::chrono::milliseconds timeout) {
+  wal_waiters_.fetch_add(1);
+  std::unique_lock<std::mutex> lock(wal_waiters_mu_);
+  bool has_data = wal_waiters_cv_.wait_for(lock, timeout, [this, seq] { return WALHasNewData(seq); });
+  lock.unlock();
+  wal_waiters_.fetch_sub(1);
+  return has_data;
+}
+
+void Storage::notifyWALWaiters() {
+  // pairs with the increment in WaitForWALData, so either the waiter sees the new sequence
+  // before sleeping, or the writer sees the waiter here
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (wal_waiters_.load(std::memory_order_relaxed) == 0) return;
+
+  std::lock_guard<std::mutex> lock(wal_waiters_mu_);
+  wal_waiters_cv_.notify_all();
 }
 
 rocksdb::Status Storage::Delete(engine::Context &ctx, const rocksdb::WriteOptions &options,
@@ -770,6 +817,8 @@ Status Storage::ApplyWriteBatch(const rocksdb::WriteOptions &options, std::strin
   if (!s.ok()) {
     return {Status::NotOK, s.ToString()};
   }
+  key_num_estimator_->OnBatchWritten(&batch, WrittenBatchSequence(batch));
+  notifyWALWaiters();
   return Status::OK();
 }
 
@@ -806,6 +855,32 @@ rocksdb::Status Storage::Compact(rocksdb::ColumnFamilyHandle *cf, const Slice *b
   return rocksdb::Status::OK();
 }
 
+rocksdb::Status Storage::IngestSSTFiles(const std::map<ColumnFamilyID, std::vector<std::string>> &files) {
+  std::vector<rocksdb::IngestExternalFileArg> args;
+  for (const auto &[cf_id, paths] : files) {
+    rocksdb::IngestExternalFileArg arg;
+    arg.column_family = GetCFHandle(cf_id);
+    arg.external_files = paths;
+    arg.options.move_files = true;
+    args.emplace_back(std::move(arg));
+  }
+  auto s = db_->IngestExternalFiles(args);
+  if (!s.ok()) return s;
+  if (files.count(ColumnFamilyID::Metadata) > 0) OnMetadataFilesChanged();
+
+  // The mark takes a sequence number after the latest one now, so only the replicas and the checkpoints
+  // which have it also have the ingested files. It's kept in the DB to refuse them after restarting as well.
+  auto sequence = db_->GetLatestSequenceNumber();
+  rocksdb::WriteBatch batch;
+  s = batch.Put(GetCFHandle(ColumnFamilyID::Propagate), kSSTIngestedSequenceKey, std::to_string(sequence));
+  if (!s.ok()) return s;
+  engine::Context ctx(this);
+  s = writeToDB(ctx, default_write_opts_, &batch);
+  if (!s.ok()) return s;
+  sst_ingested_sequence_ = sequence;
+  return rocksdb::Status::OK();
+}
+
 uint64_t Storage::GetTotalSize(const std::string &ns) {
   if (ns == kDefaultNamespace) {
     return sst_file_manager_->GetTotalSize();
@@ -861,36 +936,48 @@ void Storage::SetIORateLimit(int64_t max_io_mb) {
 rocksdb::DB *Storage::GetDB() { return db_.get(); }
 
 Status Storage::BeginTxn() {
-  if (is_txn_mode_) {
+  if (IsTxnMode()) {
     return Status{Status::NotOK, "cannot begin a new transaction while already in transaction mode"};
   }
-  // The EXEC command is exclusive and shouldn't have multi transaction at the same time,
-  // so it's fine to reset the global write batch without any lock.
-  is_txn_mode_ = true;
-  txn_write_batch_ =
+  // The write batch belongs to the current thread, so it's fine to reset it without any lock.
+  txn_state_.storage = this;
+  txn_state_.write_batch =
       std::make_unique<rocksdb::WriteBatchWithIndex>(rocksdb::BytewiseComparator() /*default backup_index_comparator */,
                                                      0 /* default reserved_bytes*/, GetWriteBatchMaxBytes());
   return Status::OK();
 }
 
 Status Storage::CommitTxn() {
-  if (!is_txn_mode_) {
+  if (!IsTxnMode()) {
     return Status{Status::NotOK, "cannot commit while not in transaction mode"};
   }
-  engine::Context ctx(this);
-  auto s = writeToDB(ctx, default_write_opts_, txn_write_batch_->GetWriteBatch());
+  auto write_batch = std::move(txn_state_.write_batch);
+  auto after_commit = std::move(txn_state_.after_commit);
+  txn_state_.after_commit.clear();
+  txn_state_.storage = nullptr;
 
-  is_txn_mode_ = false;
-  txn_write_batch_ = nullptr;
-  if (s.ok()) {
-    return Status::OK();
+  // nothing to write if the transaction only read
+  if (write_batch->GetWriteBatch()->Count() > 0) {
+    engine::Context ctx(this);
+    auto s = writeToDB(ctx, default_write_opts_, write_batch->GetWriteBatch());
+    if (!s.ok()) return {Status::NotOK, s.ToString()};
+  }
+
+  for (const auto &callback : after_commit) callback();
+  return Status::OK();
+}
+
+void Storage::AfterCommit(std::function<void()> callback) {
+  if (IsTxnMode()) {
+    txn_state_.after_commit.emplace_back(std::move(callback));
+  } else {
+    callback();
   }
-  return {Status::NotOK, s.ToString()};
 }
 
 ObserverOrUniquePtr<rocksdb::WriteBatchBase> Storage::GetWriteBatchBase() {
-  if (is_txn_mode_) {
-    return ObserverOrUniquePtr<rocksdb::WriteBatchBase>(txn_write_batch_.get(), ObserverOrUnique::Observer);
+  if (auto txn_batch = txnWriteBatch()) {
+    return ObserverOrUniquePtr<rocksdb::WriteBatchBase>(txn_batch, ObserverOrUnique::Observer);
   }
   return ObserverOrUniquePtr<rocksdb::WriteBatchBase>(
       new rocksdb::WriteBatch(0 /*reserved_bytes*/, GetWriteBatchMaxBytes()), ObserverOrUnique::Unique);
@@ -993,6 +1080,7 @@ std::unique_lock<std::shared_mutex> Storage::WriteLockGuard() { return std::uniq
 Status Storage::ReplDataManager::GetFullReplDataInfo(Storage *storage, std::string *files) {
   auto guard = storage->ReadLockGuard();
   if (storage->IsClosing()) return {Status::NotOK, "DB is closing"};
+  if (storage->IsImportingSST()) return {Status::NotOK, "SST files are being imported"};
 
   std::string data_files_dir = storage->config_->checkpoint_dir;
   std::unique_lock<std::mutex> ulm(storage->checkpoint_mu_);
@@ -1041,6 +1129,12 @@ Status Storage::ReplDataManager::GetFullReplDataInfo(Storage *storage, std::stri
       LOG(WARNING) << "[storage] Can't use current checkpoint, error: " << s.Msg();
       return {Status::NotOK, fmt::format("Can't use current checkpoint, error: {}", s.Msg())};
     }
+
+    // Neither if it was taken before ingesting SST files, for the same reason
+    if (storage->checkpoint_info_.latest_seq <= storage->GetSSTIngestedSequence()) {
+      LOG(WARNING) << "[storage] Can't use current checkpoint, it was taken before ingesting SST files";
+      return {Status::NotOK, "Can't use current checkpoint, waiting for next checkpoint"};
+    }
     LOG(INFO) << "[storage] Using current existing checkpoint";
   }
 
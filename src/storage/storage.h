@@ -28,9 +28,14 @@
 #include <rocksdb/utilities/write_batch_with_index.h>
 
 #include <atomic>
+#include <chrono>
 #include <cinttypes>
+#include <condition_variable>
 #include <cstddef>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <shared_mutex>
 #include <string>
 #include <utility>
@@ -38,8 +43,10 @@
 
 #include "common/port.h"
 #include "config/config.h"
+#include "key_num_estimator.h"
 #include "lock_manager.h"
 #include "observer_or_unique.h"
+#include "stats/latency_monitor.h"
 #include "status.h"
 
 #if defined(__sparc__) || defined(__arm__)
@@ -117,6 +124,8 @@ struct DBStats {
   alignas(CACHE_LINE_SIZE) std::atomic<uint_fast64_t> flush_count = 0;
   alignas(CACHE_LINE_SIZE) std::atomic<uint_fast64_t> keyspace_hits = 0;
   alignas(CACHE_LINE_SIZE) std::atomic<uint_fast64_t> keyspace_misses = 0;
+  alignas(CACHE_LINE_SIZE) std::atomic<uint_fast64_t> expired_keys = 0;
+  alignas(CACHE_LINE_SIZE) std::atomic<uint_fast64_t> expire_lag_ms = 0;
 };
 
 class ColumnFamilyConfig {
@@ -256,11 +265,22 @@ class Storage {
   [[nodiscard]] rocksdb::Status FlushScripts(engine::Context &ctx, const rocksdb::WriteOptions &options,
                                              rocksdb::ColumnFamilyHandle *cf_handle);
   bool WALHasNewData(rocksdb::SequenceNumber seq) { return seq <= LatestSeqNumber(); }
+  // Block until the WAL has data at `seq` or the timeout expires, return whether it has the data.
+  // The writers wake the waiters up right after writing, so it's woken without polling the WAL.
+  bool WaitForWALData(rocksdb::SequenceNumber seq, std::chrono::milliseconds timeout);
   Status InWALBoundary(rocksdb::SequenceNumber seq);
   Status WriteToPropagateCF(engine::Context &ctx, const std::string &key, const std::string &value);
 
   [[nodiscard]] rocksdb::Status Compact(rocksdb::ColumnFamilyHandle *cf, const rocksdb::Slice *begin,
                                         const rocksdb::Slice *end);
+  // Ingests the external SST files of the column families atomically, the files are moved into the DB
+  [[nodiscard]] rocksdb::Status IngestSSTFiles(const std::map<ColumnFamilyID, std::vector<std::string>> &files);
+  // The ingested SST files aren't in the WAL, so no replica may start syncing while they're being imported,
+  // and a replica or a checkpoint which has no data after the latest sequence number when the files were
+  // last ingested has to sync fully from a new checkpoint
+  void SetImportingSST(bool importing) { importing_sst_ = importing; }
+  bool IsImportingSST() const { return importing_sst_; }
+  rocksdb::SequenceNumber GetSSTIngestedSequence() const { return sst_ingested_sequence_; }
   rocksdb::DB *GetDB();
   bool IsClosing() const { return db_closing_; }
   std::string GetName() const { return config_->db_name; }
@@ -282,10 +302,20 @@ class Storage {
   Config *GetConfig() const { return config_; }
 
   const DBStats *GetDBStats() const { return db_stats_.get(); }
+  KeyNumEstimator *GetKeyNumEstimator() { return key_num_estimator_.get(); }
+  LatencyMonitor *GetLatencyMonitor() { return latency_monitor_.get(); }
+  // The number of times the SST files of the metadata column family have changed, by flushes,
+  // compactions, ingestions or reopening the DB, for caching what's read from their table properties
+  uint64_t GetMetadataFilesVersion() const { return metadata_files_version_.load(std::memory_order_acquire); }
+  void OnMetadataFilesChanged() { metadata_files_version_.fetch_add(1, std::memory_order_acq_rel); }
   void RecordStat(StatType type, uint64_t v);
 
   Status BeginTxn();
   Status CommitTxn();
+  bool IsTxnMode() const { return txnWriteBatch() != nullptr; }
+  // Run the callback once the writes of the current transaction are committed, or right away if
+  // not in the transaction mode. It's for the in-memory states which must follow the committed data.
+  void AfterCommit(std::function<void()> callback);
   ObserverOrUniquePtr<rocksdb::WriteBatchBase> GetWriteBatchBase();
 
   Storage(const Storage &) = delete;
@@ -350,26 +380,45 @@ class Storage {
   std::vector<rocksdb::ColumnFamilyHandle *> cf_handles_;
   LockManager lock_mgr_;
   std::atomic<bool> db_size_limit_reached_{false};
+  std::atomic<bool> importing_sst_{false};
+  std::atomic<rocksdb::SequenceNumber> sst_ingested_sequence_{0};
+  std::atomic<uint64_t> metadata_files_version_{0};
 
   std::unique_ptr<DBStats> db_stats_;
+  std::unique_ptr<KeyNumEstimator> key_num_estimator_;
+  std::unique_ptr<LatencyMonitor> latency_monitor_;
 
   std::shared_mutex db_rw_lock_;
   bool db_closing_ = true;
 
   std::atomic<bool> db_in_retryable_io_error_{false};
 
-  std::atomic<bool> is_txn_mode_ = false;
-  // txn_write_batch_ is used as the global write batch for the transaction mode,
-  // all writes will be grouped in this write batch when entering the transaction mode,
+  // the threads waiting in WaitForWALData, the writers only take the mutex to notify if there are any
+  std::atomic<int> wal_waiters_ = 0;
+  std::mutex wal_waiters_mu_;
+  std::condition_variable wal_waiters_cv_;
+
+  // TxnState holds the write batch for the transaction mode of the current thread,
+  // all writes of the thread will be grouped in this write batch when entering the transaction mode,
   // then write it at once when committing.
   //
-  // Notice: the reason why we can use the global transaction? because the EXEC is an exclusive
-  // command, so it won't have multi transactions to be executed at the same time.
-  std::unique_ptr<rocksdb::WriteBatchWithIndex> txn_write_batch_;
+  // It's kept per thread, since the transactions of EXEC and the Lua scripts running with
+  // the key locks may be executed by several workers at the same time.
+  struct TxnState {
+    const Storage *storage = nullptr;
+    std::unique_ptr<rocksdb::WriteBatchWithIndex> write_batch;
+    std::vector<std::function<void()>> after_commit;
+  };
+  inline static thread_local TxnState txn_state_;
+
+  rocksdb::WriteBatchWithIndex *txnWriteBatch() const {
+    return txn_state_.storage == this ? txn_state_.write_batch.get() : nullptr;
+  }
 
   rocksdb::WriteOptions default_write_opts_ = rocksdb::WriteOptions();
 
   rocksdb::Status writeToDB(engine::Context &ctx, const rocksdb::WriteOptions &options, rocksdb::WriteBatch *updates);
+  void notifyWALWaiters();
   void recordKeyspaceStat(const rocksdb::ColumnFamilyHandle *column_family, const rocksdb::Status &s);
 };
 
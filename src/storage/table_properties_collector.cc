@@ -20,6 +20,7 @@
 
 #include "table_properties_collector.h"
 
+#include <algorithm>
 #include <memory>
 #include <utility>
 
@@ -53,6 +54,9 @@ rocksdb::Status CompactOnExpiredCollector::AddUserKey(const rocksdb::Slice &key,
   if (!s.ok()) return rocksdb::Status::OK();
 
   total_keys_ += metadata.size;
+  if (metadata.expire > 0 && metadata.expire < min_expire_) {
+    min_expire_ = metadata.expire;
+  }
   if (metadata.ExpireAt(Server::GetCachedUnixTime() * 1000)) {
     deleted_keys_ += metadata.size + 1;
   }
@@ -64,6 +68,9 @@ rocksdb::Status CompactOnExpiredCollector::Finish(rocksdb::UserCollectedProperti
   properties->emplace("deleted_keys", std::to_string(deleted_keys_));
   properties->emplace("start_key", start_key_);
   properties->emplace("stop_key", stop_key_);
+  if (min_expire_ != std::numeric_limits<uint64_t>::max()) {
+    properties->emplace(kMinExpireProperty, std::to_string(min_expire_));
+  }
   return rocksdb::Status::OK();
 }
 
@@ -88,3 +95,137 @@ std::shared_ptr<CompactOnExpiredTableCollectorFactory> NewCompactOnExpiredTableC
     const std::string &cf_name, float trigger_threshold) {
   return std::make_shared<CompactOnExpiredTableCollectorFactory>(cf_name, trigger_threshold);
 }
+
+std::string KeyNumProperty::Encode() const {
+  std::string dst;
+  PutVarint32(&dst, static_cast<uint32_t>(namespaces.size()));
+  for (const auto &entry : namespaces) {
+    PutSizedString(&dst, entry.ns);
+    PutSizedString(&dst, entry.first_key);
+    PutSizedString(&dst, entry.last_key);
+    PutFixed64(&dst, entry.max_sequence);
+    PutFixed64(&dst, entry.keys);
+    PutFixed64(&dst, entry.deletes);
+    PutFixed64(&dst, entry.expires);
+    PutFixed64(&dst, entry.expire_sum_secs);
+    PutVarint32(&dst, static_cast<uint32_t>(entry.slots.size()));
+    for (const auto &slot : entry.slots) {
+      PutFixed16(&dst, slot.slot);
+      PutVarint32(&dst, slot.keys);
+      PutVarint32(&dst, slot.deletes);
+    }
+  }
+  PutVarint32(&dst, static_cast<uint32_t>(range_deletions.size()));
+  for (const auto &deletion : range_deletions) {
+    PutSizedString(&dst, deletion.begin);
+    PutSizedString(&dst, deletion.end);
+    PutFixed64(&dst, deletion.sequence);
+  }
+  return dst;
+}
+
+bool KeyNumProperty::Decode(rocksdb::Slice input) {
+  rocksdb::Slice ns, first_key, last_key;
+  uint32_t size = 0;
+  if (!GetVarint32(&input, &size)) return false;
+  namespaces.resize(size);
+  for (auto &entry : namespaces) {
+    uint32_t slots = 0;
+    if (!GetSizedString(&input, &ns) || !GetSizedString(&input, &first_key) || !GetSizedString(&input, &last_key) ||
+        !GetFixed64(&input, &entry.max_sequence) || !GetFixed64(&input, &entry.keys) ||
+        !GetFixed64(&input, &entry.deletes) || !GetFixed64(&input, &entry.expires) ||
+        !GetFixed64(&input, &entry.expire_sum_secs) || !GetVarint32(&input, &slots)) {
+      return false;
+    }
+    entry.ns = ns.ToString();
+    entry.first_key = first_key.ToString();
+    entry.last_key = last_key.ToString();
+    entry.slots.resize(slots);
+    for (auto &slot : entry.slots) {
+      if (!GetFixed16(&input, &slot.slot) || !GetVarint32(&input, &slot.keys) || !GetVarint32(&input, &slot.deletes)) {
+        return false;
+      }
+    }
+  }
+
+  rocksdb::Slice begin, end;
+  if (!GetVarint32(&input, &size)) return false;
+  range_deletions.resize(size);
+  for (auto &deletion : range_deletions) {
+    if (!GetSizedString(&input, &begin) || !GetSizedString(&input, &end) || !GetFixed64(&input, &deletion.sequence)) {
+      return false;
+    }
+    deletion.begin = begin.ToString();
+    deletion.end = end.ToString();
+  }
+  return input.empty();
+}
+
+rocksdb::Status KeyNumCollector::AddUserKey(const rocksdb::Slice &key, const rocksdb::Slice &value,
+                                            rocksdb::EntryType type, rocksdb::SequenceNumber seq, uint64_t) {
+  if (type == rocksdb::kEntryRangeDeletion) {
+    property_.range_deletions.push_back({key.ToString(), value.ToString(), seq});
+    return rocksdb::Status::OK();
+  }
+
+  bool is_delete = type == rocksdb::kEntryDelete || type == rocksdb::kEntrySingleDelete;
+  if (!is_delete && type != rocksdb::kEntryPut && type != rocksdb::kEntryBlobIndex) {
+    return rocksdb::Status::OK();
+  }
+  // the older versions of a key kept for snapshots come right after the latest one
+  if (key == last_key_) return rocksdb::Status::OK();
+  last_key_ = key.ToString();
+
+  auto [ns, _] = ExtractNamespaceKey(key, slot_id_encoded_);
+  auto &namespaces = property_.namespaces;
+  if (namespaces.empty() || namespaces.back().ns != ns) {
+    namespaces.emplace_back();
+    namespaces.back().ns = ns.ToString();
+    namespaces.back().first_key = last_key_;
+  }
+  auto &entry = namespaces.back();
+  entry.last_key = last_key_;
+  entry.max_sequence = std::max(entry.max_sequence, seq);
+
+  KeyNumProperty::Slot *slot = nullptr;
+  if (slot_id_encoded_) {
+    auto slot_id = ExtractSlotId(key);
+    if (entry.slots.empty() || entry.slots.back().slot != slot_id) entry.slots.push_back({slot_id, 0, 0});
+    slot = &entry.slots.back();
+  }
+
+  if (is_delete) {
+    entry.deletes++;
+    if (slot) slot->deletes++;
+    return rocksdb::Status::OK();
+  }
+
+  // the value of a blob index is stored in a blob file, so the key is counted as one without TTL
+  Metadata metadata(kRedisNone, false);
+  if (type == rocksdb::kEntryPut && metadata.Decode(value).ok()) {
+    if (metadata.expire > 0) {
+      entry.expires++;
+      entry.expire_sum_secs += Metadata::ExpireMsToS(metadata.expire);
+    }
+  }
+  entry.keys++;
+  if (slot) slot->keys++;
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status KeyNumCollector::Finish(rocksdb::UserCollectedProperties *properties) {
+  properties->emplace(kKeyNumProperty, property_.Encode());
+  return rocksdb::Status::OK();
+}
+
+rocksdb::UserCollectedProperties KeyNumCollector::GetReadableProperties() const {
+  uint64_t keys = 0, deletes = 0;
+  for (const auto &entry : property_.namespaces) {
+    keys += entry.keys;
+    deletes += entry.deletes;
+  }
+  rocksdb::UserCollectedProperties properties;
+  properties.emplace("key_num_keys", std::to_string(keys));
+  properties.emplace("key_num_deletes", std::to_string(deletes));
+  return properties;
+}
@@ -22,9 +22,19 @@
 
 #include <rocksdb/table_properties.h>
 
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
+
+// The earliest expire time in milliseconds of the keys with TTL in a metadata SST,
+// which the active expiration uses to find the files that have keys due
+constexpr const char *kMinExpireProperty = "min_expire";
+
+// The number of keys of each namespace and slot in a metadata SST, see KeyNumProperty
+constexpr const char *kKeyNumProperty = "key_num";
 
 class CompactOnExpiredCollector : public rocksdb::TablePropertiesCollector {
  public:
@@ -42,6 +52,7 @@ class CompactOnExpiredCollector : public rocksdb::TablePropertiesCollector {
   float trigger_threshold_;
   uint64_t total_keys_ = 0;
   uint64_t deleted_keys_ = 0;
+  uint64_t min_expire_ = std::numeric_limits<uint64_t>::max();
   std::string start_key_;
   std::string stop_key_;
 };
@@ -64,3 +75,70 @@ class CompactOnExpiredTableCollectorFactory : public rocksdb::TablePropertiesCol
 
 std::shared_ptr<CompactOnExpiredTableCollectorFactory> NewCompactOnExpiredTableCollectorFactory(
     const std::string &cf_name, float trigger_threshold);
+
+// The keys of a metadata SST counted by KeyNumCollector, from which KeyNumEstimator adds up
+// the number of keys without scanning the metadata.
+struct KeyNumProperty {
+  struct Slot {
+    uint16_t slot;
+    uint32_t keys;
+    uint32_t deletes;
+  };
+
+  struct Namespace {
+    std::string ns;
+    // the first and last metadata keys of the namespace in the SST
+    std::string first_key;
+    std::string last_key;
+    uint64_t max_sequence = 0;
+    // the keys including the expired ones, as the active expiration writes deletion markers for them
+    uint64_t keys = 0;
+    // the deletion markers, each of which hides a key of an older SST
+    uint64_t deletes = 0;
+    // the keys with TTL and the sum of their expire time in seconds
+    uint64_t expires = 0;
+    uint64_t expire_sum_secs = 0;
+    // the same counts for each slot, only if the slot id is encoded
+    std::vector<Slot> slots;
+  };
+
+  struct RangeDeletion {
+    std::string begin;
+    std::string end;
+    uint64_t sequence;
+  };
+
+  std::vector<Namespace> namespaces;
+  std::vector<RangeDeletion> range_deletions;
+
+  std::string Encode() const;
+  bool Decode(rocksdb::Slice input);
+};
+
+class KeyNumCollector : public rocksdb::TablePropertiesCollector {
+ public:
+  explicit KeyNumCollector(bool slot_id_encoded) : slot_id_encoded_(slot_id_encoded) {}
+  const char *Name() const override { return "key_num_collector"; }
+  rocksdb::Status AddUserKey(const rocksdb::Slice &key, const rocksdb::Slice &value, rocksdb::EntryType type,
+                             rocksdb::SequenceNumber seq, uint64_t) override;
+  rocksdb::Status Finish(rocksdb::UserCollectedProperties *properties) override;
+  rocksdb::UserCollectedProperties GetReadableProperties() const override;
+
+ private:
+  bool slot_id_encoded_;
+  std::string last_key_;
+  KeyNumProperty property_;
+};
+
+class KeyNumTableCollectorFactory : public rocksdb::TablePropertiesCollectorFactory {
+ public:
+  explicit KeyNumTableCollectorFactory(bool slot_id_encoded) : slot_id_encoded_(slot_id_encoded) {}
+  rocksdb::TablePropertiesCollector *CreateTablePropertiesCollector(
+      [[maybe_unused]] rocksdb::TablePropertiesCollectorFactory::Context context) override {
+    return new KeyNumCollector(slot_id_encoded_);
+  }
+  const char *Name() const override { return "KeyNumCollector"; }
+
+ private:
+  bool slot_id_encoded_;
+};
@@ -0,0 +1,337 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "bitmap_container.h"
+
+#include <algorithm>
+
+#include "common/bit_util.h"
+#include "encoding.h"
+
+namespace redis {
+
+rocksdb::Status BitmapContainer::Parse(rocksdb::Slice value, BitmapContainer *container) {
+  if (value.empty()) {
+    container->type_ = kEmpty;
+    container->data_ = rocksdb::Slice();
+    return rocksdb::Status::OK();
+  }
+
+  auto type = static_cast<Type>(value[0]);
+  value.remove_prefix(1);
+  bool valid = false;
+  switch (type) {
+    case kArray:
+      valid = !value.empty() && value.size() % 2 == 0;
+      break;
+    case kRun:
+      valid = !value.empty() && value.size() % 4 == 0;
+      break;
+    case kBitset:
+      valid = true;
+      break;
+    default:
+      break;
+  }
+  if (!valid) return rocksdb::Status::Corruption("invalid bitmap container");
+
+  container->type_ = type;
+  container->data_ = value;
+  return rocksdb::Status::OK();
+}
+
+BitmapContainer::Type BitmapContainer::smallestType(uint32_t bits, uint32_t runs, uint32_t bytes) {
+  if (bits == 0) return kEmpty;
+  if (runs * 4 < bits * 2 && runs * 4 < bytes) return kRun;
+  if (bits * 2 < bytes) return kArray;
+  return kBitset;
+}
+
+std::string BitmapContainer::Encode(rocksdb::Slice segment) {
+  size_t bytes = segment.size();
+  while (bytes > 0 && segment[bytes - 1] == 0) bytes--;
+
+  const auto *data = reinterpret_cast<const uint8_t *>(segment.data());
+  uint32_t bits = 0, runs = 0;
+  uint8_t carry = 0;
+  for (size_t i = 0; i < bytes; i++) {
+    bits += __builtin_popcount(data[i]);
+    // the bits starting a run are set while their previous bits aren't
+    runs += __builtin_popcount(data[i] & ~((data[i] << 1) | carry) & 0xff);
+    carry = data[i] >> 7;
+  }
+
+  auto type = smallestType(bits, runs, bytes);
+  std::string container;
+  if (type == kEmpty) return container;
+
+  container.push_back(static_cast<char>(type));
+  if (type == kBitset) {
+    container.append(segment.data(), bytes);
+    return container;
+  }
+
+  bool in_run = false;
+  for (uint32_t pos = 0; pos < bytes * 8; pos++) {
+    bool bit = util::lsb::GetBit(data, pos);
+    if (type == kArray) {
+      if (bit) PutFixed16(&container, static_cast<uint16_t>(pos));
+      continue;
+    }
+    if (bit && !in_run) PutFixed16(&container, static_cast<uint16_t>(pos));
+    if (!bit && in_run) PutFixed16(&container, static_cast<uint16_t>(pos - 1));
+    in_run = bit;
+  }
+  if (in_run) PutFixed16(&container, static_cast<uint16_t>(bytes * 8 - 1));
+  return container;
+}
+
+std::string BitmapContainer::encodePositions(const std::vector<uint16_t> &positions) {
+  std::string container;
+  if (positions.empty()) return container;
+
+  uint32_t runs = 0;
+  for (size_t i = 0; i < positions.size(); i++) {
+    if (i == 0 || positions[i] != positions[i - 1] + 1) runs++;
+  }
+
+  auto type = smallestType(positions.size(), runs, positions.back() / 8 + 1);
+  if (type == kBitset) {
+    std::string segment(positions.back() / 8 + 1, 0);
+    for (auto pos : positions) util::lsb::SetBitTo(reinterpret_cast<uint8_t *>(segment.data()), pos, true);
+    return Encode(segment);
+  }
+
+  container.push_back(static_cast<char>(type));
+  for (size_t i = 0; i < positions.size(); i++) {
+    if (type == kArray) {
+      PutFixed16(&container, positions[i]);
+      continue;
+    }
+    if (i == 0 || positions[i] != positions[i - 1] + 1) PutFixed16(&container, positions[i]);
+    if (i + 1 == positions.size() || positions[i + 1] != positions[i] + 1) PutFixed16(&container, positions[i]);
+  }
+  return container;
+}
+
+rocksdb::Status BitmapContainer::Intersect(const std::vector<rocksdb::Slice> &values, std::string *result) {
+  result->clear();
+  if (values.empty()) return rocksdb::Status::OK();
+
+  std::vector<BitmapContainer> containers(values.size());
+  const BitmapContainer *smallest_array = nullptr;
+  for (size_t i = 0; i < values.size(); i++) {
+    auto s = Parse(values[i], &containers[i]);
+    if (!s.ok()) return s;
+    // nothing is left if any of them is empty
+    if (containers[i].type_ == kEmpty) return rocksdb::Status::OK();
+    if (containers[i].type_ == kArray && (!smallest_array || containers[i].entries() < smallest_array->entries())) {
+      smallest_array = &containers[i];
+    }
+  }
+
+  if (smallest_array) {
+    std::vector<uint16_t> positions;
+    for (uint32_t i = 0; i < smallest_array->entries(); i++) {
+      uint16_t pos = smallest_array->position(i);
+      bool in_all = std::all_of(containers.begin(), containers.end(), [&](const BitmapContainer &container) {
+        return &container == smallest_array || container.Contains(pos);
+      });
+      if (in_all) positions.push_back(pos);
+    }
+    *result = encodePositions(positions);
+    return rocksdb::Status::OK();
+  }
+
+  std::string segment, other;
+  containers[0].ToBytes(&segment);
+  for (size_t i = 1; i < containers.size(); i++) {
+    containers[i].ToBytes(&other);
+    if (other.size() < segment.size()) segment.resize(other.size());
+    for (size_t j = 0; j < segment.size(); j++) segment[j] &= other[j];
+  }
+  *result = Encode(segment);
+  return rocksdb::Status::OK();
+}
+
+uint32_t BitmapContainer::entries() const {
+  switch (type_) {
+    case kArray:
+      return data_.size() / 2;
+    case kRun:
+      return data_.size() / 4;
+    default:
+      return 0;
+  }
+}
+
+uint16_t BitmapContainer::position(uint32_t i) const { return DecodeFixed16(data_.data() + i * 2); }
+
+uint16_t BitmapContainer::runStart(uint32_t i) const { return DecodeFixed16(data_.data() + i * 4); }
+
+uint16_t BitmapContainer::runLast(uint32_t i) const { return DecodeFixed16(data_.data() + i * 4 + 2); }
+
+uint32_t BitmapContainer::lowerBound(uint32_t pos) const {
+  uint32_t lo = 0, hi = entries();
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    uint32_t end = type_ == kArray ? position(mid) : runLast(mid);
+    if (end < pos) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+uint32_t BitmapContainer::Size() const {
+  switch (type_) {
+    case kArray:
+      return position(entries() - 1) / 8 + 1;
+    case kRun:
+      return runLast(entries() - 1) / 8 + 1;
+    case kBitset:
+      return data_.size();
+    default:
+      return 0;
+  }
+}
+
+bool BitmapContainer::Contains(uint32_t pos) const {
+  uint32_t i = 0;
+  switch (type_) {
+    case kArray:
+      i = lowerBound(pos);
+      return i < entries() && position(i) == pos;
+    case kRun:
+      i = lowerBound(pos);
+      return i < entries() && runStart(i) <= pos;
+    case kBitset:
+      return pos / 8 < data_.size() && util::lsb::GetBit(reinterpret_cast<const uint8_t *>(data_.data()), pos);
+    default:
+      return false;
+  }
+}
+
+uint8_t BitmapContainer::GetByte(uint32_t index) const {
+  if (type_ == kBitset) return index < data_.size() ? static_cast<uint8_t>(data_[index]) : 0;
+
+  uint8_t byte = 0;
+  uint32_t first = index * 8, last = index * 8 + 7;
+  for (uint32_t i = lowerBound(first); i < entries(); i++) {
+    uint32_t start = type_ == kArray ? position(i) : runStart(i);
+    if (start > last) break;
+    uint32_t end = type_ == kArray ? start : runLast(i);
+    for (uint32_t pos = std::max(start, first); pos <= std::min(end, last); pos++) {
+      byte |= 1 << (pos % 8);
+    }
+  }
+  return byte;
+}
+
+uint32_t BitmapContainer::Count(uint32_t first, uint32_t last) const {
+  if (first > last) return 0;
+
+  if (type_ == kArray) return lowerBound(last + 1) - lowerBound(first);
+
+  uint32_t count = 0;
+  if (type_ == kRun) {
+    for (uint32_t i = lowerBound(first); i < entries() && runStart(i) <= last; i++) {
+      count += std::min<uint32_t>(runLast(i), last) - std::max<uint32_t>(runStart(i), first) + 1;
+    }
+    return count;
+  }
+
+  if (type_ != kBitset || first / 8 >= data_.size()) return 0;
+  last = std::min<uint32_t>(last, data_.size() * 8 - 1);
+  const auto *data = reinterpret_cast<const uint8_t *>(data_.data());
+  uint32_t first_byte = first / 8, last_byte = last / 8;
+  auto first_mask = static_cast<uint8_t>(0xff << (first % 8));
+  auto last_mask = static_cast<uint8_t>(0xff >> (7 - last % 8));
+  if (first_byte == last_byte) return __builtin_popcount(data[first_byte] & first_mask & last_mask);
+
+  count += __builtin_popcount(data[first_byte] & first_mask);
+  count += __builtin_popcount(data[last_byte] & last_mask);
+  count += util::RawPopcount(data + first_byte + 1, last_byte - first_byte - 1);
+  return count;
+}
+
+int64_t BitmapContainer::Find(bool bit, uint32_t first, uint32_t last) const {
+  if (first > last) return -1;
+
+  int64_t pos = -1;
+  uint32_t i = 0;
+  switch (type_) {
+    case kEmpty:
+      pos = bit ? -1 : first;
+      break;
+    case kArray:
+      i = lowerBound(first);
+      if (bit) {
+        pos = i < entries() ? position(i) : -1;
+      } else {
+        pos = first;
+        for (; i < entries() && position(i) == pos; i++) pos++;
+      }
+      break;
+    case kRun:
+      i = lowerBound(first);
+      if (bit) {
+        pos = i < entries() ? std::max<uint32_t>(runStart(i), first) : -1;
+      } else {
+        // the runs never adjoin, so the bit following a run is clear
+        pos = i < entries() && runStart(i) <= first ? runLast(i) + 1 : first;
+      }
+      break;
+    case kBitset: {
+      const auto *data = reinterpret_cast<const uint8_t *>(data_.data());
+      for (uint32_t byte_index = first / 8; byte_index < data_.size() && byte_index <= last / 8; byte_index++) {
+        auto byte = static_cast<uint8_t>(bit ? data[byte_index] : ~data[byte_index]);
+        if (byte_index == first / 8) byte &= static_cast<uint8_t>(0xff << (first % 8));
+        if (byte != 0) {
+          pos = byte_index * 8 + __builtin_ctz(byte);
+          break;
+        }
+      }
+      // the bits after the bytes of the segment are clear
+      if (pos == -1 && !bit) pos = std::max<uint32_t>(first, data_.size() * 8);
+      break;
+    }
+  }
+  return pos <= static_cast<int64_t>(last) ? pos : -1;
+}
+
+void BitmapContainer::ToBytes(std::string *segment) const {
+  if (type_ == kBitset) {
+    segment->assign(data_.data(), data_.size());
+    return;
+  }
+
+  segment->assign(Size(), 0);
+  auto *data = reinterpret_cast<uint8_t *>(segment->data());
+  for (uint32_t i = 0; i < entries(); i++) {
+    uint32_t start = type_ == kArray ? position(i) : runStart(i);
+    uint32_t end = type_ == kArray ? start : runLast(i);
+    for (uint32_t pos = start; pos <= end; pos++) util::lsb::SetBitTo(data, pos, true);
+  }
+}
+
+}  // namespace redis
@@ -0,0 +1,91 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#pragma once
+
+#include <rocksdb/slice.h>
+#include <rocksdb/status.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace redis {
+
+// BitmapContainer is a segment of a compressed bitmap, see BitmapEncoding::kCompressedSegments.
+//
+// Like the containers of the roaring bitmaps, a segment is stored as the smallest of:
+// - an array container: the sorted positions of the set bits, 2 bytes each
+// - a run container: the first and the last positions of the runs of set bits, 4 bytes each
+// - a bitset container: the bytes of the segment, as stored in the plain bitmaps
+// following a byte of the container type. An empty value means no bit is set in the segment,
+// so it's removed by the compaction filter like the zero segments of the plain bitmaps.
+//
+// The positions are the offsets of the bits in the segment, the bit at position i
+// is (1 << i % 8) of the byte i / 8, the same as the plain segments.
+class BitmapContainer {
+ public:
+  enum Type : uint8_t {
+    kEmpty = 0,
+    kArray = 1,
+    kRun = 2,
+    kBitset = 3,
+  };
+
+  BitmapContainer() = default;
+
+  // The container refers to the value without copying it
+  static rocksdb::Status Parse(rocksdb::Slice value, BitmapContainer *container);
+  // Encode the bytes of a segment in the smallest container
+  static std::string Encode(rocksdb::Slice segment);
+  // Intersect the containers of the same segment of several bitmaps. If any of them is an array,
+  // which is the common case of the sparse bitmaps, the positions of the smallest array are
+  // looked up in the others without expanding them, otherwise the bytes of the segments are ANDed.
+  static rocksdb::Status Intersect(const std::vector<rocksdb::Slice> &values, std::string *result);
+
+  Type GetType() const { return type_; }
+  // The number of bytes of the segment, which ends at the byte of the last set bit
+  // unless it's a bitset container
+  uint32_t Size() const;
+  bool Contains(uint32_t pos) const;
+  uint8_t GetByte(uint32_t index) const;
+  // The number of the set bits in the positions [first, last]
+  uint32_t Count(uint32_t first, uint32_t last) const;
+  // The first position in [first, last] whose bit is `bit`, or -1 if there's no such position
+  int64_t Find(bool bit, uint32_t first, uint32_t last) const;
+  // Expand the container into the bytes of the segment
+  void ToBytes(std::string *segment) const;
+
+ private:
+  Type type_ = kEmpty;
+  rocksdb::Slice data_;
+
+  uint32_t entries() const;
+  uint16_t position(uint32_t i) const;
+  uint16_t runStart(uint32_t i) const;
+  uint16_t runLast(uint32_t i) const;
+  // The index of the first array position or run ending not before `pos`
+  uint32_t lowerBound(uint32_t pos) const;
+
+  static Type smallestType(uint32_t bits, uint32_t runs, uint32_t bytes);
+  static std::string encodePositions(const std::vector<uint16_t> &positions);
+};
+
+}  // namespace redis
@@ -23,9 +23,11 @@
 #include <algorithm>
 #include <cstdint>
 #include <memory>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "bitmap_container.h"
 #include "common/bit_util.h"
 #include "db_util.h"
 #include "parse_util.h"
@@ -95,6 +97,159 @@ uint32_t SegmentSubKeyIndexForBit(uint32_t bit_offset) {
   return (bit_offset / kBitmapSegmentBits) * kBitmapSegmentBytes;
 }
 
+// The summarized bitmaps record the popcount of every segment in 2 bytes, the popcounts of
+// kBitmapSummarySegments segments are stored in a summary block, which has the same size as a
+// segment. The blocks are keyed by a prefix byte sorting after all the fixed-width segment offsets.
+constexpr uint32_t kBitmapSummarySegments = kBitmapSegmentBytes / 2;
+constexpr char kBitmapSummaryPrefix = '\xff';
+
+// The summarized and compressed bitmaps key their segments by the fixed-width big-endian offsets
+// to keep them in order.
+static std::string SegmentSubKey(const BitmapMetadata &metadata, uint32_t byte_offset) {
+  if (!metadata.HasFixedWidthSubKeys()) return std::to_string(byte_offset);
+
+  std::string sub_key;
+  PutFixed32(&sub_key, byte_offset);
+  return sub_key;
+}
+
+static std::string SummarySubKey(uint32_t block_index) {
+  std::string sub_key(1, kBitmapSummaryPrefix);
+  PutFixed32(&sub_key, block_index);
+  return sub_key;
+}
+
+static uint32_t SegmentPopcount(const Slice &segment) {
+  return util::RawPopcount(reinterpret_cast<const uint8_t *>(segment.data()), static_cast<int64_t>(segment.size()));
+}
+
+// BitmapSummary reads and updates the popcount summary of a summarized bitmap,
+// the blocks read are cached and the updated ones are written by Flush().
+class BitmapSummary {
+ public:
+  BitmapSummary(engine::Storage *storage, std::string ns_key, uint64_t version)
+      : storage_(storage), ns_key_(std::move(ns_key)), version_(version) {}
+
+  rocksdb::Status Get(engine::Context &ctx, uint32_t segment_index, uint32_t *count) {
+    std::string *block = nullptr;
+    auto s = getBlock(ctx, segment_index / kBitmapSummarySegments, /*set_dirty=*/false, &block);
+    if (!s.ok()) return s;
+
+    size_t pos = (segment_index % kBitmapSummarySegments) * 2;
+    *count = pos + 2 <= block->size() ? DecodeFixed16(block->data() + pos) : 0;
+    return rocksdb::Status::OK();
+  }
+
+  rocksdb::Status Set(engine::Context &ctx, uint32_t segment_index, uint32_t count) {
+    std::string *block = nullptr;
+    auto s = getBlock(ctx, segment_index / kBitmapSummarySegments, /*set_dirty=*/true, &block);
+    if (!s.ok()) return s;
+
+    size_t pos = (segment_index % kBitmapSummarySegments) * 2;
+    if (block->size() < pos + 2) block->resize(pos + 2, 0);
+    EncodeFixed16(block->data() + pos, static_cast<uint16_t>(count));
+    return rocksdb::Status::OK();
+  }
+
+  // Sum the popcounts of the segments in [first, last]
+  rocksdb::Status Sum(engine::Context &ctx, uint32_t first, uint32_t last, uint64_t *count) {
+    *count = 0;
+    for (uint32_t block_index = first / kBitmapSummarySegments; block_index <= last / kBitmapSummarySegments;
+         block_index++) {
+      std::string *block = nullptr;
+      auto s = getBlock(ctx, block_index, /*set_dirty=*/false, &block);
+      if (!s.ok()) return s;
+
+      uint32_t block_first = block_index * kBitmapSummarySegments;
+      size_t begin = first > block_first ? first - block_first : 0;
+      size_t end = std::min(static_cast<size_t>(last - block_first + 1), block->size() / 2);
+      for (size_t i = begin; i < end; i++) {
+        *count += DecodeFixed16(block->data() + i * 2);
+      }
+    }
+    return rocksdb::Status::OK();
+  }
+
+  rocksdb::Status Flush(ObserverOrUniquePtr<rocksdb::WriteBatchBase> &batch) {
+    for (auto &[block_index, content] : blocks_) {
+      if (!content.first) continue;
+      std::string sub_key =
+          InternalKey(ns_key_, SummarySubKey(block_index), version_, storage_->IsSlotIdEncoded()).Encode();
+      auto s = batch->Put(sub_key, content.second);
+      if (!s.ok()) return s;
+    }
+    return rocksdb::Status::OK();
+  }
+
+ private:
+  rocksdb::Status getBlock(engine::Context &ctx, uint32_t block_index, bool set_dirty, std::string **block) {
+    auto [iter, no_cache] = blocks_.try_emplace(block_index);
+    auto &[is_dirty, content] = iter->second;
+
+    if (no_cache) {
+      is_dirty = false;
+      std::string sub_key =
+          InternalKey(ns_key_, SummarySubKey(block_index), version_, storage_->IsSlotIdEncoded()).Encode();
+      auto s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &content);
+      if (!s.ok() && !s.IsNotFound()) return s;
+    }
+
+    is_dirty |= set_dirty;
+    *block = &content;
+    return rocksdb::Status::OK();
+  }
+
+  engine::Storage *storage_;
+  std::string ns_key_;
+  uint64_t version_;
+  // Block index -> [is_dirty, popcounts]
+  std::unordered_map<uint32_t, std::pair<bool, std::string>> blocks_;
+};
+
+bool Bitmap::IsSummarySubKey(const Slice &sub_key) {
+  return sub_key.size() == 1 + sizeof(uint32_t) && sub_key[0] == kBitmapSummaryPrefix;
+}
+
+bool Bitmap::ParseSegmentSubKey(bool fixed_width, const Slice &sub_key, uint32_t *byte_offset) {
+  if (fixed_width) {
+    if (sub_key.size() != sizeof(uint32_t)) return false;
+    *byte_offset = DecodeFixed32(sub_key.data());
+    return true;
+  }
+
+  auto parse_result = ParseInt<uint32_t>(sub_key.ToString(), 10);
+  if (!parse_result) return false;
+  *byte_offset = *parse_result;
+  return true;
+}
+
+rocksdb::Status Bitmap::DecodeSegment(const BitmapMetadata &metadata, const Slice &value, std::string *segment) {
+  if (!metadata.IsCompressed()) {
+    segment->assign(value.data(), value.size());
+    return rocksdb::Status::OK();
+  }
+
+  BitmapContainer container;
+  auto s = BitmapContainer::Parse(value, &container);
+  if (!s.ok()) return s;
+  container.ToBytes(segment);
+  return rocksdb::Status::OK();
+}
+
+// The value stored for the bytes of a segment
+static std::string EncodeSegment(const BitmapMetadata &metadata, std::string segment) {
+  return metadata.IsCompressed() ? BitmapContainer::Encode(segment) : segment;
+}
+
+// Select the encoding of a bitmap being created
+static void InitBitmapEncoding(engine::Storage *storage, BitmapMetadata *metadata) {
+  if (storage->GetConfig()->bitmap_compression_enabled) {
+    metadata->SetEncoding(BitmapEncoding::kCompressedSegments);
+  } else if (storage->GetConfig()->bitmap_summary_enabled) {
+    metadata->SetEncoding(BitmapEncoding::kSummarizedSegments);
+  }
+}
+
 rocksdb::Status Bitmap::GetMetadata(engine::Context &ctx, const Slice &ns_key, BitmapMetadata *metadata,
                                     std::string *raw_value) {
   auto s = GetRawMetadata(ctx, ns_key, raw_value);
@@ -119,14 +274,21 @@ rocksdb::Status Bitmap::GetBit(engine::Context &ctx, const Slice &user_key, uint
   }
 
   rocksdb::PinnableSlice value;
-  std::string sub_key = InternalKey(ns_key, std::to_string(SegmentSubKeyIndexForBit(bit_offset)), metadata.version,
-                                    storage_->IsSlotIdEncoded())
+  std::string sub_key = InternalKey(ns_key, SegmentSubKey(metadata, SegmentSubKeyIndexForBit(bit_offset)),
+                                    metadata.version, storage_->IsSlotIdEncoded())
                             .Encode();
   s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &value);
   // If s.IsNotFound(), it means all bits in this segment are 0,
   // so we can return with *bit == false directly.
   if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
   uint32_t bit_offset_in_segment = bit_offset % kBitmapSegmentBits;
+  if (metadata.IsCompressed()) {
+    BitmapContainer container;
+    s = BitmapContainer::Parse(value, &container);
+    if (!s.ok()) return s;
+    *bit = container.Contains(bit_offset_in_segment);
+    return rocksdb::Status::OK();
+  }
   if (bit_offset_in_segment / 8 < value.size() &&
       util::lsb::GetBit(reinterpret_cast<const uint8_t *>(value.data()), bit_offset_in_segment)) {
     *bit = true;
@@ -159,12 +321,15 @@ rocksdb::Status Bitmap::GetString(engine::Context &ctx, const Slice &user_key, c
   auto iter = util::UniqueIterator(ctx, read_options);
   for (iter->Seek(prefix_key); iter->Valid() && iter->key().starts_with(prefix_key); iter->Next()) {
     InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
-    auto parse_result = ParseInt<uint32_t>(ikey.GetSubKey().ToString(), 10);
-    if (!parse_result) {
-      return rocksdb::Status::InvalidArgument(parse_result.Msg());
+    // the summary blocks follow all the segments
+    if (metadata.IsSummarized() && IsSummarySubKey(ikey.GetSubKey())) break;
+    uint32_t frag_index = 0;
+    if (!ParseSegmentSubKey(metadata.HasFixedWidthSubKeys(), ikey.GetSubKey(), &frag_index)) {
+      return rocksdb::Status::InvalidArgument("invalid bitmap segment subkey");
     }
-    uint32_t frag_index = *parse_result;
-    std::string fragment = iter->value().ToString();
+    std::string fragment;
+    auto s = DecodeSegment(metadata, iter->value(), &fragment);
+    if (!s.ok()) return s;
     // To be compatible with data written before the commit d603b0e(#338)
     // and avoid returning extra null char after expansion.
     uint32_t valid_size = std::min(
@@ -193,14 +358,19 @@ rocksdb::Status Bitmap::SetBit(engine::Context &ctx, const Slice &user_key, uint
     redis::BitmapString bitmap_string_db(storage_, namespace_);
     return bitmap_string_db.SetBit(ctx, ns_key, &raw_value, bit_offset, new_bit, old_bit);
   }
+  if (s.IsNotFound()) InitBitmapEncoding(storage_, &metadata);
 
   std::string value;
   uint32_t segment_index = SegmentSubKeyIndexForBit(bit_offset);
   std::string sub_key =
-      InternalKey(ns_key, std::to_string(segment_index), metadata.version, storage_->IsSlotIdEncoded()).Encode();
+      InternalKey(ns_key, SegmentSubKey(metadata, segment_index), metadata.version, storage_->IsSlotIdEncoded())
+          .Encode();
   if (s.ok()) {
-    s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &value);
+    std::string raw_segment;
+    s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &raw_segment);
     if (!s.ok() && !s.IsNotFound()) return s;
+    s = DecodeSegment(metadata, raw_segment, &value);
+    if (!s.ok()) return s;
   }
   uint32_t bit_offset_in_segment = bit_offset % kBitmapSegmentBits;
   uint32_t byte_index = (bit_offset / 8) % kBitmapSegmentBytes;
@@ -212,11 +382,23 @@ rocksdb::Status Bitmap::SetBit(engine::Context &ctx, const Slice &user_key, uint
   *old_bit = util::lsb::GetBit(data_ptr, bit_offset_in_segment);
   util::lsb::SetBitTo(data_ptr, bit_offset_in_segment, new_bit);
   auto batch = storage_->GetWriteBatchBase();
-  WriteBatchLogData log_data(kRedisBitmap, {std::to_string(kRedisCmdSetBit), std::to_string(bit_offset)});
+  // the new bit is recorded since it can't be read from the value of a compressed segment
+  WriteBatchLogData log_data(kRedisBitmap,
+                             {std::to_string(kRedisCmdSetBit), std::to_string(bit_offset), new_bit ? "1" : "0"});
   s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
-  s = batch->Put(sub_key, value);
+  s = batch->Put(sub_key, EncodeSegment(metadata, std::move(value)));
   if (!s.ok()) return s;
+  if (metadata.IsSummarized() && *old_bit != new_bit) {
+    BitmapSummary summary(storage_, ns_key, metadata.version);
+    uint32_t count = 0;
+    s = summary.Get(ctx, bit_offset / kBitmapSegmentBits, &count);
+    if (!s.ok()) return s;
+    s = summary.Set(ctx, bit_offset / kBitmapSegmentBits, new_bit ? count + 1 : std::max(count, 1U) - 1);
+    if (!s.ok()) return s;
+    s = summary.Flush(batch);
+    if (!s.ok()) return s;
+  }
   if (metadata.size != bitmap_size) {
     metadata.size = bitmap_size;
     std::string bytes;
@@ -269,15 +451,32 @@ rocksdb::Status Bitmap::BitCount(engine::Context &ctx, const Slice &user_key, in
   uint32_t stop_index = u_stop / kBitmapSegmentBytes;
   // Don't use multi get to prevent large range query, and take too much memory
   uint32_t mask_cnt = 0;
-  for (uint32_t i = start_index; i <= stop_index; i++) {
+  auto count_container = [&](uint32_t i, const Slice &value, bool *) -> rocksdb::Status {
+    BitmapContainer container;
+    auto s = BitmapContainer::Parse(value, &container);
+    if (!s.ok()) return s;
+    uint32_t start_in_segment = i == start_index ? u_start % kBitmapSegmentBytes : 0;
+    uint32_t stop_in_segment = i == stop_index ? u_stop % kBitmapSegmentBytes : kBitmapSegmentBytes - 1;
+    *cnt += container.Count(start_in_segment * 8, stop_in_segment * 8 + 7);
+    if (is_bit_index && i == start_index && first_byte_neg_mask != 0) {
+      uint8_t first_mask_byte = kBitSwapTable[container.GetByte(start_in_segment)] & first_byte_neg_mask;
+      mask_cnt += util::RawPopcount(&first_mask_byte, 1);
+    }
+    if (is_bit_index && i == stop_index && last_byte_neg_mask != 0) {
+      uint8_t last_mask_byte = kBitSwapTable[container.GetByte(stop_in_segment)] & last_byte_neg_mask;
+      mask_cnt += util::RawPopcount(&last_mask_byte, 1);
+    }
+    return rocksdb::Status::OK();
+  };
+  auto count_segment = [&](uint32_t i) -> rocksdb::Status {
     rocksdb::PinnableSlice pin_value;
     std::string sub_key =
-        InternalKey(ns_key, std::to_string(i * kBitmapSegmentBytes), metadata.version, storage_->IsSlotIdEncoded())
+        InternalKey(ns_key, SegmentSubKey(metadata, i * kBitmapSegmentBytes), metadata.version,
+                    storage_->IsSlotIdEncoded())
             .Encode();
-    s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &pin_value);
-    if (!s.ok() && !s.IsNotFound()) return s;
+    auto s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &pin_value);
     // NotFound means all bits in this segment are 0.
-    if (s.IsNotFound()) continue;
+    if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
     // Counting bits in [start_in_segment, stop_in_segment]
     int64_t start_in_segment = 0;                                                // start_index in 1024 bytes segment
     auto readable_stop_in_segment = static_cast<int64_t>(pin_value.size() - 1);  // stop_index  in 1024 bytes segment
@@ -302,6 +501,43 @@ rocksdb::Status Bitmap::BitCount(engine::Context &ctx, const Slice &user_key, in
       bytes = std::min(stop_in_segment, readable_stop_in_segment) - start_in_segment + 1;
       *cnt += util::RawPopcount(reinterpret_cast<const uint8_t *>(pin_value.data()) + start_in_segment, bytes);
     }
+    return rocksdb::Status::OK();
+  };
+
+  if (metadata.IsCompressed()) {
+    // only the segments stored in the range are read since they're keyed in order
+    s = scanSegments(ctx, ns_key, metadata, start_index, stop_index, count_container);
+    if (!s.ok()) return s;
+  } else if (!metadata.IsSummarized()) {
+    for (uint32_t i = start_index; i <= stop_index; i++) {
+      s = count_segment(i);
+      if (!s.ok()) return s;
+    }
+  } else {
+    // The segments wholly in the range are counted by the summary, only the ones partially
+    // in the range are read. The bytes after the end of the bitmap are always 0.
+    bool start_whole = u_start % kBitmapSegmentBytes == 0 && first_byte_neg_mask == 0;
+    bool stop_whole =
+        (u_stop % kBitmapSegmentBytes == kBitmapSegmentBytes - 1 || u_stop + 1 >= metadata.size) &&
+        last_byte_neg_mask == 0;
+    if (!start_whole) {
+      s = count_segment(start_index);
+      if (!s.ok()) return s;
+    }
+    if (!stop_whole && (stop_index != start_index || start_whole)) {
+      s = count_segment(stop_index);
+      if (!s.ok()) return s;
+    }
+
+    int64_t first_whole = start_whole ? start_index : static_cast<int64_t>(start_index) + 1;
+    int64_t last_whole = stop_whole ? stop_index : static_cast<int64_t>(stop_index) - 1;
+    if (first_whole <= last_whole) {
+      BitmapSummary summary(storage_, ns_key, metadata.version);
+      uint64_t summary_cnt = 0;
+      s = summary.Sum(ctx, first_whole, last_whole, &summary_cnt);
+      if (!s.ok()) return s;
+      *cnt += static_cast<uint32_t>(summary_cnt);
+    }
   }
   *cnt -= mask_cnt;
   return rocksdb::Status::OK();
@@ -376,12 +612,64 @@ rocksdb::Status Bitmap::BitPos(engine::Context &ctx, const Slice &user_key, bool
     return {0, 7};
   };
 
+  if (metadata.IsCompressed()) {
+    // Only the segments stored in the range are read since they're keyed in order,
+    // and the ones missing between them are all 0.
+    int64_t found = -1;
+    auto find_in_segment = [&](uint32_t i, const Slice &value) -> rocksdb::Status {
+      BitmapContainer container;
+      auto s = BitmapContainer::Parse(value, &container);
+      if (!s.ok()) return s;
+      uint32_t first = 0, last = kBitmapSegmentBits - 1;
+      if (i == start_segment_index) {
+        first = (u_start / to_bit_factor) % kBitmapSegmentBytes * 8 + start_bit_pos_in_byte;
+      }
+      if (i == stop_segment_index) {
+        last = (u_stop / to_bit_factor) % kBitmapSegmentBytes * 8 + (is_bit_index ? stop_bit_pos_in_byte : 7);
+      }
+      found = container.Find(bit, first, last);
+      if (found != -1) found += static_cast<int64_t>(i) * kBitmapSegmentBits;
+      return rocksdb::Status::OK();
+    };
+
+    uint32_t next_index = start_segment_index;
+    s = scanSegments(ctx, ns_key, metadata, start_segment_index, stop_segment_index,
+                     [&](uint32_t i, const Slice &value, bool *done) {
+                       *done = true;
+                       if (!bit && next_index < i) return find_in_segment(next_index, Slice());
+                       next_index = i + 1;
+                       auto s = find_in_segment(i, value);
+                       *done = found != -1;
+                       return s;
+                     });
+    if (!s.ok()) return s;
+    if (found == -1 && !bit && next_index <= stop_segment_index) {
+      s = find_in_segment(next_index, Slice());
+      if (!s.ok()) return s;
+    }
+    // the same as the bit not found in the plain segments below
+    *pos = found != -1 || bit || stop_given ? found : static_cast<int64_t>(metadata.size * 8);
+    return rocksdb::Status::OK();
+  }
+
+  std::optional<BitmapSummary> summary;
+  if (metadata.IsSummarized()) summary.emplace(storage_, ns_key, metadata.version);
+
   // Don't use multi get to prevent large range query, and take too much memory
   // Searching bits in segments [start_index, stop_index].
   for (uint32_t i = start_segment_index; i <= stop_segment_index; i++) {
+    if (summary) {
+      uint32_t count = 0;
+      s = summary->Get(ctx, i, &count);
+      if (!s.ok()) return s;
+      // skip the segments without the bit looked for without reading them
+      if ((bit && count == 0) || (!bit && count == kBitmapSegmentBits)) continue;
+    }
+
     rocksdb::PinnableSlice pin_value;
     std::string sub_key =
-        InternalKey(ns_key, std::to_string(i * kBitmapSegmentBytes), metadata.version, storage_->IsSlotIdEncoded())
+        InternalKey(ns_key, SegmentSubKey(metadata, i * kBitmapSegmentBytes), metadata.version,
+                    storage_->IsSlotIdEncoded())
             .Encode();
     s = storage_->Get(ctx, read_options, sub_key, &pin_value);
     if (!s.ok() && !s.IsNotFound()) return s;
@@ -457,6 +745,63 @@ rocksdb::Status Bitmap::BitPos(engine::Context &ctx, const Slice &user_key, bool
   return rocksdb::Status::OK();
 }
 
+rocksdb::Status Bitmap::scanSegments(engine::Context &ctx, const Slice &ns_key, const BitmapMetadata &metadata,
+                                     uint32_t first_index, uint32_t last_index, const SegmentVisitor &visitor) {
+  std::string prefix_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string first_key = InternalKey(ns_key, SegmentSubKey(metadata, first_index * kBitmapSegmentBytes),
+                                      metadata.version, storage_->IsSlotIdEncoded())
+                              .Encode();
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  Slice prefix_key_slice(prefix_key);
+  read_options.iterate_lower_bound = &prefix_key_slice;
+
+  auto iter = util::UniqueIterator(ctx, read_options);
+  for (iter->Seek(first_key); iter->Valid() && iter->key().starts_with(prefix_key); iter->Next()) {
+    InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
+    // the summary blocks follow all the segments
+    if (IsSummarySubKey(ikey.GetSubKey())) break;
+    uint32_t byte_offset = 0;
+    if (!ParseSegmentSubKey(true, ikey.GetSubKey(), &byte_offset)) {
+      return rocksdb::Status::InvalidArgument("invalid bitmap segment subkey");
+    }
+    uint32_t index = byte_offset / kBitmapSegmentBytes;
+    if (index > last_index) break;
+
+    bool done = false;
+    auto s = visitor(index, iter->value(), &done);
+    if (!s.ok() || done) return s;
+  }
+  return iter->status();
+}
+
+// AND a segment of the compressed bitmaps into the compressed result by their containers
+rocksdb::Status Bitmap::intersectSegments(engine::Context &ctx,
+                                          const std::vector<std::pair<std::string, BitmapMetadata>> &meta_pairs,
+                                          const Slice &ns_key, const BitmapMetadata &res_metadata,
+                                          uint32_t frag_index, ObserverOrUniquePtr<rocksdb::WriteBatchBase> &batch) {
+  std::vector<std::string> values(meta_pairs.size());
+  for (size_t i = 0; i < meta_pairs.size(); i++) {
+    const auto &[ns_op_key, metadata] = meta_pairs[i];
+    std::string sub_key = InternalKey(ns_op_key, SegmentSubKey(metadata, frag_index * kBitmapSegmentBytes),
+                                      metadata.version, storage_->IsSlotIdEncoded())
+                              .Encode();
+    auto s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &values[i]);
+    // the result is empty if any of the segments is missing
+    if (s.IsNotFound()) return rocksdb::Status::OK();
+    if (!s.ok()) return s;
+  }
+
+  std::string container;
+  auto s = BitmapContainer::Intersect(std::vector<Slice>(values.begin(), values.end()), &container);
+  if (!s.ok() || container.empty()) return s;
+
+  std::string sub_key = InternalKey(ns_key, SegmentSubKey(res_metadata, frag_index * kBitmapSegmentBytes),
+                                    res_metadata.version, storage_->IsSlotIdEncoded())
+                            .Encode();
+  return batch->Put(sub_key, container);
+}
+
 rocksdb::Status Bitmap::BitOp(engine::Context &ctx, BitOpFlags op_flag, const std::string &op_name,
                               const Slice &user_key, const std::vector<Slice> &op_keys, int64_t *len) {
   std::string raw_value;
@@ -501,6 +846,8 @@ rocksdb::Status Bitmap::BitOp(engine::Context &ctx, BitOpFlags op_flag, const st
   if (!s.ok()) return s;
 
   BitmapMetadata res_metadata;
+  InitBitmapEncoding(storage_, &res_metadata);
+  BitmapSummary res_summary(storage_, ns_key, res_metadata.version);
   // If the operation is AND and the number of keys is less than the number of op_keys,
   // we can skip setting the subkeys of the result bitmap and just set the metadata.
   const bool can_skip_op = op_flag == kBitOpAnd && num_keys != op_keys.size();
@@ -508,12 +855,56 @@ rocksdb::Status Bitmap::BitOp(engine::Context &ctx, BitOpFlags op_flag, const st
     uint64_t stop_index = (max_bitmap_size - 1) / kBitmapSegmentBytes;
     std::unique_ptr<unsigned char[]> frag_res(new unsigned char[kBitmapSegmentBytes]);
 
+    // If the segments of all the bitmaps are keyed in order, only the segments stored in them
+    // are visited instead of all the segments up to the end of the longest bitmap,
+    // and AND only needs the ones of the shortest bitmap.
+    const bool sparse_op =
+        op_flag != kBitOpNot && std::all_of(meta_pairs.begin(), meta_pairs.end(), [](const auto &meta_pair) {
+          return meta_pair.second.HasFixedWidthSubKeys();
+        });
+    std::vector<uint64_t> frag_indexes;
+    auto collect_segment = [&frag_indexes](uint32_t index, const Slice &value, bool *) {
+      // the empty segments are left to the compaction filter
+      if (!value.empty()) frag_indexes.emplace_back(index);
+      return rocksdb::Status::OK();
+    };
+    if (sparse_op) {
+      if (op_flag == kBitOpAnd) {
+        auto shortest = std::min_element(meta_pairs.begin(), meta_pairs.end(), [](const auto &a, const auto &b) {
+          return a.second.size < b.second.size;
+        });
+        s = scanSegments(ctx, shortest->first, shortest->second, 0, UINT32_MAX, collect_segment);
+        if (!s.ok()) return s;
+      } else {
+        for (const auto &meta_pair : meta_pairs) {
+          s = scanSegments(ctx, meta_pair.first, meta_pair.second, 0, UINT32_MAX, collect_segment);
+          if (!s.ok()) return s;
+        }
+        std::sort(frag_indexes.begin(), frag_indexes.end());
+        frag_indexes.erase(std::unique(frag_indexes.begin(), frag_indexes.end()), frag_indexes.end());
+      }
+    }
+    // AND of the compressed bitmaps works on the containers of the segments directly
+    const bool intersect_containers =
+        op_flag == kBitOpAnd && res_metadata.IsCompressed() &&
+        std::all_of(meta_pairs.begin(), meta_pairs.end(),
+                    [](const auto &meta_pair) { return meta_pair.second.IsCompressed(); });
+
     rocksdb::ReadOptions read_options = ctx.GetReadOptions();
-    for (uint64_t frag_index = 0; frag_index <= stop_index; frag_index++) {
+    uint64_t frag_count = sparse_op ? frag_indexes.size() : stop_index + 1;
+    for (uint64_t k = 0; k < frag_count; k++) {
+      uint64_t frag_index = sparse_op ? frag_indexes[k] : k;
+      if (intersect_containers) {
+        s = intersectSegments(ctx, meta_pairs, ns_key, res_metadata, static_cast<uint32_t>(frag_index), batch);
+        if (!s.ok()) return s;
+        continue;
+      }
+
       std::vector<rocksdb::PinnableSlice> fragments;
       uint16_t frag_maxlen = 0, frag_minlen = 0;
       for (const auto &meta_pair : meta_pairs) {
-        std::string sub_key = InternalKey(meta_pair.first, std::to_string(frag_index * kBitmapSegmentBytes),
+        auto frag_offset = static_cast<uint32_t>(frag_index * kBitmapSegmentBytes);
+        std::string sub_key = InternalKey(meta_pair.first, SegmentSubKey(meta_pair.second, frag_offset),
                                           meta_pair.second.version, storage_->IsSlotIdEncoded())
                                   .Encode();
         rocksdb::PinnableSlice fragment;
@@ -529,6 +920,13 @@ rocksdb::Status Bitmap::BitOp(engine::Context &ctx, BitOpFlags op_flag, const st
             break;
           }
         } else {
+          if (meta_pair.second.IsCompressed()) {
+            std::string segment;
+            s = DecodeSegment(meta_pair.second, fragment, &segment);
+            if (!s.ok()) return s;
+            fragment.Reset();
+            fragment.PinSelf(segment);
+          }
           if (frag_maxlen < fragment.size()) frag_maxlen = fragment.size();
           if (fragment.size() < frag_minlen || frag_minlen == 0) frag_minlen = fragment.size();
           fragments.emplace_back(std::move(fragment));
@@ -634,13 +1032,27 @@ rocksdb::Status Bitmap::BitOp(engine::Context &ctx, BitOpFlags op_flag, const st
             frag_maxlen = kBitmapSegmentBytes;
           }
         }
-        std::string sub_key = InternalKey(ns_key, std::to_string(frag_index * kBitmapSegmentBytes),
-                                          res_metadata.version, storage_->IsSlotIdEncoded())
+        auto frag_offset = static_cast<uint32_t>(frag_index * kBitmapSegmentBytes);
+        std::string sub_key = InternalKey(ns_key, SegmentSubKey(res_metadata, frag_offset), res_metadata.version,
+                                          storage_->IsSlotIdEncoded())
                                   .Encode();
-        auto s = batch->Put(sub_key, Slice(reinterpret_cast<char *>(frag_res.get()), frag_maxlen));
+        Slice frag_value(reinterpret_cast<char *>(frag_res.get()), frag_maxlen);
+        std::string container;
+        if (res_metadata.IsCompressed()) {
+          container = BitmapContainer::Encode(frag_value);
+          // the segments not stored are all 0
+          if (container.empty()) continue;
+        }
+        auto s = batch->Put(sub_key, res_metadata.IsCompressed() ? Slice(container) : frag_value);
         if (!s.ok()) return s;
+        if (res_metadata.IsSummarized()) {
+          s = res_summary.Set(ctx, static_cast<uint32_t>(frag_index), SegmentPopcount(frag_value));
+          if (!s.ok()) return s;
+        }
       }
     }
+    s = res_summary.Flush(batch);
+    if (!s.ok()) return s;
   }
 
   std::string bytes;
@@ -656,7 +1068,7 @@ rocksdb::Status Bitmap::BitOp(engine::Context &ctx, BitOpFlags op_flag, const st
 class Bitmap::SegmentCacheStore {
  public:
   SegmentCacheStore(engine::Storage *storage, rocksdb::ColumnFamilyHandle *metadata_cf_handle,
-                    std::string namespace_key, const Metadata &bitmap_metadata)
+                    std::string namespace_key, const BitmapMetadata &bitmap_metadata)
       : storage_(storage),
         metadata_cf_handle_(metadata_cf_handle),
         ns_key_(std::move(namespace_key)),
@@ -677,19 +1089,29 @@ class Bitmap::SegmentCacheStore {
   }
 
   // Add all dirty segments into write batch.
-  rocksdb::Status BatchForFlush(ObserverOrUniquePtr<rocksdb::WriteBatchBase> &batch) {
+  rocksdb::Status BatchForFlush(engine::Context &ctx, ObserverOrUniquePtr<rocksdb::WriteBatchBase> &batch) {
     uint64_t used_size = 0;
+    BitmapSummary summary(storage_, ns_key_, metadata_.version);
     for (auto &[index, content] : cache_) {
       if (content.first) {
         std::string sub_key =
             InternalKey(ns_key_, getSegmentSubKey(index), metadata_.version, storage_->IsSlotIdEncoded()).Encode();
-        auto s = batch->Put(sub_key, content.second);
+        auto s = batch->Put(sub_key, EncodeSegment(metadata_, content.second));
         if (!s.ok()) {
           return s;
         }
+        if (metadata_.IsSummarized()) {
+          s = summary.Set(ctx, index, SegmentPopcount(content.second));
+          if (!s.ok()) {
+            return s;
+          }
+        }
         used_size = std::max(used_size, static_cast<uint64_t>(index) * kBitmapSegmentBytes + content.second.size());
       }
     }
+    if (auto s = summary.Flush(batch); !s.ok()) {
+      return s;
+    }
     if (used_size > metadata_.size) {
       metadata_.size = used_size;
       std::string bytes;
@@ -711,10 +1133,15 @@ class Bitmap::SegmentCacheStore {
       is_dirty = false;
       std::string sub_key =
           InternalKey(ns_key_, getSegmentSubKey(index), metadata_.version, storage_->IsSlotIdEncoded()).Encode();
-      rocksdb::Status s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &str);
+      std::string value;
+      rocksdb::Status s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &value);
       if (!s.ok() && !s.IsNotFound()) {
         return s;
       }
+      s = DecodeSegment(metadata_, value, &str);
+      if (!s.ok()) {
+        return s;
+      }
     }
 
     is_dirty |= set_dirty;
@@ -722,12 +1149,12 @@ class Bitmap::SegmentCacheStore {
     return rocksdb::Status::OK();
   }
 
-  static std::string getSegmentSubKey(uint32_t index) { return std::to_string(index * kBitmapSegmentBytes); }
+  std::string getSegmentSubKey(uint32_t index) const { return SegmentSubKey(metadata_, index * kBitmapSegmentBytes); }
 
   engine::Storage *storage_;
   rocksdb::ColumnFamilyHandle *metadata_cf_handle_;
   std::string ns_key_;
-  Metadata metadata_;
+  BitmapMetadata metadata_;
   // Segment index -> [is_dirty, segment_cache_string]
   std::unordered_map<uint32_t, std::pair<bool, std::string>> cache_;
 };
@@ -850,6 +1277,7 @@ rocksdb::Status Bitmap::bitfield(engine::Context &ctx, const Slice &user_key, co
   if (metadata.Type() != RedisType::kRedisBitmap) {
     return rocksdb::Status::InvalidArgument("The value is not a bitmap or string.");
   }
+  if (s.IsNotFound()) InitBitmapEncoding(storage_, &metadata);
 
   // We firstly do the bitfield operation by fetching segments into memory.
   // Use SegmentCacheStore to record dirty segments. (if not read-only mode)
@@ -860,7 +1288,7 @@ rocksdb::Status Bitmap::bitfield(engine::Context &ctx, const Slice &user_key, co
     // Write changes into storage.
     auto batch = storage_->GetWriteBatchBase();
     if (bitfieldWriteAheadLog(batch, ops)) {
-      auto s = cache.BatchForFlush(batch);
+      auto s = cache.BatchForFlush(ctx, batch);
       if (!s.ok()) {
         return s;
       }
@@ -20,8 +20,10 @@
 
 #pragma once
 
+#include <functional>
 #include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "common/bitfield_util.h"
@@ -68,6 +70,13 @@ class Bitmap : public Database {
   }
   static bool GetBitFromValueAndOffset(std::string_view value, uint32_t bit_offset);
   static bool IsEmptySegment(const Slice &segment);
+  // Whether the subkey is a block of the popcount summary instead of a segment, see BitmapEncoding
+  static bool IsSummarySubKey(const Slice &sub_key);
+  // Parse the byte offset of the segment from its subkey, which is fixed-width for the summarized
+  // and compressed bitmaps
+  static bool ParseSegmentSubKey(bool fixed_width, const Slice &sub_key, uint32_t *byte_offset);
+  // Get the bytes of a segment from its value, which is a container for the compressed bitmaps
+  static rocksdb::Status DecodeSegment(const BitmapMetadata &metadata, const Slice &value, std::string *segment);
 
  private:
   template <bool ReadOnly>
@@ -77,6 +86,15 @@ class Bitmap : public Database {
                                     const std::vector<BitfieldOperation> &ops);
   rocksdb::Status GetMetadata(engine::Context &ctx, const Slice &ns_key, BitmapMetadata *metadata,
                               std::string *raw_value);
+  // Visit the segments stored in [first_index, last_index] of a bitmap whose segments are keyed in order,
+  // the visitor sets `done` to stop the scan
+  using SegmentVisitor = std::function<rocksdb::Status(uint32_t index, const Slice &value, bool *done)>;
+  rocksdb::Status scanSegments(engine::Context &ctx, const Slice &ns_key, const BitmapMetadata &metadata,
+                               uint32_t first_index, uint32_t last_index, const SegmentVisitor &visitor);
+  rocksdb::Status intersectSegments(engine::Context &ctx,
+                                    const std::vector<std::pair<std::string, BitmapMetadata>> &meta_pairs,
+                                    const Slice &ns_key, const BitmapMetadata &res_metadata, uint32_t frag_index,
+                                    ObserverOrUniquePtr<rocksdb::WriteBatchBase> &batch);
 
   template <bool ReadOnly>
   static rocksdb::Status runBitfieldOperationsWithCache(engine::Context &ctx, SegmentCacheStore &cache,
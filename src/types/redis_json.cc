@@ -20,23 +20,144 @@
 
 #include "redis_json.h"
 
+#include <algorithm>
+#include <cctype>
+
+#include "db_util.h"
 #include "json.h"
 #include "lock_manager.h"
+#include "parse_util.h"
 #include "storage/redis_metadata.h"
 
 namespace redis {
 
+// A shredded document is stored as one subkey per node. The subkey of a node is the list of member
+// names leading to it from the root, each escaped and terminated by "\0\1", so that the nodes of a
+// subtree share the subkey of its root as the prefix and come right after it in the key order.
+// An object node only marks that its members are nodes of their own, any other value
+// (including arrays and small objects) is a leaf node holding the value in CBOR.
+namespace {
+
+constexpr char kJsonObjectNode = 'o';
+constexpr char kJsonLeafNode = 'l';
+// objects smaller than this in CBOR are kept in one leaf node instead of being split further
+constexpr size_t kJsonObjectNodeMinBytes = 512;
+
+void AppendNodeSegment(std::string *node, std::string_view name) {
+  for (char c : name) {
+    node->push_back(c);
+    if (c == '\0') node->push_back('\xff');
+  }
+  node->append("\0\1", 2);
+}
+
+bool NextNodeSegment(Slice *input, std::string *name) {
+  name->clear();
+  while (!input->empty()) {
+    char c = (*input)[0];
+    if (c != '\0') {
+      name->push_back(c);
+      input->remove_prefix(1);
+      continue;
+    }
+    if (input->size() < 2) return false;
+    char escaped = (*input)[1];
+    input->remove_prefix(2);
+    if (escaped == '\1') return true;
+    if (escaped != '\xff') return false;
+    name->push_back('\0');
+  }
+  return false;
+}
+
+// a member name, or an array index if `index` is set
+struct JsonPathSegment {
+  std::string name;
+  std::optional<uint64_t> index;
+};
+
+// Split a definite path like `$.a['b'][0]` into segments. It returns false for the paths which may
+// select more than one value (wildcards, slices, filters, ...) and the syntaxes not handled here,
+// such paths are evaluated on the whole document.
+bool ParseDefinitePath(std::string_view path, std::vector<JsonPathSegment> *segments) {
+  if (path.empty() || path[0] != '$') return false;
+
+  size_t i = 1;
+  while (i < path.size()) {
+    if (path[i] == '.') {
+      size_t end = i + 1;
+      while (end < path.size() && (std::isalnum(static_cast<unsigned char>(path[end])) || path[end] == '_')) end++;
+      if (end == i + 1) return false;
+      segments->push_back({std::string(path.substr(i + 1, end - i - 1)), std::nullopt});
+      i = end;
+    } else if (path[i] == '[' && i + 1 < path.size() && (path[i + 1] == '\'' || path[i + 1] == '"')) {
+      size_t end = path.find(path[i + 1], i + 2);
+      if (end == std::string_view::npos || end + 1 >= path.size() || path[end + 1] != ']') return false;
+      auto name = path.substr(i + 2, end - i - 2);
+      if (name.find('\\') != std::string_view::npos) return false;
+      segments->push_back({std::string(name), std::nullopt});
+      i = end + 2;
+    } else if (path[i] == '[') {
+      size_t end = path.find(']', i + 1);
+      if (end == std::string_view::npos || end == i + 1) return false;
+      auto digits = path.substr(i + 1, end - i - 1);
+      auto is_digit = [](char c) { return std::isdigit(static_cast<unsigned char>(c)); };
+      if (!std::all_of(digits.begin(), digits.end(), is_digit)) return false;
+      auto index = ParseInt<uint64_t>(std::string(digits), 10);
+      if (!index) return false;
+      segments->push_back({"", *index});
+      i = end + 1;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+// the path made of the segments from `begin` on, relative to the value which the previous segments lead to
+std::string RelativePath(const std::vector<JsonPathSegment> &segments, size_t begin) {
+  std::string path = "$";
+  for (size_t i = begin; i < segments.size(); i++) {
+    if (segments[i].index) {
+      path += "[" + std::to_string(*segments[i].index) + "]";
+      continue;
+    }
+    char quote = segments[i].name.find('\'') == std::string::npos ? '\'' : '"';
+    path += '[';
+    path += quote;
+    path += segments[i].name;
+    path += quote;
+    path += ']';
+  }
+  return path;
+}
+
+}  // namespace
+
 rocksdb::Status Json::write(engine::Context &ctx, Slice ns_key, JsonMetadata *metadata, const JsonValue &json_val) {
   auto batch = storage_->GetWriteBatchBase();
   WriteBatchLogData log_data(kRedisJson);
   auto s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
 
+  s = put(ns_key, metadata, json_val, batch.Get());
+  if (!s.ok()) return s;
+
+  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+}
+
+rocksdb::Status Json::put(const Slice &ns_key, JsonMetadata *metadata, const JsonValue &json_val,
+                          rocksdb::WriteBatchBase *batch) {
   auto format = storage_->GetConfig()->json_storage_format;
+  // only the large documents with an object root are shredded, the others are kept inline as JSON
+  bool shred = format == JsonStorageFormat::SHREDDED && json_val.value.is_object();
+  if (format == JsonStorageFormat::SHREDDED) format = JsonStorageFormat::JSON;
   metadata->format = format;
+  metadata->SetShredded(false);
 
   std::string val;
   metadata->Encode(&val);
+  size_t metadata_size = val.size();
 
   Status redis_status;
   if (format == JsonStorageFormat::JSON) {
@@ -50,10 +171,24 @@ rocksdb::Status Json::write(engine::Context &ctx, Slice ns_key, JsonMetadata *me
     return rocksdb::Status::InvalidArgument("Failed to encode JSON into storage: " + redis_status.Msg());
   }
 
-  s = batch->Put(metadata_cf_handle_, ns_key, val);
-  if (!s.ok()) return s;
+  if (shred && val.size() - metadata_size >= static_cast<size_t>(storage_->GetConfig()->json_shred_threshold)) {
+    // the nodes are always written under a new version,
+    // and the ones of the previous version are dropped by the compaction filter
+    JsonMetadata shredded_metadata;
+    shredded_metadata.expire = metadata->expire;
+    shredded_metadata.format = JsonStorageFormat::SHREDDED;
+    shredded_metadata.SetShredded(true);
+    *metadata = shredded_metadata;
+
+    val.clear();
+    metadata->Encode(&val);
+    auto s = batch->Put(metadata_cf_handle_, ns_key, val);
+    if (!s.ok()) return s;
 
-  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+    return putNodes(ns_key, *metadata, "", json_val.value, batch);
+  }
+
+  return batch->Put(metadata_cf_handle_, ns_key, val);
 }
 
 rocksdb::Status Json::parse(const JsonMetadata &metadata, const Slice &json_bytes, JsonValue *value) {
@@ -79,9 +214,179 @@ rocksdb::Status Json::read(engine::Context &ctx, const Slice &ns_key, JsonMetada
   auto s = GetMetadata(ctx, {kRedisJson}, ns_key, &bytes, metadata, &rest);
   if (!s.ok()) return s;
 
+  if (metadata->IsShredded()) return readNodes(ctx, ns_key, *metadata, "", value);
   return parse(*metadata, rest, value);
 }
 
+rocksdb::Status Json::readSubtree(engine::Context &ctx, const Slice &ns_key, const std::string &path,
+                                  JsonMetadata *metadata, Subtree *subtree) {
+  std::string bytes;
+  Slice rest;
+
+  auto s = GetMetadata(ctx, {kRedisJson}, ns_key, &bytes, metadata, &rest);
+  if (!s.ok()) return s;
+
+  subtree->node.clear();
+  subtree->sparse = false;
+  subtree->path = path;
+
+  std::vector<JsonPathSegment> segments;
+  if (!metadata->IsShredded()) return parse(*metadata, rest, &subtree->value);
+  if (!ParseDefinitePath(path, &segments)) return readNodes(ctx, ns_key, *metadata, "", &subtree->value);
+
+  // walk down the object nodes along the path, until reaching a leaf node,
+  // an array index or a member which doesn't exist yet
+  size_t depth = 0;
+  while (depth < segments.size() && !segments[depth].index) {
+    std::string child = subtree->node;
+    AppendNodeSegment(&child, segments[depth].name);
+
+    std::string node_value;
+    std::string node_key = InternalKey(ns_key, child, metadata->version, storage_->IsSlotIdEncoded()).Encode();
+    s = storage_->Get(ctx, ctx.GetReadOptions(), node_key, &node_value);
+    if (s.IsNotFound()) {
+      // the rest of the path is evaluated against an object holding none of the existing members,
+      // and it yields the same as the full object since the member on the path doesn't exist
+      subtree->sparse = true;
+      subtree->path = RelativePath(segments, depth);
+      subtree->value = JsonValue(jsoncons::json(jsoncons::json_object_arg));
+      return rocksdb::Status::OK();
+    }
+    if (!s.ok()) return s;
+
+    subtree->node = std::move(child);
+    depth++;
+    if (node_value.empty() || node_value[0] != kJsonObjectNode) break;
+  }
+
+  subtree->path = RelativePath(segments, depth);
+  return readNodes(ctx, ns_key, *metadata, subtree->node, &subtree->value);
+}
+
+rocksdb::Status Json::writeSubtree(engine::Context &ctx, const Slice &ns_key, JsonMetadata *metadata,
+                                   const Subtree &subtree) {
+  if (!metadata->IsShredded() || (subtree.node.empty() && !subtree.sparse)) {
+    return write(ctx, ns_key, metadata, subtree.value);
+  }
+
+  auto batch = storage_->GetWriteBatchBase();
+  WriteBatchLogData log_data(kRedisJson);
+  auto s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return s;
+
+  if (subtree.sparse) {
+    for (const auto &member : subtree.value.value.object_range()) {
+      std::string child = subtree.node;
+      AppendNodeSegment(&child, member.key());
+      s = putNodes(ns_key, *metadata, child, member.value(), batch.Get());
+      if (!s.ok()) return s;
+    }
+  } else {
+    s = deleteNodes(ctx, ns_key, *metadata, subtree.node, batch.Get());
+    if (!s.ok()) return s;
+    s = putNodes(ns_key, *metadata, subtree.node, subtree.value.value, batch.Get());
+    if (!s.ok()) return s;
+  }
+
+  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+}
+
+rocksdb::Status Json::readNodes(engine::Context &ctx, const Slice &ns_key, const JsonMetadata &metadata,
+                                const std::string &node, JsonValue *value) {
+  std::string prefix = InternalKey(ns_key, node, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix = InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(next_version_prefix);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix);
+  read_options.iterate_lower_bound = &lower_bound;
+
+  bool found = false;
+  std::string name;
+  auto iter = util::UniqueIterator(ctx, read_options);
+  for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
+    InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
+    Slice node_value = iter->value();
+    if (node_value.empty()) return rocksdb::Status::Corruption("invalid JSON node");
+
+    jsoncons::json decoded(jsoncons::json_object_arg);
+    if (node_value[0] == kJsonLeafNode) {
+      node_value.remove_prefix(1);
+      auto res = JsonValue::FromCBOR(node_value.ToStringView());
+      if (!res) return rocksdb::Status::Corruption(res.Msg());
+      decoded = std::move(res->value);
+    } else if (node_value[0] != kJsonObjectNode) {
+      return rocksdb::Status::Corruption("invalid JSON node");
+    }
+
+    // the parents always come before their members, so every member is attached to an existing object
+    Slice segments = ikey.GetSubKey();
+    segments.remove_prefix(node.size());
+    jsoncons::json *target = &value->value;
+    while (!segments.empty()) {
+      if (!NextNodeSegment(&segments, &name)) return rocksdb::Status::Corruption("invalid JSON node path");
+      if (!target->is_object()) return rocksdb::Status::Corruption("the parent of a JSON node is not an object");
+      target = &target->try_emplace(name, jsoncons::json::null()).first->value();
+    }
+    *target = std::move(decoded);
+    found = true;
+  }
+  if (!iter->status().ok()) return iter->status();
+
+  return found ? rocksdb::Status::OK() : rocksdb::Status::NotFound();
+}
+
+rocksdb::Status Json::putNodes(const Slice &ns_key, const JsonMetadata &metadata, const std::string &node,
+                               const jsoncons::json &value, rocksdb::WriteBatchBase *batch) {
+  std::string node_value(1, kJsonLeafNode);
+  auto res = JsonValue(value).DumpCBOR(&node_value, storage_->GetConfig()->json_max_nesting_depth);
+  if (!res) return rocksdb::Status::InvalidArgument("Failed to encode JSON into storage: " + res.Msg());
+
+  std::string node_key = InternalKey(ns_key, node, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  // the root is always an object node, so that the members right under it can be updated on their own
+  if (!value.is_object() || (!node.empty() && node_value.size() < kJsonObjectNodeMinBytes)) {
+    return batch->Put(node_key, node_value);
+  }
+
+  auto s = batch->Put(node_key, std::string(1, kJsonObjectNode));
+  if (!s.ok()) return s;
+
+  for (const auto &member : value.object_range()) {
+    std::string child = node;
+    AppendNodeSegment(&child, member.key());
+    s = putNodes(ns_key, metadata, child, member.value(), batch);
+    if (!s.ok()) return s;
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status Json::deleteNodes(engine::Context &ctx, const Slice &ns_key, const JsonMetadata &metadata,
+                                  const std::string &node, rocksdb::WriteBatchBase *batch) {
+  std::string prefix = InternalKey(ns_key, node, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix = InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(next_version_prefix);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix);
+  read_options.iterate_lower_bound = &lower_bound;
+
+  // collect the keys first, since the batch may back the iterator in the transaction mode
+  std::vector<std::string> node_keys;
+  auto iter = util::UniqueIterator(ctx, read_options);
+  for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
+    node_keys.emplace_back(iter->key().ToString());
+  }
+  if (!iter->status().ok()) return iter->status();
+
+  for (const auto &node_key : node_keys) {
+    auto s = batch->Delete(node_key);
+    if (!s.ok()) return s;
+  }
+  return rocksdb::Status::OK();
+}
+
 rocksdb::Status Json::create(engine::Context &ctx, const std::string &ns_key, JsonMetadata &metadata,
                              const std::string &value) {
   auto json_res = JsonValue::FromString(value, storage_->GetConfig()->json_max_nesting_depth);
@@ -125,8 +430,8 @@ rocksdb::Status Json::Set(engine::Context &ctx, const std::string &user_key, con
   LockGuard guard(storage_->GetLockManager(), ns_key);
 
   JsonMetadata metadata;
-  JsonValue origin;
-  auto s = read(ctx, ns_key, &metadata, &origin);
+  Subtree subtree;
+  auto s = readSubtree(ctx, ns_key, path, &metadata, &subtree);
 
   if (s.IsNotFound()) {
     if (path != "$") return rocksdb::Status::InvalidArgument("new objects must be created at the root");
@@ -140,10 +445,10 @@ rocksdb::Status Json::Set(engine::Context &ctx, const std::string &user_key, con
   if (!new_res) return rocksdb::Status::InvalidArgument(new_res.Msg());
   auto new_val = *std::move(new_res);
 
-  auto set_res = origin.Set(path, std::move(new_val));
+  auto set_res = subtree.value.Set(subtree.path, std::move(new_val));
   if (!set_res) return rocksdb::Status::InvalidArgument(set_res.Msg());
 
-  return write(ctx, ns_key, &metadata, origin);
+  return writeSubtree(ctx, ns_key, &metadata, subtree);
 }
 
 rocksdb::Status Json::Get(engine::Context &ctx, const std::string &user_key, const std::vector<std::string> &paths,
@@ -151,21 +456,21 @@ rocksdb::Status Json::Get(engine::Context &ctx, const std::string &user_key, con
   auto ns_key = AppendNamespacePrefix(user_key);
 
   JsonMetadata metadata;
-  JsonValue json_val;
-  auto s = read(ctx, ns_key, &metadata, &json_val);
+  Subtree subtree;
+  auto s = readSubtree(ctx, ns_key, paths.size() == 1 ? paths[0] : "$", &metadata, &subtree);
   if (!s.ok()) return s;
 
   JsonValue res;
 
   if (paths.empty()) {
-    res = std::move(json_val);
+    res = std::move(subtree.value);
   } else if (paths.size() == 1) {
-    auto get_res = json_val.Get(paths[0]);
+    auto get_res = subtree.value.Get(subtree.path);
     if (!get_res) return rocksdb::Status::InvalidArgument(get_res.Msg());
     res = *std::move(get_res);
   } else {
     for (const auto &path : paths) {
-      auto get_res = json_val.Get(path);
+      auto get_res = subtree.value.Get(path);
       if (!get_res) return rocksdb::Status::InvalidArgument(get_res.Msg());
       res.value.insert_or_assign(path, std::move(get_res->value));
     }
@@ -191,11 +496,11 @@ rocksdb::Status Json::ArrAppend(engine::Context &ctx, const std::string &user_ke
   LockGuard guard(storage_->GetLockManager(), ns_key);
 
   JsonMetadata metadata;
-  JsonValue value;
-  auto s = read(ctx, ns_key, &metadata, &value);
+  Subtree subtree;
+  auto s = readSubtree(ctx, ns_key, path, &metadata, &subtree);
   if (!s.ok()) return s;
 
-  auto append_res = value.ArrAppend(path, append_values);
+  auto append_res = subtree.value.ArrAppend(subtree.path, append_values);
   if (!append_res) return rocksdb::Status::InvalidArgument(append_res.Msg());
   *results = std::move(*append_res);
 
@@ -203,7 +508,7 @@ rocksdb::Status Json::ArrAppend(engine::Context &ctx, const std::string &user_ke
       std::any_of(results->begin(), results->end(), [](std::optional<uint64_t> c) { return c.has_value(); });
   if (!is_write) return rocksdb::Status::OK();
 
-  return write(ctx, ns_key, &metadata, value);
+  return writeSubtree(ctx, ns_key, &metadata, subtree);
 }
 
 rocksdb::Status Json::ArrIndex(engine::Context &ctx, const std::string &user_key, const std::string &path,
@@ -215,11 +520,11 @@ rocksdb::Status Json::ArrIndex(engine::Context &ctx, const std::string &user_key
   auto needle_value = *std::move(needle_res);
 
   JsonMetadata metadata;
-  JsonValue value;
-  auto s = read(ctx, ns_key, &metadata, &value);
+  Subtree subtree;
+  auto s = readSubtree(ctx, ns_key, path, &metadata, &subtree);
   if (!s.ok()) return s;
 
-  auto index_res = value.ArrIndex(path, needle_value.value, start, end);
+  auto index_res = subtree.value.ArrIndex(subtree.path, needle_value.value, start, end);
   if (!index_res) return rocksdb::Status::InvalidArgument(index_res.Msg());
 
   *results = std::move(*index_res);
@@ -231,11 +536,11 @@ rocksdb::Status Json::Type(engine::Context &ctx, const std::string &user_key, co
   auto ns_key = AppendNamespacePrefix(user_key);
 
   JsonMetadata metadata;
-  JsonValue json_val;
-  auto s = read(ctx, ns_key, &metadata, &json_val);
+  Subtree subtree;
+  auto s = readSubtree(ctx, ns_key, path, &metadata, &subtree);
   if (!s.ok()) return s;
 
-  auto res = json_val.Type(path);
+  auto res = subtree.value.Type(subtree.path);
   if (!res) return rocksdb::Status::InvalidArgument(res.Msg());
 
   *results = *res;
@@ -249,9 +554,9 @@ rocksdb::Status Json::Merge(engine::Context &ctx, const std::string &user_key, c
   LockGuard guard(storage_->GetLockManager(), ns_key);
 
   JsonMetadata metadata;
-  JsonValue json_val;
+  Subtree subtree;
 
-  auto s = read(ctx, ns_key, &metadata, &json_val);
+  auto s = readSubtree(ctx, ns_key, path, &metadata, &subtree);
 
   if (s.IsNotFound()) {
     if (path != "$") return rocksdb::Status::InvalidArgument("new objects must be created at the root");
@@ -261,7 +566,7 @@ rocksdb::Status Json::Merge(engine::Context &ctx, const std::string &user_key, c
 
   if (!s.ok()) return s;
 
-  auto res = json_val.Merge(path, merge_value);
+  auto res = subtree.value.Merge(subtree.path, merge_value);
 
   if (!res.IsOK()) return s;
 
@@ -270,7 +575,7 @@ rocksdb::Status Json::Merge(engine::Context &ctx, const std::string &user_key, c
     return rocksdb::Status::OK();
   }
 
-  return write(ctx, ns_key, &metadata, json_val);
+  return writeSubtree(ctx, ns_key, &metadata, subtree);
 }
 
 rocksdb::Status Json::Clear(engine::Context &ctx, const std::string &user_key, const std::string &path,
@@ -279,13 +584,13 @@ rocksdb::Status Json::Clear(engine::Context &ctx, const std::string &user_key, c
 
   LockGuard guard(storage_->GetLockManager(), ns_key);
 
-  JsonValue json_val;
+  Subtree subtree;
   JsonMetadata metadata;
-  auto s = read(ctx, ns_key, &metadata, &json_val);
+  auto s = readSubtree(ctx, ns_key, path, &metadata, &subtree);
 
   if (!s.ok()) return s;
 
-  auto res = json_val.Clear(path);
+  auto res = subtree.value.Clear(subtree.path);
   if (!res) return rocksdb::Status::InvalidArgument(res.Msg());
 
   *result = *res;
@@ -293,18 +598,18 @@ rocksdb::Status Json::Clear(engine::Context &ctx, const std::string &user_key, c
     return rocksdb::Status::OK();
   }
 
-  return write(ctx, ns_key, &metadata, json_val);
+  return writeSubtree(ctx, ns_key, &metadata, subtree);
 }
 
 rocksdb::Status Json::ArrLen(engine::Context &ctx, const std::string &user_key, const std::string &path,
                              Optionals<uint64_t> *results) {
   auto ns_key = AppendNamespacePrefix(user_key);
   JsonMetadata metadata;
-  JsonValue json_val;
-  auto s = read(ctx, ns_key, &metadata, &json_val);
+  Subtree subtree;
+  auto s = readSubtree(ctx, ns_key, path, &metadata, &subtree);
   if (!s.ok()) return s;
 
-  auto len_res = json_val.ArrLen(path);
+  auto len_res = subtree.value.ArrLen(subtree.path);
   if (!len_res) return rocksdb::Status::InvalidArgument(len_res.Msg());
 
   *results = std::move(*len_res);
@@ -328,11 +633,11 @@ rocksdb::Status Json::ArrInsert(engine::Context &ctx, const std::string &user_ke
   LockGuard guard(storage_->GetLockManager(), ns_key);
 
   JsonMetadata metadata;
-  JsonValue value;
-  auto s = read(ctx, ns_key, &metadata, &value);
+  Subtree subtree;
+  auto s = readSubtree(ctx, ns_key, path, &metadata, &subtree);
   if (!s.ok()) return s;
 
-  auto insert_res = value.ArrInsert(path, index, insert_values);
+  auto insert_res = subtree.value.ArrInsert(subtree.path, index, insert_values);
   if (!insert_res) return rocksdb::Status::InvalidArgument(insert_res.Msg());
   *results = std::move(*insert_res);
 
@@ -340,7 +645,7 @@ rocksdb::Status Json::ArrInsert(engine::Context &ctx, const std::string &user_ke
       std::any_of(results->begin(), results->end(), [](std::optional<uint64_t> c) { return c.has_value(); });
   if (!is_write) return rocksdb::Status::OK();
 
-  return write(ctx, ns_key, &metadata, value);
+  return writeSubtree(ctx, ns_key, &metadata, subtree);
 }
 
 rocksdb::Status Json::Toggle(engine::Context &ctx, const std::string &user_key, const std::string &path,
@@ -350,15 +655,15 @@ rocksdb::Status Json::Toggle(engine::Context &ctx, const std::string &user_key,
   LockGuard guard(storage_->GetLockManager(), ns_key);
 
   JsonMetadata metadata;
-  JsonValue origin;
-  auto s = read(ctx, ns_key, &metadata, &origin);
+  Subtree subtree;
+  auto s = readSubtree(ctx, ns_key, path, &metadata, &subtree);
   if (!s.ok()) return s;
 
-  auto toggle_res = origin.Toggle(path);
+  auto toggle_res = subtree.value.Toggle(subtree.path);
   if (!toggle_res) return rocksdb::Status::InvalidArgument(toggle_res.Msg());
   *results = std::move(*toggle_res);
 
-  return write(ctx, ns_key, &metadata, origin);
+  return writeSubtree(ctx, ns_key, &metadata, subtree);
 }
 
 rocksdb::Status Json::ArrPop(engine::Context &ctx, const std::string &user_key, const std::string &path, int64_t index,
@@ -368,11 +673,11 @@ rocksdb::Status Json::ArrPop(engine::Context &ctx, const std::string &user_key,
   LockGuard guard(storage_->GetLockManager(), ns_key);
 
   JsonMetadata metadata;
-  JsonValue json_val;
-  auto s = read(ctx, ns_key, &metadata, &json_val);
+  Subtree subtree;
+  auto s = readSubtree(ctx, ns_key, path, &metadata, &subtree);
   if (!s.ok()) return s;
 
-  auto pop_res = json_val.ArrPop(path, index);
+  auto pop_res = subtree.value.ArrPop(subtree.path, index);
   if (!pop_res) return rocksdb::Status::InvalidArgument(pop_res.Msg());
   *results = *pop_res;
 
@@ -380,17 +685,17 @@ rocksdb::Status Json::ArrPop(engine::Context &ctx, const std::string &user_key,
                               [](const std::optional<JsonValue> &val) { return val.has_value(); });
   if (!is_write) return rocksdb::Status::OK();
 
-  return write(ctx, ns_key, &metadata, json_val);
+  return writeSubtree(ctx, ns_key, &metadata, subtree);
 }
 
 rocksdb::Status Json::ObjKeys(engine::Context &ctx, const std::string &user_key, const std::string &path,
                               Optionals<std::vector<std::string>> *keys) {
   auto ns_key = AppendNamespacePrefix(user_key);
   JsonMetadata metadata;
-  JsonValue json_val;
-  auto s = read(ctx, ns_key, &metadata, &json_val);
+  Subtree subtree;
+  auto s = readSubtree(ctx, ns_key, path, &metadata, &subtree);
   if (!s.ok()) return s;
-  auto keys_res = json_val.ObjKeys(path);
+  auto keys_res = subtree.value.ObjKeys(subtree.path);
   if (!keys_res) return rocksdb::Status::InvalidArgument(keys_res.Msg());
 
   *keys = std::move(*keys_res);
@@ -404,18 +709,18 @@ rocksdb::Status Json::ArrTrim(engine::Context &ctx, const std::string &user_key,
   LockGuard guard(storage_->GetLockManager(), ns_key);
 
   JsonMetadata metadata;
-  JsonValue json_val;
-  auto s = read(ctx, ns_key, &metadata, &json_val);
+  Subtree subtree;
+  auto s = readSubtree(ctx, ns_key, path, &metadata, &subtree);
   if (!s.ok()) return s;
 
-  auto len_res = json_val.ArrTrim(path, start, stop);
+  auto len_res = subtree.value.ArrTrim(subtree.path, start, stop);
   if (!len_res) return rocksdb::Status::InvalidArgument(len_res.Msg());
 
   *results = std::move(*len_res);
   bool is_write =
       std::any_of(results->begin(), results->end(), [](const std::optional<uint64_t> &val) { return val.has_value(); });
   if (!is_write) return rocksdb::Status::OK();
-  return write(ctx, ns_key, &metadata, json_val);
+  return writeSubtree(ctx, ns_key, &metadata, subtree);
 }
 
 rocksdb::Status Json::Del(engine::Context &ctx, const std::string &user_key, const std::string &path, size_t *result) {
@@ -423,9 +728,9 @@ rocksdb::Status Json::Del(engine::Context &ctx, const std::string &user_key, con
 
   auto ns_key = AppendNamespacePrefix(user_key);
   LockGuard guard(storage_->GetLockManager(), ns_key);
-  JsonValue json_val;
+  Subtree subtree;
   JsonMetadata metadata;
-  auto s = read(ctx, ns_key, &metadata, &json_val);
+  auto s = readSubtree(ctx, ns_key, path, &metadata, &subtree);
 
   if (!s.ok() && !s.IsNotFound()) return s;
   if (s.IsNotFound()) {
@@ -437,14 +742,28 @@ rocksdb::Status Json::Del(engine::Context &ctx, const std::string &user_key, con
     return del(ctx, ns_key);
   }
 
-  auto res = json_val.Del(path);
+  if (metadata.IsShredded() && !subtree.node.empty() && !subtree.sparse && subtree.path == "$") {
+    // the path leads right to a node, so only the nodes under it are deleted
+    auto batch = storage_->GetWriteBatchBase();
+    WriteBatchLogData log_data(kRedisJson);
+    s = batch->PutLogData(log_data.Encode());
+    if (!s.ok()) return s;
+
+    s = deleteNodes(ctx, ns_key, metadata, subtree.node, batch.Get());
+    if (!s.ok()) return s;
+
+    *result = 1;
+    return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  }
+
+  auto res = subtree.value.Del(subtree.path);
   if (!res) return rocksdb::Status::InvalidArgument(res.Msg());
 
   *result = *res;
   if (*result == 0) {
     return rocksdb::Status::OK();
   }
-  return write(ctx, ns_key, &metadata, json_val);
+  return writeSubtree(ctx, ns_key, &metadata, subtree);
 }
 
 rocksdb::Status Json::NumIncrBy(engine::Context &ctx, const std::string &user_key, const std::string &path,
@@ -467,28 +786,28 @@ rocksdb::Status Json::numop(engine::Context &ctx, JsonValue::NumOpEnum op, const
 
   auto ns_key = AppendNamespacePrefix(user_key);
   JsonMetadata metadata;
-  JsonValue json_val;
-  auto s = read(ctx, ns_key, &metadata, &json_val);
+  Subtree subtree;
+  auto s = readSubtree(ctx, ns_key, path, &metadata, &subtree);
   if (!s.ok()) return s;
 
   LockGuard guard(storage_->GetLockManager(), ns_key);
 
-  auto res = json_val.NumOp(path, number, op, result);
+  auto res = subtree.value.NumOp(subtree.path, number, op, result);
   if (!res) {
     return rocksdb::Status::InvalidArgument(res.Msg());
   }
-  return write(ctx, ns_key, &metadata, json_val);
+  return writeSubtree(ctx, ns_key, &metadata, subtree);
 }
 
 rocksdb::Status Json::StrAppend(engine::Context &ctx, const std::string &user_key, const std::string &path,
                                 const std::string &value, Optionals<uint64_t> *results) {
   auto ns_key = AppendNamespacePrefix(user_key);
   JsonMetadata metadata;
-  JsonValue json_val;
-  auto s = read(ctx, ns_key, &metadata, &json_val);
+  Subtree subtree;
+  auto s = readSubtree(ctx, ns_key, path, &metadata, &subtree);
   if (!s.ok()) return s;
 
-  auto append_res = json_val.StrAppend(path, value);
+  auto append_res = subtree.value.StrAppend(subtree.path, value);
   if (!append_res) return rocksdb::Status::InvalidArgument(append_res.Msg());
   *results = std::move(*append_res);
 
@@ -498,18 +817,18 @@ rocksdb::Status Json::StrAppend(engine::Context &ctx, const std::string &user_ke
     return rocksdb::Status::OK();
   }
 
-  return write(ctx, ns_key, &metadata, json_val);
+  return writeSubtree(ctx, ns_key, &metadata, subtree);
 }
 
 rocksdb::Status Json::StrLen(engine::Context &ctx, const std::string &user_key, const std::string &path,
                              Optionals<uint64_t> *results) {
   auto ns_key = AppendNamespacePrefix(user_key);
   JsonMetadata metadata;
-  JsonValue json_val;
-  auto s = read(ctx, ns_key, &metadata, &json_val);
+  Subtree subtree;
+  auto s = readSubtree(ctx, ns_key, path, &metadata, &subtree);
   if (!s.ok()) return s;
 
-  auto str_lens = json_val.StrLen(path);
+  auto str_lens = subtree.value.StrLen(subtree.path);
   if (!str_lens) return rocksdb::Status::InvalidArgument(str_lens.Msg());
   *results = std::move(*str_lens);
   return rocksdb::Status::OK();
@@ -519,11 +838,11 @@ rocksdb::Status Json::ObjLen(engine::Context &ctx, const std::string &user_key,
                              Optionals<uint64_t> *results) {
   auto ns_key = AppendNamespacePrefix(user_key);
   JsonMetadata metadata;
-  JsonValue json_val;
-  auto s = read(ctx, ns_key, &metadata, &json_val);
+  Subtree subtree;
+  auto s = readSubtree(ctx, ns_key, path, &metadata, &subtree);
   if (!s.ok()) return s;
 
-  auto obj_lens = json_val.ObjLen(path);
+  auto obj_lens = subtree.value.ObjLen(subtree.path);
   if (!obj_lens) return rocksdb::Status::InvalidArgument(obj_lens.Msg());
   *results = std::move(*obj_lens);
   return rocksdb::Status::OK();
@@ -595,25 +914,7 @@ rocksdb::Status Json::MSet(engine::Context &ctx, const std::vector<std::string>
       if (!set_res) return rocksdb::Status::InvalidArgument(set_res.Msg());
     }
 
-    auto format = storage_->GetConfig()->json_storage_format;
-    metadata.format = format;
-
-    std::string val;
-    metadata.Encode(&val);
-
-    Status res;
-    if (format == JsonStorageFormat::JSON) {
-      res = value.Dump(&val, storage_->GetConfig()->json_max_nesting_depth);
-    } else if (format == JsonStorageFormat::CBOR) {
-      res = value.DumpCBOR(&val, storage_->GetConfig()->json_max_nesting_depth);
-    } else {
-      return rocksdb::Status::InvalidArgument("JSON storage format not supported");
-    }
-    if (!res) {
-      return rocksdb::Status::InvalidArgument("Failed to encode JSON into storage: " + res.Msg());
-    }
-
-    s = batch->Put(metadata_cf_handle_, ns_keys[i], val);
+    s = put(ns_keys[i], &metadata, value, batch.Get());
     if (!s.ok()) return s;
   }
 
@@ -635,7 +936,11 @@ std::vector<rocksdb::Status> Json::readMulti(engine::Context &ctx, const std::ve
     statuses[i] = ParseMetadata({kRedisJson}, &rest, &metadata);
     if (!statuses[i].ok()) continue;
 
-    statuses[i] = parse(metadata, rest, &values[i]);
+    if (metadata.IsShredded()) {
+      statuses[i] = readNodes(ctx, ns_keys[i], metadata, "", &values[i]);
+    } else {
+      statuses[i] = parse(metadata, rest, &values[i]);
+    }
     if (!statuses[i].ok()) continue;
   }
   return statuses;
@@ -645,17 +950,19 @@ rocksdb::Status Json::DebugMemory(engine::Context &ctx, const std::string &user_
                                   std::vector<size_t> *results) {
   auto ns_key = AppendNamespacePrefix(user_key);
   JsonMetadata metadata;
-  if (path == "$") {
-    std::string bytes;
-    Slice rest;
-    auto s = GetMetadata(ctx, {kRedisJson}, ns_key, &bytes, &metadata, &rest);
-    if (!s.ok()) return s;
+  std::string bytes;
+  Slice rest;
+  auto s = GetMetadata(ctx, {kRedisJson}, ns_key, &bytes, &metadata, &rest);
+  if (!s.ok()) return s;
+  if (path == "$" && !metadata.IsShredded()) {
     results->emplace_back(rest.size());
   } else {
-    JsonValue json_val;
-    auto s = read(ctx, ns_key, &metadata, &json_val);
+    Subtree subtree;
+    s = readSubtree(ctx, ns_key, path, &metadata, &subtree);
     if (!s.ok()) return s;
-    auto str_bytes = json_val.GetBytes(path, metadata.format, storage_->GetConfig()->json_max_nesting_depth);
+    // the nodes of a shredded document hold the values in CBOR
+    auto format = metadata.IsShredded() ? JsonStorageFormat::CBOR : metadata.format;
+    auto str_bytes = subtree.value.GetBytes(subtree.path, format, storage_->GetConfig()->json_max_nesting_depth);
     if (!str_bytes) return rocksdb::Status::InvalidArgument(str_bytes.Msg());
     *results = std::move(*str_bytes);
   }
@@ -666,11 +973,11 @@ rocksdb::Status Json::Resp(engine::Context &ctx, const std::string &user_key, co
                            std::vector<std::string> *results, RESP resp) {
   auto ns_key = AppendNamespacePrefix(user_key);
   JsonMetadata metadata;
-  JsonValue json_val;
-  auto s = read(ctx, ns_key, &metadata, &json_val);
+  Subtree subtree;
+  auto s = readSubtree(ctx, ns_key, path, &metadata, &subtree);
   if (!s.ok()) return s;
 
-  auto json_resps = json_val.ConvertToResp(path, resp);
+  auto json_resps = subtree.value.ConvertToResp(subtree.path, resp);
   if (!json_resps) return rocksdb::Status::InvalidArgument(json_resps.Msg());
   *results = std::move(*json_resps);
   return rocksdb::Status::OK();
@@ -84,8 +84,32 @@ class Json : public Database {
                        std::vector<std::string> *results, RESP resp);
 
  private:
+  // the part of a document which a path is evaluated on, that is the whole document
+  // unless the document is shredded and the path is definite
+  struct Subtree {
+    // the node which the subtree is rooted at, empty for the root of the document
+    std::string node;
+    // the value holds none of the existing members of the node, only the ones added to it
+    bool sparse = false;
+    // the path relative to the root of the subtree
+    std::string path;
+    JsonValue value;
+  };
+
   rocksdb::Status write(engine::Context &ctx, Slice ns_key, JsonMetadata *metadata, const JsonValue &json_val);
+  rocksdb::Status put(const Slice &ns_key, JsonMetadata *metadata, const JsonValue &json_val,
+                      rocksdb::WriteBatchBase *batch);
   rocksdb::Status read(engine::Context &ctx, const Slice &ns_key, JsonMetadata *metadata, JsonValue *value);
+  rocksdb::Status readSubtree(engine::Context &ctx, const Slice &ns_key, const std::string &path,
+                              JsonMetadata *metadata, Subtree *subtree);
+  rocksdb::Status writeSubtree(engine::Context &ctx, const Slice &ns_key, JsonMetadata *metadata,
+                               const Subtree &subtree);
+  rocksdb::Status readNodes(engine::Context &ctx, const Slice &ns_key, const JsonMetadata &metadata,
+                            const std::string &node, JsonValue *value);
+  rocksdb::Status putNodes(const Slice &ns_key, const JsonMetadata &metadata, const std::string &node,
+                           const jsoncons::json &value, rocksdb::WriteBatchBase *batch);
+  rocksdb::Status deleteNodes(engine::Context &ctx, const Slice &ns_key, const JsonMetadata &metadata,
+                              const std::string &node, rocksdb::WriteBatchBase *batch);
   static rocksdb::Status parse(const JsonMetadata &metadata, const Slice &json_byt, JsonValue *value);
   rocksdb::Status create(engine::Context &ctx, const std::string &ns_key, JsonMetadata &metadata,
                          const std::string &value);
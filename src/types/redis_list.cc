@@ -20,13 +20,94 @@
 
 #include "redis_list.h"
 
+#include <algorithm>
 #include <cstdlib>
+#include <iterator>
+#include <map>
 #include <utility>
 
 #include "db_util.h"
 
 namespace redis {
 
+namespace {
+
+// the gap between the ids of the chunks created at either end of a chunked list,
+// which leaves room for the ids of the chunks split off in the middle of the list
+constexpr uint64_t kListChunkIdGap = uint64_t(1) << 20;
+// the chunk size of the existing chunked lists once list-chunk-size is set back to 0
+constexpr size_t kListDefaultChunkSize = 128;
+// a chunk is full once its elements take up this many bytes, however many elements it holds
+constexpr size_t kListChunkMaxBytes = 8 * 1024;
+// the lists up to this many elements keep all their chunks in a single group
+constexpr uint64_t kListChunkGroupMinSize = 1024;
+// the most chunk groups kept in the metadata of a list
+constexpr size_t kListMaxChunkGroups = 64;
+
+// the size over which a chunk group is split, so a list keeps at least half of the most chunk groups
+uint64_t MaxChunkGroupSize(uint64_t list_size) {
+  return std::max<uint64_t>(kListChunkGroupMinSize, list_size / (kListMaxChunkGroups / 2));
+}
+
+// the chunk group which the chunk id falls into
+size_t ChunkGroupOf(const ListMetadata &metadata, uint64_t id) {
+  const auto &groups = metadata.chunk_groups;
+  auto it = std::upper_bound(groups.begin() + 1, groups.end(), id,
+                             [](uint64_t value, const ListChunkGroup &group) { return value < group.first_id; });
+  return static_cast<size_t>(it - groups.begin()) - 1;
+}
+
+size_t ChunkBytes(const std::vector<std::string> &elems) {
+  size_t bytes = 0;
+  for (const auto &elem : elems) bytes += elem.size();
+  return bytes;
+}
+
+rocksdb::Status GetChunkLength(Slice value, uint64_t *length) {
+  uint32_t count = 0;
+  if (!GetFixed32(&value, &count)) return rocksdb::Status::Corruption("list chunk is too short");
+  *length = count;
+  return rocksdb::Status::OK();
+}
+
+uint64_t ChunkId(const Slice &key, bool slot_id_encoded) {
+  InternalKey ikey(key, slot_id_encoded);
+  Slice sub_key = ikey.GetSubKey();
+  uint64_t id = 0;
+  GetFixed64(&sub_key, &id);
+  return id;
+}
+
+uint64_t NewChunkId(ListMetadata *metadata, bool left) {
+  if (left) {
+    metadata->head -= kListChunkIdGap;
+    return metadata->head;
+  }
+  uint64_t id = metadata->tail;
+  metadata->tail += kListChunkIdGap;
+  return id;
+}
+
+// remove up to `limit` elements which are equal to `elem`, starting from the tail if `reversed`
+uint64_t RemoveElements(std::vector<std::string> *elems, const Slice &elem, uint64_t limit, bool reversed) {
+  uint64_t removed = 0;
+  std::vector<std::string> kept;
+  kept.reserve(elems->size());
+  if (reversed) std::reverse(elems->begin(), elems->end());
+  for (auto &e : *elems) {
+    if (removed < limit && elem == e) {
+      removed++;
+    } else {
+      kept.emplace_back(std::move(e));
+    }
+  }
+  if (reversed) std::reverse(kept.begin(), kept.end());
+  *elems = std::move(kept);
+  return removed;
+}
+
+}  // namespace
+
 rocksdb::Status List::GetMetadata(engine::Context &ctx, const Slice &ns_key, ListMetadata *metadata) {
   return Database::GetMetadata(ctx, {kRedisList}, ns_key, metadata);
 }
@@ -59,15 +140,36 @@ rocksdb::Status List::push(engine::Context &ctx, const Slice &user_key, const st
 
   ListMetadata metadata;
   auto batch = storage_->GetWriteBatchBase();
-  RedisCommand cmd = left ? kRedisCmdLPush : kRedisCmdRPush;
-  WriteBatchLogData log_data(kRedisList, {std::to_string(cmd)});
-  auto s = batch->PutLogData(log_data.Encode());
-  if (!s.ok()) return s;
   LockGuard guard(storage_->GetLockManager(), ns_key);
-  s = GetMetadata(ctx, ns_key, &metadata);
+  auto s = GetMetadata(ctx, ns_key, &metadata);
   if (!s.ok() && !(create_if_missing && s.IsNotFound())) {
     return s.IsNotFound() ? rocksdb::Status::OK() : s;
   }
+  if (s.IsNotFound() && storage_->GetConfig()->list_chunk_size > 0) {
+    metadata.SetChunked(true);
+  }
+
+  RedisCommand cmd = left ? kRedisCmdLPush : kRedisCmdRPush;
+  std::vector<std::string> log_args = {std::to_string(cmd)};
+  if (metadata.IsChunked()) {
+    // a chunk doesn't tell which of its elements are pushed, so record them for the write batch extractor
+    for (const auto &elem : elems) log_args.emplace_back(elem.ToString());
+  }
+  WriteBatchLogData log_data(kRedisList, std::move(log_args));
+  s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return s;
+
+  if (metadata.IsChunked()) {
+    s = pushChunked(ctx, ns_key, elems, left, &metadata, batch.Get());
+    if (!s.ok()) return s;
+    std::string bytes;
+    metadata.Encode(&bytes);
+    s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+    if (!s.ok()) return s;
+    *new_size = metadata.size;
+    return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  }
+
   uint64_t index = left ? metadata.head - 1 : metadata.tail;
   for (const auto &elem : elems) {
     std::string index_buf;
@@ -115,28 +217,38 @@ rocksdb::Status List::PopMulti(engine::Context &ctx, const rocksdb::Slice &user_
 
   auto batch = storage_->GetWriteBatchBase();
   RedisCommand cmd = left ? kRedisCmdLPop : kRedisCmdRPop;
-  WriteBatchLogData log_data(kRedisList, {std::to_string(cmd)});
+  std::vector<std::string> log_args = {std::to_string(cmd)};
+  if (metadata.IsChunked()) {
+    // a chunk doesn't tell how many of its elements are popped, so record the count for the write batch extractor
+    log_args.emplace_back(std::to_string(std::min<uint64_t>(count, metadata.size)));
+  }
+  WriteBatchLogData log_data(kRedisList, std::move(log_args));
   s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
 
-  while (metadata.size > 0 && count > 0) {
-    uint64_t index = left ? metadata.head : metadata.tail - 1;
-    std::string buf;
-    PutFixed64(&buf, index);
-    std::string sub_key = InternalKey(ns_key, buf, metadata.version, storage_->IsSlotIdEncoded()).Encode();
-    std::string elem;
-    s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &elem);
-    if (!s.ok()) {
-      // FIXME: should be always exists??
-      return s;
-    }
-
-    elems->push_back(elem);
-    s = batch->Delete(sub_key);
+  if (metadata.IsChunked()) {
+    s = popChunked(ctx, ns_key, left, count, &metadata, batch.Get(), elems);
     if (!s.ok()) return s;
-    metadata.size -= 1;
-    left ? ++metadata.head : --metadata.tail;
-    --count;
+  } else {
+    while (metadata.size > 0 && count > 0) {
+      uint64_t index = left ? metadata.head : metadata.tail - 1;
+      std::string buf;
+      PutFixed64(&buf, index);
+      std::string sub_key = InternalKey(ns_key, buf, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+      std::string elem;
+      s = storage_->Get(ctx, ctx.GetReadOptions(), sub_key, &elem);
+      if (!s.ok()) {
+        // FIXME: should be always exists??
+        return s;
+      }
+
+      elems->push_back(elem);
+      s = batch->Delete(sub_key);
+      if (!s.ok()) return s;
+      metadata.size -= 1;
+      left ? ++metadata.head : --metadata.tail;
+      --count;
+    }
   }
 
   if (metadata.size == 0) {
@@ -182,6 +294,16 @@ rocksdb::Status List::Rem(engine::Context &ctx, const Slice &user_key, int count
   rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
   if (!s.ok()) return s;
 
+  if (metadata.IsChunked() || storage_->GetConfig()->list_chunk_size > 0) {
+    auto batch = storage_->GetWriteBatchBase();
+    WriteBatchLogData log_data(kRedisList, {std::to_string(kRedisCmdLRem), std::to_string(count), elem.ToString()});
+    s = batch->PutLogData(log_data.Encode());
+    if (!s.ok()) return s;
+    s = remChunked(ctx, ns_key, count, elem, &metadata, batch.Get(), removed_cnt);
+    if (!s.ok()) return s;
+    return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  }
+
   uint64_t index = count >= 0 ? metadata.head : metadata.tail - 1;
   std::string buf;
   PutFixed64(&buf, index);
@@ -276,6 +398,19 @@ rocksdb::Status List::Insert(engine::Context &ctx, const Slice &user_key, const
   rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
   if (!s.ok()) return s;
 
+  if (metadata.IsChunked() || storage_->GetConfig()->list_chunk_size > 0) {
+    auto batch = storage_->GetWriteBatchBase();
+    WriteBatchLogData log_data(kRedisList, {std::to_string(kRedisCmdLInsert), before ? "1" : "0", pivot.ToString(),
+                                            elem.ToString()});
+    s = batch->PutLogData(log_data.Encode());
+    if (!s.ok()) return s;
+    s = insertChunked(ctx, ns_key, pivot, elem, before, &metadata, batch.Get());
+    if (s.IsNotFound()) *new_size = -1;
+    if (!s.ok()) return s;
+    *new_size = static_cast<int>(metadata.size);
+    return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  }
+
   std::string buf;
   uint64_t pivot_index = metadata.head - 1;
   PutFixed64(&buf, metadata.head);
@@ -356,6 +491,15 @@ rocksdb::Status List::Index(engine::Context &ctx, const Slice &user_key, int ind
   if (index < 0) index += static_cast<int>(metadata.size);
   if (index < 0 || index >= static_cast<int>(metadata.size)) return rocksdb::Status::NotFound();
 
+  if (metadata.IsChunked()) {
+    Chunk chunk;
+    uint64_t offset = 0;
+    s = locateChunk(ctx, ns_key, metadata, index, &chunk, &offset);
+    if (!s.ok()) return s;
+    *elem = std::move(chunk.elems[offset]);
+    return rocksdb::Status::OK();
+  }
+
   std::string buf;
   PutFixed64(&buf, metadata.head + index);
   std::string sub_key = InternalKey(ns_key, buf, metadata.version, storage_->IsSlotIdEncoded()).Encode();
@@ -381,6 +525,12 @@ rocksdb::Status List::Range(engine::Context &ctx, const Slice &user_key, int sta
   if (start > static_cast<int>(metadata.size) || stop < 0 || start > stop) return rocksdb::Status::OK();
   if (start < 0) start = 0;
 
+  if (metadata.IsChunked()) {
+    auto last = static_cast<int>(metadata.size) - 1;
+    if (start > last) return rocksdb::Status::OK();
+    return rangeChunked(ctx, ns_key, metadata, start, std::min(stop, last), elems);
+  }
+
   std::string buf;
   PutFixed64(&buf, metadata.head + start);
   std::string start_key = InternalKey(ns_key, buf, metadata.version, storage_->IsSlotIdEncoded()).Encode();
@@ -413,6 +563,8 @@ rocksdb::Status List::Pos(engine::Context &ctx, const Slice &user_key, const Sli
   rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
   if (!s.ok()) return s;
 
+  if (metadata.IsChunked()) return posChunked(ctx, ns_key, metadata, elem, spec, indexes);
+
   // A negative rank means start from the tail.
   int64_t rank = spec.rank;
   uint64_t start = metadata.head;
@@ -471,6 +623,24 @@ rocksdb::Status List::Set(engine::Context &ctx, const Slice &user_key, int index
     return rocksdb::Status::InvalidArgument("index out of range");
   }
 
+  if (metadata.IsChunked()) {
+    Chunk chunk;
+    uint64_t offset = 0;
+    s = locateChunk(ctx, ns_key, metadata, index, &chunk, &offset);
+    if (!s.ok()) return s;
+    if (chunk.elems[offset] == elem) return rocksdb::Status::OK();
+    chunk.elems[offset] = elem.ToString();
+
+    auto batch = storage_->GetWriteBatchBase();
+    // the new element is recorded since the write batch extractor can't pick it out of the chunk
+    WriteBatchLogData log_data(kRedisList, {std::to_string(kRedisCmdLSet), std::to_string(index), elem.ToString()});
+    s = batch->PutLogData(log_data.Encode());
+    if (!s.ok()) return s;
+    s = putChunk(ns_key, &metadata, chunk, batch.Get());
+    if (!s.ok()) return s;
+    return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  }
+
   std::string buf, value;
   PutFixed64(&buf, metadata.head + index);
   std::string sub_key = InternalKey(ns_key, buf, metadata.version, storage_->IsSlotIdEncoded()).Encode();
@@ -510,6 +680,10 @@ rocksdb::Status List::lmoveOnSingleList(engine::Context &ctx, const rocksdb::Sli
 
   elem->clear();
 
+  if (metadata.IsChunked()) {
+    return lmoveOnSingleChunkedList(ctx, src, ns_key, src_left, dst_left, &metadata, elem);
+  }
+
   uint64_t curr_index = src_left ? metadata.head : metadata.tail - 1;
   std::string curr_index_buf;
   PutFixed64(&curr_index_buf, curr_index);
@@ -580,6 +754,9 @@ rocksdb::Status List::lmoveOnTwoLists(engine::Context &ctx, const rocksdb::Slice
   if (!s.ok() && !s.IsNotFound()) {
     return s;
   }
+  if (s.IsNotFound() && storage_->GetConfig()->list_chunk_size > 0) {
+    dst_metadata.SetChunked(true);
+  }
 
   elem->clear();
 
@@ -589,41 +766,55 @@ rocksdb::Status List::lmoveOnTwoLists(engine::Context &ctx, const rocksdb::Slice
   s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
 
-  uint64_t src_index = src_left ? src_metadata.head : src_metadata.tail - 1;
-  std::string src_buf;
-  PutFixed64(&src_buf, src_index);
-  std::string src_sub_key =
-      InternalKey(src_ns_key, src_buf, src_metadata.version, storage_->IsSlotIdEncoded()).Encode();
-  s = storage_->Get(ctx, ctx.GetReadOptions(), src_sub_key, elem);
-  if (!s.ok()) {
-    return s;
+  if (src_metadata.IsChunked()) {
+    std::vector<std::string> elems;
+    s = popChunked(ctx, src_ns_key, src_left, 1, &src_metadata, batch.Get(), &elems);
+    if (!s.ok()) return s;
+    if (elems.empty()) return rocksdb::Status::Corruption("list chunks are inconsistent with the metadata");
+    *elem = std::move(elems[0]);
+  } else {
+    uint64_t src_index = src_left ? src_metadata.head : src_metadata.tail - 1;
+    std::string src_buf;
+    PutFixed64(&src_buf, src_index);
+    std::string src_sub_key =
+        InternalKey(src_ns_key, src_buf, src_metadata.version, storage_->IsSlotIdEncoded()).Encode();
+    s = storage_->Get(ctx, ctx.GetReadOptions(), src_sub_key, elem);
+    if (!s.ok()) {
+      return s;
+    }
+
+    s = batch->Delete(src_sub_key);
+    if (!s.ok()) return s;
+    src_metadata.size -= 1;
+    src_left ? ++src_metadata.head : --src_metadata.tail;
   }
 
-  s = batch->Delete(src_sub_key);
-  if (!s.ok()) return s;
-  if (src_metadata.size == 1) {
+  if (src_metadata.size == 0) {
     s = batch->Delete(metadata_cf_handle_, src_ns_key);
     if (!s.ok()) return s;
   } else {
     std::string bytes;
-    src_metadata.size -= 1;
-    src_left ? ++src_metadata.head : --src_metadata.tail;
     src_metadata.Encode(&bytes);
     s = batch->Put(metadata_cf_handle_, src_ns_key, bytes);
     if (!s.ok()) return s;
   }
 
-  uint64_t dst_index = dst_left ? dst_metadata.head - 1 : dst_metadata.tail;
-  std::string dst_buf;
-  PutFixed64(&dst_buf, dst_index);
-  std::string dst_sub_key =
-      InternalKey(dst_ns_key, dst_buf, dst_metadata.version, storage_->IsSlotIdEncoded()).Encode();
-  s = batch->Put(dst_sub_key, *elem);
-  if (!s.ok()) return s;
-  dst_left ? --dst_metadata.head : ++dst_metadata.tail;
+  if (dst_metadata.IsChunked()) {
+    s = pushChunked(ctx, dst_ns_key, {*elem}, dst_left, &dst_metadata, batch.Get());
+    if (!s.ok()) return s;
+  } else {
+    uint64_t dst_index = dst_left ? dst_metadata.head - 1 : dst_metadata.tail;
+    std::string dst_buf;
+    PutFixed64(&dst_buf, dst_index);
+    std::string dst_sub_key =
+        InternalKey(dst_ns_key, dst_buf, dst_metadata.version, storage_->IsSlotIdEncoded()).Encode();
+    s = batch->Put(dst_sub_key, *elem);
+    if (!s.ok()) return s;
+    dst_left ? --dst_metadata.head : ++dst_metadata.tail;
+    dst_metadata.size += 1;
+  }
 
   std::string bytes;
-  dst_metadata.size += 1;
   dst_metadata.Encode(&bytes);
   s = batch->Put(metadata_cf_handle_, dst_ns_key, bytes);
   if (!s.ok()) return s;
@@ -655,6 +846,16 @@ rocksdb::Status List::Trim(engine::Context &ctx, const Slice &user_key, int star
                                                                   std::to_string(stop)});
   s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
+
+  if (metadata.IsChunked()) {
+    if (static_cast<uint64_t>(start) >= metadata.size) {
+      s = batch->Delete(metadata_cf_handle_, ns_key);
+    } else {
+      s = trimChunked(ctx, ns_key, start, std::min<uint64_t>(stop, metadata.size - 1), &metadata, batch.Get());
+    }
+    if (!s.ok()) return s;
+    return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+  }
   uint64_t left_index = metadata.head + start;
   uint64_t right_index = metadata.head + stop + 1;
   for (uint64_t i = metadata.head; i < left_index; i++) {
@@ -687,4 +888,697 @@ rocksdb::Status List::Trim(engine::Context &ctx, const Slice &user_key, int star
   if (!s.ok()) return s;
   return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
 }
+
+void List::EncodeChunk(const std::vector<std::string> &elems, std::string *value) {
+  value->clear();
+  PutFixed32(value, static_cast<uint32_t>(elems.size()));
+  for (const auto &elem : elems) {
+    PutSizedString(value, elem);
+  }
+}
+
+rocksdb::Status List::DecodeChunk(Slice value, std::vector<std::string> *elems) {
+  elems->clear();
+  uint32_t count = 0;
+  if (!GetFixed32(&value, &count)) return rocksdb::Status::Corruption("list chunk is too short");
+  elems->reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    Slice elem;
+    if (!GetSizedString(&value, &elem)) return rocksdb::Status::Corruption("list chunk is too short");
+    elems->emplace_back(elem.ToString());
+  }
+  return rocksdb::Status::OK();
+}
+
+size_t List::chunkSize() const {
+  auto chunk_size = storage_->GetConfig()->list_chunk_size;
+  return chunk_size > 0 ? static_cast<size_t>(chunk_size) : kListDefaultChunkSize;
+}
+
+bool List::chunkHasRoom(const std::vector<std::string> &elems, const Slice &elem) const {
+  return elems.empty() || (elems.size() < chunkSize() && ChunkBytes(elems) + elem.size() <= kListChunkMaxBytes);
+}
+
+bool List::chunkOverflows(const std::vector<std::string> &elems) const {
+  return elems.size() > 1 && (elems.size() > chunkSize() || ChunkBytes(elems) > kListChunkMaxBytes);
+}
+
+std::string List::chunkKey(const Slice &ns_key, const ListMetadata &metadata, uint64_t id) const {
+  std::string buf;
+  PutFixed64(&buf, id);
+  return InternalKey(ns_key, buf, metadata.version, storage_->IsSlotIdEncoded()).Encode();
+}
+
+rocksdb::Status List::decodeChunk(const rocksdb::Iterator &iter, Chunk *chunk) const {
+  chunk->id = ChunkId(iter.key(), storage_->IsSlotIdEncoded());
+  auto s = DecodeChunk(iter.value(), &chunk->elems);
+  chunk->length = chunk->elems.size();
+  return s;
+}
+
+rocksdb::Status List::putChunk(const Slice &ns_key, ListMetadata *metadata, const Chunk &chunk,
+                               rocksdb::WriteBatchBase *batch) {
+  auto &group = metadata->chunk_groups[ChunkGroupOf(*metadata, chunk.id)];
+  group.size = group.size + chunk.elems.size() - chunk.length;
+
+  std::string sub_key = chunkKey(ns_key, *metadata, chunk.id);
+  if (chunk.elems.empty()) return batch->Delete(sub_key);
+  std::string value;
+  EncodeChunk(chunk.elems, &value);
+  return batch->Put(sub_key, value);
+}
+
+rocksdb::Status List::getEndChunk(engine::Context &ctx, const Slice &ns_key, const ListMetadata &metadata, bool left,
+                                  Chunk *chunk) {
+  std::string prefix = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix = InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(next_version_prefix);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix);
+  read_options.iterate_lower_bound = &lower_bound;
+
+  auto iter = util::UniqueIterator(ctx, read_options);
+  left ? iter->SeekToFirst() : iter->SeekToLast();
+  if (!iter->Valid()) return iter->status().ok() ? rocksdb::Status::NotFound() : iter->status();
+  return decodeChunk(*iter, chunk);
+}
+
+// Find the chunk which holds the element at `index`, the chunk groups are walked from the nearer end of the list
+// to find the group holding it, then the chunks of that group from the nearer end of the group
+rocksdb::Status List::locateChunk(engine::Context &ctx, const Slice &ns_key, const ListMetadata &metadata,
+                                  uint64_t index, Chunk *chunk, uint64_t *offset) {
+  const auto &groups = metadata.chunk_groups;
+  size_t group = 0;
+  uint64_t group_start = 0;
+  if (index < metadata.size / 2) {
+    while (group + 1 < groups.size() && group_start + groups[group].size <= index) {
+      group_start += groups[group++].size;
+    }
+  } else {
+    group = groups.size() - 1;
+    group_start = metadata.size - groups[group].size;
+    while (group > 0 && index < group_start) {
+      group_start -= groups[--group].size;
+    }
+  }
+  if (index < group_start || index - group_start >= groups[group].size) {
+    return rocksdb::Status::Corruption("list chunk groups are inconsistent with the metadata");
+  }
+
+  std::string group_begin = chunkKey(ns_key, metadata, groups[group].first_id);
+  std::string group_end = group + 1 < groups.size()
+                              ? chunkKey(ns_key, metadata, groups[group + 1].first_id)
+                              : InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(group_end);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(group_begin);
+  read_options.iterate_lower_bound = &lower_bound;
+
+  bool reversed = index - group_start >= groups[group].size / 2;
+  uint64_t chunk_start = reversed ? group_start + groups[group].size : group_start;
+  auto iter = util::UniqueIterator(ctx, read_options);
+  for (reversed ? iter->SeekToLast() : iter->SeekToFirst(); iter->Valid(); reversed ? iter->Prev() : iter->Next()) {
+    uint64_t length = 0;
+    auto s = GetChunkLength(iter->value(), &length);
+    if (!s.ok()) return s;
+    if (reversed) {
+      if (chunk_start < length) break;
+      chunk_start -= length;
+    }
+    if (chunk_start <= index && index < chunk_start + length) {
+      *offset = index - chunk_start;
+      return decodeChunk(*iter, chunk);
+    }
+    if (!reversed) chunk_start += length;
+  }
+  if (!iter->status().ok()) return iter->status();
+  return rocksdb::Status::Corruption("list chunks are inconsistent with the metadata");
+}
+
+// Keep the chunk groups of a large list small, so locateChunk() only reads a few chunks: the groups over
+// the max size are cut into pieces at their chunks, and the adjacent groups with the fewest elements are
+// merged once there are too many groups. It's done before a write changes any chunk, so the chunks read
+// here agree with the chunk groups of the metadata.
+rocksdb::Status List::balanceChunkGroups(engine::Context &ctx, const Slice &ns_key, ListMetadata *metadata) {
+  auto &groups = metadata->chunk_groups;
+  if (metadata->size <= kListChunkGroupMinSize) {
+    groups = {{0, metadata->size}};
+    return rocksdb::Status::OK();
+  }
+
+  // drop the empty groups, the first group always starts from id 0
+  for (size_t i = groups.size() - 1; i > 0; i--) {
+    if (groups[i].size == 0) groups.erase(groups.begin() + static_cast<int64_t>(i));
+  }
+  if (groups.size() > 1 && groups[0].size == 0) {
+    groups.erase(groups.begin());
+    groups[0].first_id = 0;
+  }
+
+  uint64_t max_group_size = MaxChunkGroupSize(metadata->size);
+  if (groups.size() <= kListMaxChunkGroups &&
+      std::all_of(groups.begin(), groups.end(),
+                  [max_group_size](const ListChunkGroup &group) { return group.size <= max_group_size; })) {
+    return rocksdb::Status::OK();
+  }
+
+  std::string prefix = InternalKey(ns_key, "", metadata->version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix =
+      InternalKey(ns_key, "", metadata->version + 1, storage_->IsSlotIdEncoded()).Encode();
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(next_version_prefix);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix);
+  read_options.iterate_lower_bound = &lower_bound;
+
+  std::vector<ListChunkGroup> balanced;
+  auto iter = util::UniqueIterator(ctx, read_options);
+  for (size_t i = 0; i < groups.size(); i++) {
+    if (groups[i].size <= max_group_size) {
+      balanced.emplace_back(groups[i]);
+      continue;
+    }
+
+    uint64_t total = 0;
+    balanced.push_back({groups[i].first_id, 0});
+    for (iter->Seek(chunkKey(ns_key, *metadata, groups[i].first_id)); iter->Valid(); iter->Next()) {
+      uint64_t id = ChunkId(iter->key(), storage_->IsSlotIdEncoded());
+      if (i + 1 < groups.size() && id >= groups[i + 1].first_id) break;
+      uint64_t length = 0;
+      auto s = GetChunkLength(iter->value(), &length);
+      if (!s.ok()) return s;
+      if (balanced.back().size >= max_group_size / 2) balanced.push_back({id, 0});
+      balanced.back().size += length;
+      total += length;
+    }
+    if (!iter->status().ok()) return iter->status();
+    if (total != groups[i].size) {
+      return rocksdb::Status::Corruption("list chunk groups are inconsistent with the chunks");
+    }
+  }
+
+  while (balanced.size() > kListMaxChunkGroups) {
+    size_t merged = 1;
+    for (size_t i = 2; i < balanced.size(); i++) {
+      if (balanced[i - 1].size + balanced[i].size < balanced[merged - 1].size + balanced[merged].size) merged = i;
+    }
+    balanced[merged - 1].size += balanced[merged].size;
+    balanced.erase(balanced.begin() + static_cast<int64_t>(merged));
+  }
+  groups = std::move(balanced);
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status List::getAllElements(engine::Context &ctx, const Slice &ns_key, const ListMetadata &metadata,
+                                     std::vector<std::string> *elems) {
+  elems->clear();
+
+  std::string prefix = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix = InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(next_version_prefix);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix);
+  read_options.iterate_lower_bound = &lower_bound;
+
+  elems->reserve(metadata.size);
+  std::vector<std::string> chunk_elems;
+  auto iter = util::UniqueIterator(ctx, read_options);
+  for (iter->Seek(prefix); iter->Valid(); iter->Next()) {
+    if (!metadata.IsChunked()) {
+      elems->emplace_back(iter->value().ToString());
+      continue;
+    }
+    auto s = DecodeChunk(iter->value(), &chunk_elems);
+    if (!s.ok()) return s;
+    std::move(chunk_elems.begin(), chunk_elems.end(), std::back_inserter(*elems));
+  }
+  return iter->status();
+}
+
+// Write the elements as a chunked list with a new version, the subkeys of the previous
+// version are then dropped by the compaction filter instead of being deleted one by one
+rocksdb::Status List::rewriteAsChunks(const Slice &ns_key, const std::vector<std::string> &elems,
+                                      ListMetadata *metadata, rocksdb::WriteBatchBase *batch) {
+  ListMetadata new_metadata;
+  new_metadata.expire = metadata->expire;
+  new_metadata.SetChunked(true);
+
+  // the chunk groups are cut while the chunks are written, since they are all known here
+  uint64_t max_group_size = MaxChunkGroupSize(elems.size());
+  Chunk chunk{NewChunkId(&new_metadata, false), {}};
+  for (const auto &elem : elems) {
+    if (!chunkHasRoom(chunk.elems, elem)) {
+      auto s = putChunk(ns_key, &new_metadata, chunk, batch);
+      if (!s.ok()) return s;
+      chunk = Chunk{NewChunkId(&new_metadata, false), {}};
+      if (elems.size() > kListChunkGroupMinSize && new_metadata.chunk_groups.back().size >= max_group_size / 2) {
+        new_metadata.chunk_groups.push_back({chunk.id, 0});
+      }
+    }
+    chunk.elems.emplace_back(elem);
+  }
+  auto s = putChunk(ns_key, &new_metadata, chunk, batch);
+  if (!s.ok()) return s;
+
+  new_metadata.size = elems.size();
+  *metadata = new_metadata;
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status List::pushChunked(engine::Context &ctx, const Slice &ns_key, const std::vector<Slice> &elems,
+                                  bool left, ListMetadata *metadata, rocksdb::WriteBatchBase *batch) {
+  auto s = balanceChunkGroups(ctx, ns_key, metadata);
+  if (!s.ok()) return s;
+
+  Chunk chunk;
+  s = getEndChunk(ctx, ns_key, *metadata, left, &chunk);
+  if (s.IsNotFound()) {
+    chunk.id = NewChunkId(metadata, left);
+  } else if (!s.ok()) {
+    return s;
+  }
+
+  for (const auto &elem : elems) {
+    if (!chunkHasRoom(chunk.elems, elem)) {
+      s = putChunk(ns_key, metadata, chunk, batch);
+      if (!s.ok()) return s;
+      chunk = Chunk{NewChunkId(metadata, left), {}};
+    }
+    if (left) {
+      chunk.elems.insert(chunk.elems.begin(), elem.ToString());
+    } else {
+      chunk.elems.emplace_back(elem.ToString());
+    }
+  }
+  s = putChunk(ns_key, metadata, chunk, batch);
+  if (!s.ok()) return s;
+
+  metadata->size += elems.size();
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status List::popChunked(engine::Context &ctx, const Slice &ns_key, bool left, uint64_t count,
+                                 ListMetadata *metadata, rocksdb::WriteBatchBase *batch,
+                                 std::vector<std::string> *elems) {
+  auto s = balanceChunkGroups(ctx, ns_key, metadata);
+  if (!s.ok()) return s;
+
+  std::string prefix = InternalKey(ns_key, "", metadata->version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix =
+      InternalKey(ns_key, "", metadata->version + 1, storage_->IsSlotIdEncoded()).Encode();
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(next_version_prefix);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix);
+  read_options.iterate_lower_bound = &lower_bound;
+
+  // the touched chunks are written after the iteration, since the iterator may be built upon the write batch
+  std::vector<Chunk> chunks;
+  uint64_t popped = 0;
+  auto iter = util::UniqueIterator(ctx, read_options);
+  for (left ? iter->SeekToFirst() : iter->SeekToLast(); iter->Valid() && popped < count;
+       left ? iter->Next() : iter->Prev()) {
+    Chunk chunk;
+    s = decodeChunk(*iter, &chunk);
+    if (!s.ok()) return s;
+
+    uint64_t n = std::min<uint64_t>(count - popped, chunk.elems.size());
+    if (left) {
+      std::move(chunk.elems.begin(), chunk.elems.begin() + static_cast<int64_t>(n), std::back_inserter(*elems));
+      chunk.elems.erase(chunk.elems.begin(), chunk.elems.begin() + static_cast<int64_t>(n));
+    } else {
+      for (uint64_t i = 0; i < n; i++) {
+        elems->emplace_back(std::move(chunk.elems.back()));
+        chunk.elems.pop_back();
+      }
+    }
+    popped += n;
+    chunks.emplace_back(std::move(chunk));
+  }
+  if (!iter->status().ok()) return iter->status();
+
+  for (const auto &chunk : chunks) {
+    s = putChunk(ns_key, metadata, chunk, batch);
+    if (!s.ok()) return s;
+  }
+  metadata->size -= popped;
+  return rocksdb::Status::OK();
+}
+
+// LRem on a chunked list only rewrites the chunks which hold the removed elements,
+// the lists in the previous encoding are converted into chunks since they need a full rewrite anyway
+rocksdb::Status List::remChunked(engine::Context &ctx, const Slice &ns_key, int count, const Slice &elem,
+                                 ListMetadata *metadata, rocksdb::WriteBatchBase *batch, uint64_t *removed_cnt) {
+  bool reversed = count < 0;
+  uint64_t limit = count == 0 ? metadata->size : static_cast<uint64_t>(std::abs(static_cast<int64_t>(count)));
+
+  if (!metadata->IsChunked()) {
+    std::vector<std::string> elems;
+    auto s = getAllElements(ctx, ns_key, *metadata, &elems);
+    if (!s.ok()) return s;
+    uint64_t removed = RemoveElements(&elems, elem, limit, reversed);
+    if (removed == 0) return rocksdb::Status::NotFound();
+
+    *removed_cnt = removed;
+    if (elems.empty()) return batch->Delete(metadata_cf_handle_, ns_key);
+    s = rewriteAsChunks(ns_key, elems, metadata, batch);
+    if (!s.ok()) return s;
+  } else {
+    auto s = balanceChunkGroups(ctx, ns_key, metadata);
+    if (!s.ok()) return s;
+
+    std::string prefix = InternalKey(ns_key, "", metadata->version, storage_->IsSlotIdEncoded()).Encode();
+    std::string next_version_prefix =
+        InternalKey(ns_key, "", metadata->version + 1, storage_->IsSlotIdEncoded()).Encode();
+
+    rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+    rocksdb::Slice upper_bound(next_version_prefix);
+    read_options.iterate_upper_bound = &upper_bound;
+    rocksdb::Slice lower_bound(prefix);
+    read_options.iterate_lower_bound = &lower_bound;
+
+    std::vector<Chunk> chunks;
+    uint64_t removed = 0;
+    auto iter = util::UniqueIterator(ctx, read_options);
+    for (reversed ? iter->SeekToLast() : iter->SeekToFirst(); iter->Valid() && removed < limit;
+         reversed ? iter->Prev() : iter->Next()) {
+      Chunk chunk;
+      s = decodeChunk(*iter, &chunk);
+      if (!s.ok()) return s;
+      uint64_t n = RemoveElements(&chunk.elems, elem, limit - removed, reversed);
+      if (n == 0) continue;
+      removed += n;
+      chunks.emplace_back(std::move(chunk));
+    }
+    if (!iter->status().ok()) return iter->status();
+    if (removed == 0) return rocksdb::Status::NotFound();
+
+    *removed_cnt = removed;
+    if (removed == metadata->size) return batch->Delete(metadata_cf_handle_, ns_key);
+    for (const auto &chunk : chunks) {
+      s = putChunk(ns_key, metadata, chunk, batch);
+      if (!s.ok()) return s;
+    }
+    metadata->size -= removed;
+  }
+
+  std::string bytes;
+  metadata->Encode(&bytes);
+  return batch->Put(metadata_cf_handle_, ns_key, bytes);
+}
+
+// LInsert on a chunked list only rewrites the chunk of the pivot, which is split in two once it overflows,
+// the lists in the previous encoding are converted into chunks since they need a full rewrite anyway
+rocksdb::Status List::insertChunked(engine::Context &ctx, const Slice &ns_key, const Slice &pivot, const Slice &elem,
+                                    bool before, ListMetadata *metadata, rocksdb::WriteBatchBase *batch) {
+  auto rewrite = [&, this]() -> rocksdb::Status {
+    std::vector<std::string> elems;
+    auto s = getAllElements(ctx, ns_key, *metadata, &elems);
+    if (!s.ok()) return s;
+    auto it = std::find_if(elems.begin(), elems.end(), [&pivot](const std::string &e) { return pivot == e; });
+    if (it == elems.end()) return rocksdb::Status::NotFound();
+    elems.insert(before ? it : it + 1, elem.ToString());
+    return rewriteAsChunks(ns_key, elems, metadata, batch);
+  };
+
+  rocksdb::Status s;
+  if (!metadata->IsChunked()) {
+    s = rewrite();
+  } else {
+    s = balanceChunkGroups(ctx, ns_key, metadata);
+    if (!s.ok()) return s;
+
+    std::string prefix = InternalKey(ns_key, "", metadata->version, storage_->IsSlotIdEncoded()).Encode();
+    std::string next_version_prefix =
+        InternalKey(ns_key, "", metadata->version + 1, storage_->IsSlotIdEncoded()).Encode();
+
+    rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+    rocksdb::Slice upper_bound(next_version_prefix);
+    read_options.iterate_upper_bound = &upper_bound;
+    rocksdb::Slice lower_bound(prefix);
+    read_options.iterate_lower_bound = &lower_bound;
+
+    Chunk chunk;
+    uint64_t next_id = metadata->tail;
+    bool found = false;
+    auto iter = util::UniqueIterator(ctx, read_options);
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      s = decodeChunk(*iter, &chunk);
+      if (!s.ok()) return s;
+      auto it = std::find_if(chunk.elems.begin(), chunk.elems.end(),
+                             [&pivot](const std::string &e) { return pivot == e; });
+      if (it == chunk.elems.end()) continue;
+
+      found = true;
+      chunk.elems.insert(before ? it : it + 1, elem.ToString());
+      iter->Next();
+      if (iter->Valid()) next_id = ChunkId(iter->key(), storage_->IsSlotIdEncoded());
+      break;
+    }
+    if (!iter->status().ok()) return iter->status();
+    if (!found) return rocksdb::Status::NotFound();
+
+    if (!chunkOverflows(chunk.elems)) {
+      s = putChunk(ns_key, metadata, chunk, batch);
+      metadata->size++;
+    } else if (next_id - chunk.id < 2) {
+      // no id is left between the chunk and its successor, so renumber all the chunks
+      s = rewrite();
+    } else {
+      auto half = static_cast<int64_t>(chunk.elems.size() / 2);
+      Chunk split{chunk.id + (next_id - chunk.id) / 2,
+                  std::vector<std::string>(std::make_move_iterator(chunk.elems.begin() + half),
+                                           std::make_move_iterator(chunk.elems.end()))};
+      chunk.elems.resize(half);
+      s = putChunk(ns_key, metadata, chunk, batch);
+      if (!s.ok()) return s;
+      s = putChunk(ns_key, metadata, split, batch);
+      metadata->size++;
+    }
+  }
+  if (!s.ok()) return s;
+
+  std::string bytes;
+  metadata->Encode(&bytes);
+  return batch->Put(metadata_cf_handle_, ns_key, bytes);
+}
+
+// Keep the elements in [start, stop], only the chunks out of the range are read from either end of the list
+rocksdb::Status List::trimChunked(engine::Context &ctx, const Slice &ns_key, uint64_t start, uint64_t stop,
+                                  ListMetadata *metadata, rocksdb::WriteBatchBase *batch) {
+  auto s = balanceChunkGroups(ctx, ns_key, metadata);
+  if (!s.ok()) return s;
+
+  std::string prefix = InternalKey(ns_key, "", metadata->version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix =
+      InternalKey(ns_key, "", metadata->version + 1, storage_->IsSlotIdEncoded()).Encode();
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(next_version_prefix);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix);
+  read_options.iterate_lower_bound = &lower_bound;
+
+  // the touched chunks with their remaining elements, keyed by chunk id
+  std::map<uint64_t, Chunk> chunks;
+  auto iter = util::UniqueIterator(ctx, read_options);
+  auto trim = [&, this](uint64_t chunk_start, uint64_t *length) -> rocksdb::Status {
+    Chunk chunk;
+    auto s = decodeChunk(*iter, &chunk);
+    if (!s.ok()) return s;
+    *length = chunk.length;
+    uint64_t chunk_end = chunk_start + chunk.length;
+    auto lo = static_cast<int64_t>(std::clamp(start, chunk_start, chunk_end) - chunk_start);
+    auto hi = static_cast<int64_t>(std::clamp(stop + 1, chunk_start, chunk_end) - chunk_start);
+    chunk.elems = std::vector<std::string>(std::make_move_iterator(chunk.elems.begin() + lo),
+                                           std::make_move_iterator(chunk.elems.begin() + hi));
+    chunks[chunk.id] = std::move(chunk);
+    return rocksdb::Status::OK();
+  };
+
+  uint64_t chunk_start = 0;
+  for (iter->SeekToFirst(); iter->Valid() && chunk_start < start; iter->Next()) {
+    uint64_t length = 0;
+    s = trim(chunk_start, &length);
+    if (!s.ok()) return s;
+    chunk_start += length;
+  }
+  if (!iter->status().ok()) return iter->status();
+
+  uint64_t chunk_end = metadata->size;
+  for (iter->SeekToLast(); iter->Valid() && chunk_end > stop + 1; iter->Prev()) {
+    uint64_t length = 0;
+    // a chunk of the front may be trimmed again here, which is fine since both ends of the range are applied
+    s = GetChunkLength(iter->value(), &length);
+    if (!s.ok()) return s;
+    if (chunk_end < length) return rocksdb::Status::Corruption("list chunks are inconsistent with the metadata");
+    s = trim(chunk_end - length, &length);
+    if (!s.ok()) return s;
+    chunk_end -= length;
+  }
+  if (!iter->status().ok()) return iter->status();
+
+  for (const auto &[id, chunk] : chunks) {
+    s = putChunk(ns_key, metadata, chunk, batch);
+    if (!s.ok()) return s;
+  }
+  metadata->size = stop - start + 1;
+  std::string bytes;
+  metadata->Encode(&bytes);
+  return batch->Put(metadata_cf_handle_, ns_key, bytes);
+}
+
+rocksdb::Status List::rangeChunked(engine::Context &ctx, const Slice &ns_key, const ListMetadata &metadata,
+                                   uint64_t start, uint64_t stop, std::vector<std::string> *elems) {
+  Chunk chunk;
+  uint64_t offset = 0;
+  auto s = locateChunk(ctx, ns_key, metadata, start, &chunk, &offset);
+  if (!s.ok()) return s;
+
+  std::string start_key = chunkKey(ns_key, metadata, chunk.id);
+  std::string next_version_prefix = InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(next_version_prefix);
+  read_options.iterate_upper_bound = &upper_bound;
+
+  uint64_t n = stop - start + 1;
+  elems->reserve(n);
+  std::move(chunk.elems.begin() + static_cast<int64_t>(offset),
+            chunk.elems.begin() + static_cast<int64_t>(std::min<uint64_t>(chunk.elems.size(), offset + n)),
+            std::back_inserter(*elems));
+
+  auto iter = util::UniqueIterator(ctx, read_options);
+  iter->Seek(start_key);
+  if (iter->Valid()) iter->Next();
+  for (; iter->Valid() && elems->size() < n; iter->Next()) {
+    s = DecodeChunk(iter->value(), &chunk.elems);
+    if (!s.ok()) return s;
+    auto take = static_cast<int64_t>(std::min<uint64_t>(chunk.elems.size(), n - elems->size()));
+    std::move(chunk.elems.begin(), chunk.elems.begin() + take, std::back_inserter(*elems));
+  }
+  return iter->status();
+}
+
+rocksdb::Status List::posChunked(engine::Context &ctx, const Slice &ns_key, const ListMetadata &metadata,
+                                 const Slice &elem, const PosSpec &spec, std::vector<int64_t> *indexes) {
+  // A negative rank means start from the tail.
+  int64_t rank = spec.rank;
+  bool reversed = false;
+  if (rank < 0) {
+    rank = -rank;
+    reversed = true;
+  }
+
+  std::string prefix = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
+  std::string next_version_prefix = InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice upper_bound(next_version_prefix);
+  read_options.iterate_upper_bound = &upper_bound;
+  rocksdb::Slice lower_bound(prefix);
+  read_options.iterate_lower_bound = &lower_bound;
+
+  auto list_len = static_cast<int64_t>(metadata.size);
+  int64_t max_len = spec.max_len;
+  int64_t count = spec.count.value_or(-1);
+  int64_t offset = 0, matches = 0;
+
+  std::vector<std::string> elems;
+  auto iter = util::UniqueIterator(ctx, read_options);
+  for (reversed ? iter->SeekToLast() : iter->SeekToFirst(); iter->Valid(); reversed ? iter->Prev() : iter->Next()) {
+    auto s = DecodeChunk(iter->value(), &elems);
+    if (!s.ok()) return s;
+    if (reversed) std::reverse(elems.begin(), elems.end());
+    for (const auto &e : elems) {
+      if (max_len != 0 && offset >= max_len) return rocksdb::Status::OK();
+      if (elem == e) {
+        matches++;
+        if (matches >= rank) {
+          int64_t pos = !reversed ? offset : list_len - offset - 1;
+          indexes->push_back(pos);
+          if (count != 0 && matches - rank + 1 >= count) {
+            return rocksdb::Status::OK();
+          }
+        }
+      }
+      offset++;
+    }
+  }
+  return iter->status();
+}
+
+rocksdb::Status List::lmoveOnSingleChunkedList(engine::Context &ctx, const Slice &src, const Slice &ns_key,
+                                               bool src_left, bool dst_left, ListMetadata *metadata,
+                                               std::string *elem) {
+  Chunk src_chunk;
+  auto s = getEndChunk(ctx, ns_key, *metadata, src_left, &src_chunk);
+  if (!s.ok()) return s;
+  if (src_chunk.elems.empty()) return rocksdb::Status::Corruption("list chunks are inconsistent with the metadata");
+  *elem = src_left ? src_chunk.elems.front() : src_chunk.elems.back();
+
+  if (src_left == dst_left || metadata->size == 1) {
+    // no-op
+    return rocksdb::Status::OK();
+  }
+
+  s = balanceChunkGroups(ctx, ns_key, metadata);
+  if (!s.ok()) return s;
+
+  Chunk dst_chunk;
+  s = getEndChunk(ctx, ns_key, *metadata, dst_left, &dst_chunk);
+  if (!s.ok()) return s;
+
+  auto batch = storage_->GetWriteBatchBase();
+  WriteBatchLogData log_data(kRedisList, {std::to_string(kRedisCmdLMove), src.ToString(), src.ToString(),
+                                          src_left ? "left" : "right", dst_left ? "left" : "right"});
+  s = batch->PutLogData(log_data.Encode());
+  if (!s.ok()) return s;
+
+  if (src_chunk.id == dst_chunk.id) {
+    // both ends are in the same chunk, so just rotate it
+    if (src_left) {
+      std::rotate(src_chunk.elems.begin(), src_chunk.elems.begin() + 1, src_chunk.elems.end());
+    } else {
+      std::rotate(src_chunk.elems.rbegin(), src_chunk.elems.rbegin() + 1, src_chunk.elems.rend());
+    }
+    s = putChunk(ns_key, metadata, src_chunk, batch.Get());
+    if (!s.ok()) return s;
+  } else {
+    if (src_left) {
+      src_chunk.elems.erase(src_chunk.elems.begin());
+    } else {
+      src_chunk.elems.pop_back();
+    }
+    s = putChunk(ns_key, metadata, src_chunk, batch.Get());
+    if (!s.ok()) return s;
+
+    if (!chunkHasRoom(dst_chunk.elems, *elem)) {
+      dst_chunk = Chunk{NewChunkId(metadata, dst_left), {}};
+    }
+    if (dst_left) {
+      dst_chunk.elems.insert(dst_chunk.elems.begin(), *elem);
+    } else {
+      dst_chunk.elems.emplace_back(*elem);
+    }
+    s = putChunk(ns_key, metadata, dst_chunk, batch.Get());
+    if (!s.ok()) return s;
+  }
+
+  std::string bytes;
+  metadata->Encode(&bytes);
+  s = batch->Put(metadata_cf_handle_, ns_key, bytes);
+  if (!s.ok()) return s;
+
+  return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
+}
+
 }  // namespace redis
@@ -62,7 +62,17 @@ class List : public Database {
   rocksdb::Status Pos(engine::Context &ctx, const Slice &user_key, const Slice &elem, const PosSpec &spec,
                       std::vector<int64_t> *indexes);
 
+  static void EncodeChunk(const std::vector<std::string> &elems, std::string *value);
+  static rocksdb::Status DecodeChunk(Slice value, std::vector<std::string> *elems);
+
  private:
+  struct Chunk {
+    uint64_t id = 0;
+    std::vector<std::string> elems;
+    // the number of elements the chunk held when it was read, which the size of its chunk group is updated from
+    uint64_t length = 0;
+  };
+
   rocksdb::Status GetMetadata(engine::Context &ctx, const Slice &ns_key, ListMetadata *metadata);
   rocksdb::Status push(engine::Context &ctx, const Slice &user_key, const std::vector<Slice> &elems,
                        bool create_if_missing, bool left, uint64_t *new_size);
@@ -70,5 +80,38 @@ class List : public Database {
                                     std::string *elem);
   rocksdb::Status lmoveOnTwoLists(engine::Context &ctx, const Slice &src, const Slice &dst, bool src_left,
                                   bool dst_left, std::string *elem);
+
+  size_t chunkSize() const;
+  bool chunkHasRoom(const std::vector<std::string> &elems, const Slice &elem) const;
+  bool chunkOverflows(const std::vector<std::string> &elems) const;
+  std::string chunkKey(const Slice &ns_key, const ListMetadata &metadata, uint64_t id) const;
+  rocksdb::Status decodeChunk(const rocksdb::Iterator &iter, Chunk *chunk) const;
+  rocksdb::Status putChunk(const Slice &ns_key, ListMetadata *metadata, const Chunk &chunk,
+                           rocksdb::WriteBatchBase *batch);
+  rocksdb::Status balanceChunkGroups(engine::Context &ctx, const Slice &ns_key, ListMetadata *metadata);
+  rocksdb::Status getEndChunk(engine::Context &ctx, const Slice &ns_key, const ListMetadata &metadata, bool left,
+                              Chunk *chunk);
+  rocksdb::Status locateChunk(engine::Context &ctx, const Slice &ns_key, const ListMetadata &metadata, uint64_t index,
+                              Chunk *chunk, uint64_t *offset);
+  rocksdb::Status getAllElements(engine::Context &ctx, const Slice &ns_key, const ListMetadata &metadata,
+                                 std::vector<std::string> *elems);
+  rocksdb::Status rewriteAsChunks(const Slice &ns_key, const std::vector<std::string> &elems, ListMetadata *metadata,
+                                  rocksdb::WriteBatchBase *batch);
+  rocksdb::Status pushChunked(engine::Context &ctx, const Slice &ns_key, const std::vector<Slice> &elems, bool left,
+                              ListMetadata *metadata, rocksdb::WriteBatchBase *batch);
+  rocksdb::Status popChunked(engine::Context &ctx, const Slice &ns_key, bool left, uint64_t count,
+                             ListMetadata *metadata, rocksdb::WriteBatchBase *batch, std::vector<std::string> *elems);
+  rocksdb::Status remChunked(engine::Context &ctx, const Slice &ns_key, int count, const Slice &elem,
+                             ListMetadata *metadata, rocksdb::WriteBatchBase *batch, uint64_t *removed_cnt);
+  rocksdb::Status insertChunked(engine::Context &ctx, const Slice &ns_key, const Slice &pivot, const Slice &elem,
+                                bool before, ListMetadata *metadata, rocksdb::WriteBatchBase *batch);
+  rocksdb::Status trimChunked(engine::Context &ctx, const Slice &ns_key, uint64_t start, uint64_t stop,
+                              ListMetadata *metadata, rocksdb::WriteBatchBase *batch);
+  rocksdb::Status rangeChunked(engine::Context &ctx, const Slice &ns_key, const ListMetadata &metadata,
+                               uint64_t start, uint64_t stop, std::vector<std::string> *elems);
+  rocksdb::Status posChunked(engine::Context &ctx, const Slice &ns_key, const ListMetadata &metadata,
+                             const Slice &elem, const PosSpec &spec, std::vector<int64_t> *indexes);
+  rocksdb::Status lmoveOnSingleChunkedList(engine::Context &ctx, const Slice &src, const Slice &ns_key, bool src_left,
+                                           bool dst_left, ListMetadata *metadata, std::string *elem);
 };
 }  // namespace redis
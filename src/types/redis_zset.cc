@@ -20,6 +20,7 @@
 
 #include "redis_zset.h"
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 #include <map>
@@ -32,6 +33,46 @@
 
 namespace redis {
 
+namespace {
+
+// Subkeys of the rank index sort before the encoding of every valid score (-inf is encoded as
+// 0x000FFFFFFFFFFFFF), so the score scans which start from kMinScore never observe them.
+// Each of them is made of 7 zero bytes, the level of the entry (0 for the leaves) and its boundary.
+const std::string kRankIndexPrefix(7, '\0');
+// the upper bound of the subkeys of all levels
+const std::string kRankIndexEnd = std::string(6, '\0') + '\x01';
+
+std::string RankIndexSubKey(uint8_t level, const Slice &boundary) {
+  std::string subkey = kRankIndexPrefix;
+  subkey.push_back(static_cast<char>(level));
+  subkey.append(boundary.data(), boundary.size());
+  return subkey;
+}
+
+void ParseRankIndexSubKey(Slice subkey, uint8_t *level, std::string *boundary) {
+  subkey.remove_prefix(kRankIndexPrefix.size());
+  *level = static_cast<uint8_t>(subkey[0]);
+  subkey.remove_prefix(1);
+  *boundary = subkey.ToString();
+}
+
+std::string MinScoreSubKey() {
+  std::string score_bytes;
+  PutDouble(&score_bytes, kMinScore);
+  return score_bytes;
+}
+
+// Return the smallest score subkey which is greater than all subkeys with the given score
+std::string NextScoreSubKey(double score) {
+  std::string score_bytes;
+  PutDouble(&score_bytes, score);
+  std::string next_score_bytes;
+  PutFixed64(&next_score_bytes, DecodeFixed64(score_bytes.data()) + 1);
+  return next_score_bytes;
+}
+
+}  // namespace
+
 rocksdb::Status ZSet::GetMetadata(engine::Context &ctx, const Slice &ns_key, ZSetMetadata *metadata) {
   return Database::GetMetadata(ctx, {kRedisZSet}, ns_key, metadata);
 }
@@ -49,6 +90,8 @@ rocksdb::Status ZSet::Add(engine::Context &ctx, const Slice &user_key, ZAddFlags
 
   int added = 0;
   int changed = 0;
+  uint64_t old_size = metadata.size;
+  ScoreKeyChanges changes;
   auto batch = storage_->GetWriteBatchBase();
   WriteBatchLogData log_data(kRedisZSet);
   s = batch->PutLogData(log_data.Encode());
@@ -95,6 +138,8 @@ rocksdb::Status ZSet::Add(engine::Context &ctx, const Slice &user_key, ZAddFlags
               InternalKey(ns_key, new_score_bytes, metadata.version, storage_->IsSlotIdEncoded()).Encode();
           s = batch->Put(score_cf_handle_, new_score_key, Slice());
           if (!s.ok()) return s;
+          changes.removed.emplace_back(std::move(old_score_bytes));
+          changes.added.emplace_back(std::move(new_score_bytes));
           changed++;
         }
         continue;
@@ -111,6 +156,7 @@ rocksdb::Status ZSet::Add(engine::Context &ctx, const Slice &user_key, ZAddFlags
     std::string score_key = InternalKey(ns_key, score_bytes, metadata.version, storage_->IsSlotIdEncoded()).Encode();
     s = batch->Put(score_cf_handle_, score_key, Slice());
     if (!s.ok()) return s;
+    changes.added.emplace_back(std::move(score_bytes));
     added++;
   }
   if (added > 0) {
@@ -121,6 +167,8 @@ rocksdb::Status ZSet::Add(engine::Context &ctx, const Slice &user_key, ZAddFlags
     s = batch->Put(metadata_cf_handle_, ns_key, bytes);
     if (!s.ok()) return s;
   }
+  s = updateRankIndex(ctx, ns_key, &metadata, old_size, &changes, batch.Get());
+  if (!s.ok()) return s;
   if (flags.HasCH()) {
     *added_cnt += changed;
   }
@@ -140,7 +188,39 @@ rocksdb::Status ZSet::Card(engine::Context &ctx, const Slice &user_key, uint64_t
 }
 
 rocksdb::Status ZSet::Count(engine::Context &ctx, const Slice &user_key, const RangeScoreSpec &spec, uint64_t *size) {
-  return RangeByScore(ctx, user_key, spec, nullptr, size);
+  *size = 0;
+
+  std::string ns_key = AppendNamespacePrefix(user_key);
+
+  ZSetMetadata metadata(false);
+  rocksdb::Status s = GetMetadata(ctx, ns_key, &metadata);
+  if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
+
+  if (!metadata.HasRankIndex() || spec.offset >= 0) {
+    return RangeByScore(ctx, user_key, spec, nullptr, size);
+  }
+
+  // the number of members in the range is the distance between the ranks of its two ends
+  std::string min_subkey, max_subkey;
+  if (spec.minex) {
+    min_subkey = NextScoreSubKey(spec.min);
+  } else {
+    PutDouble(&min_subkey, spec.min);
+  }
+  if (spec.maxex) {
+    PutDouble(&max_subkey, spec.max);
+  } else {
+    max_subkey = NextScoreSubKey(spec.max);
+  }
+  if (min_subkey >= max_subkey) return rocksdb::Status::OK();
+
+  uint64_t min_rank = 0, max_rank = 0;
+  s = rankByIndex(ctx, ns_key, metadata, min_subkey, &min_rank);
+  if (!s.ok()) return s;
+  s = rankByIndex(ctx, ns_key, metadata, max_subkey, &max_rank);
+  if (!s.ok()) return s;
+  if (max_rank > min_rank) *size = max_rank - min_rank;
+  return rocksdb::Status::OK();
 }
 
 rocksdb::Status ZSet::IncrBy(engine::Context &ctx, const Slice &user_key, const Slice &member, double increment,
@@ -173,7 +253,10 @@ rocksdb::Status ZSet::Pop(engine::Context &ctx, const Slice &user_key, int count
   std::string prefix_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
   std::string next_version_prefix_key =
       InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+  std::string score_lower_key = scoreKey(ns_key, metadata.version, MinScoreSubKey());
 
+  uint64_t old_size = metadata.size;
+  ScoreKeyChanges changes;
   auto batch = storage_->GetWriteBatchBase();
   WriteBatchLogData log_data(kRedisZSet);
   s = batch->PutLogData(log_data.Encode());
@@ -182,7 +265,7 @@ rocksdb::Status ZSet::Pop(engine::Context &ctx, const Slice &user_key, int count
   rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
   rocksdb::Slice upper_bound(next_version_prefix_key);
   read_options.iterate_upper_bound = &upper_bound;
-  rocksdb::Slice lower_bound(prefix_key);
+  rocksdb::Slice lower_bound(score_lower_key);
   read_options.iterate_lower_bound = &lower_bound;
 
   auto iter = util::UniqueIterator(ctx, read_options, score_cf_handle_);
@@ -194,6 +277,7 @@ rocksdb::Status ZSet::Pop(engine::Context &ctx, const Slice &user_key, int count
   for (; iter->Valid() && iter->key().starts_with(prefix_key); min ? iter->Next() : iter->Prev()) {
     InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
     Slice score_key = ikey.GetSubKey();
+    changes.removed.emplace_back(score_key.ToString());
     GetDouble(&score_key, &score);
     mscores->emplace_back(MemberScore{score_key.ToString(), score});
     std::string default_cf_key = InternalKey(ns_key, score_key, metadata.version, storage_->IsSlotIdEncoded()).Encode();
@@ -211,6 +295,8 @@ rocksdb::Status ZSet::Pop(engine::Context &ctx, const Slice &user_key, int count
     s = batch->Put(metadata_cf_handle_, ns_key, bytes);
     if (!s.ok()) return s;
   }
+  s = updateRankIndex(ctx, ns_key, &metadata, old_size, &changes, batch.Get());
+  if (!s.ok()) return s;
   return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
 }
 
@@ -237,7 +323,7 @@ rocksdb::Status ZSet::RangeByRank(engine::Context &ctx, const Slice &user_key, c
   if (start < 0) start += static_cast<int>(metadata.size);
   if (stop < 0) stop += static_cast<int>(metadata.size);
   if (start < 0) start = 0;
-  if (stop < 0 || start > stop) {
+  if (stop < 0 || start > stop || static_cast<uint64_t>(start) >= metadata.size) {
     return rocksdb::Status::OK();
   }
 
@@ -248,23 +334,42 @@ rocksdb::Status ZSet::RangeByRank(engine::Context &ctx, const Slice &user_key, c
   std::string prefix_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
   std::string next_version_prefix_key =
       InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+  std::string score_lower_key = scoreKey(ns_key, metadata.version, MinScoreSubKey());
 
   int removed_subkey = 0;
+  uint64_t old_size = metadata.size;
+  ScoreKeyChanges changes;
   rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
   rocksdb::Slice upper_bound(next_version_prefix_key);
   read_options.iterate_upper_bound = &upper_bound;
-  rocksdb::Slice lower_bound(prefix_key);
+  rocksdb::Slice lower_bound(score_lower_key);
   read_options.iterate_lower_bound = &lower_bound;
 
   auto batch = storage_->GetWriteBatchBase();
   auto iter = util::UniqueIterator(ctx, read_options, score_cf_handle_);
-  iter->Seek(start_key);
-  // see comment in RangeByScore()
-  if (spec.reversed && (!iter->Valid() || !iter->key().starts_with(prefix_key))) {
-    iter->SeekForPrev(start_key);
+  int count = 0;
+  if (metadata.HasRankIndex()) {
+    // jump to the leaf which holds the first requested member instead of walking from the lowest score
+    uint64_t pos = spec.reversed ? metadata.size - 1 - start : start;
+    std::string leaf_start;
+    uint64_t leaf_rank = 0;
+    s = seekByIndex(ctx, ns_key, metadata, pos, &leaf_start, &leaf_rank);
+    if (!s.ok()) return s;
+    iter->Seek(scoreKey(ns_key, metadata.version, leaf_start));
+    if (!spec.reversed) {
+      count = static_cast<int>(leaf_rank);
+    } else {
+      for (; leaf_rank < pos && iter->Valid(); leaf_rank++) iter->Next();
+      count = start;
+    }
+  } else {
+    iter->Seek(start_key);
+    // see comment in RangeByScore()
+    if (spec.reversed && (!iter->Valid() || !iter->key().starts_with(prefix_key))) {
+      iter->SeekForPrev(start_key);
+    }
   }
 
-  int count = 0;
   for (; iter->Valid() && iter->key().starts_with(prefix_key); !(spec.reversed) ? iter->Next() : iter->Prev()) {
     InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
     Slice score_key = ikey.GetSubKey();
@@ -276,6 +381,7 @@ rocksdb::Status ZSet::RangeByRank(engine::Context &ctx, const Slice &user_key, c
         if (!s.ok()) return s;
         s = batch->Delete(score_cf_handle_, iter->key());
         if (!s.ok()) return s;
+        changes.removed.emplace_back(ikey.GetSubKey().ToString());
         removed_subkey++;
       } else {
         if (mscores) mscores->emplace_back(MemberScore{score_key.ToString(), score});
@@ -291,6 +397,8 @@ rocksdb::Status ZSet::RangeByRank(engine::Context &ctx, const Slice &user_key, c
     metadata.Encode(&bytes);
     s = batch->Put(metadata_cf_handle_, ns_key, bytes);
     if (!s.ok()) return s;
+    s = updateRankIndex(ctx, ns_key, &metadata, old_size, &changes, batch.Get());
+    if (!s.ok()) return s;
     return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
   }
   return rocksdb::Status::OK();
@@ -356,14 +464,17 @@ rocksdb::Status ZSet::RangeByScore(engine::Context &ctx, const Slice &user_key,
   std::string prefix_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
   std::string next_version_prefix_key =
       InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+  std::string score_lower_key = scoreKey(ns_key, metadata.version, MinScoreSubKey());
 
   rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
   rocksdb::Slice upper_bound(next_version_prefix_key);
   read_options.iterate_upper_bound = &upper_bound;
-  rocksdb::Slice lower_bound(prefix_key);
+  rocksdb::Slice lower_bound(score_lower_key);
   read_options.iterate_lower_bound = &lower_bound;
 
   int pos = 0;
+  uint64_t old_size = metadata.size;
+  ScoreKeyChanges changes;
   auto iter = util::UniqueIterator(ctx, read_options, score_cf_handle_);
   auto batch = storage_->GetWriteBatchBase();
   WriteBatchLogData log_data(kRedisZSet);
@@ -397,6 +508,7 @@ rocksdb::Status ZSet::RangeByScore(engine::Context &ctx, const Slice &user_key,
       if (!s.ok()) return s;
       s = batch->Delete(score_cf_handle_, iter->key());
       if (!s.ok()) return s;
+      changes.removed.emplace_back(ikey.GetSubKey().ToString());
     } else {
       if (mscores) mscores->emplace_back(MemberScore{score_key.ToString(), score});
     }
@@ -410,6 +522,8 @@ rocksdb::Status ZSet::RangeByScore(engine::Context &ctx, const Slice &user_key,
     metadata.Encode(&bytes);
     s = batch->Put(metadata_cf_handle_, ns_key, bytes);
     if (!s.ok()) return s;
+    s = updateRankIndex(ctx, ns_key, &metadata, old_size, &changes, batch.Get());
+    if (!s.ok()) return s;
     return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
   }
   return rocksdb::Status::OK();
@@ -450,6 +564,8 @@ rocksdb::Status ZSet::RangeByLex(engine::Context &ctx, const Slice &user_key, co
   read_options.iterate_lower_bound = &lower_bound;
 
   int pos = 0;
+  uint64_t old_size = metadata.size;
+  ScoreKeyChanges changes;
   auto iter = util::UniqueIterator(ctx, read_options);
   auto batch = storage_->GetWriteBatchBase();
   WriteBatchLogData log_data(kRedisZSet);
@@ -489,6 +605,7 @@ rocksdb::Status ZSet::RangeByLex(engine::Context &ctx, const Slice &user_key, co
       if (!s.ok()) return s;
       s = batch->Delete(iter->key());
       if (!s.ok()) return s;
+      changes.removed.emplace_back(std::move(score_bytes));
     } else {
       if (mscores) mscores->emplace_back(MemberScore{member.ToString(), DecodeDouble(iter->value().data())});
     }
@@ -502,6 +619,8 @@ rocksdb::Status ZSet::RangeByLex(engine::Context &ctx, const Slice &user_key, co
     metadata.Encode(&bytes);
     s = batch->Put(metadata_cf_handle_, ns_key, bytes);
     if (!s.ok()) return s;
+    s = updateRankIndex(ctx, ns_key, &metadata, old_size, &changes, batch.Get());
+    if (!s.ok()) return s;
     return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
   }
   return rocksdb::Status::OK();
@@ -536,6 +655,8 @@ rocksdb::Status ZSet::Remove(engine::Context &ctx, const Slice &user_key, const
   s = batch->PutLogData(log_data.Encode());
   if (!s.ok()) return s;
   int removed = 0;
+  uint64_t old_size = metadata.size;
+  ScoreKeyChanges changes;
   std::unordered_set<std::string_view> mset;
   for (const auto &member : members) {
     if (!mset.insert(member.ToStringView()).second) {
@@ -551,6 +672,7 @@ rocksdb::Status ZSet::Remove(engine::Context &ctx, const Slice &user_key, const
       if (!s.ok()) return s;
       s = batch->Delete(score_cf_handle_, score_key);
       if (!s.ok()) return s;
+      changes.removed.emplace_back(std::move(score_bytes));
       removed++;
     }
   }
@@ -562,6 +684,8 @@ rocksdb::Status ZSet::Remove(engine::Context &ctx, const Slice &user_key, const
     s = batch->Put(metadata_cf_handle_, ns_key, bytes);
     if (!s.ok()) return s;
   }
+  s = updateRankIndex(ctx, ns_key, &metadata, old_size, &changes, batch.Get());
+  if (!s.ok()) return s;
   return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
 }
 
@@ -583,6 +707,16 @@ rocksdb::Status ZSet::Rank(engine::Context &ctx, const Slice &user_key, const Sl
   if (!s.ok()) return s.IsNotFound() ? rocksdb::Status::OK() : s;
 
   double target_score = DecodeDouble(score_bytes.data());
+
+  if (metadata.HasRankIndex()) {
+    uint64_t forward_rank = 0;
+    s = rankByIndex(ctx, ns_key, metadata, score_bytes + member.ToString(), &forward_rank);
+    if (!s.ok()) return s;
+    *member_rank = static_cast<int>(!reversed ? forward_rank : metadata.size - 1 - forward_rank);
+    *member_score = target_score;
+    return rocksdb::Status::OK();
+  }
+
   std::string start_score_bytes;
   double start_score = !reversed ? kMinScore : kMaxScore;
   PutDouble(&start_score_bytes, start_score);
@@ -591,11 +725,12 @@ rocksdb::Status ZSet::Rank(engine::Context &ctx, const Slice &user_key, const Sl
   std::string prefix_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
   std::string next_version_prefix_key =
       InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+  std::string score_lower_key = scoreKey(ns_key, metadata.version, MinScoreSubKey());
 
   int rank = 0;
   rocksdb::Slice upper_bound(next_version_prefix_key);
   read_options.iterate_upper_bound = &upper_bound;
-  rocksdb::Slice lower_bound(prefix_key);
+  rocksdb::Slice lower_bound(score_lower_key);
   read_options.iterate_lower_bound = &lower_bound;
 
   auto iter = util::UniqueIterator(ctx, read_options, score_cf_handle_);
@@ -623,6 +758,7 @@ rocksdb::Status ZSet::Overwrite(engine::Context &ctx, const Slice &user_key, con
 
   LockGuard guard(storage_->GetLockManager(), ns_key);
   ZSetMetadata metadata;
+  ScoreKeyChanges changes;
   auto batch = storage_->GetWriteBatchBase();
   WriteBatchLogData log_data(kRedisZSet);
   auto s = batch->PutLogData(log_data.Encode());
@@ -637,12 +773,16 @@ rocksdb::Status ZSet::Overwrite(engine::Context &ctx, const Slice &user_key, con
     std::string score_key = InternalKey(ns_key, score_bytes, metadata.version, storage_->IsSlotIdEncoded()).Encode();
     s = batch->Put(score_cf_handle_, score_key, Slice());
     if (!s.ok()) return s;
+    changes.added.emplace_back(std::move(score_bytes));
   }
   metadata.size = static_cast<uint32_t>(mscores.size());
   std::string bytes;
   metadata.Encode(&bytes);
   s = batch->Put(metadata_cf_handle_, ns_key, bytes);
   if (!s.ok()) return s;
+  // the members are written under a brand new version, so there is no index to maintain yet
+  s = updateRankIndex(ctx, ns_key, &metadata, 0, &changes, batch.Get());
+  if (!s.ok()) return s;
   return storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch());
 }
 
@@ -884,17 +1024,18 @@ rocksdb::Status ZSet::GetAllMemberScores(engine::Context &ctx, const Slice &user
   std::string prefix_key = InternalKey(ns_key, "", metadata.version, storage_->IsSlotIdEncoded()).Encode();
   std::string next_version_prefix_key =
       InternalKey(ns_key, "", metadata.version + 1, storage_->IsSlotIdEncoded()).Encode();
+  std::string score_lower_key = scoreKey(ns_key, metadata.version, MinScoreSubKey());
 
   rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
 
   rocksdb::Slice upper_bound(next_version_prefix_key);
-  rocksdb::Slice lower_bound(prefix_key);
+  rocksdb::Slice lower_bound(score_lower_key);
   read_options.iterate_upper_bound = &upper_bound;
   read_options.iterate_lower_bound = &lower_bound;
 
   auto iter = util::UniqueIterator(ctx, read_options, score_cf_handle_);
 
-  for (iter->Seek(prefix_key); iter->Valid() && iter->key().starts_with(prefix_key); iter->Next()) {
+  for (iter->Seek(score_lower_key); iter->Valid() && iter->key().starts_with(prefix_key); iter->Next()) {
     InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
     Slice score_key = ikey.GetSubKey();
     double score = NAN;
@@ -968,4 +1109,647 @@ rocksdb::Status ZSet::DiffStore(engine::Context &ctx, const Slice &dst, const st
   return Overwrite(ctx, dst, mscores);
 }
 
+bool ZSet::IsRankIndexSubKey(const Slice &score_subkey) {
+  // the entries of every level start with 7 zero bytes, which no encoded score does
+  return score_subkey.starts_with(kRankIndexPrefix);
+}
+
+void ZSet::ClearRankIndexFlag(std::string *raw_metadata) {
+  if (raw_metadata->empty()) return;
+  auto flags = static_cast<uint8_t>((*raw_metadata)[0]);
+  if ((flags & METADATA_TYPE_MASK) == kRedisZSet) {
+    (*raw_metadata)[0] = static_cast<char>(flags & ~METADATA_ALT_ENCODING_MASK);
+  }
+}
+
+std::string ZSet::encodeRankIndexEntry(uint8_t level, const RankIndexEntry &entry) {
+  std::string bytes;
+  PutFixed64(&bytes, entry.count);
+  // the children of a leaf are its members
+  if (level > 0) PutFixed64(&bytes, entry.children);
+  return bytes;
+}
+
+rocksdb::Status ZSet::decodeRankIndexEntry(uint8_t level, Slice value, RankIndexEntry *entry) {
+  if (!GetFixed64(&value, &entry->count)) return rocksdb::Status::Corruption("malformed zset rank index entry");
+  if (level == 0) {
+    entry->children = entry->count;
+  } else if (!GetFixed64(&value, &entry->children)) {
+    return rocksdb::Status::Corruption("malformed zset rank index entry");
+  }
+  return rocksdb::Status::OK();
+}
+
+std::string ZSet::scoreKey(const Slice &ns_key, uint64_t version, const Slice &score_subkey) const {
+  return InternalKey(ns_key, score_subkey, version, storage_->IsSlotIdEncoded()).Encode();
+}
+
+std::string ZSet::rankIndexKey(const Slice &ns_key, uint64_t version, uint8_t level, const Slice &boundary) const {
+  return scoreKey(ns_key, version, RankIndexSubKey(level, boundary));
+}
+
+rocksdb::Status ZSet::getRankIndexTopLevel(engine::Context &ctx, const Slice &ns_key, uint64_t version,
+                                           uint8_t *level, RankIndexEntry *root) {
+  std::string index_begin = scoreKey(ns_key, version, kRankIndexPrefix);
+  std::string index_end = scoreKey(ns_key, version, kRankIndexEnd);
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice lower_bound(index_begin);
+  rocksdb::Slice upper_bound(index_end);
+  read_options.iterate_lower_bound = &lower_bound;
+  read_options.iterate_upper_bound = &upper_bound;
+
+  // the root is the only entry of the top level, so it's the last entry of the index
+  auto iter = util::UniqueIterator(ctx, read_options, score_cf_handle_);
+  iter->SeekToLast();
+  if (!iter->Valid()) {
+    return iter->status().ok() ? rocksdb::Status::Corruption("zset rank index has no root") : iter->status();
+  }
+  std::string boundary;
+  ParseRankIndexSubKey(InternalKey(iter->key(), storage_->IsSlotIdEncoded()).GetSubKey(), level, &boundary);
+  if (!boundary.empty()) return rocksdb::Status::Corruption("zset rank index has no root");
+  return decodeRankIndexEntry(*level, iter->value(), root);
+}
+
+rocksdb::Status ZSet::dropRankIndex(engine::Context &ctx, const Slice &ns_key, uint64_t version,
+                                    rocksdb::WriteBatchBase *batch) {
+  std::string index_begin = scoreKey(ns_key, version, kRankIndexPrefix);
+  std::string index_end = scoreKey(ns_key, version, kRankIndexEnd);
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice lower_bound(index_begin);
+  rocksdb::Slice upper_bound(index_end);
+  read_options.iterate_lower_bound = &lower_bound;
+  read_options.iterate_upper_bound = &upper_bound;
+
+  // collect the entries before deleting them since the iterator may be built upon the write batch
+  std::vector<std::string> entry_keys;
+  {
+    auto iter = util::UniqueIterator(ctx, read_options, score_cf_handle_);
+    for (iter->Seek(index_begin); iter->Valid(); iter->Next()) {
+      entry_keys.emplace_back(iter->key().ToString());
+    }
+    if (!iter->status().ok()) return iter->status();
+  }
+  for (const auto &entry_key : entry_keys) {
+    auto s = batch->Delete(score_cf_handle_, entry_key);
+    if (!s.ok()) return s;
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status ZSet::splitRankIndexLeaf(engine::Context &ctx, const Slice &ns_key, uint64_t version,
+                                         const std::string &boundary, const std::optional<std::string> &upper,
+                                         const ScoreKeyChanges &changes, uint64_t count,
+                                         std::vector<std::pair<std::string, RankIndexEntry>> *pieces) {
+  // cut the leaf into pieces of about half of the maximum leaf size,
+  // so that the pieces have room to grow before being split again
+  uint64_t num_pieces = count / (kZSetRankIndexLeafMaxSize / 2);
+  uint64_t piece_size = count / num_pieces;
+  uint64_t remainder = count % num_pieces;
+
+  std::string start_key = scoreKey(ns_key, version, boundary.empty() ? MinScoreSubKey() : boundary);
+  std::string end_key = upper ? scoreKey(ns_key, version, *upper)
+                              : InternalKey(ns_key, "", version + 1, storage_->IsSlotIdEncoded()).Encode();
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice lower_bound(start_key);
+  rocksdb::Slice upper_bound(end_key);
+  read_options.iterate_lower_bound = &lower_bound;
+  read_options.iterate_upper_bound = &upper_bound;
+
+  pieces->clear();
+  pieces->emplace_back(boundary, RankIndexEntry{});
+  uint64_t piece_limit = piece_size + (remainder > 0 ? 1 : 0);
+  auto append = [&](std::string score_subkey) {
+    if (pieces->back().second.count == piece_limit) {
+      pieces->emplace_back(std::move(score_subkey), RankIndexEntry{});
+      piece_limit = piece_size + (pieces->size() - 1 < remainder ? 1 : 0);
+    }
+    pieces->back().second.count++;
+    pieces->back().second.children++;
+  };
+
+  // merge the stored score subkeys with the changes of the current write, the stored ones may
+  // already include the changes when the write batch is visible to reads (e.g. inside a transaction)
+  auto iter = util::UniqueIterator(ctx, read_options, score_cf_handle_);
+  auto added = changes.added.begin();
+  iter->Seek(start_key);
+  while (iter->Valid() || added != changes.added.end()) {
+    if (!iter->Valid()) {
+      append(*added++);
+      continue;
+    }
+    std::string stored = InternalKey(iter->key(), storage_->IsSlotIdEncoded()).GetSubKey().ToString();
+    if (added != changes.added.end() && *added <= stored) {
+      if (*added == stored) iter->Next();
+      append(*added++);
+    } else {
+      iter->Next();
+      if (!std::binary_search(changes.removed.begin(), changes.removed.end(), stored)) append(std::move(stored));
+    }
+  }
+  return iter->status();
+}
+
+rocksdb::Status ZSet::splitRankIndexNode(engine::Context &ctx, const Slice &ns_key, uint64_t version, uint8_t level,
+                                         const std::string &boundary, const std::optional<std::string> &upper,
+                                         const RankIndexChanges &child_changes,
+                                         std::vector<std::pair<std::string, RankIndexEntry>> *pieces) {
+  // the children are the entries of the level below from the boundary of the node up to the next one
+  std::string start_key = rankIndexKey(ns_key, version, level - 1, boundary);
+  std::string end_key =
+      upper ? rankIndexKey(ns_key, version, level - 1, *upper) : rankIndexKey(ns_key, version, level, "");
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice lower_bound(start_key);
+  rocksdb::Slice upper_bound(end_key);
+  read_options.iterate_lower_bound = &lower_bound;
+  read_options.iterate_upper_bound = &upper_bound;
+
+  // the stored children may already include the changes of the current write like the members do
+  // in splitRankIndexLeaf(), so the changes are applied over them
+  std::map<std::string, RankIndexEntry> children;
+  {
+    auto iter = util::UniqueIterator(ctx, read_options, score_cf_handle_);
+    for (iter->Seek(start_key); iter->Valid(); iter->Next()) {
+      uint8_t child_level = 0;
+      std::string child_boundary;
+      ParseRankIndexSubKey(InternalKey(iter->key(), storage_->IsSlotIdEncoded()).GetSubKey(), &child_level,
+                           &child_boundary);
+      auto s = decodeRankIndexEntry(child_level, iter->value(), &children[child_boundary]);
+      if (!s.ok()) return s;
+    }
+    if (!iter->status().ok()) return iter->status();
+  }
+  for (auto change = child_changes.lower_bound(boundary);
+       change != child_changes.end() && (!upper || change->first < *upper); ++change) {
+    if (change->second.new_entry) {
+      children[change->first] = *change->second.new_entry;
+    } else {
+      children.erase(change->first);
+    }
+  }
+
+  // cut the node into pieces of about half of the maximum node size, like the leaves
+  uint64_t num_pieces = children.size() / (kZSetRankIndexNodeMaxSize / 2);
+  uint64_t piece_size = children.size() / num_pieces;
+  uint64_t remainder = children.size() % num_pieces;
+
+  pieces->clear();
+  pieces->emplace_back(boundary, RankIndexEntry{});
+  uint64_t piece_limit = piece_size + (remainder > 0 ? 1 : 0);
+  for (const auto &[child_boundary, child] : children) {
+    if (pieces->back().second.children == piece_limit) {
+      pieces->emplace_back(child_boundary, RankIndexEntry{});
+      piece_limit = piece_size + (pieces->size() - 1 < remainder ? 1 : 0);
+    }
+    pieces->back().second.count += child.count;
+    pieces->back().second.children++;
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status ZSet::updateRankIndexLeaves(engine::Context &ctx, const Slice &ns_key, uint64_t version, bool indexed,
+                                            uint64_t old_size, ScoreKeyChanges *changes,
+                                            RankIndexChanges *leaf_changes, rocksdb::WriteBatchBase *batch) {
+  std::sort(changes->added.begin(), changes->added.end());
+  std::sort(changes->removed.begin(), changes->removed.end());
+
+  struct Leaf {
+    RankIndexEntry entry;
+    std::optional<std::string> next_boundary;
+    RankIndexEntry next_entry;
+    ScoreKeyChanges changes;
+  };
+  // the leaves touched by this write, keyed by their boundary (the lowest score subkey they may hold)
+  std::map<std::string, Leaf> leaves;
+
+  if (indexed) {
+    std::string leaves_begin = rankIndexKey(ns_key, version, 0, "");
+    std::string leaves_end = rankIndexKey(ns_key, version, 1, "");
+
+    rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+    rocksdb::Slice lower_bound(leaves_begin);
+    rocksdb::Slice upper_bound(leaves_end);
+    read_options.iterate_lower_bound = &lower_bound;
+    read_options.iterate_upper_bound = &upper_bound;
+    auto iter = util::UniqueIterator(ctx, read_options, score_cf_handle_);
+
+    auto leaf_boundary = [&iter, this]() {
+      uint8_t level = 0;
+      std::string boundary;
+      ParseRankIndexSubKey(InternalKey(iter->key(), storage_->IsSlotIdEncoded()).GetSubKey(), &level, &boundary);
+      return boundary;
+    };
+    auto assign = [&](const std::string &score_subkey, bool is_added) -> rocksdb::Status {
+      iter->SeekForPrev(rankIndexKey(ns_key, version, 0, score_subkey));
+      if (!iter->Valid()) {
+        return iter->status().ok() ? rocksdb::Status::Corruption("zset rank index has no leaf for the member")
+                                   : iter->status();
+      }
+      auto [leaf, inserted] = leaves.try_emplace(leaf_boundary());
+      if (inserted) {
+        auto s = decodeRankIndexEntry(0, iter->value(), &leaf->second.entry);
+        if (!s.ok()) return s;
+        // the next leaf bounds the range of this leaf
+        iter->Next();
+        if (iter->Valid()) {
+          leaf->second.next_boundary = leaf_boundary();
+          s = decodeRankIndexEntry(0, iter->value(), &leaf->second.next_entry);
+          if (!s.ok()) return s;
+        }
+      }
+      auto &keys = is_added ? leaf->second.changes.added : leaf->second.changes.removed;
+      keys.emplace_back(score_subkey);
+      return iter->status();
+    };
+    for (const auto &score_subkey : changes->added) {
+      auto s = assign(score_subkey, true);
+      if (!s.ok()) return s;
+    }
+    for (const auto &score_subkey : changes->removed) {
+      auto s = assign(score_subkey, false);
+      if (!s.ok()) return s;
+    }
+  } else {
+    // build the index from scratch, the whole sorted set starts as a single leaf and is split below
+    Leaf &leaf = leaves[""];
+    leaf.entry = RankIndexEntry{old_size, old_size};
+    leaf.changes = std::move(*changes);
+  }
+
+  for (auto &[boundary, leaf] : leaves) {
+    uint64_t count = leaf.entry.count + leaf.changes.added.size();
+    if (count < leaf.changes.removed.size()) {
+      return rocksdb::Status::Corruption("zset rank index is inconsistent with the members");
+    }
+    count -= leaf.changes.removed.size();
+
+    rocksdb::Status s;
+    std::string leaf_key = rankIndexKey(ns_key, version, 0, boundary);
+    auto &change = (*leaf_changes)[boundary];
+    change.old_entry = leaf.entry;
+    if (count == 0 && !boundary.empty()) {
+      // the range of an empty leaf is taken over by its predecessor
+      s = batch->Delete(score_cf_handle_, leaf_key);
+    } else if (count > kZSetRankIndexLeafMaxSize) {
+      std::vector<std::pair<std::string, RankIndexEntry>> pieces;
+      s = splitRankIndexLeaf(ctx, ns_key, version, boundary, leaf.next_boundary, leaf.changes, count, &pieces);
+      for (const auto &[piece_boundary, piece] : pieces) {
+        if (!s.ok()) break;
+        s = batch->Put(score_cf_handle_, rankIndexKey(ns_key, version, 0, piece_boundary),
+                       encodeRankIndexEntry(0, piece));
+        (*leaf_changes)[piece_boundary].new_entry = piece;
+      }
+    } else {
+      // absorb the following leaf if both are small and it isn't touched by this write
+      if (count < kZSetRankIndexLeafMinSize && leaf.next_boundary && leaves.count(*leaf.next_boundary) == 0 &&
+          count + leaf.next_entry.count <= kZSetRankIndexLeafMaxSize) {
+        s = batch->Delete(score_cf_handle_, rankIndexKey(ns_key, version, 0, *leaf.next_boundary));
+        if (!s.ok()) return s;
+        (*leaf_changes)[*leaf.next_boundary].old_entry = leaf.next_entry;
+        count += leaf.next_entry.count;
+      }
+      RankIndexEntry entry{count, count};
+      if (indexed && entry == leaf.entry) {
+        // e.g. a member moved within the leaf, nothing to propagate
+        leaf_changes->erase(boundary);
+        continue;
+      }
+      s = batch->Put(score_cf_handle_, leaf_key, encodeRankIndexEntry(0, entry));
+      change.new_entry = entry;
+    }
+    if (!s.ok()) return s;
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status ZSet::updateRankIndexNodes(engine::Context &ctx, const Slice &ns_key, uint64_t version, uint8_t level,
+                                           const std::optional<RankIndexEntry> &new_level_root,
+                                           const RankIndexChanges &child_changes, RankIndexChanges *node_changes,
+                                           rocksdb::WriteBatchBase *batch) {
+  struct Node {
+    RankIndexEntry entry;
+    std::optional<std::string> next_boundary;
+    RankIndexEntry next_entry;
+    // the sum of the entries of the children which are added or removed by this write
+    RankIndexEntry added;
+    RankIndexEntry removed;
+  };
+  // the nodes touched by this write, keyed by their boundary, a node holds the entries of the level
+  // below from its boundary up to the boundary of the next node
+  std::map<std::string, Node> nodes;
+
+  auto accumulate = [](Node *node, const RankIndexChange &change) {
+    if (change.new_entry) {
+      node->added.count += change.new_entry->count;
+      node->added.children++;
+    }
+    if (change.old_entry) {
+      node->removed.count += change.old_entry->count;
+      node->removed.children++;
+    }
+  };
+
+  if (new_level_root) {
+    // the level is added on top of the index, so its root holds all the entries of the level below
+    Node &node = nodes[""];
+    node.entry = *new_level_root;
+    for (const auto &[child_boundary, change] : child_changes) accumulate(&node, change);
+  } else {
+    std::string level_begin = rankIndexKey(ns_key, version, level, "");
+    std::string level_end = rankIndexKey(ns_key, version, level + 1, "");
+
+    rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+    rocksdb::Slice lower_bound(level_begin);
+    rocksdb::Slice upper_bound(level_end);
+    read_options.iterate_lower_bound = &lower_bound;
+    read_options.iterate_upper_bound = &upper_bound;
+    auto iter = util::UniqueIterator(ctx, read_options, score_cf_handle_);
+
+    auto node_boundary = [&iter, this]() {
+      uint8_t node_level = 0;
+      std::string boundary;
+      ParseRankIndexSubKey(InternalKey(iter->key(), storage_->IsSlotIdEncoded()).GetSubKey(), &node_level,
+                           &boundary);
+      return boundary;
+    };
+    for (const auto &[child_boundary, change] : child_changes) {
+      iter->SeekForPrev(rankIndexKey(ns_key, version, level, child_boundary));
+      if (!iter->Valid()) {
+        return iter->status().ok() ? rocksdb::Status::Corruption("zset rank index has no node for the entry")
+                                   : iter->status();
+      }
+      auto [node, inserted] = nodes.try_emplace(node_boundary());
+      if (inserted) {
+        auto s = decodeRankIndexEntry(level, iter->value(), &node->second.entry);
+        if (!s.ok()) return s;
+        iter->Next();
+        if (iter->Valid()) {
+          node->second.next_boundary = node_boundary();
+          s = decodeRankIndexEntry(level, iter->value(), &node->second.next_entry);
+          if (!s.ok()) return s;
+        }
+        if (!iter->status().ok()) return iter->status();
+      }
+      accumulate(&node->second, change);
+    }
+  }
+
+  for (auto &[boundary, node] : nodes) {
+    if (node.entry.count + node.added.count < node.removed.count ||
+        node.entry.children + node.added.children < node.removed.children) {
+      return rocksdb::Status::Corruption("zset rank index is inconsistent with the members");
+    }
+    RankIndexEntry entry{node.entry.count + node.added.count - node.removed.count,
+                         node.entry.children + node.added.children - node.removed.children};
+
+    rocksdb::Status s;
+    std::string node_key = rankIndexKey(ns_key, version, level, boundary);
+    auto &change = (*node_changes)[boundary];
+    change.old_entry = node.entry;
+    if (entry.children == 0 && !boundary.empty()) {
+      // the range of a node without children is taken over by its predecessor
+      s = batch->Delete(score_cf_handle_, node_key);
+    } else if (entry.children > kZSetRankIndexNodeMaxSize) {
+      std::vector<std::pair<std::string, RankIndexEntry>> pieces;
+      s = splitRankIndexNode(ctx, ns_key, version, level, boundary, node.next_boundary, child_changes, &pieces);
+      for (const auto &[piece_boundary, piece] : pieces) {
+        if (!s.ok()) break;
+        s = batch->Put(score_cf_handle_, rankIndexKey(ns_key, version, level, piece_boundary),
+                       encodeRankIndexEntry(level, piece));
+        (*node_changes)[piece_boundary].new_entry = piece;
+      }
+    } else {
+      // absorb the following node if both are small and it isn't touched by this write,
+      // its children are then in the range of this node
+      if (entry.children < kZSetRankIndexNodeMinSize && node.next_boundary && nodes.count(*node.next_boundary) == 0 &&
+          entry.children + node.next_entry.children <= kZSetRankIndexNodeMaxSize) {
+        s = batch->Delete(score_cf_handle_, rankIndexKey(ns_key, version, level, *node.next_boundary));
+        if (!s.ok()) return s;
+        (*node_changes)[*node.next_boundary].old_entry = node.next_entry;
+        entry.count += node.next_entry.count;
+        entry.children += node.next_entry.children;
+      }
+      if (!new_level_root && entry == node.entry) {
+        node_changes->erase(boundary);
+        continue;
+      }
+      s = batch->Put(score_cf_handle_, node_key, encodeRankIndexEntry(level, entry));
+      change.new_entry = entry;
+    }
+    if (!s.ok()) return s;
+  }
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status ZSet::updateRankIndex(engine::Context &ctx, const Slice &ns_key, ZSetMetadata *metadata,
+                                      uint64_t old_size, ScoreKeyChanges *changes, rocksdb::WriteBatchBase *batch) {
+  if (changes->added.empty() && changes->removed.empty()) return rocksdb::Status::OK();
+  // the index goes away together with the current version of the key
+  if (metadata->size == 0) return rocksdb::Status::OK();
+
+  bool indexed = metadata->HasRankIndex();
+  if (indexed && metadata->size < kZSetRankIndexLeafMaxSize) {
+    // the index is no longer worth keeping once the sorted set fits into a single leaf
+    auto s = dropRankIndex(ctx, ns_key, metadata->version, batch);
+    if (!s.ok()) return s;
+    metadata->SetRankIndex(false);
+    std::string bytes;
+    metadata->Encode(&bytes);
+    return batch->Put(metadata_cf_handle_, ns_key, bytes);
+  }
+  if (!indexed) {
+    auto threshold = static_cast<uint64_t>(storage_->GetConfig()->zset_rank_index_threshold);
+    if (threshold > 0) threshold = std::max(threshold, kZSetRankIndexLeafMaxSize);
+    if (threshold == 0 || metadata->size < threshold) return rocksdb::Status::OK();
+  }
+
+  // a sorted set which is being indexed starts with a single leaf as the root
+  uint8_t top_level = 0;
+  if (indexed) {
+    RankIndexEntry root;
+    auto s = getRankIndexTopLevel(ctx, ns_key, metadata->version, &top_level, &root);
+    if (!s.ok()) return s;
+  }
+
+  std::vector<RankIndexChanges> level_changes(1);
+  auto s = updateRankIndexLeaves(ctx, ns_key, metadata->version, indexed, old_size, changes, &level_changes[0], batch);
+  if (!s.ok()) return s;
+
+  // propagate the changes up to the root, and add a new root on top once the old one is split
+  for (uint8_t level = 1; !level_changes.back().empty(); level++) {
+    std::optional<RankIndexEntry> new_level_root;
+    if (level > top_level) {
+      const auto &root_changes = level_changes.back();
+      bool split = std::any_of(root_changes.begin(), root_changes.end(),
+                               [](const auto &item) { return !item.second.old_entry && item.second.new_entry; });
+      if (!split) break;
+      new_level_root = RankIndexEntry{old_size, 1};
+      top_level = level;
+    }
+    RankIndexChanges node_changes;
+    s = updateRankIndexNodes(ctx, ns_key, metadata->version, level, new_level_root, level_changes.back(),
+                             &node_changes, batch);
+    if (!s.ok()) return s;
+    level_changes.emplace_back(std::move(node_changes));
+  }
+
+  // a root which is left with a single child is dropped, then the child is the root
+  for (auto level = top_level; level > 0 && level < level_changes.size(); level--) {
+    auto root_change = level_changes[level].find("");
+    if (root_change == level_changes[level].end() || !root_change->second.new_entry ||
+        root_change->second.new_entry->children > 1) {
+      break;
+    }
+    s = batch->Delete(score_cf_handle_, rankIndexKey(ns_key, metadata->version, level, ""));
+    if (!s.ok()) return s;
+  }
+
+  if (indexed) return rocksdb::Status::OK();
+  metadata->SetRankIndex(true);
+  std::string bytes;
+  metadata->Encode(&bytes);
+  return batch->Put(metadata_cf_handle_, ns_key, bytes);
+}
+
+rocksdb::Status ZSet::rankByIndex(engine::Context &ctx, const Slice &ns_key, const ZSetMetadata &metadata,
+                                  const Slice &score_subkey, uint64_t *rank) {
+  *rank = 0;
+
+  std::string index_begin = scoreKey(ns_key, metadata.version, kRankIndexPrefix);
+  std::string index_end = scoreKey(ns_key, metadata.version, kRankIndexEnd);
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice lower_bound(index_begin);
+  rocksdb::Slice upper_bound(index_end);
+  read_options.iterate_lower_bound = &lower_bound;
+  read_options.iterate_upper_bound = &upper_bound;
+  auto iter = util::UniqueIterator(ctx, read_options, score_cf_handle_);
+
+  uint8_t level = 0;
+  std::string boundary;
+  auto parse = [&iter, this](uint8_t *entry_level, std::string *entry_boundary) {
+    ParseRankIndexSubKey(InternalKey(iter->key(), storage_->IsSlotIdEncoded()).GetSubKey(), entry_level,
+                         entry_boundary);
+  };
+
+  iter->SeekForPrev(rankIndexKey(ns_key, metadata.version, 0, score_subkey));
+  if (!iter->Valid()) {
+    return iter->status().ok() ? rocksdb::Status::Corruption("zset rank index has no leaf for the member")
+                               : iter->status();
+  }
+  parse(&level, &boundary);
+  if (level != 0) return rocksdb::Status::Corruption("zset rank index has no leaf for the member");
+
+  // count the members of the leaf which are ahead of the target
+  uint64_t before = 0;
+  {
+    std::string start_key = scoreKey(ns_key, metadata.version, boundary.empty() ? MinScoreSubKey() : boundary);
+    std::string end_key = scoreKey(ns_key, metadata.version, score_subkey);
+    rocksdb::ReadOptions leaf_read_options = ctx.DefaultScanOptions();
+    rocksdb::Slice leaf_lower_bound(start_key);
+    rocksdb::Slice leaf_upper_bound(end_key);
+    leaf_read_options.iterate_lower_bound = &leaf_lower_bound;
+    leaf_read_options.iterate_upper_bound = &leaf_upper_bound;
+
+    auto leaf_iter = util::UniqueIterator(ctx, leaf_read_options, score_cf_handle_);
+    for (leaf_iter->Seek(start_key); leaf_iter->Valid(); leaf_iter->Next()) {
+      before++;
+    }
+    if (!leaf_iter->status().ok()) return leaf_iter->status();
+  }
+
+  // then add up the entries ahead of it in its parent, and so on up to the root
+  for (level = 1;; level++) {
+    iter->SeekForPrev(rankIndexKey(ns_key, metadata.version, level, boundary));
+    if (!iter->Valid()) {
+      return iter->status().ok() ? rocksdb::Status::Corruption("zset rank index has no node for the entry")
+                                 : iter->status();
+    }
+    uint8_t parent_level = 0;
+    std::string parent_boundary;
+    parse(&parent_level, &parent_boundary);
+    // the level below holds the root
+    if (parent_level != level) break;
+
+    std::string end_key = rankIndexKey(ns_key, metadata.version, level - 1, boundary);
+    for (iter->Seek(rankIndexKey(ns_key, metadata.version, level - 1, parent_boundary));
+         iter->Valid() && iter->key().compare(end_key) < 0; iter->Next()) {
+      RankIndexEntry entry;
+      auto s = decodeRankIndexEntry(level - 1, iter->value(), &entry);
+      if (!s.ok()) return s;
+      before += entry.count;
+    }
+    if (!iter->status().ok()) return iter->status();
+    boundary = std::move(parent_boundary);
+  }
+
+  *rank = before;
+  return rocksdb::Status::OK();
+}
+
+rocksdb::Status ZSet::seekByIndex(engine::Context &ctx, const Slice &ns_key, const ZSetMetadata &metadata,
+                                  uint64_t pos, std::string *leaf_start, uint64_t *leaf_rank) {
+  uint8_t top_level = 0;
+  RankIndexEntry root;
+  auto s = getRankIndexTopLevel(ctx, ns_key, metadata.version, &top_level, &root);
+  if (!s.ok()) return s;
+  if (root.count != metadata.size) {
+    return rocksdb::Status::Corruption("zset rank index is inconsistent with the members");
+  }
+
+  std::string index_begin = scoreKey(ns_key, metadata.version, kRankIndexPrefix);
+  std::string index_end = scoreKey(ns_key, metadata.version, kRankIndexEnd);
+
+  rocksdb::ReadOptions read_options = ctx.DefaultScanOptions();
+  rocksdb::Slice lower_bound(index_begin);
+  rocksdb::Slice upper_bound(index_end);
+  read_options.iterate_lower_bound = &lower_bound;
+  read_options.iterate_upper_bound = &upper_bound;
+  auto iter = util::UniqueIterator(ctx, read_options, score_cf_handle_);
+
+  // descend from the root to the leaf which holds the position, the children of an entry are the entries
+  // of the level below from its boundary up to the boundary of the next entry of its level
+  std::string boundary;
+  std::optional<std::string> upper;
+  uint64_t rank = 0;
+  for (int level = top_level - 1; level >= 0; level--) {
+    auto child_level = static_cast<uint8_t>(level);
+    std::string end_key = upper ? rankIndexKey(ns_key, metadata.version, child_level, *upper)
+                                : rankIndexKey(ns_key, metadata.version, child_level + 1, "");
+    bool found = false;
+    for (iter->Seek(rankIndexKey(ns_key, metadata.version, child_level, boundary));
+         iter->Valid() && iter->key().compare(end_key) < 0; iter->Next()) {
+      RankIndexEntry entry;
+      s = decodeRankIndexEntry(child_level, iter->value(), &entry);
+      if (!s.ok()) return s;
+      if (rank + entry.count <= pos) {
+        rank += entry.count;
+        continue;
+      }
+
+      uint8_t entry_level = 0;
+      ParseRankIndexSubKey(InternalKey(iter->key(), storage_->IsSlotIdEncoded()).GetSubKey(), &entry_level, &boundary);
+      upper.reset();
+      iter->Next();
+      if (iter->Valid()) {
+        std::string next_boundary;
+        ParseRankIndexSubKey(InternalKey(iter->key(), storage_->IsSlotIdEncoded()).GetSubKey(), &entry_level,
+                             &next_boundary);
+        if (entry_level == child_level) upper = std::move(next_boundary);
+      }
+      found = true;
+      break;
+    }
+    if (!iter->status().ok()) return iter->status();
+    if (!found) return rocksdb::Status::Corruption("zset rank index is inconsistent with the members");
+  }
+
+  *leaf_start = boundary.empty() ? MinScoreSubKey() : boundary;
+  *leaf_rank = rank;
+  return rocksdb::Status::OK();
+}
+
 }  // namespace redis
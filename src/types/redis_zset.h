@@ -22,7 +22,9 @@
 
 #include <limits>
 #include <map>
+#include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "common/range_spec.h"
@@ -87,6 +89,16 @@ class ZAddFlags {
 
 namespace redis {
 
+// The rank index is an optional structure stored in the zset_score column family beside the
+// score entries of a large sorted set. It splits the score order into leaves of members and
+// records the number of members of each leaf, then groups the leaves into nodes level by level
+// up to a single root, so that rank based lookups only walk a few entries of each level and a
+// single leaf instead of every member preceding the target.
+constexpr uint64_t kZSetRankIndexLeafMaxSize = 1024;
+constexpr uint64_t kZSetRankIndexLeafMinSize = kZSetRankIndexLeafMaxSize / 4;
+constexpr uint64_t kZSetRankIndexNodeMaxSize = 64;
+constexpr uint64_t kZSetRankIndexNodeMinSize = kZSetRankIndexNodeMaxSize / 4;
+
 class ZSet : public SubKeyScanner {
  public:
   explicit ZSet(engine::Storage *storage, const std::string &ns)
@@ -138,8 +150,66 @@ class ZSet : public SubKeyScanner {
                                      std::vector<MemberScore> *member_scores);
   rocksdb::Status RandMember(engine::Context &ctx, const Slice &user_key, int64_t command_count,
                              std::vector<MemberScore> *member_scores);
+  // Whether the subkey of the zset_score column family belongs to the rank index rather than to a member.
+  // The index is local to each node, so the raw migration leaves it out and the destination rebuilds it.
+  static bool IsRankIndexSubKey(const Slice &score_subkey);
+  // Clear the rank index flag of the raw metadata if it's a sorted set, for the copies without the index
+  static void ClearRankIndexFlag(std::string *raw_metadata);
 
  private:
+  // The score subkeys (encoded score followed by member) added and removed by a single write
+  struct ScoreKeyChanges {
+    std::vector<std::string> added;
+    std::vector<std::string> removed;
+  };
+
+  // An entry of the rank index, the members of a leaf or the members and the entries of the level below of a node
+  struct RankIndexEntry {
+    uint64_t count = 0;
+    uint64_t children = 0;
+
+    bool operator==(const RankIndexEntry &that) const { return count == that.count && children == that.children; }
+  };
+  // The change of an index entry made by a single write, the old entry is empty if it was added
+  // and the new one is empty if it was removed
+  struct RankIndexChange {
+    std::optional<RankIndexEntry> old_entry;
+    std::optional<RankIndexEntry> new_entry;
+  };
+  // The changes of a level of the index, keyed by the boundaries of the entries
+  using RankIndexChanges = std::map<std::string, RankIndexChange>;
+
+  static std::string encodeRankIndexEntry(uint8_t level, const RankIndexEntry &entry);
+  static rocksdb::Status decodeRankIndexEntry(uint8_t level, Slice value, RankIndexEntry *entry);
+
+  std::string scoreKey(const Slice &ns_key, uint64_t version, const Slice &score_subkey) const;
+  std::string rankIndexKey(const Slice &ns_key, uint64_t version, uint8_t level, const Slice &boundary) const;
+  rocksdb::Status getRankIndexTopLevel(engine::Context &ctx, const Slice &ns_key, uint64_t version, uint8_t *level,
+                                       RankIndexEntry *root);
+  rocksdb::Status dropRankIndex(engine::Context &ctx, const Slice &ns_key, uint64_t version,
+                                rocksdb::WriteBatchBase *batch);
+  rocksdb::Status splitRankIndexLeaf(engine::Context &ctx, const Slice &ns_key, uint64_t version,
+                                     const std::string &boundary, const std::optional<std::string> &upper,
+                                     const ScoreKeyChanges &changes, uint64_t count,
+                                     std::vector<std::pair<std::string, RankIndexEntry>> *pieces);
+  rocksdb::Status splitRankIndexNode(engine::Context &ctx, const Slice &ns_key, uint64_t version, uint8_t level,
+                                     const std::string &boundary, const std::optional<std::string> &upper,
+                                     const RankIndexChanges &child_changes,
+                                     std::vector<std::pair<std::string, RankIndexEntry>> *pieces);
+  rocksdb::Status updateRankIndexLeaves(engine::Context &ctx, const Slice &ns_key, uint64_t version, bool indexed,
+                                        uint64_t old_size, ScoreKeyChanges *changes, RankIndexChanges *leaf_changes,
+                                        rocksdb::WriteBatchBase *batch);
+  rocksdb::Status updateRankIndexNodes(engine::Context &ctx, const Slice &ns_key, uint64_t version, uint8_t level,
+                                       const std::optional<RankIndexEntry> &new_level_root,
+                                       const RankIndexChanges &child_changes, RankIndexChanges *node_changes,
+                                       rocksdb::WriteBatchBase *batch);
+  rocksdb::Status updateRankIndex(engine::Context &ctx, const Slice &ns_key, ZSetMetadata *metadata, uint64_t old_size,
+                                  ScoreKeyChanges *changes, rocksdb::WriteBatchBase *batch);
+  rocksdb::Status rankByIndex(engine::Context &ctx, const Slice &ns_key, const ZSetMetadata &metadata,
+                              const Slice &score_subkey, uint64_t *rank);
+  rocksdb::Status seekByIndex(engine::Context &ctx, const Slice &ns_key, const ZSetMetadata &metadata, uint64_t pos,
+                              std::string *leaf_start, uint64_t *leaf_rank);
+
   rocksdb::ColumnFamilyHandle *score_cf_handle_;
 };
 
@@ -0,0 +1,141 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "storage/active_expire.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+#include "test_base.h"
+#include "time_util.h"
+#include "types/redis_hash.h"
+#include "types/redis_zset.h"
+
+class ActiveExpireTest : public TestBase {
+ protected:
+  explicit ActiveExpireTest() = default;
+  ~ActiveExpireTest() override = default;
+
+  void SetUp() override { hash_ = std::make_unique<redis::Hash>(storage_.get(), "active_expire_ns"); }
+
+  void flushMetadata() {
+    auto s = storage_->GetDB()->Flush(rocksdb::FlushOptions(), storage_->GetCFHandle(ColumnFamilyID::Metadata));
+    ASSERT_TRUE(s.ok());
+  }
+
+  std::unique_ptr<redis::Hash> hash_;
+};
+
+TEST_F(ActiveExpireTest, ExpireDueKeys) {
+  uint64_t ret = 0;
+  for (int i = 0; i < 25; i++) {
+    key_ = "expired_key_" + std::to_string(i);
+    ASSERT_TRUE(hash_->Set(*ctx_, key_, "f1", "v1", &ret).ok());
+    ASSERT_TRUE(hash_->Set(*ctx_, key_, "f2", "v2", &ret).ok());
+    ASSERT_TRUE(hash_->Expire(*ctx_, key_, 1).ok());
+  }
+  ASSERT_TRUE(hash_->Set(*ctx_, "ttl_key", "f1", "v1", &ret).ok());
+  ASSERT_TRUE(hash_->Expire(*ctx_, "ttl_key", util::GetTimeStampMS() + 3600 * 1000).ok());
+  ASSERT_TRUE(hash_->Set(*ctx_, "persistent_key", "f1", "v1", &ret).ok());
+  flushMetadata();
+
+  // the cycles are bounded by the number of keys to expire and resume where the last one stopped
+  ActiveExpirer expirer(storage_.get());
+  EXPECT_EQ(expirer.RunCycle(10), 10U);
+  EXPECT_EQ(expirer.RunCycle(10), 10U);
+  EXPECT_EQ(expirer.RunCycle(10), 5U);
+  EXPECT_EQ(expirer.RunCycle(10), 0U);
+  EXPECT_EQ(storage_->GetDBStats()->expired_keys.load(), 25U);
+  EXPECT_GT(storage_->GetDBStats()->expire_lag_ms.load(), 0U);
+
+  // both the metadata and the subkeys of the expired keys are gone
+  auto new_iterator = [this](ColumnFamilyID cf) {
+    return std::unique_ptr<rocksdb::Iterator>(
+        storage_->GetDB()->NewIterator(rocksdb::ReadOptions(), storage_->GetCFHandle(cf)));
+  };
+  int keys = 0;
+  auto iter = new_iterator(ColumnFamilyID::Metadata);
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), keys++) {
+    auto [_, user_key] = ExtractNamespaceKey(iter->key(), storage_->IsSlotIdEncoded());
+    EXPECT_TRUE(user_key.ToString() == "ttl_key" || user_key.ToString() == "persistent_key");
+  }
+  EXPECT_EQ(keys, 2);
+
+  keys = 0;
+  iter = new_iterator(ColumnFamilyID::PrimarySubkey);
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), keys++) {
+    InternalKey ikey(iter->key(), storage_->IsSlotIdEncoded());
+    EXPECT_TRUE(ikey.GetKey().ToString() == "ttl_key" || ikey.GetKey().ToString() == "persistent_key");
+  }
+  EXPECT_EQ(keys, 2);
+}
+
+TEST_F(ActiveExpireTest, SkipOverwrittenKeys) {
+  uint64_t ret = 0;
+  key_ = "overwritten_key";
+  ASSERT_TRUE(hash_->Set(*ctx_, key_, "f1", "v1", &ret).ok());
+  ASSERT_TRUE(hash_->Expire(*ctx_, key_, util::GetTimeStampMS() + 50).ok());
+  flushMetadata();
+  usleep(100000);
+
+  // the key expired after the flush, but was written again before the cycle
+  engine::Context ctx(storage_.get());
+  ASSERT_TRUE(hash_->Set(ctx, key_, "f2", "v2", &ret).ok());
+
+  auto zset = std::make_unique<redis::ZSet>(storage_.get(), "active_expire_ns");
+  std::vector<MemberScore> member_scores = {MemberScore{"m1", 1.0}, MemberScore{"m2", 2.0}};
+  ASSERT_TRUE(zset->Add(ctx, "zset_key", ZAddFlags::Default(), &member_scores, &ret).ok());
+  ASSERT_TRUE(zset->Expire(ctx, "zset_key", 1).ok());
+  flushMetadata();
+
+  ActiveExpirer expirer(storage_.get());
+  EXPECT_EQ(expirer.RunCycle(100), 1U);
+
+  engine::Context check_ctx(storage_.get());
+  std::string value;
+  EXPECT_TRUE(hash_->Get(check_ctx, key_, "f2", &value).ok());
+  EXPECT_EQ(value, "v2");
+  std::unique_ptr<rocksdb::Iterator> iter(storage_->GetDB()->NewIterator(
+      rocksdb::ReadOptions(), storage_->GetCFHandle(ColumnFamilyID::SecondarySubkey)));
+  iter->SeekToFirst();
+  EXPECT_FALSE(iter->Valid());
+}
+
+TEST_F(ActiveExpireTest, RefreshFilesAfterFlush) {
+  uint64_t ret = 0;
+  ActiveExpirer expirer(storage_.get());
+  EXPECT_EQ(expirer.RunCycle(100), 0U);
+
+  // the keys in the memtables aren't seen until they're flushed
+  for (int i = 0; i < 5; i++) {
+    key_ = "flushed_key_" + std::to_string(i);
+    ASSERT_TRUE(hash_->Set(*ctx_, key_, "f1", "v1", &ret).ok());
+    ASSERT_TRUE(hash_->Expire(*ctx_, key_, 1).ok());
+  }
+  EXPECT_EQ(expirer.RunCycle(100), 0U);
+
+  auto files_version = storage_->GetMetadataFilesVersion();
+  flushMetadata();
+  EXPECT_GT(storage_->GetMetadataFilesVersion(), files_version);
+  EXPECT_EQ(expirer.RunCycle(100), 5U);
+  EXPECT_EQ(expirer.RunCycle(100), 0U);
+}
@@ -20,8 +20,10 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
 #include <filesystem>
 
+#include "storage/compact_filter.h"
 #include "storage/redis_metadata.h"
 #include "storage/storage.h"
 #include "types/redis_hash.h"
@@ -132,3 +134,105 @@ TEST(Compact, Filter) {
     std::cout << "Encounter filesystem error: " << ec << std::endl;
   }
 }
+
+// Compact a big deleted hash next to a live one, and check only the subkeys of the live hash are left.
+// The time of the compaction is printed if report is set.
+static void CompactDeletedHash(const std::string &db_dir, int fields, bool report) {
+  Config config;
+  config.db_dir = db_dir;
+  config.slot_id_encoded = false;
+
+  auto storage = std::make_unique<engine::Storage>(&config);
+  Status s = storage->Open();
+  ASSERT_TRUE(s.IsOK());
+
+  std::string ns = "test_compact";
+  auto hash = std::make_unique<redis::Hash>(storage.get(), ns);
+  std::string deleted_hash_key = "deleted_hash_key";
+  std::string live_hash_key = "live_hash_key";
+  {
+    // the context holds a snapshot which would disable the range skipping, so release it before compacting
+    engine::Context ctx(storage.get());
+    uint64_t ret = 0;
+    std::vector<FieldValue> field_values;
+    for (int i = 0; i < fields; i++) {
+      field_values.emplace_back("field" + std::to_string(i), "value" + std::to_string(i));
+      if (field_values.size() == 1000 || i == fields - 1) {
+        ASSERT_TRUE(hash->MSet(ctx, deleted_hash_key, field_values, false, &ret).ok());
+        field_values.clear();
+      }
+    }
+    ASSERT_TRUE(hash->Set(ctx, live_hash_key, "f1", "v1", &ret).ok());
+    ASSERT_TRUE(storage->Compact(nullptr, nullptr, nullptr).ok());
+    ASSERT_TRUE(hash->Del(ctx, deleted_hash_key).ok());
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_TRUE(storage->Compact(nullptr, nullptr, nullptr).ok());
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (report) {
+    std::cout << "compacted " << fields << " subkeys of a deleted key in " << elapsed * 1000 << " ms, "
+              << fields / elapsed << " subkeys per second" << std::endl;
+  }
+
+  rocksdb::DB *db = storage->GetDB();
+  rocksdb::ReadOptions read_options;
+  read_options.fill_cache = false;
+  std::unique_ptr<rocksdb::Iterator> iter(
+      db->NewIterator(read_options, storage->GetCFHandle(ColumnFamilyID::PrimarySubkey)));
+  int live_subkeys = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    InternalKey ikey(iter->key(), storage->IsSlotIdEncoded());
+    EXPECT_EQ(ikey.GetKey().ToString(), live_hash_key);
+    live_subkeys++;
+  }
+  EXPECT_EQ(live_subkeys, 1);
+  iter.reset();
+
+  storage.reset();
+  std::error_code ec;
+  std::filesystem::remove_all(config.db_dir, ec);
+  if (ec) {
+    std::cout << "Encounter filesystem error: " << ec << std::endl;
+  }
+}
+
+TEST(Compact, SkipDeadVersions) {
+  Config config;
+  config.db_dir = "compactdb_skip";
+  config.slot_id_encoded = false;
+
+  auto storage = std::make_unique<engine::Storage>(&config);
+  Status s = storage->Open();
+  ASSERT_TRUE(s.IsOK());
+
+  std::string ns = "test_compact";
+  std::string ns_key = ComposeNamespaceKey(ns, "missing_key", storage->IsSlotIdEncoded());
+  auto subkey = InternalKey(ns_key, "field", 42, storage->IsSlotIdEncoded()).Encode();
+  auto next_version = InternalKey(ns_key, "", 43, storage->IsSlotIdEncoded()).Encode();
+  std::string new_value, skip_until;
+
+  engine::SubKeyFilter filter(storage.get(), true);
+  auto decision = filter.FilterV2(0, subkey, rocksdb::CompactionFilter::ValueType::kValue, "v", &new_value,
+                                  &skip_until);
+  EXPECT_EQ(decision, rocksdb::CompactionFilter::Decision::kRemoveAndSkipUntil);
+  EXPECT_EQ(skip_until, next_version);
+
+  engine::SubKeyFilter no_skip_filter(storage.get(), false);
+  decision = no_skip_filter.FilterV2(0, subkey, rocksdb::CompactionFilter::ValueType::kValue, "v", &new_value,
+                                     &skip_until);
+  EXPECT_EQ(decision, rocksdb::CompactionFilter::Decision::kRemove);
+
+  storage.reset();
+  std::error_code ec;
+  std::filesystem::remove_all(config.db_dir, ec);
+  if (ec) {
+    std::cout << "Encounter filesystem error: " << ec << std::endl;
+  }
+
+  CompactDeletedHash("compactdb_skip_hash", 2000, false);
+}
+
+// It reports the compaction speed of a deleted hash with 200k fields, and is only run with
+// --gtest_also_run_disabled_tests
+TEST(Compact, DISABLED_SkipDeadVersionsBenchmark) { CompactDeletedHash("compactdb_skip_bench", 200000, true); }
@@ -0,0 +1,75 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "compression_util.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+TEST(CompressionUtil, RoundTrip) {
+  std::string data;
+  for (int i = 0; i < 10000; i++) data += "value-" + std::to_string(i % 100);
+
+  for (auto type : {StreamCompression::kNone, StreamCompression::kLZ4, StreamCompression::kZSTD}) {
+    auto frame = util::CompressFrame(type, data);
+    ASSERT_TRUE(frame) << frame.Msg();
+    ASSERT_EQ(static_cast<StreamCompression>((*frame)[0]), type);
+    if (type != StreamCompression::kNone) ASSERT_LT(frame->size(), data.size());
+
+    auto decompressed = util::DecompressFrame(*frame);
+    ASSERT_TRUE(decompressed) << decompressed.Msg();
+    ASSERT_EQ(*decompressed, data);
+  }
+}
+
+TEST(CompressionUtil, IncompressibleData) {
+  // the data is kept raw if the compression doesn't make it smaller
+  for (auto type : {StreamCompression::kLZ4, StreamCompression::kZSTD}) {
+    for (const std::string data : {"", "a", "abc"}) {
+      auto frame = util::CompressFrame(type, data);
+      ASSERT_TRUE(frame);
+      ASSERT_EQ(frame->size(), util::kStreamFrameHeaderSize + data.size());
+      ASSERT_EQ(static_cast<StreamCompression>((*frame)[0]), StreamCompression::kNone);
+      ASSERT_EQ(*util::DecompressFrame(*frame), data);
+    }
+  }
+}
+
+TEST(CompressionUtil, MalformedFrame) {
+  std::string data(4096, 'a');
+  for (auto type : {StreamCompression::kNone, StreamCompression::kLZ4, StreamCompression::kZSTD}) {
+    auto frame = *util::CompressFrame(type, data);
+    ASSERT_FALSE(util::DecompressFrame(frame.substr(0, frame.size() - 1)));
+    ASSERT_FALSE(util::DecompressFrame(frame.substr(0, 3)));
+  }
+
+  auto frame = *util::CompressFrame(StreamCompression::kLZ4, data);
+  frame[0] = 9;
+  ASSERT_FALSE(util::DecompressFrame(frame));
+}
+
+TEST(CompressionUtil, ParseName) {
+  for (auto type : {StreamCompression::kNone, StreamCompression::kLZ4, StreamCompression::kZSTD}) {
+    ASSERT_EQ(*util::ParseStreamCompression(util::StreamCompressionName(type)), type);
+  }
+  ASSERT_EQ(*util::ParseStreamCompression("LZ4"), StreamCompression::kLZ4);
+  ASSERT_FALSE(util::ParseStreamCompression("gzip"));
+}
@@ -0,0 +1,105 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "search/hnsw_graph_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+static redis::HnswGraphCache::Vector MakeVector(size_t dim) {
+  return std::make_shared<const kqir::NumericArray>(dim, 1.0);
+}
+
+static redis::HnswGraphCache::Keys MakeKeys(std::vector<std::string> keys) {
+  return std::make_shared<const std::vector<std::string>>(std::move(keys));
+}
+
+TEST(HnswGraphCache, GetAndPut) {
+  redis::HnswGraphCache cache(1024 * 1024);
+  EXPECT_EQ(cache.GetVector("node"), nullptr);
+
+  cache.PutVector("node", MakeVector(3), cache.Generation());
+  cache.PutKeys("edges", MakeKeys({"a", "b"}), cache.Generation());
+  ASSERT_NE(cache.GetVector("node"), nullptr);
+  EXPECT_EQ(cache.GetVector("node")->size(), 3U);
+  ASSERT_NE(cache.GetKeys("edges"), nullptr);
+  EXPECT_EQ(*cache.GetKeys("edges"), std::vector<std::string>({"a", "b"}));
+  // A key holding the other kind of value is a miss
+  EXPECT_EQ(cache.GetKeys("node"), nullptr);
+  EXPECT_TRUE(cache.Contains("node"));
+
+  auto stats = cache.GetStats();
+  EXPECT_EQ(stats.entries, 2U);
+  EXPECT_EQ(stats.hits, 4U);
+  EXPECT_EQ(stats.misses, 2U);
+  EXPECT_GT(stats.usage, 0U);
+
+  cache.Clear();
+  EXPECT_EQ(cache.GetStats().entries, 0U);
+  EXPECT_EQ(cache.GetStats().usage, 0U);
+  EXPECT_FALSE(cache.Contains("node"));
+}
+
+TEST(HnswGraphCache, EvictRejectsStaleFills) {
+  redis::HnswGraphCache cache(1024 * 1024);
+  cache.PutVector("node", MakeVector(3), cache.Generation());
+
+  // A reader took the generation before the writer evicted what it changed
+  auto generation = cache.Generation();
+  cache.Evict({"node"}, 10);
+  EXPECT_FALSE(cache.Contains("node"));
+  EXPECT_EQ(cache.EvictedSequence(), 10U);
+  cache.PutVector("node", MakeVector(3), generation);
+  EXPECT_FALSE(cache.Contains("node"));
+
+  cache.PutVector("node", MakeVector(3), cache.Generation());
+  EXPECT_TRUE(cache.Contains("node"));
+
+  // The evicted sequence never goes back
+  cache.Evict({"other"}, 5);
+  EXPECT_EQ(cache.EvictedSequence(), 10U);
+}
+
+TEST(HnswGraphCache, Capacity) {
+  redis::HnswGraphCache cache;
+  EXPECT_FALSE(cache.Enabled());
+  cache.PutVector("node", MakeVector(3), cache.Generation());
+  EXPECT_EQ(cache.GetVector("node"), nullptr);
+
+  cache.SetCapacity(64 * 1024);
+  EXPECT_TRUE(cache.Enabled());
+  for (int i = 0; i < 1000; i++) {
+    cache.PutVector("node" + std::to_string(i), MakeVector(16), cache.Generation());
+  }
+  auto stats = cache.GetStats();
+  EXPECT_LE(stats.usage, 64U * 1024);
+  EXPECT_LT(stats.entries, 1000U);
+  EXPECT_GT(stats.entries, 0U);
+  // The recently put entries are kept rather than the old ones
+  EXPECT_TRUE(cache.Contains("node999"));
+  EXPECT_FALSE(cache.Contains("node0"));
+
+  cache.SetCapacity(0);
+  EXPECT_FALSE(cache.Enabled());
+  EXPECT_EQ(cache.GetStats().entries, 0U);
+}
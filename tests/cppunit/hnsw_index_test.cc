@@ -21,9 +21,12 @@
 #include <gtest/gtest.h>
 #include <test_base.h>
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <memory>
 #include <random>
+#include <unordered_set>
 
 #include "search/hnsw_indexer.h"
 #include "search/indexer.h"
@@ -608,3 +611,141 @@ TEST_F(HnswIndexTest, SearchKnnAndRange) {
   expected = {"key11"};
   EXPECT_EQ(key_strs, expected);
 }
+
+// Build a FLOAT64 and a FLOAT32 index of the same random vectors, and return the recall@10 of both.
+// The recall and the QPS of the searches are printed if report is set.
+static std::pair<double, double> MeasureFloat32AndFloat64Recall(engine::Storage* storage, const std::string& ns,
+                                                                const std::string& key, size_t num_vectors,
+                                                                size_t num_queries, bool report) {
+  constexpr uint16_t dim = 32;
+  constexpr uint32_t k = 10;
+
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> value_dist(-1, 1);
+  auto random_vector = [&] {
+    kqir::NumericArray vec(dim);
+    for (auto& v : vec) v = value_dist(gen);
+    return vec;
+  };
+  std::vector<kqir::NumericArray> vectors(num_vectors);
+  for (auto& vec : vectors) vec = random_vector();
+  std::vector<kqir::NumericArray> queries(num_queries);
+  for (auto& query : queries) query = random_vector();
+  // Both indexes get the same layers, so they only differ in the element type
+  std::vector<uint16_t> layers(num_vectors);
+  std::geometric_distribution<uint16_t> layer_dist(0.75);
+  for (auto& layer : layers) layer = std::min<uint16_t>(layer_dist(gen), 3);
+
+  engine::Context ctx(storage);
+  auto measure = [&](redis::VectorType vector_type, const std::string& name) {
+    redis::HnswVectorFieldMetadata field_meta;
+    field_meta.vector_type = vector_type;
+    field_meta.dim = dim;
+    field_meta.m = 16;
+    field_meta.ef_runtime = 20;
+    field_meta.distance_metric = redis::DistanceMetric::L2;
+    redis::HnswIndex index(redis::SearchKey(ns, name, key), &field_meta, storage);
+    for (size_t i = 0; i < num_vectors; i++) {
+      InsertEntryIntoHnswIndex(ctx, "key" + std::to_string(i), vectors[i], layers[i], &index, storage);
+    }
+
+    size_t hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& query : queries) {
+      auto result = index.KnnSearch(ctx, query, k);
+      EXPECT_TRUE(result.IsOK());
+      if (!result) continue;
+
+      std::vector<std::pair<double, size_t>> exact;
+      for (size_t i = 0; i < num_vectors; i++) {
+        double dist = 0;
+        for (size_t j = 0; j < dim; j++) dist += (query[j] - vectors[i][j]) * (query[j] - vectors[i][j]);
+        exact.emplace_back(dist, i);
+      }
+      std::partial_sort(exact.begin(), exact.begin() + k, exact.end());
+      std::unordered_set<std::string> expected;
+      for (size_t i = 0; i < k; i++) expected.emplace("key" + std::to_string(exact[i].second));
+      for (const auto& [dist, found_key] : *result) hits += expected.count(found_key);
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double recall = double(hits) / double(num_queries * k);
+    if (report) {
+      std::cout << name << ": recall@" << k << " " << recall << ", " << double(num_queries) / elapsed << " QPS"
+                << std::endl;
+    }
+    return recall;
+  };
+
+  auto recall_f64 = measure(redis::VectorType::FLOAT64, "hnsw_float64_idx");
+  auto recall_f32 = measure(redis::VectorType::FLOAT32, "hnsw_float32_idx");
+  return {recall_f64, recall_f32};
+}
+
+TEST_F(HnswIndexTest, Float32Recall) {
+  auto [recall_f64, recall_f32] = MeasureFloat32AndFloat64Recall(storage_.get(), ns, key, 100, 20, false);
+  EXPECT_NEAR(recall_f32, recall_f64, 0.1);
+}
+
+// It reports the recall and the QPS of the bigger indexes, and is only run with --gtest_also_run_disabled_tests
+TEST_F(HnswIndexTest, DISABLED_Float32RecallAndQps) {
+  auto [recall_f64, recall_f32] = MeasureFloat32AndFloat64Recall(storage_.get(), ns, key, 2000, 200, true);
+  EXPECT_NEAR(recall_f32, recall_f64, 0.1);
+}
+
+TEST_F(HnswIndexTest, GraphCacheFollowsUpdates) {
+  constexpr size_t num_vectors = 50;
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> value_dist(-10, 10);
+  auto random_vector = [&] { return kqir::NumericArray{value_dist(gen), value_dist(gen), value_dist(gen)}; };
+
+  redis::HnswGraphCache cache(1 * MiB);
+  hnsw_index->cache = &cache;
+  auto ctx = engine::Context::NoTransactionContext(storage_.get());
+  for (size_t i = 0; i < num_vectors; i++) {
+    InsertEntryIntoHnswIndex(ctx, "key" + std::to_string(i), random_vector(), i % 3 == 0 ? 1 : 0, hnsw_index.get(),
+                             storage_.get());
+    hnsw_index->EvictModifiedFromCache();
+  }
+
+  // The same index without the cache reads everything from RocksDB
+  redis::HnswIndex uncached(hnsw_index->search_key, &metadata, storage_.get());
+  auto verify_same_results = [&](const kqir::NumericArray& query) {
+    auto cached_result = hnsw_index->KnnSearch(ctx, query, 5);
+    ASSERT_TRUE(cached_result.IsOK());
+    auto uncached_result = uncached.KnnSearch(ctx, query, 5);
+    ASSERT_TRUE(uncached_result.IsOK());
+    EXPECT_EQ(GetVectorKeys(*cached_result), GetVectorKeys(*uncached_result));
+    return GetVectorKeys(*cached_result);
+  };
+
+  auto query = random_vector();
+  verify_same_results(query);
+  auto hits = cache.GetStats().hits;
+  auto nearest = verify_same_results(query);
+  EXPECT_GT(cache.GetStats().hits, hits);
+  ASSERT_FALSE(nearest.empty());
+
+  // The deleted node and its edges must not be served from the cache anymore
+  auto batch = storage_->GetWriteBatchBase();
+  ASSERT_TRUE(hnsw_index->DeleteVectorEntry(ctx, nearest[0], batch).IsOK());
+  ASSERT_TRUE(storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch()).ok());
+  hnsw_index->EvictModifiedFromCache();
+  auto result = verify_same_results(query);
+  EXPECT_EQ(std::find(result.begin(), result.end(), nearest[0]), result.end());
+
+  // A vector inserted at the query itself must be found first
+  InsertEntryIntoHnswIndex(ctx, "inserted", query, 0, hnsw_index.get(), storage_.get());
+  hnsw_index->EvictModifiedFromCache();
+  result = verify_same_results(query);
+  ASSERT_FALSE(result.empty());
+  EXPECT_EQ(result[0], "inserted");
+
+  cache.Clear();
+  EXPECT_EQ(cache.GetStats().entries, 0U);
+  ASSERT_TRUE(hnsw_index->WarmCache(ctx).IsOK());
+  EXPECT_GT(cache.GetStats().entries, num_vectors);
+  hits = cache.GetStats().hits;
+  verify_same_results(random_vector());
+  EXPECT_GT(cache.GetStats().hits, hits);
+}
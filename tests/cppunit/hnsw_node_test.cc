@@ -111,6 +111,37 @@ TEST_F(NodeTest, PutAndDecodeMetadata) {
   EXPECT_EQ(node3.neighbours[0], "node2");
 }
 
+TEST_F(NodeTest, PutAndDecodeFloat32Metadata) {
+  redis::HnswNode node("node1", 0);
+  redis::HnswNodeFieldMetadata metadata(2, {1.5, -2.25, 3}, redis::VectorType::FLOAT32);
+
+  std::string encoded;
+  metadata.Encode(&encoded);
+  EXPECT_EQ(encoded.size(), 2 + 2 + 3 * sizeof(float));
+
+  auto batch = storage_->GetWriteBatchBase();
+  auto s = node.PutMetadata(&metadata, search_key, storage_.get(), batch.Get());
+  ASSERT_TRUE(s.IsOK());
+  engine::Context ctx(storage_.get());
+  ASSERT_TRUE(storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch()).ok());
+
+  auto decoded = node.DecodeMetadata(ctx, search_key);
+  ASSERT_TRUE(decoded.IsOK());
+  EXPECT_EQ(decoded->num_neighbours, 2);
+  EXPECT_EQ(decoded->vector_type, redis::VectorType::FLOAT32);
+  EXPECT_EQ(decoded->vector, std::vector<double>({1.5, -2.25, 3}));
+
+  // Updating the neighbours keeps the float32 encoding
+  batch = storage_->GetWriteBatchBase();
+  s = node.AddNeighbour(ctx, "node2", search_key, batch.Get());
+  ASSERT_TRUE(s.IsOK());
+  ASSERT_TRUE(storage_->Write(ctx, storage_->DefaultWriteOptions(), batch->GetWriteBatch()).ok());
+  decoded = node.DecodeMetadata(ctx, search_key);
+  ASSERT_TRUE(decoded.IsOK());
+  EXPECT_EQ(decoded->num_neighbours, 3);
+  EXPECT_EQ(decoded->vector_type, redis::VectorType::FLOAT32);
+}
+
 TEST_F(NodeTest, ModifyNeighbours) {
   uint16_t layer = 1;
   redis::HnswNode node1("node1", layer);
@@ -0,0 +1,178 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "storage/key_num_estimator.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+#include "test_base.h"
+#include "time_util.h"
+#include "types/redis_string.h"
+
+class KeyNumEstimatorTest : public TestBase {
+ protected:
+  explicit KeyNumEstimatorTest() = default;
+  ~KeyNumEstimatorTest() override = default;
+
+  void SetUp() override {
+    ns1_ = std::make_unique<redis::String>(storage_.get(), "estimator_ns1");
+    ns2_ = std::make_unique<redis::String>(storage_.get(), "estimator_ns2");
+  }
+
+  void flushMetadata() {
+    auto s = storage_->GetDB()->Flush(rocksdb::FlushOptions(), storage_->GetCFHandle(ColumnFamilyID::Metadata));
+    ASSERT_TRUE(s.ok());
+  }
+
+  uint64_t keysOf(const std::string &ns) {
+    KeyNumStats stats;
+    auto s = storage_->GetKeyNumEstimator()->GetKeyNumStats(ns, &stats);
+    EXPECT_TRUE(s.ok()) << s.ToString();
+    return stats.n_key;
+  }
+
+  std::unique_ptr<redis::String> ns1_;
+  std::unique_ptr<redis::String> ns2_;
+};
+
+TEST_F(KeyNumEstimatorTest, MemtablesAndFiles) {
+  for (int i = 0; i < 10; i++) ASSERT_TRUE(ns1_->Set(*ctx_, "key" + std::to_string(i), "value").ok());
+  for (int i = 0; i < 5; i++) ASSERT_TRUE(ns2_->Set(*ctx_, "key" + std::to_string(i), "value").ok());
+  EXPECT_EQ(keysOf("estimator_ns1"), 10);
+  EXPECT_EQ(keysOf("estimator_ns2"), 5);
+  EXPECT_EQ(keysOf(kDefaultNamespace), 15);
+
+  // only the latest version in the memtables is counted
+  ASSERT_TRUE(ns1_->Set(*ctx_, "key0", "new_value").ok());
+  EXPECT_EQ(keysOf("estimator_ns1"), 10);
+
+  flushMetadata();
+  EXPECT_EQ(keysOf("estimator_ns1"), 10);
+  EXPECT_EQ(keysOf(kDefaultNamespace), 15);
+
+  // the deletion markers of the memtables and a newer file are subtracted
+  ASSERT_TRUE(ns1_->Del(*ctx_, "key0").ok());
+  ASSERT_TRUE(ns1_->Del(*ctx_, "key1").ok());
+  EXPECT_EQ(keysOf("estimator_ns1"), 8);
+  flushMetadata();
+  EXPECT_EQ(keysOf("estimator_ns1"), 8);
+  EXPECT_EQ(keysOf("estimator_ns2"), 5);
+
+  // the versions in different files are only counted once after being compacted together
+  ASSERT_TRUE(ns1_->Set(*ctx_, "key2", "new_value").ok());
+  EXPECT_EQ(keysOf("estimator_ns1"), 9);
+  flushMetadata();
+  ASSERT_TRUE(storage_->Compact(nullptr, nullptr, nullptr).ok());
+  EXPECT_EQ(keysOf("estimator_ns1"), 8);
+  EXPECT_EQ(keysOf(kDefaultNamespace), 13);
+}
+
+TEST_F(KeyNumEstimatorTest, Expires) {
+  auto expire_at = util::GetTimeStampMS() + 3600 * 1000;
+  for (int i = 0; i < 4; i++) ASSERT_TRUE(ns1_->SetEX(*ctx_, "ttl" + std::to_string(i), "value", expire_at).ok());
+  ASSERT_TRUE(ns1_->Set(*ctx_, "persistent", "value").ok());
+  ASSERT_TRUE(ns1_->SetEX(*ctx_, "expired", "value", util::GetTimeStampMS() - 1000).ok());
+
+  // the expired keys are counted until they're deleted or compacted
+  KeyNumStats stats;
+  ASSERT_TRUE(storage_->GetKeyNumEstimator()->GetKeyNumStats("estimator_ns1", &stats).ok());
+  EXPECT_EQ(stats.n_key, 6);
+  EXPECT_EQ(stats.n_expires, 5);
+  flushMetadata();
+  ASSERT_TRUE(storage_->GetKeyNumEstimator()->GetKeyNumStats("estimator_ns1", &stats).ok());
+  EXPECT_EQ(stats.n_key, 6);
+  EXPECT_EQ(stats.n_expires, 5);
+  // like the active expiration deletes it
+  auto ns_key = ComposeNamespaceKey("estimator_ns1", "expired", storage_->IsSlotIdEncoded());
+  auto metadata_cf = storage_->GetCFHandle(ColumnFamilyID::Metadata);
+  ASSERT_TRUE(storage_->Delete(*ctx_, storage_->DefaultWriteOptions(), metadata_cf, ns_key).ok());
+  ASSERT_TRUE(storage_->GetKeyNumEstimator()->GetKeyNumStats("estimator_ns1", &stats).ok());
+  EXPECT_EQ(stats.n_key, 5);
+  flushMetadata();
+  ASSERT_TRUE(storage_->Compact(nullptr, nullptr, nullptr).ok());
+  ASSERT_TRUE(storage_->GetKeyNumEstimator()->GetKeyNumStats("estimator_ns1", &stats).ok());
+  EXPECT_EQ(stats.n_key, 5);
+  EXPECT_EQ(stats.n_expires, 4);
+  EXPECT_GT(stats.avg_ttl, 3500);
+  EXPECT_LE(stats.avg_ttl, 3600);
+}
+
+TEST_F(KeyNumEstimatorTest, RangeDeletions) {
+  for (int i = 0; i < 10; i++) ASSERT_TRUE(ns1_->Set(*ctx_, "key" + std::to_string(i), "value").ok());
+  for (int i = 0; i < 5; i++) ASSERT_TRUE(ns2_->Set(*ctx_, "key" + std::to_string(i), "value").ok());
+  flushMetadata();
+
+  // the flushed keys and those in the memtables are hidden by the range deletion both before and after it's flushed
+  ASSERT_TRUE(ns1_->Set(*ctx_, "key10", "value").ok());
+  ASSERT_TRUE(ns1_->FlushDB(*ctx_).ok());
+  EXPECT_EQ(keysOf("estimator_ns1"), 0);
+  EXPECT_EQ(keysOf(kDefaultNamespace), 5);
+  flushMetadata();
+  EXPECT_EQ(keysOf("estimator_ns1"), 0);
+  EXPECT_EQ(keysOf(kDefaultNamespace), 5);
+
+  // but not the keys written after it
+  ASSERT_TRUE(ns1_->Set(*ctx_, "key0", "value").ok());
+  flushMetadata();
+  EXPECT_EQ(keysOf("estimator_ns1"), 1);
+  EXPECT_EQ(keysOf(kDefaultNamespace), 6);
+}
+
+TEST(KeyNumProperty, EncodeAndDecode) {
+  KeyNumProperty property;
+  KeyNumProperty::Namespace entry;
+  entry.ns = "ns";
+  entry.first_key = "first";
+  entry.last_key = "last";
+  entry.max_sequence = 100;
+  entry.keys = 10;
+  entry.deletes = 2;
+  entry.expires = 3;
+  entry.expire_sum_secs = 12345;
+  entry.slots = {{1, 4, 1}, {16383, 6, 1}};
+  property.namespaces.emplace_back(entry);
+  property.range_deletions.push_back({"begin", "end", 99});
+
+  KeyNumProperty decoded;
+  ASSERT_TRUE(decoded.Decode(property.Encode()));
+  ASSERT_EQ(decoded.namespaces.size(), 1);
+  const auto &decoded_entry = decoded.namespaces[0];
+  EXPECT_EQ(decoded_entry.ns, "ns");
+  EXPECT_EQ(decoded_entry.first_key, "first");
+  EXPECT_EQ(decoded_entry.last_key, "last");
+  EXPECT_EQ(decoded_entry.max_sequence, 100);
+  EXPECT_EQ(decoded_entry.keys, 10);
+  EXPECT_EQ(decoded_entry.deletes, 2);
+  EXPECT_EQ(decoded_entry.expires, 3);
+  EXPECT_EQ(decoded_entry.expire_sum_secs, 12345);
+  ASSERT_EQ(decoded_entry.slots.size(), 2);
+  EXPECT_EQ(decoded_entry.slots[1].slot, 16383);
+  EXPECT_EQ(decoded_entry.slots[1].keys, 6);
+  ASSERT_EQ(decoded.range_deletions.size(), 1);
+  EXPECT_EQ(decoded.range_deletions[0].end, "end");
+  EXPECT_EQ(decoded.range_deletions[0].sequence, 99);
+
+  // a truncated property is rejected
+  auto encoded = property.Encode();
+  EXPECT_FALSE(decoded.Decode(rocksdb::Slice(encoded.data(), encoded.size() - 1)));
+}
@@ -0,0 +1,77 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "stats/latency_histogram.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+TEST(LatencyHistogram, BucketBounds) {
+  for (uint64_t v = 0; v < 16; v++) {
+    EXPECT_EQ(LatencyHistogram::BucketIndex(v), v);
+  }
+  for (uint64_t v : {16ULL, 17ULL, 31ULL, 32ULL, 33ULL, 1000ULL, 123456ULL, (1ULL << 39) + 12345}) {
+    auto idx = LatencyHistogram::BucketIndex(v);
+    EXPECT_LE(LatencyHistogram::BucketLowerBound(idx), v);
+    EXPECT_GE(LatencyHistogram::BucketUpperBound(idx), v);
+    EXPECT_EQ(LatencyHistogram::BucketUpperBound(idx) + 1, LatencyHistogram::BucketLowerBound(idx + 1));
+  }
+  EXPECT_EQ(LatencyHistogram::BucketIndex(1ULL << 40), LatencyHistogram::kBuckets - 1);
+  EXPECT_EQ(LatencyHistogram::BucketIndex(UINT64_MAX), LatencyHistogram::kBuckets - 1);
+}
+
+TEST(LatencyHistogram, Percentile) {
+  ShardedLatencyHistogram histogram;
+  EXPECT_EQ(histogram.Distribution().Percentile(99), 0);
+
+  for (uint64_t v = 1; v <= 1000; v++) {
+    histogram.Record(v);
+  }
+  auto distribution = histogram.Distribution();
+  EXPECT_EQ(distribution.Count(), 1000);
+  // the relative error is less than 1/16
+  EXPECT_GE(distribution.Percentile(50), 500);
+  EXPECT_LE(distribution.Percentile(50), 500 + 500 / 16);
+  EXPECT_GE(distribution.Percentile(99), 990);
+  EXPECT_LE(distribution.Percentile(99), 990 + 990 / 16);
+  EXPECT_GE(distribution.Percentile(100), 1000);
+
+  auto counts = distribution.CumulativeCounts();
+  ASSERT_FALSE(counts.empty());
+  EXPECT_EQ(counts.front(), std::make_pair(uint64_t(2), uint64_t(1)));
+  EXPECT_EQ(counts.back(), std::make_pair(uint64_t(1024), uint64_t(1000)));
+
+  histogram.Reset();
+  EXPECT_EQ(histogram.Distribution().Count(), 0);
+}
+
+TEST(LatencyHistogram, ConcurrentRecord) {
+  ShardedLatencyHistogram histogram;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 16; i++) {
+    threads.emplace_back([&histogram] {
+      for (uint64_t v = 0; v < 10000; v++) histogram.Record(v);
+    });
+  }
+  for (auto &t : threads) t.join();
+  EXPECT_EQ(histogram.Distribution().Count(), 16 * 10000);
+}
@@ -0,0 +1,50 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "stats/latency_monitor.h"
+
+#include <gtest/gtest.h>
+
+TEST(LatencyMonitor, AddSample) {
+  LatencyMonitor monitor;
+  monitor.AddSampleIfNeeded("command", 100);
+  EXPECT_TRUE(monitor.GetLatest().empty());
+
+  monitor.SetThreshold(10);
+  monitor.AddSampleIfNeeded("command", 5);
+  monitor.AddSampleIfNeeded("command", 20);
+  monitor.AddSampleIfNeeded("command", 30);
+  monitor.AddSampleIfNeeded("flush", 15);
+
+  auto latest = monitor.GetLatest();
+  ASSERT_EQ(latest.size(), 2);
+  EXPECT_EQ(latest[0].event, "command");
+  EXPECT_EQ(latest[0].max, 30);
+  // the samples in the same second are merged
+  auto history = monitor.GetHistory("command");
+  ASSERT_GE(history.size(), 1);
+  EXPECT_LE(history.size(), 2);
+  EXPECT_EQ(history.back().latency, 30);
+
+  EXPECT_EQ(monitor.Reset({"flush", "compaction"}), 1);
+  EXPECT_EQ(monitor.GetLatest().size(), 1);
+  EXPECT_EQ(monitor.Reset({}), 1);
+  EXPECT_TRUE(monitor.GetHistory("command").empty());
+}
@@ -0,0 +1,194 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "lock_manager.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(LockManager, LockIndexes) {
+  LockIndexes indexes;
+  for (unsigned i : {5U, 3U, 9U, 3U, 1U}) {
+    indexes.Insert(i, LockMode::kShared);
+  }
+  indexes.Insert(9, LockMode::kExclusive);
+  indexes.Insert(1, LockMode::kShared);
+
+  std::vector<LockIndexes::Entry> expected = {
+      {1, LockMode::kShared}, {3, LockMode::kShared}, {5, LockMode::kShared}, {9, LockMode::kExclusive}};
+  ASSERT_EQ(std::vector<LockIndexes::Entry>(indexes.begin(), indexes.end()), expected);
+
+  // spill out of the inline array while keeping the order
+  for (unsigned i = 100; i > 0; i--) {
+    indexes.Insert(i * 2, LockMode::kExclusive);
+  }
+  ASSERT_EQ(indexes.Size(), 104);
+  ASSERT_TRUE(std::is_sorted(indexes.begin(), indexes.end()));
+  for (const auto &[index, mode] : indexes) {
+    if (index % 2 == 0) ASSERT_EQ(mode, LockMode::kExclusive);
+  }
+}
+
+TEST(LockManager, MultiGet) {
+  LockManager lock_mgr(2);
+  std::vector<std::string> keys;
+  for (int i = 0; i < 100; i++) {
+    keys.emplace_back("key" + std::to_string(i));
+  }
+
+  auto indexes = lock_mgr.MultiGet(keys);
+  ASSERT_LE(indexes.Size(), lock_mgr.Size());
+  for (const auto &key : keys) {
+    auto index = lock_mgr.Index(key);
+    ASSERT_TRUE(std::any_of(indexes.begin(), indexes.end(), [&](const auto &entry) { return entry.first == index; }));
+  }
+
+  // every stripe is locked once even if several keys fall into it
+  { MultiLockGuard guard(&lock_mgr, keys); }
+  ASSERT_EQ(lock_mgr.GetStats(0).acquired, indexes.Size());
+}
+
+TEST(LockManager, SharedAndExclusive) {
+  LockManager lock_mgr(4);
+  std::string key = "key";
+
+  {
+    LockGuard reader1(&lock_mgr, key, LockMode::kShared);
+    LockGuard reader2(&lock_mgr, key, LockMode::kShared);
+    ASSERT_EQ(lock_mgr.GetStats(1).contended, 0);
+  }
+
+  std::atomic<int> counter = 0;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < 1000; j++) {
+        LockGuard guard(&lock_mgr, key);
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(counter, 4000);
+
+  auto stats = lock_mgr.GetStats(1);
+  ASSERT_EQ(stats.acquired, 4002);
+  if (stats.contended > 0) {
+    ASSERT_EQ(stats.hot_stripes.size(), 1);
+    ASSERT_EQ(stats.hot_stripes[0].index, lock_mgr.Index(key));
+    ASSERT_EQ(stats.hot_stripes[0].contended, stats.contended);
+  }
+}
+
+TEST(LockManager, HeldLockGuard) {
+  LockManager lock_mgr(4);
+  std::vector<std::string> keys = {"a", "b", "c"};
+
+  std::optional<HeldLockGuard> held;
+  held.emplace(&lock_mgr, keys);
+  auto acquired = lock_mgr.GetStats(0).acquired;
+  // the commands run by the holder skip the stripes it holds instead of deadlocking
+  { LockGuard guard(&lock_mgr, std::string("a")); }
+  { MultiLockGuard guard(&lock_mgr, std::vector<std::string>{"b", "c"}); }
+  ASSERT_EQ(lock_mgr.GetStats(0).acquired, acquired);
+
+  // but the other threads still wait for them
+  std::atomic<bool> locked = false;
+  std::thread other([&] {
+    LockGuard guard(&lock_mgr, std::string("a"));
+    locked = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_FALSE(locked);
+  held.reset();
+  other.join();
+  ASSERT_TRUE(locked);
+
+  // the stripes are locked as usual after the guard is gone
+  acquired = lock_mgr.GetStats(0).acquired;
+  { LockGuard guard(&lock_mgr, std::string("a")); }
+  ASSERT_EQ(lock_mgr.GetStats(0).acquired, acquired + 1);
+}
+
+// Compare the throughput of the scripts running exclusively with the global guard, and the ones
+// running with the locks of their keys, each script runs a few commands on its own keys like a rate limiter.
+// It's disabled by default, run it with --gtest_also_run_disabled_tests.
+TEST(LockManager, DISABLED_ScriptLockingBenchmark) {
+  constexpr int kScriptsPerThread = 20000;
+  constexpr int kKeysPerThread = 64;
+  constexpr int kCommandsPerScript = 3;
+
+  LockManager lock_mgr(16);
+  auto run = [&](int threads_num, const std::function<void(int, int)> &script) {
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < threads_num; i++) {
+      threads.emplace_back([i, &script] {
+        for (int j = 0; j < kScriptsPerThread; j++) script(i, j);
+      });
+    }
+    for (auto &t : threads) t.join();
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    return static_cast<double>(threads_num) * kScriptsPerThread * 1000000 / static_cast<double>(elapsed.count());
+  };
+
+  std::vector<uint64_t> counters(32 * kKeysPerThread);
+  auto run_commands = [&](const std::string &key, int index) {
+    for (int k = 0; k < kCommandsPerScript; k++) {
+      LockGuard guard(&lock_mgr, key);
+      // the work of a command
+      for (int n = 0; n < 100; n++) counters[index] = counters[index] * 31 + n;
+    }
+  };
+
+  std::shared_mutex exclusivity;
+  for (int threads_num : {1, 2, 4, 8, 16, 32}) {
+    auto exclusive_ops = run(threads_num, [&](int i, int j) {
+      int index = i * kKeysPerThread + j % kKeysPerThread;
+      std::string key = "rate:" + std::to_string(index);
+      std::unique_lock<std::shared_mutex> guard(exclusivity);
+      run_commands(key, index);
+    });
+    auto key_locking_ops = run(threads_num, [&](int i, int j) {
+      int index = i * kKeysPerThread + j % kKeysPerThread;
+      std::string key = "rate:" + std::to_string(index);
+      std::shared_lock<std::shared_mutex> guard(exclusivity);
+      HeldLockGuard held(&lock_mgr, std::vector<std::string>{key});
+      run_commands(key, index);
+    });
+
+    std::cout << threads_num << " threads running the scripts, exclusively: " << static_cast<uint64_t>(exclusive_ops)
+              << " scripts/s, with the key locks: " << static_cast<uint64_t>(key_locking_ops) << " scripts/s"
+              << std::endl;
+  }
+}
@@ -64,6 +64,18 @@ TEST(Metadata, EncodeAndDecode) {
   list_md.Encode(&list_bytes);
   ASSERT_TRUE(list_md1.Decode(list_bytes).ok());
   ASSERT_EQ(list_md, list_md1);
+  ASSERT_EQ(list_md1.chunk_groups.size(), 1U);
+  ASSERT_EQ(list_md1.chunk_groups[0].size, list_md.size);
+
+  list_md.chunk_groups = {{0, 1000}, {uint64_t(1) << 20, 234}};
+  list_bytes.clear();
+  list_md.Encode(&list_bytes);
+  ASSERT_TRUE(list_md1.Decode(list_bytes).ok());
+  ASSERT_EQ(list_md1.head, list_md.head);
+  ASSERT_EQ(list_md1.tail, list_md.tail);
+  ASSERT_EQ(list_md1.chunk_groups.size(), 2U);
+  ASSERT_EQ(list_md1.chunk_groups[1].first_id, uint64_t(1) << 20);
+  ASSERT_EQ(list_md1.chunk_groups[1].size, 234U);
 }
 
 class RedisTypeTest : public TestBase {
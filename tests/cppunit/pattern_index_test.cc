@@ -0,0 +1,84 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "pattern_index.h"
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+static std::set<std::string> MatchAll(const PatternIndex<int> &index, const std::string &subject) {
+  std::set<std::string> matched;
+  index.Match(subject, [&](const std::string &pattern, int) { matched.emplace(pattern); });
+  return matched;
+}
+
+TEST(PatternIndex, InsertFindErase) {
+  PatternIndex<int> index;
+  ASSERT_TRUE(index.Empty());
+
+  index["news.*"] = 1;
+  index["news.sport"] = 2;
+  index["*"] = 3;
+  index["news.*"]++;
+  ASSERT_EQ(index.Size(), 3);
+  ASSERT_EQ(*index.Find("news.*"), 2);
+  ASSERT_EQ(*index.Find("news.sport"), 2);
+  ASSERT_EQ(*index.Find("*"), 3);
+  ASSERT_EQ(index.Find("news.sp"), nullptr);
+  ASSERT_EQ(index.Find("other"), nullptr);
+
+  ASSERT_TRUE(index.Erase("news.sport"));
+  ASSERT_FALSE(index.Erase("news.sport"));
+  ASSERT_EQ(index.Find("news.sport"), nullptr);
+  ASSERT_EQ(*index.Find("news.*"), 2);
+  ASSERT_TRUE(index.Erase("news.*"));
+  ASSERT_TRUE(index.Erase("*"));
+  ASSERT_TRUE(index.Empty());
+  ASSERT_TRUE(MatchAll(index, "news.sport").empty());
+}
+
+TEST(PatternIndex, Match) {
+  std::vector<std::string> patterns = {
+      "*",         "**",        "news.*",      "news.sport", "news.s*t", "news.?port", "news.[st]port",
+      "news\\.*",  "n*s.sport", "news.sport*", "news.",      "",         "new*",       "news.sport.*",
+      "[a-z]*.go", "a?c",       "abc",         "ab",         "*c",       "user:*:id",  "user:1*",
+  };
+  std::vector<std::string> subjects = {
+      "", "news.sport", "news.tport", "news.spot", "news.", "news", "new", "news.sport.1", "x.go", "abc",
+      "a.c", "ab", "c", "user:1:id", "user:12", "user:2:name", "news.sportx", "news\\.x",
+  };
+
+  PatternIndex<int> index;
+  for (const auto &pattern : patterns) index[pattern] = 0;
+
+  for (const auto &subject : subjects) {
+    std::set<std::string> expected;
+    for (const auto &pattern : patterns) {
+      if (util::StringMatch(pattern, subject, 0)) expected.emplace(pattern);
+    }
+    ASSERT_EQ(MatchAll(index, subject), expected) << "subject: " << subject;
+  }
+
+  for (const auto &pattern : patterns) ASSERT_TRUE(index.Erase(pattern));
+  ASSERT_TRUE(index.Empty());
+}
@@ -21,7 +21,10 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "config/config.h"
 #include "search/executors/mock_executor.h"
@@ -297,6 +300,67 @@ TEST(PlanExecutorTest, Merge) {
   }
 }
 
+TEST(PlanExecutorTest, ExecutorPool) {
+  ExecutorPool pool(3);
+  EXPECT_EQ(pool.Size(), 3U);
+
+  // Concurrent callers share the workers, and every index runs exactly once
+  std::vector<std::thread> callers;
+  std::vector<std::vector<int>> counts(4, std::vector<int>(1000));
+  for (auto &count : counts) {
+    callers.emplace_back([&pool, &count] { pool.ParallelFor(count.size(), [&count](size_t i) { count[i]++; }); });
+  }
+  for (auto &caller : callers) caller.join();
+  for (const auto &count : counts) {
+    EXPECT_EQ(std::count(count.begin(), count.end(), 1), 1000);
+  }
+
+  pool.ParallelFor(0, [](size_t) { FAIL(); });
+}
+
+TEST(PlanExecutorTest, ParallelFilterAndTopNSort) {
+  std::vector<ExecutorNode::RowType> data;
+  for (int i = 0; i < 100; i++) {
+    // Distinct values in a shuffled order
+    data.push_back({std::to_string(i), {{FieldI("f3"), N((i * 37) % 100)}}, IndexI()});
+  }
+
+  ExecutorPool pool(3);
+  auto collect = [&pool](PlanOperator *op, bool parallel) {
+    auto ctx = ExecutorContext(op);
+    if (parallel) {
+      ctx.pool = &pool;
+      ctx.batch_size = 7;
+    }
+    std::vector<std::string> keys;
+    for (auto v = ctx.Next(); v && std::holds_alternative<ExecutorNode::RowType>(*v); v = ctx.Next()) {
+      keys.push_back(std::get<ExecutorNode::RowType>(*v).key);
+    }
+    return keys;
+  };
+
+  {
+    auto op = std::make_unique<Filter>(
+        std::make_unique<Mock>(data),
+        std::make_unique<NumericCompareExpr>(NumericCompareExpr::LT, std::make_unique<FieldRef>("f3", FieldI("f3")),
+                                             std::make_unique<NumericLiteral>(30)));
+    auto serial = collect(op.get(), false);
+    EXPECT_EQ(serial.size(), 30U);
+    EXPECT_EQ(collect(op.get(), true), serial);
+  }
+  {
+    auto op = std::make_unique<TopNSort>(
+        std::make_unique<Mock>(data),
+        std::make_unique<SortByClause>(SortByClause::ASC, std::make_unique<FieldRef>("f3", FieldI("f3"))),
+        std::make_unique<LimitClause>(5, 10));
+    auto serial = collect(op.get(), false);
+    ASSERT_EQ(serial.size(), 10U);
+    // 65 * 37 % 100 is 5, the sixth smallest value
+    EXPECT_EQ(serial[0], "65");
+    EXPECT_EQ(collect(op.get(), true), serial);
+  }
+}
+
 class PlanExecutorTestC : public TestBase {
  protected:
   explicit PlanExecutorTestC() : json_(std::make_unique<redis::Json>(storage_.get(), "search_ns")) {}
@@ -345,6 +409,32 @@ TEST_F(PlanExecutorTestC, FullIndexScan) {
   }
 }
 
+TEST_F(PlanExecutorTestC, ParallelFilterInTransaction) {
+  ExecutorPool pool(3);
+  ASSERT_TRUE(storage_->BeginTxn().IsOK());
+  // the documents are only in the batch of the transaction, which the pool threads can't see
+  {
+    engine::Context ctx(storage_.get());
+    for (int i = 0; i < 50; i++) {
+      json_->Set(ctx, "test4:txn" + std::to_string(i), "$", "{\"f3\": " + std::to_string(i) + "}");
+    }
+  }
+
+  auto op = std::make_unique<Filter>(
+      std::make_unique<FullIndexScan>(std::make_unique<IndexRef>("ia", IndexI())),
+      std::make_unique<NumericCompareExpr>(NumericCompareExpr::GET, std::make_unique<FieldRef>("f3", FieldI("f3")),
+                                           std::make_unique<NumericLiteral>(25)));
+  auto ctx = ExecutorContext(op.get(), storage_.get(), &pool);
+  ctx.batch_size = 7;
+  size_t rows = 0;
+  for (auto v = ctx.Next(); v && std::holds_alternative<ExecutorNode::RowType>(*v); v = ctx.Next()) {
+    EXPECT_TRUE(util::HasPrefix(std::get<ExecutorNode::RowType>(*v).key, "test4:txn"));
+    rows++;
+  }
+  EXPECT_EQ(rows, 25U);
+  ASSERT_TRUE(storage_->CommitTxn().IsOK());
+}
+
 struct ScopedUpdate {
   engine::Context* db_ctx;
   redis::GlobalIndexer::RecordResult rr;
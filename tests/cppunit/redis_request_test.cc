@@ -0,0 +1,144 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "server/redis_request.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "config/config.h"
+#include "event_util.h"
+#include "stats/stats.h"
+
+class RedisRequestTest : public testing::Test {
+ protected:
+  RedisRequestTest() : req_(&stats_, &config_) {}
+
+  void Feed(const std::string &data, size_t chunk_size) {
+    for (size_t i = 0; i < data.size(); i += chunk_size) {
+      evbuffer_add(input_.get(), data.data() + i, std::min(chunk_size, data.size() - i));
+      auto s = req_.Tokenize(input_.get());
+      ASSERT_TRUE(s.IsOK()) << s.Msg();
+    }
+  }
+
+  Status Parse(const std::string &data) {
+    evbuffer_add(input_.get(), data.data(), data.size());
+    return req_.Tokenize(input_.get());
+  }
+
+  Stats stats_;
+  Config config_;
+  UniqueEvbuf input_;
+  redis::Request req_;
+};
+
+TEST_F(RedisRequestTest, Tokenize) {
+  std::string big(100000, 'x');
+  std::string data = "*3\r\n$3\r\nSET\r\n$1\r\nk\r\n$5\r\nhello\r\n";
+  data += "PING\r\n\r\nECHO a\tb\n";
+  data += "*-1\r\n*0\r\n";
+  data += "*2\r\n$4\r\nECHO\r\n$100000\r\n" + big + "\r\n";
+  std::vector<redis::CommandTokens> expected = {{"SET", "k", "hello"}, {"PING"}, {"ECHO", "a", "b"}, {"ECHO", big}};
+
+  // the lines and arguments are split at every possible position between the chunks
+  for (size_t chunk_size : {1, 3, 7, 4096, 1 << 20}) {
+    req_.GetCommands()->clear();
+    Feed(data, chunk_size);
+    ASSERT_EQ(std::vector<redis::CommandTokens>(req_.GetCommands()->begin(), req_.GetCommands()->end()), expected);
+    ASSERT_EQ(evbuffer_get_length(input_.get()), 0);
+  }
+}
+
+TEST_F(RedisRequestTest, ProtocolError) {
+  std::vector<std::pair<std::string, std::string>> cases = {
+      {"*abc\r\n", "invalid multibulk length"},
+      {"*3\n", "invalid multibulk length"},
+      {"*+3\r\n", "invalid multibulk length"},
+      {"*1\r\nfoo\r\n", "expected '$'"},
+      {"*1\r\n$-1\r\n", "invalid bulk length"},
+      {"*1\r\n$123456789012345678901234567890123456789\r\n", "invalid bulk length"},
+  };
+  for (const auto &[data, error] : cases) {
+    redis::Request req(&stats_, &config_);
+    UniqueEvbuf input;
+    evbuffer_add(input.get(), data.data(), data.size());
+    auto s = req.Tokenize(input.get());
+    ASSERT_FALSE(s.IsOK()) << data;
+    ASSERT_NE(s.Msg().find(error), std::string::npos) << s.Msg();
+  }
+
+  config_.proto_max_bulk_len = 4;
+  ASSERT_FALSE(Parse("*1\r\n$5\r\n").IsOK());
+}
+
+static std::string PipelinedSetGetData(int pairs) {
+  std::string data;
+  for (int i = 0; i < pairs; i++) {
+    std::string key = "key:" + std::to_string(i);
+    std::string key_bulk = "$" + std::to_string(key.size()) + "\r\n" + key + "\r\n";
+    data += "*3\r\n$3\r\nSET\r\n" + key_bulk + "$16\r\n0123456789abcdef\r\n";
+    data += "*2\r\n$3\r\nGET\r\n" + key_bulk;
+  }
+  return data;
+}
+
+TEST_F(RedisRequestTest, PipelinedSetGet) {
+  constexpr int kPairs = 1000;
+
+  std::vector<redis::CommandTokens> expected;
+  for (int i = 0; i < kPairs; i++) {
+    std::string key = "key:" + std::to_string(i);
+    expected.push_back({"SET", key, "0123456789abcdef"});
+    expected.push_back({"GET", key});
+  }
+
+  // the commands are split across the reads at arbitrary positions
+  Feed(PipelinedSetGetData(kPairs), 1000);
+  ASSERT_EQ(std::vector<redis::CommandTokens>(req_.GetCommands()->begin(), req_.GetCommands()->end()), expected);
+  ASSERT_EQ(evbuffer_get_length(input_.get()), 0);
+}
+
+// A micro benchmark of parsing the pipelined SET/GET commands, it reports the parsing cost per command.
+// It's disabled by default, run it with --gtest_also_run_disabled_tests.
+TEST_F(RedisRequestTest, DISABLED_PipelinedSetGetBenchmark) {
+  constexpr int kPairs = 100000;
+  constexpr size_t kReadSize = 16 * 1024;
+
+  auto data = PipelinedSetGetData(kPairs);
+  size_t commands = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < data.size(); i += kReadSize) {
+    evbuffer_add(input_.get(), data.data() + i, std::min(kReadSize, data.size() - i));
+    ASSERT_TRUE(req_.Tokenize(input_.get()).IsOK());
+    commands += req_.GetCommands()->size();
+    req_.GetCommands()->clear();
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+  ASSERT_EQ(commands, 2 * kPairs);
+  std::cout << "parsed " << commands << " pipelined SET/GET commands, "
+            << static_cast<double>(elapsed.count()) / static_cast<double>(commands) << " ns per command" << std::endl;
+}
@@ -0,0 +1,98 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "storage/scripting.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+
+#include "server/redis_reply.h"
+
+class ScriptingTest : public testing::Test {
+ protected:
+  void SetUp() override { lua_ = luaL_newstate(); }
+  void TearDown() override { lua_close(lua_); }
+
+  lua_State *lua_ = nullptr;
+};
+
+TEST_F(ScriptingTest, RedisProtocolToLuaType) {
+  std::string reply = redis::MultiLen(5) + redis::Integer(-42) + redis::BulkString("foo") + redis::NilString(RESP::v2) +
+                      redis::ArrayOfBulkStrings({"a", "b"}) + redis::SimpleString("OK");
+  const char *end = lua::RedisProtocolToLuaType(lua_, reply.data());
+  ASSERT_EQ(end, reply.data() + reply.size());
+  ASSERT_EQ(lua_gettop(lua_), 1);
+  ASSERT_TRUE(lua_istable(lua_, -1));
+  ASSERT_EQ(lua_objlen(lua_, -1), 5);
+
+  lua_rawgeti(lua_, -1, 1);
+  ASSERT_EQ(lua_tonumber(lua_, -1), -42);
+  lua_rawgeti(lua_, -2, 2);
+  ASSERT_EQ(std::string(lua_tostring(lua_, -1)), "foo");
+  lua_rawgeti(lua_, -3, 3);
+  ASSERT_TRUE(lua_isboolean(lua_, -1));
+  ASSERT_FALSE(lua_toboolean(lua_, -1));
+  lua_pop(lua_, 3);
+
+  lua_rawgeti(lua_, -1, 4);
+  ASSERT_EQ(lua_objlen(lua_, -1), 2);
+  lua_rawgeti(lua_, -1, 2);
+  ASSERT_EQ(std::string(lua_tostring(lua_, -1)), "b");
+  lua_pop(lua_, 2);
+
+  lua_rawgeti(lua_, -1, 5);
+  lua_getfield(lua_, -1, "ok");
+  ASSERT_EQ(std::string(lua_tostring(lua_, -1)), "OK");
+  lua_pop(lua_, 3);
+}
+
+TEST_F(ScriptingTest, RedisProtocolToLuaTypeMap) {
+  std::string reply = redis::MapOfBulkStrings(RESP::v3, {"f1", "v1", "f2", "v2"});
+  const char *end = lua::RedisProtocolToLuaType(lua_, reply.data());
+  ASSERT_EQ(end, reply.data() + reply.size());
+
+  lua_getfield(lua_, -1, "map");
+  lua_getfield(lua_, -1, "f2");
+  ASSERT_EQ(std::string(lua_tostring(lua_, -1)), "v2");
+  lua_pop(lua_, 3);
+}
+
+// A micro benchmark of converting the replies of the scripts calling HMGET or HGETALL with hundreds of fields.
+// It's disabled by default, run it with --gtest_also_run_disabled_tests.
+TEST_F(ScriptingTest, DISABLED_RedisProtocolToLuaTypeBenchmark) {
+  constexpr int kRounds = 2000;
+
+  for (int elems : {1, 16, 256}) {
+    std::vector<std::string> values;
+    for (int i = 0; i < elems; i++) values.emplace_back("value:" + std::to_string(i));
+    std::string reply = redis::ArrayOfBulkStrings(values);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kRounds; i++) {
+      lua::RedisProtocolToLuaType(lua_, reply.data());
+      lua_pop(lua_, 1);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "converting the reply of " << elems << " elements: "
+              << static_cast<double>(elapsed.count()) * 1000 / kRounds << " ns/reply" << std::endl;
+  }
+}
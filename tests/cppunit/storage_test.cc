@@ -23,7 +23,9 @@
 #include <status.h>
 #include <storage/storage.h>
 
+#include <chrono>
 #include <filesystem>
+#include <thread>
 
 TEST(Storage, CreateBackup) {
   std::error_code ec;
@@ -58,3 +60,101 @@ TEST(Storage, CreateBackup) {
   std::filesystem::remove_all(config.db_dir, ec);
   ASSERT_TRUE(!ec);
 }
+
+TEST(Storage, WaitForWALData) {
+  std::error_code ec;
+
+  Config config;
+  config.db_dir = "test_wait_wal_dir";
+  config.slot_id_encoded = false;
+
+  std::filesystem::remove_all(config.db_dir, ec);
+  ASSERT_TRUE(!ec);
+
+  auto storage = std::make_unique<engine::Storage>(&config);
+  auto s = storage->Open();
+  ASSERT_TRUE(s.IsOK());
+
+  auto next_seq = storage->LatestSeqNumber() + 1;
+  ASSERT_FALSE(storage->WaitForWALData(next_seq, std::chrono::milliseconds(10)));
+
+  std::thread writer([&storage] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto ctx = engine::Context(storage.get());
+    rocksdb::WriteBatch batch;
+    batch.Put("k", "v");
+    ASSERT_TRUE(storage->Write(ctx, rocksdb::WriteOptions(), &batch).ok());
+  });
+  // woken up by the write long before the timeout
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_TRUE(storage->WaitForWALData(next_seq, std::chrono::seconds(10)));
+  ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+  writer.join();
+
+  storage = nullptr;
+  std::filesystem::remove_all(config.db_dir, ec);
+  ASSERT_TRUE(!ec);
+}
+
+TEST(Storage, TxnPerThread) {
+  std::error_code ec;
+
+  Config config;
+  config.db_dir = "test_txn_per_thread_dir";
+  config.slot_id_encoded = false;
+
+  std::filesystem::remove_all(config.db_dir, ec);
+  ASSERT_TRUE(!ec);
+
+  auto storage = std::make_unique<engine::Storage>(&config);
+  auto s = storage->Open();
+  ASSERT_TRUE(s.IsOK());
+
+  ASSERT_TRUE(storage->BeginTxn().IsOK());
+  ASSERT_TRUE(storage->IsTxnMode());
+  {
+    auto ctx = engine::Context(storage.get());
+    auto batch = storage->GetWriteBatchBase();
+    ASSERT_TRUE(batch->Put("k", "v").ok());
+    ASSERT_TRUE(storage->Write(ctx, rocksdb::WriteOptions(), batch->GetWriteBatch()).ok());
+    std::string value;
+    ASSERT_TRUE(storage->Get(ctx, ctx.GetReadOptions(), "k", &value).ok());
+    ASSERT_EQ(value, "v");
+  }
+
+  // the transaction of this thread is invisible to the others until it's committed
+  std::thread reader([&storage] {
+    ASSERT_FALSE(storage->IsTxnMode());
+    ASSERT_TRUE(storage->BeginTxn().IsOK());
+    auto ctx = engine::Context(storage.get());
+    std::string value;
+    ASSERT_TRUE(storage->Get(ctx, ctx.GetReadOptions(), "k", &value).IsNotFound());
+    ASSERT_TRUE(storage->CommitTxn().IsOK());
+  });
+  reader.join();
+
+  // the callbacks wait for the commit and see the committed writes
+  auto seq = storage->LatestSeqNumber();
+  rocksdb::SequenceNumber seq_in_callback = 0;
+  storage->AfterCommit([&storage, &seq_in_callback] { seq_in_callback = storage->LatestSeqNumber(); });
+  ASSERT_EQ(seq_in_callback, 0);
+  ASSERT_TRUE(storage->CommitTxn().IsOK());
+  ASSERT_FALSE(storage->IsTxnMode());
+  ASSERT_GT(storage->LatestSeqNumber(), seq);
+  ASSERT_EQ(seq_in_callback, storage->LatestSeqNumber());
+
+  // and run right away out of the transaction mode
+  bool called = false;
+  storage->AfterCommit([&called] { called = true; });
+  ASSERT_TRUE(called);
+  {
+    auto ctx = engine::Context(storage.get());
+    std::string value;
+    ASSERT_TRUE(storage->Get(ctx, ctx.GetReadOptions(), "k", &value).ok());
+    ASSERT_EQ(value, "v");
+  }
+
+  storage = nullptr;
+  std::filesystem::remove_all(config.db_dir, ec);
+  ASSERT_TRUE(!ec);
+}
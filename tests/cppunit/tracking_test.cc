@@ -0,0 +1,187 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "server/tracking.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+static TrackingTarget Target(uint64_t id) { return {nullptr, static_cast<int>(id), id}; }
+
+// Maps the client id to the invalidated keys
+static std::map<uint64_t, std::vector<std::string>> KeysOf(const std::vector<Invalidation> &invalidations) {
+  std::map<uint64_t, std::vector<std::string>> keys;
+  for (const auto &invalidation : invalidations) keys[invalidation.client.id] = invalidation.keys;
+  return keys;
+}
+
+TEST(TrackingTable, DefaultMode) {
+  TrackingTable table;
+  ASSERT_TRUE(table.Empty());
+  table.Enable(Target(1), "ns", {}, {});
+  table.Enable(Target(2), "ns", {}, {});
+  ASSERT_FALSE(table.Empty());
+
+  ASSERT_TRUE(table.RecordRead(1, "ns", {"a", "b"}).empty());
+  ASSERT_TRUE(table.RecordRead(2, "ns", {"b"}).empty());
+  ASSERT_EQ(table.GetStats().keys, 2);
+
+  // the same key of another namespace isn't tracked
+  ASSERT_TRUE(table.Invalidate(3, "other", {"a", "b"}).empty());
+
+  auto keys = KeysOf(table.Invalidate(3, "ns", {"b", "c"}));
+  ASSERT_EQ(keys.size(), 2);
+  ASSERT_EQ(keys[1], std::vector<std::string>{"b"});
+  ASSERT_EQ(keys[2], std::vector<std::string>{"b"});
+
+  // a key is forgotten once it's invalidated, until it's read again
+  ASSERT_TRUE(table.Invalidate(3, "ns", {"b"}).empty());
+  ASSERT_EQ(table.GetStats().keys, 1);
+
+  table.Disable(1);
+  ASSERT_EQ(table.GetRedirect(1), -1);
+  ASSERT_TRUE(table.Invalidate(3, "ns", {"a"}).empty());
+  table.Disable(2);
+  ASSERT_TRUE(table.Empty());
+}
+
+TEST(TrackingTable, NoLoop) {
+  TrackingTable table;
+  TrackingOptions noloop;
+  noloop.noloop = true;
+  table.Enable(Target(1), "ns", {}, {});
+  table.Enable(Target(2), "ns", noloop, {});
+  table.RecordRead(1, "ns", {"a"});
+  table.RecordRead(2, "ns", {"a"});
+
+  auto keys = KeysOf(table.Invalidate(1, "ns", {"a"}));
+  ASSERT_EQ(keys.size(), 2);
+
+  table.RecordRead(1, "ns", {"a"});
+  table.RecordRead(2, "ns", {"a"});
+  keys = KeysOf(table.Invalidate(2, "ns", {"a"}));
+  ASSERT_EQ(keys.size(), 1);
+  ASSERT_EQ(keys[1], std::vector<std::string>{"a"});
+}
+
+TEST(TrackingTable, BroadcastMode) {
+  TrackingTable table;
+  TrackingOptions prefixes;
+  prefixes.bcast = true;
+  prefixes.prefixes = {"user:", "user:1"};
+  TrackingOptions all;
+  all.bcast = true;
+  table.Enable(Target(1), "ns", prefixes, {});
+  table.Enable(Target(2), "ns", all, Target(3));
+  ASSERT_EQ(table.GetStats().prefixes, 3);
+  ASSERT_EQ(table.GetRedirect(2), 3);
+
+  // the keys read in the broadcasting mode aren't remembered
+  ASSERT_TRUE(table.RecordRead(1, "ns", {"user:1"}).empty());
+  ASSERT_EQ(table.GetStats().keys, 0);
+
+  auto invalidations = table.Invalidate(4, "ns", {"user:1", "item:1"});
+  auto keys = KeysOf(invalidations);
+  ASSERT_EQ(keys.size(), 2);
+  ASSERT_EQ(keys[1], std::vector<std::string>{"user:1"});
+  ASSERT_EQ(keys[2], (std::vector<std::string>{"user:1", "item:1"}));
+  for (const auto &invalidation : invalidations) {
+    ASSERT_EQ(invalidation.redirect.id, invalidation.client.id == 2 ? 3 : 0);
+  }
+
+  ASSERT_TRUE(table.Invalidate(4, "other", {"user:1"}).empty());
+
+  table.Disable(1);
+  table.Disable(2);
+  ASSERT_EQ(table.GetStats().prefixes, 0);
+}
+
+TEST(TrackingTable, MaxKeys) {
+  // the oldest keys are evicted first in a single shard
+  TrackingTable table(2, 1);
+  table.Enable(Target(1), "ns", {}, {});
+  ASSERT_TRUE(table.RecordRead(1, "ns", {"a", "b"}).empty());
+
+  auto keys = KeysOf(table.RecordRead(1, "ns", {"c"}));
+  ASSERT_EQ(keys[1], std::vector<std::string>{"a"});
+  ASSERT_EQ(table.GetStats().keys, 2);
+
+  keys = KeysOf(table.SetMaxKeys(1));
+  ASSERT_EQ(keys[1], std::vector<std::string>{"b"});
+  ASSERT_EQ(table.GetStats().keys, 1);
+
+  ASSERT_TRUE(table.SetMaxKeys(0).empty());
+  ASSERT_TRUE(table.RecordRead(1, "ns", {"d", "e", "f"}).empty());
+  ASSERT_EQ(table.GetStats().keys, 4);
+}
+
+TEST(TrackingTable, MaxKeysOfShards) {
+  TrackingTable table(10, 4);
+  table.Enable(Target(1), "ns", {}, {});
+  std::vector<std::string> keys;
+  for (int i = 0; i < 20; i++) keys.emplace_back("key" + std::to_string(i));
+  ASSERT_EQ(KeysOf(table.RecordRead(1, "ns", keys))[1].size(), 10);
+  ASSERT_EQ(table.GetStats().keys, 10);
+
+  // the keys left are the ones which weren't evicted
+  auto invalidated = KeysOf(table.Invalidate(2, "ns", keys))[1];
+  ASSERT_EQ(invalidated.size(), 10);
+  ASSERT_EQ(table.GetStats().keys, 0);
+}
+
+TEST(TrackingTable, Expire) {
+  TrackingTable table;
+  table.Enable(Target(1), "ns", {}, {});
+  table.Enable(Target(2), "ns", {}, {});
+  table.RecordRead(1, "ns", {"a", "b", "c"}, {100, 200, 0});
+  table.RecordRead(2, "ns", {"b"}, {200});
+
+  ASSERT_TRUE(table.InvalidateExpired(99).empty());
+  auto keys = KeysOf(table.InvalidateExpired(200));
+  ASSERT_EQ(keys.size(), 2);
+  ASSERT_EQ(keys[1].size(), 2);
+  ASSERT_EQ(keys[2], std::vector<std::string>{"b"});
+  ASSERT_EQ(table.GetStats().keys, 1);
+
+  // the expire time is updated by reading the key again, and forgotten once it's invalidated
+  table.RecordRead(1, "ns", {"c"}, {300});
+  table.RecordRead(1, "ns", {"c"}, {400});
+  ASSERT_TRUE(table.InvalidateExpired(300).empty());
+  ASSERT_EQ(KeysOf(table.Invalidate(2, "ns", {"c"}))[1], std::vector<std::string>{"c"});
+  ASSERT_TRUE(table.InvalidateExpired(400).empty());
+}
+
+TEST(TrackingTable, InvalidateAll) {
+  TrackingTable table;
+  TrackingOptions bcast;
+  bcast.bcast = true;
+  table.Enable(Target(1), "ns", {}, {});
+  table.Enable(Target(2), "ns", bcast, {});
+  table.RecordRead(1, "ns", {"a", "b"});
+
+  auto invalidations = table.InvalidateAll();
+  ASSERT_EQ(invalidations.size(), 2);
+  for (const auto &invalidation : invalidations) ASSERT_TRUE(invalidation.keys.empty());
+  ASSERT_EQ(table.GetStats().keys, 0);
+  ASSERT_EQ(table.Invalidate(3, "ns", {"a"}).size(), 1);
+}
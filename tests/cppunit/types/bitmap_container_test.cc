@@ -0,0 +1,160 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "types/bitmap_container.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/bit_util.h"
+
+using redis::BitmapContainer;
+
+static constexpr uint32_t kSegmentBits = 1024 * 8;
+
+static std::string SegmentOf(const std::vector<uint32_t> &positions) {
+  std::string segment(kSegmentBits / 8, 0);
+  for (auto pos : positions) util::lsb::SetBitTo(reinterpret_cast<uint8_t *>(segment.data()), pos, true);
+  return segment;
+}
+
+static bool GetBit(const std::string &segment, uint32_t pos) {
+  return pos / 8 < segment.size() && util::lsb::GetBit(reinterpret_cast<const uint8_t *>(segment.data()), pos);
+}
+
+// Check the container against the bytes of the segment
+static void CheckContainer(const std::string &segment, const std::string &value) {
+  BitmapContainer container;
+  ASSERT_TRUE(BitmapContainer::Parse(value, &container).ok());
+
+  std::string bytes;
+  container.ToBytes(&bytes);
+  bytes.resize(segment.size(), 0);
+  ASSERT_EQ(bytes, segment);
+
+  std::vector<uint32_t> ranges = {0, 1, 7, 8, 100, 1023, 1024, 4095, 4096, 8000, kSegmentBits - 1};
+  for (auto first : ranges) {
+    for (auto last : ranges) {
+      uint32_t count = 0;
+      int64_t first_set = -1, first_clear = -1;
+      for (uint32_t pos = first; pos <= last; pos++) {
+        bool bit = GetBit(segment, pos);
+        count += bit;
+        if (bit && first_set == -1) first_set = pos;
+        if (!bit && first_clear == -1) first_clear = pos;
+      }
+      EXPECT_EQ(container.Count(first, last), count) << first << "-" << last;
+      EXPECT_EQ(container.Find(true, first, last), first_set) << first << "-" << last;
+      EXPECT_EQ(container.Find(false, first, last), first_clear) << first << "-" << last;
+    }
+    EXPECT_EQ(container.Contains(first), GetBit(segment, first));
+    EXPECT_EQ(container.GetByte(first / 8), static_cast<uint8_t>(segment[first / 8]));
+  }
+}
+
+TEST(BitmapContainer, Empty) {
+  EXPECT_TRUE(BitmapContainer::Encode(std::string(1024, 0)).empty());
+
+  BitmapContainer container;
+  ASSERT_TRUE(BitmapContainer::Parse("", &container).ok());
+  EXPECT_EQ(container.GetType(), BitmapContainer::kEmpty);
+  EXPECT_EQ(container.Size(), 0U);
+  EXPECT_EQ(container.Count(0, kSegmentBits - 1), 0U);
+  EXPECT_EQ(container.Find(true, 0, kSegmentBits - 1), -1);
+  EXPECT_EQ(container.Find(false, 10, kSegmentBits - 1), 10);
+
+  EXPECT_FALSE(BitmapContainer::Parse("\x01\x00", &container).ok());
+  EXPECT_FALSE(BitmapContainer::Parse("\x09", &container).ok());
+}
+
+TEST(BitmapContainer, Array) {
+  auto segment = SegmentOf({3, 100, 101, 4000, kSegmentBits - 1});
+  auto value = BitmapContainer::Encode(segment);
+  EXPECT_EQ(value.size(), 1U + 5 * 2);
+
+  BitmapContainer container;
+  ASSERT_TRUE(BitmapContainer::Parse(value, &container).ok());
+  EXPECT_EQ(container.GetType(), BitmapContainer::kArray);
+  EXPECT_EQ(container.Size(), 1024U);
+  CheckContainer(segment, value);
+}
+
+TEST(BitmapContainer, Run) {
+  std::vector<uint32_t> positions;
+  for (uint32_t pos = 16; pos < 3000; pos++) positions.emplace_back(pos);
+  for (uint32_t pos = 5000; pos < 5100; pos++) positions.emplace_back(pos);
+  auto segment = SegmentOf(positions);
+  auto value = BitmapContainer::Encode(segment);
+  EXPECT_EQ(value.size(), 1U + 2 * 4);
+
+  BitmapContainer container;
+  ASSERT_TRUE(BitmapContainer::Parse(value, &container).ok());
+  EXPECT_EQ(container.GetType(), BitmapContainer::kRun);
+  EXPECT_EQ(container.Size(), 5099U / 8 + 1);
+  CheckContainer(segment, value);
+}
+
+TEST(BitmapContainer, Bitset) {
+  std::mt19937 gen(42);
+  std::string segment(1024, 0);
+  for (auto &byte : segment) byte = static_cast<char>(gen());
+  auto value = BitmapContainer::Encode(segment);
+
+  BitmapContainer container;
+  ASSERT_TRUE(BitmapContainer::Parse(value, &container).ok());
+  EXPECT_EQ(container.GetType(), BitmapContainer::kBitset);
+  CheckContainer(segment, value);
+}
+
+TEST(BitmapContainer, RandomDensity) {
+  std::mt19937 gen(7);
+  for (uint32_t bits : {1, 10, 200, 600, 3000, 8000}) {
+    std::vector<uint32_t> positions;
+    for (uint32_t i = 0; i < bits; i++) positions.emplace_back(gen() % kSegmentBits);
+    auto segment = SegmentOf(positions);
+    CheckContainer(segment, BitmapContainer::Encode(segment));
+  }
+}
+
+TEST(BitmapContainer, Intersect) {
+  std::vector<uint32_t> runs;
+  for (uint32_t pos = 100; pos < 2000; pos++) runs.emplace_back(pos);
+  auto array = SegmentOf({5, 100, 1999, 2000, 7000});
+  auto run = SegmentOf(runs);
+  std::string bitset(1024, static_cast<char>(0x55));
+
+  std::string result;
+  auto array_value = BitmapContainer::Encode(array);
+  auto run_value = BitmapContainer::Encode(run);
+  ASSERT_TRUE(BitmapContainer::Intersect({array_value, run_value}, &result).ok());
+  CheckContainer(SegmentOf({100, 1999}), result);
+
+  auto bitset_value = BitmapContainer::Encode(bitset);
+  ASSERT_TRUE(BitmapContainer::Intersect({run_value, bitset_value}, &result).ok());
+  std::vector<uint32_t> expected;
+  for (uint32_t pos = 100; pos < 2000; pos += 2) expected.emplace_back(pos);
+  CheckContainer(SegmentOf(expected), result);
+
+  ASSERT_TRUE(BitmapContainer::Intersect({array_value, ""}, &result).ok());
+  EXPECT_TRUE(result.empty());
+}
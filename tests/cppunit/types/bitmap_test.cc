@@ -631,3 +631,143 @@ TEST_P(RedisBitmapTest, BitfieldStringGetSetTest) {
     i += 8;
   }
 }
+
+TEST_P(RedisBitmapTest, SummarizedEncoding) {
+  if (bool use_bitmap = GetParam(); !use_bitmap) {
+    GTEST_SKIP() << "the summary only applies to the bitmaps";
+  }
+  config_.bitmap_summary_enabled = true;
+
+  // the segments spread over two summary blocks
+  uint32_t offsets[] = {0, 123, 1024 * 8, 1024 * 8 + 1, 3 * 1024 * 8, 600 * 1024 * 8 + 7};
+  for (const auto &offset : offsets) {
+    bool bit = false;
+    bitmap_->SetBit(*ctx_, key_, offset, true, &bit);
+    EXPECT_FALSE(bit);
+  }
+  // setting a bit twice doesn't change the counts
+  bool bit = false;
+  bitmap_->SetBit(*ctx_, key_, 123, true, &bit);
+  EXPECT_TRUE(bit);
+
+  uint32_t cnt = 0;
+  bitmap_->BitCount(*ctx_, key_, 0, -1, false, &cnt);
+  EXPECT_EQ(cnt, 6);
+  bitmap_->BitCount(*ctx_, key_, 1, 600 * 1024 - 1, false, &cnt);
+  EXPECT_EQ(cnt, 4);
+  bitmap_->BitCount(*ctx_, key_, 124, 600 * 1024 * 8 + 7, true, &cnt);
+  EXPECT_EQ(cnt, 4);
+
+  int64_t pos = 0;
+  bitmap_->BitPos(*ctx_, key_, true, 3 * 1024 + 1, -1, false, &pos, /*bit_index=*/false);
+  EXPECT_EQ(pos, 600 * 1024 * 8 + 7);
+
+  bitmap_->SetBit(*ctx_, key_, 600 * 1024 * 8 + 7, false, &bit);
+  EXPECT_TRUE(bit);
+  bitmap_->BitCount(*ctx_, key_, 0, -1, false, &cnt);
+  EXPECT_EQ(cnt, 5);
+
+  std::string value;
+  EXPECT_TRUE(bitmap_->GetString(*ctx_, key_, 1024 * 1024, &value).ok());
+  EXPECT_EQ(value.size(), 600 * 1024 + 1);
+  EXPECT_EQ(static_cast<uint8_t>(value[0]), 0x80);
+  EXPECT_EQ(static_cast<uint8_t>(value[1024]), 0xc0);
+
+  std::string dest_key = "test_bitmap_summarized_dest";
+  int64_t len = 0;
+  EXPECT_TRUE(bitmap_->BitOp(*ctx_, kBitOpNot, "not", dest_key, {key_}, &len).ok());
+  bitmap_->BitCount(*ctx_, dest_key, 0, 1023, false, &cnt);
+  EXPECT_EQ(cnt, 1024 * 8 - 2);
+
+  std::vector<std::optional<BitfieldValue>> rets;
+  BitfieldOperation op;
+  op.type = BitfieldOperation::Type::kSet;
+  op.encoding = BitfieldEncoding::Create(BitfieldEncoding::Type::kUnsigned, 8).GetValue();
+  op.offset = 2 * 1024 * 8;
+  op.value = 0xff;
+  EXPECT_TRUE(bitmap_->Bitfield(*ctx_, key_, {op}, &rets).ok());
+  bitmap_->BitCount(*ctx_, key_, 0, -1, false, &cnt);
+  EXPECT_EQ(cnt, 13);
+
+  auto s = bitmap_->Del(*ctx_, dest_key);
+  s = bitmap_->Del(*ctx_, key_);
+  config_.bitmap_summary_enabled = false;
+}
+
+TEST_P(RedisBitmapTest, CompressedEncoding) {
+  if (bool use_bitmap = GetParam(); !use_bitmap) {
+    GTEST_SKIP() << "the compression only applies to the bitmaps";
+  }
+  config_.bitmap_compression_enabled = true;
+
+  // a sparse bitmap with a bit far away from the others
+  constexpr uint32_t far_offset = 1U << 30;
+  uint32_t offsets[] = {0, 123, 1024 * 8, 1024 * 8 + 1, 3 * 1024 * 8, far_offset};
+  for (const auto &offset : offsets) {
+    bool bit = false;
+    bitmap_->SetBit(*ctx_, key_, offset, true, &bit);
+    EXPECT_FALSE(bit);
+  }
+  bool bit = false;
+  bitmap_->GetBit(*ctx_, key_, 1024 * 8 + 1, &bit);
+  EXPECT_TRUE(bit);
+  bitmap_->GetBit(*ctx_, key_, 1024 * 8 + 2, &bit);
+  EXPECT_FALSE(bit);
+
+  uint32_t cnt = 0;
+  bitmap_->BitCount(*ctx_, key_, 0, -1, false, &cnt);
+  EXPECT_EQ(cnt, 6);
+  bitmap_->BitCount(*ctx_, key_, 1, far_offset / 8 - 1, false, &cnt);
+  EXPECT_EQ(cnt, 4);
+  bitmap_->BitCount(*ctx_, key_, 124, far_offset, true, &cnt);
+  EXPECT_EQ(cnt, 4);
+
+  int64_t pos = 0;
+  bitmap_->BitPos(*ctx_, key_, true, 3 * 1024 + 1, -1, false, &pos, /*bit_index=*/false);
+  EXPECT_EQ(pos, far_offset);
+  bitmap_->BitPos(*ctx_, key_, false, 0, -1, false, &pos, /*bit_index=*/false);
+  EXPECT_EQ(pos, 1);
+  bitmap_->BitPos(*ctx_, key_, false, 1024 * 8, 1024 * 8 + 1, true, &pos, /*bit_index=*/true);
+  EXPECT_EQ(pos, -1);
+
+  std::string other_key = "test_bitmap_compressed_other";
+  for (uint32_t offset : {123U, 1024U * 8 + 1, far_offset, far_offset + 1}) {
+    bitmap_->SetBit(*ctx_, other_key, offset, true, &bit);
+  }
+  std::string dest_key = "test_bitmap_compressed_dest";
+  int64_t len = 0;
+  EXPECT_TRUE(bitmap_->BitOp(*ctx_, kBitOpAnd, "and", dest_key, {key_, other_key}, &len).ok());
+  bitmap_->BitCount(*ctx_, dest_key, 0, -1, false, &cnt);
+  EXPECT_EQ(cnt, 3);
+  EXPECT_TRUE(bitmap_->BitOp(*ctx_, kBitOpOr, "or", dest_key, {key_, other_key}, &len).ok());
+  bitmap_->BitCount(*ctx_, dest_key, 0, -1, false, &cnt);
+  EXPECT_EQ(cnt, 7);
+
+  std::vector<std::optional<BitfieldValue>> rets;
+  BitfieldOperation op;
+  op.type = BitfieldOperation::Type::kSet;
+  op.encoding = BitfieldEncoding::Create(BitfieldEncoding::Type::kUnsigned, 8).GetValue();
+  op.offset = 2 * 1024 * 8;
+  op.value = 0xff;
+  EXPECT_TRUE(bitmap_->Bitfield(*ctx_, key_, {op}, &rets).ok());
+  bitmap_->BitCount(*ctx_, key_, 0, -1, false, &cnt);
+  EXPECT_EQ(cnt, 14);
+
+  bitmap_->SetBit(*ctx_, key_, far_offset, false, &bit);
+  EXPECT_TRUE(bit);
+  bitmap_->BitCount(*ctx_, key_, 0, -1, false, &cnt);
+  EXPECT_EQ(cnt, 13);
+
+  std::string small_key = "test_bitmap_compressed_small";
+  bitmap_->SetBit(*ctx_, small_key, 0, true, &bit);
+  bitmap_->SetBit(*ctx_, small_key, 9, true, &bit);
+  std::string value;
+  EXPECT_TRUE(bitmap_->GetString(*ctx_, small_key, 1024, &value).ok());
+  EXPECT_EQ(value, "\x80\x40");
+
+  auto s = bitmap_->Del(*ctx_, small_key);
+  s = bitmap_->Del(*ctx_, other_key);
+  s = bitmap_->Del(*ctx_, dest_key);
+  s = bitmap_->Del(*ctx_, key_);
+  config_.bitmap_compression_enabled = false;
+}
@@ -701,3 +701,72 @@ TEST_F(RedisJsonTest, StrLen) {
     ASSERT_EQ(results[i], result1[i]);
   }
 }
+
+TEST_F(RedisJsonTest, ShreddedFormat) {
+  config_.json_storage_format = JsonStorageFormat::SHREDDED;
+  config_.json_shred_threshold = 0;
+
+  // the large member keeps "nested" as an object node, while "small" is stored as one leaf node
+  std::string big(1200, 'x');
+  std::string doc = R"({"a":1,"nested":{"arr":[1,2],"b":"x","big":")" + big + R"("},"small":{"c":true}})";
+  ASSERT_TRUE(json_->Set(*ctx_, key_, "$", doc).ok());
+  auto format = JsonStorageFormat::JSON;
+  ASSERT_TRUE(json_->Info(*ctx_, key_, &format).ok());
+  ASSERT_EQ(format, JsonStorageFormat::SHREDDED);
+  ASSERT_TRUE(json_->Get(*ctx_, key_, {}, &json_val_).ok());
+  ASSERT_EQ(json_val_.Dump().GetValue(), doc);
+
+  ASSERT_TRUE(json_->Set(*ctx_, key_, "$.nested.b", R"("y")").ok());
+  ASSERT_TRUE(json_->Set(*ctx_, key_, "$.nested['new']", R"({"d":2})").ok());
+  ASSERT_TRUE(json_->Set(*ctx_, key_, "$.small.c", "false").ok());
+
+  Optionals<size_t> append_results;
+  ASSERT_TRUE(json_->ArrAppend(*ctx_, key_, "$.nested.arr", {"3"}, &append_results).ok());
+  ASSERT_EQ(append_results.size(), 1);
+  ASSERT_EQ(append_results[0], 3);
+
+  JsonValue incr_result = JsonValue::FromString("[]").GetValue();
+  ASSERT_TRUE(json_->NumIncrBy(*ctx_, key_, "$.a", "1", &incr_result).ok());
+  ASSERT_EQ(incr_result.Print(0, true).GetValue(), "[2]");
+
+  size_t del_result = 0;
+  ASSERT_TRUE(json_->Del(*ctx_, key_, "$.nested.big", &del_result).ok());
+  ASSERT_EQ(del_result, 1);
+  ASSERT_TRUE(json_->Del(*ctx_, key_, "$.nested.big", &del_result).ok());
+  ASSERT_EQ(del_result, 0);
+
+  ASSERT_TRUE(json_->Get(*ctx_, key_, {"$.nested.arr"}, &json_val_).ok());
+  ASSERT_EQ(json_val_.Dump().GetValue(), "[[1,2,3]]");
+  ASSERT_TRUE(json_->Get(*ctx_, key_, {"$.nested.missing"}, &json_val_).ok());
+  ASSERT_EQ(json_val_.Dump().GetValue(), "[]");
+  ASSERT_TRUE(json_->Get(*ctx_, key_, {}, &json_val_).ok());
+  ASSERT_EQ(json_val_.Dump().GetValue(),
+            R"({"a":2,"nested":{"arr":[1,2,3],"b":"y","new":{"d":2}},"small":{"c":false}})");
+
+  // the paths which may select more than one value are evaluated on the whole document
+  Optionals<uint64_t> str_results;
+  ASSERT_TRUE(json_->StrAppend(*ctx_, key_, "$..b", R"("z")", &str_results).ok());
+  ASSERT_EQ(str_results.size(), 1);
+  ASSERT_EQ(str_results[0], 2);
+  ASSERT_TRUE(json_->Get(*ctx_, key_, {"$.nested.b"}, &json_val_).ok());
+  ASSERT_EQ(json_val_.Dump().GetValue(), R"(["yz"])");
+  ASSERT_TRUE(json_->Info(*ctx_, key_, &format).ok());
+  ASSERT_EQ(format, JsonStorageFormat::SHREDDED);
+
+  // documents without an object root and the ones below the threshold are kept inline
+  ASSERT_TRUE(json_->Set(*ctx_, key_, "$", "[1,2]").ok());
+  ASSERT_TRUE(json_->Info(*ctx_, key_, &format).ok());
+  ASSERT_EQ(format, JsonStorageFormat::JSON);
+  ASSERT_TRUE(json_->Get(*ctx_, key_, {}, &json_val_).ok());
+  ASSERT_EQ(json_val_.Dump().GetValue(), "[1,2]");
+
+  config_.json_shred_threshold = 1024;
+  ASSERT_TRUE(json_->Set(*ctx_, key_, "$", R"({"a":1})").ok());
+  ASSERT_TRUE(json_->Info(*ctx_, key_, &format).ok());
+  ASSERT_EQ(format, JsonStorageFormat::JSON);
+  ASSERT_TRUE(json_->Set(*ctx_, key_, "$.b", doc).ok());
+  ASSERT_TRUE(json_->Info(*ctx_, key_, &format).ok());
+  ASSERT_EQ(format, JsonStorageFormat::SHREDDED);
+  ASSERT_TRUE(json_->Get(*ctx_, key_, {"$.b.a"}, &json_val_).ok());
+  ASSERT_EQ(json_val_.Dump().GetValue(), "[1]");
+}
@@ -20,6 +20,9 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
 #include <memory>
 
 #include "test_base.h"
@@ -628,3 +631,209 @@ TEST_F(RedisListTest, RPopMultiCountGreaterThanListSize) {
   }
   s = list_->Del(*ctx_, key_);
 }
+
+TEST_F(RedisListTest, ChunkedEncoding) {
+  config_.list_chunk_size = 4;
+
+  std::deque<std::string> expected;
+  auto check = [&]() {
+    uint64_t size = 0;
+    EXPECT_TRUE(list_->Size(*ctx_, key_, &size).ok());
+    EXPECT_EQ(size, expected.size());
+
+    std::vector<std::string> elems;
+    EXPECT_TRUE(list_->Range(*ctx_, key_, 0, -1, &elems).ok());
+    EXPECT_EQ(elems, std::vector<std::string>(expected.begin(), expected.end()));
+    EXPECT_TRUE(list_->Range(*ctx_, key_, 3, 9, &elems).ok());
+    EXPECT_EQ(elems, std::vector<std::string>(expected.begin() + 3, expected.begin() + 10));
+
+    for (size_t i = 0; i < expected.size(); i++) {
+      std::string elem;
+      EXPECT_TRUE(list_->Index(*ctx_, key_, static_cast<int>(i), &elem).ok());
+      EXPECT_EQ(elem, expected[i]);
+    }
+  };
+  auto remove = [&](int count, const std::string &elem) {
+    uint64_t removed = 0;
+    EXPECT_TRUE(list_->Rem(*ctx_, key_, count, elem, &removed).ok());
+    uint64_t expected_removed = 0;
+    auto limit = count == 0 ? expected.size() : static_cast<size_t>(std::abs(count));
+    if (count < 0) std::reverse(expected.begin(), expected.end());
+    for (auto it = expected.begin(); it != expected.end() && expected_removed < limit;) {
+      if (*it == elem) {
+        it = expected.erase(it);
+        expected_removed++;
+      } else {
+        ++it;
+      }
+    }
+    if (count < 0) std::reverse(expected.begin(), expected.end());
+    EXPECT_EQ(removed, expected_removed);
+  };
+
+  std::vector<std::string> values;
+  for (int i = 0; i < 30; i++) {
+    values.emplace_back("v" + std::to_string(i));
+  }
+  uint64_t ret = 0;
+  EXPECT_TRUE(list_->Push(*ctx_, key_, {values.begin(), values.begin() + 15}, false, &ret).ok());
+  expected.insert(expected.end(), values.begin(), values.begin() + 15);
+  EXPECT_TRUE(list_->Push(*ctx_, key_, {values.begin() + 15, values.end()}, true, &ret).ok());
+  for (auto it = values.begin() + 15; it != values.end(); ++it) expected.push_front(*it);
+  EXPECT_EQ(ret, expected.size());
+  check();
+
+  // split the chunks in the middle of the list over and over again
+  int new_size = 0;
+  for (int i = 0; i < 10; i++) {
+    std::string elem = "dup" + std::to_string(i % 3);
+    EXPECT_TRUE(list_->Insert(*ctx_, key_, "v5", elem, i % 2 == 0, &new_size).ok());
+    auto pivot = std::find(expected.begin(), expected.end(), "v5");
+    expected.insert(i % 2 == 0 ? pivot : pivot + 1, elem);
+    EXPECT_EQ(new_size, static_cast<int>(expected.size()));
+  }
+  EXPECT_TRUE(list_->Insert(*ctx_, key_, "no-such-pivot", "x", true, &new_size).IsNotFound());
+  EXPECT_EQ(new_size, -1);
+  check();
+
+  remove(2, "dup0");
+  remove(-1, "dup1");
+  remove(0, "dup2");
+  uint64_t removed = 0;
+  EXPECT_TRUE(list_->Rem(*ctx_, key_, 0, "no-such-elem", &removed).IsNotFound());
+  check();
+
+  EXPECT_TRUE(list_->Set(*ctx_, key_, 7, "set").ok());
+  expected[7] = "set";
+  std::vector<int64_t> indexes;
+  PosSpec spec;
+  spec.rank = -1;
+  EXPECT_TRUE(list_->Pos(*ctx_, key_, "set", spec, &indexes).ok());
+  EXPECT_EQ(indexes, std::vector<int64_t>{7});
+  check();
+
+  EXPECT_TRUE(list_->Trim(*ctx_, key_, 2, -3).ok());
+  expected.erase(expected.begin(), expected.begin() + 2);
+  expected.erase(expected.end() - 2, expected.end());
+  check();
+
+  std::vector<std::string> elems;
+  EXPECT_TRUE(list_->PopMulti(*ctx_, key_, true, 5, &elems).ok());
+  EXPECT_EQ(elems, std::vector<std::string>(expected.begin(), expected.begin() + 5));
+  expected.erase(expected.begin(), expected.begin() + 5);
+  EXPECT_TRUE(list_->PopMulti(*ctx_, key_, false, 5, &elems).ok());
+  EXPECT_EQ(elems, std::vector<std::string>(expected.rbegin(), expected.rbegin() + 5));
+  expected.erase(expected.end() - 5, expected.end());
+  check();
+
+  std::string elem;
+  EXPECT_TRUE(list_->LMove(*ctx_, key_, key_, true, false, &elem).ok());
+  EXPECT_EQ(elem, expected.front());
+  expected.push_back(expected.front());
+  expected.pop_front();
+  EXPECT_TRUE(list_->LMove(*ctx_, key_, key_, false, true, &elem).ok());
+  EXPECT_EQ(elem, expected.back());
+  expected.push_front(expected.back());
+  expected.pop_back();
+  check();
+
+  auto s = list_->Del(*ctx_, key_);
+}
+
+TEST_F(RedisListTest, ChunkedEncodingGroups) {
+  config_.list_chunk_size = 4;
+
+  std::deque<std::string> expected;
+  auto check = [&]() {
+    uint64_t size = 0;
+    EXPECT_TRUE(list_->Size(*ctx_, key_, &size).ok());
+    EXPECT_EQ(size, expected.size());
+    for (size_t i = 0; i < expected.size(); i += 97) {
+      std::string elem;
+      EXPECT_TRUE(list_->Index(*ctx_, key_, static_cast<int>(i), &elem).ok());
+      EXPECT_EQ(elem, expected[i]);
+    }
+    std::vector<std::string> elems;
+    EXPECT_TRUE(list_->Range(*ctx_, key_, 0, -1, &elems).ok());
+    EXPECT_EQ(elems, std::vector<std::string>(expected.begin(), expected.end()));
+  };
+
+  // the list is split into many chunk groups, which are kept up by the pushes on either end
+  uint64_t ret = 0;
+  for (int i = 0; i < 40; i++) {
+    std::vector<std::string> values;
+    for (int j = 0; j < 100; j++) values.emplace_back("v" + std::to_string(i * 100 + j));
+    bool left = i % 2 == 0;
+    EXPECT_TRUE(list_->Push(*ctx_, key_, {values.begin(), values.end()}, left, &ret).ok());
+    for (const auto &value : values) left ? expected.push_front(value) : expected.push_back(value);
+  }
+  EXPECT_EQ(ret, expected.size());
+  check();
+
+  int new_size = 0;
+  for (int i = 0; i < 200; i++) {
+    std::string pivot = "v" + std::to_string(i * 17);
+    EXPECT_TRUE(list_->Insert(*ctx_, key_, pivot, "new" + std::to_string(i), true, &new_size).ok());
+    expected.insert(std::find(expected.begin(), expected.end(), pivot), "new" + std::to_string(i));
+  }
+  for (int i = 0; i < 100; i++) {
+    std::string elem = "v" + std::to_string(i * 31);
+    EXPECT_TRUE(list_->Set(*ctx_, key_, static_cast<int>(i * 37), elem).ok());
+    expected[i * 37] = elem;
+  }
+  check();
+
+  uint64_t removed = 0;
+  for (int i = 0; i < 1000; i += 3) {
+    std::string elem = "v" + std::to_string(i);
+    auto count = std::count(expected.begin(), expected.end(), elem);
+    auto s = list_->Rem(*ctx_, key_, 0, elem, &removed);
+    EXPECT_EQ(s.IsNotFound(), count == 0);
+    if (count > 0) EXPECT_EQ(removed, static_cast<uint64_t>(count));
+    expected.erase(std::remove(expected.begin(), expected.end(), elem), expected.end());
+  }
+  check();
+
+  EXPECT_TRUE(list_->Trim(*ctx_, key_, 500, -700).ok());
+  expected.erase(expected.begin(), expected.begin() + 500);
+  expected.erase(expected.end() - 699, expected.end());
+  std::vector<std::string> elems;
+  EXPECT_TRUE(list_->PopMulti(*ctx_, key_, true, 300, &elems).ok());
+  expected.erase(expected.begin(), expected.begin() + 300);
+  EXPECT_TRUE(list_->PopMulti(*ctx_, key_, false, 300, &elems).ok());
+  expected.erase(expected.end() - 300, expected.end());
+  check();
+
+  auto s = list_->Del(*ctx_, key_);
+}
+
+TEST_F(RedisListTest, ChunkedEncodingConversion) {
+  uint64_t ret = 0;
+  list_->Push(*ctx_, key_, fields_, false, &ret);
+  EXPECT_EQ(fields_.size(), ret);
+
+  // the list is converted into chunks by the first LINSERT or LREM
+  config_.list_chunk_size = 4;
+  int new_size = 0;
+  EXPECT_TRUE(list_->Insert(*ctx_, key_, "list-test-key-3", "new", true, &new_size).ok());
+  EXPECT_EQ(new_size, static_cast<int>(fields_.size() + 1));
+  uint64_t removed = 0;
+  EXPECT_TRUE(list_->Rem(*ctx_, key_, 0, "list-test-key-1", &removed).ok());
+  EXPECT_EQ(removed, static_cast<uint64_t>(m_));
+
+  std::vector<std::string> expected;
+  for (size_t i = 0; i < fields_.size(); i++) {
+    if (i == 2) expected.emplace_back("new");
+    if (fields_[i] != "list-test-key-1") expected.emplace_back(fields_[i].ToString());
+  }
+  std::vector<std::string> elems;
+  EXPECT_TRUE(list_->Range(*ctx_, key_, 0, -1, &elems).ok());
+  EXPECT_EQ(elems, expected);
+
+  EXPECT_TRUE(list_->Push(*ctx_, key_, {"tail"}, false, &ret).ok());
+  EXPECT_EQ(ret, expected.size() + 1);
+  std::string elem;
+  EXPECT_TRUE(list_->Index(*ctx_, key_, -1, &elem).ok());
+  EXPECT_EQ(elem, "tail");
+  auto s = list_->Del(*ctx_, key_);
+}
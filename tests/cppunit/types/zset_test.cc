@@ -20,6 +20,9 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <iterator>
+#include <map>
 #include <memory>
 
 #include "test_base.h"
@@ -613,3 +616,196 @@ TEST_F(RedisZSetTest, DiffStore) {
   s = zset_->Del(*ctx_, "zsetdiff");
   EXPECT_TRUE(s.ok());
 }
+
+TEST_F(RedisZSetTest, RankIndex) {
+  // values below a single leaf are raised to the leaf size
+  config_.zset_rank_index_threshold = 1;
+
+  std::map<std::string, double> members;
+  auto check = [&]() {
+    std::vector<MemberScore> expected;
+    for (const auto &[member, score] : members) expected.emplace_back(MemberScore{member, score});
+    std::sort(expected.begin(), expected.end(), [](const MemberScore &a, const MemberScore &b) {
+      return a.score < b.score || (a.score == b.score && a.member < b.member);
+    });
+    auto size = static_cast<int>(expected.size());
+
+    uint64_t card = 0;
+    zset_->Card(*ctx_, key_, &card);
+    ASSERT_EQ(card, expected.size());
+
+    for (int i = 0; i < size; i += 97) {
+      int rank = -1;
+      double score = 0;
+      zset_->Rank(*ctx_, key_, expected[i].member, false, &rank, &score);
+      EXPECT_EQ(rank, i);
+      EXPECT_EQ(score, expected[i].score);
+      zset_->Rank(*ctx_, key_, expected[i].member, true, &rank, &score);
+      EXPECT_EQ(rank, size - 1 - i);
+    }
+
+    for (int start : {0, size / 3, size / 2, size - 10}) {
+      RangeRankSpec spec;
+      spec.start = start;
+      spec.stop = start + 9;
+      std::vector<MemberScore> mscores;
+      zset_->RangeByRank(*ctx_, key_, spec, &mscores, nullptr);
+      ASSERT_EQ(mscores.size(), 10);
+      for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(mscores[i].member, expected[start + i].member);
+      }
+      spec.reversed = true;
+      zset_->RangeByRank(*ctx_, key_, spec, &mscores, nullptr);
+      ASSERT_EQ(mscores.size(), 10);
+      for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(mscores[i].member, expected[size - 1 - start - i].member);
+      }
+    }
+
+    std::vector<std::pair<double, double>> ranges = {{-1, 2000}, {100, 200}, {300, 300}, {500, 100}};
+    for (const auto &range : ranges) {
+      RangeScoreSpec spec;
+      spec.min = range.first;
+      spec.max = range.second;
+      spec.minex = true;
+      uint64_t count = 0;
+      zset_->Count(*ctx_, key_, spec, &count);
+      auto in_range = [&range](const MemberScore &ms) { return ms.score > range.first && ms.score <= range.second; };
+      EXPECT_EQ(count, static_cast<uint64_t>(std::count_if(expected.begin(), expected.end(), in_range)));
+    }
+  };
+
+  uint64_t ret = 0;
+  std::vector<MemberScore> mscores;
+  for (int i = 0; i < 5000; i++) {
+    mscores.emplace_back(MemberScore{"member-" + std::to_string(i), static_cast<double>((i * 7919) % 1000)});
+    members[mscores.back().member] = mscores.back().score;
+    if (mscores.size() == 500) {
+      zset_->Add(*ctx_, key_, ZAddFlags::Default(), &mscores, &ret);
+      EXPECT_EQ(ret, 500);
+      mscores.clear();
+    }
+  }
+  check();
+
+  // score updates move the members across the leaves
+  for (int i = 0; i < 5000; i += 3) {
+    mscores.emplace_back(MemberScore{"member-" + std::to_string(i), static_cast<double>(1000 + i % 100)});
+    members[mscores.back().member] = mscores.back().score;
+  }
+  zset_->Add(*ctx_, key_, ZAddFlags::Default(), &mscores, &ret);
+  mscores.clear();
+  check();
+
+  std::vector<Slice> to_remove;
+  std::vector<std::string> removed_members;
+  for (int i = 1; i < 5000; i += 4) removed_members.emplace_back("member-" + std::to_string(i));
+  for (const auto &member : removed_members) {
+    to_remove.emplace_back(member);
+    members.erase(member);
+  }
+  zset_->Remove(*ctx_, key_, to_remove, &ret);
+  EXPECT_EQ(ret, removed_members.size());
+  check();
+
+  zset_->Pop(*ctx_, key_, 300, true, &mscores);
+  for (const auto &ms : mscores) members.erase(ms.member);
+  zset_->Pop(*ctx_, key_, 300, false, &mscores);
+  for (const auto &ms : mscores) members.erase(ms.member);
+  check();
+
+  RangeRankSpec rank_spec;
+  rank_spec.start = 100;
+  rank_spec.stop = 1099;
+  rank_spec.with_deletion = true;
+  zset_->RangeByRank(*ctx_, key_, RangeRankSpec(), &mscores, nullptr);
+  for (int i = rank_spec.start; i <= rank_spec.stop; i++) members.erase(mscores[i].member);
+  zset_->RangeByRank(*ctx_, key_, rank_spec, nullptr, &ret);
+  EXPECT_EQ(ret, 1000);
+  check();
+
+  // the index is dropped once the sorted set shrinks into a single leaf
+  RangeScoreSpec score_spec;
+  score_spec.min = 50;
+  score_spec.with_deletion = true;
+  zset_->RangeByScore(*ctx_, key_, score_spec, nullptr, &ret);
+  for (auto iter = members.begin(); iter != members.end();) {
+    iter = iter->second >= 50 ? members.erase(iter) : std::next(iter);
+  }
+  EXPECT_LT(members.size(), kZSetRankIndexLeafMaxSize);
+  check();
+
+  auto s = zset_->Del(*ctx_, key_);
+  EXPECT_TRUE(s.ok());
+}
+
+TEST_F(RedisZSetTest, RankIndexLevels) {
+  config_.zset_rank_index_threshold = 1024;
+  auto has_rank_index = [this]() {
+    ZSetMetadata metadata(false);
+    zset_->GetMetadata(*ctx_, zset_->AppendNamespacePrefix(key_), &metadata);
+    return metadata.HasRankIndex();
+  };
+  // the members are ranked by their ids, ten of them share a score
+  auto member = [](int id) { return "member-" + std::to_string(100000 + id); };
+  auto check = [&](const std::vector<int> &ids) {
+    auto size = static_cast<int>(ids.size());
+    for (int i = 0; i < size; i += 7919) {
+      int rank = -1;
+      double score = 0;
+      zset_->Rank(*ctx_, key_, member(ids[i]), false, &rank, &score);
+      EXPECT_EQ(rank, i);
+      zset_->Rank(*ctx_, key_, member(ids[i]), true, &rank, &score);
+      EXPECT_EQ(rank, size - 1 - i);
+
+      RangeRankSpec spec;
+      spec.start = i;
+      spec.stop = i + 4;
+      std::vector<MemberScore> mscores;
+      zset_->RangeByRank(*ctx_, key_, spec, &mscores, nullptr);
+      ASSERT_EQ(mscores.size(), static_cast<size_t>(std::min(5, size - i)));
+      for (size_t j = 0; j < mscores.size(); j++) {
+        EXPECT_EQ(mscores[j].member, member(ids[i + j]));
+      }
+    }
+  };
+
+  // more leaves than a node holds, so the leaves are summarized by more than one level of nodes
+  const int size = 80000;
+  uint64_t ret = 0;
+  std::vector<MemberScore> mscores;
+  std::vector<int> ids;
+  for (int i = 0; i < size; i++) {
+    mscores.emplace_back(MemberScore{member(i), static_cast<double>(i / 10)});
+    ids.emplace_back(i);
+    if (mscores.size() == 1000) {
+      zset_->Add(*ctx_, key_, ZAddFlags::Default(), &mscores, &ret);
+      EXPECT_EQ(ret, 1000);
+      mscores.clear();
+    }
+  }
+  EXPECT_TRUE(has_rank_index());
+  check(ids);
+
+  // the nodes shrink and merge as well
+  std::vector<std::string> removed_members;
+  for (int i = 1; i < 60000; i += 2) removed_members.emplace_back(member(i));
+  std::vector<Slice> to_remove(removed_members.begin(), removed_members.end());
+  zset_->Remove(*ctx_, key_, to_remove, &ret);
+  EXPECT_EQ(ret, removed_members.size());
+  ids.erase(std::remove_if(ids.begin(), ids.end(), [](int id) { return id < 60000 && id % 2 == 1; }), ids.end());
+  check(ids);
+
+  RangeRankSpec spec;
+  spec.start = 0;
+  spec.stop = static_cast<int>(ids.size()) - 1000;
+  spec.with_deletion = true;
+  zset_->RangeByRank(*ctx_, key_, spec, nullptr, &ret);
+  ids.erase(ids.begin(), ids.begin() + spec.stop + 1);
+  EXPECT_EQ(ids.size(), 999);
+  EXPECT_FALSE(has_rank_index());
+  check(ids);
+
+  auto s = zset_->Del(*ctx_, key_);
+  EXPECT_TRUE(s.ok());
+}
@@ -0,0 +1,102 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "search/vector_distance.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+static std::vector<float> RandomVector(std::mt19937 &gen, size_t dim) {
+  std::uniform_real_distribution<float> dist(-1, 1);
+  std::vector<float> vec(dim);
+  for (auto &v : vec) v = dist(gen);
+  return vec;
+}
+
+TEST(VectorDistance, KernelsMatchFloat64) {
+  std::mt19937 gen(42);
+  const auto &kernels = redis::GetVectorDistanceKernels();
+  const auto &scalar = redis::GetScalarVectorDistanceKernels();
+
+  // Cover the empty vector, the tails after each SIMD width and a typical embedding size
+  for (size_t dim : {0, 1, 3, 7, 8, 9, 15, 16, 17, 31, 32, 33, 100, 768}) {
+    auto left = RandomVector(gen, dim);
+    auto right = RandomVector(gen, dim);
+
+    double l2 = 0, ip = 0, norm_left = 0, norm_right = 0;
+    for (size_t i = 0; i < dim; i++) {
+      double diff = double(left[i]) - right[i];
+      l2 += diff * diff;
+      ip += double(left[i]) * right[i];
+      norm_left += double(left[i]) * left[i];
+      norm_right += double(right[i]) * right[i];
+    }
+
+    for (const auto *k : {&kernels, &scalar}) {
+      double tolerance = 1e-5 * double(dim + 1);
+      EXPECT_NEAR(k->l2_squared(left.data(), right.data(), dim), l2, tolerance) << k->name << " dim " << dim;
+      EXPECT_NEAR(k->inner_product(left.data(), right.data(), dim), ip, tolerance) << k->name << " dim " << dim;
+
+      float dot = 0, k_norm_left = 0, k_norm_right = 0;
+      k->cosine_terms(left.data(), right.data(), dim, &dot, &k_norm_left, &k_norm_right);
+      EXPECT_NEAR(dot, ip, tolerance) << k->name << " dim " << dim;
+      EXPECT_NEAR(k_norm_left, norm_left, tolerance) << k->name << " dim " << dim;
+      EXPECT_NEAR(k_norm_right, norm_right, tolerance) << k->name << " dim " << dim;
+    }
+  }
+}
+
+// A micro benchmark of the L2 distance kernels, it's disabled by default and run with --gtest_also_run_disabled_tests
+TEST(VectorDistance, DISABLED_Benchmark) {
+  constexpr size_t dim = 768;
+  constexpr int rounds = 100000;
+
+  std::mt19937 gen(42);
+  auto left = RandomVector(gen, dim);
+  auto right = RandomVector(gen, dim);
+  std::vector<double> left_f64(left.begin(), left.end());
+  std::vector<double> right_f64(right.begin(), right.end());
+
+  auto measure = [&](const char *name, auto &&fn) {
+    double sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) sink += fn();
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << elapsed / rounds << " ns per L2 distance of dim " << dim << " (" << sink << ")"
+              << std::endl;
+  };
+
+  measure("float64 loop", [&] {
+    double dist = 0;
+    for (size_t i = 0; i < dim; i++) {
+      double diff = left_f64[i] - right_f64[i];
+      dist += diff * diff;
+    }
+    return dist;
+  });
+  const auto &scalar = redis::GetScalarVectorDistanceKernels();
+  measure(scalar.name, [&] { return scalar.l2_squared(left.data(), right.data(), dim); });
+  const auto &kernels = redis::GetVectorDistanceKernels();
+  measure(kernels.name, [&] { return kernels.l2_squared(left.data(), right.data(), dim); });
+}
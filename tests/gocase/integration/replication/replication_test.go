@@ -552,3 +552,90 @@ func TestFullSyncReplication(t *testing.T) {
 		require.Equal(t, "bar", slaveClient.Get(ctx, "foo").Val())
 	})
 }
+
+func TestReplicationWithCompression(t *testing.T) {
+	master := util.StartServer(t, map[string]string{
+		"rocksdb.compression":             "no",
+		"rocksdb.write_buffer_size":       "4",
+		"rocksdb.target_file_size_base":   "16",
+		"rocksdb.max_write_buffer_number": "1",
+		"rocksdb.wal_ttl_seconds":         "0",
+		"rocksdb.wal_size_limit_mb":       "0",
+	})
+	defer master.Close()
+	masterClient := master.NewClient()
+	defer func() { require.NoError(t, masterClient.Close()) }()
+
+	slave := util.StartServer(t, map[string]string{"replication-compression": "zstd"})
+	defer slave.Close()
+	slaveClient := slave.NewClient()
+	defer func() { require.NoError(t, slaveClient.Close()) }()
+
+	ctx := context.Background()
+
+	t.Run("Full sync and incremental replication with compression", func(t *testing.T) {
+		value := strings.Repeat("a", 128*1024)
+		for i := 0; i < 256; i++ {
+			require.NoError(t, masterClient.Set(ctx, fmt.Sprintf("key%d", i), value, 0).Err())
+		}
+
+		util.SlaveOf(t, slaveClient, master)
+		util.WaitForOffsetSync(t, masterClient, slaveClient, 60*time.Second)
+		require.Equal(t, value, slaveClient.Get(ctx, "key1").Val())
+
+		require.NoError(t, masterClient.Set(ctx, "foo", strings.Repeat("bar", 1024), 0).Err())
+		util.WaitForOffsetSync(t, masterClient, slaveClient, 5*time.Second)
+		require.Equal(t, strings.Repeat("bar", 1024), slaveClient.Get(ctx, "foo").Val())
+
+		require.Contains(t, masterClient.Info(ctx, "replication").Val(), "compression=zstd")
+		rawBytes, err := strconv.Atoi(util.FindInfoEntry(masterClient, "stream_compression_raw_bytes"))
+		require.NoError(t, err)
+		compressedBytes, err := strconv.Atoi(util.FindInfoEntry(masterClient, "stream_compression_compressed_bytes"))
+		require.NoError(t, err)
+		require.Greater(t, compressedBytes, 0)
+		require.Less(t, compressedBytes, rawBytes)
+		decompressedBytes, err := strconv.Atoi(util.FindInfoEntry(slaveClient, "stream_decompression_raw_bytes"))
+		require.NoError(t, err)
+		require.Greater(t, decompressedBytes, 0)
+	})
+}
+
+func TestReplicationWait(t *testing.T) {
+	master := util.StartServer(t, map[string]string{})
+	defer master.Close()
+	masterClient := master.NewClient()
+	defer func() { require.NoError(t, masterClient.Close()) }()
+
+	slave := util.StartServer(t, map[string]string{})
+	defer slave.Close()
+	slaveClient := slave.NewClient()
+	defer func() { require.NoError(t, slaveClient.Close()) }()
+
+	ctx := context.Background()
+
+	t.Run("WAIT returns immediately without the replicas required", func(t *testing.T) {
+		require.NoError(t, masterClient.Set(ctx, "foo", "bar", 0).Err())
+		require.EqualValues(t, 0, masterClient.Do(ctx, "WAIT", "0", "0").Val())
+		require.EqualValues(t, 0, masterClient.Do(ctx, "WAIT", "1", "100").Val())
+	})
+
+	util.SlaveOf(t, slaveClient, master)
+	util.WaitForSync(t, slaveClient)
+
+	t.Run("WAIT blocks until the replica acknowledges the writes", func(t *testing.T) {
+		require.NoError(t, masterClient.Set(ctx, "foo", "baz", 0).Err())
+		require.EqualValues(t, 1, masterClient.Do(ctx, "WAIT", "1", "0").Val())
+		require.Equal(t, "baz", slaveClient.Get(ctx, "foo").Val())
+	})
+
+	t.Run("WAIT times out with the replicas acknowledged", func(t *testing.T) {
+		require.NoError(t, masterClient.Set(ctx, "foo", "qux", 0).Err())
+		start := time.Now()
+		require.EqualValues(t, 1, masterClient.Do(ctx, "WAIT", "2", "200").Val())
+		require.GreaterOrEqual(t, time.Since(start), 200*time.Millisecond)
+	})
+
+	t.Run("WAIT is not allowed in the replica", func(t *testing.T) {
+		require.ErrorContains(t, slaveClient.Do(ctx, "WAIT", "0", "0").Err(), "replica")
+	})
+}
@@ -47,6 +47,7 @@ const (
 
 	MigrationTypeRedisCommand SlotMigrationType = "redis-command"
 	MigrationTypeRawKeyValue  SlotMigrationType = "raw-key-value"
+	MigrationTypeRawSST       SlotMigrationType = "raw-sst"
 )
 
 var testSlot = 0
@@ -941,7 +942,74 @@ func TestSlotMigrateDataType(t *testing.T) {
 		require.EqualValues(t, 0, rdb0.Exists(ctx, util.SlotTable[slotWithDeletedKey]).Val())
 	}
 
-	testMigrationTypes := []SlotMigrationType{MigrationTypeRedisCommand, MigrationTypeRawKeyValue}
+	migrateZSetWithRankIndex := func(t *testing.T, migrateType SlotMigrationType) {
+		require.NoError(t, rdb0.ConfigSet(ctx, "migrate-type", string(migrateType)).Err())
+		for _, rdb := range []*redis.Client{rdb0, rdb1} {
+			require.NoError(t, rdb.ConfigSet(ctx, "zset-rank-index-threshold", "1024").Err())
+		}
+		defer func() {
+			for _, rdb := range []*redis.Client{rdb0, rdb1} {
+				require.NoError(t, rdb.ConfigSet(ctx, "zset-rank-index-threshold", "0").Err())
+			}
+		}()
+		testSlot += 1
+		migratingSlot := testSlot
+		hashtag := util.SlotTable[migratingSlot]
+		// the list slows down the snapshot, so the writes to the sorted set are caught up from the WAL
+		listKey := hashtag
+		zsetKey := fmt.Sprintf("{%s}_zset", hashtag)
+
+		valuePrefix := "value"
+		if migrateType == MigrationTypeRedisCommand {
+			require.NoError(t, rdb0.ConfigSet(ctx, "migrate-speed", "64").Err())
+			defer func() {
+				require.NoError(t, rdb0.ConfigSet(ctx, "migrate-speed", "4096").Err())
+			}()
+		} else {
+			valuePrefix = strings.Repeat("value", 1024)
+			require.NoError(t, rdb0.ConfigSet(ctx, "migrate-batch-rate-limit-mb", "1").Err())
+		}
+		for i := 0; i < 2000; i++ {
+			require.NoError(t, rdb0.LPush(ctx, listKey, fmt.Sprintf("%s-%d", valuePrefix, i)).Err())
+		}
+
+		// the sorted set is large enough to be indexed on the source
+		members := make([]redis.Z, 0, 3000)
+		for i := 0; i < 3000; i++ {
+			members = append(members, redis.Z{Score: float64(i), Member: fmt.Sprintf("m-%d", i)})
+		}
+		require.NoError(t, rdb0.ZAdd(ctx, zsetKey, members...).Err())
+
+		require.Equal(t, "OK", rdb0.Do(ctx, "clusterx", "migrate", migratingSlot, id1).Val())
+		// update the index of the source while migrating, the updates touch only a part of its leaves
+		for i := 1; i <= 100; i++ {
+			require.NoError(t, rdb0.ZAdd(ctx, zsetKey, redis.Z{Score: float64(-i), Member: fmt.Sprintf("n-%d", i)}).Err())
+		}
+		for i := 0; i < 50; i++ {
+			require.NoError(t, rdb0.ZRem(ctx, zsetKey, fmt.Sprintf("m-%d", i)).Err())
+		}
+		waitForMigrateStateInDuration(t, rdb0, migratingSlot, SlotMigrationStateSuccess, time.Minute)
+		waitForImportState(t, rdb1, migratingSlot, SlotImportStateSuccess)
+
+		// n-100 ... n-1 go first, followed by m-50 ... m-2999
+		require.EqualValues(t, 3050, rdb1.ZCard(ctx, zsetKey).Val())
+		require.EqualValues(t, 0, rdb1.ZRank(ctx, zsetKey, "n-100").Val())
+		require.EqualValues(t, 100, rdb1.ZRank(ctx, zsetKey, "m-50").Val())
+		require.EqualValues(t, 3049, rdb1.ZRank(ctx, zsetKey, "m-2999").Val())
+		require.EqualValues(t, 0, rdb1.ZRevRank(ctx, zsetKey, "m-2999").Val())
+		require.EqualValues(t, []string{"m-1450", "m-1451", "m-1452"}, rdb1.ZRange(ctx, zsetKey, 1500, 1502).Val())
+		require.EqualValues(t, 1050, rdb1.ZCount(ctx, zsetKey, "-inf", "999").Val())
+
+		// the destination builds its own index on the next write
+		require.NoError(t, rdb1.ZAdd(ctx, zsetKey, redis.Z{Score: -1000, Member: "x"}).Err())
+		require.EqualValues(t, 101, rdb1.ZRank(ctx, zsetKey, "m-50").Val())
+		require.EqualValues(t, []string{"m-1449", "m-1450"}, rdb1.ZRange(ctx, zsetKey, 1500, 1501).Val())
+		require.EqualValues(t, 1, rdb1.ZRemRangeByRank(ctx, zsetKey, 0, 0).Val())
+		require.EqualValues(t, 100, rdb1.ZRank(ctx, zsetKey, "m-50").Val())
+		require.EqualValues(t, 1050, rdb1.ZCount(ctx, zsetKey, "-inf", "999").Val())
+	}
+
+	testMigrationTypes := []SlotMigrationType{MigrationTypeRedisCommand, MigrationTypeRawKeyValue, MigrationTypeRawSST}
 
 	for _, testType := range testMigrationTypes {
 		t.Run(fmt.Sprintf("MIGRATE - Slot migrate all types of existing data using %s", testType), func(t *testing.T) {
@@ -967,6 +1035,10 @@ func TestSlotMigrateDataType(t *testing.T) {
 		t.Run(fmt.Sprintf("MIGRATE - Migrate incremental data via parsing and filtering data in WAL using %s", testType), func(t *testing.T) {
 			migrateIncrementalData(t, testType)
 		})
+
+		t.Run(fmt.Sprintf("MIGRATE - Migrate sorted set with rank index while writing using %s", testType), func(t *testing.T) {
+			migrateZSetWithRankIndex(t, testType)
+		})
 	}
 
 	t.Run("MIGRATE - Accessing slot is forbidden on source server but not on destination server", func(t *testing.T) {
@@ -1331,6 +1403,24 @@ func TestSlotRangeMigrate(t *testing.T) {
 		require.ErrorContains(t, rdb0.Do(ctx, "clusterx", "migrate", "110-112", id1).Err(), errMsg)
 	})
 
+	t.Run("MIGRATE - Slot range migration with multiple snapshot streams", func(t *testing.T) {
+		require.NoError(t, rdb0.ConfigSet(ctx, "migrate-type", string(MigrationTypeRawKeyValue)).Err())
+		require.NoError(t, rdb0.ConfigSet(ctx, "migrate-snapshot-streams", "4").Err())
+		require.NoError(t, rdb0.ConfigSet(ctx, "migrate-batch-window", "4").Err())
+		require.NoError(t, rdb0.ConfigSet(ctx, "migrate-batch-size-kb", "1").Err())
+		defer func() {
+			require.NoError(t, rdb0.ConfigSet(ctx, "migrate-type", string(MigrationTypeRedisCommand)).Err())
+			require.NoError(t, rdb0.ConfigSet(ctx, "migrate-snapshot-streams", "1").Err())
+			require.NoError(t, rdb0.ConfigSet(ctx, "migrate-batch-window", "16").Err())
+			require.NoError(t, rdb0.ConfigSet(ctx, "migrate-batch-size-kb", "16").Err())
+		}()
+
+		migrateSlotRangeAndSetSlot(t, ctx, rdb0, rdb1, id1, "120-149")
+		for slot := 120; slot <= 149; slot++ {
+			require.EqualValues(t, 10, rdb1.LLen(ctx, util.SlotTable[slot]).Val())
+		}
+	})
+
 	t.Run("MIGRATE - Failure cases", func(t *testing.T) {
 		largeSlot := 210
 		for i := 0; i < 20000; i++ {
@@ -0,0 +1,104 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+package latency
+
+import (
+	"context"
+	"strings"
+	"testing"
+
+	"github.com/apache/kvrocks/tests/gocase/util"
+	"github.com/stretchr/testify/require"
+)
+
+func TestLatency(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{
+		"resp3-enabled": "yes",
+	})
+	defer srv.Close()
+	ctx := context.Background()
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	t.Run("LATENCY - the monitor is disabled by default", func(t *testing.T) {
+		require.NoError(t, rdb.Do(ctx, "debug", "sleep", 0.1).Err())
+		val, err := rdb.Do(ctx, "latency", "latest").Slice()
+		require.NoError(t, err)
+		require.Len(t, val, 0)
+	})
+
+	t.Run("LATENCY - LATEST and HISTORY report the slow commands", func(t *testing.T) {
+		require.NoError(t, rdb.ConfigSet(ctx, "latency-monitor-threshold", "50").Err())
+		require.NoError(t, rdb.Do(ctx, "debug", "sleep", 0.1).Err())
+
+		val, err := rdb.Do(ctx, "latency", "latest").Slice()
+		require.NoError(t, err)
+		require.Len(t, val, 1)
+		latest := val[0].([]interface{})
+		require.EqualValues(t, "command", latest[0])
+		require.GreaterOrEqual(t, latest[2].(int64), int64(100))
+		require.GreaterOrEqual(t, latest[3].(int64), int64(100))
+
+		val, err = rdb.Do(ctx, "latency", "history", "command").Slice()
+		require.NoError(t, err)
+		require.Len(t, val, 1)
+		require.GreaterOrEqual(t, val[0].([]interface{})[1].(int64), int64(100))
+	})
+
+	t.Run("LATENCY - RESET clears the events", func(t *testing.T) {
+		require.EqualValues(t, 0, rdb.Do(ctx, "latency", "reset", "flush").Val())
+		require.EqualValues(t, 1, rdb.Do(ctx, "latency", "reset").Val())
+		val, err := rdb.Do(ctx, "latency", "latest").Slice()
+		require.NoError(t, err)
+		require.Len(t, val, 0)
+		require.NoError(t, rdb.ConfigSet(ctx, "latency-monitor-threshold", "0").Err())
+	})
+
+	t.Run("LATENCY - HISTOGRAM reports the cumulative counts of the commands", func(t *testing.T) {
+		for i := 0; i < 10; i++ {
+			require.NoError(t, rdb.Set(ctx, "foo", "bar", 0).Err())
+		}
+		val, err := rdb.Do(ctx, "latency", "histogram", "SET").Result()
+		require.NoError(t, err)
+		histograms := val.(map[interface{}]interface{})
+		require.Len(t, histograms, 1)
+		set := histograms["set"].(map[interface{}]interface{})
+		require.EqualValues(t, 10, set["calls"])
+		buckets := set["histogram_usec"].(map[interface{}]interface{})
+		require.NotEmpty(t, buckets)
+		var total int64
+		for _, count := range buckets {
+			total = max(total, count.(int64))
+		}
+		require.EqualValues(t, 10, total)
+	})
+
+	t.Run("INFO latencystats reports the percentiles", func(t *testing.T) {
+		info := rdb.Info(ctx, "latencystats").Val()
+		require.Contains(t, info, "# Latencystats")
+		for _, line := range strings.Split(info, "\r\n") {
+			if strings.HasPrefix(line, "latency_percentiles_usec_set:") {
+				require.Regexp(t, `^latency_percentiles_usec_set:p50=\d+,p99=\d+,p99\.9=\d+$`, line)
+				return
+			}
+		}
+		require.Fail(t, "no latency percentiles of SET")
+	})
+}
@@ -22,6 +22,7 @@ package multi
 import (
 	"context"
 	"fmt"
+	"sync"
 	"testing"
 
 	"github.com/apache/kvrocks/tests/gocase/util"
@@ -323,3 +324,103 @@ func TestMulti(t *testing.T) {
 		require.Equal(t, rdb.Do(ctx, "EXEC").Val(), []interface{}{int64(51)})
 	})
 }
+
+func TestMultiWithKeyLocking(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{"txn-key-locking-enabled": "yes"})
+	defer srv.Close()
+
+	ctx := context.Background()
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	t.Run("Transactions on the keys run concurrently and atomically", func(t *testing.T) {
+		var wg sync.WaitGroup
+		for i := 0; i < 8; i++ {
+			wg.Add(1)
+			go func() {
+				defer wg.Done()
+				c := srv.NewClient()
+				defer func() { require.NoError(t, c.Close()) }()
+				for j := 0; j < 100; j++ {
+					_, err := c.TxPipelined(ctx, func(pipe redis.Pipeliner) error {
+						pipe.Incr(ctx, "a")
+						pipe.Decr(ctx, "b")
+						pipe.MGet(ctx, "a", "b")
+						return nil
+					})
+					require.NoError(t, err)
+				}
+			}()
+		}
+		wg.Wait()
+		require.Equal(t, []interface{}{"800", "-800"}, rdb.MGet(ctx, "a", "b").Val())
+	})
+
+	t.Run("Writes of the transaction are applied as a whole", func(t *testing.T) {
+		require.NoError(t, rdb.Del(ctx, "k1", "k2").Err())
+		cmds, err := rdb.TxPipelined(ctx, func(pipe redis.Pipeliner) error {
+			pipe.Set(ctx, "k1", "a", 0)
+			pipe.Set(ctx, "k2", "b", 0)
+			pipe.MGet(ctx, "k1", "k2")
+			return nil
+		})
+		require.NoError(t, err)
+		require.Equal(t, []interface{}{"a", "b"}, cmds[2].(*redis.SliceCmd).Val())
+	})
+
+	t.Run("Transactions without keys or watching keys run exclusively as before", func(t *testing.T) {
+		require.NoError(t, rdb.Do(ctx, "MULTI").Err())
+		require.NoError(t, rdb.Do(ctx, "PING").Err())
+		require.NoError(t, rdb.Do(ctx, "SET", "x", "1").Err())
+		require.Equal(t, []interface{}{"PONG", "OK"}, rdb.Do(ctx, "EXEC").Val())
+
+		rdb2 := srv.NewClient()
+		defer func() { require.NoError(t, rdb2.Close()) }()
+		require.NoError(t, rdb.Do(ctx, "WATCH", "x").Err())
+		require.NoError(t, rdb2.Set(ctx, "x", "2", 0).Err())
+		require.NoError(t, rdb.Do(ctx, "MULTI").Err())
+		require.NoError(t, rdb.Do(ctx, "SET", "x", "3").Err())
+		require.Equal(t, nil, rdb.Do(ctx, "EXEC").Val())
+		require.Equal(t, "2", rdb.Get(ctx, "x").Val())
+	})
+
+	t.Run("Transactions lock the STORE destination of SORT", func(t *testing.T) {
+		require.NoError(t, rdb.Del(ctx, "sortdst").Err())
+		var wg sync.WaitGroup
+		for i := 0; i < 8; i++ {
+			src := fmt.Sprintf("sortsrc%d", i)
+			require.NoError(t, rdb.Del(ctx, src).Err())
+			require.NoError(t, rdb.RPush(ctx, src, i, i+10).Err())
+			wg.Add(1)
+			go func() {
+				defer wg.Done()
+				c := srv.NewClient()
+				defer func() { require.NoError(t, c.Close()) }()
+				for j := 0; j < 50; j++ {
+					cmds, err := c.TxPipelined(ctx, func(pipe redis.Pipeliner) error {
+						pipe.SortStore(ctx, src, "sortdst", &redis.Sort{})
+						pipe.RPush(ctx, "sortdst", "end")
+						pipe.LRange(ctx, "sortdst", 0, -1)
+						return nil
+					})
+					require.NoError(t, err)
+					require.Len(t, cmds[2].(*redis.StringSliceCmd).Val(), 3)
+				}
+			}()
+		}
+		wg.Wait()
+		require.Len(t, rdb.LRange(ctx, "sortdst", 0, -1).Val(), 3)
+	})
+
+	t.Run("Transactions accessing the keys out of the key range run exclusively", func(t *testing.T) {
+		require.NoError(t, rdb.Del(ctx, "sortsrc", "w_1", "w_2").Err())
+		require.NoError(t, rdb.RPush(ctx, "sortsrc", 1, 2).Err())
+		require.NoError(t, rdb.MSet(ctx, "w_1", 20, "w_2", 10).Err())
+		cmds, err := rdb.TxPipelined(ctx, func(pipe redis.Pipeliner) error {
+			pipe.Sort(ctx, "sortsrc", &redis.Sort{By: "w_*"})
+			return nil
+		})
+		require.NoError(t, err)
+		require.Equal(t, []string{"2", "1"}, cmds[0].(*redis.StringSliceCmd).Val())
+	})
+}
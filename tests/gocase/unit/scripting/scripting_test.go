@@ -23,6 +23,7 @@ import (
 	"context"
 	"fmt"
 	"math/big"
+	"sync"
 	"testing"
 	"time"
 
@@ -542,6 +543,15 @@ func TestScriptingWithRESP3(t *testing.T) {
 		require.Equal(t, map[interface{}]interface{}{"f1": "v1", "f2": "v2"}, val)
 	})
 
+	t.Run("EVAL - Redis protocol type null conversion", func(t *testing.T) {
+		require.NoError(t, rdb.Del(ctx, "mynull").Err())
+		script := `if redis.call('get', KEYS[1]) ~= false then return 0 end
+redis.setresp(3)
+if redis.call('get', KEYS[1]) ~= nil or redis.call('hget', KEYS[1], 'f') ~= nil then return 0 end
+return 1`
+		require.EqualValues(t, 1, rdb.Eval(ctx, script, []string{"mynull"}).Val())
+	})
+
 	t.Run("EVAL - Redis protocol type set conversion", func(t *testing.T) {
 		require.NoError(t, rdb.SAdd(ctx, "myset", "m0", "m1", "m2").Err())
 		val, err := rdb.Eval(ctx, `redis.setresp(3); return redis.call('smembers', KEYS[1])`, []string{"myset"}).StringSlice()
@@ -886,3 +896,79 @@ func TestEvalScriptFlags(t *testing.T) {
 
 	})
 }
+
+func TestScriptingWithKeyLocking(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{"lua-key-locking-enabled": "yes"})
+	defer srv.Close()
+
+	ctx := context.Background()
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	t.Run("Scripts declaring their keys run concurrently and atomically", func(t *testing.T) {
+		script := `local v = tonumber(redis.call('GET', KEYS[1]) or '0'); redis.call('SET', KEYS[1], v + 1); return v + 1`
+		var wg sync.WaitGroup
+		for i := 0; i < 8; i++ {
+			wg.Add(1)
+			go func() {
+				defer wg.Done()
+				c := srv.NewClient()
+				defer func() { require.NoError(t, c.Close()) }()
+				for j := 0; j < 100; j++ {
+					require.NoError(t, c.Eval(ctx, script, []string{"counter"}).Err())
+				}
+			}()
+		}
+		wg.Wait()
+		require.Equal(t, "800", rdb.Get(ctx, "counter").Val())
+	})
+
+	t.Run("Scripts running with the key locks can only access the declared keys", func(t *testing.T) {
+		r := rdb.Eval(ctx, `return redis.call('SET', 'undeclared', 'v')`, []string{"declared"})
+		util.ErrorRegexp(t, r.Err(), ".*not declared in KEYS.*")
+		r = rdb.Eval(ctx, `return redis.call('FLUSHDB')`, []string{"declared"})
+		util.ErrorRegexp(t, r.Err(), ".*write command without keys.*")
+		require.EqualValues(t, 0, rdb.Exists(ctx, "undeclared").Val())
+
+		// the keys out of the key range of the command can't be checked
+		require.NoError(t, rdb.RPush(ctx, "declared", 1, 2).Err())
+		r = rdb.Eval(ctx, `return redis.call('SORT', KEYS[1], 'STORE', 'undeclared')`, []string{"declared"})
+		util.ErrorRegexp(t, r.Err(), ".*not declared in KEYS.*")
+		r = rdb.Eval(ctx, `return redis.call('SORT', KEYS[1], 'BY', 'undeclared_*')`, []string{"declared"})
+		util.ErrorRegexp(t, r.Err(), ".*not declared in KEYS.*")
+		r = rdb.Eval(ctx, `return redis.call('SORT', KEYS[1], 'STORE', KEYS[2])`, []string{"declared", "dst"})
+		require.NoError(t, r.Err())
+		require.EqualValues(t, 2, r.Val())
+
+		// the scripts without keys run exclusively as before
+		require.NoError(t, rdb.Eval(ctx, `return redis.call('SET', 'undeclared', 'v')`, []string{}).Err())
+		require.Equal(t, "v", rdb.Get(ctx, "undeclared").Val())
+	})
+
+	t.Run("Writes of the script are applied as a whole", func(t *testing.T) {
+		r := rdb.Eval(ctx, `redis.call('SET', KEYS[1], 'a'); redis.call('SET', KEYS[2], 'b'); return redis.call('MGET', KEYS[1], KEYS[2])`,
+			[]string{"k1", "k2"})
+		require.NoError(t, r.Err())
+		require.Equal(t, []interface{}{"a", "b"}, r.Val())
+		require.Equal(t, []interface{}{"a", "b"}, rdb.MGet(ctx, "k1", "k2").Val())
+	})
+
+	t.Run("EVALSHA doesn't run the flushed scripts", func(t *testing.T) {
+		sha := rdb.ScriptLoad(ctx, `return redis.call('GET', KEYS[1])`).Val()
+		require.Equal(t, "a", rdb.EvalSha(ctx, sha, []string{"k1"}).Val())
+		require.NoError(t, rdb.ScriptFlush(ctx).Err())
+		util.ErrorRegexp(t, rdb.EvalSha(ctx, sha, []string{"k1"}).Err(), ".*NOSCRIPT.*")
+	})
+
+	t.Run("FCALL runs the replaced library", func(t *testing.T) {
+		code := `#!lua name=keylocking
+redis.register_function('keylocking_get', function(keys, args) return redis.call('GET', keys[1]) end)`
+		require.NoError(t, rdb.Do(ctx, "FUNCTION", "LOAD", code).Err())
+		require.Equal(t, "a", rdb.Do(ctx, "FCALL", "keylocking_get", "1", "k1").Val())
+
+		code = `#!lua name=keylocking
+redis.register_function('keylocking_get', function(keys, args) return 'replaced' end)`
+		require.NoError(t, rdb.Do(ctx, "FUNCTION", "LOAD", "REPLACE", code).Err())
+		require.Equal(t, "replaced", rdb.Do(ctx, "FCALL", "keylocking_get", "1", "k1").Val())
+	})
+}
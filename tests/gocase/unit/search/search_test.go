@@ -23,6 +23,7 @@ import (
 	"bytes"
 	"context"
 	"encoding/binary"
+	"fmt"
 	"testing"
 
 	"github.com/apache/kvrocks/tests/gocase/util"
@@ -170,3 +171,30 @@ func TestSearch(t *testing.T) {
 		verify(t)
 	})
 }
+
+func TestSearchInTransaction(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{"search-executor-threads": "3"})
+	defer srv.Close()
+
+	ctx := context.Background()
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	t.Run("FT.SEARCHSQL sees the writes queued before it in the transaction", func(t *testing.T) {
+		require.NoError(t, rdb.Do(ctx, "FT.CREATE", "txnidx", "ON", "HASH", "PREFIX", "1", "txn:", "SCHEMA", "n", "NUMERIC", "NOINDEX").Err())
+
+		cmds, err := rdb.TxPipelined(ctx, func(pipe redis.Pipeliner) error {
+			for i := 0; i < 200; i++ {
+				pipe.HSet(ctx, fmt.Sprintf("txn:%d", i), "n", i)
+			}
+			pipe.Do(ctx, "FT.SEARCHSQL", "select * from txnidx where n >= 150 limit 100")
+			return nil
+		})
+		require.NoError(t, err)
+		inTxn := cmds[len(cmds)-1].(*redis.Cmd).Val().([]interface{})
+		require.EqualValues(t, 50, inTxn[0])
+
+		outOfTxn := rdb.Do(ctx, "FT.SEARCHSQL", "select * from txnidx where n >= 150 limit 100").Val().([]interface{})
+		require.EqualValues(t, 50, outOfTxn[0])
+	})
+}
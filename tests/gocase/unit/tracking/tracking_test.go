@@ -0,0 +1,244 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+package tracking
+
+import (
+	"context"
+	"fmt"
+	"strings"
+	"sync"
+	"testing"
+	"time"
+
+	"github.com/apache/kvrocks/tests/gocase/util"
+	"github.com/redis/go-redis/v9"
+	"github.com/stretchr/testify/require"
+	"golang.org/x/exp/slices"
+)
+
+// subscribeInvalidations returns the id of a client subscribed to the invalidations of a server,
+// which the tracking clients redirect to, and the channel of the received messages
+func subscribeInvalidations(t *testing.T, srv *util.KvrocksServer) (string, <-chan *redis.Message) {
+	ctx := context.Background()
+	// the subscriber is looked up by its name, and closed after the server is
+	sub := srv.NewClientWithOption(&redis.Options{ClientName: "invalidations"})
+	t.Cleanup(func() { _ = sub.Close() })
+	pubsub := sub.Subscribe(ctx, "__redis__:invalidate")
+	t.Cleanup(func() { _ = pubsub.Close() })
+	_, err := pubsub.Receive(ctx)
+	require.NoError(t, err)
+
+	subID := ""
+	for _, line := range strings.Split(sub.ClientList(ctx).Val(), "\n") {
+		if !strings.Contains(line, "name=invalidations") {
+			continue
+		}
+		for _, field := range strings.Fields(line) {
+			if strings.HasPrefix(field, "id=") {
+				subID = strings.TrimPrefix(field, "id=")
+			}
+		}
+	}
+	require.NotEmpty(t, subID)
+	return subID, pubsub.Channel()
+}
+
+// waitForInvalidation waits until the key is invalidated, either by itself or with every key
+func waitForInvalidation(t *testing.T, invalidations <-chan *redis.Message, key string) {
+	timeout := time.After(5 * time.Second)
+	for {
+		select {
+		case msg := <-invalidations:
+			if len(msg.PayloadSlice) == 0 || slices.Contains(msg.PayloadSlice, key) {
+				return
+			}
+		case <-timeout:
+			require.FailNow(t, "the key isn't invalidated", key)
+		}
+	}
+}
+
+// drainInvalidations drops the invalidations received so far
+func drainInvalidations(invalidations <-chan *redis.Message) {
+	for {
+		select {
+		case <-invalidations:
+		case <-time.After(100 * time.Millisecond):
+			return
+		}
+	}
+}
+
+func TestTrackingWithConcurrentWrites(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{
+		"workers":                 "2",
+		"txn-key-locking-enabled": "yes",
+	})
+	defer srv.Close()
+
+	ctx := context.Background()
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+
+	// the invalidations are redirected to a subscriber
+	subID, invalidations := subscribeInvalidations(t, srv)
+
+	tracker := srv.NewClient()
+	defer func() { require.NoError(t, tracker.Close()) }()
+	conn := tracker.Conn()
+	defer func() { require.NoError(t, conn.Close()) }()
+	require.NoError(t, conn.Do(ctx, "CLIENT", "TRACKING", "ON", "REDIRECT", subID).Err())
+
+	for _, useExec := range []bool{false, true} {
+		t.Run(fmt.Sprintf("The cached value is never left stale by the writes of other workers (exec: %v)", useExec), func(t *testing.T) {
+			key := fmt.Sprintf("tracked-key-%v", useExec)
+			require.NoError(t, rdb.Set(ctx, key, "0", 0).Err())
+
+			// the connections of the writers are spread over both workers
+			var wg sync.WaitGroup
+			stop := make(chan struct{})
+			for w := 0; w < 4; w++ {
+				wg.Add(1)
+				go func(w int) {
+					defer wg.Done()
+					writer := srv.NewClient()
+					defer func() { _ = writer.Close() }()
+					for i := 1; ; i++ {
+						select {
+						case <-stop:
+							return
+						default:
+						}
+						value := fmt.Sprintf("%d-%d", w, i)
+						if useExec {
+							_, _ = writer.TxPipelined(ctx, func(pipe redis.Pipeliner) error {
+								pipe.Set(ctx, key, value, 0)
+								return nil
+							})
+						} else {
+							writer.Set(ctx, key, value, 0)
+						}
+					}
+				}(w)
+			}
+
+			cached, hasCached := "", false
+			drain := func() {
+				for {
+					select {
+					case msg := <-invalidations:
+						// an empty payload invalidates every key
+						if len(msg.PayloadSlice) == 0 || slices.Contains(msg.PayloadSlice, key) {
+							hasCached = false
+						}
+					default:
+						return
+					}
+				}
+			}
+			for deadline := time.Now().Add(2 * time.Second); time.Now().Before(deadline); {
+				drain()
+				if !hasCached {
+					cached = conn.Get(ctx, key).Val()
+					hasCached = true
+				}
+			}
+			close(stop)
+			wg.Wait()
+
+			// once the writes stop, the cached value is either invalidated or up to date
+			current := rdb.Get(ctx, key).Val()
+			require.Eventually(t, func() bool {
+				drain()
+				return !hasCached || cached == current
+			}, 5*time.Second, 10*time.Millisecond)
+		})
+	}
+}
+
+func TestTrackingExpiredKeys(t *testing.T) {
+	srv := util.StartServer(t, map[string]string{})
+	defer srv.Close()
+
+	ctx := context.Background()
+	rdb := srv.NewClient()
+	defer func() { require.NoError(t, rdb.Close()) }()
+	subID, invalidations := subscribeInvalidations(t, srv)
+
+	tracker := srv.NewClient()
+	defer func() { require.NoError(t, tracker.Close()) }()
+	conn := tracker.Conn()
+	defer func() { require.NoError(t, conn.Close()) }()
+	require.NoError(t, conn.Do(ctx, "CLIENT", "TRACKING", "ON", "REDIRECT", subID).Err())
+
+	t.Run("The cached key is invalidated once it expires", func(t *testing.T) {
+		require.NoError(t, rdb.Set(ctx, "expiring-key", "value", 500*time.Millisecond).Err())
+		require.Equal(t, "value", conn.Get(ctx, "expiring-key").Val())
+		waitForInvalidation(t, invalidations, "expiring-key")
+		require.Empty(t, conn.Get(ctx, "expiring-key").Val())
+	})
+}
+
+func TestTrackingOnReplica(t *testing.T) {
+	master := util.StartServer(t, map[string]string{})
+	defer master.Close()
+	replica := util.StartServer(t, map[string]string{})
+	defer replica.Close()
+
+	ctx := context.Background()
+	masterClient := master.NewClient()
+	defer func() { require.NoError(t, masterClient.Close()) }()
+	replicaClient := replica.NewClient()
+	defer func() { require.NoError(t, replicaClient.Close()) }()
+	util.SlaveOf(t, replicaClient, master)
+	util.WaitForSync(t, replicaClient)
+
+	subID, invalidations := subscribeInvalidations(t, replica)
+	tracker := replica.NewClient()
+	defer func() { require.NoError(t, tracker.Close()) }()
+	conn := tracker.Conn()
+	defer func() { require.NoError(t, conn.Close()) }()
+	require.NoError(t, conn.Do(ctx, "CLIENT", "TRACKING", "ON", "REDIRECT", subID).Err())
+
+	t.Run("The keys written by the master are invalidated on the replica", func(t *testing.T) {
+		require.NoError(t, masterClient.HSet(ctx, "replicated-hash", "field", "1").Err())
+		require.Eventually(t, func() bool {
+			return conn.HGet(ctx, "replicated-hash", "field").Val() == "1"
+		}, 5*time.Second, 10*time.Millisecond)
+
+		// a field update only writes the subkey
+		drainInvalidations(invalidations)
+		require.NoError(t, masterClient.HSet(ctx, "replicated-hash", "field", "2").Err())
+		waitForInvalidation(t, invalidations, "replicated-hash")
+		require.Eventually(t, func() bool {
+			return conn.HGet(ctx, "replicated-hash", "field").Val() == "2"
+		}, 5*time.Second, 10*time.Millisecond)
+	})
+
+	t.Run("The keys flushed by the master are invalidated on the replica", func(t *testing.T) {
+		require.NoError(t, masterClient.Set(ctx, "replicated-key", "value", 0).Err())
+		require.Eventually(t, func() bool {
+			return conn.Get(ctx, "replicated-key").Val() == "value"
+		}, 5*time.Second, 10*time.Millisecond)
+		drainInvalidations(invalidations)
+		require.NoError(t, masterClient.FlushDB(ctx).Err())
+		waitForInvalidation(t, invalidations, "replicated-key")
+	})
+}